@@ -0,0 +1,138 @@
+
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/*
+ * class AtomicQueue - Thread-safe lock-free bounded queue
+ *
+ * This is a fixed sized ring buffer that allows many producers and many
+ * consumers. Each slot has a sequence number that tells whether the slot
+ * is ready to be written by the producer at a given position, or to be read
+ * by the consumer at that position. Producers and consumers claim positions
+ * by CAS on the tail and head counters respectively, so an operation only
+ * retries when another thread has claimed the same position.
+ *
+ * NOTE: QUEUE_SIZE must be a power of two. Type T is required to be
+ * trivially copy assign-able and default constructable, since elements are
+ * copied into and out of slots and an empty value is returned on failure
+ *
+ * NOTE 2: Push() fails instead of blocking if the queue is full, and Pop()
+ * returns as if the queue were empty if the slot at the head is still being
+ * written
+ */
+template <typename T, size_t QUEUE_SIZE>
+class AtomicQueue {
+  static_assert((QUEUE_SIZE & (QUEUE_SIZE - 1)) == 0UL,
+                "Queue size must be a power of two");
+
+ private:
+  /*
+   * class Slot - One element in the ring buffer
+   */
+  class Slot {
+   public:
+    std::atomic<uint64_t> sequence;
+    T data;
+  };
+
+  Slot slot_list[QUEUE_SIZE];
+
+  // Next position to be written and read respectively. They are padded to
+  // different cache lines since they are modified by different threads
+  std::atomic<uint64_t> tail;
+  char padding[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> head;
+
+ public:
+
+  /*
+   * Default Constructor - Slot i is ready to be written at position i
+   */
+  AtomicQueue() :
+    tail{0UL},
+    head{0UL} {
+    for(size_t i = 0;i < QUEUE_SIZE;i++) {
+      slot_list[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    return;
+  }
+
+  AtomicQueue(const AtomicQueue &) = delete;
+  AtomicQueue &operator=(const AtomicQueue &) = delete;
+
+  /*
+   * Push() - Pushes an item at the tail of the queue
+   *
+   * Returns false if the queue is full
+   */
+  inline bool Push(const T &item) {
+    uint64_t pos = tail.load(std::memory_order_relaxed);
+
+    while(1) {
+      Slot *slot_p = &slot_list[pos & (QUEUE_SIZE - 1)];
+      uint64_t seq = slot_p->sequence.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(seq - pos);
+
+      if(diff == 0) {
+        // The slot is free; claim the position. On failure pos is reloaded
+        if(tail.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed) == true) {
+          slot_p->data = item;
+
+          // Make the slot visible to the consumer at this position
+          slot_p->sequence.store(pos + 1, std::memory_order_release);
+
+          return true;
+        }
+      } else if(diff < 0) {
+        // The slot still holds an item from the previous round
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    assert(false);
+    return false;
+  }
+
+  /*
+   * Pop() - Pops one item from the head of the queue
+   *
+   * The return value is a pair of whether an item is popped and the item
+   * itself. If the queue is empty the item is default constructed
+   */
+  inline std::pair<bool, T> Pop() {
+    uint64_t pos = head.load(std::memory_order_relaxed);
+
+    while(1) {
+      Slot *slot_p = &slot_list[pos & (QUEUE_SIZE - 1)];
+      uint64_t seq = slot_p->sequence.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(seq - (pos + 1));
+
+      if(diff == 0) {
+        if(head.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed) == true) {
+          auto ret = std::make_pair(true, slot_p->data);
+
+          // The slot could be written at position pos + QUEUE_SIZE
+          slot_p->sequence.store(pos + QUEUE_SIZE, std::memory_order_release);
+
+          return ret;
+        }
+      } else if(diff < 0) {
+        return {false, T{}};
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+
+    assert(false);
+    return {false, T{}};
+  }
+};
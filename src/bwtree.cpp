@@ -28,8 +28,13 @@ bool print_flag = true;
 // is free to change them
 thread_local int BwTreeBase::gc_id = -1;
 
+thread_local uint64_t BwTreeBase::gc_generation = 0UL;
+
 std::atomic<size_t> BwTreeBase::total_thread_num{0UL};
 
+// All GC IDs start free with generation 0
+std::atomic<uint64_t> BwTreeBase::gc_id_generation_list[MAX_GC_ID_NUM] = {};
+
 }  // End index/bwtree namespace
 }  // End peloton/wangziqi2013 namespace
 
@@ -30,12 +30,26 @@
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <unordered_set>
 // offsetof() is defined here
 #include <cstddef>
 #include <vector>
 
+// These are used by checkpointing
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 /*
  * BWTREE_PELOTON - Specifies whether Peloton-specific features are
  *                  Compiled or not
@@ -56,12 +70,32 @@
 
 #endif
 
+/*
+ * BWTREE_USE_RTM - Compiles the Intel RTM fast path of leaf delta
+ *                  installation (see SetRTMMode()). Whether the CPU
+ *                  supports RTM is still checked at run time
+ */
+//#define BWTREE_USE_RTM
+
+#ifdef BWTREE_USE_RTM
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#endif
+
 // This must be declared before all include directives
 using NodeID = uint64_t;
 
 #include "sorted_small_set.h"
 #include "bloom_filter.h"
 #include "atomic_stack.h"
+#include "atomic_queue.h"
+#include "read_cache.h"
+#include "page_allocator.h"
+#include "mapping_table.h"
+#include "node_allocator.h"
+#include "fixed_length_key.h"
 
 // Copied from Linux kernel code to facilitate branch prediction unit on CPU
 // if there is one
@@ -85,11 +119,6 @@ using NodeID = uint64_t;
  */
 #define ALL_PUBLIC
 
-/*
- * USE_OLD_EPOCH - This flag switches between old epoch and new epoch mechanism
- */
-//#define USE_OLD_EPOCH
-
 /*
  * BWTREE_TEMPLATE_ARGUMENTS - Save some key strokes
  */
@@ -138,15 +167,33 @@ extern bool print_flag;
 // that the node is actually the last node on that level
 #define INVALID_NODE_ID ((NodeID)0UL)
 
-// The NodeID for the first leaf is fixed, which is 2
+// The NodeID of the first leaf of a new tree, which is 2
 #define FIRST_LEAF_NODE_ID ((NodeID)2UL)
 
+// Leaf delta records and leaf base nodes are stamped with versions smaller
+// than this, so reading at this version sees the latest state of a leaf
+#define LATEST_VERSION ((uint64_t)-1)
+
 // This is the value we use in epoch manager to make sure
 // no thread sneaking in while GC decision is being made
 #define MAX_THREAD_COUNT ((int)0x7FFFFFFF)
 
+// The mapping table is allocated in segments of (1 << SEGMENT_BITS) NodeIDs
+// on demand, and the directory of segments has a fixed size
+#define MAPPING_TABLE_SEGMENT_BITS ((size_t)16)
+#define MAPPING_TABLE_DIRECTORY_SIZE ((size_t)(1 << 14))
+
 // The maximum number of nodes we could map in this index
-#define MAPPING_TABLE_SIZE ((size_t)(1 << 20))
+#define MAPPING_TABLE_SIZE \
+  (MAPPING_TABLE_DIRECTORY_SIZE << MAPPING_TABLE_SEGMENT_BITS)
+
+// The maximum number of recycled NodeIDs that could be buffered
+#define FREE_NODE_ID_LIST_SIZE ((size_t)(1 << 16))
+
+// The number of NodeIDs a thread reserves from the shared counter at a time
+#define NODE_ID_CHUNK_SIZE ((NodeID)64)
+
+// The following thresholds are default values of class DefaultTuningPolicy
 
 // If the length of delta chain exceeds ( >= ) this then we consolidate the node
 #define INNER_DELTA_CHAIN_LENGTH_THRESHOLD ((int)8)
@@ -161,17 +208,87 @@ extern bool print_flag;
 
 #define PREALLOCATE_THREAD_NUM ((size_t)1024)
 
+// The number of NodeIDs that could be pending for background consolidation
+#define CONSOLIDATION_QUEUE_SIZE ((size_t)(1 << 12))
+
+// With background consolidation, worker threads still consolidate inline
+// if the delta chain is this many times longer than the threshold
+#define CONSOLIDATION_HARD_CAP_FACTOR ((int)4)
+
+// Background consolidation threads sleep for this long if the queue is empty
+#define CONSOLIDATION_IDLE_INTERVAL_US ((int)100)
+
+// With adaptive consolidation, one in this many leaf accesses of a thread
+// is counted into the access counter of the leaf's NodeID
+#define NODE_ACCESS_SAMPLE_INTERVAL ((uint32_t)4)
+
+// The number of access counters. NodeIDs are mapped to counters by their
+// lower bits, so this must be a power of two
+#define NODE_ACCESS_COUNTER_NUM ((size_t)(1 << 14))
+
+// Both halves of an access counter are halved if either reaches this
+#define NODE_ACCESS_COUNTER_LIMIT ((uint32_t)64)
+
+// A leaf needs this many sampled accesses before its threshold is adjusted
+#define NODE_ACCESS_MIN_SAMPLE ((uint32_t)8)
+
+// A leaf is read-hot (write-hot) if its sampled reads (writes) are at least
+// this many times its sampled writes (reads)
+#define NODE_ACCESS_SKEW_FACTOR ((uint32_t)4)
+
+// The number of keys whose traversals are interleaved in GetValueBatch()
+// when prefetching is enabled
+#define BATCH_PREFETCH_GROUP_SIZE ((size_t)8)
+
+// The number of cache lines prefetched from the start of a node
+#define NODE_PREFETCH_LINE_NUM ((size_t)3)
+
+// For integer keys with std::less, ranges no longer than this are searched
+// with a linear scan instead of binary search
+#define INTEGER_KEY_LINEAR_SEARCH_THRESHOLD ((size_t)16)
+
+// The number of times a leaf delta is retried in an RTM transaction after
+// a transient abort before falling back to CAS
+#define RTM_RETRY_COUNT ((int)3)
+
+// Explicit abort code of an RTM transaction that finds the leaf changed
+#define RTM_ABORT_NODE_CHANGED ((unsigned)0xFF)
+
+// The number of random descents of SampleKeys() tried for a sample before
+// it is given up, if descents keep ending in empty nodes
+#define SAMPLE_DESCENT_RETRY_COUNT ((int)64)
+
+// ParallelScan() descends until there are at least this many subtrees
+// per partition, or leaves are reached, before cutting the key range
+#define SCAN_PARTITION_SUBTREE_NUM ((size_t)8)
+
+// Parallel teardown frees top levels on one thread until there are at least
+// this many subtrees per thread, or leaves are reached
+#define TEARDOWN_SUBTREE_NUM ((size_t)8)
+
+// The interval at which the reclaim thread of Truncate() checks whether
+// threads that could see the old tree have left their epochs
+#define RECLAIM_POLL_INTERVAL_US ((int)1000)
+
+// The bit of ElasticNode::pin_count set once a pinned leaf is retired
+#define PIN_RETIRED_FLAG (((uint64_t)0x1UL) << 63)
+
+// The number of bits per key in the fingerprint of a consolidated leaf
+#define LEAF_FINGERPRINT_BITS_PER_KEY ((size_t)8)
+
 /*
  * InnerInlineAllocateOfType() - allocates a chunk of memory from base node and
  *                               initialize it using placement new and then 
  *                               return its pointer
  *
- * This is used for InnerNode delta chains
+ * This is used for InnerNode delta chains. Chunks grown for the allocation
+ * are counted into node_memory_size of the tree
  */
 #define InnerInlineAllocateOfType(T, node_p, ...) (static_cast<T *>( \
                                                      new(ElasticNode<KeyNodeIDPair>::InlineAllocate( \
                                                          &node_p->GetLowKeyPair(), \
-                                                         sizeof(T)) \
+                                                         sizeof(T), \
+                                                         &node_memory_size) \
                                                      ) T{ __VA_ARGS__ } ))
                                                      
 /*
@@ -179,18 +296,21 @@ extern bool print_flag;
  *                              initialize it using placement new and then 
  *                              return its pointer
  *
- * This is used for LeafNode delta chains
+ * This is used for LeafNode delta chains. Chunks grown for the allocation
+ * are counted into node_memory_size of the tree
  */
 #define LeafInlineAllocateOfType(T, node_p, ...) (static_cast<T *>( \
                                                     new(ElasticNode<KeyValuePair>::InlineAllocate( \
                                                         &node_p->GetLowKeyPair(), \
-                                                        sizeof(T)) \
+                                                        sizeof(T), \
+                                                        &node_memory_size) \
                                                     ) T{__VA_ARGS__} ))
 
 /*
  * class BwTreeBase - Base class of BwTree that stores some common members
  */
 class BwTreeBase {
+ protected:
   // This is the presumed size of cache line
   static constexpr size_t CACHE_LINE_SIZE = 64;
   
@@ -198,8 +318,30 @@ class BwTreeBase {
   static constexpr size_t CACHE_LINE_MASK = ~(CACHE_LINE_SIZE - 1);
   
   // We invoke the GC procedure after this has been reached
+  // This is the initial value of the per-thread adaptive threshold
   static constexpr size_t GC_NODE_COUNT_THREADHOLD = 1024;
   
+  // The adaptive GC threshold of a thread never grows beyond this
+  static constexpr size_t GC_NODE_COUNT_THREADHOLD_MAX = \
+    GC_NODE_COUNT_THREADHOLD * 64;
+  
+  // The maximum number of GC IDs, including both IDs handed out by
+  // RegisterThread() and IDs assigned manually
+  static constexpr size_t MAX_GC_ID_NUM = 1024;
+  
+  // The maximum number of epochs pinned at the same time by snapshots of
+  // a tree instance (see BwTree::Snapshot())
+  static constexpr size_t MAX_PINNED_EPOCH_NUM = 64;
+  
+  // Thread local slots of a tree instance are allocated in segments of
+  // this many slots when a GC ID in the segment is first used
+  static constexpr size_t THREAD_LOCAL_SEGMENT_SIZE = 16;
+  static constexpr size_t THREAD_LOCAL_SEGMENT_NUM = \
+    MAX_GC_ID_NUM / THREAD_LOCAL_SEGMENT_SIZE;
+  
+  // The last active epoch of a slot that does not belong to an active thread
+  static constexpr uint64_t INACTIVE_EPOCH = static_cast<uint64_t>(-1);
+  
   /*
    * class GarbageNode - Garbage node used to represent delayed allocation
    *
@@ -214,22 +356,71 @@ class BwTreeBase {
     // actual epoch it is unlinked from the data structure
     uint64_t delete_epoch;
     void *node_p;
-    GarbageNode *next_p;
+    
+    // The bytes counted into garbage_memory_size when the node is retired
+    size_t memory_size;
     
     /*
      * Constructor
      */
-    GarbageNode(uint64_t p_delete_epoch, void *p_node_p) :
+    GarbageNode(uint64_t p_delete_epoch,
+                void *p_node_p,
+                size_t p_memory_size) :
       delete_epoch{p_delete_epoch},
       node_p{p_node_p},
-      next_p{nullptr}
+      memory_size{p_memory_size}
     {}
     
     GarbageNode() :
       delete_epoch{0UL},
       node_p{nullptr},
-      next_p{nullptr}
+      memory_size{0UL}
+    {}
+  };
+  
+  /*
+   * class GarbageSegment - A fixed sized array of garbage nodes
+   *
+   * Garbage nodes of a thread are appended to a FIFO list of segments, such
+   * that retiring a node is a store into the tail segment rather than a
+   * memory allocation. Since nodes are appended in the order they are
+   * unlinked, inside one thread's context they are always sorted from low
+   * epoch to high epoch, and GC consumes nodes from the head of the oldest
+   * segment until it sees an epoch >= GC epoch
+   *
+   * NOTE: Segments drained by GC are kept in a per-thread free list and are
+   * reused; they are only freed when the thread local storage is cleared
+   */
+  class GarbageSegment {
+   public:
+    // The size of a segment is slightly less than 4KB
+    static constexpr size_t NODE_NUM = 254UL;
+    
+    // The next (newer) segment in the list
+    GarbageSegment *next_p;
+    
+    // Nodes in [begin_index, end_index) have not been freed
+    size_t begin_index;
+    size_t end_index;
+    
+    GarbageNode node_list[NODE_NUM];
+    
+    /*
+     * Default constructor
+     */
+    GarbageSegment() :
+      next_p{nullptr},
+      begin_index{0UL},
+      end_index{0UL}
     {}
+    
+    inline bool IsFull() const {
+      return end_index == NODE_NUM;
+    }
+    
+    inline bool IsEmpty() const {
+      return begin_index == end_index;
+    }
   };
   
   /*
@@ -244,34 +435,51 @@ class BwTreeBase {
     // be recycled
     uint64_t last_active_epoch;
     
-    // We only need a pointer
-    GarbageNode header; 
+    // The oldest and the newest segment of garbage nodes
+    // Both are nullptr if there is no garbage in this context
+    GarbageSegment *head_p;
+    GarbageSegment *tail_p;
     
-    // This points to the last node in the garbage node linked list
-    // We always append new nodes to this pointer, and thus inside one
-    // node's context these garbage nodes are always sorted, from low
-    // epoch to high epoch. This facilitates memory reclaimation since we
-    // just start from the lowest epoch garbage and traverse the linked list
-    // until we see an epoch >= GC epoch
-    GarbageNode *last_p;
+    // Empty segments that could be reused
+    GarbageSegment *free_segment_p;
     
     // The number of nodes inside this GC context
     // We use this as a threshold to trigger GC
     uint64_t node_count;
     
+    // GC is triggered when node_count exceeds this value. It grows when GC
+    // could not free most nodes (i.e. the epoch has not advanced enough) to
+    // avoid repeatedly scanning the same garbage, and shrinks back when GC
+    // catches up
+    uint64_t gc_threshold;
+    
+    // The registration generation of the thread that last announced its
+    // epoch in this slot, or 0 if the GC ID was assigned manually. If the
+    // thread has exited the generation of the GC ID has changed, and the
+    // slot is ignored when taking the minimum epoch
+    uint64_t owner_generation;
+    
+    // Stable value slots reclaimed by GC of this thread, which are reused
+    // by the next allocation of this thread (see BwTree::NewStableValue())
+    void *free_value_slot_p;
+    
     /*
-     * Default constructor
+     * Default constructor - The slot is inactive until a thread joins
      */
     GCMetaData() :
-      last_active_epoch{0UL},
-      header{},
-      last_p{&header},
-      node_count{0UL}
+      last_active_epoch{INACTIVE_EPOCH},
+      head_p{nullptr},
+      tail_p{nullptr},
+      free_segment_p{nullptr},
+      node_count{0UL},
+      gc_threshold{GC_NODE_COUNT_THREADHOLD},
+      owner_generation{0UL},
+      free_value_slot_p{nullptr}
     {}
   };
   
   // Make sure class Data does not exceed one cache line
-  static_assert(sizeof(GCMetaData) < CACHE_LINE_SIZE,
+  static_assert(sizeof(GCMetaData) <= CACHE_LINE_SIZE,
                 "class Data size exceeds cache line length!");
   
   /*
@@ -304,32 +512,307 @@ class BwTreeBase {
   static_assert(sizeof(PaddedGCMetadata) == PaddedGCMetadata::ALIGNMENT, 
                 "class PaddedGCMetadata size does"
                 " not conform to the alignment!");
+  
+  /*
+   * class ThreadStatistics - Per-thread counters of tree operations
+   *
+   * Counters of a slot are only written by the thread owning the GC ID of
+   * the slot, using a relaxed load followed by a relaxed store, which is
+   * a plain add without any lock prefix. Other threads could read them at
+   * any time without synchronization to aggregate a snapshot
+   */
+  class ThreadStatistics {
+   public:
+    // Number of operations issued by the thread. Upsert is counted
+    // as an update, and every key of a batch lookup is counted as a read
+    std::atomic<uint64_t> insert_op_count;
+    std::atomic<uint64_t> delete_op_count;
+    std::atomic<uint64_t> update_op_count;
+    std::atomic<uint64_t> read_op_count;
+    
+    // Number of failed CAS when installing the delta of an operation
+    std::atomic<uint64_t> insert_abort_count;
+    std::atomic<uint64_t> delete_abort_count;
+    std::atomic<uint64_t> update_abort_count;
+    
+    // Number of traversals from the root, and the number of times they
+    // restart from the root after an abort
+    std::atomic<uint64_t> traversal_count;
+    std::atomic<uint64_t> traversal_abort_count;
+    
+    // Number of nodes loaded during traversals and the sum of the length
+    // of their delta chains
+    std::atomic<uint64_t> node_visit_count;
+    std::atomic<uint64_t> delta_chain_length_sum;
+    
+    // Number of successful SMO installed by this thread, and the number of
+    // times the thread helps along an unfinished SMO in FinishPartialSMO()
+    std::atomic<uint64_t> consolidation_count;
+    std::atomic<uint64_t> split_count;
+    std::atomic<uint64_t> merge_count;
+    std::atomic<uint64_t> smo_help_count;
+    
+    // Number of leaf consolidations performed below the threshold since
+    // the leaf is read-hot, and the number of times a write-hot leaf at or
+    // above the threshold is left unconsolidated (see SetAdaptiveConsolidation())
+    std::atomic<uint64_t> early_consolidation_count;
+    std::atomic<uint64_t> deferred_consolidation_count;
+    
+    // Number of lookups served by the read cache and the number of misses,
+    // which are only counted if the cache is enabled
+    std::atomic<uint64_t> read_cache_hit_count;
+    std::atomic<uint64_t> read_cache_miss_count;
+    
+    // Number of modifications that start from the leaf finger, and the
+    // number of those falling back to a traversal from the root
+    std::atomic<uint64_t> leaf_finger_hit_count;
+    std::atomic<uint64_t> leaf_finger_miss_count;
+    
+    // Number of retries after a failed leaf delta installation that start
+    // from the same leaf instead of the root (see SetLeafRetryMode())
+    std::atomic<uint64_t> leaf_retry_count;
+    
+    // Number of key-value pairs added to and removed from the tree by the
+    // thread. Their difference summed over all threads is the size of the
+    // tree (see GetApproximateSize())
+    std::atomic<uint64_t> item_insert_count;
+    std::atomic<uint64_t> item_delete_count;
+    
+    // Number of times the thread collects its garbage in PerformGC(), and
+    // the total time spent there in nanoseconds
+    std::atomic<uint64_t> gc_count;
+    std::atomic<uint64_t> gc_time;
+    
+    /*
+     * Default constructor
+     */
+    ThreadStatistics() :
+      insert_op_count{0UL},
+      delete_op_count{0UL},
+      update_op_count{0UL},
+      read_op_count{0UL},
+      insert_abort_count{0UL},
+      delete_abort_count{0UL},
+      update_abort_count{0UL},
+      traversal_count{0UL},
+      traversal_abort_count{0UL},
+      node_visit_count{0UL},
+      delta_chain_length_sum{0UL},
+      consolidation_count{0UL},
+      split_count{0UL},
+      merge_count{0UL},
+      smo_help_count{0UL},
+      early_consolidation_count{0UL},
+      deferred_consolidation_count{0UL},
+      read_cache_hit_count{0UL},
+      read_cache_miss_count{0UL},
+      leaf_finger_hit_count{0UL},
+      leaf_finger_miss_count{0UL},
+      leaf_retry_count{0UL},
+      item_insert_count{0UL},
+      item_delete_count{0UL},
+      gc_count{0UL},
+      gc_time{0UL}
+    {}
+  };
+  
+  // Statistics of a thread take four cache lines
+  using PaddedThreadStatistics = \
+    PaddedData<ThreadStatistics, CACHE_LINE_SIZE * 4>;
+  
+  static_assert(sizeof(PaddedThreadStatistics) == \
+                PaddedThreadStatistics::ALIGNMENT,
+                "class PaddedThreadStatistics size does"
+                " not conform to the alignment!");
+  
+  /*
+   * class LeafFinger - The NodeID of the leaf last modified by a thread
+   *
+   * It is only a hint. Before it is used the node is loaded again and its
+   * range is checked against the search key. The tree generation read
+   * before the traversal is kept as well, since a leaf of a tree dropped by
+   * BwTree::Truncate() could still have a matching range. Root NodeIDs are
+   * recycled after the old tree is freed, so they could not be used here
+   */
+  class LeafFinger {
+   public:
+    NodeID node_id;
+    uint64_t generation;
+    
+    /*
+     * Default constructor
+     */
+    LeafFinger() :
+      node_id{INVALID_NODE_ID},
+      generation{0UL}
+    {}
+  };
+  
+  using PaddedLeafFinger = PaddedData<LeafFinger, CACHE_LINE_SIZE>;
+  
+  static_assert(sizeof(PaddedLeafFinger) == PaddedLeafFinger::ALIGNMENT,
+                "class PaddedLeafFinger size does"
+                " not conform to the alignment!");
+  
+  /*
+   * class NodeIDCache - NodeIDs reserved by a thread but not yet used
+   *
+   * IDs in [next_node_id, end_node_id) are handed out by GetNextNodeID()
+   * of the thread without touching the shared counter. IDs left in the
+   * slot of an exited thread are used by the next owner of the GC ID
+   */
+  class NodeIDCache {
+   public:
+    NodeID next_node_id;
+    NodeID end_node_id;
+    
+    /*
+     * Default constructor - The cache is empty
+     */
+    NodeIDCache() :
+      next_node_id{INVALID_NODE_ID},
+      end_node_id{INVALID_NODE_ID}
+    {}
+  };
+  
+  using PaddedNodeIDCache = PaddedData<NodeIDCache, CACHE_LINE_SIZE>;
+  
+  static_assert(sizeof(PaddedNodeIDCache) == PaddedNodeIDCache::ALIGNMENT,
+                "class PaddedNodeIDCache size does"
+                " not conform to the alignment!");
+  
+  /*
+   * class ThreadLocalSegment - GC metadata and statistics slots of a range
+   *                            of GC IDs
+   *
+   * Segments are allocated with their address aligned to cache line
+   * boundary, and are only freed when the thread local storage is destroyed
+   */
+  class ThreadLocalSegment {
+   public:
+    PaddedGCMetadata gc_metadata_list[THREAD_LOCAL_SEGMENT_SIZE];
+    PaddedThreadStatistics statistics_list[THREAD_LOCAL_SEGMENT_SIZE];
+    PaddedLeafFinger leaf_finger_list[THREAD_LOCAL_SEGMENT_SIZE];
+    PaddedNodeIDCache node_id_cache_list[THREAD_LOCAL_SEGMENT_SIZE];
+    
+    // The address returned by malloc() before alignment
+    void *original_p;
+  };
+  
+ public:
+ 
+  /*
+   * class Statistics - A snapshot of statistics of a tree instance
+   *
+   * Counters are sums of ThreadStatistics over all thread slots. Since the
+   * slots are read without stopping worker threads, counters of a snapshot
+   * might not be consistent with each other
+   */
+  class Statistics {
+   public:
+    uint64_t insert_op_count;
+    uint64_t delete_op_count;
+    uint64_t update_op_count;
+    uint64_t read_op_count;
+    
+    uint64_t insert_abort_count;
+    uint64_t delete_abort_count;
+    uint64_t update_abort_count;
+    
+    uint64_t traversal_count;
+    uint64_t traversal_abort_count;
+    
+    uint64_t node_visit_count;
+    uint64_t delta_chain_length_sum;
+    
+    uint64_t consolidation_count;
+    uint64_t split_count;
+    uint64_t merge_count;
+    uint64_t smo_help_count;
+    
+    uint64_t early_consolidation_count;
+    uint64_t deferred_consolidation_count;
+    
+    uint64_t read_cache_hit_count;
+    uint64_t read_cache_miss_count;
+    
+    uint64_t leaf_finger_hit_count;
+    uint64_t leaf_finger_miss_count;
+    
+    uint64_t leaf_retry_count;
+    
+    uint64_t item_insert_count;
+    uint64_t item_delete_count;
+    
+    uint64_t gc_count;
+    uint64_t gc_time;
+    
+    // Number of garbage nodes not yet freed in all GC contexts
+    uint64_t gc_backlog;
+    
+    // Difference between the global epoch and the minimum last active
+    // epoch of all registered threads
+    uint64_t epoch_lag;
+  };
  
- private: 
+ protected:
   // This is used as the garbage collection ID, and is maintained in a per
   // thread level
   // This is initialized to -1 in order to distinguish between registered 
   // threads and unregistered threads
   static thread_local int gc_id;
   
-  // This is used to count the number of threads participating GC process
+  // The registration generation of the current thread's GC ID, or 0 if
+  // the thread is not registered through RegisterThread()
+  static thread_local uint64_t gc_generation;
+  
+  // This is the high water mark of GC IDs handed out by RegisterThread()
   // We use this number to initialize GC data structure
   static std::atomic<size_t> total_thread_num;
   
-  // This is the array being allocated for performing GC
-  // The allocation aligns its address to cache line boundary
-  PaddedGCMetadata *gc_metadata_p;
+  // Registration generation of each GC ID. An odd number means the ID is
+  // owned by a live thread, and an even number means the ID is free. It is
+  // increased by one when the ID is taken and when it is released
+  static std::atomic<uint64_t> gc_id_generation_list[MAX_GC_ID_NUM];
   
-  // We use this to compute aligned memory address to be
-  // used as the gc metadata array
-  unsigned char *original_p;
+  // Segments of thread local slots; nullptr if no GC ID in the segment has
+  // been used with this instance
+  std::atomic<ThreadLocalSegment *> segment_list[THREAD_LOCAL_SEGMENT_NUM];
   
-  // This is the number of thread that this instance could support
+  // One plus the largest index of allocated segments, such that scanning
+  // slots is bounded by the largest GC ID in use rather than MAX_GC_ID_NUM
+  std::atomic<size_t> segment_num;
+  
+  // This is the number of slots allocated by PrepareThreadLocal(), which
+  // serve GC IDs assigned manually
   size_t thread_num;
   
   // This is current epoch
   // We need to make it atomic since multiple threads might try to modify it
-  uint64_t epoch;
+  std::atomic<uint64_t> epoch;
+  
+  // The result of the last SummarizeGCEpoch() and the global epoch when it
+  // was computed. Threads only take the O(thread_num) minimum again after
+  // the global epoch has changed
+  std::atomic<uint64_t> cached_gc_epoch;
+  std::atomic<uint64_t> cached_gc_epoch_version;
+  
+  // Epochs pinned by PinEpoch(), or INACTIVE_EPOCH for free slots. They
+  // are taken into the minimum epoch in the same way as thread slots
+  std::atomic<uint64_t> pinned_epoch_list[MAX_PINNED_EPOCH_NUM];
+  
+  /*
+   * class GCIDHandle - Releases the GC ID of a registered thread when the
+   *                    thread exits
+   */
+  class GCIDHandle {
+   public:
+    ~GCIDHandle() {
+      ReleaseGCID();
+      
+      return;
+    }
+  };
   
  public:
    
@@ -346,20 +829,29 @@ class BwTreeBase {
    * This function must be called when the garbage pool is empty
    */
   void DestroyThreadLocal() {
-    bwt_printf("Destroy %lu thread local slots\n", thread_num);
-    
-    // There must already be metadata allocated
-    assert(original_p != nullptr);
+    bwt_printf("Destroy %lu thread local segments\n", segment_num.load());
     
-    // Manually call destructor
-    for(size_t i = 0;i < thread_num;i++) {
-      assert((gc_metadata_p + i)->data.header.next_p == nullptr);
+    for(size_t i = 0;i < segment_num.load();i++) {
+      ThreadLocalSegment *segment_p = segment_list[i].load();
+      if(segment_p == nullptr) {
+        continue;
+      }
+      
+      for(size_t j = 0;j < THREAD_LOCAL_SEGMENT_SIZE;j++) {
+        assert(segment_p->gc_metadata_list[j].data.head_p == nullptr);
+        assert(segment_p->gc_metadata_list[j].data.free_segment_p == nullptr);
+      }
+      
+      // Free memory using original pointer rather than adjusted pointer
+      void *original_p = segment_p->original_p;
       
-      (gc_metadata_p + i)->~PaddedGCMetadata();
+      segment_p->~ThreadLocalSegment();
+      free(original_p);
+      
+      segment_list[i].store(nullptr);
     }
     
-    // Free memory using original pointer rather than adjusted pointer
-    free(original_p);
+    segment_num.store(0UL);
     
     return;
   }
@@ -367,37 +859,64 @@ class BwTreeBase {
   /*
    * PrepareThreadLocal() - Initialize thread local variables
    *
-   * This function uses thread_num to initialize number of threads
+   * This function allocates segments for the first thread_num GC IDs. Slots
+   * of larger GC IDs are allocated when they are first used
    */
   void PrepareThreadLocal() {
     bwt_printf("Preparing %lu thread local slots\n", thread_num);
     
-    // This is the unaligned base address
-    // We allocate one more element than requested as the buffer
+    assert(thread_num <= MAX_GC_ID_NUM);
+    
+    for(size_t i = 0;i < thread_num;i += THREAD_LOCAL_SEGMENT_SIZE) {
+      AllocateThreadLocalSegment(i / THREAD_LOCAL_SEGMENT_SIZE);
+    }
+    
+    return; 
+  } 
+  
+  /*
+   * AllocateThreadLocalSegment() - Allocates a segment of thread local slots
+   *                                 if it has not been allocated
+   *
+   * Threads might race to allocate the same segment, in which case the one
+   * failing CAS frees its segment. Returns the segment installed
+   */
+  ThreadLocalSegment *AllocateThreadLocalSegment(size_t index) {
+    assert(index < THREAD_LOCAL_SEGMENT_NUM);
+    
+    // We allocate one more cache line than requested as the buffer
     // for doing alignment
-    original_p = static_cast<unsigned char *>(
-      malloc(CACHE_LINE_SIZE * (thread_num + 1)));
+    void *original_p = malloc(sizeof(ThreadLocalSegment) + CACHE_LINE_SIZE);
     assert(original_p != nullptr);
     
     // Align the address to cache line boundary
-    gc_metadata_p = reinterpret_cast<PaddedGCMetadata *>(
+    ThreadLocalSegment *segment_p = reinterpret_cast<ThreadLocalSegment *>(
       (reinterpret_cast<size_t>(original_p) + CACHE_LINE_SIZE - 1) & \
         CACHE_LINE_MASK);
     
-    // Make sure it is aligned
-    assert(((size_t)gc_metadata_p % CACHE_LINE_SIZE) == 0);
+    // At last call constructor of the class; we use placement new
+    new (segment_p) ThreadLocalSegment{};
+    segment_p->original_p = original_p;
     
-    // Make sure we do not overflow the chunk of memory
-    assert(((size_t)gc_metadata_p + thread_num * CACHE_LINE_SIZE) <= \
-             ((size_t)original_p + (thread_num + 1) * CACHE_LINE_SIZE));
+    ThreadLocalSegment *expected_p = nullptr;
+    if(segment_list[index].compare_exchange_strong(expected_p,
+                                                   segment_p) == false) {
+      segment_p->~ThreadLocalSegment();
+      free(original_p);
+      
+      return expected_p;
+    }
     
-    // At last call constructor of the class; we use placement new
-    for(size_t i = 0;i < thread_num;i++) {
-      new (gc_metadata_p + i) PaddedGCMetadata{};
+    // Raise the number of segments to be scanned
+    size_t current_num = segment_num.load();
+    while(current_num < index + 1) {
+      if(segment_num.compare_exchange_strong(current_num, index + 1) == true) {
+        break;
+      }
     }
     
-    return; 
-  } 
+    return segment_p;
+  }
   
   /*
    * SetThreadNum() - Sets number of threads manually
@@ -414,10 +933,18 @@ class BwTreeBase {
    * Constructor - Initialize GC data structure
    */
   BwTreeBase() :
-    gc_metadata_p{nullptr},
-    original_p{nullptr},
+    segment_num{0UL},
     thread_num{total_thread_num.load()},
-    epoch{0UL} {
+    epoch{0UL},
+    cached_gc_epoch{0UL},
+    cached_gc_epoch_version{static_cast<uint64_t>(-1)} {
+    for(size_t i = 0;i < THREAD_LOCAL_SEGMENT_NUM;i++) {
+      segment_list[i].store(nullptr);
+    }
+    
+    for(size_t i = 0;i < MAX_PINNED_EPOCH_NUM;i++) {
+      pinned_epoch_list[i].store(INACTIVE_EPOCH);
+    }
     
     // Allocate memory for thread local data structure
     PrepareThreadLocal();
@@ -448,37 +975,106 @@ class BwTreeBase {
   /*
    * AssignGCID() - Assigns a gc_id manually
    *
-   * This is mainly used for debugging
+   * This is mainly used for debugging. A GC ID assigned manually is never
+   * recycled, and should not be mixed with IDs from RegisterThread()
    */
   inline void AssignGCID(int p_gc_id) {
     gc_id = p_gc_id;
+    gc_generation = 0UL;
     
     return;
   }
   
+  /*
+   * GetGCID() - Returns the GC ID of the calling thread, or -1 if no ID
+   *             has been assigned
+   */
+  static inline int GetGCID() {
+    return gc_id;
+  }
+  
   /*
    * RegisterThread() - Registers a thread for GC for all instances of BwTree
    *                    in the current process's address space
    *
-   * This function assigns an ID to a thread starting from 0, which could be 
-   * used as thread ID for the garbage collection process. 
+   * This function assigns the smallest free GC ID to the calling thread, and
+   * stores it in a thread local variable called gc_id decleared inside this
+   * class. IDs are taken with CAS on the generation of the ID, so it does
+   * not block. Calling this function again on a registered thread has no
+   * effect
    *
-   * Also note that only threads registered before an instance is created will
-   * be considered as being eligible for GC for that thread
+   * The ID is released when the thread exits (or by ReleaseGCID()), and is
+   * then reused by the next thread being registered, together with its slot
+   * in every tree instance. Garbage nodes left in the slot by the exited
+   * thread are handed off to the new owner, and the slot does not prevent
+   * GC while the ID is free. Therefore the number of slots of a tree is
+   * bounded by the largest number of live threads, which makes this suitable
+   * for elastic thread pools
    *
-   * This function does not return any value, and instead it uses an atomic 
-   * counter to counter the number of threads currently in this system, and
-   * assigns the thread ID to a thread local variable called gc_id decleared
-   * inside this class
-   *
-   * Each thread being allocated a GC ID has a context for garbage collection
-   * that is aligned to cache lines. The context will be allocated for every
-   * thread being registered, even if it has already exited. Therefore, this
-   * approach is only suitable for thread pools where the number of threads
-   * is fixed at startup time.
+   * NOTE: Threads could be registered before or after a tree is created
    */
   static void RegisterThread() {
-    gc_id = total_thread_num.fetch_add(1);
+    if(gc_generation != 0UL) {
+      return;
+    }
+    
+    for(size_t i = 0;i < MAX_GC_ID_NUM;i++) {
+      uint64_t generation = gc_id_generation_list[i].load();
+      
+      // Odd generation means the ID is in use
+      if((generation & 0x1UL) == 1UL) {
+        continue;
+      }
+      
+      if(gc_id_generation_list[i].compare_exchange_strong(
+           generation, generation + 1) == false) {
+        continue;
+      }
+      
+      gc_id = static_cast<int>(i);
+      gc_generation = generation + 1;
+      
+      // Raise the high water mark which new trees use as thread_num
+      size_t current_num = total_thread_num.load();
+      while(current_num < i + 1) {
+        if(total_thread_num.compare_exchange_strong(current_num, 
+                                                    i + 1) == true) {
+          break;
+        }
+      }
+      
+      // This is constructed once per thread, and its destructor releases
+      // the ID on thread exit
+      static thread_local GCIDHandle handle{};
+      (void)handle;
+      
+      return;
+    }
+    
+    // All IDs are in use
+    assert(false);
+    
+    return;
+  }
+  
+  /*
+   * ReleaseGCID() - Returns the GC ID of a registered thread for reuse
+   *
+   * The thread must not be inside any epoch of any tree. This is called
+   * automatically when a registered thread exits
+   */
+  static void ReleaseGCID() {
+    if(gc_generation == 0UL) {
+      return;
+    }
+    
+    assert(gc_id_generation_list[gc_id].load() == gc_generation);
+    
+    // This makes all slots announced with the current generation inactive
+    gc_id_generation_list[gc_id].fetch_add(1);
+    
+    gc_id = -1;
+    gc_generation = 0UL;
     
     return;
   }
@@ -486,11 +1082,11 @@ class BwTreeBase {
   /*
    * IncreaseEpoch() - Go to the next epoch by increasing the counter
    *
-   * Note that this should not be called by worker threads since 
-   * it will cause contention
+   * Worker threads only call this before they collect their garbage, which
+   * is rare enough not to cause contention on the counter
    */
   inline void IncreaseEpoch() {
-    epoch++;
+    epoch.fetch_add(1);
     
     return;
   }
@@ -503,9 +1099,26 @@ class BwTreeBase {
    * unlinked before this epoch could be safely collected since at the time 
    * the thread local counter is updated, we know all references to shared
    * resources have been released
+   *
+   * If the slot was inactive, or announced by another owner of the GC ID,
+   * then other threads might ignore the slot until they see this store. So
+   * a full fence is issued before the thread reads any shared node. This is
+   * the only case that costs more than a plain store
    */
   inline void UpdateLastActiveEpoch() {
-    GetCurrentGCMetaData()->last_active_epoch = GetGlobalEpoch();
+    GCMetaData *metadata_p = GetCurrentGCMetaData();
+    
+    if(metadata_p->last_active_epoch == INACTIVE_EPOCH || \
+       metadata_p->owner_generation != gc_generation) {
+      metadata_p->owner_generation = gc_generation;
+      metadata_p->last_active_epoch = GetGlobalEpoch();
+      
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      
+      return;
+    }
+    
+    metadata_p->last_active_epoch = GetGlobalEpoch();
     
     return;
   }
@@ -516,65 +1129,358 @@ class BwTreeBase {
    *                      for GC
    */
   inline void UnregisterThread(int thread_id) {
-    GetGCMetaData(thread_id)->last_active_epoch = static_cast<uint64_t>(-1);
+    GetGCMetaData(thread_id)->last_active_epoch = INACTIVE_EPOCH;
   }
   
   /*
-   * GetGlobalEpoch() - Returns the current global epoch counter
+   * PinEpoch() - Announces the current global epoch in a free pinned slot
+   *              and returns the index of the slot
    *
-   * Note that this function might return a stale value, which does not affect
-   * correctness as long as unlinking the node form data structure is atomic
-   * since all refreshing operations will read the same or smaller value
-   * when it reads the counter
+   * Nodes unlinked on and after the pinned epoch are not freed before
+   * UnpinEpoch() is called on the slot, no matter which thread announces
+   * it. This costs a CAS, so it is only used by long lived readers
    */
-  inline uint64_t GetGlobalEpoch() {
-    return epoch; 
+  size_t PinEpoch() {
+    for(size_t i = 0;i < MAX_PINNED_EPOCH_NUM;i++) {
+      uint64_t expected = INACTIVE_EPOCH;
+      
+      // The CAS is a full fence, so the epoch is announced before the
+      // caller reads any shared node
+      if(pinned_epoch_list[i].load() == INACTIVE_EPOCH && \
+         pinned_epoch_list[i].compare_exchange_strong(expected,
+                                                      GetGlobalEpoch())) {
+        return i;
+      }
+    }
+    
+    // All slots are in use
+    assert(false);
+    
+    return MAX_PINNED_EPOCH_NUM;
   }
   
   /*
-   * GetGCMetaData() - Returns the thread-local metadata for GC for a specified
-   *                   thread
+   * UnpinEpoch() - Frees a slot returned by PinEpoch()
+   *
+   * The epoch is then increased, since GetCachedGCEpoch() would otherwise
+   * keep returning the pinned epoch until another thread increases it. A
+   * tree dropped by BwTree::Truncate() waits for this without any other
+   * thread working on the tree
+   *
+   * The invalid slot returned if all slots are in use is ignored
    */
-  inline GCMetaData *GetGCMetaData(int thread_id) {
-    // The thread ID must be within the range
-    assert(thread_id >= 0 && thread_id < static_cast<int>(thread_num));
+  inline void UnpinEpoch(size_t index) {
+    if(index >= MAX_PINNED_EPOCH_NUM) {
+      return;
+    }
     
-    return &(gc_metadata_p + thread_id)->data;
+    assert(pinned_epoch_list[index].load() != INACTIVE_EPOCH);
+    
+    pinned_epoch_list[index].store(INACTIVE_EPOCH);
+    IncreaseEpoch();
+    
+    return;
   }
   
   /*
-   * GetCurrentGCMetaData() - Returns the metadata for the current thread
+   * GetMinPinnedEpoch() - Returns the minimum pinned epoch, or
+   *                       INACTIVE_EPOCH if no epoch is pinned
    */
-  inline GCMetaData *GetCurrentGCMetaData() {
-    return GetGCMetaData(gc_id); 
-  }
-  
+  uint64_t GetMinPinnedEpoch() const {
+    uint64_t min_epoch = INACTIVE_EPOCH;
+    
+    for(size_t i = 0;i < MAX_PINNED_EPOCH_NUM;i++) {
+      uint64_t ts = pinned_epoch_list[i].load();
+      min_epoch = std::min(ts, min_epoch);
+    }
+    
+    return min_epoch;
+  }
+  
+  /*
+   * GetGlobalEpoch() - Returns the current global epoch counter
+   *
+   * Note that this function might return a stale value, which does not affect
+   * correctness as long as unlinking the node form data structure is atomic
+   * since all refreshing operations will read the same or smaller value
+   * when it reads the counter
+   */
+  inline uint64_t GetGlobalEpoch() {
+    return epoch.load(); 
+  }
+  
+  /*
+   * GetThreadLocalSegment() - Returns the segment holding the slot of a
+   *                           GC ID, allocating it if necessary
+   */
+  inline ThreadLocalSegment *GetThreadLocalSegment(int thread_id) {
+    // The thread ID must be within the range
+    assert(thread_id >= 0 && thread_id < static_cast<int>(MAX_GC_ID_NUM));
+    
+    size_t index = static_cast<size_t>(thread_id) / THREAD_LOCAL_SEGMENT_SIZE;
+    ThreadLocalSegment *segment_p = segment_list[index].load();
+    
+    if(segment_p == nullptr) {
+      segment_p = AllocateThreadLocalSegment(index);
+    }
+    
+    return segment_p;
+  }
+  
+  /*
+   * GetGCMetaData() - Returns the thread-local metadata for GC for a specified
+   *                   thread
+   */
+  inline GCMetaData *GetGCMetaData(int thread_id) {
+    return &GetThreadLocalSegment(thread_id)->gc_metadata_list[
+      static_cast<size_t>(thread_id) % THREAD_LOCAL_SEGMENT_SIZE].data;
+  }
+  
+  /*
+   * GetCurrentGCMetaData() - Returns the metadata for the current thread
+   */
+  inline GCMetaData *GetCurrentGCMetaData() {
+    return GetGCMetaData(gc_id); 
+  }
+  
+  /*
+   * GetCurrentThreadStatistics() - Returns the statistics slot of the
+   *                                current thread
+   */
+  inline ThreadStatistics *GetCurrentThreadStatistics() {
+    return &GetThreadLocalSegment(gc_id)->statistics_list[
+      static_cast<size_t>(gc_id) % THREAD_LOCAL_SEGMENT_SIZE].data;
+  }
+  
+  /*
+   * GetCurrentLeafFinger() - Returns the leaf finger slot of the current
+   *                          thread
+   */
+  inline LeafFinger *GetCurrentLeafFinger() {
+    return &GetThreadLocalSegment(gc_id)->leaf_finger_list[
+      static_cast<size_t>(gc_id) % THREAD_LOCAL_SEGMENT_SIZE].data;
+  }
+  
+  /*
+   * GetCurrentNodeIDCache() - Returns the NodeID cache slot of the current
+   *                           thread
+   */
+  inline NodeIDCache *GetCurrentNodeIDCache() {
+    return &GetThreadLocalSegment(gc_id)->node_id_cache_list[
+      static_cast<size_t>(gc_id) % THREAD_LOCAL_SEGMENT_SIZE].data;
+  }
+  
+  /*
+   * AddStatistics() - Adds a value to a counter of the current thread
+   *
+   * The counter is given as a pointer to member of class ThreadStatistics
+   */
+  inline void AddStatistics(std::atomic<uint64_t> ThreadStatistics::*counter_p,
+                            uint64_t value = 1UL) {
+    std::atomic<uint64_t> &counter = GetCurrentThreadStatistics()->*counter_p;
+    
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+    
+    return;
+  }
+  
+  /*
+   * GetActiveEpoch() - Returns the last active epoch of a slot, or
+   *                    INACTIVE_EPOCH if the slot should be ignored
+   *
+   * A slot is ignored if it is unregistered, or if the registered thread
+   * announcing in it has released its GC ID
+   */
+  static inline uint64_t GetActiveEpoch(size_t thread_id,
+                                        const GCMetaData *metadata_p) {
+    // Note: We need to first copy the shared value into a local variable
+    // before using it, since the owner thread might modify it concurrently
+    uint64_t ts = metadata_p->last_active_epoch;
+    uint64_t generation = metadata_p->owner_generation;
+    
+    if(generation != 0UL && \
+       generation != gc_id_generation_list[thread_id].load()) {
+      return INACTIVE_EPOCH;
+    }
+    
+    return ts;
+  }
+  
+  /*
+   * GetStatistics() - Returns a snapshot of statistics of all threads
+   *
+   * This function does not block or slow down worker threads, and could be
+   * called at any time by any thread, including unregistered ones. Take
+   * the difference of two snapshots to obtain statistics of an interval
+   *
+   * NOTE: Statistics are reset when the thread local array is reallocated
+   * by BwTree::UpdateThreadLocal()
+   */
+  Statistics GetStatistics() {
+    Statistics stat{};
+    
+    uint64_t current_epoch = GetGlobalEpoch();
+    uint64_t min_epoch = current_epoch;
+    
+    for(size_t i = 0;i < segment_num.load();i++) {
+      const ThreadLocalSegment *segment_p = segment_list[i].load();
+      if(segment_p == nullptr) {
+        continue;
+      }
+      
+      for(size_t j = 0;j < THREAD_LOCAL_SEGMENT_SIZE;j++) {
+        const ThreadStatistics &data = segment_p->statistics_list[j].data;
+        
+        stat.insert_op_count += data.insert_op_count.load();
+        stat.delete_op_count += data.delete_op_count.load();
+        stat.update_op_count += data.update_op_count.load();
+        stat.read_op_count += data.read_op_count.load();
+        
+        stat.insert_abort_count += data.insert_abort_count.load();
+        stat.delete_abort_count += data.delete_abort_count.load();
+        stat.update_abort_count += data.update_abort_count.load();
+        
+        stat.traversal_count += data.traversal_count.load();
+        stat.traversal_abort_count += data.traversal_abort_count.load();
+        
+        stat.node_visit_count += data.node_visit_count.load();
+        stat.delta_chain_length_sum += data.delta_chain_length_sum.load();
+        
+        stat.consolidation_count += data.consolidation_count.load();
+        stat.split_count += data.split_count.load();
+        stat.merge_count += data.merge_count.load();
+        stat.smo_help_count += data.smo_help_count.load();
+        
+        stat.early_consolidation_count += \
+          data.early_consolidation_count.load();
+        stat.deferred_consolidation_count += \
+          data.deferred_consolidation_count.load();
+        
+        stat.read_cache_hit_count += data.read_cache_hit_count.load();
+        stat.read_cache_miss_count += data.read_cache_miss_count.load();
+        
+        stat.leaf_finger_hit_count += data.leaf_finger_hit_count.load();
+        stat.leaf_finger_miss_count += data.leaf_finger_miss_count.load();
+        
+        stat.leaf_retry_count += data.leaf_retry_count.load();
+        
+        stat.item_insert_count += data.item_insert_count.load();
+        stat.item_delete_count += data.item_delete_count.load();
+        
+        stat.gc_count += data.gc_count.load();
+        stat.gc_time += data.gc_time.load();
+        
+        // Garbage of a slot whose owner has exited is still counted,
+        // since it is handed off to the next owner
+        const GCMetaData *metadata_p = &segment_p->gc_metadata_list[j].data;
+        uint64_t ts = \
+          GetActiveEpoch(i * THREAD_LOCAL_SEGMENT_SIZE + j, metadata_p);
+        
+        stat.gc_backlog += metadata_p->node_count;
+        min_epoch = std::min(ts, min_epoch);
+      }
+    }
+    
+    min_epoch = std::min(GetMinPinnedEpoch(), min_epoch);
+    
+    stat.epoch_lag = current_epoch - min_epoch;
+    
+    return stat;
+  }
+  
   /*
    * SummarizeGCEpoch() - Returns the minimum epochs among the current epoch
-   *                      counters of all threads
+   *                      counters of all threads and pinned epochs
    *
-   * Note that if this is called then it must be true that there are at least
-   * one thread participating into the GC process
+   * Only segments that have been allocated are scanned. If no thread is
+   * active and no epoch is pinned then INACTIVE_EPOCH is returned
    */
   uint64_t SummarizeGCEpoch() {
-    assert(thread_num >= 1);
+    uint64_t min_epoch = GetMinPinnedEpoch();
     
-    // Use the first metadata's epoch as min and update it on the fly
-    uint64_t min_epoch = GetGCMetaData(0)->last_active_epoch;
+    for(size_t i = 0;i < segment_num.load();i++) {
+      const ThreadLocalSegment *segment_p = segment_list[i].load();
+      if(segment_p == nullptr) {
+        continue;
+      }
+      
+      for(size_t j = 0;j < THREAD_LOCAL_SEGMENT_SIZE;j++) {
+        // Note: std::min pass a const & of into the function. We need to first copy the shared GetGCMetaData(i)->last_active_epoch
+        // into a local variable before calling std::min. Otherwise we will have a Heisenbug where std::min first check which one is smaller,
+        // and before it returns, other thread modify the variable and we actually return the larger one.
+        uint64_t ts = \
+          GetActiveEpoch(i * THREAD_LOCAL_SEGMENT_SIZE + j,
+                         &segment_p->gc_metadata_list[j].data);
+        min_epoch = std::min(ts, min_epoch);
+      }
+    }
     
-    // This might not be executed if there is only one thread
-    for(int i = 1;i < static_cast<int>(thread_num);i++) {
-      // Note: std::min pass a const & of into the function. We need to first copy the shared GetGCMetaData(i)->last_active_epoch
-      // into a local variable before calling std::min. Otherwise we will have a Heisenbug where std::min first check which one is smaller,
-      // and before it returns, other thread modify the variable and we actually return the larger one.
-      auto ts = GetGCMetaData(i)->last_active_epoch;
-      min_epoch = std::min(ts, min_epoch);
+    return min_epoch;
+  }
+  
+  /*
+   * GetCachedGCEpoch() - Returns a lower bound of the minimum epoch of all
+   *                      threads, recomputing it only if the global epoch
+   *                      has changed since the last computation
+   *
+   * The returned value is never larger than the global epoch when it was
+   * computed. A thread that registers (or becomes active again) after the
+   * computation always sees a global epoch no less than that, so garbage
+   * older than the returned value could never be observed by such a thread
+   *
+   * NOTE: Concurrent updates of the cache might leave a smaller (i.e. older)
+   * value, which only delays GC and is therefore safe
+   */
+  uint64_t GetCachedGCEpoch() {
+    uint64_t current_epoch = GetGlobalEpoch();
+    
+    // Load the value after the version; writers store the value first
+    if(cached_gc_epoch_version.load() == current_epoch) {
+      return cached_gc_epoch.load();
     }
     
+    uint64_t min_epoch = std::min(SummarizeGCEpoch(), current_epoch);
+    
+    cached_gc_epoch.store(min_epoch);
+    cached_gc_epoch_version.store(current_epoch);
+    
     return min_epoch;
   }
 };
 
+/*
+ * class DefaultTuningPolicy - Node size and delta chain length thresholds
+ *
+ * A tuning policy is passed to BwTree as the last template argument to
+ * choose node fanout and consolidation aggressiveness per tree type at
+ * compile time. Any class that defines the same six integer constants could
+ * be used as a policy
+ *
+ * The delta chain length thresholds are compile time constants. Split and
+ * merge thresholds are only the initial values for each tree instance, which
+ * could be overridden at runtime using BwTree::SetNodeSizeThreshold()
+ */
+class DefaultTuningPolicy {
+ public:
+  // If the length of delta chain exceeds ( >= ) this then we consolidate
+  static constexpr int INNER_DELTA_CHAIN_THRESHOLD = \
+    INNER_DELTA_CHAIN_LENGTH_THRESHOLD;
+  static constexpr int LEAF_DELTA_CHAIN_THRESHOLD = \
+    LEAF_DELTA_CHAIN_LENGTH_THRESHOLD;
+
+  // If node size goes above ( >= ) upper threshold then we split it; if it
+  // goes below ( <= ) lower threshold then we merge it
+  static constexpr int INNER_NODE_UPPER_THRESHOLD = \
+    INNER_NODE_SIZE_UPPER_THRESHOLD;
+  static constexpr int INNER_NODE_LOWER_THRESHOLD = \
+    INNER_NODE_SIZE_LOWER_THRESHOLD;
+  static constexpr int LEAF_NODE_UPPER_THRESHOLD = \
+    LEAF_NODE_SIZE_UPPER_THRESHOLD;
+  static constexpr int LEAF_NODE_LOWER_THRESHOLD = \
+    LEAF_NODE_SIZE_LOWER_THRESHOLD;
+};
+
 /*
  * class BwTree - Lock-free BwTree index implementation
  *
@@ -586,7 +1492,10 @@ class BwTreeBase {
  *           typename KeyEqualityChecker = std::equal_to<KeyType>,
  *           typename KeyHashFunc = std::hash<KeyType>,
  *           typename ValueEqualityChecker = std::equal_to<ValueType>,
- *           typename ValueHashFunc = std::hash<ValueType>>
+ *           typename ValueHashFunc = std::hash<ValueType>,
+ *           typename TuningPolicy = DefaultTuningPolicy,
+ *           typename NodeAllocator = DefaultNodeAllocator,
+ *           bool UniqueKey = false>
  *
  * Explanation:
  *
@@ -614,6 +1523,19 @@ class BwTreeBase {
  *  - ValueHashFunc: Hashes ValueType into a size_t
  *                   This is used in unordered_set
  *
+ *  - TuningPolicy: Node size and delta chain length thresholds. See
+ *                  class DefaultTuningPolicy
+ *
+ *  - NodeAllocator: Allocates memory for base nodes, delta record chunks,
+ *                   iterator pages and garbage nodes. See class
+ *                   DefaultNodeAllocator and class ThreadLocalPoolAllocator
+ *                   (or HugePagePoolAllocator for slabs on huge pages)
+ *
+ *  - UniqueKey: If true then a key is mapped to at most one value. Insert()
+ *               fails if the key already exists, and leaf lookups stop at
+ *               the first delta record on the key instead of replaying the
+ *               delta chain with value sets
+ *
  * If not specified, then by default all arguments except the first two will
  * be set as the standard operator in C++ (i.e. the operator for primitive types
  * AND/OR overloaded operators for derived types)
@@ -624,7 +1546,10 @@ template <typename KeyType,
           typename KeyEqualityChecker = std::equal_to<KeyType>,
           typename KeyHashFunc = std::hash<KeyType>,
           typename ValueEqualityChecker = std::equal_to<ValueType>,
-          typename ValueHashFunc = std::hash<ValueType>>
+          typename ValueHashFunc = std::hash<ValueType>,
+          typename TuningPolicy = DefaultTuningPolicy,
+          typename NodeAllocator = DefaultNodeAllocator,
+          bool UniqueKey = false>
 class BwTree : public BwTreeBase {
  /*
   * Private & Public declaration
@@ -705,6 +1630,12 @@ class BwTree : public BwTreeBase {
     LeafDeleteType = 10,
     LeafRemoveType = 11,
     LeafMergeType = 12,
+    LeafUpdateType = 13,
+    LeafBatchInsertType = 14,
+    LeafDeleteRangeType = 15,
+
+    // Read-only leaf base node (see class CompressedLeafNode)
+    LeafCompressedType = 16,
   };
 
   ///////////////////////////////////////////////////////////////////
@@ -983,6 +1914,44 @@ class BwTree : public BwTreeBase {
     return value_eq_obj(v1, v2);
   }
 
+  /*
+   * class TreeRoot - The tree a snapshot is taken on
+   *
+   * Truncate() replaces the whole tree, so a snapshot remembers the tree
+   * generation together with the root and the first leaf of that tree.
+   * A default constructed object refers to the current tree
+   */
+  class TreeRoot {
+   public:
+    uint64_t generation;
+    NodeID root_node_id;
+    NodeID first_leaf_node_id;
+
+    /*
+     * Default Constructor - Refers to whichever tree is current
+     */
+    TreeRoot() :
+      generation{0UL},
+      root_node_id{INVALID_NODE_ID},
+      first_leaf_node_id{INVALID_NODE_ID}
+    {}
+
+    TreeRoot(uint64_t p_generation,
+             NodeID p_root_node_id,
+             NodeID p_first_leaf_node_id) :
+      generation{p_generation},
+      root_node_id{p_root_node_id},
+      first_leaf_node_id{p_first_leaf_node_id}
+    {}
+
+    /*
+     * IsCurrent() - Returns true if this does not refer to a particular tree
+     */
+    inline bool IsCurrent() const {
+      return root_node_id == INVALID_NODE_ID;
+    }
+  };
+
   /*
    * class Context - Stores per thread context data that is used during
    *                 tree traversal
@@ -1020,10 +1989,35 @@ class BwTree : public BwTreeBase {
     // and other functions just return on seeing this flag
     bool abort_flag;
 
+    // Set by Compact(), which consolidates every delta chain on the path
+    // and merges nodes below the compaction threshold
+    bool compact_flag;
+
+    // Bytes of nodes unlinked minus bytes of nodes allocated by the
+    // traversal. Only counted if compact_flag is set
+    int64_t compact_freed_size;
+
+    // Set by traversals that do not modify the leaf they stop at, i.e.
+    // read-optimized traversals, iterators and scans. These keep compressed
+    // leaves as they are instead of expanding them (see GetExpandedNode())
+    bool read_only_flag;
+
+    // Hash of the search key, which is only computed on the first call of
+    // GetSearchKeyHash() since many traversals never need it
+    size_t search_key_hash;
+    bool search_key_hash_flag;
+
+    // The tree to traverse. If it has been dropped by Truncate() then
+    // dropped_tree_flag is set by GetRootNodeID(), and the root of the
+    // dropped tree is never replaced
+    const TreeRoot tree_root;
+    bool dropped_tree_flag;
+
     /*
      * Constructor - Initialize a context object into initial state
      */
-    inline Context(const KeyType &p_search_key) :
+    inline Context(const KeyType &p_search_key,
+                   const TreeRoot &p_tree_root = TreeRoot{}) :
       #ifdef BWTREE_PELOTON
 
       // Because earlier versions of g++ does not support
@@ -1043,7 +2037,14 @@ class BwTree : public BwTreeBase {
       
       #endif
       
-      abort_flag{false}
+      abort_flag{false},
+      compact_flag{false},
+      compact_freed_size{0},
+      read_only_flag{false},
+      search_key_hash{0UL},
+      search_key_hash_flag{false},
+      tree_root{p_tree_root},
+      dropped_tree_flag{false}
     {}
 
     /*
@@ -1090,6 +2091,34 @@ class BwTree : public BwTreeBase {
     }
   };
 
+  /*
+   * GetKeyHash() - Returns the hash of a key stored in leaf data nodes and
+   *                probed in leaf fingerprints
+   *
+   * The hash is multiplied with a large odd number and the upper half is
+   * folded into the lower half, since std::hash of integers is the identity
+   * function
+   */
+  inline size_t GetKeyHash(const KeyType &key) const {
+    uint64_t hash = \
+      static_cast<uint64_t>(key_hash_obj(key)) * 0x9E3779B97F4A7C15UL;
+
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
+
+  /*
+   * GetSearchKeyHash() - Returns the hash of the search key of a context,
+   *                      computing it on the first call
+   */
+  inline size_t GetSearchKeyHash(Context *context_p) const {
+    if(context_p->search_key_hash_flag == false) {
+      context_p->search_key_hash = GetKeyHash(context_p->search_key);
+      context_p->search_key_hash_flag = true;
+    }
+
+    return context_p->search_key_hash;
+  }
+
   /*
    * class NodeMetaData - Holds node metadata in an object
    *
@@ -1204,7 +2233,8 @@ class BwTree : public BwTreeBase {
      */
     inline bool IsDeltaNode() const {
       if(GetType() == NodeType::InnerType || \
-         GetType() == NodeType::LeafType) {
+         GetType() == NodeType::LeafType || \
+         GetType() == NodeType::LeafCompressedType) {
         return false;
       } else {
         return true;
@@ -1380,15 +2410,25 @@ class BwTree : public BwTreeBase {
 
     // This is the item being deleted or inserted
     KeyValuePair item;
+
+    // Hash of the key of the item (see GetKeyHash()), such that searches
+    // could skip the record without comparing keys
+    size_t key_hash;
     
     // This is the index of the node when inserting/deleting
     // the item into the base leaf node
     std::pair<int, bool> index_pair;
 
+    // The version of the tree when the record is created, such that
+    // snapshots taken before that skip it (see BwTree::Snapshot())
+    uint64_t version;
+
     LeafDataNode(const KeyValuePair &p_item,
+                 size_t p_key_hash,
                  NodeType p_type,
                  const BaseNode *p_child_node_p,
                  std::pair<int, bool> p_index_pair,
+                 uint64_t p_version,
                  const KeyNodeIDPair *p_low_key_p,
                  const KeyNodeIDPair *p_high_key_p,
                  int p_depth,
@@ -1400,7 +2440,9 @@ class BwTree : public BwTreeBase {
                 p_depth,
                 p_item_count},
       item{p_item},
-      index_pair{p_index_pair}
+      key_hash{p_key_hash},
+      index_pair{p_index_pair},
+      version{p_version}
     {}
     
     /*
@@ -1424,13 +2466,17 @@ class BwTree : public BwTreeBase {
      * Constructor
      */
     LeafInsertNode(const KeyType &p_insert_key,
+                   size_t p_key_hash,
                    const ValueType &p_value,
                    const BaseNode *p_child_node_p,
-                   std::pair<int, bool> p_index_pair) :
+                   std::pair<int, bool> p_index_pair,
+                   uint64_t p_version) :
       LeafDataNode{std::make_pair(p_insert_key, p_value),
+                   p_key_hash,
                    NodeType::LeafInsertType,
                    p_child_node_p,
                    p_index_pair,
+                   p_version,
                    &p_child_node_p->GetLowKeyPair(),
                    &p_child_node_p->GetHighKeyPair(),
                    p_child_node_p->GetDepth() + 1,
@@ -1454,13 +2500,17 @@ class BwTree : public BwTreeBase {
      * Constructor
      */
     LeafDeleteNode(const KeyType &p_delete_key,
+                   size_t p_key_hash,
                    const ValueType &p_value,
                    const BaseNode *p_child_node_p,
-                   std::pair<int, bool> p_index_pair) :
+                   std::pair<int, bool> p_index_pair,
+                   uint64_t p_version) :
       LeafDataNode{std::make_pair(p_delete_key, p_value),
+                   p_key_hash,
                    NodeType::LeafDeleteType,
                    p_child_node_p,
                    p_index_pair,
+                   p_version,
                    &p_child_node_p->GetLowKeyPair(),
                    &p_child_node_p->GetHighKeyPair(),
                    p_child_node_p->GetDepth() + 1,
@@ -1470,6 +2520,168 @@ class BwTree : public BwTreeBase {
      {}
   };
 
+  /*
+   * class LeafUpdateNode - Replaces a value of a key with another value
+   *
+   * This is equivalent to a LeafDeleteNode on the old value and a
+   * LeafInsertNode on the new value being posted atomically. The inherited
+   * item and index pair describe the inserted value, and the deleted value
+   * is described by an embedded delete node, such that consolidation could
+   * merge both halves as ordinary data nodes
+   *
+   * NOTE: The embedded delete node is never linked into any delta chain
+   * and is destroyed together with this node
+   */
+  class LeafUpdateNode : public LeafDataNode {
+   public:
+    const LeafDeleteNode delete_node;
+
+    /*
+     * Constructor
+     */
+    LeafUpdateNode(const KeyType &p_update_key,
+                   size_t p_key_hash,
+                   const ValueType &p_old_value,
+                   const ValueType &p_new_value,
+                   const BaseNode *p_child_node_p,
+                   std::pair<int, bool> p_old_index_pair,
+                   std::pair<int, bool> p_new_index_pair,
+                   uint64_t p_version) :
+      LeafDataNode{std::make_pair(p_update_key, p_new_value),
+                   p_key_hash,
+                   NodeType::LeafUpdateType,
+                   p_child_node_p,
+                   p_new_index_pair,
+                   p_version,
+                   &p_child_node_p->GetLowKeyPair(),
+                   &p_child_node_p->GetHighKeyPair(),
+                   p_child_node_p->GetDepth() + 1,
+                   // One item is deleted and one is inserted
+                   p_child_node_p->GetItemCount()},
+      delete_node{p_update_key,
+                  p_key_hash,
+                  p_old_value,
+                  p_child_node_p,
+                  p_old_index_pair,
+                  p_version}
+    {}
+  };
+
+  /*
+   * class LeafBatchInsertNode - Inserts a sorted array of items into a leaf
+   *                             node
+   *
+   * Items are stored as LeafInsertNode objects right after this node in the
+   * same allocation and are sorted by key. Consolidation merges them as
+   * ordinary data nodes in the same way as the embedded delete node of
+   * LeafUpdateNode, and navigation finds the key with binary search. The
+   * whole array only counts as one node in the depth of the delta chain
+   *
+   * NOTE: Embedded insert nodes are never linked into any delta chain, and
+   * their child is the child of this node. They are destroyed together with
+   * this node
+   */
+  class LeafBatchInsertNode : public DeltaNode {
+   public:
+    const int insert_num;
+
+    // The version of all embedded insert nodes
+    const uint64_t version;
+
+    /*
+     * Constructor - Embedded insert nodes are constructed by the caller
+     */
+    LeafBatchInsertNode(const BaseNode *p_child_node_p,
+                        int p_insert_num,
+                        uint64_t p_version) :
+      DeltaNode{NodeType::LeafBatchInsertType,
+                p_child_node_p,
+                &p_child_node_p->GetLowKeyPair(),
+                &p_child_node_p->GetHighKeyPair(),
+                p_child_node_p->GetDepth() + 1,
+                p_child_node_p->GetItemCount() + p_insert_num},
+      insert_num{p_insert_num},
+      version{p_version}
+    {}
+
+    /*
+     * Destructor - Destroys all embedded insert nodes
+     */
+    ~LeafBatchInsertNode() {
+      for(int i = 0;i < insert_num;i++) {
+        Begin()[i].~LeafInsertNode();
+      }
+    }
+
+    /*
+     * Begin() - Returns a pointer to the first embedded insert node
+     */
+    inline LeafInsertNode *Begin() {
+      return reinterpret_cast<LeafInsertNode *>(this + 1);
+    }
+
+    inline const LeafInsertNode *Begin() const {
+      return reinterpret_cast<const LeafInsertNode *>(this + 1);
+    }
+
+    inline const LeafInsertNode *End() const {
+      return Begin() + insert_num;
+    }
+
+    /*
+     * GetAllocationSize() - Returns the size of a batch node together with
+     *                       its embedded insert nodes
+     */
+    static constexpr size_t GetAllocationSize(int p_insert_num) {
+      return sizeof(LeafBatchInsertNode) + \
+             sizeof(LeafInsertNode) * static_cast<size_t>(p_insert_num);
+    }
+  };
+
+  static_assert(sizeof(LeafBatchInsertNode) % alignof(LeafInsertNode) == 0,
+                "Embedded insert nodes of LeafBatchInsertNode are misaligned");
+
+  /*
+   * class LeafDeleteRangeNode - Deletes all items of a leaf whose keys are
+   *                             in [delete_low_key, delete_high_key)
+   *
+   * This is a range tombstone posted by DeleteRange(). Items below it on
+   * the delta chain (including the base node) whose keys are in the range
+   * are invisible, while items above it are not affected. The range is
+   * always clipped to the range of the leaf when the node is posted, such
+   * that it never covers keys of a right branch merged later
+   *
+   * NOTE: The caller must count the items being deleted, since item count
+   * is not derivable from the range
+   */
+  class LeafDeleteRangeNode : public DeltaNode {
+   public:
+    const KeyType delete_low_key;
+    const KeyType delete_high_key;
+
+    // See LeafDataNode::version
+    const uint64_t version;
+
+    /*
+     * Constructor
+     */
+    LeafDeleteRangeNode(const KeyType &p_delete_low_key,
+                        const KeyType &p_delete_high_key,
+                        const BaseNode *p_child_node_p,
+                        int p_delete_num,
+                        uint64_t p_version) :
+      DeltaNode{NodeType::LeafDeleteRangeType,
+                p_child_node_p,
+                &p_child_node_p->GetLowKeyPair(),
+                &p_child_node_p->GetHighKeyPair(),
+                p_child_node_p->GetDepth() + 1,
+                p_child_node_p->GetItemCount() - p_delete_num},
+      delete_low_key{p_delete_low_key},
+      delete_high_key{p_delete_high_key},
+      version{p_version}
+    {}
+  };
+
   /*
    * class LeafSplitNode - Split node for leaf
    *
@@ -1958,9 +3170,10 @@ class BwTree : public BwTreeBase {
      * even under contention
      *
      * Whether or not this has succeded, always return the pointer to the next
-     * chunk such that the caller could retry on next chunk
+     * chunk such that the caller could retry on next chunk. If this thread
+     * installs the chunk then its size is added to *memory_size_p
      */
-    AllocationMeta *GrowChunk() {
+    AllocationMeta *GrowChunk(std::atomic<int64_t> *memory_size_p) {
       // If we know there is a next chunk just return it to avoid
       // having too many failed CAS instruction
       AllocationMeta *meta_p = next.load();
@@ -1968,7 +3181,8 @@ class BwTree : public BwTreeBase {
         return meta_p;
       }
       
-      char *new_chunk = new char[CHUNK_SIZE];
+      char *new_chunk = \
+        reinterpret_cast<char *>(NodeAllocator::Allocate(CHUNK_SIZE));
       AllocationMeta *expected = nullptr;
       
       // Prepare the new chunk's metadata field
@@ -1986,13 +3200,16 @@ class BwTree : public BwTreeBase {
       // a chunk that has already been installed here
       bool ret = next.compare_exchange_strong(expected, new_meta_base);
       if(ret == true) {
+        memory_size_p->fetch_add(static_cast<int64_t>(CHUNK_SIZE),
+                                 std::memory_order_relaxed);
+
         return new_meta_base; 
       }
       
-      // Note that here we call destructor manually and then delete the char[]
+      // Note that here we call destructor manually and then free the memory
       // to complete the entire sequence which should be done by the compiler
       new_meta_base->~AllocationMeta();
-      delete[] new_chunk;
+      NodeAllocator::Free(new_chunk);
       
       // If CAS fails this will be loaded with the real value such that we have
       // free access to the next chunk
@@ -2009,7 +3226,7 @@ class BwTree : public BwTreeBase {
      * Note that this must be called at the header node of the chain, since it
      * takes "this" pointer and iterate using the "next" field
      */
-    void *Allocate(size_t size) {
+    void *Allocate(size_t size, std::atomic<int64_t> *memory_size_p) {
       AllocationMeta *meta_p = this;
       while(1) {
         // Allocate from the current chunk first
@@ -2021,7 +3238,7 @@ class BwTree : public BwTreeBase {
           // This will surely traverse the entire linked list
           // but since the linked list itself is supposed to be relatively short
           // even under contention, we do not worry about it right now
-          meta_p = meta_p->GrowChunk();
+          meta_p = meta_p->GrowChunk(memory_size_p);
           assert(meta_p != nullptr); 
         } else {
           return p; 
@@ -2031,7 +3248,25 @@ class BwTree : public BwTreeBase {
       assert(false);
       return nullptr;
     }
-    
+
+    /*
+     * GetNextChunkNum() - Returns the number of chunks grown after this one
+     *
+     * All of them have size CHUNK_SIZE. The list could grow concurrently,
+     * in which case the result is a lower bound
+     */
+    size_t GetNextChunkNum() const {
+      size_t chunk_num = 0UL;
+
+      for(const AllocationMeta *meta_p = next.load();
+          meta_p != nullptr;
+          meta_p = meta_p->next.load()) {
+        chunk_num++;
+      }
+
+      return chunk_num;
+    }
+
     /*
      * Destroy() - Frees all chunks in the linked list
      *
@@ -2050,11 +3285,11 @@ class BwTree : public BwTreeBase {
         AllocationMeta *next_p = meta_p->next.load();
         
         // 1. Manually call destructor
-        // 2. Delete it as a char[]
+        // 2. Free it through the node allocator
         // Note that we know the base of meta_p is always the address
-        // returned by operator new[]
+        // returned by NodeAllocator::Allocate()
         meta_p->~AllocationMeta();
-        delete[] reinterpret_cast<char *>(meta_p);
+        NodeAllocator::Free(meta_p);
         
         meta_p = next_p;
       }
@@ -2062,6 +3297,25 @@ class BwTree : public BwTreeBase {
       return;
     }
   };
+
+  // The largest number of items in a LeafBatchInsertNode, which is bounded
+  // such that the node always fits into an empty chunk
+  static constexpr int LEAF_BATCH_INSERT_NODE_CAPACITY = \
+    (LeafBatchInsertNode::GetAllocationSize(8) <= \
+       AllocationMeta::CHUNK_SIZE - sizeof(AllocationMeta)) ? \
+    8 : \
+    static_cast<int>((AllocationMeta::CHUNK_SIZE - sizeof(AllocationMeta) - \
+                      sizeof(LeafBatchInsertNode)) / sizeof(LeafInsertNode));
+
+  static_assert(LEAF_BATCH_INSERT_NODE_CAPACITY >= 2,
+                "LeafBatchInsertNode does not fit into a chunk");
+
+  // The largest number of data records carried by one node on a leaf delta
+  // chain. LeafUpdateNode carries two and LeafBatchInsertNode carries up to
+  // its capacity. Arrays for data records of a delta chain are sized using
+  // this times the depth of the chain
+  static constexpr int LEAF_DELTA_RECORD_NUM_MAX = \
+    (LEAF_BATCH_INSERT_NODE_CAPACITY > 2) ? LEAF_BATCH_INSERT_NODE_CAPACITY : 2;
   
   /*
    * class ElasticNode - The base class for elastic node types, i.e. InnerNode
@@ -2073,6 +3327,14 @@ class BwTree : public BwTreeBase {
    */
   template <typename ElementType>
   class ElasticNode : public BaseNode {
+   public:
+    // Whether elements could be copied with std::memcpy. std::pair is never
+    // trivially copyable because of its assignment operators, so both
+    // members are checked instead
+    static constexpr bool TRIVIAL_ELEMENT = \
+      std::is_trivially_copyable<typename ElementType::first_type>::value && \
+      std::is_trivially_copyable<typename ElementType::second_type>::value;
+
    private:
     // These two are the low key and high key of the node respectively
     // since we could not add it in the inherited class (will clash with
@@ -2084,6 +3346,25 @@ class BwTree : public BwTreeBase {
     // We explicitly store it here to avoid calculating the end of the array
     // everytime
     ElementType *end;
+
+    // Optional search index after the end of the array. Only consolidated
+    // nodes could have it (see BuildInnerSearchIndex() for inner nodes and
+    // BuildLeafFingerprint() for leaf nodes)
+    char *search_index_p;
+
+    // 1 + the epoch in which CompressColdLeaves() first saw this leaf
+    // without delta records, or 0 if it has not
+    mutable std::atomic<uint64_t> cold_epoch;
+
+    // Number of iterators reading this leaf in place, plus PIN_RETIRED_FLAG
+    // once the GC has unlinked it (see Pin() and Retire())
+    mutable std::atomic<uint64_t> pin_count;
+
+    // The tree version when a leaf node is installed, and the delta chain it
+    // replaced, which snapshots older than the version read instead
+    // (see BwTree::Snapshot())
+    uint64_t version;
+    const BaseNode *previous_p;
     
     // This is the starting point
     ElementType start[0];
@@ -2103,7 +3384,12 @@ class BwTree : public BwTreeBase {
       BaseNode{p_type, &low_key, &high_key, p_depth, p_item_count},
       low_key{p_low_key},
       high_key{p_high_key},
-      end{start}
+      end{start},
+      search_index_p{nullptr},
+      cold_epoch{0UL},
+      pin_count{0UL},
+      version{0UL},
+      previous_p{nullptr}
     {}
     
     /*
@@ -2136,6 +3422,10 @@ class BwTree : public BwTreeBase {
      * so destroying should be dont individually with each type.
      */
     ~ElasticNode() {
+      if(std::is_trivially_destructible<ElementType>::value == true) {
+        return;
+      }
+
       // Use two iterators to iterate through all existing elements
       for(ElementType *element_p = Begin();
           element_p != End();
@@ -2211,23 +3501,133 @@ class BwTree : public BwTreeBase {
     inline int GetSize() const {
       return static_cast<int>(End() - Begin());
     }
-    
+
     /*
-     * PushBack() - Push back an element
-     *
-     * This function takes an element type and copy-construct it on the array
-     * which is invisible to the compiler. Therefore we must call placement
-     * operator new to do the job
+     * GetSearchIndex() - Returns the search index, or nullptr if none
      */
-    inline void PushBack(const ElementType &element) {
-      // Placement new + copy constructor using end pointer
-      new (end) ElementType{element};
-      
+    inline const char *GetSearchIndex() const {
+      return search_index_p;
+    }
+
+    /*
+     * SetSearchIndex() - Sets the search index, which must be inside the
+     *                    memory reserved by Get() after the array
+     */
+    inline void SetSearchIndex(char *p_search_index_p) {
+      search_index_p = p_search_index_p;
+
+      return;
+    }
+
+    /*
+     * GetColdEpoch() - Returns the cold epoch stamp of a leaf node
+     */
+    inline uint64_t GetColdEpoch() const {
+      return cold_epoch.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * SetColdEpoch() - Sets the cold epoch stamp of a leaf node
+     *
+     * The stamp is only a hint, so it is set on the published node
+     * without synchronization other than being atomic
+     */
+    inline void SetColdEpoch(uint64_t p_cold_epoch) const {
+      cold_epoch.store(p_cold_epoch, std::memory_order_relaxed);
+
+      return;
+    }
+
+    /*
+     * GetVersion() - Returns the version stamp of a leaf node
+     */
+    inline uint64_t GetVersion() const {
+      return version;
+    }
+
+    /*
+     * GetPreviousVersion() - Returns the delta chain this leaf replaced
+     *
+     * This is nullptr for leaves that did not replace any chain, i.e. the
+     * initial leaf and bulk loaded leaves, which have version 0
+     */
+    inline const BaseNode *GetPreviousVersion() const {
+      return previous_p;
+    }
+
+    /*
+     * SetPreviousVersion() - Stamps a leaf node before it is installed
+     */
+    inline void SetPreviousVersion(const BaseNode *p_previous_p,
+                                   uint64_t p_version) {
+      previous_p = p_previous_p;
+      version = p_version;
+
+      return;
+    }
+
+    /*
+     * Pin() - Prevents a published leaf node from being freed by the GC
+     *
+     * This must be called inside an epoch in which the node is reachable,
+     * such that Retire() could not have been called on it yet. The node
+     * stays valid after the epoch is left until Unpin() is called
+     */
+    inline void Pin() const {
+      pin_count.fetch_add(1UL, std::memory_order_relaxed);
+
+      return;
+    }
+
+    /*
+     * Unpin() - Drops a reference added by Pin()
+     *
+     * Returns true if the node has been retired and this is the last
+     * reference, in which case the caller must free the node
+     */
+    inline bool Unpin() const {
+      return pin_count.fetch_sub(1UL, std::memory_order_acq_rel) == \
+             (PIN_RETIRED_FLAG | 1UL);
+    }
+
+    /*
+     * Retire() - Marks the node as unlinked when the GC reclaims it
+     *
+     * Returns true if the node is not pinned and could be freed right
+     * away. Otherwise the last Unpin() is responsible for freeing it
+     */
+    inline bool Retire() const {
+      return pin_count.fetch_or(PIN_RETIRED_FLAG,
+                                std::memory_order_acq_rel) == 0UL;
+    }
+    
+    /*
+     * PushBack() - Push back an element
+     *
+     * This function takes an element type and copy-construct it on the array
+     * which is invisible to the compiler. Therefore we must call placement
+     * operator new to do the job
+     */
+    inline void PushBack(const ElementType &element) {
+      // Placement new + copy constructor using end pointer
+      new (end) ElementType{element};
+      
       // Move it pointing to the enxt available slot, if not reached the end
       end++;
       
       return;
     }
+
+    /*
+     * PushBack() - Push back an element that is no longer used by the caller
+     */
+    inline void PushBack(ElementType &&element) {
+      new (end) ElementType{std::move(element)};
+
+      end++;
+
+      return;
+    }
     
     /*
      * PushBack() - Push back a series of elements
@@ -2241,8 +3641,7 @@ class BwTree : public BwTreeBase {
 
       // If both key type and value type are trivially copyable then
       // we just use std::memcpy to copy ii without losing any semantics
-      if(std::is_trivially_copyable<KeyType>::value == false || 
-         std::is_trivially_copyable<ValueType>::value == false) {
+      if(TRIVIAL_ELEMENT == false) {
         while(copy_start_p != copy_end_p) {
           PushBack(*copy_start_p);
           copy_start_p++; 
@@ -2256,6 +3655,31 @@ class BwTree : public BwTreeBase {
       
       return;
     }
+
+    /*
+     * MoveBack() - Push back a series of elements by moving them
+     *
+     * This is used for elements in a private buffer that is destroyed after
+     * this, such that non-trivial keys and values, e.g. std::string, are
+     * not deep copied. The source elements are left in the moved-from state
+     */
+    inline void MoveBack(ElementType *move_start_p,
+                         ElementType *move_end_p) {
+      assert(move_start_p <= move_end_p);
+
+      if(TRIVIAL_ELEMENT == true) {
+        PushBack(move_start_p, move_end_p);
+
+        return;
+      }
+
+      while(move_start_p != move_end_p) {
+        PushBack(std::move(*move_start_p));
+        move_start_p++;
+      }
+
+      return;
+    }
     
    public: 
    
@@ -2268,13 +3692,16 @@ class BwTree : public BwTreeBase {
      * lengthed node. However, after malloc() returns we use placement operator
      * new to initialize it, such that the node could be freed using operator
      * delete later on
+     *
+     * extra_size bytes are reserved after the array for the search index
      */
     inline static ElasticNode *Get(int size,         // Number of elements
                                    NodeType p_type,
                                    int p_depth,
                                    int p_item_count, // Usually equal to size
                                    const KeyNodeIDPair &p_low_key,
-                                   const KeyNodeIDPair &p_high_key) {
+                                   const KeyNodeIDPair &p_high_key,
+                                   size_t extra_size = 0UL) {
       // Currently this is always true - if we want a larger array then 
       // just remove this line
       assert(size == p_item_count);
@@ -2287,9 +3714,11 @@ class BwTree : public BwTreeBase {
       // Note: do not make it constant since it is going to be modified
       // after being returned
       char *alloc_base = \
-        new char[sizeof(ElasticNode) + \
-                   size * sizeof(ElementType) + \
-                   AllocationMeta::CHUNK_SIZE];
+        reinterpret_cast<char *>( \
+          NodeAllocator::Allocate(sizeof(ElasticNode) + \
+                                  size * sizeof(ElementType) + \
+                                  extra_size + \
+                                  AllocationMeta::CHUNK_SIZE));
       assert(alloc_base != nullptr);
       
       // Initialize the AllocationMeta - tail points to the first byte inside
@@ -2337,7 +3766,33 @@ class BwTree : public BwTreeBase {
                reinterpret_cast<uint64_t>(node_p) - \
                  AllocationMeta::CHUNK_SIZE);
     }
-    
+
+    /*
+     * GetAllocationSize() - Returns the bytes allocated by Get() for the
+     *                       node, excluding chunks grown later
+     *
+     * extra_size must be the same as the one passed to Get()
+     */
+    size_t GetAllocationSize(size_t extra_size = 0UL) const {
+      return sizeof(ElasticNode) + \
+             static_cast<size_t>(this->GetItemCount()) * sizeof(ElementType) + \
+             extra_size + \
+             AllocationMeta::CHUNK_SIZE;
+    }
+
+    /*
+     * GetMemorySize() - Returns the bytes allocated for the node, including
+     *                   chunks holding delta nodes posted on it
+     *
+     * extra_size must be the same as the one passed to Get()
+     */
+    size_t GetMemorySize(size_t extra_size = 0UL) const {
+      size_t chunk_num = GetAllocationHeader(this)->GetNextChunkNum();
+
+      return GetAllocationSize(extra_size) + \
+             AllocationMeta::CHUNK_SIZE * chunk_num;
+    }
+
     /*
      * InlineAllocate() - Allocates a delta node in preallocated area preceeds
      *                    the data area of this ElasticNode
@@ -2352,14 +3807,16 @@ class BwTree : public BwTreeBase {
      * so (1) it is static, and (2) it takes low key p which is universally
      * available for all node type (stored in NodeMetadata)
      */
-    static void *InlineAllocate(const KeyNodeIDPair *low_key_p, size_t size) {
+    static void *InlineAllocate(const KeyNodeIDPair *low_key_p,
+                                size_t size,
+                                std::atomic<int64_t> *memory_size_p) {
       const ElasticNode *node_p = GetNodeHeader(low_key_p);
       assert(&node_p->low_key == low_key_p);
       
       // Jump over chunk content
       AllocationMeta *meta_p = GetAllocationHeader(node_p);
             
-      void *p = meta_p->Allocate(size);
+      void *p = meta_p->Allocate(size, memory_size_p);
       assert(p != nullptr);
       
       return p;
@@ -2401,20 +3858,23 @@ class BwTree : public BwTreeBase {
     InnerNode &operator=(InnerNode &&) = delete;
     
     /*
-     * Destructor - Calls destructor of ElasticNode
+     * Destructor - Elements are destroyed by the destructor of ElasticNode
+     *
+     * NOTE: The base class destructor runs implicitly after this one. Calling
+     * it explicitly here would destroy non-trivial keys twice
      */
     ~InnerNode() {
-      this->~ElasticNode<KeyNodeIDPair>();
     }
 
     /*
-     * GetSplitSibling() - Split InnerNode into two halves.
+     * GetSplitSibling() - Split InnerNode into two at the given index
      *
      * This function does not change the current node since all existing nodes
-     * should be read-only to avoid data race. It copies half of the inner node
-     * into the split sibling, and return the sibling node.
+     * should be read-only to avoid data race. It copies separators from
+     * split_item_index to the end into the split sibling, and return the
+     * sibling node. The index is chosen by BwTree::GetSplitIndex()
      */
-    InnerNode *GetSplitSibling() const {
+    InnerNode *GetSplitSibling(int split_item_index) const {
       // Call function in class ElasticNode to determine the size of the 
       // inner node
       int key_num = this->GetSize();
@@ -2427,7 +3887,8 @@ class BwTree : public BwTreeBase {
       // the recorded item count
       assert(key_num == this->GetItemCount());
 
-      int split_item_index = key_num / 2;
+      // Both halves are non-empty
+      assert(split_item_index > 0 && split_item_index < key_num);
 
       // This is the split point of the inner node
       auto copy_start_it = this->Begin() + split_item_index;
@@ -2473,33 +3934,35 @@ class BwTree : public BwTreeBase {
     LeafNode &operator=(LeafNode &&) = delete;
     
     /*
-     * Destructor - Calls underlying ElasticNode d'tor
+     * Destructor - Elements are destroyed by the underlying ElasticNode d'tor
+     *
+     * NOTE: Same as class InnerNode, the base class d'tor must not be
+     * called explicitly
      */
     ~LeafNode() {
-      this->~ElasticNode<KeyValuePair>();
     }
 
     /*
-     * FindSplitPoint() - Find the split point that could divide the node
-     *                    into two even siblings
+     * FindSplitPoint() - Find the split point that is closest to the given
+     *                    index without separating values of a key
      *
-     * If such point does not exist then we manage to find a point that
-     * divides the node into two halves that are as even as possible (i.e.
-     * make the size difference as small as possible)
+     * If the key at the given index also appears before it, then we manage
+     * to find the nearest point before or after it where the key changes
      *
-     * This function works by first finding the key on the exact central
-     * position, after which it scans forward to find a KeyValuePair
-     * with a different key. If this fails then it scans backwards to find
+     * This function works by first finding the key on the target
+     * position, after which it scans backward to find a KeyValuePair
+     * with a different key. If this fails then it scans forward to find
      * a KeyValuePair with a different key.
      *
-     * NOTE: If both split points would make an uneven division with one of
-     * the node size below the merge threshold, then we do not split,
-     * and return -1 instead. Otherwise the index of the spliting point
-     * is returned
+     * NOTE: If both split points would make the left node no larger than
+     * the merge threshold, or the right node no larger than
+     * right_size_threshold, then we do not split, and return -1 instead.
+     * Otherwise the index of the spliting point is returned
      */
-    int FindSplitPoint(const BwTree *t) const {
-      int central_index = this->GetSize() / 2;
-      assert(central_index > 1);
+    int FindSplitPoint(const BwTree *t,
+                       int central_index,
+                       int right_size_threshold) const {
+      assert(central_index > 0 && central_index < this->GetSize());
 
       // This will used as upper_bound and lower_bound key
       const KeyValuePair &central_kvp = this->At(central_index);
@@ -2520,7 +3983,7 @@ class BwTree : public BwTreeBase {
       // This size is exactly the index of the split point
       int left_sibling_size = std::distance(this->Begin(), it);
 
-      if(left_sibling_size > static_cast<int>(LEAF_NODE_SIZE_LOWER_THRESHOLD)) {
+      if(left_sibling_size > t->leaf_node_size_lower_threshold) {
         return left_sibling_size;
       }
 
@@ -2536,7 +3999,7 @@ class BwTree : public BwTreeBase {
 
       int right_sibling_size = std::distance(it, this->End());
 
-      if(right_sibling_size > static_cast<int>(LEAF_NODE_SIZE_LOWER_THRESHOLD)) {
+      if(right_sibling_size > right_size_threshold) {
         return std::distance(this->Begin(), it);
       }
 
@@ -2544,7 +4007,10 @@ class BwTree : public BwTreeBase {
     }
 
     /*
-     * GetSplitSibling() - Split the node into two halves
+     * GetSplitSibling() - Split the node near the given index
+     *
+     * The index is chosen by BwTree::GetSplitIndex(), which is the middle
+     * of the node unless an uneven split policy is set.
      *
      * Although key-values are stored as independent pairs, we always split
      * on the point such that no keys are separated on two leaf nodes
@@ -2570,7 +4036,9 @@ class BwTree : public BwTreeBase {
      * or almost evenly divide the leaf node) then the return value of this
      * function is nullptr
      */
-    LeafNode *GetSplitSibling(const BwTree *t) const {
+    LeafNode *GetSplitSibling(const BwTree *t,
+                              int target_index,
+                              int right_size_threshold) const {
       // When we split a leaf node, it is certain that there is no delta
       // chain on top of it. As a result, the number of items must equal
       // the actual size of the data list
@@ -2579,7 +4047,8 @@ class BwTree : public BwTreeBase {
       // This is the index of the actual key-value pair in data_list
       // We need to substract this value from the prefix sum in the new
       // inner node
-      int split_item_index = FindSplitPoint(t);
+      int split_item_index = \
+        FindSplitPoint(t, target_index, right_size_threshold);
       
       // Could not split because we could not find a split point
       // and the caller is responsible for not spliting the node
@@ -2589,6 +4058,9 @@ class BwTree : public BwTreeBase {
         return nullptr;
       }
 
+      // Both halves are non-empty
+      assert(split_item_index > 0);
+
       // This is an iterator pointing to the split point in the vector
       // note that std::advance() operates efficiently on std::vector's
       // RandomAccessIterator
@@ -2597,10 +4069,12 @@ class BwTree : public BwTreeBase {
       // This is the end point for later copy of data
       auto copy_end_it = this->End();
 
-      // This is the key part of the key-value pair, also the low key
-      // of the new node and new high key of the current node (will be
-      // reflected in split delta later in its caller)
-      const KeyType &split_key = copy_start_it->first;
+      // This is the low key of the new node and new high key of the
+      // current node (will be reflected in split delta later in its caller)
+      // It could be shorter than the first key of the new node, but it
+      // always separates the last key of this node and that key
+      const KeyType split_key = \
+        t->GetSeparatorKey((copy_start_it - 1)->first, copy_start_it->first);
 
       int sibling_size = \
         static_cast<int>(std::distance(copy_start_it,
@@ -2614,18 +4088,155 @@ class BwTree : public BwTreeBase {
               0,
               sibling_size,
               std::make_pair(split_key, ~INVALID_NODE_ID),
-              this->GetHighKeyPair()));
+              this->GetHighKeyPair(),
+              t->leaf_fingerprint_flag ? \
+                BwTree::GetLeafFingerprintSize(sibling_size) : 0UL));
 
       // Copy data item into the new node using PushBack()
       leaf_node_p->PushBack(copy_start_it, copy_end_it);
 
+      // Snapshots older than this node read the sibling's key range from
+      // the chain this node replaced
+      leaf_node_p->SetPreviousVersion(this->GetPreviousVersion(),
+                                      this->GetVersion());
+
       assert(leaf_node_p->GetSize() == sibling_size);
       assert(leaf_node_p->GetSize() == leaf_node_p->GetItemCount());
 
+      // The sibling is a new base node as if it were consolidated
+      if(t->leaf_fingerprint_flag == true) {
+        t->BuildLeafFingerprint(leaf_node_p);
+      }
+
       return leaf_node_p;
     }
   };
 
+  /*
+   * class CompressedLeafNode - Leaf base node whose items are encoded into
+   *                            a byte array
+   *
+   * This is produced by CompressColdLeaves() for leaves that have not been
+   * modified for a while (see EncodeLeafItems() for the format). Since
+   * delta records are allocated in the chunk of an ElasticNode, nothing is
+   * ever posted on this node. Read-only traversals decode it on demand,
+   * and all other traversals replace it with a LeafNode when they load it
+   * (see GetExpandedNode())
+   */
+  class CompressedLeafNode : public BaseNode {
+   private:
+    KeyNodeIDPair low_key;
+    KeyNodeIDPair high_key;
+
+    // The cold epoch stamp of the leaf node it is compressed from, which is
+    // given back to the LeafNode when it is expanded
+    uint64_t cold_epoch;
+
+    // Version stamp and previous version of the leaf node it is compressed
+    // from, which are also given back (see ElasticNode::GetVersion())
+    uint64_t version;
+    const BaseNode *previous_p;
+
+    // Number of bytes in the data array
+    size_t data_size;
+
+    unsigned char data[0];
+
+   public:
+    /*
+     * Constructor - The data array is filled by Get()
+     */
+    CompressedLeafNode(int p_item_count,
+                       const KeyNodeIDPair &p_low_key,
+                       const KeyNodeIDPair &p_high_key,
+                       uint64_t p_cold_epoch,
+                       size_t p_data_size) :
+      BaseNode{NodeType::LeafCompressedType,
+               &low_key,
+               &high_key,
+               0,
+               p_item_count},
+      low_key{p_low_key},
+      high_key{p_high_key},
+      cold_epoch{p_cold_epoch},
+      version{0UL},
+      previous_p{nullptr},
+      data_size{p_data_size}
+    {}
+
+    /*
+     * Get() - Allocates a compressed leaf node holding a copy of the
+     *         encoded items
+     */
+    static CompressedLeafNode *Get(int p_item_count,
+                                   const KeyNodeIDPair &p_low_key,
+                                   const KeyNodeIDPair &p_high_key,
+                                   uint64_t p_cold_epoch,
+                                   const unsigned char *p_data_p,
+                                   size_t p_data_size) {
+      CompressedLeafNode *node_p = \
+        reinterpret_cast<CompressedLeafNode *>( \
+          NodeAllocator::Allocate(sizeof(CompressedLeafNode) + p_data_size));
+      assert(node_p != nullptr);
+
+      new (node_p) CompressedLeafNode{p_item_count,
+                                      p_low_key,
+                                      p_high_key,
+                                      p_cold_epoch,
+                                      p_data_size};
+
+      std::memcpy(node_p->data, p_data_p, p_data_size);
+
+      return node_p;
+    }
+
+    /*
+     * Destroy() - Frees the memory allocated by Get()
+     *
+     * The destructor should be called first
+     */
+    void Destroy() const {
+      NodeAllocator::Free(const_cast<CompressedLeafNode *>(this));
+
+      return;
+    }
+
+    inline const unsigned char *GetData() const {
+      return data;
+    }
+
+    inline size_t GetDataSize() const {
+      return data_size;
+    }
+
+    inline uint64_t GetColdEpoch() const {
+      return cold_epoch;
+    }
+
+    inline uint64_t GetVersion() const {
+      return version;
+    }
+
+    inline const BaseNode *GetPreviousVersion() const {
+      return previous_p;
+    }
+
+    inline void SetPreviousVersion(const BaseNode *p_previous_p,
+                                   uint64_t p_version) {
+      previous_p = p_previous_p;
+      version = p_version;
+
+      return;
+    }
+
+    /*
+     * GetAllocationSize() - Returns the bytes allocated by Get()
+     */
+    inline size_t GetAllocationSize() const {
+      return sizeof(CompressedLeafNode) + data_size;
+    }
+  };
+
   ////////////////////////////////////////////////////////////////////
   // Interface Method Implementation
   ////////////////////////////////////////////////////////////////////
@@ -2639,9 +4250,10 @@ class BwTree : public BwTreeBase {
    *
    * Some properties of the tree should be specified in the argument.
    *
-   *   start_gc_thread - If set to true then a separate gc thred will be
-   *                     started. Otherwise GC must be done by the user
-   *                     using PerformGarbageCollection() interface
+   *   start_gc_thread - If set to true then worker threads advance the
+   *                     global epoch by themselves when they collect their
+   *                     garbage. Otherwise the epoch must be advanced by the
+   *                     user using IncreaseEpoch()
    */
   BwTree(bool start_gc_thread = true,
          KeyComparator p_key_cmp_obj = KeyComparator{},
@@ -2669,11 +4281,16 @@ class BwTree : public BwTreeBase {
       key_value_pair_eq_obj{this},
       key_value_pair_hash_obj{this},
       
+      tree_generation{0UL},
+
       // NodeID counter
       next_unused_node_id{1},
 
       // Initialize free NodeID stack
       free_node_id_list{},
+      recycled_node_id_lock{},
+      recycled_node_id_list{},
+      recycled_node_id_count{0UL},
 
       // Statistical information
       insert_op_count{0},
@@ -2683,6 +4300,66 @@ class BwTree : public BwTreeBase {
       update_op_count{0},
       update_abort_count{0},
 
+      // Memory accounting. The mapping table is counted on demand
+      node_memory_size{0},
+      garbage_memory_size{0},
+      garbage_list_memory_size{0},
+      iterator_memory_size_p{std::make_shared<std::atomic<int64_t>>(0)},
+      stable_value_memory_size{0},
+      memory_limit{0UL},
+      stable_value_chunk_list{nullptr},
+
+      // Split and merge thresholds
+      inner_node_size_upper_threshold{TuningPolicy::INNER_NODE_UPPER_THRESHOLD},
+      inner_node_size_lower_threshold{TuningPolicy::INNER_NODE_LOWER_THRESHOLD},
+      leaf_node_size_upper_threshold{TuningPolicy::LEAF_NODE_UPPER_THRESHOLD},
+      leaf_node_size_lower_threshold{TuningPolicy::LEAF_NODE_LOWER_THRESHOLD},
+
+      // Nodes are split in the middle by default
+      split_percent{50},
+      right_edge_split_percent{50},
+
+      // Inner nodes use the sorted array only by default
+      inner_search_index_flag{false},
+
+      // Leaf nodes do not carry fingerprints by default
+      leaf_fingerprint_flag{false},
+
+      // Prefetching is chosen by SetPrefetchMode()
+      prefetch_flag{false},
+
+      // Background consolidation is not started by default
+      consolidation_queue_p{nullptr},
+      consolidation_thread_list{},
+      consolidation_exit_flag{false},
+      consolidation_hard_cap_factor{CONSOLIDATION_HARD_CAP_FACTOR},
+      consolidation_gc_id_start{MAX_THREAD_COUNT},
+
+      // Adaptive consolidation is chosen by SetAdaptiveConsolidation()
+      node_access_counter_p{nullptr},
+
+      // The read cache is created by SetReadCacheSize()
+      read_cache_p{nullptr},
+
+      // Leaf fingers are chosen by SetLeafFingerMode()
+      leaf_finger_flag{false},
+
+      // Chosen by SetLeafRetryMode() and SetRTMMode() respectively
+      leaf_retry_flag{false},
+      rtm_flag{false},
+
+      approximate_size_base{0L},
+
+      snapshot_version{0UL},
+
+      // The tree is freed by one thread by default
+      teardown_thread_num{1UL},
+      reclaim_task_list{},
+      reclaim_exit_flag{false},
+
+      // Whether worker threads advance the epoch themselves
+      auto_epoch_flag{start_gc_thread},
+
       // Epoch Manager that does garbage collection
       epoch_manager{this} {
     bwt_printf("Bw-Tree Constructor called. "
@@ -2696,13 +4373,6 @@ class BwTree : public BwTreeBase {
     bwt_printf("sizeof(KeyType) = %lu is the size of key\n",
                sizeof(KeyType));
 
-    // We could choose not to start GC thread inside the BwTree
-    // in that case GC must be done by calling the interface
-    if(start_gc_thread == true) {
-      bwt_printf("Starting epoch manager thread...\n");
-      epoch_manager.StartThread();
-    }
-
     dummy("Call it here to avoid compiler warning\n");
     
     return;
@@ -2719,12 +4389,27 @@ class BwTree : public BwTreeBase {
     bwt_printf("Next node ID at exit: %lu\n", next_unused_node_id.load());
     bwt_printf("Destructor: Free tree nodes\n");
 
+    // Background threads also add garbage nodes
+    StopConsolidationThreads();
+
+    // Trees dropped by Truncate() are freed before thread local data,
+    // which reclaim threads read
+    JoinReclaimTasks();
+
+    SetAdaptiveConsolidation(false);
+
+    delete read_cache_p;
+
     // Clear all garbage nodes awaiting cleaning
     // First of all it should set all last active epoch counter to -1
     ClearThreadLocalGarbage();
 
+    // Retired values have been returned to free lists above, and values
+    // still in use are owned by the caller
+    FreeStableValueChunks();
+
     // Free all nodes recursively
-    size_t node_count = FreeNodeByNodeID(root_id.load());
+    size_t node_count = FreeSubtrees(root_id.load(), teardown_thread_num);
 
     bwt_printf("Freed %lu tree nodes\n", node_count);
 
@@ -2737,20 +4422,46 @@ class BwTree : public BwTreeBase {
    * This must be called under single threaded environment
    */
   void ClearThreadLocalGarbage() {
+    // Slots of all GC IDs that have been used with this instance
+    size_t slot_num = segment_num.load() * THREAD_LOCAL_SEGMENT_SIZE;
+    
     // First of all we should set all last active counter to -1 to
     // guarantee progress to clear all epoches
-    for(size_t i = 0;i < GetThreadNum();i++) {
+    for(size_t i = 0;i < slot_num;i++) {
       UnregisterThread(i);
     }
     
-    for(size_t i = 0;i < GetThreadNum();i++) {
+    for(size_t i = 0;i < slot_num;i++) {
       // Here all epoch counters have been set to 0xFFFFFFFFFFFFFFFF
-      // so GC should always succeed
-      PerformGC(i);
+      // so GC should always succeed. The cached GC epoch is bounded by
+      // the global epoch, so we do not use it here
+      FreeGarbageBefore(i, static_cast<uint64_t>(-1));
       
       // This will collect all nodes since we have adjusted the currenr thread
       // GC ID
       assert(GetGCMetaData(i)->node_count == 0);
+      assert(GetGCMetaData(i)->head_p == nullptr);
+      
+      // Then free segments kept for reuse
+      GarbageSegment *segment_p = GetGCMetaData(i)->free_segment_p;
+      while(segment_p != nullptr) {
+        GarbageSegment *next_segment_p = segment_p->next_p;
+        
+        segment_p->~GarbageSegment();
+        NodeAllocator::Free(segment_p);
+
+        garbage_list_memory_size.fetch_sub( \
+          static_cast<int64_t>(sizeof(GarbageSegment)),
+          std::memory_order_relaxed);
+        
+        segment_p = next_segment_p;
+      }
+      
+      GetGCMetaData(i)->free_segment_p = nullptr;
+      GetGCMetaData(i)->gc_threshold = GC_NODE_COUNT_THREADHOLD;
+      
+      // Free value slots stay in their chunks, which are owned by the tree
+      GetGCMetaData(i)->free_value_slot_p = nullptr;
     }
     
     return;
@@ -2768,4915 +4479,11831 @@ class BwTree : public BwTreeBase {
     bwt_printf("Updating thread-local array to length %lu......\n", 
                p_thread_num);
     
+    // Background threads own GC IDs in the current array
+    assert(consolidation_queue_p == nullptr);
+    
+    // Reclaim threads read the current array
+    JoinReclaimTasks();
+    
     // 1. Frees all pending memory chunks
     // 2. Frees the thread local array
     ClearThreadLocalGarbage(); 
+
+    // Item counters are reset with the array
+    approximate_size_base = GetItemCountSum();
     DestroyThreadLocal();
     
     SetThreadNum(p_thread_num);
     
     // 3. Allocate a new array based on the new given size
-    // Here all epoches are restored to 0
     PrepareThreadLocal();
     
     return;
   }
 
   /*
-   * FreeNodeByNodeID() - Given a NodeID, free all nodes and its children
+   * SetNodeSizeThreshold() - Overrides split and merge thresholds given by
+   *                          TuningPolicy for this tree instance
    *
-   * This function returns if the mapping table entry is nullptr which implies
-   * that the NodeID has already been recycled and we should not recycle it
-   * twice.
+   * A node is split if its size >= upper threshold, and is merged if its
+   * size <= lower threshold. To avoid a split immediately followed by a merge
+   * the upper threshold must be greater than twice the lower threshold
    *
-   * The return value represents the number of nodes recycled
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
    */
-  size_t FreeNodeByNodeID(NodeID node_id) {
-    const BaseNode *node_p = GetNode(node_id);
-    if(node_p == nullptr) {
-      return 0UL;
-    }
-
-    mapping_table[node_id] = nullptr;
+  void SetNodeSizeThreshold(int inner_upper_threshold,
+                            int inner_lower_threshold,
+                            int leaf_upper_threshold,
+                            int leaf_lower_threshold) {
+    assert(inner_lower_threshold >= 0);
+    assert(inner_upper_threshold > inner_lower_threshold * 2);
+    assert(leaf_lower_threshold >= 0);
+    assert(leaf_upper_threshold > leaf_lower_threshold * 2);
+
+    // Inner node split and FindSplitPoint() requires at least 4 elements
+    assert(inner_upper_threshold >= 4);
+    assert(leaf_upper_threshold >= 4);
+
+    inner_node_size_upper_threshold = inner_upper_threshold;
+    inner_node_size_lower_threshold = inner_lower_threshold;
+    leaf_node_size_upper_threshold = leaf_upper_threshold;
+    leaf_node_size_lower_threshold = leaf_lower_threshold;
 
-    return FreeNodeByPointer(node_p);
+    return;
   }
 
   /*
-   * InvalidateNodeID() - Recycle NodeID
-   *
-   * This function is called when a NodeID has been invalidated due to a
-   * node removal and it is guaranteed that the NodeID will not be used
-   * anymore by any thread. This usually happens in the epoch manager
+   * SetSplitPolicy() - Chooses where full nodes are split
    *
-   * Even if NodeIDs are not recycled (e.g. the counter monotonically increase)
-   * this is necessary for destroying the tree since we want to avoid deleting
-   * a removed node in InnerNode
+   * Both arguments are the percentage of items kept in the left node of a
+   * split. The first one applies to nodes with a right sibling, and the
+   * second one to the rightmost node of each level, which takes all inserts
+   * of monotonically increasing keys. Setting the latter to e.g. 90 leaves
+   * the left nodes almost full, since they are never written again under an
+   * append pattern, instead of at half occupancy forever.
    *
-   * NOTE: This function only works in a single-threaded environment such
-   * as epoch manager and destructor
+   * Split points are clamped such that both nodes are above the merge
+   * threshold, except that the right node of a right edge split only has
+   * to be non-empty. With a right edge percentage above 50, the rightmost
+   * node of a level is not merged while it still has items, since it is
+   * expected to grow
    *
-   * DO NOT call this in worker thread!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
    */
-  inline void InvalidateNodeID(NodeID node_id) {
-    mapping_table[node_id] = nullptr;
+  void SetSplitPolicy(int p_split_percent, int p_right_edge_split_percent) {
+    assert(p_split_percent > 0 && p_split_percent < 100);
+    assert(p_right_edge_split_percent > 0 && p_right_edge_split_percent < 100);
 
-    // Next time if we need a node ID we just push back from this
-    //free_node_id_list.SingleThreadPush(node_id);
+    split_percent = p_split_percent;
+    right_edge_split_percent = p_right_edge_split_percent;
 
     return;
   }
 
   /*
-   * FreeNodeByPointer() - Free all nodes currently in the tree
-   *
-   * For normal destruction, we do not accept InnerAbortNode,
-   * InnerRemoveNode, and LeafRemoveNode, since these three types
-   * only appear as temporary states, and must be completed before
-   * a thread could finish its job and exit (after posting remove delta
-   * the thread always aborts and restarts traversal from the root)
-   *
-   * NOTE: Do not confuse this function with FreeEpochDeltaChain
-   * in EpochManager. These two functions differs in details (see above)
-   * and could not be used interchangeably.
-   *
-   * NOTE 2: This function should only be called in single threaded
-   * environment since it assumes sole ownership of the entire tree
-   * This is trivial during normal destruction, but care must be taken
-   * when this is not true.
-   *
-   * NOTE 3: This function does not consider InnerAbortNode, InnerRemoveNode
-   * and LeafRemoveNode as valid, since these three are just temporary nodes,
-   * and should not exist if a thread finishes its job (for remove nodes they
-   * must be removed after posting InnerDeleteNode, which should be done by
-   * the thread posting remove delta or other threads helping-along)
-   *
-   * This node calls destructor according to the type of the node, considering
-   * that there is not virtual destructor defined for sake of running speed.
+   * class MemoryUsage - Bytes allocated by the tree in each category
    */
-  size_t FreeNodeByPointer(const BaseNode *node_p) {
-    const BaseNode *next_node_p = node_p;
-    size_t freed_count = 0;
+  class MemoryUsage {
+   public:
+    // Base nodes together with delta chunks and remove/abort nodes that
+    // are reachable from the mapping table
+    size_t node_size;
 
-    while(1) {
-      node_p = next_node_p;
-      assert(node_p != nullptr);
+    // Directory and segments of the mapping table
+    size_t mapping_table_size;
 
-      NodeType type = node_p->GetType();
+    // Nodes unlinked from the tree but not yet freed by the epoch manager
+    size_t garbage_size;
 
-      switch(type) {
-        case NodeType::LeafInsertType:
-          next_node_p = ((LeafInsertNode *)node_p)->child_node_p;
-
-          ((LeafInsertNode *)node_p)->~LeafInsertNode();
-          freed_count++;
+    // Segments of per-thread garbage lists, including those kept for reuse
+    size_t garbage_list_size;
 
-          break;
-        case NodeType::LeafDeleteType:
-          next_node_p = ((LeafDeleteNode *)node_p)->child_node_p;
+    // Leaf pages and parent nodes buffered by live iterators
+    size_t iterator_size;
 
-          ((LeafDeleteNode *)node_p)->~LeafDeleteNode();
+    // Chunks of stable value slots, including slots that are free
+    size_t stable_value_size;
 
-          break;
-        case NodeType::LeafSplitType:
-          next_node_p = ((LeafSplitNode *)node_p)->child_node_p;
+    /*
+     * GetTotalSize() - Returns the sum of all categories
+     */
+    size_t GetTotalSize() const {
+      return node_size + \
+             mapping_table_size + \
+             garbage_size + \
+             garbage_list_size + \
+             iterator_size + \
+             stable_value_size;
+    }
+  };
 
-          freed_count += \
-            FreeNodeByNodeID(((LeafSplitNode *)node_p)->insert_item.second);
+  /*
+   * GetMemoryUsage() - Returns bytes currently allocated by the tree
+   *
+   * Counters are updated when nodes are published, grown, unlinked and
+   * freed, so this does not traverse the tree. Under concurrent
+   * modification each category could be off by the nodes in flight.
+   * Memory held by keys and values themselves (e.g. std::string buffers)
+   * is not counted
+   */
+  MemoryUsage GetMemoryUsage() const {
+    auto load_size = [](const std::atomic<int64_t> &size) {
+      int64_t value = size.load(std::memory_order_relaxed);
 
-          ((LeafSplitNode *)node_p)->~LeafSplitNode();
-          freed_count++;
+      return value < 0 ? 0UL : static_cast<size_t>(value);
+    };
 
-          break;
-        case NodeType::LeafMergeType:
-          freed_count += \
-            FreeNodeByPointer(((LeafMergeNode *)node_p)->child_node_p);
-          freed_count += \
-            FreeNodeByPointer(((LeafMergeNode *)node_p)->right_merge_p);
+    return MemoryUsage{load_size(node_memory_size),
+                       mapping_table.GetMemorySize(),
+                       load_size(garbage_memory_size),
+                       load_size(garbage_list_memory_size),
+                       load_size(*iterator_memory_size_p),
+                       load_size(stable_value_memory_size)};
+  }
 
-          ((LeafMergeNode *)node_p)->~LeafMergeNode();
-          freed_count++;
+  /*
+   * SetMemoryLimit() - Sets a soft limit of the bytes allocated by the tree
+   *
+   * Above the limit, worker threads collect garbage whenever they have any
+   * rather than after the GC threshold is reached, and leaf delta chains
+   * are consolidated by the thread that finds them at the static threshold.
+   * Operations are never refused. A limit of 0 removes the limit
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
+   */
+  void SetMemoryLimit(size_t p_memory_limit) {
+    memory_limit = p_memory_limit;
 
-          // Leaf merge node is an ending node
-          return freed_count;
-        case NodeType::LeafType:
-          // Call destructor first, and then call Destroy() on its preallocated
-          // linked list of chunks
-          ((LeafNode *)node_p)->~LeafNode();
-          
-          // Free the memory
-          ((LeafNode *)node_p)->Destroy();
-          
-          freed_count++;
+    return;
+  }
 
-          // We have reached the end of delta chain
-          return freed_count;
-        case NodeType::InnerInsertType:
-          next_node_p = ((InnerInsertNode *)node_p)->child_node_p;
+  /*
+   * IsMemoryLimitExceeded() - Returns true if there is a memory limit and
+   *                           bytes allocated by the tree exceed it
+   */
+  inline bool IsMemoryLimitExceeded() const {
+    if(memory_limit == 0UL) {
+      return false;
+    }
 
-          freed_count += \
-            FreeNodeByNodeID(((InnerInsertNode *)node_p)->item.second);
+    return GetMemoryUsage().GetTotalSize() > memory_limit;
+  }
 
-          ((InnerInsertNode *)node_p)->~InnerInsertNode();
-          freed_count++;
+  // Size in bytes of a stable value slot, and the number of slots carved
+  // from one chunk allocated by NodeAllocator
+  static constexpr size_t STABLE_VALUE_SLOT_SIZE = 16UL;
+  static constexpr size_t STABLE_VALUE_CHUNK_SLOT_NUM = 255UL;
 
-          break;
-        case NodeType::InnerDeleteType:
-          next_node_p = ((InnerDeleteNode *)node_p)->child_node_p;
+  // Retired slots are tagged with this bit in the garbage list to tell
+  // them apart from nodes, which are at least 8 byte aligned
+  static constexpr size_t STABLE_VALUE_GARBAGE_TAG = 0x1UL;
 
-          // For those already deleted, the delta chain has been merged
-          // and the remove node should be freed (either before this point
-          // or will be freed) epoch manager
-          // NOTE: No need to call InvalidateNodeID since this function is
-          // only called on destruction of the tree
-          mapping_table[((InnerDeleteNode *)node_p)->item.second] = \
-            nullptr;
+  /*
+   * class StableValueSlot - Storage of one stable value, or the link of
+   *                         the per-thread free list when it is not used
+   */
+  class StableValueSlot {
+   public:
+    union {
+      StableValueSlot *next_p;
+      unsigned char data[STABLE_VALUE_SLOT_SIZE];
+    };
+  };
 
-          ((InnerDeleteNode *)node_p)->~InnerDeleteNode();
-          freed_count++;
+  /*
+   * class StableValueChunk - A fixed sized array of stable value slots
+   *
+   * Chunks are never freed before the tree is destroyed, so that the
+   * address of a value stays valid until GC reclaims its slot
+   */
+  class StableValueChunk {
+   public:
+    StableValueChunk *next_p;
 
-          break;
-        case NodeType::InnerSplitType:
-          next_node_p = ((InnerSplitNode *)node_p)->child_node_p;
+    StableValueSlot slot_list[STABLE_VALUE_CHUNK_SLOT_NUM];
+  };
 
-          freed_count += \
-            FreeNodeByNodeID(((LeafSplitNode *)node_p)->insert_item.second);
+  /*
+   * NewStableValue() - Copies a value into a slot whose address does not
+   *                    change until the value is retired
+   *
+   * This is intended for indexes storing pointers to small values (e.g.
+   * an ItemPointer in the MVCC index) that must outlive concurrent readers.
+   * Slots are taken from a free list of the calling thread without any
+   * heap allocation in the common case, and a new chunk is allocated when
+   * the list is empty.
+   *
+   * NOTE: The calling thread must be registered with a GC ID
+   */
+  template <typename T>
+  T *NewStableValue(const T &value) {
+    static_assert(sizeof(T) <= STABLE_VALUE_SLOT_SIZE,
+                  "Stable value is larger than a slot");
+    static_assert(alignof(T) <= alignof(StableValueSlot),
+                  "Stable value has a larger alignment than a slot");
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "Stable value must be trivially destructible");
+
+    return new (AllocateStableValueSlot()) T{value};
+  }
 
-          ((InnerSplitNode *)node_p)->~InnerSplitNode();
-          freed_count++;
+  /*
+   * RetireStableValue() - Returns the slot of a value returned by
+   *                       NewStableValue() after all threads have left
+   *                       the current epoch
+   *
+   * The slot goes through the garbage list of the calling thread like an
+   * unlinked node, so readers that obtained the address from the tree
+   * before it is retired could still dereference it.
+   *
+   * NOTE: The calling thread must be registered with a GC ID
+   */
+  template <typename T>
+  void RetireStableValue(const T *value_p) {
+    assert((reinterpret_cast<size_t>(value_p) & \
+            STABLE_VALUE_GARBAGE_TAG) == 0UL);
 
-          break;
-        case NodeType::InnerMergeType:
-          freed_count += \
-            FreeNodeByPointer(((InnerMergeNode *)node_p)->child_node_p);
-          freed_count += \
-            FreeNodeByPointer(((InnerMergeNode *)node_p)->right_merge_p);
+    AddGarbage(reinterpret_cast<void *>( \
+      reinterpret_cast<size_t>(value_p) | STABLE_VALUE_GARBAGE_TAG));
 
-          ((InnerMergeNode *)node_p)->~InnerMergeNode();
-          freed_count++;
+    return;
+  }
 
-          return freed_count;
-        case NodeType::InnerType: {
-          const InnerNode *inner_node_p = \
-            static_cast<const InnerNode *>(node_p);
+  /*
+   * AllocateStableValueSlot() - Pops a slot from the free list of the
+   *                             current thread, refilling the list with a
+   *                             new chunk if it is empty
+   */
+  void *AllocateStableValueSlot() {
+    GCMetaData *metadata_p = GetCurrentGCMetaData();
+    StableValueSlot *slot_p = \
+      static_cast<StableValueSlot *>(metadata_p->free_value_slot_p);
+
+    if(slot_p == nullptr) {
+      StableValueChunk *chunk_p = static_cast<StableValueChunk *>( \
+        NodeAllocator::Allocate(sizeof(StableValueChunk)));
+
+      // All slots except the first one go to the free list
+      for(size_t i = 1;i < STABLE_VALUE_CHUNK_SLOT_NUM;i++) {
+        chunk_p->slot_list[i].next_p = \
+          (i + 1 == STABLE_VALUE_CHUNK_SLOT_NUM) ? \
+            nullptr : &chunk_p->slot_list[i + 1];
+      }
 
-          // Free NodeID one by one stored in its separator list
-          // Even if they are already freed (e.g. a split delta has not
-          // been consolidated would share a NodeID with its parent)
-          for(auto it = inner_node_p->Begin();
-              it != inner_node_p->End();
-              it++) {
-            freed_count += FreeNodeByNodeID(it->second);
-          }
+      slot_p = &chunk_p->slot_list[0];
+      slot_p->next_p = &chunk_p->slot_list[1];
 
-          inner_node_p->~InnerNode();
-          inner_node_p->Destroy();
-          
-          
-          freed_count++;
+      // Link the chunk such that it is freed with the tree
+      StableValueChunk *head_p = stable_value_chunk_list.load();
+      do {
+        chunk_p->next_p = head_p;
+      } while(stable_value_chunk_list.compare_exchange_weak(head_p,
+                                                            chunk_p) == false);
 
-          // Since we free nodes recursively, after processing an inner
-          // node and recursively with its child nodes we could return here
-          return freed_count;
-        }
-        default:
-          // For InnerAbortNode, InnerRemoveNode and LeafRemoveNode
-          // they are supposed to be removed as part of any operation on
-          // the tree (i.e. they could not be left behind once a operation
-          // has been finished)
-          bwt_printf("Unknown node type: %d\n", (int)type);
+      stable_value_memory_size.fetch_add( \
+        static_cast<int64_t>(sizeof(StableValueChunk)),
+        std::memory_order_relaxed);
+    }
 
-          assert(false);
-          return 0;
-      } // switch
-    } // while 1
+    metadata_p->free_value_slot_p = slot_p->next_p;
 
-    assert(false);
-    return 0;
+    return slot_p->data;
   }
 
   /*
-   * InitNodeLayout() - Initialize the nodes required to start BwTree
+   * FreeStableValueChunks() - Frees all chunks of stable value slots
    *
-   * We need at least a root inner node and a leaf node in order
-   * to guide the first operation to the right place
+   * This must be called under single threaded environment after all
+   * values have been retired or are no longer used
    */
-  void InitNodeLayout() {
-    bwt_printf("Initializing node layout for root and first page...\n");
+  void FreeStableValueChunks() {
+    StableValueChunk *chunk_p = stable_value_chunk_list.exchange(nullptr);
 
-    root_id = GetNextNodeID();
-    assert(root_id == 1UL);
+    while(chunk_p != nullptr) {
+      StableValueChunk *next_chunk_p = chunk_p->next_p;
 
-    // This is important since in the iterator we will use NodeID = 2
-    // as the starting point of the traversal
-    first_leaf_id = GetNextNodeID();
-    assert(first_leaf_id == FIRST_LEAF_NODE_ID);
+      NodeAllocator::Free(chunk_p);
 
-    #ifdef BWTREE_PELOTON
+      stable_value_memory_size.fetch_sub( \
+        static_cast<int64_t>(sizeof(StableValueChunk)),
+        std::memory_order_relaxed);
 
-    // For the first inner node, it needs an empty low key
-    // the search procedure will not look at it and only use it
-    // if the search key could not be matched to anything after the first key
-    KeyNodeIDPair first_sep{KeyType(), first_leaf_id};
+      chunk_p = next_chunk_p;
+    }
 
-    // Initially there is one element inside the root node
-    // so we set item count to be 1
-    // The high key is +Inf which is identified by INVALID_NODE_ID
-    InnerNode *root_node_p = \
-      reinterpret_cast<InnerNode *>( \
-        ElasticNode<KeyNodeIDPair>::\
-          Get(1, 
-              NodeType::InnerType, 
-              0, 
-              1, 
-              first_sep,
-              std::make_pair(KeyType(), INVALID_NODE_ID)));
+    return;
+  }
 
-    #else
+  /*
+   * SetInnerNodeSearchIndex() - Chooses whether consolidated inner nodes
+   *                             carry an Eytzinger ordered search index
+   *
+   * The index trades memory (one more copy of separators plus NodeIDs) and
+   * consolidation time for fewer cache lines touched per inner level, so it
+   * is suited to read-mostly indexes. Inner nodes consolidated later use the
+   * chosen layout, and lookups on existing nodes are not affected. It has
+   * no effect unless KeyType is trivially copyable
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
+   */
+  void SetInnerNodeSearchIndex(bool search_index_flag) {
+    inner_search_index_flag = search_index_flag;
 
-    // For the first inner node, it needs an empty low key
-    // the search procedure will not look at it and only use it
-    // if the search key could not be matched to anything after the first key
-    KeyNodeIDPair first_sep{KeyType{}, first_leaf_id};
+    return;
+  }
 
-    // Initially there is one element inside the root node
-    // so we set item count to be 1
-    // The high key is +Inf which is identified by INVALID_NODE_ID
-    InnerNode *root_node_p = \
-      reinterpret_cast<InnerNode *>( \
-        ElasticNode<KeyNodeIDPair>::\
-          Get(1, 
-              NodeType::InnerType, 
-              0, 
-              1, 
-              first_sep,    // Copy this as the first key
-              std::make_pair(KeyType{}, INVALID_NODE_ID)));
+  /*
+   * SetMappingTablePageMode() - Chooses the pages backing the mapping table
+   *
+   * page_flags is a combination of PageAllocator options, e.g. HUGE_PAGE
+   * maps segments of the table on 2MB pages, such that GetNode() on a large
+   * tree does not miss the TLB for every segment, and INTERLEAVE spreads
+   * them over memory nodes since all threads read the table. Existing
+   * segments are moved to the new pages. Segments for the first
+   * prefault_node_num NodeIDs are allocated here, and with PREFAULT their
+   * pages are also faulted here rather than by the first inserts
+   *
+   * NOTE: This function must be called at most once, when there is no
+   * other thread working on the tree
+   */
+  void SetMappingTablePageMode(int page_flags, size_t prefault_node_num = 0UL) {
+    mapping_table.SetPageFlags(page_flags);
+    mapping_table.Preallocate(prefault_node_num);
 
-    #endif
+    return;
+  }
 
-    root_node_p->PushBack(first_sep);
+  /*
+   * SetLeafKeyFingerprint() - Chooses whether consolidated leaf nodes carry
+   *                           a fingerprint of their keys
+   *
+   * The fingerprint costs LEAF_FINGERPRINT_BITS_PER_KEY bits per item, and
+   * lets lookups of keys not on a leaf return without searching the node,
+   * which suits workloads where most probes miss (e.g. unique checks before
+   * inserting) and key comparisons are expensive. Together with the key
+   * hashes in leaf data nodes, a miss is decided mostly by comparing hashes.
+   * Inserts still search the node for the position of their delta record.
+   * Leaves consolidated later carry the fingerprint, and other leaves are
+   * searched as before
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
+   */
+  void SetLeafKeyFingerprint(bool fingerprint_flag) {
+    leaf_fingerprint_flag = fingerprint_flag;
 
-    bwt_printf("root id = %lu; first leaf id = %lu\n",
-               root_id.load(),
-               first_leaf_id);
+    return;
+  }
 
-    InstallNewNode(root_id, root_node_p);
+  /*
+   * SetPrefetchMode() - Enables or disables software prefetching on reads
+   *
+   * With prefetching, read traversals prefetch the first lines of each node
+   * as soon as its pointer is loaded, and GetValueBatch() interleaves the
+   * traversals of BATCH_PREFETCH_GROUP_SIZE keys level by level such that
+   * mapping table slots and nodes of one key are fetched while other keys
+   * are being searched
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
+   */
+  void SetPrefetchMode(bool p_prefetch_flag) {
+    prefetch_flag = p_prefetch_flag;
 
-    // Initially there is no element inside the leaf node so we set element
-    // count to be 0
-    #ifdef BWTREE_PELOTON
+    return;
+  }
 
-    LeafNode *left_most_leaf = \
-      reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
-        Get(0,
-            NodeType::LeafType,
-            0,
-            0,
-            std::make_pair(KeyType(), INVALID_NODE_ID),
-            std::make_pair(KeyType(), INVALID_NODE_ID)));
+  /*
+   * SetAdaptiveConsolidation() - Enables or disables per-leaf delta chain
+   *                              thresholds chosen by the access mix
+   *
+   * When enabled, leaf reads and writes are sampled into small counters
+   * indexed by the NodeID of the leaf. A read-hot leaf is consolidated at
+   * half of LEAF_DELTA_CHAIN_THRESHOLD, including by the reader itself since
+   * read traversals never consolidate otherwise, and a write-hot leaf only
+   * at twice the threshold, since it would soon receive more deltas. Leaves
+   * with a balanced or little sampled mix use the threshold as it is.
+   * Decisions are counted in early_consolidation_count and
+   * deferred_consolidation_count of Statistics
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
+   */
+  void SetAdaptiveConsolidation(bool adaptive_flag) {
+    if(adaptive_flag == true && node_access_counter_p == nullptr) {
+      node_access_counter_p = \
+        new std::atomic<uint32_t>[NODE_ACCESS_COUNTER_NUM];
 
-    #else
+      for(size_t i = 0;i < NODE_ACCESS_COUNTER_NUM;i++) {
+        node_access_counter_p[i].store(0U, std::memory_order_relaxed);
+      }
+    } else if(adaptive_flag == false && node_access_counter_p != nullptr) {
+      delete[] node_access_counter_p;
 
-    LeafNode *left_most_leaf = \
-      reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
-        Get(0,
-            NodeType::LeafType,
-            0,
-            0,
-            std::make_pair(KeyType{}, INVALID_NODE_ID),
-            std::make_pair(KeyType{}, INVALID_NODE_ID)));
+      node_access_counter_p = nullptr;
+    }
 
-    #endif
+    return;
+  }
+
+  /*
+   * SetReadCacheSize() - Creates a read cache of slot_num entries in front of
+   *                      point lookups, or removes it if slot_num is 0
+   *
+   * GetValue() and VisitValue() look up the key in the cache first, and on
+   * a miss fill the cache if the key turns out to have exactly one value.
+   * Entries are invalidated by writes to their keys, so the cache never
+   * returns a value overwritten by a completed write. This removes most
+   * traversals on skewed workloads where a few keys take most reads.
+   * GetValueBatch() does not use the cache
+   *
+   * slot_num must be a power of two. The cache is direct mapped, so it
+   * should be a few times larger than the set of hot keys
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
+   */
+  void SetReadCacheSize(size_t slot_num) {
+    static_assert(std::is_trivially_copyable<KeyType>::value && \
+                  std::is_trivially_copyable<ValueType>::value,
+                  "Read cache requires trivially copyable key and value");
 
-    InstallNewNode(first_leaf_id, left_most_leaf);
+    delete read_cache_p;
+    read_cache_p = nullptr;
+
+    if(slot_num > 0UL) {
+      read_cache_p = new ReadCacheType{slot_num, key_hash_obj, key_eq_obj};
+    }
 
     return;
   }
 
   /*
-   * InitMappingTable() - Initialize the mapping table
+   * SetLeafFingerMode() - Enables or disables leaf fingers of modifications
    *
-   * It initialize all elements to NULL in order to make
-   * first CAS on the mapping table would succeed
+   * With leaf fingers, every thread remembers the leaf it last modified, and
+   * Insert(), Delete(), Update() and Upsert() start from that leaf instead
+   * of the root if the key is inside its range. This skips the inner levels
+   * entirely for threads inserting increasing keys. A full traversal is done
+   * if the key is out of range, or if the leaf needs an SMO, consolidation
+   * or a split or merge, which requires the path from the root
    *
-   * NOTE: As an optimization we do not set the mapping table to zero
-   * since installing new node could be done as directly writing into
-   * the mapping table rather than CAS with nullptr
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
    */
-  void InitMappingTable() {
-    bwt_printf("Initializing mapping table.... size = %lu\n",
-               MAPPING_TABLE_SIZE);
-    bwt_printf("Fast initialization: Do not set to zero\n");
+  void SetLeafFingerMode(bool p_leaf_finger_flag) {
+    leaf_finger_flag = p_leaf_finger_flag;
 
     return;
   }
 
   /*
-   * GetNextNodeID() - Thread-safe lock free method to get next node ID
+   * SetLeafRetryMode() - Enables or disables retries from the leaf
    *
-   * This function basically compiles to LOCK XADD instruction on x86
-   * which is guaranteed to execute atomically
+   * Normally, when the delta of Insert(), Delete() or Upsert() fails to be
+   * installed because another thread changed the leaf first, the operation
+   * traverses again from the root. With this mode the retry starts from
+   * the leaf of the failed installation if the key is still inside its
+   * range, which saves the inner levels of every retry on contended leaves
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
    */
-  inline NodeID GetNextNodeID() {
-    // This is a std::pair<bool, NodeID>
-    // If the first element is true then the NodeID is a valid one
-    // If the first element is false then NodeID is invalid and the
-    // stack is either empty or being used (we cannot lock and wait)
-    auto ret_pair = free_node_id_list.Pop();
-
-    // If there is no free node id
-    if(ret_pair.first == false) {
-      // fetch_add() returns the old value and increase the atomic
-      // automatically
-      return next_unused_node_id.fetch_add(1);
-    } else {
-      return ret_pair.second;
-    }
+  void SetLeafRetryMode(bool p_leaf_retry_flag) {
+    leaf_retry_flag = p_leaf_retry_flag;
+
+    return;
   }
 
   /*
-   * InstallNodeToReplace() - Install a node to replace a previous one
+   * SetTeardownThreadNum() - Sets the number of threads freeing nodes in
+   *                          the destructor and after Truncate()
    *
-   * If installation fails because CAS returned false, then return false
-   * This function does not retry
+   * With more than one thread, top levels of the tree are freed first, and
+   * disjoint subtrees below them are then freed in parallel, such that
+   * dropping a large tree scales with cores. Threads are started for each
+   * teardown and do not take GC IDs
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
    */
-  inline bool InstallNodeToReplace(NodeID node_id,
-                                   const BaseNode *node_p,
-                                   const BaseNode *prev_p) {
-    // Make sure node id is valid and does not exceed maximum
-    assert(node_id != INVALID_NODE_ID);
-    assert(node_id < MAPPING_TABLE_SIZE);
+  void SetTeardownThreadNum(size_t p_teardown_thread_num) {
+    assert(p_teardown_thread_num >= 1UL);
 
-    // If idb is activated, then all operation will be blocked before
-    // they could call CAS and change the key
-    #ifdef INTERACTIVE_DEBUG
-    debug_stop_mutex.lock();
-    debug_stop_mutex.unlock();
-    #endif
+    teardown_thread_num = p_teardown_thread_num;
 
-    return mapping_table[node_id].compare_exchange_strong(prev_p, node_p);
+    return;
   }
 
   /*
-   * InstallRootNode() - Replace the old root with a new one
+   * SetRTMMode() - Enables or disables the RTM fast path of leaf deltas
    *
-   * There is change that this function would fail. In that case it returns
-   * false, which implies there are some other threads changing the root ID
+   * Returns whether the mode is enabled, which is false if the tree is
+   * compiled without BWTREE_USE_RTM or if the CPU does not support RTM.
+   * In that case deltas are always installed with CAS
+   *
+   * NOTE: This function must be called when there is no other thread
+   * working on the tree
    */
-  inline bool InstallRootNode(NodeID old_root_node_id,
-                              NodeID new_root_node_id) {
-    return root_id.compare_exchange_strong(old_root_node_id,
-                                           new_root_node_id);
+  bool SetRTMMode(bool p_rtm_flag) {
+    rtm_flag = (p_rtm_flag == true) && (IsRTMSupported() == true);
+
+    return rtm_flag;
   }
 
   /*
-   * InstallNewNode() - Install a new node into the mapping table
+   * StartConsolidationThreads() - Moves delta chain consolidation into
+   *                               background threads
    *
-   * This function does not return any value since we assume new node
-   * installation would always succeed
+   * After this is called, worker threads that find a delta chain exceeding
+   * the threshold only push its NodeID into a queue, and background threads
+   * consolidate the node and perform the split that follows. Worker threads
+   * fall back to inline consolidation if the queue is full, or if the chain
+   * has grown to hard_cap_factor times the threshold
+   *
+   * Background threads use the last thread_num GC IDs, so the tree should
+   * have been set up with UpdateThreadLocal() to serve both worker threads
+   * and background threads, and worker threads must use smaller GC IDs
+   *
+   * NOTE: This function and StopConsolidationThreads() must be called when
+   * there is no other thread working on the tree
    */
-  inline void InstallNewNode(NodeID node_id,
-                             const BaseNode *node_p) {
-    mapping_table[node_id] = node_p;
+  void StartConsolidationThreads(
+    size_t thread_num,
+    int hard_cap_factor = CONSOLIDATION_HARD_CAP_FACTOR) {
+    assert(consolidation_queue_p == nullptr);
+    assert(thread_num >= 1 && thread_num < GetThreadNum());
+    assert(hard_cap_factor > 1);
+
+    // Threads still on a tree dropped by Truncate() might push its NodeIDs
+    // into the new queue
+    JoinReclaimTasks();
+
+    bwt_printf("Starting %lu consolidation threads\n", thread_num);
+
+    consolidation_queue_p = new ConsolidationQueue{};
+    consolidation_hard_cap_factor = hard_cap_factor;
+    consolidation_gc_id_start = static_cast<int>(GetThreadNum() - thread_num);
+    consolidation_exit_flag.store(false);
+
+    for(size_t i = 0;i < thread_num;i++) {
+      int thread_gc_id = consolidation_gc_id_start + static_cast<int>(i);
+
+      consolidation_thread_list.push_back(
+        new std::thread{[this, thread_gc_id]() {
+          this->ConsolidationThreadFunc(thread_gc_id);
+        }});
+    }
 
     return;
   }
 
   /*
-   * GetNode() - Return the pointer mapped by a node ID
-   *
-   * This function checks the validity of the node ID
+   * StopConsolidationThreads() - Joins background consolidation threads
+   *                              and switches back to inline consolidation
    *
-   * NOTE: This function fixes a snapshot; its counterpart using
-   * CAS instruction to install a new node creates new snapshot
-   * and the serialization order of these two atomic operations
-   * determines actual serialization order
+   * NodeIDs still in the queue are dropped. Their delta chains will be
+   * consolidated by the next worker thread traversing them
    *
-   * If we want to keep the same snapshot then we should only
-   * call GetNode() once and stick to that physical pointer
+   * This function does nothing if background consolidation is not started
    */
-  inline const BaseNode *GetNode(const NodeID node_id) {
-    assert(node_id != INVALID_NODE_ID);
-    assert(node_id < MAPPING_TABLE_SIZE);
+  void StopConsolidationThreads() {
+    if(consolidation_queue_p == nullptr) {
+      return;
+    }
 
-    return mapping_table[node_id].load();
+    consolidation_exit_flag.store(true);
+
+    for(std::thread *thread_p : consolidation_thread_list) {
+      thread_p->join();
+
+      delete thread_p;
+    }
+
+    consolidation_thread_list.clear();
+
+    // Reclaim threads might be draining the queue
+    JoinReclaimTasks();
+
+    delete consolidation_queue_p;
+    consolidation_queue_p = nullptr;
+
+    return;
   }
 
   /*
-   * Traverse() - Traverse down the tree structure, handles abort
-   *
-   * This function is implemented as a state machine that allows a thread
-   * to jump back to Init state when necessary (probably a CAS failed and
-   * it does not want to resolve it from bottom up)
-   *
-   * It stops at page level, and then the top on the context stack is a
-   * leaf level snapshot, with all SMOs, consolidation, and possibly
-   * split/remove finished
-   *
-   * NOTE: If value_p is given then this function calls NavigateLeafNode()
-   * to detect whether the desired key value pair exists or not. If value_p
-   * is nullptr then this function calls the overloaded version of
-   *  NavigateLeafNode() to collect all values associated with the key
-   * and put them into value_list_p.
+   * FreeNodeByNodeID() - Given a NodeID, free all nodes and its children
    *
-   * If value_p is not nullptr, then the return value of this function denotes
-   * whether the key-value pair exists or not. Otherwise it always return true
+   * This function returns if the mapping table entry is nullptr which implies
+   * that the NodeID has already been recycled and we should not recycle it
+   * twice.
    *
-   * In both cases, when this function returns, the top of the NodeSnapshot
-   * list is always a leaf node snapshot in which current key is included
-   * in its range.
+   * The return value represents the number of nodes recycled
    *
-   * For value_p and value_list_p, at most one of them could be non-nullptr
-   * If both are nullptr then we just traverse and do not do anything
+   * The entry is cleared with an atomic exchange, so threads freeing
+   * subtrees in parallel never free a NodeID shared by two of them twice
    */
-  const KeyValuePair *Traverse(Context *context_p,
-                               const ValueType *value_p,
-                               std::pair<int, bool> *index_pair_p) {
-
-    // For value collection it always returns nullptr
-    const KeyValuePair *found_pair_p = nullptr;
-
-retry_traverse:
-    assert(context_p->abort_flag == false);
-    assert(context_p->current_level == -1);
-
-    // This is the serialization point for reading/writing root node
-    NodeID start_node_id = root_id.load();
-    
-    // This is used to identify root nodes
-    // NOTE: We set current snapshot since in LoadNodeID() or read opt.
-    // version the parent node snapshot will be overwritten with this child
-    // node snapshot
-    //
-    // NOTE 2: We could not use GetLatestNodeSnashot() here since it checks
-    // current_level, which is -1 at this point
-    context_p->current_snapshot.node_id = INVALID_NODE_ID;
-    
-    // We need to call this even for root node since there could
-    // be split delta posted on to root node
-    LoadNodeID(start_node_id, context_p);
+  size_t FreeNodeByNodeID(NodeID node_id) {
+    assert(node_id != INVALID_NODE_ID);
+    assert(node_id < MAPPING_TABLE_SIZE);
 
-    // There could be an abort here, and we could not directly jump
-    // to Init state since we would like to do some clean up or
-    // statistics after aborting
-    if(context_p->abort_flag == true) {
-      goto abort_traverse;
+    const BaseNode *node_p = mapping_table[node_id].exchange(nullptr);
+    if(node_p == nullptr) {
+      return 0UL;
     }
 
-    bwt_printf("Successfully loading root node ID\n");
-
-    while(1) {
-      NodeID child_node_id = NavigateInnerNode(context_p);
+    return FreeNodeByPointer(node_p);
+  }
 
-      // Navigate could abort since it might go to another NodeID
-      // if there is a split delta and the key is >= split key
-      if(context_p->abort_flag == true) {
-        bwt_printf("Navigate Inner Node abort. ABORT\n");
+  /*
+   * FreeNodeByNodeID() - Frees all nodes under a NodeID, and appends the
+   *                      NodeIDs whose entries are cleared to a list
+   *
+   * Child NodeIDs are kept on an explicit stack rather than followed by
+   * recursion, such that every NodeID freed passes through here
+   */
+  size_t FreeNodeByNodeID(NodeID node_id,
+                          std::vector<NodeID> *freed_node_id_list_p) {
+    size_t freed_count = 0UL;
+    std::vector<NodeID> node_id_stack{node_id};
+
+    while(node_id_stack.empty() == false) {
+      NodeID top_node_id = node_id_stack.back();
+      node_id_stack.pop_back();
+
+      const BaseNode *node_p = mapping_table[top_node_id].exchange(nullptr);
+      if(node_p == nullptr) {
+        continue;
+      }
 
-        // If NavigateInnerNode() aborts then it retrns INVALID_NODE_ID
-        // as a double check
-        // This is the only situation that this function returns
-        // INVALID_NODE_ID
-        assert(child_node_id == INVALID_NODE_ID);
+      freed_node_id_list_p->push_back(top_node_id);
+      freed_count += FreeNodeByPointer(node_p, &node_id_stack);
+    }
 
-        goto abort_traverse;
-      }
+    return freed_count;
+  }
 
-      // This might load a leaf child
-      // Also LoadNodeID() does not guarantee the node bound matches
-      // seatch key. Since we could readjust using the split side link
-      // during Navigate...Node()
-      LoadNodeID(child_node_id, context_p);
+  /*
+   * FreeChildNodeByNodeID() - Frees the node of a NodeID referenced by a
+   *                           delta chain being freed
+   *
+   * If subtree_list_p is not nullptr then the NodeID is appended to it
+   * and left to the caller of FreeNodeByPointer()
+   */
+  inline size_t FreeChildNodeByNodeID(NodeID node_id,
+                                      std::vector<NodeID> *subtree_list_p) {
+    if(subtree_list_p == nullptr) {
+      return FreeNodeByNodeID(node_id);
+    }
 
-      if(context_p->abort_flag == true) {
-        bwt_printf("LoadNodeID aborted. ABORT\n");
+    subtree_list_p->push_back(node_id);
 
-        goto abort_traverse;
-      }
+    return 0UL;
+  }
 
-      // This is the node we have just loaded
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+  /*
+   * FreeSubtrees() - Frees all nodes under a NodeID with multiple threads
+   *
+   * Top levels are freed on the calling thread with child NodeIDs collected
+   * rather than followed, until there are TEARDOWN_SUBTREE_NUM subtrees per
+   * thread or leaves are reached. Threads then take subtrees from the list
+   * one by one and free them recursively. Subtrees are disjoint except for
+   * NodeIDs of unfinished splits, which are claimed by FreeNodeByNodeID()
+   *
+   * If recycle_flag is true then NodeIDs of freed nodes are handed to
+   * RecycleNodeIDs(), which is only safe for a tree no thread could be on.
+   * This is done after all subtrees are freed, since the NodeID of an
+   * unfinished split is reached twice, and the second visit must not find
+   * a node of the current tree that the NodeID has been reused for
+   *
+   * The return value is the number of nodes freed. This has the same
+   * requirement as FreeNodeByPointer()
+   */
+  size_t FreeSubtrees(NodeID node_id,
+                      size_t thread_num,
+                      bool recycle_flag = false) {
+    size_t freed_count = 0UL;
+    std::vector<NodeID> subtree_list{node_id};
+    std::vector<NodeID> freed_node_id_list{};
+
+    while(thread_num > 1UL && \
+          subtree_list.empty() == false && \
+          subtree_list.size() < thread_num * TEARDOWN_SUBTREE_NUM) {
+      std::vector<NodeID> next_subtree_list{};
+
+      for(NodeID subtree_id : subtree_list) {
+        const BaseNode *node_p = mapping_table[subtree_id].exchange(nullptr);
+        if(node_p == nullptr) {
+          continue;
+        }
 
-      if(snapshot_p->IsLeaf() == true) {
-        bwt_printf("The next node is a leaf\n");
+        if(recycle_flag == true) {
+          freed_node_id_list.push_back(subtree_id);
+        }
 
-        break;
+        freed_count += FreeNodeByPointer(node_p, &next_subtree_list);
       }
-    } //while(1)
 
-    if(value_p == nullptr) {
-      // We are using an iterator just to get a leaf page
-      assert(index_pair_p == nullptr);
-      
-      // If both are nullptr then we just navigate the sibling chain
-      // to find the correct node with the correct range
-      // And then the iterator will consolidate the node without actually
-      // going down with a specific key
-      NavigateSiblingChain(context_p);
-    } else {
-      // If a value is given then use this value to Traverse down leaf
-      // page to find whether the value exists or not
-      found_pair_p = NavigateLeafNode(context_p, *value_p, index_pair_p);
+      subtree_list.swap(next_subtree_list);
     }
 
-    if(context_p->abort_flag == true) {
-      bwt_printf("NavigateLeafNode() or NavigateSiblingChain()"
-                 " aborts. ABORT\n");
+    std::atomic<size_t> next_index{0UL};
+    std::atomic<size_t> subtree_freed_count{0UL};
+    std::mutex freed_node_id_lock{};
+    auto free_subtrees = [this,
+                          &subtree_list,
+                          &next_index,
+                          &subtree_freed_count,
+                          &freed_node_id_list,
+                          &freed_node_id_lock,
+                          recycle_flag]() {
+      size_t count = 0UL;
+      std::vector<NodeID> local_freed_node_id_list{};
+
+      for(size_t i = next_index.fetch_add(1UL);
+          i < subtree_list.size();
+          i = next_index.fetch_add(1UL)) {
+        if(recycle_flag == true) {
+          count += FreeNodeByNodeID(subtree_list[i],
+                                    &local_freed_node_id_list);
+        } else {
+          count += FreeNodeByNodeID(subtree_list[i]);
+        }
+      }
 
-      goto abort_traverse;
-    }
+      if(recycle_flag == true) {
+        std::lock_guard<std::mutex> guard{freed_node_id_lock};
 
-    #ifdef BWTREE_DEBUG
-    
-    bwt_printf("Found leaf node. Abort count = %d, level = %d\n",
-               context_p->abort_counter,
-               context_p->current_level);
-               
-    #endif
+        freed_node_id_list.insert(freed_node_id_list.end(),
+                                  local_freed_node_id_list.begin(),
+                                  local_freed_node_id_list.end());
+      }
 
-    // If there is no abort then we could safely return
-    return found_pair_p;
+      subtree_freed_count.fetch_add(count);
+    };
 
-abort_traverse:
-    #ifdef BWTREE_DEBUG
-    
-    assert(context_p->current_level >= 0);
+    // The calling thread is one of the threads
+    std::vector<std::thread> thread_list{};
+    for(size_t i = 1;i < std::min(thread_num, subtree_list.size());i++) {
+      thread_list.emplace_back(free_subtrees);
+    }
 
-    context_p->current_level = -1;
-    
-    context_p->abort_counter++;
-    
-    #endif
-    
-    // This is used to identify root node
-    context_p->current_snapshot.node_id = INVALID_NODE_ID;
+    free_subtrees();
 
-    context_p->abort_flag = false;
+    for(std::thread &thread : thread_list) {
+      thread.join();
+    }
 
-    goto retry_traverse;
+    if(recycle_flag == true) {
+      RecycleNodeIDs(&freed_node_id_list);
+    }
 
-    assert(false);
-    return nullptr;
+    return freed_count + subtree_freed_count.load();
   }
 
-  ///////////////////////////////////////////////////////////////////
-  // Data Storage Core
-  ///////////////////////////////////////////////////////////////////
-  
   /*
-   * NavigateSiblingChain() - Traverse on sibling chain to adjust current
-   *                          position so that the range of the node matches
-   *                          the search key
+   * InvalidateNodeID() - Recycle NodeID
    *
-   * This function detects node range using the topmost node's high key
-   * since it is guaranteed that topmost high key is always the correct
-   * high key for us to use
+   * This function is called when a NodeID has been invalidated due to a
+   * node removal and it is guaranteed that the NodeID will not be used
+   * anymore by any thread. This usually happens in the epoch manager
    *
-   * NOTE: This function cannot traverse to a sibling node of a different
-   * parent node than the current parent node, because we also do
-   * a key range validation on the parent node, it is impossible that the
-   * parent node contains a child node whose range is outside the parent
-   * node's range. Therefore when posting on the parent node there is no need
-   * for us to validate key range.
+   * Even if NodeIDs are not recycled (e.g. the counter monotonically increase)
+   * this is necessary for destroying the tree since we want to avoid deleting
+   * a removed node in InnerNode
    *
-   * If the traverse aborts then this function returns with abort_flag
-   * setting to true.
+   * NOTE: This function only works in a single-threaded environment such
+   * as epoch manager and destructor
+   *
+   * DO NOT call this in worker thread!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
    */
-  void NavigateSiblingChain(Context *context_p) {
-    do {
-      // These two will be updated everytime we switch to
-      // a new node
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-      const BaseNode *node_p = snapshot_p->node_p;
-      
-      // Before node navigation, the first thing to do is to verify
-      // that we are on the correct node according to the current
-      // search key
-      // This procedure does not necessarily need a split node to do right
-      // traversal (but it needs to complete any SMO if there is one, so
-      // it must be called after FinishPartialSMO() returns), because
-      // the high key of split node will be inherited by all nodes
-      // posted later and by the consolidated version of the node
-      if((node_p->GetNextNodeID() != INVALID_NODE_ID) &&
-         (KeyCmpGreaterEqual(context_p->search_key, node_p->GetHighKey()))) {
-        bwt_printf("Bounds checking failed (id = %lu) - "
-                   "Go right.\n",
-                   snapshot_p->node_id);
-
-        JumpToNodeID(node_p->GetNextNodeID(), context_p);
-
-        if(context_p->abort_flag == true) {
-          bwt_printf("JumpToNodeID aborts(). ABORT\n");
-
-          return;
-        }
+  inline void InvalidateNodeID(NodeID node_id) {
+    mapping_table[node_id] = nullptr;
 
-      } else {
-        break;
-      }
-    } while(1);
-    
-    return;
-  }
-  
-  /*
-   * NavigateSiblingChainBI() - Navigates sibling chain for backward iteration
-   *
-   * This function traverses to the right sibling of the current node only if
-   * the search key > current high key. In the case of search key == high key
-   * we stay on the same node to enable finding the left node of the node with
-   * the search key as low key
-   */
-  void NavigateSiblingChainBI(Context *context_p) {
-    while(1) {
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-      const BaseNode *node_p = snapshot_p->node_p;
-      if((node_p->GetNextNodeID() != INVALID_NODE_ID) &&
-         (KeyCmpGreater(context_p->search_key, node_p->GetHighKey()))) {
-        bwt_printf("Bounds checking for BI failed (id = %lu) - "
-                   "Go right.\n",
-                   snapshot_p->node_id);
+    // Next time if we need a node ID we just push back from this
+    //free_node_id_list.SingleThreadPush(node_id);
 
-        JumpToNodeID(node_p->GetNextNodeID(), context_p);
-        if(context_p->abort_flag == true) {
-          bwt_printf("JumpToNodeID() aborts for BI. ABORT\n");
-          return;
-        }
-      } else {
-        break;
-      }
-    } // while(1)
-    
     return;
   }
 
   /*
-   * LocateSeparatorByKey() - Locate the child node for a key
-   *
-   * This functions works with any non-empty inner nodes. However
-   * it fails assertion with empty inner node
+   * FreeNodeByPointer() - Free all nodes currently in the tree
    *
-   * NOTE: This function ignores the first element in the sep list
-   * since even if we know the low key of the first element
-   */
-  inline NodeID LocateSeparatorByKey(const KeyType &search_key,
-                                     const InnerNode *inner_node_p,
-                                     const KeyNodeIDPair *start_p,
-                                     const KeyNodeIDPair *end_p) {
-    // Inner node could not be empty
-    assert(inner_node_p->GetSize() != 0UL);
-
-    // Hopefully std::upper_bound would use binary search here
-    auto it = std::upper_bound(start_p,
-                               end_p,
-                               std::make_pair(search_key, INVALID_NODE_ID),
-                               key_node_id_pair_cmp_obj) - 1;
-#ifdef BWTREE_DEBUG
-    //auto it2 = std::upper_bound(inner_node_p->Begin() + 1,
-    //                           inner_node_p->End(),
-    //                           std::make_pair(search_key, INVALID_NODE_ID),
-    //                           key_node_id_pair_cmp_obj) - 1;
-                               
-    //assert(it == it2);
-#endif
-
-    // Since upper_bound returns the first element > given key
-    // so we need to decrease it to find the last element <= given key
-    // which is out separator key
-    return it->second;
-  }
-  
-  /*
-   * LocateSeparatorByKeyBI() - Same as locate separator by key but it 
-   *                            goes left when we see the selected separator
-   *                            being the search key
+   * For normal destruction, we do not accept InnerAbortNode,
+   * InnerRemoveNode, and LeafRemoveNode, since these three types
+   * only appear as temporary states, and must be completed before
+   * a thread could finish its job and exit (after posting remove delta
+   * the thread always aborts and restarts traversal from the root)
    *
-   * This function guarantees to find a left key if we see the separator
-   * being the search key. This is because if there is not a left key then we
-   * we must have come down from a node where the search key is its separator
-   * key (remember that the separator key is the low key of ots child node)
-   */
-  inline NodeID LocateSeparatorByKeyBI(const KeyType &search_key,
-                                       const InnerNode *inner_node_p) {
-    assert(inner_node_p->GetSize() != 0UL);
-    auto it = std::upper_bound(inner_node_p->Begin() + 1,
-                               inner_node_p->End(),
-                               std::make_pair(search_key, INVALID_NODE_ID),
-                               key_node_id_pair_cmp_obj) - 1;
-
-    if(KeyCmpEqual(it->first, search_key) == true) {
-      // If search key is the low key then we know we should have already
-      // gone left on the parent node
-      assert(it != inner_node_p->Begin());
-      
-      // Go to the left separator to find the left node with range < search key
-      // After decreament it might or might not be the low key
-      it--; 
-    }
-    
-    return it->second;
-  }
-
-  /*
-   * NavigateInnerNode() - Traverse down through the inner node delta chain
-   *                       and probably horizontally to right sibling nodes
+   * NOTE: Do not confuse this function with FreeEpochDeltaChain
+   * in EpochManager. These two functions differs in details (see above)
+   * and could not be used interchangeably.
    *
-   * This function does not have to always reach the base node in order to
-   * find the target since we know for inner nodes it is always single key
-   * single node mapping. Therefore there is neither need to keep a delta
-   * pointer list to recover full key-value mapping, nor returning a base node
-   * pointer to test low key and high key.
+   * NOTE 2: This function should only be called in single threaded
+   * environment since it assumes sole ownership of the entire tree
+   * This is trivial during normal destruction, but care must be taken
+   * when this is not true.
    *
-   * However, if we have reached a base node, for debugging purposes we
-   * need to test current search key against low key and high key
+   * NOTE 3: This function does not consider InnerAbortNode, InnerRemoveNode
+   * and LeafRemoveNode as valid, since these three are just temporary nodes,
+   * and should not exist if a thread finishes its job (for remove nodes they
+   * must be removed after posting InnerDeleteNode, which should be done by
+   * the thread posting remove delta or other threads helping-along)
    *
-   * NOTE: This function returns a NodeID, instead of NodeSnapshot since
-   * its behaviour is not dependent on the actual content of the physical
-   * pointer associated with the node ID, so we could choose to fix the
-   * snapshot later
+   * This node calls destructor according to the type of the node, considering
+   * that there is not virtual destructor defined for sake of running speed.
    *
-   * NOTE: This function will jump to a sibling if the current node is on
-   * a half split state. If this happens, then the flag inside snapshot_p
-   * is set to true, and also the corresponding NodeId and BaseNode *
-   * will be updated to reflect the newest sibling ID and pointer.
-   * After returning of this function please remember to check the flag
-   * and update path history. (Such jump may happen multiple times, so
-   * do not make any assumption about how jump is performed)
+   * If subtree_list_p is not nullptr then only this delta chain is freed,
+   * and NodeIDs of child nodes and split siblings are appended to the list
+   * (see FreeSubtrees())
    */
-  NodeID NavigateInnerNode(Context *context_p) {
-    // This will go to the right sibling until we have seen
-    // a node whose range match the search key
-    NavigateSiblingChain(context_p);
+  size_t FreeNodeByPointer(const BaseNode *node_p,
+                           std::vector<NodeID> *subtree_list_p = nullptr) {
+    const BaseNode *next_node_p = node_p;
+    size_t freed_count = 0;
 
-    // If navigating sibling chain aborts then abort here
-    if(unlikely(context_p->abort_flag == true)) {
-      return INVALID_NODE_ID;
-    }
-    
-    /////////////////////////////////////////////////////////////////
-    // Only after this point could we get snapshot and node_p
-    /////////////////////////////////////////////////////////////////
-    
-    // This search key will not be changed during navigation
-    const KeyType &search_key = context_p->search_key;
+    while(1) {
+      node_p = next_node_p;
+      assert(node_p != nullptr);
 
-    // First get the snapshot from context
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+      NodeType type = node_p->GetType();
 
-    // Save some keystrokes
-    const BaseNode *node_p = snapshot_p->node_p;
+      switch(type) {
+        case NodeType::LeafInsertType:
+          next_node_p = ((LeafInsertNode *)node_p)->child_node_p;
 
-    // Make sure the structure is valid
-    assert(snapshot_p->IsLeaf() == false);
-    assert(snapshot_p->node_p != nullptr);
-    
-    // For read only workload this is always true since we do not need
-    // to remember the node ID for read - read is always stateless until
-    // it has reached a leaf node
-    assert(snapshot_p->node_id != INVALID_NODE_ID);
+          ((LeafInsertNode *)node_p)->~LeafInsertNode();
+          freed_count++;
 
-    bwt_printf("Navigating inner node delta chain...\n");
-    
-    // Always start with the first element
-    const KeyNodeIDPair *start_p = \
-      InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->Begin() + 1;
-    // Use low key pair to find base node and then use base node pointer to find
-    // total number of elements in the array. We search in this array later
-    const KeyNodeIDPair *end_p = \
-      InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->End();
+          break;
+        case NodeType::LeafDeleteType:
+          next_node_p = ((LeafDeleteNode *)node_p)->child_node_p;
 
-    while(1) {
-      NodeType type = node_p->GetType();
+          ((LeafDeleteNode *)node_p)->~LeafDeleteNode();
 
-      switch(type) {
-        case NodeType::InnerType: {
-          const InnerNode *inner_node_p = \
-            static_cast<const InnerNode *>(node_p);
+          break;
+        case NodeType::LeafUpdateType:
+          next_node_p = ((LeafUpdateNode *)node_p)->child_node_p;
 
-          // We always use the ubound recorded inside the top of the
-          // delta chain
-          NodeID target_id = \
-            LocateSeparatorByKey(search_key, 
-                                 inner_node_p, 
-                                 start_p, 
-                                 end_p);
+          ((LeafUpdateNode *)node_p)->~LeafUpdateNode();
+          freed_count++;
 
-          bwt_printf("Found child in inner node; child ID = %lu\n",
-                     target_id);
+          break;
+        case NodeType::LeafBatchInsertType:
+          next_node_p = ((LeafBatchInsertNode *)node_p)->child_node_p;
 
-          return target_id;
-        } // case InnerType
-        case NodeType::InnerInsertType: {
-          const InnerInsertNode *insert_node_p = \
-            static_cast<const InnerInsertNode *>(node_p);
+          ((LeafBatchInsertNode *)node_p)->~LeafBatchInsertNode();
+          freed_count++;
 
-          const KeyNodeIDPair &insert_item = insert_node_p->item;
-          const KeyNodeIDPair &next_item = insert_node_p->next_item;
+          break;
+        case NodeType::LeafDeleteRangeType:
+          next_node_p = ((LeafDeleteRangeNode *)node_p)->child_node_p;
 
-          // This comparison servers two purposes:
-          //   1. Check whether we could use it to do a quick jump
-          //   2. Update start_index or end_index depending on the 
-          //      result of comparison
-          if(KeyCmpGreaterEqual(search_key, insert_item.first)) {
-            if((next_item.second == INVALID_NODE_ID) ||
-               (KeyCmpLess(search_key, next_item.first))) {
-              bwt_printf("Find target ID = %lu in insert delta\n",
-                         insert_item.second);
+          ((LeafDeleteRangeNode *)node_p)->~LeafDeleteRangeNode();
 
-              return insert_item.second;
-            }
-            
-            start_p = std::max(start_p, insert_node_p->location);
-          } else {
-            end_p = std::min(end_p, insert_node_p->location);
-          }
-          
           break;
-        } // InnerInsertType
-        case NodeType::InnerDeleteType: {
-          const InnerDeleteNode *delete_node_p = \
-            static_cast<const InnerDeleteNode *>(node_p);
+        case NodeType::LeafSplitType:
+          next_node_p = ((LeafSplitNode *)node_p)->child_node_p;
 
-          const KeyNodeIDPair &prev_item = delete_node_p->prev_item;
-          const KeyNodeIDPair &next_item = delete_node_p->next_item;
+          freed_count += \
+            FreeChildNodeByNodeID( \
+              ((LeafSplitNode *)node_p)->insert_item.second,
+              subtree_list_p);
 
-          // NOTE: Low key ID will not be changed (i.e. being deleted or
-          // being preceded by other key-NodeID pair)
-          // If the prev item is the leftmost item then we do not need to
-          // compare since we know the search key is definitely greater than
-          // or equal to the low key (this is necessary to prevent comparing
-          // with -Inf)
-          // NOTE: Even if the inner node is merged into its left sibling
-          // this is still true since we compared prev_item.second
-          // with the low key of the current delete node which always
-          // reflects the low key of this branch
-          if((delete_node_p->GetLowKeyNodeID() == prev_item.second) ||
-             (KeyCmpGreaterEqual(search_key, prev_item.first))) {
-            // If the next item is +Inf key then we also choose not to compare
-            // keys directly since we know the search key is definitely smaller
-            // then +Inf
-            if((next_item.second == INVALID_NODE_ID) ||
-               (KeyCmpLess(search_key, next_item.first))) {
-              bwt_printf("Find target ID = %lu in delete delta\n",
-                         prev_item.second);
+          ((LeafSplitNode *)node_p)->~LeafSplitNode();
+          freed_count++;
 
-              return prev_item.second;
-            }
+          break;
+        case NodeType::LeafMergeType: {
+          // The merge node lives in the chunk of the right branch, so it is
+          // destroyed before branches are freed
+          const BaseNode *child_node_p = \
+            ((LeafMergeNode *)node_p)->child_node_p;
+          const BaseNode *right_merge_p = \
+            ((LeafMergeNode *)node_p)->right_merge_p;
+
+          ((LeafMergeNode *)node_p)->~LeafMergeNode();
+          freed_count++;
+
+          freed_count += FreeNodeByPointer(child_node_p, subtree_list_p);
+          freed_count += FreeNodeByPointer(right_merge_p, subtree_list_p);
+
+          // Leaf merge node is an ending node
+          return freed_count;
+        } // case LeafMergeType
+        case NodeType::LeafType:
+          // A leaf pinned by an iterator is freed by the last Unpin()
+          if(((LeafNode *)node_p)->Retire() == true) {
+            // Call destructor first, and then call Destroy() on its
+            // preallocated linked list of chunks
+            ((LeafNode *)node_p)->~LeafNode();
+          
+            // Free the memory
+            ((LeafNode *)node_p)->Destroy();
           }
           
-          // Use the deleted key to do a divide - all keys less than
-          // it is on the left of the index recorded in this InnerInsertNode
-          // Otherwise it is to the right of it
-          if(KeyCmpGreaterEqual(search_key, delete_node_p->item.first) == true) {
-            start_p = std::max(delete_node_p->location, start_p);
-          } else {
-            end_p = std::min(delete_node_p->location, end_p);
-          } 
+          freed_count++;
+
+          // We have reached the end of delta chain
+          return freed_count;
+        case NodeType::LeafCompressedType:
+          ((CompressedLeafNode *)node_p)->~CompressedLeafNode();
+          ((CompressedLeafNode *)node_p)->Destroy();
+
+          freed_count++;
+
+          return freed_count;
+        case NodeType::InnerInsertType:
+          next_node_p = ((InnerInsertNode *)node_p)->child_node_p;
+
+          freed_count += \
+            FreeChildNodeByNodeID(((InnerInsertNode *)node_p)->item.second,
+                                  subtree_list_p);
+
+          ((InnerInsertNode *)node_p)->~InnerInsertNode();
+          freed_count++;
 
           break;
-        } // InnerDeleteType
-        case NodeType::InnerSplitType: {
+        case NodeType::InnerDeleteType:
+          next_node_p = ((InnerDeleteNode *)node_p)->child_node_p;
+
+          // For those already deleted, the delta chain has been merged
+          // and the remove node should be freed (either before this point
+          // or will be freed) epoch manager
+          // NOTE: No need to call InvalidateNodeID since this function is
+          // only called on destruction of the tree
+          mapping_table[((InnerDeleteNode *)node_p)->item.second] = \
+            nullptr;
+
+          ((InnerDeleteNode *)node_p)->~InnerDeleteNode();
+          freed_count++;
+
+          break;
+        case NodeType::InnerSplitType:
+          next_node_p = ((InnerSplitNode *)node_p)->child_node_p;
+
+          freed_count += \
+            FreeChildNodeByNodeID( \
+              ((LeafSplitNode *)node_p)->insert_item.second,
+              subtree_list_p);
+
+          ((InnerSplitNode *)node_p)->~InnerSplitNode();
+          freed_count++;
+
           break;
-        } // case InnerSplitType
         case NodeType::InnerMergeType: {
-          const InnerMergeNode *merge_node_p = \
-            static_cast<const InnerMergeNode *>(node_p);
+          const BaseNode *child_node_p = \
+            ((InnerMergeNode *)node_p)->child_node_p;
+          const BaseNode *right_merge_p = \
+            ((InnerMergeNode *)node_p)->right_merge_p;
 
-          const KeyType &merge_key = merge_node_p->delete_item.first;
+          ((InnerMergeNode *)node_p)->~InnerMergeNode();
+          freed_count++;
 
-          // Here since we will only take one branch, so
-          // high key does not need to be updated
-          // Since we still could not know the high key
-          if(KeyCmpGreaterEqual(search_key, merge_key)) {
-            bwt_printf("Take merge right branch (ID = %lu)\n",
-                       snapshot_p->node_id);
+          freed_count += FreeNodeByPointer(child_node_p, subtree_list_p);
+          freed_count += FreeNodeByPointer(right_merge_p, subtree_list_p);
 
-            node_p = merge_node_p->right_merge_p;
-          } else {
-            bwt_printf("Take merge left branch (ID = %lu)\n",
-                       snapshot_p->node_id);
+          return freed_count;
+        } // case InnerMergeType
+        case NodeType::InnerType: {
+          const InnerNode *inner_node_p = \
+            static_cast<const InnerNode *>(node_p);
 
-            node_p = merge_node_p->child_node_p;
+          // Free NodeID one by one stored in its separator list
+          // Even if they are already freed (e.g. a split delta has not
+          // been consolidated would share a NodeID with its parent)
+          for(auto it = inner_node_p->Begin();
+              it != inner_node_p->End();
+              it++) {
+            freed_count += FreeChildNodeByNodeID(it->second, subtree_list_p);
           }
+
+          inner_node_p->~InnerNode();
+          inner_node_p->Destroy();
           
-          // Since all indices are not invalidated, we do not know on which
-          // branch it is referring to
-          // After this point node_p has been updated as the newest branch we 
-          // are travelling on
-          start_p = \
-            InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->Begin() + 1;
-          end_p = \
-            InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->End();
+          
+          freed_count++;
 
-          // Note that we should jump to the beginning of the loop without 
-          // going to child node any further
-          continue;
-        } // InnerMergeType
-        default: {
-          bwt_printf("ERROR: Unknown node type = %d",
-                     static_cast<int>(type));
+          // Since we free nodes recursively, after processing an inner
+          // node and recursively with its child nodes we could return here
+          return freed_count;
+        }
+        default:
+          // For InnerAbortNode, InnerRemoveNode and LeafRemoveNode
+          // they are supposed to be removed as part of any operation on
+          // the tree (i.e. they could not be left behind once a operation
+          // has been finished)
+          bwt_printf("Unknown node type: %d\n", (int)type);
 
           assert(false);
-        }
-      } // switch type
-      
-      node_p = static_cast<const DeltaNode *>(node_p)->child_node_p; 
+          return 0;
+      } // switch
     } // while 1
 
-    // Should not reach here
     assert(false);
-    return INVALID_NODE_ID;
+    return 0;
   }
-  
+
   /*
-   * NavigateInnerNodeBI() - Traverses an InnerNode for backward iteration
+   * GetDeltaChainMemorySize() - Returns the bytes allocated for a delta chain
    *
-   * This function serves the same purpose as NavigateInnerNode() in a sense
-   * that it also traverses down the delta chain of an InnerNode and returns 
-   * an next level NodeID for later traversal.
-   *
-   * The difference between this function and NavigateInnerNode() is that
-   * this function will go left even if the search key is found. Similarly
-   * if the key happens to be the merge key in InnerMergeNode, we just take
-   * the left branch to avoid ending up in the node with low key == search key
+   * Delta nodes live in the chunks of the base node below them, so this
+   * counts the base nodes, following both branches of merge deltas. Remove
+   * and abort deltas are allocated separately and are counted as well.
+   * Split siblings are not counted, since they belong to another NodeID
    */
-  NodeID NavigateInnerNodeBI(Context *context_p) {
-    NavigateSiblingChainBI(context_p);
-    if(context_p->abort_flag == true) {
-      return INVALID_NODE_ID;
-    }
-    
-    const KeyType &search_key = context_p->search_key;
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-    const BaseNode *node_p = snapshot_p->node_p;
+  size_t GetDeltaChainMemorySize(const BaseNode *node_p) const {
+    size_t size = 0UL;
 
-    assert(snapshot_p->IsLeaf() == false);
-    assert(snapshot_p->node_p != nullptr);
-    bwt_printf("Navigating inner node delta chain for BI...\n");
+    while(node_p->IsDeltaNode() == true) {
+      switch(node_p->GetType()) {
+        case NodeType::LeafRemoveType:
+          size += sizeof(LeafRemoveNode);
+          break;
+        case NodeType::InnerRemoveType:
+          size += sizeof(InnerRemoveNode);
+          break;
+        case NodeType::InnerAbortType:
+          size += sizeof(InnerAbortNode);
+          break;
+        case NodeType::LeafMergeType:
+          size += GetDeltaChainMemorySize( \
+            static_cast<const LeafMergeNode *>(node_p)->right_merge_p);
+          break;
+        case NodeType::InnerMergeType:
+          size += GetDeltaChainMemorySize( \
+            static_cast<const InnerMergeNode *>(node_p)->right_merge_p);
+          break;
+        default:
+          break;
+      }
 
-    while(1) {
-      NodeType type = node_p->GetType();
+      node_p = static_cast<const DeltaNode *>(node_p)->child_node_p;
+    }
 
-      switch(type) {
-        case NodeType::InnerType: {
-          NodeID target_id = \
-            LocateSeparatorByKeyBI(search_key, 
-                                    static_cast<const InnerNode *>(node_p));
+    if(node_p->GetType() == NodeType::LeafCompressedType) {
+      return size + \
+             static_cast<const CompressedLeafNode *>(node_p)->\
+               GetAllocationSize();
+    }
 
-          bwt_printf("Found child in inner node (BI); child ID = %lu\n",
-                     target_id);
+    if(node_p->IsOnLeafDeltaChain() == true) {
+      const LeafNode *leaf_node_p = static_cast<const LeafNode *>(node_p);
+      size_t extra_size = 0UL;
 
-          return target_id;
-        } 
-        case NodeType::InnerInsertType: {
-          const InnerInsertNode *insert_node_p = \
-            static_cast<const InnerInsertNode *>(node_p);
+      if(leaf_node_p->GetSearchIndex() != nullptr) {
+        extra_size = GetLeafFingerprintSize(leaf_node_p->GetItemCount());
+      }
 
-          const KeyNodeIDPair &insert_item = insert_node_p->item;
-          const KeyNodeIDPair &next_item = insert_node_p->next_item;
-          if((next_item.second == INVALID_NODE_ID) ||
-             (KeyCmpLess(search_key, next_item.first))) {
-               
-            // *********************************************
-            // * NOTE: DO NOT PROCEED IF IT IS "==" RELATION
-            // *********************************************
-            
-            if(KeyCmpGreater(search_key, insert_item.first)) {
-              bwt_printf("Find target ID = %lu in insert delta (BI)\n",
-                         insert_item.second);
+      return size + leaf_node_p->GetMemorySize(extra_size);
+    }
 
-              return insert_item.second;
-            }
-          }
+    const InnerNode *inner_node_p = static_cast<const InnerNode *>(node_p);
+    size_t extra_size = 0UL;
 
-          node_p = insert_node_p->child_node_p;
+    if(inner_node_p->GetSearchIndex() != nullptr) {
+      extra_size = GetInnerSearchIndexSize(inner_node_p->GetItemCount());
+    }
 
-          break;
-        } // InnerInsertType
-        case NodeType::InnerDeleteType: {
-          const InnerDeleteNode *delete_node_p = \
-            static_cast<const InnerDeleteNode *>(node_p);
+    return size + inner_node_p->GetMemorySize(extra_size);
+  }
 
-          const KeyNodeIDPair &prev_item = delete_node_p->prev_item;
-          const KeyNodeIDPair &next_item = delete_node_p->next_item;
+  /*
+   * GetBaseNodeAllocationSize() - Returns the bytes allocated for a base node
+   *
+   * This excludes chunks grown after the node is allocated, which are
+   * counted into node_memory_size when they are grown
+   */
+  static size_t GetBaseNodeAllocationSize(const BaseNode *node_p) {
+    switch(node_p->GetType()) {
+      case NodeType::LeafType: {
+        const LeafNode *leaf_node_p = static_cast<const LeafNode *>(node_p);
+        size_t extra_size = 0UL;
+
+        if(leaf_node_p->GetSearchIndex() != nullptr) {
+          extra_size = GetLeafFingerprintSize(leaf_node_p->GetItemCount());
+        }
 
-          // *********************************************
-          // * NOTE: DO NOT PROCEED IF IT IS "==" RELATION
-          // *********************************************
+        return leaf_node_p->GetAllocationSize(extra_size);
+      }
+      case NodeType::LeafCompressedType:
+        return GetNodeAllocationSize( \
+                 static_cast<const CompressedLeafNode *>(node_p));
+      case NodeType::InnerType: {
+        const InnerNode *inner_node_p = static_cast<const InnerNode *>(node_p);
+        size_t extra_size = 0UL;
 
-          if((delete_node_p->GetLowKeyNodeID() == prev_item.second) ||
-             (KeyCmpGreater(search_key, prev_item.first))) {
-            if((next_item.second == INVALID_NODE_ID) ||
-               (KeyCmpLess(search_key, next_item.first))) {
-              bwt_printf("Find target ID = %lu in delete delta (BI)\n",
-                         prev_item.second);
+        if(inner_node_p->GetSearchIndex() != nullptr) {
+          extra_size = GetInnerSearchIndexSize(inner_node_p->GetItemCount());
+        }
 
-              return prev_item.second;
-            }
-          }
+        return inner_node_p->GetAllocationSize(extra_size);
+      }
+      default:
+        assert(false);
+        return 0UL;
+    }
+  }
 
-          node_p = delete_node_p->child_node_p;
+  /*
+   * GetNodeAllocationSize() - Returns the bytes allocated for a single node
+   *
+   * Delta types are resolved first, such that only base nodes are cast to
+   * ElasticNode or CompressedLeafNode
+   */
+  static size_t GetNodeAllocationSize(const BaseNode *node_p) {
+    if(node_p->IsDeltaNode() == false) {
+      return GetBaseNodeAllocationSize(node_p);
+    }
 
-          break;
-        } // InnerDeleteType
-        case NodeType::InnerSplitType: {
-          node_p = static_cast<const InnerSplitNode *>(node_p)->child_node_p;
-          break;
-        } // case InnerSplitType
-        case NodeType::InnerMergeType: {
-          const InnerMergeNode *merge_node_p = \
-            static_cast<const InnerMergeNode *>(node_p);
+    switch(node_p->GetType()) {
+      case NodeType::LeafRemoveType:
+        return sizeof(LeafRemoveNode);
+      case NodeType::InnerRemoveType:
+        return sizeof(InnerRemoveNode);
+      case NodeType::InnerAbortType:
+        return sizeof(InnerAbortNode);
+      default:
+        // Other delta nodes live in the chunks of their base node
+        return 0UL;
+    }
+  }
 
-          const KeyType &merge_key = merge_node_p->delete_item.first;
+  /*
+   * GetNodeAllocationSize() - Overloads for nodes whose type is known
+   *
+   * Remove and abort nodes are much smaller than base nodes, so the base
+   * node casts above must not be reachable from where they are allocated
+   */
+  static size_t GetNodeAllocationSize(const LeafRemoveNode *) {
+    return sizeof(LeafRemoveNode);
+  }
 
-          // ************************************************
-          // * NOTE: GO TO LEFT BRANCH IF IT IS "==" RELATION
-          // ************************************************
+  static size_t GetNodeAllocationSize(const InnerRemoveNode *) {
+    return sizeof(InnerRemoveNode);
+  }
 
-          if(KeyCmpGreater(search_key, merge_key)) {
-            bwt_printf("Take merge right branch (ID = %lu) for BI\n",
-                       snapshot_p->node_id);
+  static size_t GetNodeAllocationSize(const InnerAbortNode *) {
+    return sizeof(InnerAbortNode);
+  }
 
-            node_p = merge_node_p->right_merge_p;
-          } else {
-            bwt_printf("Take merge left branch (ID = %lu) for BI\n",
-                       snapshot_p->node_id);
+  static size_t GetNodeAllocationSize(const CompressedLeafNode *node_p) {
+    return node_p->GetAllocationSize();
+  }
 
-            node_p = merge_node_p->child_node_p;
-          }
+  /*
+   * GetGarbageMemorySize() - Returns the bytes freed by FreeEpochDeltaChain()
+   *                          on the given node
+   *
+   * This follows the same path as FreeEpochDeltaChain(), i.e. it stops at
+   * remove and abort nodes and follows both branches of merge nodes
+   */
+  size_t GetGarbageMemorySize(const BaseNode *node_p) const {
+    size_t size = 0UL;
 
+    while(node_p->IsDeltaNode() == true) {
+      switch(node_p->GetType()) {
+        case NodeType::LeafRemoveType:
+        case NodeType::InnerRemoveType:
+        case NodeType::InnerAbortType:
+          return size + GetNodeAllocationSize(node_p);
+        case NodeType::LeafMergeType:
+          size += GetGarbageMemorySize( \
+            static_cast<const LeafMergeNode *>(node_p)->right_merge_p);
           break;
-        } // InnerMergeType
-        default: {
-          bwt_printf("ERROR: Unknown or unsupported node type = %d",
-                     static_cast<int>(type));
+        case NodeType::InnerMergeType:
+          size += GetGarbageMemorySize( \
+            static_cast<const InnerMergeNode *>(node_p)->right_merge_p);
+          break;
+        default:
+          break;
+      }
 
-          assert(false);
-        }
-      } // switch type
-    } // while 1
+      node_p = static_cast<const DeltaNode *>(node_p)->child_node_p;
+    }
 
-    // Should not reach here
-    assert(false);
-    return INVALID_NODE_ID;
+    return size + GetDeltaChainMemorySize(node_p);
   }
 
   /*
-   * CollectAllSepsOnInner() - Collect all separators given a snapshot
-   *
-   * This function consolidates a given delta chain given the node snapshot.
-   * Consolidation takes place by using a deleted set and present set to record
-   * values already deleted and still exist in the current node, to achieve
-   * the same effect as a log replay.
+   * RecordInstalledNode() - Counts a node allocated outside of delta chunks
+   *                         that has been published in the mapping table
    *
-   * This function returns an inner node with all Key-NodeID pairs
-   * sorted by the key order
+   * The static type of the node picks the GetNodeAllocationSize() overload
+   */
+  template <typename InstalledNodeType>
+  inline void RecordInstalledNode(const InstalledNodeType *node_p) {
+    node_memory_size.fetch_add( \
+      static_cast<int64_t>(GetNodeAllocationSize(node_p)),
+      std::memory_order_relaxed);
+
+    return;
+  }
+
+  /*
+   * InitNodeLayout() - Initialize the nodes required to start BwTree
    *
-   * NOTE: This function could take an optional depth argument indicating the
-   * depth of the newly constructed InnerNode. This is majorly used by other
-   * proceures where parent node is consolidated and scanned in order to find
-   * a certain key.
+   * We need at least a root inner node and a leaf node in order
+   * to guide the first operation to the right place
    */
-  InnerNode *CollectAllSepsOnInner(NodeSnapshot *snapshot_p,
-                                   int p_depth = 0) {
+  void InitNodeLayout() {
+    bwt_printf("Initializing node layout for root and first page...\n");
 
-    // Note that in the recursive call node_p might change
-    // but we should not change the metadata
-    const BaseNode *node_p = snapshot_p->node_p;
+    // The constructing thread might not have a GC ID, so these two are
+    // taken from the shared counter directly
+    root_id = ReserveNodeIDs(1);
+    assert(root_id == 1UL);
 
-    // This is the number of insert + delete records which contributes
-    // to the size of the bloom filter
-    int delta_record_num = node_p->GetDepth();
+    // Iterators start from the first leaf, which is NodeID = 2 until the
+    // tree is truncated
+    first_leaf_id = ReserveNodeIDs(1);
+    assert(first_leaf_id == FIRST_LEAF_NODE_ID);
 
-    // This array will hold sorted InnerDataNode pointers in order to
-    // perform a log merging
-    const InnerDataNode *data_node_list[delta_record_num];
+    InstallEmptyLayout(root_id.load(), first_leaf_id.load());
 
-    // These two are used to compare InnerDataNode for < and == relation
-    auto f1 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
-                      return this->key_cmp_obj(idn_1->item.first, idn_2->item.first);
-                    };
+    return;
+  }
 
-    auto f2 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
-                      return this->key_eq_obj(idn_1->item.first, idn_2->item.first);
-                    };
+  /*
+   * InstallEmptyLayout() - Installs a root inner node with a single empty
+   *                        leaf node under the given NodeIDs
+   *
+   * This is the layout of a new tree, and of a tree after Truncate()
+   */
+  void InstallEmptyLayout(NodeID root_node_id, NodeID leaf_node_id) {
+    #ifdef BWTREE_PELOTON
 
-    SortedSmallSet<const InnerDataNode *, decltype(f1), decltype(f2)> \
-      sss{data_node_list, f1, f2};
+    // For the first inner node, it needs an empty low key
+    // the search procedure will not look at it and only use it
+    // if the search key could not be matched to anything after the first key
+    KeyNodeIDPair first_sep{KeyType(), leaf_node_id};
 
-    // The effect of this function is a consolidation into inner node
-    InnerNode *inner_node_p = \
+    // Initially there is one element inside the root node
+    // so we set item count to be 1
+    // The high key is +Inf which is identified by INVALID_NODE_ID
+    InnerNode *root_node_p = \
       reinterpret_cast<InnerNode *>( \
         ElasticNode<KeyNodeIDPair>::\
-          Get(node_p->GetItemCount(),
-              NodeType::InnerType,
-              p_depth,
-              node_p->GetItemCount(),
-              node_p->GetLowKeyPair(),
-              node_p->GetHighKeyPair()));
+          Get(1, 
+              NodeType::InnerType, 
+              0, 
+              1, 
+              first_sep,
+              std::make_pair(KeyType(), INVALID_NODE_ID)));
 
-    // The first element is always the low key
-    // since we know it will never be deleted
-    // We do this because for an InnerNode, its first separator key is just
-    // a placeholder and never used (reading its content causes undefined 
-    // behavior), because there is one more NodeID than separators
-    inner_node_p->PushBack(node_p->GetLowKeyPair());
+    #else
 
-    // This will fill in two sets with values present in the inner node
-    // and values deleted
-    CollectAllSepsOnInnerRecursive(node_p,
-                                   node_p->GetLowKeyNodeID(),
-                                   sss,
-                                   inner_node_p);
+    // For the first inner node, it needs an empty low key
+    // the search procedure will not look at it and only use it
+    // if the search key could not be matched to anything after the first key
+    KeyNodeIDPair first_sep{KeyType{}, leaf_node_id};
 
-    // Since consolidation would not change item count they must be equal
-    // Also allocated space should be used exactly as described in the
-    // construction function
-    assert(inner_node_p->GetSize() == node_p->GetItemCount());
-    assert(inner_node_p->GetSize() == inner_node_p->GetItemCount());
+    // Initially there is one element inside the root node
+    // so we set item count to be 1
+    // The high key is +Inf which is identified by INVALID_NODE_ID
+    InnerNode *root_node_p = \
+      reinterpret_cast<InnerNode *>( \
+        ElasticNode<KeyNodeIDPair>::\
+          Get(1, 
+              NodeType::InnerType, 
+              0, 
+              1, 
+              first_sep,    // Copy this as the first key
+              std::make_pair(KeyType{}, INVALID_NODE_ID)));
 
-    return inner_node_p;
-  }
+    #endif
 
-  /*
-   * CollectAllSepsOnInnerRecursive() - This is the counterpart on inner node
-   *
-   * Please refer to the function on leaf node for details. These two have
-   * almost the same logical flow
-   */
-  template<typename T> // To make the f**king compiler
-                       // to deduce SortedSmallSet template type
-  void
-  CollectAllSepsOnInnerRecursive(const BaseNode *node_p,
-                                 NodeID low_key_node_id,
-                                 T &sss,
-                                 InnerNode *new_inner_node_p) const {
-    // High key should be the high key of the branch (if there is a merge
-    // then the high key of the branch may not always equal the high key
-    // of the merged node)
-    // Even if there is no merge, we still need the high key to rule out
-    // keys that has already been splited
-    const KeyNodeIDPair &high_key_pair = node_p->GetHighKeyPair();
+    root_node_p->PushBack(first_sep);
 
-    while(1) {
-      NodeType type = node_p->GetType();
+    bwt_printf("root id = %lu; first leaf id = %lu\n",
+               root_node_id,
+               leaf_node_id);
 
-      switch(type) {
-        case NodeType::InnerType: {
-          const InnerNode *inner_node_p = \
-            static_cast<const InnerNode *>(node_p);
+    InstallNewNode(root_node_id, root_node_p);
 
-          // These two will be set according to the high key and
-          // low key
-          const KeyNodeIDPair *copy_end_it;
-          const KeyNodeIDPair *copy_start_it;
+    // Initially there is no element inside the leaf node so we set element
+    // count to be 0
+    #ifdef BWTREE_PELOTON
 
-          if(high_key_pair.second == INVALID_NODE_ID) {
-            copy_end_it = inner_node_p->End();
-          } else {
-            // This search for the first key >= high key of the current node
-            // being consolidated
-            // This is exactly where we should stop copying
-            // The return value might be end() iterator, but it is also
-            // consistent
-            copy_end_it = \
-              std::lower_bound(inner_node_p->Begin() + 1,
-                               inner_node_p->End(),
-                               high_key_pair,     // This contains the high key
-                               key_node_id_pair_cmp_obj);
-          }
+    LeafNode *left_most_leaf = \
+      reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
+        Get(0,
+            NodeType::LeafType,
+            0,
+            0,
+            std::make_pair(KeyType(), INVALID_NODE_ID),
+            std::make_pair(KeyType(), INVALID_NODE_ID)));
 
-          // Since we want to access its first element
-          assert(inner_node_p->GetSize() > 0);
+    #else
 
-          // If the first element in the sep list equals the low key pair's
-          // NodeID then we are at the leftmost node of the merge tree
-          // and we ignore the leftmost sep (since it could be -Inf)
-          // For other nodes, the leftmost item inside sep list has a valid
-          // key and could thus be pushed directly
-          if(inner_node_p->At(0).second == low_key_node_id) {
-            copy_start_it = inner_node_p->Begin() + 1;
-          } else {
-            copy_start_it = inner_node_p->Begin();
-          }
+    LeafNode *left_most_leaf = \
+      reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
+        Get(0,
+            NodeType::LeafType,
+            0,
+            0,
+            std::make_pair(KeyType{}, INVALID_NODE_ID),
+            std::make_pair(KeyType{}, INVALID_NODE_ID)));
 
-          // Find the end of copying
-          auto sss_end_it = sss.GetEnd() - 1;
+    #endif
 
-          // If the high key is +Inf then sss_end_it is the real end of the
-          // sorted array
-          // Otherwise need to find the end iterator of sss for the current
-          // InnerNode by using its high key
-          if(high_key_pair.second != INVALID_NODE_ID) {
-            // Corner case: If the first element is lower bound
-            // then current_p will move outside
-            // the valid range of the array but still we return
-            // the first element in the array
-            while(sss_end_it >= sss.GetBegin()) {
-              if(key_cmp_obj((*sss_end_it)->item.first, high_key_pair.first) == true) {
-                break;
-              }
+    InstallNewNode(leaf_node_id, left_most_leaf);
 
-              sss_end_it--;
-            }
-          }
+    return;
+  }
 
-          // This points to the first element >= high key
-          sss_end_it++;
+  /*
+   * InitMappingTable() - Initialize the mapping table
+   *
+   * The directory of segments is initialized to NULL in the constructor of
+   * class MappingTable, and segments are allocated with all elements set to
+   * NULL when the first NodeID inside it is reserved by ReserveNodeIDs()
+   */
+  void InitMappingTable() {
+    bwt_printf("Initializing mapping table.... size = %lu\n",
+               MAPPING_TABLE_SIZE);
+    bwt_printf("Segments are allocated on demand\n");
 
-          //printf("%ld\n", sss.GetSize());
+    return;
+  }
 
-          while(1) {
-            bool sss_end_flag = (sss.GetBegin() == sss_end_it);
-            bool array_end_flag = (copy_start_it == copy_end_it);
+  /*
+   * ReserveNodeIDs() - Takes a number of consecutive NodeIDs that have never
+   *                    been used from the shared counter
+   *
+   * This function basically compiles to LOCK XADD instruction on x86
+   * which is guaranteed to execute atomically. Segments of the mapping
+   * table are allocated for all returned NodeIDs
+   */
+  inline NodeID ReserveNodeIDs(NodeID node_id_num) {
+    // fetch_add() returns the old value and increase the atomic
+    // automatically
+    NodeID node_id = next_unused_node_id.fetch_add(node_id_num);
+
+    // Allocate the segment if this is the first NodeID inside it. Since
+    // recycled NodeIDs were once allocated here, they do not need this
+    for(NodeID i = 0;i < node_id_num;i++) {
+      mapping_table.Reserve(node_id + i);
+    }
 
-            //printf("sss_end_flag = %d; array_end_flag = %d\n", sss_end_flag, array_end_flag);
+    return node_id;
+  }
 
-            if(sss_end_flag == true && array_end_flag == true) {
-              // Both are drained
-              break;
-            } else if(sss_end_flag == true) {
-              // If the sss has drained we continue to drain the array
-              // This version of PushBack() takes two iterators and
-              // insert from start to end - 1
-              new_inner_node_p->PushBack(copy_start_it, copy_end_it);
+  /*
+   * GetNextNodeID() - Thread-safe lock free method to get next node ID
+   *
+   * NodeIDs are handed out from the chunk reserved by the current thread,
+   * such that threads splitting nodes at the same time do not contend on
+   * the shared counter. If the chunk is used up then a recycled NodeID is
+   * taken, or the chunk is refilled with at most NODE_ID_CHUNK_SIZE NodeIDs
+   * of trees freed after Truncate(), or NODE_ID_CHUNK_SIZE new NodeIDs are
+   * reserved
+   */
+  inline NodeID GetNextNodeID() {
+    NodeIDCache *cache_p = GetCurrentNodeIDCache();
+
+    if(cache_p->next_node_id == cache_p->end_node_id) {
+      // This is a std::pair<bool, NodeID>
+      // If the first element is true then the NodeID is a valid one
+      // If the first element is false then NodeID is invalid and the
+      // stack is either empty or being used (we cannot lock and wait)
+      auto ret_pair = free_node_id_list.Pop();
+      if(ret_pair.first == true) {
+        return ret_pair.second;
+      }
 
-              break;
-            } else if(array_end_flag == true) {
-              // Then we drain all elements inside the delta chain
-              while(sss.GetBegin() != sss_end_it) {
-                // We could not pop here since we will use the value later
-                NodeType data_node_type = (sss.GetFront())->GetType();
+      bool ret = TakeRecycledNodeIDs(NODE_ID_CHUNK_SIZE,
+                                     &cache_p->next_node_id,
+                                     &cache_p->end_node_id);
+      if(ret == false) {
+        cache_p->next_node_id = ReserveNodeIDs(NODE_ID_CHUNK_SIZE);
+        cache_p->end_node_id = cache_p->next_node_id + NODE_ID_CHUNK_SIZE;
+      }
+    }
 
-                // It is possible that there is an InnerDeleteNode:
-                // InnerNode: [1, 2, 3, 4, 5]
-                // Delta Chain:               Delete 6, Insert 6
-                // Only the first "Delete 6" will appear in the set
-                // and we just do not care
-                if(data_node_type == NodeType::InnerInsertType) {
-                  // Pop the value here
-                  new_inner_node_p->PushBack(sss.PopFront()->item);
-                } else {
-                  // And here (InnerDeleteNode after we have drained InnerNode
-                  // is useless so just ignore it)
-                  sss.PopFront();
-                }
-              }
+    return cache_p->next_node_id++;
+  }
 
-              break;
-            }
+  /*
+   * TakeNodeID() - Returns a NodeID of a tree freed after Truncate(), or
+   *                reserves a new one
+   *
+   * This does not require a GC ID, and is used where nodes are created
+   * one at a time outside of a worker thread's chunk
+   */
+  inline NodeID TakeNodeID() {
+    NodeID node_id;
+    NodeID end_node_id;
 
-            // Next is the normal case: Both are not drained
-            // we do a comparison of their leading elements
+    if(TakeRecycledNodeIDs(1, &node_id, &end_node_id) == true) {
+      return node_id;
+    }
 
-            if(key_cmp_obj(copy_start_it->first, 
-                           sss.GetFront()->item.first) == true) {
-              // If array element is less than data node list element
-              new_inner_node_p->PushBack(*copy_start_it);
+    return ReserveNodeIDs(1);
+  }
 
-              copy_start_it++;
-            } else if(key_cmp_obj(sss.GetFront()->item.first, 
-                                  copy_start_it->first) == true) {
-              NodeType data_node_type = (sss.GetFront())->GetType();
+  /*
+   * TakeRecycledNodeIDs() - Takes at most node_id_num consecutive NodeIDs
+   *                         from the recycled ranges
+   *
+   * The range is returned as [*node_id_p, *end_node_id_p). Returns false
+   * if there is no recycled NodeID, in which case the arguments are not
+   * modified. Segments of recycled NodeIDs have been allocated
+   */
+  bool TakeRecycledNodeIDs(NodeID node_id_num,
+                           NodeID *node_id_p,
+                           NodeID *end_node_id_p) {
+    if(recycled_node_id_count.load(std::memory_order_relaxed) == 0UL) {
+      return false;
+    }
 
-              // Delta Insert with array not having that element
-              if(data_node_type == NodeType::InnerInsertType) {
-                // Pop the value here
-                new_inner_node_p->PushBack(sss.PopFront()->item);
-              } else {
-                // This is possible
-                // InnerNode: [2, 3, 4, 5]
-                // Delta Chain: Delete 1, Insert 1
-                // So just ignore it
-                sss.PopFront();
-              }
-            } else {
-              // In this branch the values are equal
+    std::lock_guard<std::mutex> guard{recycled_node_id_lock};
 
-              NodeType data_node_type = (sss.GetFront())->GetType();
+    if(recycled_node_id_list.empty() == true) {
+      return false;
+    }
 
-              // InsertDelta overrides InnerNode element
-              if(data_node_type == NodeType::InnerInsertType) {
-                new_inner_node_p->PushBack(sss.PopFront()->item);
-              } else {
-                // There is a value in InnerNode that does not exist
-                // in consolidated node. Just ignore
-                sss.PopFront();
-              }
+    std::pair<NodeID, NodeID> &range = recycled_node_id_list.back();
+    NodeID taken_num = std::min(node_id_num, range.second - range.first);
 
-              copy_start_it++;
-            } // Compare leading elements
-          } // while(1)
+    *node_id_p = range.first;
+    *end_node_id_p = range.first + taken_num;
 
-          return;
-        } // case InnerType
-        case NodeType::InnerRemoveType: {
-          bwt_printf("ERROR: InnerRemoveNode not allowed\n");
+    range.first += taken_num;
+    if(range.first == range.second) {
+      recycled_node_id_list.pop_back();
+    }
 
-          assert(false);
-          return;
-        } // case InnerRemoveType
-        case NodeType::InnerInsertType: {
-          const InnerInsertNode *insert_node_p = \
-            static_cast<const InnerInsertNode *>(node_p);
+    recycled_node_id_count.fetch_sub(taken_num);
 
-          // delta nodes must be consistent with the most up-to-date
-          // node high key
-          assert((high_key_pair.second == INVALID_NODE_ID) ||
-                 (KeyCmpLess(insert_node_p->item.first, high_key_pair.first)));
+    return true;
+  }
 
-          sss.Insert(static_cast<const InnerDataNode *>(node_p));
+  /*
+   * RecycleNodeIDs() - Makes NodeIDs available to TakeRecycledNodeIDs()
+   *
+   * Mapping table entries of these NodeIDs must be nullptr, and no thread
+   * could be using them, i.e. they are freed after all threads that could
+   * have seen them have left their epochs. The list is sorted, such that
+   * consecutive NodeIDs are stored as one range, and then cleared
+   */
+  void RecycleNodeIDs(std::vector<NodeID> *node_id_list_p) {
+    if(node_id_list_p->empty() == true) {
+      return;
+    }
 
-          // Go to next node
-          node_p = insert_node_p->child_node_p;
+    std::sort(node_id_list_p->begin(), node_id_list_p->end());
 
-          break;
-        } // case InnerInsertType
-        case NodeType::InnerDeleteType: {
-          const InnerDeleteNode *delete_node_p = \
-            static_cast<const InnerDeleteNode *>(node_p);
+    std::vector<std::pair<NodeID, NodeID>> range_list{};
+    for(NodeID node_id : *node_id_list_p) {
+      assert(mapping_table[node_id].load() == nullptr);
 
-          // Since we do not allow any delta node under split node
-          // this must be true
-          // i.e. delta nodes must be consistent with the most up-to-date
-          // node high key
-          assert((high_key_pair.second == INVALID_NODE_ID) ||
-                 (KeyCmpLess(delete_node_p->item.first, high_key_pair.first)));
+      if(range_list.empty() == false && range_list.back().second == node_id) {
+        range_list.back().second++;
+      } else {
+        range_list.push_back(std::make_pair(node_id, node_id + 1));
+      }
+    }
 
-          sss.Insert(static_cast<const InnerDataNode *>(node_p));
+    std::lock_guard<std::mutex> guard{recycled_node_id_lock};
 
-          node_p = delete_node_p->child_node_p;
+    recycled_node_id_list.insert(recycled_node_id_list.end(),
+                                 range_list.begin(),
+                                 range_list.end());
+    recycled_node_id_count.fetch_add(node_id_list_p->size());
 
-          break;
-        } // case InnerDeleteType
-        case NodeType::InnerSplitType: {
-          node_p = (static_cast<const DeltaNode *>(node_p))->child_node_p;
+    node_id_list_p->clear();
 
-          break;
-        } // case InnerSplitType
-        case NodeType::InnerMergeType: {
-          const InnerMergeNode *merge_node_p = \
-            static_cast<const InnerMergeNode *>(node_p);
+    return;
+  }
 
-          // NOTE: We alaways use the same metadata object which is the
-          // one passed by the wrapper. Though node_p changes for each
-          // recursive call, metadata should not change and should remain
-          // constant
+  /*
+   * InstallNodeToReplace() - Install a node to replace a previous one
+   *
+   * If installation fails because CAS returned false, then return false
+   * This function does not retry
+   */
+  inline bool InstallNodeToReplace(NodeID node_id,
+                                   const BaseNode *node_p,
+                                   const BaseNode *prev_p) {
+    // Make sure node id is valid and does not exceed maximum
+    assert(node_id != INVALID_NODE_ID);
+    assert(node_id < MAPPING_TABLE_SIZE);
 
-          CollectAllSepsOnInnerRecursive(merge_node_p->child_node_p,
-                                         low_key_node_id,
-                                         sss,
-                                         new_inner_node_p);
+    // If idb is activated, then all operation will be blocked before
+    // they could call CAS and change the key
+    #ifdef INTERACTIVE_DEBUG
+    debug_stop_mutex.lock();
+    debug_stop_mutex.unlock();
+    #endif
 
-          CollectAllSepsOnInnerRecursive(merge_node_p->right_merge_p,
-                                         low_key_node_id,
-                                         sss,
-                                         new_inner_node_p);
+    return mapping_table[node_id].compare_exchange_strong(prev_p, node_p);
+  }
 
-          // There is no unvisited node
-          return;
-        } // case InnerMergeType
-        default: {
-          bwt_printf("ERROR: Unknown inner node type = %d\n",
-                 static_cast<int>(type));
+  /*
+   * InstallLeafDelta() - Install a delta node on top of a leaf delta chain
+   *
+   * This is InstallNodeToReplace() for the deltas of Insert(), Delete()
+   * and Upsert(). If RTM is enabled the mapping table slot is checked and
+   * written in a hardware transaction, which avoids the locked instruction
+   * when there is no contention. If the slot no longer holds prev_p the
+   * transaction aborts explicitly and false is returned, just like a failed
+   * CAS. Other aborts are retried a few times before falling back to CAS
+   */
+  inline bool InstallLeafDelta(NodeID node_id,
+                               const BaseNode *node_p,
+                               const BaseNode *prev_p) {
+    #ifdef BWTREE_USE_RTM
+    if(rtm_flag == true) {
+      return InstallLeafDeltaRTM(node_id, node_p, prev_p);
+    }
+    #endif
 
-          assert(false);
-          return;
+    return InstallNodeToReplace(node_id, node_p, prev_p);
+  }
+
+  #ifdef BWTREE_USE_RTM
+
+  /*
+   * InstallLeafDeltaRTM() - The RTM path of InstallLeafDelta()
+   */
+  __attribute__((target("rtm")))
+  bool InstallLeafDeltaRTM(NodeID node_id,
+                           const BaseNode *node_p,
+                           const BaseNode *prev_p) {
+    assert(node_id != INVALID_NODE_ID);
+    assert(node_id < MAPPING_TABLE_SIZE);
+
+    std::atomic<const BaseNode *> &slot = mapping_table[node_id];
+
+    for(int i = 0;i < RTM_RETRY_COUNT;i++) {
+      unsigned status = _xbegin();
+
+      if(status == _XBEGIN_STARTED) {
+        if(slot.load(std::memory_order_relaxed) != prev_p) {
+          _xabort(RTM_ABORT_NODE_CHANGED);
         }
-      } // switch type
-    } // while(1)
 
-    // Should not get to here
-    assert(false);
-    return;
+        slot.store(node_p, std::memory_order_relaxed);
+        _xend();
+
+        return true;
+      }
+
+      if((status & _XABORT_EXPLICIT) && \
+         (_XABORT_CODE(status) == RTM_ABORT_NODE_CHANGED)) {
+        return false;
+      }
+
+      // Capacity aborts and the like would not succeed on a retry
+      if((status & _XABORT_RETRY) == 0) {
+        break;
+      }
+    }
+
+    return InstallNodeToReplace(node_id, node_p, prev_p);
   }
 
   /*
-   * NavigateLeafNode() - Find search key on a logical leaf node and collect
-   *                      values associated with the key
-   *
-   * This function correctly deals with merge and split, starting on
-   * the topmost node of a delta chain
-   *
-   * It pushes pointers of nodes into a vector, and stops at the leaf node.
-   * After that it bulk loads the leaf page's data item of the search key
-   * into logical leaf node, and then replay log
-   *
-   * In order to reflect the fact that we might jump to a split sibling using
-   * NodeID due to a half split state, the function will modify snapshot_p's
-   * NodeID and BaseNode pointer if this happens, and furthermore it sets
-   * is_sibling flag to true to notify the caller that path history needs to
-   * be updated
-   *
-   * This function takes an extra argument to decide whether it collects any
-   * value. If collect_value is set to false, then this function only traverses
-   * the leaf node without collecting any actual value, while still being
-   * able to traverse to its left sibling and potentially abort
-   *
-   * NOTE: If there is prior data in its logical node when calling this function
-   * then we simply turn off collect_value flag in order to make use of
-   * these values and avoid map insert conflict.
-   *
-   * NOTE 2: After jumping to a new NodeID in this function there will be similar
-   * problems since now the snapshot has been changed, and we need to check
-   * whether there is data in the map again to make sure there is no
-   * map insert conflict
+   * IsRTMSupported() - Whether the CPU supports RTM instructions
    */
-  void NavigateLeafNode(Context *context_p,
-                        std::vector<ValueType> &value_list) {
-                          
-    // This will go to the right sibling until we have seen
-    // a node whose range match the search key
-    NavigateSiblingChain(context_p);
+  static bool IsRTMSupported() {
+    unsigned eax, ebx, ecx, edx;
 
-    // If navigating sibling chain aborts then abort here
-    if(context_p->abort_flag == true) {
-      return;
+    if(__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) {
+      return false;
     }
-    
-    /////////////////////////////////////////////////////////////////
-    // Only after this point could we get snapshot and node_p
-    /////////////////////////////////////////////////////////////////
-    
-    // This contains information for current node
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-    const BaseNode *node_p = snapshot_p->node_p;
 
-    assert(snapshot_p->IsLeaf() == true);
+    return (ebx & bit_RTM) != 0;
+  }
 
-    // We only collect values for this key
-    const KeyType &search_key = context_p->search_key;
+  #else
 
-    // The maximum size of present set and deleted set is just
-    // the length of the delta chain. Since when we reached the leaf node
-    // we just probe and add to value set
-    const int set_max_size = node_p->GetDepth();
+  static bool IsRTMSupported() {
+    return false;
+  }
 
-    // 1. This works even if depth is 0
-    // 2. We choose to store const ValueType * because we want to bound the
-    // size of stack array. It should be upper bounded by max delta chain
-    // length * pointer size. On the contrary, if the size of
-    // ValueType is huge, and we store ValueType, then we might cause
-    // a stack overflow
-    const ValueType *present_set_data_p[set_max_size];
-    const ValueType *deleted_set_data_p[set_max_size];
+  #endif
 
-    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
-      present_set{present_set_data_p,
-                  value_eq_obj,
-                  value_hash_obj};
+  /*
+   * InstallRootNode() - Replace the old root with a new one
+   *
+   * There is change that this function would fail. In that case it returns
+   * false, which implies there are some other threads changing the root ID
+   */
+  inline bool InstallRootNode(NodeID old_root_node_id,
+                              NodeID new_root_node_id) {
+    return root_id.compare_exchange_strong(old_root_node_id,
+                                           new_root_node_id);
+  }
 
-    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
-      deleted_set{deleted_set_data_p,
-                  value_eq_obj,
-                  value_hash_obj};
-                  
-    int start_index = 0;
-    int end_index = -1;
+  /*
+   * InstallNewNode() - Install a new node into the mapping table
+   *
+   * This function does not return any value since we assume new node
+   * installation would always succeed
+   */
+  inline void InstallNewNode(NodeID node_id,
+                             const BaseNode *node_p) {
+    mapping_table[node_id] = node_p;
 
-    while(1) {
-      NodeType type = node_p->GetType();
+    RecordInstalledNode(node_p);
 
-      switch(type) {
-        case NodeType::LeafType: {
-          const LeafNode *leaf_node_p = \
-            static_cast<const LeafNode *>(node_p);
+    return;
+  }
 
-          auto start_it = leaf_node_p->Begin() + start_index;
+  /*
+   * GetNode() - Return the pointer mapped by a node ID
+   *
+   * This function checks the validity of the node ID
+   *
+   * NOTE: This function fixes a snapshot; its counterpart using
+   * CAS instruction to install a new node creates new snapshot
+   * and the serialization order of these two atomic operations
+   * determines actual serialization order
+   *
+   * If we want to keep the same snapshot then we should only
+   * call GetNode() once and stick to that physical pointer
+   */
+  inline const BaseNode *GetNode(const NodeID node_id) {
+    assert(node_id != INVALID_NODE_ID);
+    assert(node_id < MAPPING_TABLE_SIZE);
 
-          // That is the end of searching
-          auto end_it = ((end_index == -1) ? \
-                         leaf_node_p->End() : \
-                         leaf_node_p->Begin() + end_index);
+    return mapping_table[node_id].load();
+  }
 
-          // Here we know the search key < high key of current node
-          // NOTE: We only compare keys here, so it will get to the first
-          // element >= search key
-          auto copy_start_it = \
-            std::lower_bound(start_it,
-                             end_it,
-                             std::make_pair(search_key, ValueType{}),
-                             key_value_pair_cmp_obj);
+  /*
+   * GetExpandedNode() - GetNode() that replaces a compressed leaf node with
+   *                     a LeafNode first
+   *
+   * This is used by all traversals except read-only ones (see
+   * Context::read_only_flag), such that code that modifies or splits nodes
+   * never sees a compressed leaf
+   */
+  inline const BaseNode *GetExpandedNode(const NodeID node_id) {
+    const BaseNode *node_p = GetNode(node_id);
 
-          // If there is something to copy
-          while((copy_start_it != leaf_node_p->End()) && \
-                (KeyCmpEqual(search_key, copy_start_it->first))) {
-            // If the value has not been deleted then just insert
-            // Note that here we use ValueSet, so need to extract value from
-            // the key value pair
-            if(deleted_set.Exists(copy_start_it->second) == false) {
-              if(present_set.Exists(copy_start_it->second) == false) {
-                // Note: As an optimization, we do not have to Insert() the
-                // value element into present set here. Since we know it
-                // is already base leaf page, adding values into present set
-                // definitely will not block the remaining values, since we
-                // know they do not duplicate inside the leaf node
+    while(node_p != nullptr && \
+          node_p->GetType() == NodeType::LeafCompressedType) {
+      node_p = ExpandLeafNode(node_id, node_p);
+    }
 
-                value_list.push_back(copy_start_it->second);
-              }
-            }
+    return node_p;
+  }
 
-            copy_start_it++;
-          }
+  /*
+   * GetRootNodeID() - Returns the NodeID a traversal starts from
+   *
+   * This is the current root, unless the context refers to a tree that
+   * has been dropped by Truncate() since. Then the root remembered by the
+   * snapshot is used, and dropped_tree_flag is set. The generation is read
+   * on both sides of the root, and it is odd while Truncate() is swapping
+   * the root, so the root read belongs to the snapshot's tree if both
+   * generations match it
+   */
+  inline NodeID GetRootNodeID(Context *context_p) {
+    if(context_p->tree_root.IsCurrent() == true) {
+      return root_id.load();
+    }
 
-          return;
-        }
-        case NodeType::LeafInsertType: {
-          const LeafInsertNode *insert_node_p = \
-            static_cast<const LeafInsertNode *>(node_p);
+    uint64_t generation = tree_generation.load();
+    NodeID node_id = root_id.load();
 
-          if(KeyCmpEqual(search_key, insert_node_p->item.first)) {
-            if(deleted_set.Exists(insert_node_p->item.second) == false) {
-              // We must do this, since inserted set does not detect for
-              // duplication, and if the value has already been in present set
-              // then we inserted the same value twice
-              if(present_set.Exists(insert_node_p->item.second) == false) {
-                present_set.Insert(insert_node_p->item.second);
+    if(generation == context_p->tree_root.generation && \
+       tree_generation.load() == generation) {
+      return node_id;
+    }
 
-                value_list.push_back(insert_node_p->item.second);
-              }
-            }
-          } else if(KeyCmpGreater(search_key, insert_node_p->item.first)) {
-            start_index = insert_node_p->GetIndexPair().first;
-          } else {
-            end_index = insert_node_p->GetIndexPair().first;
-          }
+    context_p->dropped_tree_flag = true;
 
-          node_p = insert_node_p->child_node_p;
+    return context_p->tree_root.root_node_id;
+  }
 
-          break;
-        } // case LeafInsertType
-        case NodeType::LeafDeleteType: {
-          const LeafDeleteNode *delete_node_p = \
-            static_cast<const LeafDeleteNode *>(node_p);
+  /*
+   * Traverse() - Traverse down the tree structure, handles abort
+   *
+   * This function is implemented as a state machine that allows a thread
+   * to jump back to Init state when necessary (probably a CAS failed and
+   * it does not want to resolve it from bottom up)
+   *
+   * It stops at page level, and then the top on the context stack is a
+   * leaf level snapshot, with all SMOs, consolidation, and possibly
+   * split/remove finished
+   *
+   * NOTE: If value_p is given then this function calls NavigateLeafNode()
+   * to detect whether the desired key value pair exists or not. If value_p
+   * is nullptr then this function calls the overloaded version of
+   *  NavigateLeafNode() to collect all values associated with the key
+   * and put them into value_list_p.
+   *
+   * If value_p is not nullptr, then the return value of this function denotes
+   * whether the key-value pair exists or not. Otherwise it always return true
+   *
+   * In both cases, when this function returns, the top of the NodeSnapshot
+   * list is always a leaf node snapshot in which current key is included
+   * in its range.
+   *
+   * For value_p and value_list_p, at most one of them could be non-nullptr
+   * If both are nullptr then we just traverse and do not do anything
+   */
+  const KeyValuePair *Traverse(Context *context_p,
+                               const ValueType *value_p,
+                               std::pair<int, bool> *index_pair_p) {
 
-          if(KeyCmpEqual(search_key, delete_node_p->item.first)) {
-            if(present_set.Exists(delete_node_p->item.second) == false) {
-              deleted_set.Insert(delete_node_p->item.second);
-            }
-          } else if(KeyCmpGreater(search_key, delete_node_p->item.first)) {
-            start_index = delete_node_p->GetIndexPair().first;
-          } else {
-            end_index = delete_node_p->GetIndexPair().first;
-          }
-          
-          node_p = delete_node_p->child_node_p;
+    // For value collection it always returns nullptr
+    const KeyValuePair *found_pair_p = nullptr;
 
-          break;
-        } // case LeafDeleteType
-        case NodeType::LeafRemoveType: {
-          bwt_printf("ERROR: Observed LeafRemoveNode in delta chain\n");
+    AddStatistics(&ThreadStatistics::traversal_count);
 
-          assert(false);
-        } // case LeafRemoveType
-        case NodeType::LeafMergeType: {
-          bwt_printf("Observed a merge node on leaf delta chain\n");
+retry_traverse:
+    assert(context_p->abort_flag == false);
+    assert(context_p->current_level == -1);
 
-          const LeafMergeNode *merge_node_p = \
-            static_cast<const LeafMergeNode *>(node_p);
+    // This is the serialization point for reading/writing root node
+    NodeID start_node_id = GetRootNodeID(context_p);
+    
+    // This is used to identify root nodes
+    // NOTE: We set current snapshot since in LoadNodeID() or read opt.
+    // version the parent node snapshot will be overwritten with this child
+    // node snapshot
+    //
+    // NOTE 2: We could not use GetLatestNodeSnashot() here since it checks
+    // current_level, which is -1 at this point
+    context_p->current_snapshot.node_id = INVALID_NODE_ID;
+    
+    // We need to call this even for root node since there could
+    // be split delta posted on to root node
+    LoadNodeID(start_node_id, context_p);
 
-          // Decide which side we should choose
-          // Using >= for separator key
-          if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
-            bwt_printf("Take leaf merge right branch\n");
+    // There could be an abort here, and we could not directly jump
+    // to Init state since we would like to do some clean up or
+    // statistics after aborting
+    if(context_p->abort_flag == true) {
+      goto abort_traverse;
+    }
 
-            node_p = merge_node_p->right_merge_p;
-          } else {
-            bwt_printf("Take leaf merge left branch\n");
+    bwt_printf("Successfully loading root node ID\n");
 
-            node_p = merge_node_p->child_node_p;
-          }
+    while(1) {
+      NodeID child_node_id = NavigateInnerNode(context_p);
 
-          break;
-        } // case LeafMergeType
-        case NodeType::LeafSplitType: {
-          bwt_printf("Observed a split node on leaf delta chain\n");
+      // Navigate could abort since it might go to another NodeID
+      // if there is a split delta and the key is >= split key
+      if(context_p->abort_flag == true) {
+        bwt_printf("Navigate Inner Node abort. ABORT\n");
 
-          const LeafSplitNode *split_node_p = \
-            static_cast<const LeafSplitNode *>(node_p);
+        // If NavigateInnerNode() aborts then it retrns INVALID_NODE_ID
+        // as a double check
+        // This is the only situation that this function returns
+        // INVALID_NODE_ID
+        assert(child_node_id == INVALID_NODE_ID);
 
-          // Do not need to go right here since we have already
-          // done that on the top level
-          // and the high key has been observed on the top level high key
-          node_p = split_node_p->child_node_p;
+        goto abort_traverse;
+      }
 
-          break;
-        } // case LeafSplitType
-        default: {
-          bwt_printf("ERROR: Unknown leaf delta node type: %d\n",
-                     static_cast<int>(node_p->GetType()));
+      // This might load a leaf child
+      // Also LoadNodeID() does not guarantee the node bound matches
+      // seatch key. Since we could readjust using the split side link
+      // during Navigate...Node()
+      LoadNodeID(child_node_id, context_p);
 
-          assert(false);
-        } // default
-      } // switch
-    } // while
+      if(context_p->abort_flag == true) {
+        bwt_printf("LoadNodeID aborted. ABORT\n");
 
-    // We cannot reach here
-    assert(false);
-    return;
-  }
+        goto abort_traverse;
+      }
 
-  /*
-   * NavigateLeafNode() - Check existence for a certain value
-   *
-   * Please note that this function is overloaded. This version is used for
-   * insert/delete/update that only checks existence of values, rather than
-   * collecting all values for a single key.
-   *
-   * If return value is nullptr, then the key-value pair is not found. Otherwise
-   * a pointer to the matching item is returned. The caller should check return
-   * value and act accordingly.
-   *
-   * This function works by traversing down the delta chain and compare
-   * values with those in delta nodes and in the base node. No special data
-   * structure is required
-   *
-   * This function calls JumpToNodeID() to switch to a split sibling node
-   * There are possibility that the switch aborts, and in this case this
-   * function returns with value false.
-   */
-  const KeyValuePair *NavigateLeafNode(Context *context_p,
-                                       const ValueType &search_value,
-                                       std::pair<int, bool> *index_pair_p) {
-    
-    // This will go to the right sibling until we have seen
-    // a node whose range match the search key
-    NavigateSiblingChain(context_p);
+      // This is the node we have just loaded
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
 
-    // If navigating sibling chain aborts then abort here
-    if(context_p->abort_flag == true) {
-      return nullptr;
+      if(snapshot_p->IsLeaf() == true) {
+        bwt_printf("The next node is a leaf\n");
+
+        break;
+      }
+    } //while(1)
+
+    if(value_p == nullptr) {
+      // We are using an iterator just to get a leaf page
+      assert(index_pair_p == nullptr);
+      
+      // If both are nullptr then we just navigate the sibling chain
+      // to find the correct node with the correct range
+      // And then the iterator will consolidate the node without actually
+      // going down with a specific key
+      NavigateSiblingChain(context_p);
+    } else {
+      // If a value is given then use this value to Traverse down leaf
+      // page to find whether the value exists or not
+      found_pair_p = NavigateLeafNode(context_p, *value_p, index_pair_p);
     }
-    
-    /////////////////////////////////////////////////////////////////
-    // Only after this point could we get snapshot and node_p
-    /////////////////////////////////////////////////////////////////
-    
-    // Snapshot pointer, node pointer, and metadata reference all need
-    // updating once LoadNodeID() returns with success
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-    assert(snapshot_p->IsLeaf() == true);
 
-    const BaseNode *node_p = snapshot_p->node_p;
+    if(context_p->abort_flag == true) {
+      bwt_printf("NavigateLeafNode() or NavigateSiblingChain()"
+                 " aborts. ABORT\n");
 
-    // Save some typing
-    const KeyType &search_key = context_p->search_key;
+      goto abort_traverse;
+    }
 
-    while(1) {
-      NodeType type = node_p->GetType();
+    #ifdef BWTREE_DEBUG
+    
+    bwt_printf("Found leaf node. Abort count = %d, level = %d\n",
+               context_p->abort_counter,
+               context_p->current_level);
+               
+    #endif
 
-      switch(type) {
-        case NodeType::LeafType: {
-          const LeafNode *leaf_node_p = \
-            static_cast<const LeafNode *>(node_p);
+    // If there is no abort then we could safely return
+    return found_pair_p;
 
-          // Here we know the search key < high key of current node
-          // NOTE: We only compare keys here, so it will get to the first
-          // element >= search key
-          auto scan_start_it = \
-            std::lower_bound(leaf_node_p->Begin(),
-                             leaf_node_p->End(),
-                             std::make_pair(search_key, ValueType{}),
-                             key_value_pair_cmp_obj);
+abort_traverse:
+    AddStatistics(&ThreadStatistics::traversal_abort_count);
 
-          // Search all values with the search key
-          while((scan_start_it != leaf_node_p->End()) && \
-                (KeyCmpEqual(scan_start_it->first, search_key))) {
-                  
-            // If there is a value matching the search value then return true
-            // We do not need to check any delete set here, since if the
-            // value has been deleted earlier then this function would
-            // already have returned
-            if(ValueCmpEqual(scan_start_it->second, search_value)) {
-              // Since only Delete() will use this piece of information
-              // we set exist flag to false to indicate that the value
-              // has been invalidated
-              index_pair_p->first = \
-                scan_start_it - leaf_node_p->Begin();
-              index_pair_p->second = true;
-              
-              // Return a pointer to the item inside LeafNode;
-              // This pointer should remain valid until epoch is exited
-              return &(*scan_start_it);
-            }
+    #ifdef BWTREE_DEBUG
+    
+    assert(context_p->current_level >= 0);
 
-            scan_start_it++;
-          }
-          
-          // Either key does not exist or key exists but value does not
-          // exist will reach here
-          // Since only Insert() will use the index we set exist flag to false
-          index_pair_p->first = \
-                scan_start_it - leaf_node_p->Begin();
-          index_pair_p->second = false;
+    context_p->current_level = -1;
+    
+    context_p->abort_counter++;
+    
+    #endif
+    
+    // This is used to identify root node
+    context_p->current_snapshot.node_id = INVALID_NODE_ID;
 
-          return nullptr;
-        } // case LeafType
-        case NodeType::LeafInsertType: {
-          const LeafInsertNode *insert_node_p = \
-            static_cast<const LeafInsertNode *>(node_p);
+    context_p->abort_flag = false;
 
-          if(KeyCmpEqual(search_key, insert_node_p->item.first)) {
-            if(ValueCmpEqual(insert_node_p->item.second, search_value)) {
-              // Only Delete() will use this
-              // We just simply inherit from the first node
-              *index_pair_p = insert_node_p->GetIndexPair();
-              
-              return &insert_node_p->item;
-            }
-          }
+    goto retry_traverse;
 
-          node_p = insert_node_p->child_node_p;
+    assert(false);
+    return nullptr;
+  }
 
-          break;
-        } // case LeafInsertType
-        case NodeType::LeafDeleteType: {
-          const LeafDeleteNode *delete_node_p = \
-            static_cast<const LeafDeleteNode *>(node_p);
+  /*
+   * TraverseWithFinger() - Traverse() that starts from the leaf finger of
+   *                        the current thread if possible
+   *
+   * The arguments and the return value are the same as Traverse(). After
+   * a full traversal the leaf found becomes the new finger. If retry_node_id
+   * is valid then it is the leaf of a failed delta installation, which is
+   * tried before the finger, since the key is most likely still there
+   */
+  const KeyValuePair *TraverseWithFinger(Context *context_p,
+                                         const ValueType *value_p,
+                                         std::pair<int, bool> *index_pair_p,
+                                         NodeID retry_node_id = \
+                                           INVALID_NODE_ID) {
+    if(retry_node_id != INVALID_NODE_ID && \
+       LoadLeafFinger(retry_node_id, context_p) == true) {
+      AddStatistics(&ThreadStatistics::leaf_retry_count);
+    } else if(leaf_finger_flag == false) {
+      return Traverse(context_p, value_p, index_pair_p);
+    } else if(GetCurrentLeafFinger()->generation == \
+                tree_generation.load() && \
+              LoadLeafFinger(GetCurrentLeafFinger()->node_id,
+                             context_p) == true) {
+      AddStatistics(&ThreadStatistics::leaf_finger_hit_count);
+    } else {
+      AddStatistics(&ThreadStatistics::leaf_finger_miss_count);
 
-          // If the value was deleted then return false
-          if(KeyCmpEqual(search_key, delete_node_p->item.first)) {
-            if(ValueCmpEqual(delete_node_p->item.second, search_value)) {
-              // Only Insert() will use this
-              // We just simply inherit from the first node
-              *index_pair_p = delete_node_p->GetIndexPair();
-              
-              return nullptr;
-            }
-          }
-          
-          node_p = delete_node_p->child_node_p;
+      // The generation is read before Traverse() reads the root, so the
+      // finger is never newer than the tree it was found in. If Truncate()
+      // is swapping the root then the odd value never matches afterwards
+      uint64_t start_generation = tree_generation.load();
 
-          break;
-        } // case LeafDeleteType
-        case NodeType::LeafRemoveType: {
-          bwt_printf("ERROR: Observed LeafRemoveNode in delta chain\n");
+      const KeyValuePair *found_pair_p = \
+        Traverse(context_p, value_p, index_pair_p);
 
-          assert(false);
-        } // case LeafRemoveType
-        case NodeType::LeafMergeType: {
-          bwt_printf("Observed a merge node on leaf delta chain\n");
+      GetCurrentLeafFinger()->node_id = \
+        GetLatestNodeSnapshot(context_p)->node_id;
+      GetCurrentLeafFinger()->generation = start_generation;
 
-          const LeafMergeNode *merge_node_p = \
-            static_cast<const LeafMergeNode *>(node_p);
+      return found_pair_p;
+    }
 
-          // Decide which side we should choose
-          // Using >= for separator key
-          if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
-            bwt_printf("Take leaf merge right branch\n");
+    if(value_p == nullptr) {
+      assert(index_pair_p == nullptr);
 
-            node_p = merge_node_p->right_merge_p;
-          } else {
-            bwt_printf("Take leaf merge left branch\n");
+      return nullptr;
+    }
 
-            node_p = merge_node_p->child_node_p;
-          }
+    // The key is within range so NavigateSiblingChain() inside this
+    // function does not jump, and it could not abort
+    const KeyValuePair *found_pair_p = \
+      NavigateLeafNode(context_p, *value_p, index_pair_p);
+    assert(context_p->abort_flag == false);
 
-          break;
-        } // case LeafMergeType
-        case NodeType::LeafSplitType: {
-          bwt_printf("Observed a split node on leaf delta chain\n");
+    return found_pair_p;
+  }
 
-          const LeafSplitNode *split_node_p = \
-            static_cast<const LeafSplitNode *>(node_p);
+  /*
+   * LoadLeafFinger() - Takes the snapshot of the finger leaf as the only
+   *                    node on the path
+   *
+   * Returns false if the finger could not be used, in which case the
+   * context is not modified. The NodeID might have been recycled, so the
+   * node is checked to be a leaf whose range contains the search key, which
+   * makes it the right leaf no matter how it got there. Leaves with an SMO
+   * on top, or that Traverse() would consolidate, split or merge, are
+   * left to the full traversal, since these need the parent node. So are
+   * compressed leaves, which the full traversal expands
+   */
+  bool LoadLeafFinger(NodeID node_id, Context *context_p) {
+    if(node_id == INVALID_NODE_ID) {
+      return false;
+    }
 
-          node_p = split_node_p->child_node_p;
+    const BaseNode *node_p = GetNode(node_id);
 
-          break;
-        } // case LeafSplitType
-        default: {
-          bwt_printf("ERROR: Unknown leaf delta node type: %d\n",
-                     static_cast<int>(node_p->GetType()));
+    if(node_p == nullptr || node_p->IsOnLeafDeltaChain() == false) {
+      return false;
+    }
 
-          assert(false);
-        } // default
-      } // switch
-    } // while
+    switch(node_p->GetType()) {
+      case NodeType::LeafSplitType:
+      case NodeType::LeafRemoveType:
+      case NodeType::LeafMergeType:
+      case NodeType::LeafCompressedType:
+        return false;
+      default:
+        break;
+    }
 
-    // We cannot reach here
-    assert(false);
-    return nullptr;
+    if(node_p->IsDeltaNode() == true) {
+      if(node_p->GetDepth() >= GetLeafDeltaChainThreshold(node_id)) {
+        return false;
+      }
+    } else {
+      size_t node_size = \
+        static_cast<const LeafNode *>(node_p)->GetItemCount();
+
+      if(node_size >= static_cast<size_t>(leaf_node_size_upper_threshold)) {
+        return false;
+      }
+
+      if(node_size <= static_cast<size_t>(leaf_node_size_lower_threshold) && \
+         (node_size == 0UL || IsMergeExempt(node_p) == false)) {
+        return false;
+      }
+    }
+
+    if(IsKeyInNodeRange(context_p->search_key, node_p) == false) {
+      return false;
+    }
+
+    RecordNodeVisit(node_p);
+
+    #ifdef BWTREE_DEBUG
+    context_p->current_level = 0;
+    #endif
+
+    // There is no parent on the path, as if the leaf were the root
+    context_p->parent_snapshot.node_id = INVALID_NODE_ID;
+    context_p->current_snapshot.node_id = node_id;
+    context_p->current_snapshot.node_p = node_p;
+
+    return true;
   }
+
+  ///////////////////////////////////////////////////////////////////
+  // Data Storage Core
+  ///////////////////////////////////////////////////////////////////
   
   /*
-   * NavigateLeafNode() - Apply predicate to all values, and detect for existing
-   *                      value for insert
-   *
-   * This function cooperates with ConditionalInsert() which requires applying
-   * a predicate to all existing values, and insert the value if and only if:
-   *
-   * 1. The predicate is not satisfied on all existing values
-   * 2. The value does not yet exists in the leaf delta chain
-   *
-   * If any of the above two are true, then we should not insert:
+   * NavigateSiblingChain() - Traverse on sibling chain to adjust current
+   *                          position so that the range of the node matches
+   *                          the search key
    *
-   * 1. If predicate is satisfied by an existing value, return nullptr and
-   *    argument predicate_satisfied is set to true
-   * 2. If predicate is not satisfied, but the value already exists, then
-   *    return nullptr but argument predicate_satisfied is unchanged
+   * This function detects node range using the topmost node's high key
+   * since it is guaranteed that topmost high key is always the correct
+   * high key for us to use
    *
-   * If both conditions are true then we always test predicate first
-   * and then test for existence
+   * NOTE: This function cannot traverse to a sibling node of a different
+   * parent node than the current parent node, because we also do
+   * a key range validation on the parent node, it is impossible that the
+   * parent node contains a child node whose range is outside the parent
+   * node's range. Therefore when posting on the parent node there is no need
+   * for us to validate key range.
    *
-   * If only one condition are true then it depends on the order we
-   * traverse the delta chain and leaf data node, and could not be
-   * guaranteed a specific order
+   * If the traverse aborts then this function returns with abort_flag
+   * setting to true.
    */
-  const KeyValuePair *
-  NavigateLeafNode(Context *context_p,
-                   const ValueType &value,
-                   std::pair<int, bool> *index_pair_p,
-                   std::function<bool(const void *)> predicate,
-                   bool *predicate_satisfied) {
+  void NavigateSiblingChain(Context *context_p) {
+    do {
+      // These two will be updated everytime we switch to
+      // a new node
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+      const BaseNode *node_p = snapshot_p->node_p;
+      
+      // Before node navigation, the first thing to do is to verify
+      // that we are on the correct node according to the current
+      // search key
+      // This procedure does not necessarily need a split node to do right
+      // traversal (but it needs to complete any SMO if there is one, so
+      // it must be called after FinishPartialSMO() returns), because
+      // the high key of split node will be inherited by all nodes
+      // posted later and by the consolidated version of the node
+      if((node_p->GetNextNodeID() != INVALID_NODE_ID) &&
+         (KeyCmpGreaterEqual(context_p->search_key, node_p->GetHighKey()))) {
+        bwt_printf("Bounds checking failed (id = %lu) - "
+                   "Go right.\n",
+                   snapshot_p->node_id);
 
+        JumpToNodeID(node_p->GetNextNodeID(), context_p);
 
-    // NOTE: We do not have to traverse to the right sibling here
-    // since Traverse() already traverses to the right sibling
-    // if value pointer given to it is nullptr
-    // So we are guaranteed that we are always on the correct leaf
-    // page delta chain on entry of this function
+        if(context_p->abort_flag == true) {
+          bwt_printf("JumpToNodeID aborts(). ABORT\n");
 
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-    const BaseNode *node_p = snapshot_p->node_p;
+          return;
+        }
 
-    assert(snapshot_p->IsLeaf() == true);
+      } else {
+        break;
+      }
+    } while(1);
+    
+    return;
+  }
+  
+  /*
+   * NavigateSiblingChainBI() - Navigates sibling chain for backward iteration
+   *
+   * This function traverses to the right sibling of the current node only if
+   * the search key > current high key. In the case of search key == high key
+   * we stay on the same node to enable finding the left node of the node with
+   * the search key as low key
+   */
+  void NavigateSiblingChainBI(Context *context_p) {
+    while(1) {
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+      const BaseNode *node_p = snapshot_p->node_p;
+      if((node_p->GetNextNodeID() != INVALID_NODE_ID) &&
+         (KeyCmpGreater(context_p->search_key, node_p->GetHighKey()))) {
+        bwt_printf("Bounds checking for BI failed (id = %lu) - "
+                   "Go right.\n",
+                   snapshot_p->node_id);
 
-    const KeyType &search_key = context_p->search_key;
+        JumpToNodeID(node_p->GetNextNodeID(), context_p);
+        if(context_p->abort_flag == true) {
+          bwt_printf("JumpToNodeID() aborts for BI. ABORT\n");
+          return;
+        }
+      } else {
+        break;
+      }
+    } // while(1)
+    
+    return;
+  }
 
-    const int set_max_size = node_p->GetDepth();
+  ///////////////////////////////////////////////////////////////////
+  // Intra-node key search
+  ///////////////////////////////////////////////////////////////////
 
-    const ValueType *present_set_data_p[set_max_size];
-    const ValueType *deleted_set_data_p[set_max_size];
+  // Whether keys could be compared with raw integer comparison. In this
+  // case we use a search routine without data dependent branches
+  static constexpr bool INTEGER_KEY_SEARCH = \
+    std::is_integral<KeyType>::value && \
+    std::is_same<KeyComparator, std::less<KeyType>>::value;
 
-    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
-      present_set{present_set_data_p,
-                  value_eq_obj,
-                  value_hash_obj};
+  /*
+   * KeyLowerBound() - Returns the first element whose key is >= search key
+   *
+   * This works on both KeyNodeIDPair and KeyValuePair arrays since only
+   * the key part of the element is compared
+   */
+  template <typename ElementType>
+  inline const ElementType *KeyLowerBound(const ElementType *start_p,
+                                          const ElementType *end_p,
+                                          const KeyType &search_key) const {
+    return KeySearch<false>(start_p,
+                            end_p,
+                            search_key,
+                            std::integral_constant<bool, INTEGER_KEY_SEARCH>{});
+  }
 
-    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
-      deleted_set{deleted_set_data_p,
-                  value_eq_obj,
-                  value_hash_obj};
+  /*
+   * KeyUpperBound() - Returns the first element whose key is > search key
+   */
+  template <typename ElementType>
+  inline const ElementType *KeyUpperBound(const ElementType *start_p,
+                                          const ElementType *end_p,
+                                          const KeyType &search_key) const {
+    return KeySearch<true>(start_p,
+                           end_p,
+                           search_key,
+                           std::integral_constant<bool, INTEGER_KEY_SEARCH>{});
+  }
 
-    while(1) {
-      NodeType type = node_p->GetType();
+  /*
+   * BatchKeyLowerBound() - Returns the first embedded insert node of a batch
+   *                        node whose key is >= search key
+   */
+  inline const LeafInsertNode *
+  BatchKeyLowerBound(const LeafBatchInsertNode *batch_node_p,
+                     const KeyType &search_key) const {
+    return std::partition_point(
+      batch_node_p->Begin(),
+      batch_node_p->End(),
+      [this, &search_key](const LeafInsertNode &insert_node) {
+        return KeyCmpLess(insert_node.item.first, search_key);
+      });
+  }
 
-      switch(type) {
-        case NodeType::LeafType: {
-          const LeafNode *leaf_node_p = \
-            static_cast<const LeafNode *>(node_p);
+  /*
+   * KeySearch() - Generic version of key search using the key comparator
+   *
+   * Elements before the returned pointer have keys < search key if
+   * UPPER_BOUND is false, or keys <= search key if UPPER_BOUND is true
+   */
+  template <bool UPPER_BOUND, typename ElementType>
+  inline const ElementType *KeySearch(const ElementType *start_p,
+                                      const ElementType *end_p,
+                                      const KeyType &search_key,
+                                      std::false_type) const {
+    return std::partition_point(start_p,
+                                end_p,
+                                [this, &search_key](const ElementType &element) {
+      return UPPER_BOUND ? \
+             !KeyCmpLess(search_key, element.first) : \
+             KeyCmpLess(element.first, search_key);
+    });
+  }
 
-          auto copy_start_it = \
-            std::lower_bound(leaf_node_p->Begin(),
-                             leaf_node_p->End(),
-                             std::make_pair(search_key, ValueType{}),
-                             key_value_pair_cmp_obj);
+  /*
+   * KeySearch() - Integer key version of key search
+   *
+   * For short ranges we count the number of elements before the search key
+   * using a linear scan, which has no data dependent branch and could be
+   * vectorized by the compiler. Otherwise we use a binary search whose
+   * only branch is the loop condition that only depends on the range size.
+   * Neither needs the key array to be contiguous, which is not true in
+   * ElasticNode since keys are interleaved with NodeIDs or values
+   *
+   * NOTE: Both branches return exactly the same result as std::lower_bound()
+   * and std::upper_bound()
+   */
+  template <bool UPPER_BOUND, typename ElementType>
+  inline const ElementType *KeySearch(const ElementType *start_p,
+                                      const ElementType *end_p,
+                                      const KeyType &search_key,
+                                      std::true_type) const {
+    size_t size = static_cast<size_t>(end_p - start_p);
+
+    if(size <= INTEGER_KEY_LINEAR_SEARCH_THRESHOLD) {
+      size_t count = 0UL;
+      for(size_t i = 0;i < size;i++) {
+        count += UPPER_BOUND ? \
+                 (start_p[i].first <= search_key) : \
+                 (start_p[i].first < search_key);
+      }
 
-          while((copy_start_it != leaf_node_p->End()) && \
-                (KeyCmpEqual(search_key, copy_start_it->first))) {
-            if(deleted_set.Exists(copy_start_it->second) == false) {
-              if(present_set.Exists(copy_start_it->second) == false) {
-                
-                // If the predicate is satified by the value
-                // then return with predicate flag set to true
-                // Otherwise test for duplication
-                if(predicate(copy_start_it->second) == true) {
-                  *predicate_satisfied = true;
-                  
-                  return nullptr;
-                } else if(value_eq_obj(value, copy_start_it->second) == true) {
-                  // We will not insert anyway....
-                  return &(*copy_start_it);
-                }
-              }
-            }
+      return start_p + count;
+    }
 
-            copy_start_it++;
-          }
-          
-          // The index is the last element (this is true even if we have seen a
-          // leaf delete node, since the delete node must have deleted a
-          // value that does not exist in leaf base node, so that inserted value
-          // must have the same index)
-          index_pair_p->first = copy_start_it - leaf_node_p->Begin();
-          // Value does not exist
-          index_pair_p->second = false;
+    // Invariant: The result is always inside [start_p, start_p + size]
+    while(size > 1) {
+      size_t half = size / 2;
+      bool go_right = UPPER_BOUND ? \
+                      (start_p[half].first <= search_key) : \
+                      (start_p[half].first < search_key);
 
-          // Only if we return here could we insert
-          return nullptr;
-        }
-        case NodeType::LeafInsertType: {
-          const LeafInsertNode *insert_node_p = \
-            static_cast<const LeafInsertNode *>(node_p);
+      // This is usually compiled into a conditional move
+      start_p = go_right ? (start_p + half) : start_p;
+      size -= half;
+    }
 
-          if(KeyCmpEqual(search_key, insert_node_p->item.first)) {
-            if(deleted_set.Exists(insert_node_p->item.second) == false) {
-              if(present_set.Exists(insert_node_p->item.second) == false) {
-                present_set.Insert(insert_node_p->item.second);
+    return start_p + (UPPER_BOUND ? \
+                      (start_p->first <= search_key) : \
+                      (start_p->first < search_key));
+  }
 
-                // LeafInsertNode means this value exists
-                if(predicate(insert_node_p->item.second) == true) {
-                  *predicate_satisfied = true;
+  ///////////////////////////////////////////////////////////////////
+  // Separator key truncation
+  ///////////////////////////////////////////////////////////////////
 
-                  // Could return here since we know the predicate is satisfied
-                  return nullptr;
-                } else if(value_eq_obj(value, insert_node_p->item.second) == true) {
-                  // Could also return here since we know the value exists
-                  // and we could not insert anyway
-                  return &insert_node_p->item;
-                } // test predicate and duplicates
-              } // if value not seen
-            } // if value not deleted
-          } // if key equal
+  // Whether keys are strings compared byte by byte. In this case a leaf
+  // split only needs the shortest prefix that separates the two halves
+  static constexpr bool STRING_KEY_SEPARATOR = \
+    std::is_same<KeyType, std::string>::value && \
+    std::is_same<KeyComparator, std::less<KeyType>>::value;
 
-          node_p = insert_node_p->child_node_p;
+  /*
+   * GetSeparatorKey() - Returns a key sep such that left < sep <= right
+   *
+   * left is the largest key on the left half of a split and right is the
+   * smallest key on the right half. The separator becomes the low key of
+   * the new sibling and is posted to the parent, and inner node splits
+   * reuse separators, so all levels above leaves only store shortened keys
+   */
+  static KeyType GetSeparatorKey(const KeyType &left, const KeyType &right) {
+    return GetSeparatorKey(left,
+                           right,
+                           std::integral_constant<bool,
+                                                  STRING_KEY_SEPARATOR>{});
+  }
 
-          break;
-        } // case LeafInsertType
-        case NodeType::LeafDeleteType: {
-          const LeafDeleteNode *delete_node_p = \
-            static_cast<const LeafDeleteNode *>(node_p);
-
-          if(KeyCmpEqual(search_key, delete_node_p->item.first)) {
-            if(present_set.Exists(delete_node_p->item.second) == false) {
-              // Even if we know the value does not exist, we still need
-              // to test all predicates to the leaf base node
-              deleted_set.Insert(delete_node_p->item.second);
-            }
-          }
-
-          node_p = delete_node_p->child_node_p;
-
-          break;
-        } // case LeafDeleteType
-        case NodeType::LeafRemoveType: {
-          bwt_printf("ERROR: Observed LeafRemoveNode in delta chain\n");
-
-          assert(false);
-        } // case LeafRemoveType
-        case NodeType::LeafMergeType: {
-          bwt_printf("Observed a merge node on leaf delta chain\n");
-
-          const LeafMergeNode *merge_node_p = \
-            static_cast<const LeafMergeNode *>(node_p);
+  /*
+   * GetSeparatorKey() - Generic version that uses the right key unmodified
+   */
+  static KeyType GetSeparatorKey(const KeyType &left,
+                                 const KeyType &right,
+                                 std::false_type) {
+    (void)left;
 
-          if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
-            bwt_printf("Take leaf merge right branch\n");
+    return right;
+  }
 
-            node_p = merge_node_p->right_merge_p;
-          } else {
-            bwt_printf("Take leaf merge left branch\n");
+  /*
+   * GetSeparatorKey() - String version that truncates the right key after
+   *                     the first byte that differs from the left key
+   *
+   * Since left < right, right could not be a prefix of left, and the
+   * truncated key is > left because it either has left as a proper prefix
+   * or has a larger byte at the first difference. Short separators also
+   * fit in the inline buffer of std::string, so comparing against them
+   * does not dereference a heap pointer
+   */
+  static KeyType GetSeparatorKey(const KeyType &left,
+                                 const KeyType &right,
+                                 std::true_type) {
+    size_t prefix_len = 0UL;
+    size_t min_len = std::min(left.size(), right.size());
+
+    while((prefix_len < min_len) && (left[prefix_len] == right[prefix_len])) {
+      prefix_len++;
+    }
 
-            node_p = merge_node_p->child_node_p;
-          }
+    assert(prefix_len < right.size());
 
-          break;
-        } // case LeafMergeType
-        case NodeType::LeafSplitType: {
-          bwt_printf("Observed a split node on leaf delta chain\n");
+    return right.substr(0, prefix_len + 1);
+  }
 
-          const LeafSplitNode *split_node_p = \
-            static_cast<const LeafSplitNode *>(node_p);
+  /*
+   * LocateSeparatorByKey() - Locate the child node for a key
+   *
+   * This functions works with any non-empty inner nodes. However
+   * it fails assertion with empty inner node
+   *
+   * NOTE: This function ignores the first element in the sep list
+   * since even if we know the low key of the first element
+   */
+  inline NodeID LocateSeparatorByKey(const KeyType &search_key,
+                                     const InnerNode *inner_node_p,
+                                     const KeyNodeIDPair *start_p,
+                                     const KeyNodeIDPair *end_p) {
+    // Inner node could not be empty
+    assert(inner_node_p->GetSize() != 0UL);
 
-          node_p = split_node_p->child_node_p;
+    // The search index only covers the whole array. If the range has been
+    // narrowed by delta records then we search the array directly
+    if((inner_node_p->GetSearchIndex() != nullptr) &&
+       (start_p == inner_node_p->Begin() + 1) &&
+       (end_p == inner_node_p->End())) {
+      return SearchInnerSearchIndex(search_key, inner_node_p);
+    }
 
-          break;
-        } // case LeafSplitType
-        default: {
-          bwt_printf("ERROR: Unknown leaf delta node type: %d\n",
-                     static_cast<int>(node_p->GetType()));
+    // This finds the first element > search key
+    auto it = KeyUpperBound(start_p, end_p, search_key) - 1;
+#ifdef BWTREE_DEBUG
+    //auto it2 = std::upper_bound(inner_node_p->Begin() + 1,
+    //                           inner_node_p->End(),
+    //                           std::make_pair(search_key, INVALID_NODE_ID),
+    //                           key_node_id_pair_cmp_obj) - 1;
+                               
+    //assert(it == it2);
+#endif
 
-          assert(false);
-        } // default
-      } // switch
-    } // while
+    // Since upper_bound returns the first element > given key
+    // so we need to decrease it to find the last element <= given key
+    // which is out separator key
+    return it->second;
+  }
+  
+  /*
+   * LocateSeparatorByKeyBI() - Same as locate separator by key but it 
+   *                            goes left when we see the selected separator
+   *                            being the search key
+   *
+   * This function guarantees to find a left key if we see the separator
+   * being the search key. This is because if there is not a left key then we
+   * we must have come down from a node where the search key is its separator
+   * key (remember that the separator key is the low key of ots child node)
+   */
+  inline NodeID LocateSeparatorByKeyBI(const KeyType &search_key,
+                                       const InnerNode *inner_node_p) {
+    assert(inner_node_p->GetSize() != 0UL);
+    auto it = KeyUpperBound(inner_node_p->Begin() + 1,
+                            inner_node_p->End(),
+                            search_key) - 1;
 
-    // We cannot reach here
-    assert(false);
-    return nullptr;
+    if(KeyCmpEqual(it->first, search_key) == true) {
+      // If search key is the low key then we know we should have already
+      // gone left on the parent node
+      assert(it != inner_node_p->Begin());
+      
+      // Go to the left separator to find the left node with range < search key
+      // After decreament it might or might not be the low key
+      it--; 
+    }
+    
+    return it->second;
   }
 
   /*
-   * CollectAllValuesOnLeaf() - Consolidate delta chain for a single logical
-   *                            leaf node
+   * NavigateInnerNode() - Traverse down through the inner node delta chain
+   *                       and probably horizontally to right sibling nodes
    *
-   * This function is the non-recursive wrapper of the resursive core function.
-   * It calls the recursive version to collect all base leaf nodes, and then
-   * it replays delta records on top of them.
+   * This function does not have to always reach the base node in order to
+   * find the target since we know for inner nodes it is always single key
+   * single node mapping. Therefore there is neither need to keep a delta
+   * pointer list to recover full key-value mapping, nor returning a base node
+   * pointer to test low key and high key.
    *
-   * If leaf_node_p is nullptr (default) then a new leaf node instance is 
-   * created; Otherwise we simply use the existing pointer *WITHOUT* performing
-   * any initialization. This implies that the caller should initialize
-   * a valid LeafNode object before calling this function
+   * However, if we have reached a base node, for debugging purposes we
+   * need to test current search key against low key and high key
+   *
+   * NOTE: This function returns a NodeID, instead of NodeSnapshot since
+   * its behaviour is not dependent on the actual content of the physical
+   * pointer associated with the node ID, so we could choose to fix the
+   * snapshot later
+   *
+   * NOTE: This function will jump to a sibling if the current node is on
+   * a half split state. If this happens, then the flag inside snapshot_p
+   * is set to true, and also the corresponding NodeId and BaseNode *
+   * will be updated to reflect the newest sibling ID and pointer.
+   * After returning of this function please remember to check the flag
+   * and update path history. (Such jump may happen multiple times, so
+   * do not make any assumption about how jump is performed)
    */
-  LeafNode *CollectAllValuesOnLeaf(NodeSnapshot *snapshot_p,
-                                   LeafNode *leaf_node_p=nullptr) {
-    assert(snapshot_p->IsLeaf() == true);
-
-    const BaseNode *node_p = snapshot_p->node_p;
-    
-    /////////////////////////////////////////////////////////////////
-    // Prepare new node
-    /////////////////////////////////////////////////////////////////
+  NodeID NavigateInnerNode(Context *context_p) {
+    // This will go to the right sibling until we have seen
+    // a node whose range match the search key
+    NavigateSiblingChain(context_p);
 
-    if(likely(leaf_node_p == nullptr)) {
-      leaf_node_p = \
-        reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
-          Get(node_p->GetItemCount(),
-              NodeType::LeafType,
-              0,
-              node_p->GetItemCount(),
-              node_p->GetLowKeyPair(),
-              node_p->GetHighKeyPair()));
+    // If navigating sibling chain aborts then abort here
+    if(unlikely(context_p->abort_flag == true)) {
+      return INVALID_NODE_ID;
     }
     
-    assert(leaf_node_p != nullptr);
-    
     /////////////////////////////////////////////////////////////////
-    // Prepare Delta Set
+    // Only after this point could we get snapshot and node_p
     /////////////////////////////////////////////////////////////////
     
-    // This is the number of delta records inside the logical node
-    // including merged delta chains
-    int delta_change_num = node_p->GetDepth();
+    // This search key will not be changed during navigation
+    const KeyType &search_key = context_p->search_key;
 
-    // We only need to keep those on the delta chian into a set
-    // and those in the data list of leaf page do not need to be
-    // put in the set
-    // This is used to dedup already seen key-value pairs
-    const KeyValuePair *delta_set_data_p[delta_change_num];
+    // First get the snapshot from context
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
 
-    // This set is used as the set for deduplicating already seen
-    // key value pairs
-    KeyValuePairBloomFilter delta_set{delta_set_data_p,
-                                      key_value_pair_eq_obj,
-                                      key_value_pair_hash_obj};
-                                        
-    /////////////////////////////////////////////////////////////////
-    // Prepare Small Sorted Set
-    /////////////////////////////////////////////////////////////////
-    
-    const LeafDataNode *sss_data_p[delta_change_num];
-    
-    auto f1 = [this](const LeafDataNode *ldn1, const LeafDataNode *ldn2) {
-      // Compare using key first; if keys are equal then compare using
-      // index (since we must pop those nodes in a key-order given the index)
-      // NOTE: Since in leaf node keys are sorted, if keys are sorted then
-      // indices only needs sorting inside the range of the key
-      if(this->key_cmp_obj(ldn1->item.first, ldn2->item.first)) {
-        return true;
-      } else if(this->key_eq_obj(ldn1->item.first, ldn2->item.first)) {
-        return ldn1->GetIndexPair().first < ldn2->GetIndexPair().first;
-      } else {
-        return false;
-      }
-    };
-    
-    // This is not used since in this case we do not need to compare
-    // for equal relation
-    auto f2 = [this](const LeafDataNode *ldn1, const LeafDataNode *ldn2) {
-      (void)ldn1;
-      (void)ldn2;
-      
-      assert(false);
-      return false;
-    };
+    // Save some keystrokes
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    // Make sure the structure is valid
+    assert(snapshot_p->IsLeaf() == false);
+    assert(snapshot_p->node_p != nullptr);
     
-    // Declare an sss object with the previously declared comparators and
-    // null equality checkers (not used)
-    SortedSmallSet<const LeafDataNode *, decltype(f1), decltype(f2)> \
-      sss{sss_data_p, f1, f2};
+    // For read only workload this is always true since we do not need
+    // to remember the node ID for read - read is always stateless until
+    // it has reached a leaf node
+    assert(snapshot_p->node_id != INVALID_NODE_ID);
+
+    bwt_printf("Navigating inner node delta chain...\n");
     
-    /////////////////////////////////////////////////////////////////
-    // Start collecting values!
-    /////////////////////////////////////////////////////////////////
+    // Always start with the first element
+    const KeyNodeIDPair *start_p = \
+      InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->Begin() + 1;
+    // Use low key pair to find base node and then use base node pointer to find
+    // total number of elements in the array. We search in this array later
+    const KeyNodeIDPair *end_p = \
+      InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->End();
 
-    // We collect all valid values in present_set
-    // and deleted_set is just for bookkeeping
-    CollectAllValuesOnLeafRecursive(node_p,
-                                    sss,
-                                    delta_set,
-                                    leaf_node_p);
+    while(1) {
+      NodeType type = node_p->GetType();
 
-    // Item count would not change during consolidation
-    assert(leaf_node_p->GetSize() == node_p->GetItemCount());
+      switch(type) {
+        case NodeType::InnerType: {
+          const InnerNode *inner_node_p = \
+            static_cast<const InnerNode *>(node_p);
 
-    return leaf_node_p;
-  }
+          // We always use the ubound recorded inside the top of the
+          // delta chain
+          NodeID target_id = \
+            LocateSeparatorByKey(search_key, 
+                                 inner_node_p, 
+                                 start_p, 
+                                 end_p);
 
-  /*
-   * CollectAllValuesOnLeafRecursive() - Collect all values given a
-   *                                     pointer recursively
-   *
-   * It does not need NodeID to collect values since only read-only
-   * routine calls this one, so no validation is ever needed even in
-   * its caller.
-   *
-   * This function only travels using physical pointer, which implies
-   * that it does not deal with LeafSplitNode and LeafRemoveNode
-   * For LeafSplitNode it only collects value on child node
-   * For LeafRemoveNode it fails assertion
-   * If LeafRemoveNode is not the topmost node it also fails assertion
-   *
-   * NOTE: This function calls itself to collect values in a merge node
-   * since logically speaking merge node consists of two delta chains
-   * DO NOT CALL THIS DIRECTLY - Always use the wrapper (the one without
-   * "Recursive" suffix)
-   */
-  template <typename T>  // To let the compiler deduce type of sss
-  void
-  CollectAllValuesOnLeafRecursive(const BaseNode *node_p,
-                                  T &sss,
-                                  KeyValuePairBloomFilter &delta_set,
-                                  LeafNode *new_leaf_node_p) const {
-    // The top node is used to derive high key
-    // NOTE: Low key for Leaf node and its delta chain is nullptr
-    const KeyNodeIDPair &high_key_pair = node_p->GetHighKeyPair();
+          bwt_printf("Found child in inner node; child ID = %lu\n",
+                     target_id);
 
-    while(1) {
-      NodeType type = node_p->GetType();
+          return target_id;
+        } // case InnerType
+        case NodeType::InnerInsertType: {
+          const InnerInsertNode *insert_node_p = \
+            static_cast<const InnerInsertNode *>(node_p);
 
-      switch(type) {
-        // When we see a leaf node, just copy all keys together with
-        // all values into the value set
-        case NodeType::LeafType: {
-          const LeafNode *leaf_node_p = \
-            static_cast<const LeafNode *>(node_p);
+          const KeyNodeIDPair &insert_item = insert_node_p->item;
+          const KeyNodeIDPair &next_item = insert_node_p->next_item;
 
-          // We compute end iterator based on the high key
-          const KeyValuePair *copy_end_it;
+          // This comparison servers two purposes:
+          //   1. Check whether we could use it to do a quick jump
+          //   2. Update start_index or end_index depending on the 
+          //      result of comparison
+          if(KeyCmpGreaterEqual(search_key, insert_item.first)) {
+            if((next_item.second == INVALID_NODE_ID) ||
+               (KeyCmpLess(search_key, next_item.first))) {
+              bwt_printf("Find target ID = %lu in insert delta\n",
+                         insert_item.second);
 
-          // If the high key is +Inf then all items could be copied
-          if((high_key_pair.second == INVALID_NODE_ID)) {
-            copy_end_it = leaf_node_p->End();
+              return insert_item.second;
+            }
+            
+            start_p = std::max(start_p, insert_node_p->location);
           } else {
-            // This points copy_end_it to the first element >= current high key
-            // If no such element exists then copy_end_it is end() iterator
-            // which is also consistent behavior
-            copy_end_it = std::lower_bound(leaf_node_p->Begin(),
-                                           leaf_node_p->End(),
-                                           // It only compares key so we
-                                           // just use high key pair
-                                           std::make_pair(high_key_pair.first, ValueType{}),
-                                           key_value_pair_cmp_obj);
+            end_p = std::min(end_p, insert_node_p->location);
           }
           
-          // This is the index of the copy end it
-          int copy_end_index = \
-            static_cast<int>(copy_end_it - leaf_node_p->Begin());
-          int copy_start_index = 0;
-
-          ///////////////////////////////////////////////////////////
-          // Find the end index for sss
-          ///////////////////////////////////////////////////////////
+          break;
+        } // InnerInsertType
+        case NodeType::InnerDeleteType: {
+          const InnerDeleteNode *delete_node_p = \
+            static_cast<const InnerDeleteNode *>(node_p);
 
-          // Find the end of copying
-          auto sss_end_it = sss.GetEnd() - 1;
+          const KeyNodeIDPair &prev_item = delete_node_p->prev_item;
+          const KeyNodeIDPair &next_item = delete_node_p->next_item;
 
-          // If the next key is +Inf then sss_end_it is the real end of the
-          // sorted array
-          if(high_key_pair.second != INVALID_NODE_ID) {
-            // Corner case: If the first element is lower bound
-            // then current_p will move outside
-            // the valid range of the array but still we return
-            // the first element in the array
-            while(sss_end_it >= sss.GetBegin()) {
-              if(key_cmp_obj((*sss_end_it)->item.first, high_key_pair.first) == true) {
-                break;
-              }
+          // NOTE: Low key ID will not be changed (i.e. being deleted or
+          // being preceded by other key-NodeID pair)
+          // If the prev item is the leftmost item then we do not need to
+          // compare since we know the search key is definitely greater than
+          // or equal to the low key (this is necessary to prevent comparing
+          // with -Inf)
+          // NOTE: Even if the inner node is merged into its left sibling
+          // this is still true since we compared prev_item.second
+          // with the low key of the current delete node which always
+          // reflects the low key of this branch
+          if((delete_node_p->GetLowKeyNodeID() == prev_item.second) ||
+             (KeyCmpGreaterEqual(search_key, prev_item.first))) {
+            // If the next item is +Inf key then we also choose not to compare
+            // keys directly since we know the search key is definitely smaller
+            // then +Inf
+            if((next_item.second == INVALID_NODE_ID) ||
+               (KeyCmpLess(search_key, next_item.first))) {
+              bwt_printf("Find target ID = %lu in delete delta\n",
+                         prev_item.second);
 
-              sss_end_it--;
+              return prev_item.second;
             }
           }
-
-          // This points to the first element >= high key
-          sss_end_it++;
           
-          ///////////////////////////////////////////////////////////
-          // Start merge loop
-          ///////////////////////////////////////////////////////////
+          // Use the deleted key to do a divide - all keys less than
+          // it is on the left of the index recorded in this InnerInsertNode
+          // Otherwise it is to the right of it
+          if(KeyCmpGreaterEqual(search_key, delete_node_p->item.first) == true) {
+            start_p = std::max(delete_node_p->location, start_p);
+          } else {
+            end_p = std::min(delete_node_p->location, end_p);
+          } 
 
-          // While the sss has not reached the end for this node
-          while(sss.GetBegin() != sss_end_it) {
-            int current_index = sss.GetFront()->GetIndexPair().first;
-            
-            // If we did not see any overwriting delta then
-            // we also copy the old item in leaf node
-            bool item_overwritten = false;
-            
-            assert(copy_start_index <= current_index);
-            assert(current_index <= copy_end_index);
-            
-            // First copy all items before the current index
-            new_leaf_node_p->PushBack(
-              leaf_node_p->Begin() + copy_start_index,
-              leaf_node_p->Begin() + current_index);
+          break;
+        } // InnerDeleteType
+        case NodeType::InnerSplitType: {
+          break;
+        } // case InnerSplitType
+        case NodeType::InnerMergeType: {
+          const InnerMergeNode *merge_node_p = \
+            static_cast<const InnerMergeNode *>(node_p);
 
-            // Update copy start index for next copy
-            copy_start_index = current_index;
-            
-            // Drain delta records on the same index
-            while(sss.GetFront()->GetIndexPair().first == current_index) {
-              // Update current status of the item on leaf base node
-              // IndexPair.second == true if the value has been overwritten
-              item_overwritten = item_overwritten || sss.GetFront()->GetIndexPair().second;
-              
-              // We only insert those in LeafInsertNode
-              // and ignore all LeafDeleteNode
-              if(sss.GetFront()->GetType() == NodeType::LeafInsertType) {
-                // We remove the element from sss here
-                new_leaf_node_p->PushBack(sss.PopFront()->item);
-              } else {
-                assert(sss.GetFront()->GetType() == NodeType::LeafDeleteType);
+          const KeyType &merge_key = merge_node_p->delete_item.first;
 
-                // ... and here
-                sss.PopFront();
-              }
-              
-              // If we have drained sss
-              if(sss.GetBegin() == sss_end_it) {
-                break;
-              }
-            }
-            
-            // If the element has been overwritten by some of the deltas
-            // just advance the pointer
-            if(item_overwritten == true) {
-              copy_start_index++;
-            }
-          } // while sss has not reached the copy end
+          // Here since we will only take one branch, so
+          // high key does not need to be updated
+          // Since we still could not know the high key
+          if(KeyCmpGreaterEqual(search_key, merge_key)) {
+            bwt_printf("Take merge right branch (ID = %lu)\n",
+                       snapshot_p->node_id);
+
+            node_p = merge_node_p->right_merge_p;
+          } else {
+            bwt_printf("Take merge left branch (ID = %lu)\n",
+                       snapshot_p->node_id);
+
+            node_p = merge_node_p->child_node_p;
+          }
           
-          // Also need to insert all other elements if there are some
-          new_leaf_node_p->PushBack(leaf_node_p->Begin() + copy_start_index,
-                                    leaf_node_p->Begin() + copy_end_index);
+          // Since all indices are not invalidated, we do not know on which
+          // branch it is referring to
+          // After this point node_p has been updated as the newest branch we 
+          // are travelling on
+          start_p = \
+            InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->Begin() + 1;
+          end_p = \
+            InnerNode::GetNodeHeader(&node_p->GetLowKeyPair())->End();
 
-          return;
-        } // case LeafType
-        case NodeType::LeafInsertType: {
-          const LeafInsertNode *insert_node_p = \
-            static_cast<const LeafInsertNode *>(node_p);
+          // Note that we should jump to the beginning of the loop without 
+          // going to child node any further
+          continue;
+        } // InnerMergeType
+        default: {
+          bwt_printf("ERROR: Unknown node type = %d",
+                     static_cast<int>(type));
 
-          if(delta_set.Exists(insert_node_p->item) == false) {
-            delta_set.Insert(insert_node_p->item);
+          assert(false);
+        }
+      } // switch type
+      
+      node_p = static_cast<const DeltaNode *>(node_p)->child_node_p; 
+    } // while 1
 
-            sss.InsertNoDedup(insert_node_p);
-          }
+    // Should not reach here
+    assert(false);
+    return INVALID_NODE_ID;
+  }
+  
+  /*
+   * NavigateInnerNodeBI() - Traverses an InnerNode for backward iteration
+   *
+   * This function serves the same purpose as NavigateInnerNode() in a sense
+   * that it also traverses down the delta chain of an InnerNode and returns 
+   * an next level NodeID for later traversal.
+   *
+   * The difference between this function and NavigateInnerNode() is that
+   * this function will go left even if the search key is found. Similarly
+   * if the key happens to be the merge key in InnerMergeNode, we just take
+   * the left branch to avoid ending up in the node with low key == search key
+   */
+  NodeID NavigateInnerNodeBI(Context *context_p) {
+    NavigateSiblingChainBI(context_p);
+    if(context_p->abort_flag == true) {
+      return INVALID_NODE_ID;
+    }
+    
+    const KeyType &search_key = context_p->search_key;
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    assert(snapshot_p->IsLeaf() == false);
+    assert(snapshot_p->node_p != nullptr);
+    bwt_printf("Navigating inner node delta chain for BI...\n");
+
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::InnerType: {
+          NodeID target_id = \
+            LocateSeparatorByKeyBI(search_key, 
+                                    static_cast<const InnerNode *>(node_p));
+
+          bwt_printf("Found child in inner node (BI); child ID = %lu\n",
+                     target_id);
+
+          return target_id;
+        } 
+        case NodeType::InnerInsertType: {
+          const InnerInsertNode *insert_node_p = \
+            static_cast<const InnerInsertNode *>(node_p);
+
+          const KeyNodeIDPair &insert_item = insert_node_p->item;
+          const KeyNodeIDPair &next_item = insert_node_p->next_item;
+          if((next_item.second == INVALID_NODE_ID) ||
+             (KeyCmpLess(search_key, next_item.first))) {
+               
+            // *********************************************
+            // * NOTE: DO NOT PROCEED IF IT IS "==" RELATION
+            // *********************************************
+            
+            if(KeyCmpGreater(search_key, insert_item.first)) {
+              bwt_printf("Find target ID = %lu in insert delta (BI)\n",
+                         insert_item.second);
+
+              return insert_item.second;
+            }
+          }
+
+          node_p = insert_node_p->child_node_p;
+
+          break;
+        } // InnerInsertType
+        case NodeType::InnerDeleteType: {
+          const InnerDeleteNode *delete_node_p = \
+            static_cast<const InnerDeleteNode *>(node_p);
+
+          const KeyNodeIDPair &prev_item = delete_node_p->prev_item;
+          const KeyNodeIDPair &next_item = delete_node_p->next_item;
+
+          // *********************************************
+          // * NOTE: DO NOT PROCEED IF IT IS "==" RELATION
+          // *********************************************
+
+          if((delete_node_p->GetLowKeyNodeID() == prev_item.second) ||
+             (KeyCmpGreater(search_key, prev_item.first))) {
+            if((next_item.second == INVALID_NODE_ID) ||
+               (KeyCmpLess(search_key, next_item.first))) {
+              bwt_printf("Find target ID = %lu in delete delta (BI)\n",
+                         prev_item.second);
+
+              return prev_item.second;
+            }
+          }
+
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // InnerDeleteType
+        case NodeType::InnerSplitType: {
+          node_p = static_cast<const InnerSplitNode *>(node_p)->child_node_p;
+          break;
+        } // case InnerSplitType
+        case NodeType::InnerMergeType: {
+          const InnerMergeNode *merge_node_p = \
+            static_cast<const InnerMergeNode *>(node_p);
+
+          const KeyType &merge_key = merge_node_p->delete_item.first;
+
+          // ************************************************
+          // * NOTE: GO TO LEFT BRANCH IF IT IS "==" RELATION
+          // ************************************************
+
+          if(KeyCmpGreater(search_key, merge_key)) {
+            bwt_printf("Take merge right branch (ID = %lu) for BI\n",
+                       snapshot_p->node_id);
+
+            node_p = merge_node_p->right_merge_p;
+          } else {
+            bwt_printf("Take merge left branch (ID = %lu) for BI\n",
+                       snapshot_p->node_id);
+
+            node_p = merge_node_p->child_node_p;
+          }
+
+          break;
+        } // InnerMergeType
+        default: {
+          bwt_printf("ERROR: Unknown or unsupported node type = %d",
+                     static_cast<int>(type));
+
+          assert(false);
+        }
+      } // switch type
+    } // while 1
+
+    // Should not reach here
+    assert(false);
+    return INVALID_NODE_ID;
+  }
+
+  /*
+   * CollectAllSepsOnInner() - Collect all separators given a snapshot
+   *
+   * This function consolidates a given delta chain given the node snapshot.
+   * Consolidation takes place by using a deleted set and present set to record
+   * values already deleted and still exist in the current node, to achieve
+   * the same effect as a log replay.
+   *
+   * This function returns an inner node with all Key-NodeID pairs
+   * sorted by the key order
+   *
+   * NOTE: This function could take an optional depth argument indicating the
+   * depth of the newly constructed InnerNode. This is majorly used by other
+   * proceures where parent node is consolidated and scanned in order to find
+   * a certain key.
+   *
+   * NOTE 2: If search_index_flag is true then the search index is also built
+   * for the new node (see BuildInnerSearchIndex())
+   */
+  InnerNode *CollectAllSepsOnInner(NodeSnapshot *snapshot_p,
+                                   int p_depth = 0,
+                                   bool search_index_flag = false) {
+
+    // Note that in the recursive call node_p might change
+    // but we should not change the metadata
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    // This is the number of insert + delete records which contributes
+    // to the size of the bloom filter
+    int delta_record_num = node_p->GetDepth();
+
+    // This array will hold sorted InnerDataNode pointers in order to
+    // perform a log merging
+    const InnerDataNode *data_node_list[delta_record_num];
+
+    // These two are used to compare InnerDataNode for < and == relation
+    auto f1 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
+                      return this->key_cmp_obj(idn_1->item.first, idn_2->item.first);
+                    };
+
+    auto f2 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
+                      return this->key_eq_obj(idn_1->item.first, idn_2->item.first);
+                    };
+
+    SortedSmallSet<const InnerDataNode *, decltype(f1), decltype(f2)> \
+      sss{data_node_list, f1, f2};
+
+    search_index_flag = search_index_flag && INNER_SEARCH_INDEX_SUPPORTED;
+
+    // The effect of this function is a consolidation into inner node
+    InnerNode *inner_node_p = \
+      reinterpret_cast<InnerNode *>( \
+        ElasticNode<KeyNodeIDPair>::\
+          Get(node_p->GetItemCount(),
+              NodeType::InnerType,
+              p_depth,
+              node_p->GetItemCount(),
+              node_p->GetLowKeyPair(),
+              node_p->GetHighKeyPair(),
+              search_index_flag ? \
+                GetInnerSearchIndexSize(node_p->GetItemCount()) : 0UL));
+
+    // The first element is always the low key
+    // since we know it will never be deleted
+    // We do this because for an InnerNode, its first separator key is just
+    // a placeholder and never used (reading its content causes undefined 
+    // behavior), because there is one more NodeID than separators
+    inner_node_p->PushBack(node_p->GetLowKeyPair());
+
+    // This will fill in two sets with values present in the inner node
+    // and values deleted
+    CollectAllSepsOnInnerRecursive(node_p,
+                                   node_p->GetLowKeyNodeID(),
+                                   sss,
+                                   inner_node_p);
+
+    // Since consolidation would not change item count they must be equal
+    // Also allocated space should be used exactly as described in the
+    // construction function
+    assert(inner_node_p->GetSize() == node_p->GetItemCount());
+    assert(inner_node_p->GetSize() == inner_node_p->GetItemCount());
+
+    if(search_index_flag == true) {
+      BuildInnerSearchIndex(inner_node_p);
+    }
+
+    return inner_node_p;
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Cold leaf compression
+  ///////////////////////////////////////////////////////////////////
+
+  // Items are encoded as differences between integers
+  static constexpr bool LEAF_COMPRESSION_SUPPORTED = \
+    std::is_integral<KeyType>::value && \
+    std::is_integral<ValueType>::value;
+
+  // The maximum number of bytes of a varint encoding 64 bits
+  static constexpr size_t VARINT_SIZE_MAX = 10UL;
+
+  /*
+   * EncodeVarint() - Writes 7 bits per byte with the high bit set on all
+   *                  bytes but the last one, and returns the next byte
+   */
+  static unsigned char *EncodeVarint(unsigned char *p, uint64_t x) {
+    while(x >= 0x80UL) {
+      *p++ = static_cast<unsigned char>(x | 0x80UL);
+      x >>= 7;
+    }
+
+    *p++ = static_cast<unsigned char>(x);
+
+    return p;
+  }
+
+  /*
+   * DecodeVarint() - Reads a varint written by EncodeVarint(), and returns
+   *                  the next byte
+   */
+  static const unsigned char *DecodeVarint(const unsigned char *p,
+                                           uint64_t *x_p) {
+    uint64_t x = 0UL;
+    int shift = 0;
+
+    while((*p & 0x80) != 0) {
+      x |= static_cast<uint64_t>(*p++ & 0x7F) << shift;
+      shift += 7;
+    }
+
+    *x_p = x | (static_cast<uint64_t>(*p++) << shift);
+
+    return p;
+  }
+
+  /*
+   * ZigZagEncode() - Maps a difference taken modulo 2^64 to an integer that
+   *                  is small if the difference is close to 0 in either
+   *                  direction
+   */
+  static inline uint64_t ZigZagEncode(uint64_t diff) {
+    return (diff << 1) ^ \
+           static_cast<uint64_t>(static_cast<int64_t>(diff) >> 63);
+  }
+
+  static inline uint64_t ZigZagDecode(uint64_t x) {
+    return (x >> 1) ^ (0UL - (x & 1UL));
+  }
+
+  /*
+   * EncodeLeafItems() - Encodes all items of a leaf node into the buffer
+   *
+   * Each run of items with the same key is written as a group:
+   *
+   *   key diff | value count | value diff (one for each value)
+   *
+   * where the key diff is taken from the key of the previous group, and a
+   * value diff from the previous value, which might be in the previous
+   * group. Both start from 0. Values of the same key are therefore stored
+   * with only one copy of the key. All fields are varints, and diffs are
+   * zigzag encoded
+   */
+  void EncodeLeafItems(const LeafNode *leaf_node_p,
+                       std::vector<unsigned char> *buffer_p) const {
+    // Each item takes at most one varint for each of the three fields
+    buffer_p->resize(static_cast<size_t>(leaf_node_p->GetItemCount()) * \
+                     3 * VARINT_SIZE_MAX);
+
+    unsigned char *p = buffer_p->data();
+    uint64_t prev_key = 0UL;
+    uint64_t prev_value = 0UL;
+
+    const KeyValuePair *it = leaf_node_p->Begin();
+    while(it != leaf_node_p->End()) {
+      const uint64_t key = static_cast<uint64_t>(it->first);
+
+      const KeyValuePair *group_end_it = it + 1;
+      while(group_end_it != leaf_node_p->End() && \
+            static_cast<uint64_t>(group_end_it->first) == key) {
+        group_end_it++;
+      }
+
+      p = EncodeVarint(p, ZigZagEncode(key - prev_key));
+      p = EncodeVarint(p, static_cast<uint64_t>(group_end_it - it));
+      prev_key = key;
+
+      for(;it != group_end_it;it++) {
+        const uint64_t value = static_cast<uint64_t>(it->second);
+
+        p = EncodeVarint(p, ZigZagEncode(value - prev_value));
+        prev_value = value;
+      }
+    }
+
+    buffer_p->resize(static_cast<size_t>(p - buffer_p->data()));
+
+    return;
+  }
+
+  /*
+   * DecodeLeafItems() - Calls the visitor on items of a compressed leaf node
+   *                     in key order until it returns false
+   *
+   * The visitor takes (const KeyType &, const ValueType &) and returns bool
+   */
+  template <typename ItemVisitor>
+  void DecodeLeafItems(const CompressedLeafNode *node_p,
+                       ItemVisitor &&visitor) const {
+    DecodeLeafItems(node_p,
+                    visitor,
+                    std::integral_constant<bool, LEAF_COMPRESSION_SUPPORTED>{});
+
+    return;
+  }
+
+  template <typename ItemVisitor>
+  void DecodeLeafItems(const CompressedLeafNode *node_p,
+                       ItemVisitor &visitor,
+                       std::true_type) const {
+    const unsigned char *p = node_p->GetData();
+    const unsigned char *end_p = p + node_p->GetDataSize();
+    uint64_t key = 0UL;
+    uint64_t value = 0UL;
+
+    while(p != end_p) {
+      uint64_t diff;
+      uint64_t value_num;
+
+      p = DecodeVarint(p, &diff);
+      key += ZigZagDecode(diff);
+      p = DecodeVarint(p, &value_num);
+
+      for(;value_num > 0UL;value_num--) {
+        p = DecodeVarint(p, &diff);
+        value += ZigZagDecode(diff);
+
+        if(visitor(static_cast<KeyType>(key),
+                   static_cast<ValueType>(value)) == false) {
+          return;
+        }
+      }
+    }
+
+    return;
+  }
+
+  template <typename ItemVisitor>
+  void DecodeLeafItems(const CompressedLeafNode *,
+                       ItemVisitor &,
+                       std::false_type) const {
+    // Compressed leaf nodes are only created for integral types
+    assert(false);
+
+    return;
+  }
+
+  /*
+   * VisitCompressedLeaf() - Calls the visitor on each value of the search
+   *                         key on a compressed leaf node
+   *
+   * Decoding stops at the first key greater than the search key
+   */
+  template <typename ValueVisitor>
+  void VisitCompressedLeaf(const CompressedLeafNode *node_p,
+                           const KeyType &search_key,
+                           ValueVisitor &visitor) const {
+    DecodeLeafItems(node_p,
+                    [this, &search_key, &visitor](const KeyType &key,
+                                                  const ValueType &value) {
+                      if(KeyCmpLess(key, search_key) == true) {
+                        return true;
+                      }
+
+                      if(KeyCmpEqual(key, search_key) == false) {
+                        return false;
+                      }
+
+                      visitor(value);
+
+                      return true;
+                    });
+
+    return;
+  }
+
+  /*
+   * DecompressLeafNode() - Appends all items of a compressed leaf node to
+   *                        the leaf node
+   */
+  void DecompressLeafNode(const CompressedLeafNode *node_p,
+                          LeafNode *leaf_node_p) const {
+    DecodeLeafItems(node_p,
+                    [leaf_node_p](const KeyType &key,
+                                  const ValueType &value) {
+                      leaf_node_p->PushBack(std::make_pair(key, value));
+
+                      return true;
+                    });
+
+    return;
+  }
+
+  /*
+   * ExpandLeafNode() - Replaces a compressed leaf node with a LeafNode
+   *
+   * The cold epoch stamp is kept, since expanding is not a modification.
+   * Returns the node in the mapping table after the CAS, which is installed
+   * by another thread if the CAS fails
+   */
+  const BaseNode *ExpandLeafNode(NodeID node_id, const BaseNode *node_p) {
+    const CompressedLeafNode *compressed_node_p = \
+      static_cast<const CompressedLeafNode *>(node_p);
+    const int item_count = compressed_node_p->GetItemCount();
+
+    LeafNode *leaf_node_p = \
+      reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
+        Get(item_count,
+            NodeType::LeafType,
+            0,
+            item_count,
+            compressed_node_p->GetLowKeyPair(),
+            compressed_node_p->GetHighKeyPair()));
+
+    DecompressLeafNode(compressed_node_p, leaf_node_p);
+    assert(leaf_node_p->GetSize() == item_count);
+
+    leaf_node_p->SetColdEpoch(compressed_node_p->GetColdEpoch());
+    leaf_node_p->SetPreviousVersion(compressed_node_p->GetPreviousVersion(),
+                                    compressed_node_p->GetVersion());
+
+    if(InstallNodeToReplace(node_id, leaf_node_p, node_p) == true) {
+      RecordInstalledNode(leaf_node_p);
+
+      epoch_manager.AddGarbageNode(node_p);
+
+      return leaf_node_p;
+    }
+
+    epoch_manager.AddGarbageNode(leaf_node_p, false);
+
+    return GetNode(node_id);
+  }
+
+  /*
+   * TryCompressLeafNode() - Replaces the leaf node of the snapshot with a
+   *                         compressed leaf node if it is cold
+   *
+   * A leaf is cold if it has been a LeafNode without delta records for
+   * cold_epoch_num epochs, which is measured from the first time this
+   * function sees it. Any modification posts a delta record, after which
+   * the node is replaced by consolidation, so the stamp goes with it.
+   *
+   * Returns the bytes of the leaf node minus those of the compressed node,
+   * or 0 if the node is not replaced
+   */
+  int64_t TryCompressLeafNode(NodeSnapshot *snapshot_p,
+                              uint64_t cold_epoch_num,
+                              std::vector<unsigned char> *buffer_p) {
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    if(node_p->GetType() != NodeType::LeafType || \
+       node_p->GetItemCount() == 0) {
+      return 0;
+    }
+
+    const LeafNode *leaf_node_p = static_cast<const LeafNode *>(node_p);
+    const uint64_t current_stamp = GetGlobalEpoch() + 1UL;
+
+    uint64_t cold_epoch = leaf_node_p->GetColdEpoch();
+    if(cold_epoch == 0UL) {
+      cold_epoch = current_stamp;
+
+      leaf_node_p->SetColdEpoch(cold_epoch);
+    }
+
+    if(current_stamp - cold_epoch < cold_epoch_num) {
+      return 0;
+    }
+
+    EncodeLeafItems(leaf_node_p, buffer_p);
+
+    const size_t old_size = GetDeltaChainMemorySize(node_p);
+    if(sizeof(CompressedLeafNode) + buffer_p->size() >= old_size) {
+      return 0;
+    }
+
+    CompressedLeafNode *compressed_node_p = \
+      CompressedLeafNode::Get(leaf_node_p->GetItemCount(),
+                              leaf_node_p->GetLowKeyPair(),
+                              leaf_node_p->GetHighKeyPair(),
+                              cold_epoch,
+                              buffer_p->data(),
+                              buffer_p->size());
+
+    compressed_node_p->SetPreviousVersion(leaf_node_p->GetPreviousVersion(),
+                                          leaf_node_p->GetVersion());
+
+    bool ret = InstallNodeToReplace(snapshot_p->node_id,
+                                    compressed_node_p,
+                                    node_p);
+
+    if(ret == false) {
+      epoch_manager.AddGarbageNode(compressed_node_p, false);
+
+      return 0;
+    }
+
+    RecordInstalledNode(compressed_node_p);
+
+    epoch_manager.AddGarbageNode(node_p);
+
+    snapshot_p->node_p = compressed_node_p;
+
+    return static_cast<int64_t>(old_size) - \
+           static_cast<int64_t>(compressed_node_p->GetAllocationSize());
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Inner node search index
+  ///////////////////////////////////////////////////////////////////
+
+  // The search index copies keys with memcpy and never destroys them
+  static constexpr bool INNER_SEARCH_INDEX_SUPPORTED = \
+    std::is_trivially_copyable<KeyType>::value;
+
+  /*
+   * GetInnerSearchIndexKeySize() - Returns the bytes of the key array of the
+   *                                search index, rounded up for NodeIDs
+   */
+  static size_t GetInnerSearchIndexKeySize(int size) {
+    size_t key_size = sizeof(KeyType) * static_cast<size_t>(size);
+
+    return (key_size + sizeof(NodeID) - 1) / sizeof(NodeID) * sizeof(NodeID);
+  }
+
+  /*
+   * GetInnerSearchIndexSize() - Returns the extra bytes needed by the search
+   *                             index of an inner node of the given size
+   *
+   * Plus the alignment of the end of the separator array
+   */
+  static size_t GetInnerSearchIndexSize(int size) {
+    return GetInnerSearchIndexKeySize(size) + \
+           sizeof(NodeID) * static_cast<size_t>(size) + \
+           alignof(KeyType);
+  }
+
+  /*
+   * BuildInnerSearchIndex() - Builds the search index of an inner node
+   *
+   * There are n = GetSize() elements in the node, and the first key is not
+   * a separator. The other n - 1 separators are stored in Eytzinger (BFS)
+   * order at slot 1 to n - 1 of a key array, i.e. the children of slot k are
+   * at 2k and 2k + 1, so the top levels of the implicit tree share a few
+   * cache lines and the positions of future probes are known in advance.
+   * A parallel NodeID array stores at slot k the child to the left of the
+   * separator at slot k, and at slot 0 the last child, which is the result
+   * if all separators are <= the search key
+   *
+   * NOTE: The node must have been allocated with the size given by
+   * GetInnerSearchIndexSize(), and must not be modified after this
+   */
+  void BuildInnerSearchIndex(InnerNode *inner_node_p) const {
+    int size = inner_node_p->GetSize();
+    assert(size >= 1);
+
+    uintptr_t index_addr = reinterpret_cast<uintptr_t>(inner_node_p->End());
+    index_addr = (index_addr + alignof(KeyType) - 1) / \
+                 alignof(KeyType) * alignof(KeyType);
+
+    char *search_index_p = reinterpret_cast<char *>(index_addr);
+    KeyType *key_list = reinterpret_cast<KeyType *>(search_index_p);
+    NodeID *node_id_list = reinterpret_cast<NodeID *>( \
+      search_index_p + GetInnerSearchIndexKeySize(size));
+
+    node_id_list[0] = (inner_node_p->End() - 1)->second;
+
+    // The next separator to place in in-order traversal
+    const KeyNodeIDPair *sep_p = inner_node_p->Begin() + 1;
+    BuildInnerSearchIndexRecursive(key_list, node_id_list, size - 1, 1, &sep_p);
+    assert(sep_p == inner_node_p->End());
+
+    inner_node_p->SetSearchIndex(search_index_p);
+
+    return;
+  }
+
+  /*
+   * BuildInnerSearchIndexRecursive() - Fills the subtree rooted at slot k
+   *
+   * An in-order traversal of the implicit tree visits slots in key order
+   */
+  static void BuildInnerSearchIndexRecursive(KeyType *key_list,
+                                             NodeID *node_id_list,
+                                             int sep_num,
+                                             int k,
+                                             const KeyNodeIDPair **sep_pp) {
+    if(k > sep_num) {
+      return;
+    }
+
+    BuildInnerSearchIndexRecursive(key_list, node_id_list, sep_num, 2 * k, sep_pp);
+
+    memcpy(static_cast<void *>(key_list + k), &(*sep_pp)->first, sizeof(KeyType));
+    node_id_list[k] = ((*sep_pp) - 1)->second;
+    (*sep_pp)++;
+
+    BuildInnerSearchIndexRecursive(key_list, node_id_list, sep_num, 2 * k + 1, sep_pp);
+
+    return;
+  }
+
+  /*
+   * SearchInnerSearchIndex() - Returns the child whose range covers the key
+   *
+   * This returns the same NodeID as LocateSeparatorByKey() on the whole
+   * array. We descend from slot 1, going to the right child if the key at
+   * the slot is <= search key. The separator found is the last slot where
+   * we went left, which is obtained by removing trailing ones and one more
+   * bit from the final slot number. It is 0 if we never went left
+   */
+  inline NodeID SearchInnerSearchIndex(const KeyType &search_key,
+                                       const InnerNode *inner_node_p) const {
+    const char *search_index_p = inner_node_p->GetSearchIndex();
+    size_t sep_num = static_cast<size_t>(inner_node_p->GetSize() - 1);
+
+    const KeyType *key_list = reinterpret_cast<const KeyType *>(search_index_p);
+    const NodeID *node_id_list = reinterpret_cast<const NodeID *>( \
+      search_index_p + GetInnerSearchIndexKeySize(inner_node_p->GetSize()));
+
+    // Slots 4 levels below share cache lines if keys are small
+    constexpr size_t PREFETCH_STRIDE = 64 / sizeof(KeyType);
+
+    size_t k = 1;
+    while(k <= sep_num) {
+      if(PREFETCH_STRIDE >= 4) {
+        __builtin_prefetch(key_list + PREFETCH_STRIDE * k);
+      }
+
+      k = 2 * k + (KeyCmpLess(search_key, key_list[k]) == false);
+    }
+
+    k >>= __builtin_ffsl(static_cast<long>(~k));
+
+    return node_id_list[k];
+  }
+
+  /*
+   * CollectAllSepsOnInnerRecursive() - This is the counterpart on inner node
+   *
+   * Please refer to the function on leaf node for details. These two have
+   * almost the same logical flow
+   */
+  template<typename T> // To make the f**king compiler
+                       // to deduce SortedSmallSet template type
+  void
+  CollectAllSepsOnInnerRecursive(const BaseNode *node_p,
+                                 NodeID low_key_node_id,
+                                 T &sss,
+                                 InnerNode *new_inner_node_p) const {
+    // High key should be the high key of the branch (if there is a merge
+    // then the high key of the branch may not always equal the high key
+    // of the merged node)
+    // Even if there is no merge, we still need the high key to rule out
+    // keys that has already been splited
+    const KeyNodeIDPair &high_key_pair = node_p->GetHighKeyPair();
+
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::InnerType: {
+          const InnerNode *inner_node_p = \
+            static_cast<const InnerNode *>(node_p);
+
+          // These two will be set according to the high key and
+          // low key
+          const KeyNodeIDPair *copy_end_it;
+          const KeyNodeIDPair *copy_start_it;
+
+          if(high_key_pair.second == INVALID_NODE_ID) {
+            copy_end_it = inner_node_p->End();
+          } else {
+            // This search for the first key >= high key of the current node
+            // being consolidated
+            // This is exactly where we should stop copying
+            // The return value might be end() iterator, but it is also
+            // consistent
+            copy_end_it = \
+              std::lower_bound(inner_node_p->Begin() + 1,
+                               inner_node_p->End(),
+                               high_key_pair,     // This contains the high key
+                               key_node_id_pair_cmp_obj);
+          }
+
+          // Since we want to access its first element
+          assert(inner_node_p->GetSize() > 0);
+
+          // If the first element in the sep list equals the low key pair's
+          // NodeID then we are at the leftmost node of the merge tree
+          // and we ignore the leftmost sep (since it could be -Inf)
+          // For other nodes, the leftmost item inside sep list has a valid
+          // key and could thus be pushed directly
+          if(inner_node_p->At(0).second == low_key_node_id) {
+            copy_start_it = inner_node_p->Begin() + 1;
+          } else {
+            copy_start_it = inner_node_p->Begin();
+          }
+
+          // Find the end of copying
+          auto sss_end_it = sss.GetEnd() - 1;
+
+          // If the high key is +Inf then sss_end_it is the real end of the
+          // sorted array
+          // Otherwise need to find the end iterator of sss for the current
+          // InnerNode by using its high key
+          if(high_key_pair.second != INVALID_NODE_ID) {
+            // Corner case: If the first element is lower bound
+            // then current_p will move outside
+            // the valid range of the array but still we return
+            // the first element in the array
+            while(sss_end_it >= sss.GetBegin()) {
+              if(key_cmp_obj((*sss_end_it)->item.first, high_key_pair.first) == true) {
+                break;
+              }
+
+              sss_end_it--;
+            }
+          }
+
+          // This points to the first element >= high key
+          sss_end_it++;
+
+          //printf("%ld\n", sss.GetSize());
+
+          while(1) {
+            bool sss_end_flag = (sss.GetBegin() == sss_end_it);
+            bool array_end_flag = (copy_start_it == copy_end_it);
+
+            //printf("sss_end_flag = %d; array_end_flag = %d\n", sss_end_flag, array_end_flag);
+
+            if(sss_end_flag == true && array_end_flag == true) {
+              // Both are drained
+              break;
+            } else if(sss_end_flag == true) {
+              // If the sss has drained we continue to drain the array
+              // This version of PushBack() takes two iterators and
+              // insert from start to end - 1
+              new_inner_node_p->PushBack(copy_start_it, copy_end_it);
+
+              break;
+            } else if(array_end_flag == true) {
+              // Then we drain all elements inside the delta chain
+              while(sss.GetBegin() != sss_end_it) {
+                // We could not pop here since we will use the value later
+                NodeType data_node_type = (sss.GetFront())->GetType();
+
+                // It is possible that there is an InnerDeleteNode:
+                // InnerNode: [1, 2, 3, 4, 5]
+                // Delta Chain:               Delete 6, Insert 6
+                // Only the first "Delete 6" will appear in the set
+                // and we just do not care
+                if(data_node_type == NodeType::InnerInsertType) {
+                  // Pop the value here
+                  new_inner_node_p->PushBack(sss.PopFront()->item);
+                } else {
+                  // And here (InnerDeleteNode after we have drained InnerNode
+                  // is useless so just ignore it)
+                  sss.PopFront();
+                }
+              }
+
+              break;
+            }
+
+            // Next is the normal case: Both are not drained
+            // we do a comparison of their leading elements
+
+            if(key_cmp_obj(copy_start_it->first, 
+                           sss.GetFront()->item.first) == true) {
+              // If array element is less than data node list element
+              new_inner_node_p->PushBack(*copy_start_it);
+
+              copy_start_it++;
+            } else if(key_cmp_obj(sss.GetFront()->item.first, 
+                                  copy_start_it->first) == true) {
+              NodeType data_node_type = (sss.GetFront())->GetType();
+
+              // Delta Insert with array not having that element
+              if(data_node_type == NodeType::InnerInsertType) {
+                // Pop the value here
+                new_inner_node_p->PushBack(sss.PopFront()->item);
+              } else {
+                // This is possible
+                // InnerNode: [2, 3, 4, 5]
+                // Delta Chain: Delete 1, Insert 1
+                // So just ignore it
+                sss.PopFront();
+              }
+            } else {
+              // In this branch the values are equal
+
+              NodeType data_node_type = (sss.GetFront())->GetType();
+
+              // InsertDelta overrides InnerNode element
+              if(data_node_type == NodeType::InnerInsertType) {
+                new_inner_node_p->PushBack(sss.PopFront()->item);
+              } else {
+                // There is a value in InnerNode that does not exist
+                // in consolidated node. Just ignore
+                sss.PopFront();
+              }
+
+              copy_start_it++;
+            } // Compare leading elements
+          } // while(1)
+
+          return;
+        } // case InnerType
+        case NodeType::InnerRemoveType: {
+          bwt_printf("ERROR: InnerRemoveNode not allowed\n");
+
+          assert(false);
+          return;
+        } // case InnerRemoveType
+        case NodeType::InnerInsertType: {
+          const InnerInsertNode *insert_node_p = \
+            static_cast<const InnerInsertNode *>(node_p);
+
+          // delta nodes must be consistent with the most up-to-date
+          // node high key
+          assert((high_key_pair.second == INVALID_NODE_ID) ||
+                 (KeyCmpLess(insert_node_p->item.first, high_key_pair.first)));
+
+          sss.Insert(static_cast<const InnerDataNode *>(node_p));
+
+          // Go to next node
+          node_p = insert_node_p->child_node_p;
+
+          break;
+        } // case InnerInsertType
+        case NodeType::InnerDeleteType: {
+          const InnerDeleteNode *delete_node_p = \
+            static_cast<const InnerDeleteNode *>(node_p);
+
+          // Since we do not allow any delta node under split node
+          // this must be true
+          // i.e. delta nodes must be consistent with the most up-to-date
+          // node high key
+          assert((high_key_pair.second == INVALID_NODE_ID) ||
+                 (KeyCmpLess(delete_node_p->item.first, high_key_pair.first)));
+
+          sss.Insert(static_cast<const InnerDataNode *>(node_p));
+
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // case InnerDeleteType
+        case NodeType::InnerSplitType: {
+          node_p = (static_cast<const DeltaNode *>(node_p))->child_node_p;
+
+          break;
+        } // case InnerSplitType
+        case NodeType::InnerMergeType: {
+          const InnerMergeNode *merge_node_p = \
+            static_cast<const InnerMergeNode *>(node_p);
+
+          // NOTE: We alaways use the same metadata object which is the
+          // one passed by the wrapper. Though node_p changes for each
+          // recursive call, metadata should not change and should remain
+          // constant
+
+          CollectAllSepsOnInnerRecursive(merge_node_p->child_node_p,
+                                         low_key_node_id,
+                                         sss,
+                                         new_inner_node_p);
+
+          CollectAllSepsOnInnerRecursive(merge_node_p->right_merge_p,
+                                         low_key_node_id,
+                                         sss,
+                                         new_inner_node_p);
+
+          // There is no unvisited node
+          return;
+        } // case InnerMergeType
+        default: {
+          bwt_printf("ERROR: Unknown inner node type = %d\n",
+                 static_cast<int>(type));
+
+          assert(false);
+          return;
+        }
+      } // switch type
+    } // while(1)
+
+    // Should not get to here
+    assert(false);
+    return;
+  }
+
+  /*
+   * NavigateLeafNode() - Find search key on a logical leaf node and collect
+   *                      values associated with the key
+   *
+   * This function correctly deals with merge and split, starting on
+   * the topmost node of a delta chain
+   *
+   * It pushes pointers of nodes into a vector, and stops at the leaf node.
+   * After that it bulk loads the leaf page's data item of the search key
+   * into logical leaf node, and then replay log
+   *
+   * In order to reflect the fact that we might jump to a split sibling using
+   * NodeID due to a half split state, the function will modify snapshot_p's
+   * NodeID and BaseNode pointer if this happens, and furthermore it sets
+   * is_sibling flag to true to notify the caller that path history needs to
+   * be updated
+   *
+   * This function takes an extra argument to decide whether it collects any
+   * value. If collect_value is set to false, then this function only traverses
+   * the leaf node without collecting any actual value, while still being
+   * able to traverse to its left sibling and potentially abort
+   *
+   * NOTE: If there is prior data in its logical node when calling this function
+   * then we simply turn off collect_value flag in order to make use of
+   * these values and avoid map insert conflict.
+   *
+   * NOTE 2: After jumping to a new NodeID in this function there will be similar
+   * problems since now the snapshot has been changed, and we need to check
+   * whether there is data in the map again to make sure there is no
+   * map insert conflict
+   */
+  void NavigateLeafNode(Context *context_p,
+                        std::vector<ValueType> &value_list) {
+    NavigateLeafNodeVisit(context_p,
+                          [&value_list](const ValueType &value) {
+                            value_list.push_back(value);
+                          });
+
+    return;
+  }
+
+  /*
+   * IsKeyInDeleteRange() - Whether a key is deleted by a range tombstone
+   */
+  inline bool IsKeyInDeleteRange(const KeyType &key,
+                                 const LeafDeleteRangeNode *delete_range_node_p) const {
+    return (KeyCmpLess(key, delete_range_node_p->delete_low_key) == false) && \
+           (KeyCmpLess(key, delete_range_node_p->delete_high_key) == true);
+  }
+
+  /*
+   * class DeleteRangeSet - Range tombstones seen while collecting values
+   *                        on a leaf delta chain
+   *
+   * The array is allocated by the caller on the stack, and its size is
+   * bounded by the depth of the delta chain
+   */
+  class DeleteRangeSet {
+   public:
+    const LeafDeleteRangeNode **data_p;
+    int size;
+  };
+
+  /*
+   * IsKeyInDeleteRangeSet() - Whether a key is deleted by any of the range
+   *                           tombstones in the set
+   */
+  inline bool IsKeyInDeleteRangeSet(const KeyType &key,
+                                    const DeleteRangeSet &delete_range_set) const {
+    for(int i = 0;i < delete_range_set.size;i++) {
+      if(IsKeyInDeleteRange(key, delete_range_set.data_p[i]) == true) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /*
+   * GetLeafBaseIndex() - Returns the index of the first item >= search key
+   *                      on the base node the search key belongs to
+   *
+   * This is used to compute the index pair of a key hidden by a range
+   * tombstone, in which case the key is inserted as if it does not exist
+   * on the base node
+   */
+  int GetLeafBaseIndex(const BaseNode *node_p,
+                       const KeyType &search_key) const {
+    while(node_p->IsDeltaNode() == true) {
+      if(node_p->GetType() == NodeType::LeafMergeType) {
+        const LeafMergeNode *merge_node_p = \
+          static_cast<const LeafMergeNode *>(node_p);
+
+        if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
+          node_p = merge_node_p->right_merge_p;
+
+          continue;
+        }
+      }
+
+      node_p = static_cast<const DeltaNode *>(node_p)->child_node_p;
+    }
+
+    const LeafNode *leaf_node_p = static_cast<const LeafNode *>(node_p);
+
+    return static_cast<int>(KeyLowerBound(leaf_node_p->Begin(),
+                                          leaf_node_p->End(),
+                                          search_key) - leaf_node_p->Begin());
+  }
+
+  /*
+   * NavigateLeafNodeVisit() - Calls the visitor once on each value of the
+   *                           search key
+   *
+   * This is the body of NavigateLeafNode() with a value list. The visitor is
+   * a callable taking const ValueType &, which lets the caller decide where
+   * values go without an intermediate container
+   */
+  template <typename ValueVisitor>
+  void NavigateLeafNodeVisit(Context *context_p,
+                             ValueVisitor &&visitor) {
+
+    // This will go to the right sibling until we have seen
+    // a node whose range match the search key
+    NavigateSiblingChain(context_p);
+
+    // If navigating sibling chain aborts then abort here
+    if(context_p->abort_flag == true) {
+      return;
+    }
+    
+    /////////////////////////////////////////////////////////////////
+    // Only after this point could we get snapshot and node_p
+    /////////////////////////////////////////////////////////////////
+    
+    // This contains information for current node
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    assert(snapshot_p->IsLeaf() == true);
+
+    // Only read-optimized traversals could see a compressed leaf, which
+    // is never below a delta record
+    if(node_p->GetType() == NodeType::LeafCompressedType) {
+      VisitCompressedLeaf(static_cast<const CompressedLeafNode *>(node_p),
+                          context_p->search_key,
+                          visitor);
+
+      return;
+    }
+
+    // There is at most one value, so no value set is needed
+    if(UniqueKey == true) {
+      std::pair<int, bool> index_pair;
+      const KeyValuePair *item_p = \
+        NavigateLeafNodeUnique(context_p, &index_pair);
+
+      if(item_p != nullptr) {
+        visitor(item_p->second);
+      }
+
+      return;
+    }
+
+    // We only collect values for this key
+    const KeyType &search_key = context_p->search_key;
+
+    // The maximum size of present set and deleted set is bounded by
+    // the number of data records on the delta chain. Since when we reached
+    // the leaf node we just probe and add to value set
+    const int set_max_size = node_p->GetDepth() * LEAF_DELTA_RECORD_NUM_MAX;
+
+    // 1. This works even if depth is 0
+    // 2. We choose to store const ValueType * because we want to bound the
+    // size of stack array. It should be upper bounded by max delta chain
+    // length * pointer size. On the contrary, if the size of
+    // ValueType is huge, and we store ValueType, then we might cause
+    // a stack overflow
+    const ValueType *present_set_data_p[set_max_size];
+    const ValueType *deleted_set_data_p[set_max_size];
+
+    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
+      present_set{present_set_data_p,
+                  value_eq_obj,
+                  value_hash_obj};
+
+    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
+      deleted_set{deleted_set_data_p,
+                  value_eq_obj,
+                  value_hash_obj};
+                  
+    int start_index = 0;
+    int end_index = -1;
+
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::LeafType: {
+          const LeafNode *leaf_node_p = \
+            static_cast<const LeafNode *>(node_p);
+
+          // The key is not on the base node so there is nothing to search
+          if((leaf_node_p->GetSearchIndex() != nullptr) && \
+             (LeafFingerprintMayContain(leaf_node_p,
+                                        GetSearchKeyHash(context_p)) == false)) {
+            return;
+          }
+
+          auto start_it = leaf_node_p->Begin() + start_index;
+
+          // That is the end of searching
+          auto end_it = ((end_index == -1) ? \
+                         leaf_node_p->End() : \
+                         leaf_node_p->Begin() + end_index);
+
+          // Here we know the search key < high key of current node
+          // NOTE: We only compare keys here, so it will get to the first
+          // element >= search key
+          auto copy_start_it = KeyLowerBound(start_it, end_it, search_key);
+
+          // If there is something to copy
+          while((copy_start_it != leaf_node_p->End()) && \
+                (KeyCmpEqual(search_key, copy_start_it->first))) {
+            // If the value has not been deleted then just insert
+            // Note that here we use ValueSet, so need to extract value from
+            // the key value pair
+            if(deleted_set.Exists(copy_start_it->second) == false) {
+              if(present_set.Exists(copy_start_it->second) == false) {
+                // Note: As an optimization, we do not have to Insert() the
+                // value element into present set here. Since we know it
+                // is already base leaf page, adding values into present set
+                // definitely will not block the remaining values, since we
+                // know they do not duplicate inside the leaf node
+
+                visitor(copy_start_it->second);
+              }
+            }
+
+            copy_start_it++;
+          }
+
+          return;
+        }
+        case NodeType::LeafInsertType: {
+          const LeafInsertNode *insert_node_p = \
+            static_cast<const LeafInsertNode *>(node_p);
+
+          if(KeyCmpEqual(search_key, insert_node_p->item.first)) {
+            if(deleted_set.Exists(insert_node_p->item.second) == false) {
+              // We must do this, since inserted set does not detect for
+              // duplication, and if the value has already been in present set
+              // then we inserted the same value twice
+              if(present_set.Exists(insert_node_p->item.second) == false) {
+                present_set.Insert(insert_node_p->item.second);
+
+                visitor(insert_node_p->item.second);
+              }
+            }
+          } else if(KeyCmpGreater(search_key, insert_node_p->item.first)) {
+            start_index = insert_node_p->GetIndexPair().first;
+          } else {
+            end_index = insert_node_p->GetIndexPair().first;
+          }
+
+          node_p = insert_node_p->child_node_p;
+
+          break;
+        } // case LeafInsertType
+        case NodeType::LeafDeleteType: {
+          const LeafDeleteNode *delete_node_p = \
+            static_cast<const LeafDeleteNode *>(node_p);
+
+          if(KeyCmpEqual(search_key, delete_node_p->item.first)) {
+            if(present_set.Exists(delete_node_p->item.second) == false) {
+              deleted_set.Insert(delete_node_p->item.second);
+            }
+          } else if(KeyCmpGreater(search_key, delete_node_p->item.first)) {
+            start_index = delete_node_p->GetIndexPair().first;
+          } else {
+            end_index = delete_node_p->GetIndexPair().first;
+          }
+          
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteType
+        case NodeType::LeafUpdateType: {
+          const LeafUpdateNode *update_node_p = \
+            static_cast<const LeafUpdateNode *>(node_p);
+
+          if(KeyCmpEqual(search_key, update_node_p->item.first)) {
+            // The new value is treated as inserted and the old value
+            // is treated as deleted
+            if(deleted_set.Exists(update_node_p->item.second) == false) {
+              if(present_set.Exists(update_node_p->item.second) == false) {
+                present_set.Insert(update_node_p->item.second);
+
+                visitor(update_node_p->item.second);
+              }
+            }
+
+            const ValueType &old_value = update_node_p->delete_node.item.second;
+            if(present_set.Exists(old_value) == false) {
+              deleted_set.Insert(old_value);
+            }
+          } else if(KeyCmpGreater(search_key, update_node_p->item.first)) {
+            start_index = update_node_p->GetIndexPair().first;
+          } else {
+            end_index = update_node_p->GetIndexPair().first;
+          }
+
+          node_p = update_node_p->child_node_p;
+
+          break;
+        } // case LeafUpdateType
+        case NodeType::LeafBatchInsertType: {
+          const LeafBatchInsertNode *batch_node_p = \
+            static_cast<const LeafBatchInsertNode *>(node_p);
+
+          // Values of the search key are adjacent, and their neighbours
+          // narrow down the range on the base node
+          const LeafInsertNode *insert_node_p = \
+            BatchKeyLowerBound(batch_node_p, search_key);
+
+          if(insert_node_p != batch_node_p->Begin()) {
+            start_index = (insert_node_p - 1)->GetIndexPair().first;
+          }
+
+          while((insert_node_p != batch_node_p->End()) && \
+                (KeyCmpEqual(search_key, insert_node_p->item.first))) {
+            if(deleted_set.Exists(insert_node_p->item.second) == false) {
+              if(present_set.Exists(insert_node_p->item.second) == false) {
+                present_set.Insert(insert_node_p->item.second);
+
+                visitor(insert_node_p->item.second);
+              }
+            }
+
+            insert_node_p++;
+          }
+
+          if(insert_node_p != batch_node_p->End()) {
+            end_index = insert_node_p->GetIndexPair().first;
+          }
+
+          node_p = batch_node_p->child_node_p;
+
+          break;
+        } // case LeafBatchInsertType
+        case NodeType::LeafDeleteRangeType: {
+          const LeafDeleteRangeNode *delete_range_node_p = \
+            static_cast<const LeafDeleteRangeNode *>(node_p);
+
+          // All values of the search key below this node are deleted
+          if(IsKeyInDeleteRange(search_key, delete_range_node_p) == true) {
+            return;
+          }
+
+          node_p = delete_range_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteRangeType
+        case NodeType::LeafRemoveType: {
+          bwt_printf("ERROR: Observed LeafRemoveNode in delta chain\n");
+
+          assert(false);
+        } // case LeafRemoveType
+        case NodeType::LeafMergeType: {
+          bwt_printf("Observed a merge node on leaf delta chain\n");
+
+          const LeafMergeNode *merge_node_p = \
+            static_cast<const LeafMergeNode *>(node_p);
+
+          // Decide which side we should choose
+          // Using >= for separator key
+          if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
+            bwt_printf("Take leaf merge right branch\n");
+
+            node_p = merge_node_p->right_merge_p;
+          } else {
+            bwt_printf("Take leaf merge left branch\n");
+
+            node_p = merge_node_p->child_node_p;
+          }
+
+          break;
+        } // case LeafMergeType
+        case NodeType::LeafSplitType: {
+          bwt_printf("Observed a split node on leaf delta chain\n");
+
+          const LeafSplitNode *split_node_p = \
+            static_cast<const LeafSplitNode *>(node_p);
+
+          // Do not need to go right here since we have already
+          // done that on the top level
+          // and the high key has been observed on the top level high key
+          node_p = split_node_p->child_node_p;
+
+          break;
+        } // case LeafSplitType
+        default: {
+          bwt_printf("ERROR: Unknown leaf delta node type: %d\n",
+                     static_cast<int>(node_p->GetType()));
+
+          assert(false);
+        } // default
+      } // switch
+    } // while
+
+    // We cannot reach here
+    assert(false);
+    return;
+  }
+
+  /*
+   * NavigateLeafNodeUnique() - Finds the value of the search key if keys
+   *                            are unique
+   *
+   * Since a key has at most one value, the first delta record on the key
+   * decides whether the key exists, and there is no need to keep value sets.
+   * If the key exists then the item is returned and index_pair_p is set in
+   * the same way as a Delete() would do; Otherwise nullptr is returned and
+   * index_pair_p is the position for an Insert() of the key
+   *
+   * NOTE: The caller must have navigated the sibling chain such that the
+   * current leaf covers the search key
+   */
+  const KeyValuePair *NavigateLeafNodeUnique(
+    Context *context_p,
+    std::pair<int, bool> *index_pair_p) {
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    assert(snapshot_p->IsLeaf() == true);
+
+    return NavigateLeafDeltaChainUnique(snapshot_p->node_p,
+                                        context_p->search_key,
+                                        GetSearchKeyHash(context_p),
+                                        index_pair_p);
+  }
+
+  /*
+   * NavigateLeafDeltaChainUnique() - Finds the value of the search key on
+   *                                  a leaf delta chain if keys are unique
+   *
+   * This is the core of NavigateLeafNodeUnique() which works on a given
+   * node rather than the latest snapshot of a context. search_key_hash
+   * must be GetKeyHash(search_key)
+   */
+  const KeyValuePair *NavigateLeafDeltaChainUnique(
+    const BaseNode *node_p,
+    const KeyType &search_key,
+    size_t search_key_hash,
+    std::pair<int, bool> *index_pair_p) {
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::LeafType: {
+          const LeafNode *leaf_node_p = \
+            static_cast<const LeafNode *>(node_p);
+
+          auto it = KeyLowerBound(leaf_node_p->Begin(),
+                                  leaf_node_p->End(),
+                                  search_key);
+
+          index_pair_p->first = it - leaf_node_p->Begin();
+
+          if(it != leaf_node_p->End() && \
+             LeafFingerprintMayContain(leaf_node_p, search_key_hash) && \
+             KeyCmpEqual(it->first, search_key)) {
+            index_pair_p->second = true;
+
+            return &(*it);
+          }
+
+          index_pair_p->second = false;
+
+          return nullptr;
+        } // case LeafType
+        case NodeType::LeafInsertType:
+        case NodeType::LeafUpdateType: {
+          const LeafDataNode *data_node_p = \
+            static_cast<const LeafDataNode *>(node_p);
+
+          if(data_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, data_node_p->item.first)) {
+            *index_pair_p = data_node_p->GetIndexPair();
+
+            return &data_node_p->item;
+          }
+
+          node_p = data_node_p->child_node_p;
+
+          break;
+        } // case LeafInsertType / LeafUpdateType
+        case NodeType::LeafBatchInsertType: {
+          const LeafBatchInsertNode *batch_node_p = \
+            static_cast<const LeafBatchInsertNode *>(node_p);
+
+          const LeafInsertNode *insert_node_p = \
+            BatchKeyLowerBound(batch_node_p, search_key);
+
+          if((insert_node_p != batch_node_p->End()) && \
+             (KeyCmpEqual(search_key, insert_node_p->item.first))) {
+            *index_pair_p = insert_node_p->GetIndexPair();
+
+            return &insert_node_p->item;
+          }
+
+          node_p = batch_node_p->child_node_p;
+
+          break;
+        } // case LeafBatchInsertType
+        case NodeType::LeafDeleteRangeType: {
+          const LeafDeleteRangeNode *delete_range_node_p = \
+            static_cast<const LeafDeleteRangeNode *>(node_p);
+
+          // All values of the search key below this node are deleted, so
+          // only Insert() will use the index pair
+          if(IsKeyInDeleteRange(search_key, delete_range_node_p) == true) {
+            index_pair_p->first = \
+              GetLeafBaseIndex(delete_range_node_p->child_node_p, search_key);
+            index_pair_p->second = false;
+
+            return nullptr;
+          }
+
+          node_p = delete_range_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteRangeType
+        case NodeType::LeafDeleteType: {
+          const LeafDeleteNode *delete_node_p = \
+            static_cast<const LeafDeleteNode *>(node_p);
+
+          if(delete_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, delete_node_p->item.first)) {
+            *index_pair_p = delete_node_p->GetIndexPair();
+
+            return nullptr;
+          }
+
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteType
+        case NodeType::LeafRemoveType: {
+          bwt_printf("ERROR: Observed LeafRemoveNode in delta chain\n");
+
+          assert(false);
+        } // case LeafRemoveType
+        case NodeType::LeafMergeType: {
+          const LeafMergeNode *merge_node_p = \
+            static_cast<const LeafMergeNode *>(node_p);
+
+          if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
+            node_p = merge_node_p->right_merge_p;
+          } else {
+            node_p = merge_node_p->child_node_p;
+          }
+
+          break;
+        } // case LeafMergeType
+        case NodeType::LeafSplitType: {
+          const LeafSplitNode *split_node_p = \
+            static_cast<const LeafSplitNode *>(node_p);
+
+          node_p = split_node_p->child_node_p;
+
+          break;
+        } // case LeafSplitType
+        default: {
+          bwt_printf("ERROR: Unknown leaf delta node type: %d\n",
+                     static_cast<int>(node_p->GetType()));
+
+          assert(false);
+        } // default
+      } // switch
+    } // while
+
+    // We cannot reach here
+    assert(false);
+    return nullptr;
+  }
+
+  /*
+   * NavigateLeafNode() - Check existence for a certain value
+   *
+   * Please note that this function is overloaded. This version is used for
+   * insert/delete/update that only checks existence of values, rather than
+   * collecting all values for a single key.
+   *
+   * If return value is nullptr, then the key-value pair is not found. Otherwise
+   * a pointer to the matching item is returned. The caller should check return
+   * value and act accordingly.
+   *
+   * This function works by traversing down the delta chain and compare
+   * values with those in delta nodes and in the base node. No special data
+   * structure is required
+   *
+   * This function calls JumpToNodeID() to switch to a split sibling node
+   * There are possibility that the switch aborts, and in this case this
+   * function returns with value false.
+   */
+  const KeyValuePair *NavigateLeafNode(Context *context_p,
+                                       const ValueType &search_value,
+                                       std::pair<int, bool> *index_pair_p) {
+    
+    // This will go to the right sibling until we have seen
+    // a node whose range match the search key
+    NavigateSiblingChain(context_p);
+
+    // If navigating sibling chain aborts then abort here
+    if(context_p->abort_flag == true) {
+      return nullptr;
+    }
+    
+    /////////////////////////////////////////////////////////////////
+    // Only after this point could we get snapshot and node_p
+    /////////////////////////////////////////////////////////////////
+    
+    // Snapshot pointer, node pointer, and metadata reference all need
+    // updating once LoadNodeID() returns with success
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    assert(snapshot_p->IsLeaf() == true);
+
+    return NavigateLeafDeltaChain(snapshot_p->node_p,
+                                  context_p->search_key,
+                                  GetSearchKeyHash(context_p),
+                                  search_value,
+                                  index_pair_p);
+  }
+
+  /*
+   * NavigateLeafDeltaChain() - Check existence for a certain value on a leaf
+   *                            delta chain
+   *
+   * This is the core of the above NavigateLeafNode() which works on a given
+   * node whose range contains the search key, rather than the latest
+   * snapshot of a context. search_key_hash must be GetKeyHash(search_key),
+   * and data nodes with a different key hash are skipped without comparing
+   * keys
+   */
+  const KeyValuePair *NavigateLeafDeltaChain(
+    const BaseNode *node_p,
+    const KeyType &search_key,
+    size_t search_key_hash,
+    const ValueType &search_value,
+    std::pair<int, bool> *index_pair_p) {
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::LeafType: {
+          const LeafNode *leaf_node_p = \
+            static_cast<const LeafNode *>(node_p);
+
+          // Here we know the search key < high key of current node
+          // NOTE: We only compare keys here, so it will get to the first
+          // element >= search key
+          auto scan_start_it = KeyLowerBound(leaf_node_p->Begin(),
+                                             leaf_node_p->End(),
+                                             search_key);
+
+          // If the fingerprint rules out the key then there is no value
+          // to compare, though the index is still needed by Insert()
+          bool key_may_exist = \
+            LeafFingerprintMayContain(leaf_node_p, search_key_hash);
+
+          // Search all values with the search key
+          while((key_may_exist == true) && \
+                (scan_start_it != leaf_node_p->End()) && \
+                (KeyCmpEqual(scan_start_it->first, search_key))) {
+                  
+            // If there is a value matching the search value then return true
+            // We do not need to check any delete set here, since if the
+            // value has been deleted earlier then this function would
+            // already have returned
+            if(ValueCmpEqual(scan_start_it->second, search_value)) {
+              // Since only Delete() will use this piece of information
+              // we set exist flag to false to indicate that the value
+              // has been invalidated
+              index_pair_p->first = \
+                scan_start_it - leaf_node_p->Begin();
+              index_pair_p->second = true;
+              
+              // Return a pointer to the item inside LeafNode;
+              // This pointer should remain valid until epoch is exited
+              return &(*scan_start_it);
+            }
+
+            scan_start_it++;
+          }
+          
+          // Either key does not exist or key exists but value does not
+          // exist will reach here
+          // Since only Insert() will use the index we set exist flag to false
+          index_pair_p->first = \
+                scan_start_it - leaf_node_p->Begin();
+          index_pair_p->second = false;
+
+          return nullptr;
+        } // case LeafType
+        case NodeType::LeafInsertType: {
+          const LeafInsertNode *insert_node_p = \
+            static_cast<const LeafInsertNode *>(node_p);
+
+          if(insert_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, insert_node_p->item.first)) {
+            if(ValueCmpEqual(insert_node_p->item.second, search_value)) {
+              // Only Delete() will use this
+              // We just simply inherit from the first node
+              *index_pair_p = insert_node_p->GetIndexPair();
+              
+              return &insert_node_p->item;
+            }
+          }
+
+          node_p = insert_node_p->child_node_p;
+
+          break;
+        } // case LeafInsertType
+        case NodeType::LeafDeleteType: {
+          const LeafDeleteNode *delete_node_p = \
+            static_cast<const LeafDeleteNode *>(node_p);
+
+          // If the value was deleted then return false
+          if(delete_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, delete_node_p->item.first)) {
+            if(ValueCmpEqual(delete_node_p->item.second, search_value)) {
+              // Only Insert() will use this
+              // We just simply inherit from the first node
+              *index_pair_p = delete_node_p->GetIndexPair();
+              
+              return nullptr;
+            }
+          }
+          
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteType
+        case NodeType::LeafUpdateType: {
+          const LeafUpdateNode *update_node_p = \
+            static_cast<const LeafUpdateNode *>(node_p);
+
+          // The new value exists and the old value has been deleted
+          if(update_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, update_node_p->item.first)) {
+            if(ValueCmpEqual(update_node_p->item.second, search_value)) {
+              *index_pair_p = update_node_p->GetIndexPair();
+
+              return &update_node_p->item;
+            }
+
+            const LeafDeleteNode *delete_node_p = &update_node_p->delete_node;
+
+            if(ValueCmpEqual(delete_node_p->item.second, search_value)) {
+              *index_pair_p = delete_node_p->GetIndexPair();
+
+              return nullptr;
+            }
+          }
+
+          node_p = update_node_p->child_node_p;
+
+          break;
+        } // case LeafUpdateType
+        case NodeType::LeafBatchInsertType: {
+          const LeafBatchInsertNode *batch_node_p = \
+            static_cast<const LeafBatchInsertNode *>(node_p);
+
+          for(const LeafInsertNode *insert_node_p = \
+                BatchKeyLowerBound(batch_node_p, search_key);
+              (insert_node_p != batch_node_p->End()) && \
+                (KeyCmpEqual(search_key, insert_node_p->item.first));
+              insert_node_p++) {
+            if(ValueCmpEqual(insert_node_p->item.second, search_value)) {
+              *index_pair_p = insert_node_p->GetIndexPair();
+
+              return &insert_node_p->item;
+            }
+          }
+
+          node_p = batch_node_p->child_node_p;
+
+          break;
+        } // case LeafBatchInsertType
+        case NodeType::LeafDeleteRangeType: {
+          const LeafDeleteRangeNode *delete_range_node_p = \
+            static_cast<const LeafDeleteRangeNode *>(node_p);
+
+          // All values of the search key below this node are deleted, so
+          // only Insert() will use the index pair
+          if(IsKeyInDeleteRange(search_key, delete_range_node_p) == true) {
+            index_pair_p->first = \
+              GetLeafBaseIndex(delete_range_node_p->child_node_p, search_key);
+            index_pair_p->second = false;
+
+            return nullptr;
+          }
+
+          node_p = delete_range_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteRangeType
+        case NodeType::LeafRemoveType: {
+          bwt_printf("ERROR: Observed LeafRemoveNode in delta chain\n");
+
+          assert(false);
+        } // case LeafRemoveType
+        case NodeType::LeafMergeType: {
+          bwt_printf("Observed a merge node on leaf delta chain\n");
+
+          const LeafMergeNode *merge_node_p = \
+            static_cast<const LeafMergeNode *>(node_p);
+
+          // Decide which side we should choose
+          // Using >= for separator key
+          if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
+            bwt_printf("Take leaf merge right branch\n");
+
+            node_p = merge_node_p->right_merge_p;
+          } else {
+            bwt_printf("Take leaf merge left branch\n");
+
+            node_p = merge_node_p->child_node_p;
+          }
+
+          break;
+        } // case LeafMergeType
+        case NodeType::LeafSplitType: {
+          bwt_printf("Observed a split node on leaf delta chain\n");
+
+          const LeafSplitNode *split_node_p = \
+            static_cast<const LeafSplitNode *>(node_p);
+
+          node_p = split_node_p->child_node_p;
+
+          break;
+        } // case LeafSplitType
+        default: {
+          bwt_printf("ERROR: Unknown leaf delta node type: %d\n",
+                     static_cast<int>(node_p->GetType()));
+
+          assert(false);
+        } // default
+      } // switch
+    } // while
+
+    // We cannot reach here
+    assert(false);
+    return nullptr;
+  }
+  
+  /*
+   * NavigateLeafNode() - Apply predicate to all values, and detect for existing
+   *                      value for insert
+   *
+   * This function cooperates with ConditionalInsert() which requires applying
+   * a predicate to all existing values, and insert the value if and only if:
+   *
+   * 1. The predicate is not satisfied on all existing values
+   * 2. The value does not yet exists in the leaf delta chain
+   *
+   * If any of the above two are true, then we should not insert:
+   *
+   * 1. If predicate is satisfied by an existing value, return nullptr and
+   *    argument predicate_satisfied is set to true
+   * 2. If predicate is not satisfied, but the value already exists, then
+   *    return nullptr but argument predicate_satisfied is unchanged
+   *
+   * If both conditions are true then we always test predicate first
+   * and then test for existence
+   *
+   * If only one condition are true then it depends on the order we
+   * traverse the delta chain and leaf data node, and could not be
+   * guaranteed a specific order
+   */
+  const KeyValuePair *
+  NavigateLeafNode(Context *context_p,
+                   const ValueType &value,
+                   std::pair<int, bool> *index_pair_p,
+                   std::function<bool(const void *)> predicate,
+                   bool *predicate_satisfied) {
+
+
+    // NOTE: We do not have to traverse to the right sibling here
+    // since Traverse() already traverses to the right sibling
+    // if value pointer given to it is nullptr
+    // So we are guaranteed that we are always on the correct leaf
+    // page delta chain on entry of this function
+
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    assert(snapshot_p->IsLeaf() == true);
+
+    const KeyType &search_key = context_p->search_key;
+    const size_t search_key_hash = GetSearchKeyHash(context_p);
+
+    const int set_max_size = node_p->GetDepth() * LEAF_DELTA_RECORD_NUM_MAX;
+
+    const ValueType *present_set_data_p[set_max_size];
+    const ValueType *deleted_set_data_p[set_max_size];
+
+    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
+      present_set{present_set_data_p,
+                  value_eq_obj,
+                  value_hash_obj};
+
+    BloomFilter<ValueType, ValueEqualityChecker, ValueHashFunc> \
+      deleted_set{deleted_set_data_p,
+                  value_eq_obj,
+                  value_hash_obj};
+
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::LeafType: {
+          const LeafNode *leaf_node_p = \
+            static_cast<const LeafNode *>(node_p);
+
+          auto copy_start_it = KeyLowerBound(leaf_node_p->Begin(),
+                                             leaf_node_p->End(),
+                                             search_key);
+
+          // No predicate is evaluated if the fingerprint rules out the key
+          bool key_may_exist = \
+            LeafFingerprintMayContain(leaf_node_p, search_key_hash);
+
+          while((key_may_exist == true) && \
+                (copy_start_it != leaf_node_p->End()) && \
+                (KeyCmpEqual(search_key, copy_start_it->first))) {
+            if(deleted_set.Exists(copy_start_it->second) == false) {
+              if(present_set.Exists(copy_start_it->second) == false) {
+                
+                // If the predicate is satified by the value
+                // then return with predicate flag set to true
+                // Otherwise test for duplication
+                if(predicate(copy_start_it->second) == true) {
+                  *predicate_satisfied = true;
+                  
+                  return nullptr;
+                } else if(value_eq_obj(value, copy_start_it->second) == true) {
+                  // We will not insert anyway....
+                  return &(*copy_start_it);
+                }
+              }
+            }
+
+            copy_start_it++;
+          }
+          
+          // The index is the last element (this is true even if we have seen a
+          // leaf delete node, since the delete node must have deleted a
+          // value that does not exist in leaf base node, so that inserted value
+          // must have the same index)
+          index_pair_p->first = copy_start_it - leaf_node_p->Begin();
+          // Value does not exist
+          index_pair_p->second = false;
+
+          // Only if we return here could we insert
+          return nullptr;
+        }
+        case NodeType::LeafInsertType: {
+          const LeafInsertNode *insert_node_p = \
+            static_cast<const LeafInsertNode *>(node_p);
+
+          if(insert_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, insert_node_p->item.first)) {
+            if(deleted_set.Exists(insert_node_p->item.second) == false) {
+              if(present_set.Exists(insert_node_p->item.second) == false) {
+                present_set.Insert(insert_node_p->item.second);
+
+                // LeafInsertNode means this value exists
+                if(predicate(insert_node_p->item.second) == true) {
+                  *predicate_satisfied = true;
+
+                  // Could return here since we know the predicate is satisfied
+                  return nullptr;
+                } else if(value_eq_obj(value, insert_node_p->item.second) == true) {
+                  // Could also return here since we know the value exists
+                  // and we could not insert anyway
+                  return &insert_node_p->item;
+                } // test predicate and duplicates
+              } // if value not seen
+            } // if value not deleted
+          } // if key equal
+
+          node_p = insert_node_p->child_node_p;
+
+          break;
+        } // case LeafInsertType
+        case NodeType::LeafDeleteType: {
+          const LeafDeleteNode *delete_node_p = \
+            static_cast<const LeafDeleteNode *>(node_p);
+
+          if(delete_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, delete_node_p->item.first)) {
+            if(present_set.Exists(delete_node_p->item.second) == false) {
+              // Even if we know the value does not exist, we still need
+              // to test all predicates to the leaf base node
+              deleted_set.Insert(delete_node_p->item.second);
+            }
+          }
+
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteType
+        case NodeType::LeafUpdateType: {
+          const LeafUpdateNode *update_node_p = \
+            static_cast<const LeafUpdateNode *>(node_p);
+
+          if(update_node_p->key_hash == search_key_hash && \
+             KeyCmpEqual(search_key, update_node_p->item.first)) {
+            if(deleted_set.Exists(update_node_p->item.second) == false) {
+              if(present_set.Exists(update_node_p->item.second) == false) {
+                present_set.Insert(update_node_p->item.second);
+
+                if(predicate(update_node_p->item.second) == true) {
+                  *predicate_satisfied = true;
+
+                  return nullptr;
+                } else if(value_eq_obj(value, update_node_p->item.second) == true) {
+                  return &update_node_p->item;
+                }
+              }
+            }
+
+            const ValueType &old_value = update_node_p->delete_node.item.second;
+            if(present_set.Exists(old_value) == false) {
+              deleted_set.Insert(old_value);
+            }
+          }
+
+          node_p = update_node_p->child_node_p;
+
+          break;
+        } // case LeafUpdateType
+        case NodeType::LeafBatchInsertType: {
+          const LeafBatchInsertNode *batch_node_p = \
+            static_cast<const LeafBatchInsertNode *>(node_p);
+
+          for(const LeafInsertNode *insert_node_p = \
+                BatchKeyLowerBound(batch_node_p, search_key);
+              (insert_node_p != batch_node_p->End()) && \
+                (KeyCmpEqual(search_key, insert_node_p->item.first));
+              insert_node_p++) {
+            const ValueType &insert_value = insert_node_p->item.second;
+
+            if(deleted_set.Exists(insert_value) == false) {
+              if(present_set.Exists(insert_value) == false) {
+                present_set.Insert(insert_value);
+
+                if(predicate(insert_value) == true) {
+                  *predicate_satisfied = true;
+
+                  return nullptr;
+                } else if(value_eq_obj(value, insert_value) == true) {
+                  return &insert_node_p->item;
+                }
+              }
+            }
+          }
+
+          node_p = batch_node_p->child_node_p;
+
+          break;
+        } // case LeafBatchInsertType
+        case NodeType::LeafDeleteRangeType: {
+          const LeafDeleteRangeNode *delete_range_node_p = \
+            static_cast<const LeafDeleteRangeNode *>(node_p);
+
+          // All values of the search key below this node are deleted, so
+          // only Insert() will use the index pair
+          if(IsKeyInDeleteRange(search_key, delete_range_node_p) == true) {
+            index_pair_p->first = \
+              GetLeafBaseIndex(delete_range_node_p->child_node_p, search_key);
+            index_pair_p->second = false;
+
+            return nullptr;
+          }
+
+          node_p = delete_range_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteRangeType
+        case NodeType::LeafRemoveType: {
+          bwt_printf("ERROR: Observed LeafRemoveNode in delta chain\n");
+
+          assert(false);
+        } // case LeafRemoveType
+        case NodeType::LeafMergeType: {
+          bwt_printf("Observed a merge node on leaf delta chain\n");
+
+          const LeafMergeNode *merge_node_p = \
+            static_cast<const LeafMergeNode *>(node_p);
+
+          if(KeyCmpGreaterEqual(search_key, merge_node_p->delete_item.first)) {
+            bwt_printf("Take leaf merge right branch\n");
+
+            node_p = merge_node_p->right_merge_p;
+          } else {
+            bwt_printf("Take leaf merge left branch\n");
+
+            node_p = merge_node_p->child_node_p;
+          }
+
+          break;
+        } // case LeafMergeType
+        case NodeType::LeafSplitType: {
+          bwt_printf("Observed a split node on leaf delta chain\n");
+
+          const LeafSplitNode *split_node_p = \
+            static_cast<const LeafSplitNode *>(node_p);
+
+          node_p = split_node_p->child_node_p;
+
+          break;
+        } // case LeafSplitType
+        default: {
+          bwt_printf("ERROR: Unknown leaf delta node type: %d\n",
+                     static_cast<int>(node_p->GetType()));
+
+          assert(false);
+        } // default
+      } // switch
+    } // while
+
+    // We cannot reach here
+    assert(false);
+    return nullptr;
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Leaf key fingerprint
+  ///////////////////////////////////////////////////////////////////
+
+  /*
+   * GetLeafFingerprintWordNum() - Returns the number of 64 bit words of the
+   *                               fingerprint of a leaf node of given size
+   */
+  static size_t GetLeafFingerprintWordNum(int size) {
+    size_t bit_num = \
+      static_cast<size_t>(size) * LEAF_FINGERPRINT_BITS_PER_KEY;
+
+    return std::max((bit_num + 63UL) / 64UL, 1UL);
+  }
+
+  /*
+   * GetLeafFingerprintSize() - Returns the extra bytes needed by the
+   *                            fingerprint of a leaf node of the given size
+   *
+   * Plus the alignment of the end of the item array
+   */
+  static size_t GetLeafFingerprintSize(int size) {
+    return GetLeafFingerprintWordNum(size) * sizeof(uint64_t) + \
+           alignof(uint64_t);
+  }
+
+  /*
+   * GetLeafFingerprintBit() - Returns the bit of the i-th probe (0 or 1) of
+   *                           a key hash in a fingerprint of bit_num bits
+   *
+   * Each half of the hash is mapped to [0, bit_num) by multiply-shift
+   */
+  static size_t GetLeafFingerprintBit(size_t key_hash,
+                                      int i,
+                                      size_t bit_num) {
+    uint64_t half = (static_cast<uint64_t>(key_hash) >> (32 * i)) & \
+                    0xFFFFFFFFUL;
+
+    return static_cast<size_t>((half * bit_num) >> 32);
+  }
+
+  /*
+   * BuildLeafFingerprint() - Builds the fingerprint of a leaf node
+   *
+   * The fingerprint is a bloom filter with two probes over the keys of the
+   * node, such that a search key whose bits are not all set could not be
+   * on the node, and the binary search and key comparisons are skipped.
+   * With LEAF_FINGERPRINT_BITS_PER_KEY = 8 about 5% of missing keys still
+   * search the node
+   *
+   * NOTE: The node must have been allocated with the size given by
+   * GetLeafFingerprintSize(), and must not be modified after this
+   */
+  void BuildLeafFingerprint(LeafNode *leaf_node_p) const {
+    int size = leaf_node_p->GetSize();
+
+    uintptr_t fingerprint_addr = \
+      reinterpret_cast<uintptr_t>(leaf_node_p->End());
+    fingerprint_addr = (fingerprint_addr + alignof(uint64_t) - 1) / \
+                       alignof(uint64_t) * alignof(uint64_t);
+
+    uint64_t *word_list = reinterpret_cast<uint64_t *>(fingerprint_addr);
+    size_t word_num = GetLeafFingerprintWordNum(size);
+    size_t bit_num = word_num * 64UL;
+
+    std::fill(word_list, word_list + word_num, 0UL);
+
+    for(const KeyValuePair *it = leaf_node_p->Begin();
+        it != leaf_node_p->End();
+        it++) {
+      size_t key_hash = GetKeyHash(it->first);
+
+      for(int i = 0;i < 2;i++) {
+        size_t bit = GetLeafFingerprintBit(key_hash, i, bit_num);
+
+        word_list[bit / 64UL] |= (0x1UL << (bit % 64UL));
+      }
+    }
+
+    leaf_node_p->SetSearchIndex(reinterpret_cast<char *>(word_list));
+
+    return;
+  }
+
+  /*
+   * LeafFingerprintMayContain() - Returns false if the key of the given hash
+   *                               is definitely not on the leaf node
+   *
+   * Leaf nodes without a fingerprint may contain any key
+   */
+  static bool LeafFingerprintMayContain(const LeafNode *leaf_node_p,
+                                        size_t key_hash) {
+    const uint64_t *word_list = \
+      reinterpret_cast<const uint64_t *>(leaf_node_p->GetSearchIndex());
+
+    if(word_list == nullptr) {
+      return true;
+    }
+
+    size_t bit_num = GetLeafFingerprintWordNum(leaf_node_p->GetSize()) * 64UL;
+
+    for(int i = 0;i < 2;i++) {
+      size_t bit = GetLeafFingerprintBit(key_hash, i, bit_num);
+
+      if((word_list[bit / 64UL] & (0x1UL << (bit % 64UL))) == 0UL) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /*
+   * CollectAllValuesOnLeaf() - Consolidate delta chain for a single logical
+   *                            leaf node
+   *
+   * This function is the non-recursive wrapper of the resursive core function.
+   * It calls the recursive version to collect all base leaf nodes, and then
+   * it replays delta records on top of them.
+   *
+   * If leaf_node_p is nullptr (default) then a new leaf node instance is 
+   * created; Otherwise we simply use the existing pointer *WITHOUT* performing
+   * any initialization. This implies that the caller should initialize
+   * a valid LeafNode object before calling this function
+   *
+   * If fingerprint_flag is true then the key fingerprint is also built for
+   * the new node (see BuildLeafFingerprint()). This is ignored if the node
+   * is given by the caller
+   */
+  LeafNode *CollectAllValuesOnLeaf(NodeSnapshot *snapshot_p,
+                                   LeafNode *leaf_node_p=nullptr,
+                                   bool fingerprint_flag=false) {
+    assert(snapshot_p->IsLeaf() == true);
+
+    const BaseNode *node_p = snapshot_p->node_p;
+    
+    /////////////////////////////////////////////////////////////////
+    // Prepare new node
+    /////////////////////////////////////////////////////////////////
+
+    if(likely(leaf_node_p == nullptr)) {
+      leaf_node_p = \
+        reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
+          Get(node_p->GetItemCount(),
+              NodeType::LeafType,
+              0,
+              node_p->GetItemCount(),
+              node_p->GetLowKeyPair(),
+              node_p->GetHighKeyPair(),
+              fingerprint_flag ? \
+                GetLeafFingerprintSize(node_p->GetItemCount()) : 0UL));
+    } else {
+      fingerprint_flag = false;
+    }
+    
+    assert(leaf_node_p != nullptr);
+
+    // Iterators and checkpoints load the first leaf without a traversal,
+    // and locate the others with read-only traversals, so they could see a
+    // compressed leaf
+    if(node_p->GetType() == NodeType::LeafCompressedType) {
+      DecompressLeafNode(static_cast<const CompressedLeafNode *>(node_p),
+                         leaf_node_p);
+
+      if(fingerprint_flag == true) {
+        BuildLeafFingerprint(leaf_node_p);
+      }
+
+      return leaf_node_p;
+    }
+    
+    /////////////////////////////////////////////////////////////////
+    // Prepare Delta Set
+    /////////////////////////////////////////////////////////////////
+    
+    // This is the number of delta records inside the logical node
+    // including merged delta chains. Each LeafUpdateNode contributes
+    // two data nodes, and each LeafBatchInsertNode up to its capacity
+    int delta_change_num = node_p->GetDepth() * LEAF_DELTA_RECORD_NUM_MAX;
+
+    // We only need to keep those on the delta chian into a set
+    // and those in the data list of leaf page do not need to be
+    // put in the set
+    // This is used to dedup already seen key-value pairs
+    const KeyValuePair *delta_set_data_p[delta_change_num];
+
+    // This set is used as the set for deduplicating already seen
+    // key value pairs
+    KeyValuePairBloomFilter delta_set{delta_set_data_p,
+                                      key_value_pair_eq_obj,
+                                      key_value_pair_hash_obj};
+                                        
+    /////////////////////////////////////////////////////////////////
+    // Prepare Small Sorted Set
+    /////////////////////////////////////////////////////////////////
+    
+    const LeafDataNode *sss_data_p[delta_change_num];
+    
+    auto f1 = [this](const LeafDataNode *ldn1, const LeafDataNode *ldn2) {
+      // Compare using key first; if keys are equal then compare using
+      // index (since we must pop those nodes in a key-order given the index)
+      // NOTE: Since in leaf node keys are sorted, if keys are sorted then
+      // indices only needs sorting inside the range of the key
+      if(this->key_cmp_obj(ldn1->item.first, ldn2->item.first)) {
+        return true;
+      } else if(this->key_eq_obj(ldn1->item.first, ldn2->item.first)) {
+        return ldn1->GetIndexPair().first < ldn2->GetIndexPair().first;
+      } else {
+        return false;
+      }
+    };
+    
+    // This is not used since in this case we do not need to compare
+    // for equal relation
+    auto f2 = [this](const LeafDataNode *ldn1, const LeafDataNode *ldn2) {
+      (void)ldn1;
+      (void)ldn2;
+      
+      assert(false);
+      return false;
+    };
+    
+    // Declare an sss object with the previously declared comparators and
+    // null equality checkers (not used)
+    SortedSmallSet<const LeafDataNode *, decltype(f1), decltype(f2)> \
+      sss{sss_data_p, f1, f2};
+    
+    /////////////////////////////////////////////////////////////////
+    // Start collecting values!
+    /////////////////////////////////////////////////////////////////
+
+    // Range tombstones are at most as many as delta records
+    const LeafDeleteRangeNode *delete_range_data_p[node_p->GetDepth()];
+
+    DeleteRangeSet delete_range_set{delete_range_data_p, 0};
+
+    // We collect all valid values in present_set
+    // and deleted_set is just for bookkeeping
+    CollectAllValuesOnLeafRecursive(node_p,
+                                    sss,
+                                    delta_set,
+                                    delete_range_set,
+                                    leaf_node_p);
+
+    // Item count would not change during consolidation
+    assert(leaf_node_p->GetSize() == node_p->GetItemCount());
+
+    if(fingerprint_flag == true) {
+      BuildLeafFingerprint(leaf_node_p);
+    }
+
+    return leaf_node_p;
+  }
+
+  /*
+   * CollectAllValuesOnLeafRecursive() - Collect all values given a
+   *                                     pointer recursively
+   *
+   * It does not need NodeID to collect values since only read-only
+   * routine calls this one, so no validation is ever needed even in
+   * its caller.
+   *
+   * This function only travels using physical pointer, which implies
+   * that it does not deal with LeafSplitNode and LeafRemoveNode
+   * For LeafSplitNode it only collects value on child node
+   * For LeafRemoveNode it fails assertion
+   * If LeafRemoveNode is not the topmost node it also fails assertion
+   *
+   * NOTE: This function calls itself to collect values in a merge node
+   * since logically speaking merge node consists of two delta chains
+   *
+   * Range tombstones are added into delete_range_set as they are seen, and
+   * data records below them as well as items on the base node are skipped
+   * if their keys are inside any of the ranges
+   * DO NOT CALL THIS DIRECTLY - Always use the wrapper (the one without
+   * "Recursive" suffix)
+   */
+  template <typename T>  // To let the compiler deduce type of sss
+  void
+  CollectAllValuesOnLeafRecursive(const BaseNode *node_p,
+                                  T &sss,
+                                  KeyValuePairBloomFilter &delta_set,
+                                  DeleteRangeSet &delete_range_set,
+                                  LeafNode *new_leaf_node_p) const {
+    // The top node is used to derive high key
+    // NOTE: Low key for Leaf node and its delta chain is nullptr
+    const KeyNodeIDPair &high_key_pair = node_p->GetHighKeyPair();
+
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        // When we see a leaf node, just copy all keys together with
+        // all values into the value set
+        case NodeType::LeafType: {
+          const LeafNode *leaf_node_p = \
+            static_cast<const LeafNode *>(node_p);
+
+          // We compute end iterator based on the high key
+          const KeyValuePair *copy_end_it;
+
+          // If the high key is +Inf then all items could be copied
+          if((high_key_pair.second == INVALID_NODE_ID)) {
+            copy_end_it = leaf_node_p->End();
+          } else {
+            // This points copy_end_it to the first element >= current high key
+            // If no such element exists then copy_end_it is end() iterator
+            // which is also consistent behavior
+            copy_end_it = std::lower_bound(leaf_node_p->Begin(),
+                                           leaf_node_p->End(),
+                                           // It only compares key so we
+                                           // just use high key pair
+                                           std::make_pair(high_key_pair.first, ValueType{}),
+                                           key_value_pair_cmp_obj);
+          }
+          
+          // This is the index of the copy end it
+          int copy_end_index = \
+            static_cast<int>(copy_end_it - leaf_node_p->Begin());
+          int copy_start_index = 0;
+
+          // Copies base items in [copy_start, copy_end) which are not
+          // deleted by range tombstones
+          auto copy_items = [this, &delete_range_set, new_leaf_node_p]
+                            (const KeyValuePair *copy_start,
+                             const KeyValuePair *copy_end) {
+            if(delete_range_set.size == 0) {
+              new_leaf_node_p->PushBack(copy_start, copy_end);
+
+              return;
+            }
+
+            // Runs of items between deleted ones are still copied
+            // with the range version of PushBack()
+            while(copy_start != copy_end) {
+              const KeyValuePair *run_end = copy_start;
+              while(run_end != copy_end && \
+                    IsKeyInDeleteRangeSet(run_end->first,
+                                          delete_range_set) == false) {
+                run_end++;
+              }
+
+              new_leaf_node_p->PushBack(copy_start, run_end);
+
+              copy_start = run_end;
+              while(copy_start != copy_end && \
+                    IsKeyInDeleteRangeSet(copy_start->first,
+                                          delete_range_set) == true) {
+                copy_start++;
+              }
+            }
+          };
+
+          ///////////////////////////////////////////////////////////
+          // Find the end index for sss
+          ///////////////////////////////////////////////////////////
+
+          // Find the end of copying
+          auto sss_end_it = sss.GetEnd() - 1;
+
+          // If the next key is +Inf then sss_end_it is the real end of the
+          // sorted array
+          if(high_key_pair.second != INVALID_NODE_ID) {
+            // Corner case: If the first element is lower bound
+            // then current_p will move outside
+            // the valid range of the array but still we return
+            // the first element in the array
+            while(sss_end_it >= sss.GetBegin()) {
+              if(key_cmp_obj((*sss_end_it)->item.first, high_key_pair.first) == true) {
+                break;
+              }
+
+              sss_end_it--;
+            }
+          }
+
+          // This points to the first element >= high key
+          sss_end_it++;
+          
+          ///////////////////////////////////////////////////////////
+          // Start merge loop
+          ///////////////////////////////////////////////////////////
+
+          // While the sss has not reached the end for this node
+          while(sss.GetBegin() != sss_end_it) {
+            int current_index = sss.GetFront()->GetIndexPair().first;
+            
+            // If we did not see any overwriting delta then
+            // we also copy the old item in leaf node
+            bool item_overwritten = false;
+            
+            assert(copy_start_index <= current_index);
+            assert(current_index <= copy_end_index);
+            
+            // First copy all items before the current index
+            copy_items(leaf_node_p->Begin() + copy_start_index,
+                       leaf_node_p->Begin() + current_index);
+
+            // Update copy start index for next copy
+            copy_start_index = current_index;
+            
+            // Drain delta records on the same index
+            while(sss.GetFront()->GetIndexPair().first == current_index) {
+              // Update current status of the item on leaf base node
+              // IndexPair.second == true if the value has been overwritten
+              item_overwritten = item_overwritten || sss.GetFront()->GetIndexPair().second;
+              
+              // We only insert those in LeafInsertNode (and the inserted
+              // half of LeafUpdateNode) and ignore all LeafDeleteNode
+              if(sss.GetFront()->GetType() != NodeType::LeafDeleteType) {
+                // We remove the element from sss here
+                new_leaf_node_p->PushBack(sss.PopFront()->item);
+              } else {
+                assert(sss.GetFront()->GetType() == NodeType::LeafDeleteType);
+
+                // ... and here
+                sss.PopFront();
+              }
+              
+              // If we have drained sss
+              if(sss.GetBegin() == sss_end_it) {
+                break;
+              }
+            }
+            
+            // If the element has been overwritten by some of the deltas
+            // just advance the pointer
+            if(item_overwritten == true) {
+              copy_start_index++;
+            }
+          } // while sss has not reached the copy end
+          
+          // Also need to insert all other elements if there are some
+          copy_items(leaf_node_p->Begin() + copy_start_index,
+                     leaf_node_p->Begin() + copy_end_index);
+
+          return;
+        } // case LeafType
+        case NodeType::LeafInsertType: {
+          const LeafInsertNode *insert_node_p = \
+            static_cast<const LeafInsertNode *>(node_p);
+
+          if(IsKeyInDeleteRangeSet(insert_node_p->item.first,
+                                   delete_range_set) == false && \
+             delta_set.Exists(insert_node_p->item) == false) {
+            delta_set.Insert(insert_node_p->item);
+
+            sss.InsertNoDedup(insert_node_p);
+          }
+
+          node_p = insert_node_p->child_node_p;
+
+          break;
+        } // case LeafInsertType
+        case NodeType::LeafDeleteType: {
+          const LeafDeleteNode *delete_node_p = \
+            static_cast<const LeafDeleteNode *>(node_p);
+
+          if(IsKeyInDeleteRangeSet(delete_node_p->item.first,
+                                   delete_range_set) == false && \
+             delta_set.Exists(delete_node_p->item) == false) {
+            delta_set.Insert(delete_node_p->item);
+
+            sss.InsertNoDedup(delete_node_p);
+          }
+
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteType
+        case NodeType::LeafUpdateType: {
+          const LeafUpdateNode *update_node_p = \
+            static_cast<const LeafUpdateNode *>(node_p);
+
+          // Both halves are merged as separate data nodes
+          if(IsKeyInDeleteRangeSet(update_node_p->item.first,
+                                   delete_range_set) == false) {
+            if(delta_set.Exists(update_node_p->item) == false) {
+              delta_set.Insert(update_node_p->item);
+
+              sss.InsertNoDedup(update_node_p);
+            }
+
+            const LeafDeleteNode *delete_node_p = &update_node_p->delete_node;
+
+            if(delta_set.Exists(delete_node_p->item) == false) {
+              delta_set.Insert(delete_node_p->item);
+
+              sss.InsertNoDedup(delete_node_p);
+            }
+          }
+
+          node_p = update_node_p->child_node_p;
+
+          break;
+        } // case LeafUpdateType
+        case NodeType::LeafBatchInsertType: {
+          const LeafBatchInsertNode *batch_node_p = \
+            static_cast<const LeafBatchInsertNode *>(node_p);
+
+          // Embedded insert nodes are merged as separate data nodes
+          for(const LeafInsertNode *insert_node_p = batch_node_p->Begin();
+              insert_node_p != batch_node_p->End();
+              insert_node_p++) {
+            if(IsKeyInDeleteRangeSet(insert_node_p->item.first,
+                                     delete_range_set) == false && \
+               delta_set.Exists(insert_node_p->item) == false) {
+              delta_set.Insert(insert_node_p->item);
+
+              sss.InsertNoDedup(insert_node_p);
+            }
+          }
+
+          node_p = batch_node_p->child_node_p;
+
+          break;
+        } // case LeafBatchInsertType
+        case NodeType::LeafDeleteRangeType: {
+          const LeafDeleteRangeNode *delete_range_node_p = \
+            static_cast<const LeafDeleteRangeNode *>(node_p);
+
+          delete_range_set.data_p[delete_range_set.size] = delete_range_node_p;
+          delete_range_set.size++;
+
+          node_p = delete_range_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteRangeType
+        case NodeType::LeafRemoveType: {
+          bwt_printf("ERROR: LeafRemoveNode not allowed\n");
+
+          assert(false);
+        } // case LeafRemoveType
+        case NodeType::LeafSplitType: {
+          const LeafSplitNode *split_node_p = \
+            static_cast<const LeafSplitNode *>(node_p);
+
+          node_p = split_node_p->child_node_p;
+
+          break;
+        } // case LeafSplitType
+        case NodeType::LeafMergeType: {
+          const LeafMergeNode *merge_node_p = \
+            static_cast<const LeafMergeNode *>(node_p);
+
+          // Range tombstones seen in the left branch do not apply to
+          // the right branch
+          int delete_range_num = delete_range_set.size;
+
+          /**** RECURSIVE CALL ON LEFT AND RIGHT SUB-TREE ****/
+          CollectAllValuesOnLeafRecursive(merge_node_p->child_node_p,
+                                          sss,
+                                          delta_set,
+                                          delete_range_set,
+                                          new_leaf_node_p);
+
+          delete_range_set.size = delete_range_num;
+
+          CollectAllValuesOnLeafRecursive(merge_node_p->right_merge_p,
+                                          sss,
+                                          delta_set,
+                                          delete_range_set,
+                                          new_leaf_node_p);
+
+          return;
+        } // case LeafMergeType
+        default: {
+          bwt_printf("ERROR: Unknown node type: %d\n",
+                     static_cast<int>(type));
+
+          assert(false);
+        } // default
+      } // switch
+    } // while(1)
+
+    return;
+  }
+
+  /*
+   * CollectRangeOnLeaf() - Collect key value pairs inside a key range
+   *                        from a single logical leaf node
+   *
+   * This function is a bounded version of CollectAllValuesOnLeaf(). Only
+   * items whose key is inside [*start_key_p, *high_key_p) are collected, and
+   * at most limit items are appended to item_list_p in key order. If
+   * either key pointer is nullptr then the range is only bounded by the
+   * low key or high key of the logical node on that side
+   *
+   * Delta records outside the range are not merged, and on the base node
+   * we only copy the portion inside the range, so the cost is proportional
+   * to the number of items returned rather than the size of the leaf
+   *
+   * The leaf is read as of the given version (see Snapshot()): delta records
+   * with a larger version are ignored, and base nodes with a larger version
+   * are replaced by the delta chain they replaced
+   */
+  void CollectRangeOnLeaf(const BaseNode *node_p,
+                          const KeyType *start_key_p,
+                          const KeyType *high_key_p,
+                          size_t limit,
+                          std::vector<KeyValuePair> *item_list_p,
+                          uint64_t version = LATEST_VERSION) const {
+    assert(node_p->IsOnLeafDeltaChain() == true);
+
+    // Versions newer than the given one are skipped here rather than by
+    // CollectRangeOnLeafRecursive(), since every consolidation after a
+    // snapshot is taken adds one to the chain of previous versions, which
+    // would otherwise be read with one level of recursion each
+    while(version != LATEST_VERSION) {
+      const BaseNode *base_node_p = node_p;
+      while(base_node_p->IsDeltaNode() == true && \
+            base_node_p->GetType() != NodeType::LeafMergeType) {
+        base_node_p = \
+          static_cast<const DeltaNode *>(base_node_p)->child_node_p;
+      }
+
+      // Compressed leaf nodes are only read by read-only traversals, and
+      // they are never below a delta record
+      uint64_t base_version;
+      const BaseNode *previous_p;
+      if(base_node_p->GetType() == NodeType::LeafType) {
+        base_version = \
+          static_cast<const LeafNode *>(base_node_p)->GetVersion();
+        previous_p = \
+          static_cast<const LeafNode *>(base_node_p)->GetPreviousVersion();
+      } else if(base_node_p->GetType() == NodeType::LeafCompressedType) {
+        base_version = \
+          static_cast<const CompressedLeafNode *>(base_node_p)->GetVersion();
+        previous_p = static_cast<const CompressedLeafNode *>(base_node_p)-> \
+                       GetPreviousVersion();
+      } else {
+        break;
+      }
+
+      if(base_version <= version) {
+        break;
+      }
+
+      // The previous version is restricted to the range of this node in
+      // the same way as in CollectRangeOnLeafRecursive()
+      const KeyNodeIDPair &low_key_pair = node_p->GetLowKeyPair();
+      const KeyNodeIDPair &high_key_pair = node_p->GetHighKeyPair();
+
+      if((low_key_pair.second != INVALID_NODE_ID) && \
+         ((start_key_p == nullptr) || \
+          (KeyCmpLess(*start_key_p, low_key_pair.first) == true))) {
+        start_key_p = &low_key_pair.first;
+      }
+
+      if((high_key_pair.second != INVALID_NODE_ID) && \
+         ((high_key_p == nullptr) || \
+          (KeyCmpLess(high_key_pair.first, *high_key_p) == true))) {
+        high_key_p = &high_key_pair.first;
+      }
+
+      node_p = previous_p;
+      assert(node_p != nullptr);
+    }
+
+    // Items already in the list are not counted into the limit, which
+    // might be as large as (size_t)-1 for unlimited scans
+    size_t list_limit = item_list_p->size() + \
+                        std::min(limit, static_cast<size_t>(-1) - \
+                                          item_list_p->size());
+
+    // Items are decoded in key order, so decoding stops at the high key
+    if(node_p->GetType() == NodeType::LeafCompressedType) {
+      DecodeLeafItems(
+        static_cast<const CompressedLeafNode *>(node_p),
+        [this, start_key_p, high_key_p, list_limit, item_list_p]
+        (const KeyType &key, const ValueType &value) {
+          if((item_list_p->size() == list_limit) || \
+             ((high_key_p != nullptr) && \
+              (KeyCmpLess(key, *high_key_p) == false))) {
+            return false;
+          }
+
+          if(IsKeyInScanRange(key, start_key_p, high_key_p) == true) {
+            item_list_p->push_back(std::make_pair(key, value));
+          }
+
+          return true;
+        });
+
+      return;
+    }
+
+    // Delta set and small sorted set are organized in the same way as
+    // CollectAllValuesOnLeaf()
+    int delta_change_num = node_p->GetDepth() * LEAF_DELTA_RECORD_NUM_MAX;
+
+    const KeyValuePair *delta_set_data_p[delta_change_num];
+
+    KeyValuePairBloomFilter delta_set{delta_set_data_p,
+                                      key_value_pair_eq_obj,
+                                      key_value_pair_hash_obj};
+
+    const LeafDataNode *sss_data_p[delta_change_num];
+
+    auto f1 = [this](const LeafDataNode *ldn1, const LeafDataNode *ldn2) {
+      if(this->key_cmp_obj(ldn1->item.first, ldn2->item.first)) {
+        return true;
+      } else if(this->key_eq_obj(ldn1->item.first, ldn2->item.first)) {
+        return ldn1->GetIndexPair().first < ldn2->GetIndexPair().first;
+      } else {
+        return false;
+      }
+    };
+
+    auto f2 = [this](const LeafDataNode *ldn1, const LeafDataNode *ldn2) {
+      (void)ldn1;
+      (void)ldn2;
+
+      assert(false);
+      return false;
+    };
+
+    SortedSmallSet<const LeafDataNode *, decltype(f1), decltype(f2)> \
+      sss{sss_data_p, f1, f2};
+
+    const LeafDeleteRangeNode *delete_range_data_p[node_p->GetDepth()];
+
+    DeleteRangeSet delete_range_set{delete_range_data_p, 0};
+
+    CollectRangeOnLeafRecursive(node_p,
+                                sss,
+                                delta_set,
+                                delete_range_set,
+                                start_key_p,
+                                high_key_p,
+                                list_limit,
+                                item_list_p,
+                                version);
+
+    // The last base node might have pushed more items than needed
+    if(item_list_p->size() > list_limit) {
+      item_list_p->erase(item_list_p->begin() + list_limit,
+                         item_list_p->end());
+    }
+
+    return;
+  }
+
+  /*
+   * IsKeyInScanRange() - Whether a leaf data item should be collected
+   *                      by CollectRangeOnLeafRecursive()
+   */
+  inline bool IsKeyInScanRange(const KeyType &key,
+                               const KeyType *start_key_p,
+                               const KeyType *high_key_p) const {
+    if((start_key_p != nullptr) && (KeyCmpLess(key, *start_key_p) == true)) {
+      return false;
+    }
+
+    return (high_key_p == nullptr) || (KeyCmpLess(key, *high_key_p) == true);
+  }
+
+  /*
+   * CollectRangeOnLeafRecursive() - Collect values in a range given a
+   *                                 pointer recursively
+   *
+   * The structure of this function is identical to
+   * CollectAllValuesOnLeafRecursive(), except that delta records outside the
+   * scan range are ignored, copying on base nodes starts from the first
+   * item >= start key, and the merge loop stops once the limit is reached.
+   * Range tombstones are handled in the same way
+   *
+   * NOTE: Since all keys in the left branch of a merge node are smaller than
+   * keys in the right branch, we could skip the right branch if the limit
+   * has been reached on the left branch
+   *
+   * NOTE 2: A base node newer than the version is installed after all
+   * delta records that are visible at the version, so any delta record
+   * above it is also newer, and nothing has been collected for its range.
+   * The chain it replaced is then read instead, restricted to the key range
+   * of the node we started from, since the chain covers a wider range if it
+   * has been split or merged since then
+   */
+  template <typename T>
+  void
+  CollectRangeOnLeafRecursive(const BaseNode *node_p,
+                              T &sss,
+                              KeyValuePairBloomFilter &delta_set,
+                              DeleteRangeSet &delete_range_set,
+                              const KeyType *start_key_p,
+                              const KeyType *high_key_p,
+                              size_t list_limit,
+                              std::vector<KeyValuePair> *item_list_p,
+                              uint64_t version) const {
+    const KeyNodeIDPair &low_key_pair = node_p->GetLowKeyPair();
+    const KeyNodeIDPair &high_key_pair = node_p->GetHighKeyPair();
+
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::LeafType: {
+          const LeafNode *leaf_node_p = \
+            static_cast<const LeafNode *>(node_p);
+
+          if(leaf_node_p->GetVersion() > version) {
+            assert(leaf_node_p->GetPreviousVersion() != nullptr);
+
+            const KeyType *previous_start_key_p = start_key_p;
+            if((low_key_pair.second != INVALID_NODE_ID) && \
+               ((start_key_p == nullptr) || \
+                (KeyCmpLess(*start_key_p, low_key_pair.first) == true))) {
+              previous_start_key_p = &low_key_pair.first;
+            }
+
+            const KeyType *previous_high_key_p = high_key_p;
+            if((high_key_pair.second != INVALID_NODE_ID) && \
+               ((high_key_p == nullptr) || \
+                (KeyCmpLess(high_key_pair.first, *high_key_p) == true))) {
+              previous_high_key_p = &high_key_pair.first;
+            }
+
+            if(item_list_p->size() < list_limit) {
+              CollectRangeOnLeaf(leaf_node_p->GetPreviousVersion(),
+                                 previous_start_key_p,
+                                 previous_high_key_p,
+                                 list_limit - item_list_p->size(),
+                                 item_list_p,
+                                 version);
+            }
+
+            return;
+          }
+
+          const KeyValuePair *copy_end_it = leaf_node_p->End();
+
+          if(high_key_pair.second != INVALID_NODE_ID) {
+            copy_end_it = KeyLowerBound(leaf_node_p->Begin(),
+                                        copy_end_it,
+                                        high_key_pair.first);
+          }
+
+          if(high_key_p != nullptr) {
+            copy_end_it = KeyLowerBound(leaf_node_p->Begin(),
+                                        copy_end_it,
+                                        *high_key_p);
+          }
+
+          const KeyValuePair *copy_start_it = leaf_node_p->Begin();
+          if(start_key_p != nullptr) {
+            copy_start_it = \
+              KeyLowerBound(leaf_node_p->Begin(), copy_end_it, *start_key_p);
+          }
+
+          int copy_end_index = \
+            static_cast<int>(copy_end_it - leaf_node_p->Begin());
+          int copy_start_index = \
+            static_cast<int>(copy_start_it - leaf_node_p->Begin());
+
+          auto copy_items = [this, &delete_range_set, item_list_p]
+                            (const KeyValuePair *copy_start,
+                             const KeyValuePair *copy_end) {
+            if(delete_range_set.size == 0) {
+              item_list_p->insert(item_list_p->end(), copy_start, copy_end);
+
+              return;
+            }
+
+            for(;copy_start != copy_end;copy_start++) {
+              if(IsKeyInDeleteRangeSet(copy_start->first,
+                                       delete_range_set) == false) {
+                item_list_p->push_back(*copy_start);
+              }
+            }
+          };
+
+          // Only items < high key of the current node are merged
+          auto sss_end_it = sss.GetEnd() - 1;
+
+          if(high_key_pair.second != INVALID_NODE_ID) {
+            while(sss_end_it >= sss.GetBegin()) {
+              if(key_cmp_obj((*sss_end_it)->item.first, high_key_pair.first) == true) {
+                break;
+              }
+
+              sss_end_it--;
+            }
+          }
+
+          sss_end_it++;
+
+          while(sss.GetBegin() != sss_end_it) {
+            if(item_list_p->size() >= list_limit) {
+              return;
+            }
+
+            int current_index = sss.GetFront()->GetIndexPair().first;
+            bool item_overwritten = false;
+
+            assert(copy_start_index <= current_index);
+            assert(current_index <= copy_end_index);
+
+            copy_items(leaf_node_p->Begin() + copy_start_index,
+                       leaf_node_p->Begin() + current_index);
+
+            copy_start_index = current_index;
+
+            while(sss.GetFront()->GetIndexPair().first == current_index) {
+              item_overwritten = item_overwritten || sss.GetFront()->GetIndexPair().second;
+
+              if(sss.GetFront()->GetType() != NodeType::LeafDeleteType) {
+                item_list_p->push_back(sss.PopFront()->item);
+              } else {
+                assert(sss.GetFront()->GetType() == NodeType::LeafDeleteType);
+
+                sss.PopFront();
+              }
+
+              if(sss.GetBegin() == sss_end_it) {
+                break;
+              }
+            }
+
+            if(item_overwritten == true) {
+              copy_start_index++;
+            }
+          } // while sss has not reached the copy end
+
+          if(item_list_p->size() >= list_limit) {
+            return;
+          }
+
+          // Do not copy more than needed from the rest of the base node
+          // (if there are range tombstones then the wrapper trims the list)
+          if(delete_range_set.size == 0) {
+            size_t remaining_num = list_limit - item_list_p->size();
+            if(remaining_num < \
+               static_cast<size_t>(copy_end_index - copy_start_index)) {
+              copy_end_index = \
+                copy_start_index + static_cast<int>(remaining_num);
+            }
+          }
+
+          copy_items(leaf_node_p->Begin() + copy_start_index,
+                     leaf_node_p->Begin() + copy_end_index);
+
+          return;
+        } // case LeafType
+        case NodeType::LeafInsertType:
+        case NodeType::LeafDeleteType: {
+          const LeafDataNode *data_node_p = \
+            static_cast<const LeafDataNode *>(node_p);
+
+          // Delta records outside the range would never be output, and
+          // they could not shadow items inside the range
+          if(data_node_p->version <= version && \
+             IsKeyInScanRange(data_node_p->item.first,
+                              start_key_p,
+                              high_key_p) == true && \
+             IsKeyInDeleteRangeSet(data_node_p->item.first,
+                                   delete_range_set) == false) {
+            if(delta_set.Exists(data_node_p->item) == false) {
+              delta_set.Insert(data_node_p->item);
+
+              sss.InsertNoDedup(data_node_p);
+            }
+          }
+
+          node_p = data_node_p->child_node_p;
+
+          break;
+        } // case LeafInsertType / LeafDeleteType
+        case NodeType::LeafUpdateType: {
+          const LeafUpdateNode *update_node_p = \
+            static_cast<const LeafUpdateNode *>(node_p);
+
+          if(update_node_p->version <= version && \
+             IsKeyInScanRange(update_node_p->item.first,
+                              start_key_p,
+                              high_key_p) == true && \
+             IsKeyInDeleteRangeSet(update_node_p->item.first,
+                                   delete_range_set) == false) {
+            if(delta_set.Exists(update_node_p->item) == false) {
+              delta_set.Insert(update_node_p->item);
+
+              sss.InsertNoDedup(update_node_p);
+            }
+
+            const LeafDeleteNode *delete_node_p = &update_node_p->delete_node;
+
+            if(delta_set.Exists(delete_node_p->item) == false) {
+              delta_set.Insert(delete_node_p->item);
+
+              sss.InsertNoDedup(delete_node_p);
+            }
+          }
+
+          node_p = update_node_p->child_node_p;
+
+          break;
+        } // case LeafUpdateType
+        case NodeType::LeafBatchInsertType: {
+          const LeafBatchInsertNode *batch_node_p = \
+            static_cast<const LeafBatchInsertNode *>(node_p);
+
+          // Only embedded insert nodes from the start key are in the range
+          const LeafInsertNode *insert_start_p = batch_node_p->Begin();
+          if(start_key_p != nullptr) {
+            insert_start_p = BatchKeyLowerBound(batch_node_p, *start_key_p);
+          }
+
+          // Embedded insert nodes all have the version of the batch
+          if(batch_node_p->version > version) {
+            insert_start_p = batch_node_p->End();
+          }
+
+          for(const LeafInsertNode *insert_node_p = insert_start_p;
+              (insert_node_p != batch_node_p->End()) && \
+                (IsKeyInScanRange(insert_node_p->item.first,
+                                  start_key_p,
+                                  high_key_p) == true);
+              insert_node_p++) {
+            if(IsKeyInDeleteRangeSet(insert_node_p->item.first,
+                                     delete_range_set) == false && \
+               delta_set.Exists(insert_node_p->item) == false) {
+              delta_set.Insert(insert_node_p->item);
+
+              sss.InsertNoDedup(insert_node_p);
+            }
+          }
+
+          node_p = batch_node_p->child_node_p;
+
+          break;
+        } // case LeafBatchInsertType
+        case NodeType::LeafDeleteRangeType: {
+          const LeafDeleteRangeNode *delete_range_node_p = \
+            static_cast<const LeafDeleteRangeNode *>(node_p);
+
+          if(delete_range_node_p->version <= version) {
+            delete_range_set.data_p[delete_range_set.size] = \
+              delete_range_node_p;
+            delete_range_set.size++;
+          }
+
+          node_p = delete_range_node_p->child_node_p;
+
+          break;
+        } // case LeafDeleteRangeType
+        case NodeType::LeafRemoveType: {
+          bwt_printf("ERROR: LeafRemoveNode not allowed\n");
+
+          assert(false);
+        } // case LeafRemoveType
+        case NodeType::LeafSplitType: {
+          const LeafSplitNode *split_node_p = \
+            static_cast<const LeafSplitNode *>(node_p);
+
+          node_p = split_node_p->child_node_p;
+
+          break;
+        } // case LeafSplitType
+        case NodeType::LeafMergeType: {
+          const LeafMergeNode *merge_node_p = \
+            static_cast<const LeafMergeNode *>(node_p);
+
+          int delete_range_num = delete_range_set.size;
+
+          CollectRangeOnLeafRecursive(merge_node_p->child_node_p,
+                                      sss,
+                                      delta_set,
+                                      delete_range_set,
+                                      start_key_p,
+                                      high_key_p,
+                                      list_limit,
+                                      item_list_p,
+                                      version);
+
+          if(item_list_p->size() >= list_limit) {
+            return;
+          }
+
+          delete_range_set.size = delete_range_num;
+
+          CollectRangeOnLeafRecursive(merge_node_p->right_merge_p,
+                                      sss,
+                                      delta_set,
+                                      delete_range_set,
+                                      start_key_p,
+                                      high_key_p,
+                                      list_limit,
+                                      item_list_p,
+                                      version);
+
+          return;
+        } // case LeafMergeType
+        default: {
+          bwt_printf("ERROR: Unknown node type: %d\n",
+                     static_cast<int>(type));
+
+          assert(false);
+        } // default
+      } // switch
+    } // while(1)
+
+    return;
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Control Core
+  ///////////////////////////////////////////////////////////////////
+
+  /*
+   * GetLatestNodeSnapshot() - Return a pointer to the most recent snapshot
+   *
+   * This is wrapper that includes size checking
+   *
+   * NOTE: The snapshot object is not valid after it is popped out of
+   * the vector, since at that time the snapshot object will be destroyed
+   * which also freed up the logical node object
+   */
+  static inline NodeSnapshot *GetLatestNodeSnapshot(Context *context_p) {
+    assert(context_p->current_level >= 0);
+
+    return &context_p->current_snapshot;
+  }
+
+  /*
+   * GetLatestParentNodeSnapshot() - Return the pointer to the parent node of
+   *                                 the current node
+   *
+   * This function assumes the current node is always the one on the top of
+   * the stack.
+   *
+   * NOTE: The same as GetLatestNodeSnapshot(), be careful when popping
+   * snapshots out of the stack
+   */
+  inline NodeSnapshot *GetLatestParentNodeSnapshot(Context *context_p) {
+    // Make sure the current node has a parent
+    assert(context_p->current_level >= 1);
+
+    // This is the address of the parent node
+    return &context_p->parent_snapshot;
+  }
+
+  /*
+   * IsOnLeftMostChild() - Returns true if latest node snapshot represents
+   *                       the leftmost child in its parent
+   *
+   * This is done by checking whether the NodeID of the current node is
+   * the same as the NodeID associated with the low key of its parent node
+   *
+   * NOTE: This function could only be called on a non-root node
+   * since root node does not have any parent node
+   */
+  inline bool IsOnLeftMostChild(Context *context_p) {
+    assert(context_p->current_level >= 1);
+
+    return GetLatestParentNodeSnapshot(context_p)->node_p->GetLowKeyNodeID() == \
+           GetLatestNodeSnapshot(context_p)->node_id;
+  }
+
+  /*
+   * IsMergeExempt() - Returns true if the node is the rightmost node of its
+   *                   level and the right edge split policy is uneven
+   *
+   * Such nodes are left small by right edge splits on purpose, so they are
+   * not merged into their left sibling while they grow
+   */
+  inline bool IsMergeExempt(const BaseNode *node_p) const {
+    return right_edge_split_percent > 50 && \
+           node_p->GetNextNodeID() == INVALID_NODE_ID;
+  }
+
+  /*
+   * GetSplitIndex() - Returns the index at which a full node is split
+   *
+   * The index is the percentage given by the split policy of the node size,
+   * clamped such that the left node is above the merge threshold and below
+   * the split threshold, and such that the right node is above the merge
+   * threshold unless it is merge exempt, in which case it only has to be
+   * non-empty. If no index meets all conditions then the node is split in
+   * the middle
+   */
+  int GetSplitIndex(const BaseNode *node_p,
+                    int node_size,
+                    int upper_threshold,
+                    int lower_threshold) const {
+    int percent = split_percent;
+    int right_threshold = lower_threshold;
+
+    if(node_p->GetNextNodeID() == INVALID_NODE_ID) {
+      percent = right_edge_split_percent;
+
+      if(IsMergeExempt(node_p) == true) {
+        right_threshold = 0;
+      }
+    }
+
+    int min_index = lower_threshold + 1;
+    int max_index = std::min(node_size - right_threshold - 1,
+                             upper_threshold - 1);
+
+    if(min_index > max_index) {
+      return node_size / 2;
+    }
+
+    int split_index = static_cast<int>( \
+      static_cast<long>(node_size) * percent / 100L);
+
+    if(split_index < min_index) {
+      split_index = min_index;
+    } else if(split_index > max_index) {
+      split_index = max_index;
+    }
+
+    return split_index;
+  }
+
+  /*
+   * JumpToLeftSibling() - Jump to the left sibling given a node
+   *
+   * When this function is called, we assume path_list_p includes the
+   * NodeSnapshot object for the current node being inspected, since
+   * we want to pass the information of whether the current node is
+   * the left most child.
+   *
+   * This function uses the fact that the mapping relationship between NodeID
+   * and low key does not change during the lifetime of the NodeID. This way,
+   * after we have fixed a snapshot of the current node, even though the node
+   * could keep changing, using the information given in the snapshot
+   * we could know at least a starting point for us to traverse right until
+   * we see a node whose high key equals the low key we are searching for,
+   * or whose range covers the low key (in the latter case, we know the
+   * merge delta has already been posted)
+   *
+   * NOTE: This function might abort. Please check context and make proper
+   * decisions
+   */
+  void JumpToLeftSibling(Context *context_p) {
+    bwt_printf("Jumping to the left sibling\n");
+
+    assert(context_p->HasParentNode());
+
+    // Get last record which is the current node's context
+    // and we must make sure the current node is not left mode node
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+    // Check currently we are on a remove node
+    assert(snapshot_p->node_p->IsRemoveNode());
+
+    // This is not necessarily true. e.g. if the parent node was merged into
+    // its left sibling before we take the snapshot of its previou left child
+    // then this no longer holds
+    if(IsOnLeftMostChild(context_p)) {
+      bwt_printf("Observed a remove node on left most child.\n"
+                 "  Parent node must have been merged. ABORT\n");
+
+      context_p->abort_flag = true;
+
+      return;
+    }
+
+    // After here we know we are not on a left most child of the parent
+    // InnerNode, and thus the low key is a valid key
+
+    // We use this to test whether we have found the real
+    // left sibling whose next node id equals this one
+    const NodeID removed_node_id = snapshot_p->node_id;
+
+    // After this point snapshot_p could be overwritten
+
+    // Get its parent node
+    NodeSnapshot *parent_snapshot_p = GetLatestParentNodeSnapshot(context_p);
+    assert(parent_snapshot_p->IsLeaf() == false);
+    
+    // If the parent has changed then abort
+    // This is to avoid missing InnerInsertNode which is fatal in our case
+    // because we could not find the item that actually is on the parent node
+    //
+    // Or we might traverse right on the child (i.e. there was a split and
+    // the split was consolidated), which means also that we
+    // could not find a sep item on the parent node
+    if(parent_snapshot_p->node_p != GetNode(parent_snapshot_p->node_id)) {
+      bwt_printf("Inconsistent parent node snapshot and "
+                 "current parent node. ABORT\n");
+      
+      context_p->abort_flag = true;
+      
+      return;
+    }
+
+    NodeID left_sibling_id = FindLeftSibling(snapshot_p->node_p->GetLowKey(),
+                                             parent_snapshot_p);
+
+    // This might incur recursive update
+    // We need to pass in the low key of left sibling node
+    JumpToNodeID(left_sibling_id, context_p);
+
+    if(context_p->abort_flag == true) {
+      bwt_printf("JumpToLeftSibling()'s call to JumpToNodeID() ABORT\n")
+
+      return;
+    }
+
+    // Read the potentially redirected snapshot
+    // (but do not pop it - so we directly return)
+    snapshot_p = GetLatestNodeSnapshot(context_p);
+
+    // If the next node ID stored inside the "left sibling" does
+    // not equal the removed node, then we know we have got to the
+    // wrong left sibling, maybe because the parent node has changed
+    // or because its left sibling has splited
+    // In the latter case simply aborting seems to be a bad idea
+    // but if it is the second case then aborting is beneficial
+    if(removed_node_id != snapshot_p->node_p->GetNextNodeID()) {
+      bwt_printf("Left sibling's next node ID does not match removed NodeID."
+                 " ABORT\n");
+
+      context_p->abort_flag = true;
+
+      return;
+    }
+
+    return;
+  }
+
+  /*
+   * RecordNodeVisit() - Counts a node loaded by traversal and the length of
+   *                     its delta chain in thread statistics
+   */
+  inline void RecordNodeVisit(const BaseNode *node_p) {
+    AddStatistics(&ThreadStatistics::node_visit_count);
+    AddStatistics(&ThreadStatistics::delta_chain_length_sum,
+                  static_cast<uint64_t>(node_p->GetDepth()));
+
+    return;
+  }
+
+  /*
+   * TakeNodeSnapshot() - Take the snapshot of a node by pushing node information
+   *
+   * This function simply copies NodeID, and physical pointer into
+   * the snapshot object. Node that the snapshot object itself is directly
+   * constructed on the path list which is a vector. This avoids copying the
+   * NodeSnapshot object from the stack to vector
+   */
+  void TakeNodeSnapshot(NodeID node_id,
+                        Context *context_p) {
+    const BaseNode *node_p = (context_p->read_only_flag == true) ? \
+                             GetNode(node_id) : \
+                             GetExpandedNode(node_id);
+
+    bwt_printf("Is leaf node? - %d\n", node_p->IsOnLeafDeltaChain());
+
+    RecordNodeVisit(node_p);
+
+    #ifdef BWTREE_DEBUG
+    
+    // This is used to record how many levels we have traversed
+    context_p->current_level++;
+    
+    #endif
+
+    // Copy assignment
+    // NOTE: For root node, the parent node contains garbage
+    // but current node ID is INVALID_NODE_ID
+    // So after this line parent node ID is INVALID_NODE_ID
+    context_p->parent_snapshot = context_p->current_snapshot;
+
+    context_p->current_snapshot.node_p = node_p;
+    context_p->current_snapshot.node_id = node_id;
+
+    return;
+  }
+
+  /*
+   * UpdateNodeSnapshot() - Update an existing node snapshot
+   *
+   * This function does not create and push new NodeSnapshot object into the
+   * stack; instead it modifies existing NodeSnapshot object on top of the
+   * path stack, using the given NodeID and low key
+   *
+   * NOTE: The left most child flag will be ignored because in current
+   * design when this is called we always go within the same parent node
+   *
+   * NOTE 2: If right traversal cross parent node boundary then NOTE 1
+   * is no longer true
+   *
+   * NOTE 3: Since we always traverse on the same level, the leaf/inner identity
+   * does not change
+   *
+   * NOTE 4: We need to clear all cached data and metadata inside the logical
+   * node since it is not changed to another NodeID
+   *
+   * NOTE 5: IF NODE ID DOES NOT CHANGE, DO NOT CALL THIS FUNCTION
+   * SINCE THIS FUNCTION RESETS ROOT IDENTITY
+   * Call SwitchPhysicalPointer() instead
+   */
+  void UpdateNodeSnapshot(NodeID node_id,
+                          Context *context_p) {
+    const BaseNode *node_p = (context_p->read_only_flag == true) ? \
+                             GetNode(node_id) : \
+                             GetExpandedNode(node_id);
+
+    // We operate on the latest snapshot instead of creating a new one
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+    // Assume we always use this function to traverse on the same
+    // level
+    assert(node_p->IsOnLeafDeltaChain() == snapshot_p->IsLeaf());
+
+    // Make sure we are not switching to itself
+    assert(snapshot_p->node_id != node_id);
+
+    snapshot_p->node_id = node_id;
+    snapshot_p->node_p = node_p;
+
+    return;
+  }
+
+  /*
+   * LoadNodeID() - Push a new snapshot for the node pointed to by node_id
+   *
+   * If we just want to modify existing snapshot object in the stack, we should
+   * call JumpToNodeID() instead
+   *
+   * Note that there is currently no flag indicating whether the current node
+   * being load is a leaf node or leftmost node or a root node. To check for
+   * attributes mentioned above:
+   *
+   * (1) Call IsOnLeafDeltaChain() to determine whether we are on leaf node
+   *     This call is lightweight and only requires an integer comparison
+   *
+   * (2) Check current node id with parent node's low key node id. If they
+   *     match then we are on a left most child of the parent node
+   *     (but that is only a strong hint; if the parent node is merged after
+   *     being taken a snapshot then we will get a false positive, though it
+   *     does not affect correctness)
+   *
+   * (3) Check current_level == 0 to determine whether we are on a root node
+   */
+  void LoadNodeID(NodeID node_id, Context *context_p) {
+    bwt_printf("Loading NodeID = %lu\n", node_id);
+
+    // This pushes a new snapshot into stack
+    TakeNodeSnapshot(node_id, context_p);
+
+    // Only read-only traversals keep a leaf compressed. It has no delta
+    // records, and is consolidated, split or merged only after a modifying
+    // traversal has expanded it
+    if(IsCompressedSnapshot(context_p) == true) {
+      return;
+    }
+
+    // If there are SMO (split; merge) that require much computation to
+    // deal with (e.g. go to its parent and comsolidate parent first) then
+    // we should aggressively comsolidate the SMO away to avoid further
+    // access
+    FinishPartialSMO(context_p);
+
+    if(context_p->abort_flag == true) {
+      return;
+    }
+
+    // This does not abort
+    TryConsolidateNode(context_p);
+
+    AdjustNodeSize(context_p);
+
+    // Do not have to check for abort here because anyway we will return
+
+    return;
+  }
+
+  /*
+   * IsCompressedSnapshot() - Whether the top of the path list is a
+   *                          compressed leaf node
+   */
+  inline bool IsCompressedSnapshot(Context *context_p) {
+    return GetLatestNodeSnapshot(context_p)->node_p->GetType() == \
+           NodeType::LeafCompressedType;
+  }
+
+  /*
+   * JumpToNodeID() - Given a NodeID, change the top of the path list
+   *                  by loading the delta chain of the node ID
+   *
+   * NOTE: This function could also be called to traverse right, in which case
+   * we need to check whether the target node is the left most child
+   */
+  void JumpToNodeID(NodeID node_id, Context *context_p) {
+    bwt_printf("Jumping to node ID = %lu\n", node_id);
+
+    // This updates the current snapshot in the stack
+    UpdateNodeSnapshot(node_id, context_p);
+
+    // Same as LoadNodeID()
+    if(IsCompressedSnapshot(context_p) == true) {
+      return;
+    }
+
+    FinishPartialSMO(context_p);
+
+    if(context_p->abort_flag == true) {
+      return;
+    }
+
+    // This does not abort
+    TryConsolidateNode(context_p);
+
+    AdjustNodeSize(context_p);
+
+    // Do not have to check for abort here because anyway we will return
+
+    return;
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Read-Optimized functions
+  ///////////////////////////////////////////////////////////////////
+
+  /*
+   * FinishPartialSMOReadOptimized() - Read optimized version of
+   *                                   FinishPartialSMO()
+   *
+   * This function only delas with remove delta and abort node
+   */
+  inline void FinishPartialSMOReadOptimized(Context *context_p) {
+    // Note: If the top of the path list changes then this pointer
+    // must also be updated
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+before_switch:
+    switch(snapshot_p->node_p->GetType()) {
+      case NodeType::InnerAbortType: {
+        bwt_printf("Observed Inner Abort Node; Continue\n");
+
+        snapshot_p->node_p = \
+          (static_cast<const DeltaNode *>(snapshot_p->node_p))->child_node_p;
+
+        goto before_switch;
+      }
+      case NodeType::LeafRemoveType:
+      case NodeType::InnerRemoveType: {
+        bwt_printf("Observed remove node; abort\n");
+        
+        // Since remove node is just a temporary measure, and if
+        // a thread proceeds to do its own job it must finish the remove
+        // SMO, posting InnerDeleteNode on the parent
+        context_p->abort_flag = true;
+        
+        return;
+      } // case Inner/LeafRemoveType
+      default: {
+        return;
+      }
+    } // switch
+
+    assert(false);
+    return;
+  }
+  
+  /*
+   * TakeNodeSnapshotReadOptimized() - Take node snapshot without saving
+   *                                   parent node
+   *
+   * This implies that if there is remove delta on the path then
+   * the read thread will have to spin and wait. But finally it will
+   * complete the job since remove delta will not be present if the thread
+   * posting the remove delta finally proceeds to finish its job
+   */
+  inline void TakeNodeSnapshotReadOptimized(NodeID node_id,
+                                            Context *context_p) {
+    const BaseNode *node_p = GetNode(node_id);
+
+    bwt_printf("Is leaf node (RO)? - %d\n", node_p->IsOnLeafDeltaChain());
+
+    RecordNodeVisit(node_p);
+
+    #ifdef BWTREE_DEBUG
+
+    // This is used to record how many levels we have traversed
+    context_p->current_level++;
+
+    #endif
+
+    context_p->current_snapshot.node_p = node_p;
+    
+    // DO NOT REMOVE THIS!
+    // REMOVING THIS WOULD CAUSE ASSERTION FAILURE WHEN JUMPING
+    // TO RIGHT SIBLING SINCEI IT CHECKS NODE ID
+    context_p->current_snapshot.node_id = node_id;
+
+    // Lines after the header are fetched in parallel with the header
+    if(prefetch_flag == true) {
+      PrefetchNodeBody(node_p);
+    }
+
+    return;
+  }
+
+  /*
+   * PrefetchNodeBody() - Issues prefetches for the first few cache lines
+   *                      of a node
+   *
+   * For base nodes these hold the node header and the beginning of the
+   * array, and for delta nodes the record and probably the next record
+   * allocated before it in the same chunk
+   */
+  inline void PrefetchNodeBody(const BaseNode *node_p) const {
+    for(size_t i = 0;i < NODE_PREFETCH_LINE_NUM;i++) {
+      __builtin_prefetch(reinterpret_cast<const char *>(node_p) + \
+                         i * CACHE_LINE_SIZE);
+    }
+
+    return;
+  }
+
+  /*
+   * PrefetchNodeID() - Issues prefetches for a node given its NodeID
+   *
+   * The mapping table slot must have been in the cache (e.g. prefetched
+   * earlier by PrefetchMappingTable()), otherwise loading it stalls
+   */
+  inline void PrefetchNodeID(NodeID node_id) {
+    PrefetchNodeBody(mapping_table[node_id].load(std::memory_order_relaxed));
+
+    return;
+  }
+
+  /*
+   * LoadNodeIDReadOptimized() - Read optimized version of LoadNodeID()
+   *
+   * This only SMO that a read only thread cares about is remove delta,
+   * since it has to jump to the left sibling in order to keep traversing
+   * down. However, jumping to left sibling has the possibility to fail
+   * so we still need to check abort flag after this function returns
+   */
+  inline void LoadNodeIDReadOptimized(NodeID node_id, Context *context_p) {
+    bwt_printf("Loading NodeID (RO) = %lu\n", node_id);
+
+    // Jumping to a sibling goes through JumpToNodeID(), which must not
+    // expand a compressed leaf either
+    context_p->read_only_flag = true;
+
+    // This pushes a new snapshot into stack
+    TakeNodeSnapshotReadOptimized(node_id, context_p);
+
+    FinishPartialSMOReadOptimized(context_p);
+
+    // Do not need to check for abort flag here
+
+    return;
+  }
+
+  /*
+   * TraverseBI() - Read optimized traversal for backward iteration
+   *
+   * This function calls NavigateInnerNodeBI() to find the node with a smaller
+   * key than search key
+   */
+  void TraverseBI(Context *context_p) {
+    AddStatistics(&ThreadStatistics::traversal_count);
+
+retry_traverse:
+    assert(context_p->abort_flag == false);
+    assert(context_p->current_level == -1);
+
+    NodeID start_node_id = GetRootNodeID(context_p);
+    context_p->current_snapshot.node_id = INVALID_NODE_ID;
+    LoadNodeID(start_node_id, context_p);
+    if(context_p->abort_flag == true) {
+      goto abort_traverse;
+    }
+
+    bwt_printf("Successfully loading root node ID for BI\n");
+
+    while(1) {
+      NodeID child_node_id = NavigateInnerNodeBI(context_p);
+      if(context_p->abort_flag == true) {
+        bwt_printf("Navigate Inner Node abort (BI). ABORT\n");
+        assert(child_node_id == INVALID_NODE_ID);
+        goto abort_traverse;
+      }
+
+      LoadNodeID(child_node_id, context_p);
+      if(context_p->abort_flag == true) {
+        bwt_printf("LoadNodeID aborted (BI). ABORT\n");
+        goto abort_traverse;
+      }
+
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+      if(snapshot_p->IsLeaf() == true) {
+        bwt_printf("The next node is a leaf (BI)\n");
+
+        // After reaching leaf level just traverse the sibling chain
+        // and stop before the search key
+        NavigateSiblingChainBI(context_p);
+        if(context_p->abort_flag == true) {
+          bwt_printf("NavigateSiblingChainBI() inside TraverseBI() aborts\n");
+
+          goto abort_traverse;
+        }
+    
+        return;
+      }
+    } //while(1)
+
+abort_traverse:
+    AddStatistics(&ThreadStatistics::traversal_abort_count);
+
+    #ifdef BWTREE_DEBUG
+    assert(context_p->current_level >= 0);
+    context_p->current_level = -1;
+    context_p->abort_counter++;
+    #endif
+    
+    // This is used to identify root node
+    context_p->current_snapshot.node_id = INVALID_NODE_ID;
+    context_p->abort_flag = false;
+    goto retry_traverse;
+
+    assert(false);
+    return;
+  }
+  
+  /*
+   * TraverseReadOptimized() - Collects values of the search key into a list
+   */
+  void TraverseReadOptimized(Context *context_p,
+                             std::vector<ValueType> *value_list_p) {
+    TraverseReadOptimized(context_p,
+                          [value_list_p](const ValueType &value) {
+                            value_list_p->push_back(value);
+                          });
+
+    return;
+  }
+
+  /*
+   * TraverseReadCached() - Read-only traversal that looks up the read cache
+   *                        first if it is enabled
+   *
+   * On a miss the visitor is called by TraverseReadOptimized(), and the
+   * value is filled into the cache if the key has only one value
+   */
+  template <typename ValueVisitor>
+  void TraverseReadCached(Context *context_p,
+                          ValueVisitor &&visitor) {
+    if(read_cache_p == nullptr) {
+      TraverseReadOptimized(context_p, visitor);
+
+      return;
+    }
+
+    ValueType value{};
+    uint64_t generation;
+
+    if(read_cache_p->Lookup(context_p->search_key,
+                            &value,
+                            &generation) == true) {
+      AddStatistics(&ThreadStatistics::read_cache_hit_count);
+
+      visitor(value);
+
+      return;
+    }
+
+    AddStatistics(&ThreadStatistics::read_cache_miss_count);
+
+    size_t value_count = 0UL;
+
+    TraverseReadOptimized(context_p,
+                          [&visitor,
+                           &value,
+                           &value_count](const ValueType &p_value) {
+                            value = p_value;
+                            value_count++;
+
+                            visitor(p_value);
+                          });
+
+    if(value_count == 1UL) {
+      read_cache_p->Fill(context_p->search_key, value, generation);
+    }
+
+    return;
+  }
+
+  /*
+   * InvalidateReadCache() - Invalidates the cached value of a key after it
+   *                         is modified
+   */
+  inline void InvalidateReadCache(const KeyType &key) {
+    if(read_cache_p != nullptr) {
+      read_cache_p->Invalidate(key);
+    }
+
+    return;
+  }
+
+  /*
+   * TraverseReadOptimized() - Read-only traversal that calls the visitor on
+   *                           each value of the search key on the leaf
+   *
+   * Node snapshots are not recorded since nothing is modified, and the
+   * visitor is called by NavigateLeafNodeVisit() once the correct leaf
+   * is found
+   */
+  template <typename ValueVisitor>
+  void TraverseReadOptimized(Context *context_p,
+                             ValueVisitor &&visitor) {
+    AddStatistics(&ThreadStatistics::traversal_count);
+
+retry_traverse:
+    assert(context_p->abort_flag == false);
+    assert(context_p->current_level == -1);
+
+    // This is the serialization point for reading/writing root node
+    NodeID child_node_id = root_id.load();
+    
+    LoadNodeIDReadOptimized(child_node_id, context_p);
+
+    if(context_p->abort_flag == true) {
+      bwt_printf("LoadNodeID aborted on loading root (RO)\n");
+
+      goto abort_traverse;
+    }
+    
+    bwt_printf("Successfully loading root node ID (RO)\n");
+
+    while(1) {
+      child_node_id = NavigateInnerNode(context_p);
+
+      // Navigate could abort since it might go to another NodeID
+      // if there is a split delta and the key is >= split key
+      if(context_p->abort_flag == true) {
+        bwt_printf("Navigate Inner Node abort (RO)\n");
+
+        // If NavigateInnerNode() aborts then it retrns INVALID_NODE_ID
+        // as a double check
+        // This is the only situation that this function returns
+        // INVALID_NODE_ID
+        assert(child_node_id == INVALID_NODE_ID);
+
+        goto abort_traverse;
+      }
+      
+      // This might load a leaf child
+      // Also LoadNodeID() does not guarantee the node bound matches
+      // search key. Since we could readjust using the split side link
+      // during Navigate...Node(), or abort if we reach the bottom
+      // while still observing an inconsistent high key
+      // (low key is always consistent)
+      LoadNodeIDReadOptimized(child_node_id, context_p);
+
+      if(context_p->abort_flag == true) {
+        bwt_printf("LoadNodeID aborted (RO). ABORT\n");
+
+        goto abort_traverse;
+      }
+
+      // This is the node we have just loaded
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+      if(snapshot_p->IsLeaf() == true) {
+        bwt_printf("The next node is a leaf (RO)\n");
+
+        NavigateLeafNodeVisit(context_p, visitor);
+
+        if(context_p->abort_flag == true) {
+          bwt_printf("NavigateLeafNode aborts (RO). ABORT\n");
+
+          goto abort_traverse;
+        }
+
+        SampleLeafRead(context_p);
+
+        #ifdef BWTREE_DEBUG
+        
+        bwt_printf("Found leaf node (RO). Abort count = %d, level = %d\n",
+                   context_p->abort_counter,
+                   context_p->current_level);
+
+        #endif
+
+        // If there is no abort then we could safely return
+        return;
+      }
+      
+      // This does not work
+      //_mm_prefetch(&context_p->current_snapshot.node_p->GetLowKeyPair(), _MM_HINT_T0);
+    } // while(1)
+
+abort_traverse:
+    AddStatistics(&ThreadStatistics::traversal_abort_count);
+
+    #ifdef BWTREE_DEBUG
+    
+    assert(context_p->current_level >= 0);
+
+    context_p->current_level = -1;
+    
+    context_p->abort_counter++;
+    
+    #endif
+    
+    context_p->current_snapshot.node_id = INVALID_NODE_ID;
+
+    context_p->abort_flag = false;
+
+    goto retry_traverse;
+
+    assert(false);
+    return;
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  ///////////////////////////////////////////////////////////////////
+  ///////////////////////////////////////////////////////////////////
+
+  /*
+   * PostInnerInsertNode() - Posts an InnerInsertNode on the parent node
+   *
+   * This is used to finish the partial node split SMO as part of the help
+   * along protocol
+   *
+   * NOTE: This function may abort
+   */
+  inline bool PostInnerInsertNode(Context *context_p,
+                                  const KeyNodeIDPair &insert_item,
+                                  const KeyNodeIDPair &next_item,
+                                  const KeyNodeIDPair *location) {
+    // We post on the parent node, after which we check for size and decide whether
+    // to consolidate and/or split the node
+    NodeSnapshot *parent_snapshot_p = GetLatestParentNodeSnapshot(context_p);
+
+    // Three arguments are: inserted key-node id pair
+    //                      next key-node id pair
+    //                      child node in delta chain
+    const InnerInsertNode *insert_node_p = \
+      InnerInlineAllocateOfType(InnerInsertNode,
+                                parent_snapshot_p->node_p,
+                                insert_item,
+                                next_item,
+                                parent_snapshot_p->node_p,
+                                location);
+
+    // CAS Index Term Insert Delta onto the parent node
+    bool ret = InstallNodeToReplace(parent_snapshot_p->node_id,
+                                    insert_node_p,
+                                    parent_snapshot_p->node_p);
+
+    if(ret == true) {
+      bwt_printf("Index term insert (from %lu to %lu) delta CAS succeeds\n",
+                 GetLatestNodeSnapshot(context_p)->node_id,
+                 insert_item.second);
+
+      // Update parent node pointer to reflect the fact that it has been
+      // updated
+      parent_snapshot_p->node_p = insert_node_p;
+
+      ConsolidateNodeInContext(context_p);
+
+      return true;
+    } else {
+      bwt_printf("Index term insert (from %lu to %lu) delta CAS failed. "
+                 "ABORT\n",
+                 GetLatestNodeSnapshot(context_p)->node_id,
+                 insert_item.second);
+
+      // Set abort, and remove the newly created node
+      context_p->abort_flag = true;
+      
+      // Call destructor but do not free memory
+      insert_node_p->~InnerInsertNode();
+
+      return false;
+    } // if CAS succeeds/fails
+
+    assert(false);
+    return false;
+  }
+
+  /*
+   * PostInnerDeleteNode() - Posts an InnerDeleteNode on the current parent node
+   *
+   * This function is called to complete node merges as part of the SMO help-along
+   * protocol. It posts an InnerDeleteNode on the parent node and returns the result
+   * of CAS instruction
+   *
+   * NOTE: This function may abort
+   */
+  inline bool PostInnerDeleteNode(Context *context_p,
+                                  const KeyNodeIDPair &delete_item,
+                                  const KeyNodeIDPair &prev_item,
+                                  const KeyNodeIDPair &next_item,
+                                  const KeyNodeIDPair *location) {
+    NodeSnapshot *parent_snapshot_p = GetLatestParentNodeSnapshot(context_p);
+
+    // Arguments are:
+    // Deleted item; Prev item; next item (NodeID not used for next item)
+    // and delta chail child node
+    const InnerDeleteNode *delete_node_p = \
+      InnerInlineAllocateOfType(InnerDeleteNode,
+                                parent_snapshot_p->node_p,
+                                delete_item,
+                                prev_item,
+                                next_item,
+                                parent_snapshot_p->node_p,
+                                location);
+
+    // Assume parent has not changed, and CAS the index term delete delta
+    // If CAS failed then parent has changed, and we have no idea how it
+    // could be modified. The safest way is just abort
+    bool ret = InstallNodeToReplace(parent_snapshot_p->node_id,
+                                    delete_node_p,
+                                    parent_snapshot_p->node_p);
+
+    // If we installed the IndexTermDeleteDelta successfully the next
+    // step is to put the remove node into garbage chain
+    // and also recycle the deleted NodeID since now no new thread
+    // could access that NodeID until it is reused
+    if(ret == true) {
+      bwt_printf("Index term delete delta installed, ID = %lu; ABORT\n",
+                 parent_snapshot_p->node_id);
+
+      // The deleted node ID must resolve to a RemoveNode of either
+      // Inner or Leaf category
+      const BaseNode *garbage_node_p = GetNode(delete_item.second);
+      assert(garbage_node_p->IsRemoveNode());
+
+      // Put the remove node into garbage chain
+      // This will not remove the child node of the remove node, which
+      // should be removed together with the merge node above it
+      // Also, the remove node acts as a container for removed NodeID
+      // which will be recycled when the remove node is recycled
+      epoch_manager.AddGarbageNode(garbage_node_p);
+
+      // To avoid this entry being recycled during tree destruction
+      // Since the entry still remains in the old inner base node
+      // but we should have already deleted it
+      // NOTE: We could not do it here since some thread will fetch
+      // nullptr from the mapping table
+      // We should recycle the NodeID using EpochManager
+      // and requires that epoch manager finishes all epoches before
+      // the tree is destroyed
+      //mapping_table[deleted_node_id] = nullptr;
+
+      parent_snapshot_p->node_p = delete_node_p;
+
+      ConsolidateNodeInContext(context_p);
+
+      return true;
+    } else {
+      bwt_printf("Index term delete delta install failed. ABORT\n");
+
+      // DO NOT FORGET TO DELETE THIS
+      delete_node_p->~InnerDeleteNode();
+
+      // The caller just returns after this function, so do not have
+      // to branch on abort_flag after this function returns
+      context_p->abort_flag = true;
+
+      return false;
+    }
+
+    assert(false);
+    return false;
+  }
+
+  /*
+   * FinishPartialSMO() - Finish partial completed SMO if there is one
+   *
+   * This function defines the help-along protocol, i.e. if we find
+   * a SMO on top of the delta chain, we should help-along that SMO before
+   * doing our own job. This might incur a recursive call of this function.
+   *
+   * If this function returns true, then a node consolidation on the current
+   * top snapshot is recommended, because we have seen and processed (or
+   * confirmed that it has been processed) a merge/split delta on current
+   * top snapshot. To prevent other threads from seeing them and taking
+   * a full snapshot of the parent snapshot everytime they are seen, we
+   * return true to inform caller to do a consolidation
+   *
+   * If we see a remove node, then the actual NodeID pushed into the path
+   * list stack may not equal the NodeID passed in this function. So when
+   * we need to read NodeID, always use the one stored in the NodeSnapshot
+   * vector instead of using a previously passed one
+   */
+  void FinishPartialSMO(Context *context_p) {
+    // Note: If the top of the path list changes then this pointer
+    // must also be updated
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+before_switch:
+    switch(snapshot_p->node_p->GetType()) {
+      case NodeType::InnerAbortType: {
+        bwt_printf("Observed Inner Abort Node; ABORT\n");
+
+        // This is an optimization - when seeing an ABORT
+        // node, we continue but set the physical pointer to be ABORT's
+        // child, to make CAS always fail on this node to avoid
+        // posting on ABORT, especially posting split node
+        snapshot_p->node_p = \
+          (static_cast<const DeltaNode *>(snapshot_p->node_p))->child_node_p;
+
+        goto before_switch;
+      }
+      case NodeType::LeafRemoveType:
+      case NodeType::InnerRemoveType: {
+        bwt_printf("Helping along remove node...\n");
+
+        // The right branch for merging is the child node under remove node
+        const BaseNode *merge_right_branch = \
+          (static_cast<const DeltaNode *>(snapshot_p->node_p))->child_node_p;
+
+        // This will also be recorded in merge delta such that when
+        // we finish merge delta we could recycle the node id as well
+        // as the RemoveNode
+        NodeID deleted_node_id = snapshot_p->node_id;
+
+        JumpToLeftSibling(context_p);
+
+        // If this aborts then we propagate this to the state machine driver
+        if(context_p->abort_flag == true) {
+          bwt_printf("Jump to left sibling in Remove help along ABORT\n");
+
+          // Here we are uncertain about the current status (it might have
+          // jumped and observed an inconsistent next node ID, or it has not
+          // jumped because of an inconsistent left child status)
+          return;
+        }
+
+        // That is the left sibling's snapshot
+        NodeSnapshot *left_snapshot_p = GetLatestNodeSnapshot(context_p);
+
+        // A read-only traversal keeps the left sibling compressed, but the
+        // merge delta could only be posted on a LeafNode. Expand it and
+        // retry, since the snapshot could not be used for the CAS anymore
+        if(left_snapshot_p->node_p->GetType() == \
+           NodeType::LeafCompressedType) {
+          ExpandLeafNode(left_snapshot_p->node_id, left_snapshot_p->node_p);
+
+          context_p->abort_flag = true;
+
+          return;
+        }
+
+        // Update snapshot pointer if we fall through to posting
+        // index term delete delta for merge node
+        snapshot_p = left_snapshot_p;
+
+        // This serves as the merge key
+        // Note that the left sibling node must have a valid high key
+        const KeyType &merge_key = snapshot_p->node_p->GetHighKey();
+
+        // This holds the merge node if installation is successful
+        // Not changed (i.e.undefined) if CAS fails
+        const BaseNode *merge_node_p = nullptr;
+
+        bool ret;
+
+        // If we are currently on leaf, just post leaf merge delta
+        if(left_snapshot_p->IsLeaf() == true) {
+          ret = \
+            PostLeafMergeNode(left_snapshot_p,
+                              &merge_key,
+                              merge_right_branch,
+                              deleted_node_id,
+                              &merge_node_p);
+        } else {
+          ret = \
+            PostInnerMergeNode(left_snapshot_p,
+                               &merge_key,
+                               merge_right_branch,
+                               deleted_node_id,
+                               &merge_node_p);
+        }
+
+        // If CAS fails just abort and return
+        if(ret == true) {
+          bwt_printf("Merge delta CAS succeeds. "
+                     "Continue to finish merge SMO\n");
+
+          left_snapshot_p->node_p = merge_node_p;
+
+          // merge_node_p is set as the newest merge node above
+          // after this point
+          // Also snapshot_p has been to left_snapshot_p above
+        } else {
+          bwt_printf("Merge delta CAS fails. ABORT\n");
+
+          context_p->abort_flag = true;
+
+          return;
+        } // if ret == true
+
+        //
+        // FALL THROUGH IF POSTING MERGE DELTA SUCCEEDS
+        //
+
+      } // case Inner/LeafRemoveType
+      case NodeType::InnerMergeType:
+      case NodeType::LeafMergeType: {
+        bwt_printf("Helping along merge delta\n");
+
+        // A remove node is counted here after its merge delta is posted
+        AddStatistics(&ThreadStatistics::smo_help_count);
+
+        // First consolidate parent node and find the left/right
+        // sep pair plus left node ID
+        NodeSnapshot *parent_snapshot_p = \
+          GetLatestParentNodeSnapshot(context_p);
+
+        // This is necessary - make sure the parent node snapshot
+        // is always update to date such that we do not miss a
+        // late InnerInsertNode that actually posts the deleted item
+        // o.w. the thread will just continue and post on top of
+        // an unfinished merge delta
+        if(parent_snapshot_p->node_p != GetNode(parent_snapshot_p->node_id)) {
+          context_p->abort_flag = true;
+          
+          return;
+        }
+
+        // This is the item being deleted inside parent node
+        const KeyNodeIDPair *delete_item_p = nullptr;
+        const BaseNode *right_merge_p = nullptr;
+
+        // Type of the merge delta
+        // This is important since we might fall through
+        // from the LeafRemoveNode/InnerRemoveNode branch
+        NodeType type = snapshot_p->node_p->GetType();
+        
+        if(type == NodeType::InnerMergeType) {
+          const InnerMergeNode *merge_node_p = \
+            static_cast<const InnerMergeNode *>(snapshot_p->node_p);
+
+          delete_item_p = &merge_node_p->delete_item;
+          right_merge_p = merge_node_p->right_merge_p;
+        } else if(type == NodeType::LeafMergeType) {
+          const LeafMergeNode *merge_node_p = \
+            static_cast<const LeafMergeNode *>(snapshot_p->node_p);
+
+          delete_item_p = &merge_node_p->delete_item;
+          right_merge_p = merge_node_p->right_merge_p;
+        } else {
+          bwt_printf("ERROR: Illegal node type: %d\n",
+                     static_cast<int>(type));
+
+          assert(false);
+        } // If on type of merge node
+
+        const KeyNodeIDPair *location;
+
+        // Find the deleted item
+        const KeyNodeIDPair *found_pair_p = \
+          NavigateInnerNode(parent_snapshot_p, 
+                            delete_item_p->first, 
+                            &location);
+          
+        // If the item is found then next we post InnerDeleteNode
+        if(found_pair_p != nullptr) {
+          assert(found_pair_p->second == delete_item_p->second);
+        } else {
+          return;
+        }
+
+        // It will post an InnerDeleteNode on the parent node
+        // and the return value is the result of CAS
+        // Note: Even if this function aborts, since we return immediately
+        // so do not have to test abort_flag here
+        //
+        // There is a trick: The prev key is the low key of the node
+        // being merged into
+        // and the next key is the high key of the node being merged from
+        PostInnerDeleteNode(context_p,
+                            *delete_item_p,
+                            // Note that for leaf node the low key is not complete
+                            std::make_pair(snapshot_p->node_p->GetLowKey(), snapshot_p->node_id),
+                            // Also note that high key pair is valid for both leaf and inner
+                            right_merge_p->GetHighKeyPair(),
+                            // This is location on InnerNode
+                            location);
+
+        return;
+      } // case Inner/LeafMergeNode
+      case NodeType::InnerSplitType:
+      case NodeType::LeafSplitType: {
+        bwt_printf("Helping along split node\n");
+
+        AddStatistics(&ThreadStatistics::smo_help_count);
+
+        // These two will be stored inside InnerInsertNode
+        // The insert item is just the split item inside InnerSplitNode
+        // but next item needs to be read from the parent node
+        const KeyNodeIDPair *insert_item_p;
+
+        // This is set to use the high key pair of the node under
+        // split delta
+        const KeyNodeIDPair *next_item_p;
+
+        NodeType type = snapshot_p->node_p->GetType();
+
+        // NOTE: depth should not be read here, since we
+        // need to know the depth on its parent node
+        if(type == NodeType::InnerSplitType) {
+          const InnerSplitNode *split_node_p = \
+            static_cast<const InnerSplitNode *>(snapshot_p->node_p);
+
+          insert_item_p = &split_node_p->insert_item;
+          next_item_p = &split_node_p->child_node_p->GetHighKeyPair();
+        } else {
+          const LeafSplitNode *split_node_p = \
+            static_cast<const LeafSplitNode *>(snapshot_p->node_p);
+
+          insert_item_p = &split_node_p->insert_item;
+          next_item_p = &split_node_p->child_node_p->GetHighKeyPair();
+        }
+
+        assert(context_p->current_level >= 0);
+
+        // The root of a tree dropped by Truncate() is not in root_id, so
+        // the CAS below would never succeed. The split is left unfinished,
+        // and traversals of that tree go right through the split delta
+        if(context_p->IsOnRootNode() == true && \
+           context_p->dropped_tree_flag == true) {
+          bwt_printf("Root of a dropped tree splits. Do not install\n");
+
+          return;
+        }
+
+        // If the parent snapshot has an invalid node ID then it must be the
+        // root node. 
+        if(context_p->IsOnRootNode() == true) {
+          /***********************************************************
+           * Root splits (don't have to consolidate parent node)
+           ***********************************************************/
+          bwt_printf("Root splits!\n");
+
+          // Allocate a new node ID for the newly created node
+          // If CAS fails we need to free the root ID
+          NodeID new_root_id = GetNextNodeID();
+
+          // InnerNode requires high key pair which is +Inf, INVALID NODE ID
+          // low key pair will be set inside the constructor to be pointing
+          // to the first element in the sep list
+          // NOTE: Storage will be automatically reserved inside the
+          // constructor
+          #ifdef BWTREE_PELOTON
+
+          // This is the first item of the newly created InnerNode
+          // and also the low key for the newly created InnerNode
+          const KeyNodeIDPair first_item = std::make_pair(KeyType(),
+                                                          snapshot_p->node_id);
+
+          // Allocate an InnerNode with KeyNodeIDPair embedded
+          InnerNode *inner_node_p = \
+            reinterpret_cast<InnerNode *>( \
+              ElasticNode<KeyNodeIDPair>::\
+                Get(2, 
+                    NodeType::InnerType, 
+                    0,
+                    2,
+                    first_item,
+                    std::make_pair(KeyType(), INVALID_NODE_ID)));
+
+          #else
+
+          // This is the first item of the newly created InnerNode
+          // and also the low key for the InnerNode
+          const KeyNodeIDPair first_item = std::make_pair(KeyType{},
+                                                          snapshot_p->node_id);
+
+          // Allocate an InnerNode with KeyNodeIDPair embedded
+          InnerNode *inner_node_p = \
+            reinterpret_cast<InnerNode *>( \
+              ElasticNode<KeyNodeIDPair>::\
+                Get(2, 
+                NodeType::InnerType, 
+                0,
+                2,
+                first_item,
+                std::make_pair(KeyType{}, INVALID_NODE_ID)));
+                               
+          #endif
+
+          // Add new element - one points to the current node (new second level
+          // left most inner node), another points to its split sibling
+          inner_node_p->PushBack(first_item);
+          inner_node_p->PushBack(*insert_item_p);
+
+          // First we need to install the new node with NodeID
+          // This makes it visible
+          InstallNewNode(new_root_id, inner_node_p);
+          bool ret = InstallRootNode(snapshot_p->node_id,
+                                     new_root_id);
+
+          if(ret == true) {
+            bwt_printf("Install root CAS succeeds\n");
+
+            // After installing new root we abort in order to load
+            // the new root
+            context_p->abort_flag = true;
+
+            return;
+          } else {
+            bwt_printf("Install root CAS failed. ABORT\n");
+
+            // We need to make a new remove node and send it into EpochManager
+            // for recycling the NodeID
+            // Note that the remove node must not be created on inner_node_p
+            // since inner_node_p might be destroyed before remove node is 
+            // destroyed since they are both put into the GC chain
+            const InnerRemoveNode *fake_remove_node_p = \
+              new InnerRemoveNode{new_root_id, 
+                                  inner_node_p};
+
+            // Put the remove node into garbage chain, because
+            // we cannot call InvalidateNodeID() here
+            epoch_manager.AddGarbageNode(fake_remove_node_p, false);
+            epoch_manager.AddGarbageNode(inner_node_p);
+
+            context_p->abort_flag = true;
+
+            return;
+          } // if CAS succeeds/fails
+        } else {
+          /***********************************************************
+           * Index term insert for non-root nodes
+           ***********************************************************/
+
+          // First consolidate parent node and find the right sep
+          NodeSnapshot *parent_snapshot_p = \
+            GetLatestParentNodeSnapshot(context_p);
+
+          // If the split key is out of range then just ignore
+          // we do not worry that through split sibling link
+          // we would traverse to the child of a different parent node
+          // than the current one, since we always guarantee that after
+          // NavigateInnerNode() returns if it does not abort, then we
+          // are on the correct node for the current key
+
+          // This happens when the parent splits on the newly inserted index term
+          // and the split delta has not been consolidated yet, so that a thread
+          // sees the split delta and traverses to its right sibling which is on
+          // another parent node (the right sibling of the current parent node)
+          // In this case we do not have to insert since we know the index term has
+          // already been inserted
+          if((parent_snapshot_p->node_p->GetNextNodeID() != INVALID_NODE_ID) &&
+             (KeyCmpGreaterEqual(insert_item_p->first,
+                                 parent_snapshot_p->node_p->GetHighKey()))) {
+            bwt_printf("Bounds check failed on parent node"
+                       " - item key >= high key\n");
+
+            return;
+          }
+          
+          // This is used to hold index information for InnerInsertNode
+          const KeyNodeIDPair *location;
+
+          // Find the split item that we intend to insert in the parent node
+          // This function returns a pointer to the item if found, or
+          // nullptr if not found
+          const KeyNodeIDPair *found_item_p = \
+            NavigateInnerNode(parent_snapshot_p, 
+                              insert_item_p->first, 
+                              &location);
+
+          // If the item has been found then we do not post
+          // InnerInsertNode onto the parent
+          if(found_item_p != nullptr) {
+            
+            // Check whether there is an item in the parent
+            // node that has the same key but different NodeID
+            // This is totally legal
+            if(found_item_p->second != insert_item_p->second) {
+              
+              #ifdef BWTREE_DEBUG
+              
+              // If this happens then it must be the case that the node with
+              // the same split key but different node ID was removed and then
+              // merged into the current node and then it is splited again
+              //
+              // We are now on the way of completing the second split SMO
+              // but since the parent has changed (we must have missed an
+              // InnerInsertNode) we need to abort and restart traversing
+              const BaseNode *node_p = GetNode(found_item_p->second);
+              
+              assert(node_p->GetType() == NodeType::InnerRemoveType ||
+                     node_p->GetType() == NodeType::LeafRemoveType);
+              
+              #endif
+              
+              context_p->abort_flag = true;
+            }
+            
+            return;
+          }
+
+          // Post InnerInsertNode on the parent node.
+          // Also if this returns true then we have successfully completed split SMO
+          // which means the SMO could be removed by a consolidation to avoid
+          // consolidating the parent node again and again
+          // Note: Even if this function aborts, since we return immediately
+          // so do not have to test abort_flag here
+          PostInnerInsertNode(context_p, 
+                              *insert_item_p, 
+                              *next_item_p, 
+                              location);
+
+          return;
+        } // if split root / else not split root
+      } // case split node
+      default: {
+        return;
+        // By default we do not do anything special
+        break;
+      }
+    } // switch
+
+    assert(false);
+    return;
+  }
+  
+  /*
+   * ConsolidateLeafNode() - Consolidates a leaf delta chian unconditionally
+   *
+   * This function does not check delta chain size
+   */
+  inline void ConsolidateLeafNode(NodeSnapshot *snapshot_p) {
+    assert(snapshot_p->node_p->IsOnLeafDeltaChain() == true);
+    
+    LeafNode *leaf_node_p = \
+      CollectAllValuesOnLeaf(snapshot_p, nullptr, leaf_fingerprint_flag);
+
+    leaf_node_p->SetPreviousVersion(snapshot_p->node_p, GetCurrentVersion());
+
+    bool ret = InstallNodeToReplace(snapshot_p->node_id,
+                                    leaf_node_p,
+                                    snapshot_p->node_p);
+
+    if(ret == true) {
+      RecordInstalledNode(leaf_node_p);
+
+      epoch_manager.AddGarbageNode(snapshot_p->node_p);
+
+      AddStatistics(&ThreadStatistics::consolidation_count);
+
+      snapshot_p->node_p = leaf_node_p;
+    } else {
+      epoch_manager.AddGarbageNode(leaf_node_p, false);
+    }
+    
+    return;
+  }
+  
+  /*
+   * ConsolidateInnerNode() - Consolidates inner node unconditionally
+   *
+   * This function does not check for inner delta chain length
+   */
+  inline void ConsolidateInnerNode(NodeSnapshot *snapshot_p) {
+    assert(snapshot_p->node_p->IsOnLeafDeltaChain() == false);
+    
+    InnerNode *inner_node_p = \
+      CollectAllSepsOnInner(snapshot_p, 0, inner_search_index_flag);
+
+    bool ret = InstallNodeToReplace(snapshot_p->node_id,
+                                    inner_node_p,
+                                    snapshot_p->node_p);
+
+    if(ret == true) {
+      RecordInstalledNode(inner_node_p);
+
+      epoch_manager.AddGarbageNode(snapshot_p->node_p);
+
+      AddStatistics(&ThreadStatistics::consolidation_count);
+
+      snapshot_p->node_p = inner_node_p;
+    } else {
+      epoch_manager.AddGarbageNode(inner_node_p, false);
+    }
+    
+    return;
+  }
+
+  /*
+   * ConsolidateNode() - Consolidates current node unconditionally
+   *
+   * This function is called after finishing split/merge SMO, since we
+   * want to prevent other threads from seeing the finished SMO and
+   * do an useless consolidation on the parent node
+   *
+   * NOTE: This function does not return any value reflecting the status
+   * of CAS operation, since consolidation is an optional operation, and it
+   * would not have any effect even if it fails
+   */
+  void ConsolidateNode(NodeSnapshot *snapshot_p) {
+    if(snapshot_p->node_p->IsOnLeafDeltaChain() == true) {
+      ConsolidateLeafNode(snapshot_p);
+    } else {
+      ConsolidateInnerNode(snapshot_p);
+    } // if on leaf/inner node
+
+    return;
+  }
+
+  /*
+   * ConsolidateNodeInContext() - Consolidates the current node of the
+   *                              context unconditionally
+   *
+   * During compaction the bytes of the old delta chain minus those of the
+   * new node are counted in the context
+   */
+  void ConsolidateNodeInContext(Context *context_p) {
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+    if(context_p->compact_flag == false) {
+      ConsolidateNode(snapshot_p);
+
+      return;
+    }
+
+    const BaseNode *node_p = snapshot_p->node_p;
+    size_t old_size = GetDeltaChainMemorySize(node_p);
+
+    ConsolidateNode(snapshot_p);
+
+    if(snapshot_p->node_p != node_p) {
+      context_p->compact_freed_size += \
+        static_cast<int64_t>(old_size) - \
+        static_cast<int64_t>(GetDeltaChainMemorySize(snapshot_p->node_p));
+    }
+
+    return;
+  }
+
+  /*
+   * TryConsolidateNode() - Consolidate current node if its length exceeds the
+   *                        threshold value
+   *
+   * If the length of delta chain does not exceed the threshold then this
+   * function does nothing
+   *
+   * If function returns true then we have successfully consolidated a node
+   * Otherwise no consolidation happens. The return value might be used
+   * as a hint for deciding whether to adjust node size or not
+   *
+   * NOTE: If consolidation fails then this function does not do anything
+   * and will just continue with its own job. There is no chance of abort
+   *
+   * TODO: If strict mode is on, then whenever consolidation fails we should
+   * always abort and start from the beginning, to keep delta chain length
+   * upper bound intact
+   */
+  void TryConsolidateNode(Context *context_p) {
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+    // Do not overwrite this pointer since we will use this
+    // to locate garbage delta chain
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    // We could only perform consolidation on delta node
+    // because we want to see depth field
+    if(node_p->IsDeltaNode() == false) {
+      // The depth of base node may not be 0
+      // since if we consolidate parent node to finish the partial SMO,
+      // then parent node will have non-0 depth in order to avoid being too
+      // large (see FindSplitNextKey() and FindMergePrevNextKey() and
+      // JumpToLeftSibling())
+      // assert(node_p->metadata.depth == 0);
+
+      return;
+    }
+
+    // Compaction consolidates every delta chain, such that node sizes are
+    // exact and merged branches are released
+    if(context_p->compact_flag == true) {
+      ConsolidateNodeInContext(context_p);
+
+      return;
+    }
+
+    // If depth does not exceed threshold then we check recommendation flag
+    int depth = node_p->GetDepth();
+    int threshold = 0;
+
+    // Above the memory limit long chains are not left to background
+    // threads or deferred by adaptive consolidation, such that chunks grown
+    // on them are released as soon as possible
+    bool memory_limit_flag = IsMemoryLimitExceeded();
+
+    if(snapshot_p->IsLeaf() == true) {
+      threshold = GetLeafDeltaChainThreshold(snapshot_p->node_id);
+      if(memory_limit_flag == true && \
+         threshold > TuningPolicy::LEAF_DELTA_CHAIN_THRESHOLD) {
+        threshold = TuningPolicy::LEAF_DELTA_CHAIN_THRESHOLD;
+      }
+
+      if(depth < threshold) {
+        if(depth >= TuningPolicy::LEAF_DELTA_CHAIN_THRESHOLD) {
+          AddStatistics(&ThreadStatistics::deferred_consolidation_count);
+        }
+
+        return;
+      }
+    } else {
+      threshold = TuningPolicy::INNER_DELTA_CHAIN_THRESHOLD;
+
+      if(depth < threshold) {
+        return;
+      }
+    }
+
+    // Leave the node to background threads unless the chain is too long
+    // The NodeID is pushed every time the chain grows by another threshold
+    // length, such that it is pushed again if the previous one is dropped
+    if(consolidation_queue_p != nullptr && \
+       memory_limit_flag == false && \
+       IsConsolidationThread() == false && \
+       depth < threshold * consolidation_hard_cap_factor) {
+      if(depth % threshold != 0 || \
+         consolidation_queue_p->Push(snapshot_p->node_id) == true) {
+        return;
+      }
+
+      bwt_printf("Consolidation queue is full\n");
+    }
+
+    // After this point we decide to consolidate node
+
+    if(snapshot_p->IsLeaf() == true && \
+       depth < TuningPolicy::LEAF_DELTA_CHAIN_THRESHOLD) {
+      AddStatistics(&ThreadStatistics::early_consolidation_count);
+    }
+
+    ConsolidateNode(snapshot_p);
+
+    return;
+  }
+
+  /*
+   * SampleNodeAccess() - Counts a read or a write on a leaf into the access
+   *                      counter of its NodeID
+   *
+   * Only one in NODE_ACCESS_SAMPLE_INTERVAL accesses of a thread is counted.
+   * The counter is updated with a relaxed load and store, so concurrent
+   * updates could be lost, which only makes the sample smaller. Both halves
+   * are halved once either reaches the limit, such that the counter follows
+   * the recent access mix of the node
+   *
+   * Returns true if the access is sampled
+   */
+  inline bool SampleNodeAccess(NodeID node_id, bool write_flag) {
+    static thread_local uint32_t access_count = 0U;
+
+    access_count++;
+    if(access_count % NODE_ACCESS_SAMPLE_INTERVAL != 0U) {
+      return false;
+    }
+
+    std::atomic<uint32_t> &counter = \
+      node_access_counter_p[node_id & (NODE_ACCESS_COUNTER_NUM - 1)];
+
+    uint32_t count = counter.load(std::memory_order_relaxed);
+    uint32_t read_count = count & 0xFFFFU;
+    uint32_t write_count = count >> 16;
+
+    if(write_flag == true) {
+      write_count++;
+    } else {
+      read_count++;
+    }
+
+    if(read_count >= NODE_ACCESS_COUNTER_LIMIT || \
+       write_count >= NODE_ACCESS_COUNTER_LIMIT) {
+      read_count /= 2;
+      write_count /= 2;
+    }
+
+    counter.store((write_count << 16) | read_count,
+                  std::memory_order_relaxed);
+
+    return true;
+  }
+
+  /*
+   * GetLeafDeltaChainThreshold() - Returns the delta chain length at which
+   *                                a leaf is consolidated
+   *
+   * This is LEAF_DELTA_CHAIN_THRESHOLD unless adaptive consolidation is
+   * enabled and the sampled access mix of the leaf is skewed
+   */
+  inline int GetLeafDeltaChainThreshold(NodeID node_id) const {
+    constexpr int threshold = TuningPolicy::LEAF_DELTA_CHAIN_THRESHOLD;
+
+    if(node_access_counter_p == nullptr) {
+      return threshold;
+    }
+
+    uint32_t count = \
+      node_access_counter_p[node_id & (NODE_ACCESS_COUNTER_NUM - 1)].load(
+        std::memory_order_relaxed);
+    uint32_t read_count = count & 0xFFFFU;
+    uint32_t write_count = count >> 16;
+
+    if(read_count + write_count < NODE_ACCESS_MIN_SAMPLE) {
+      return threshold;
+    } else if(read_count >= write_count * NODE_ACCESS_SKEW_FACTOR) {
+      return std::max(threshold / 2, 1);
+    } else if(write_count >= read_count * NODE_ACCESS_SKEW_FACTOR) {
+      return threshold * 2;
+    }
+
+    return threshold;
+  }
+
+  /*
+   * SampleLeafWrite() - Samples a modification of the leaf at the top of
+   *                     the context
+   */
+  inline void SampleLeafWrite(Context *context_p) {
+    if(node_access_counter_p != nullptr) {
+      SampleNodeAccess(GetLatestNodeSnapshot(context_p)->node_id, true);
+    }
+
+    return;
+  }
+
+  /*
+   * SampleLeafRead() - Samples a read of the leaf found by a read-optimized
+   *                    traversal, and consolidates the leaf if it is read-hot
+   *                    and its delta chain has reached the lowered threshold
+   *
+   * Read traversals do not consolidate otherwise, so without this a read-hot
+   * leaf keeps its chain until the next write. Nodes with an unfinished SMO
+   * on top are left to writers, as in ConsolidateNodeID()
+   */
+  void SampleLeafRead(Context *context_p) {
+    if(node_access_counter_p == nullptr) {
+      return;
+    }
+
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+
+    // Only sampled reads check the chain, to keep the cost of other reads
+    // at a thread local increment
+    if(SampleNodeAccess(snapshot_p->node_id, false) == false || \
+       snapshot_p->node_p->IsDeltaNode() == false) {
+      return;
+    }
+
+    switch(snapshot_p->node_p->GetType()) {
+      case NodeType::LeafSplitType:
+      case NodeType::LeafRemoveType:
+      case NodeType::LeafMergeType:
+        return;
+      default:
+        break;
+    }
+
+    int depth = snapshot_p->node_p->GetDepth();
+
+    if(depth >= GetLeafDeltaChainThreshold(snapshot_p->node_id)) {
+      if(depth < TuningPolicy::LEAF_DELTA_CHAIN_THRESHOLD) {
+        AddStatistics(&ThreadStatistics::early_consolidation_count);
+      }
+
+      ConsolidateLeafNode(snapshot_p);
+    }
+
+    return;
+  }
+
+  /*
+   * IsConsolidationThread() - Returns true if the current thread is a
+   *                           background consolidation thread of this tree
+   */
+  inline bool IsConsolidationThread() const {
+    return gc_id >= consolidation_gc_id_start;
+  }
+
+  /*
+   * ConsolidationThreadFunc() - Main loop of background consolidation
+   *
+   * The thread unregisters itself from GC before sleeping, so an idle
+   * thread does not prevent other threads from reclaiming memory
+   */
+  void ConsolidationThreadFunc(int thread_gc_id) {
+    AssignGCID(thread_gc_id);
+
+    while(consolidation_exit_flag.load() == false) {
+      // The epoch is entered before popping, such that the reclaim thread
+      // of Truncate() waits for NodeIDs of the old tree popped before it
+      // drains the queue (see ReclaimTreeFunc())
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
+
+      auto ret = consolidation_queue_p->Pop();
+
+      if(ret.first == true) {
+        ConsolidateNodeID(ret.second);
+
+        epoch_manager.LeaveEpoch(epoch_node_p);
+
+        continue;
+      }
+
+      UnregisterThread(thread_gc_id);
+
+      std::this_thread::sleep_for(
+        std::chrono::microseconds(CONSOLIDATION_IDLE_INTERVAL_US));
+    }
+
+    UnregisterThread(thread_gc_id);
+
+    return;
+  }
+
+  /*
+   * ConsolidateNodeID() - Consolidates a node in the background thread, and
+   *                       then adjusts its size
+   *
+   * The node is skipped if it has been consolidated since it was pushed, or
+   * if there is an unfinished SMO on top of the delta chain, which should be
+   * helped along with the parent node in the context of a traversal
+   *
+   * After a successful consolidation, if the node should be split or merged
+   * then we traverse to a key inside the node, such that AdjustNodeSize()
+   * is called with the complete context
+   *
+   * This must be called inside an epoch
+   */
+  void ConsolidateNodeID(NodeID node_id) {
+    const BaseNode *node_p = GetNode(node_id);
+
+    // The NodeID has been recycled after a merge
+    if(node_p == nullptr || node_p->IsDeltaNode() == false) {
+      return;
+    }
+
+    switch(node_p->GetType()) {
+      case NodeType::InnerSplitType:
+      case NodeType::InnerRemoveType:
+      case NodeType::InnerMergeType:
+      case NodeType::InnerAbortType:
+      case NodeType::LeafSplitType:
+      case NodeType::LeafRemoveType:
+      case NodeType::LeafMergeType:
+        return;
+      default:
+        break;
+    }
+
+    NodeSnapshot snapshot{node_id, node_p};
+    ConsolidateNode(&snapshot);
+
+    // CAS failed; other threads are modifying the node
+    if(snapshot.node_p == node_p) {
+      return;
+    }
+
+    // A key in the node for traversal. For inner nodes the first
+    // separator might be -Inf, so we use the second one
+    const KeyType *key_p = nullptr;
+
+    if(snapshot.node_p->IsOnLeafDeltaChain() == true) {
+      const LeafNode *leaf_node_p = \
+        static_cast<const LeafNode *>(snapshot.node_p);
+      int size = static_cast<int>(leaf_node_p->GetItemCount());
+
+      if((size >= leaf_node_size_upper_threshold || \
+          size <= leaf_node_size_lower_threshold) && size > 0) {
+        key_p = &leaf_node_p->At(0).first;
+      }
+    } else {
+      const InnerNode *inner_node_p = \
+        static_cast<const InnerNode *>(snapshot.node_p);
+      int size = static_cast<int>(inner_node_p->GetSize());
+
+      if((size >= inner_node_size_upper_threshold || \
+          size <= inner_node_size_lower_threshold) && size > 1) {
+        key_p = &inner_node_p->At(1).first;
+      }
+    }
+
+    if(key_p != nullptr) {
+      // The node is not freed before we leave the epoch, and the
+      // context keeps its own copy of the key
+      Context context{*key_p};
+
+      Traverse(&context, nullptr, nullptr);
+    }
+
+    return;
+  }
+
+  /*
+   * GetMergeThreshold() - Returns the size at or below which a leaf or inner
+   *                       node is merged into its left sibling
+   *
+   * This is the lower threshold, except during compaction, where nodes
+   * below half of the upper threshold are merged, such that runs of
+   * under-full nodes collapse into few nodes without being split again
+   */
+  inline int GetMergeThreshold(const Context *context_p,
+                               bool leaf_flag) const {
+    int upper_threshold = leaf_flag == true ? \
+                          leaf_node_size_upper_threshold : \
+                          inner_node_size_upper_threshold;
+    int lower_threshold = leaf_flag == true ? \
+                          leaf_node_size_lower_threshold : \
+                          inner_node_size_lower_threshold;
+
+    if(context_p->compact_flag == true) {
+      return std::max(lower_threshold, upper_threshold / 2 - 1);
+    }
+
+    return lower_threshold;
+  }
+
+  /*
+   * AdjustNodeSize() - Post split or merge delta if a node becomes overflow
+   *                    or underflow
+   *
+   * For leftmost children nodes and for root node (which has is_leftmost
+   * flag set) we never post remove delta, the merge of which would change
+   * its parent node's low key
+   *
+   * NOTE: This function will abort after installing a node remove delta,
+   * in order not to have to call LoadNodeID recursively
+   *
+   * TODO: In the future we might want to change this
+   */
+  void AdjustNodeSize(Context *context_p) {
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    const BaseNode *node_p = snapshot_p->node_p;
+
+    // We do not adjust size for delta nodes
+    if(node_p->IsDeltaNode() == true) {
+      // TODO: If we want to strictly enforce the size of any node
+      // then we should aggressively consolidate here and always
+      // Though it brings huge overhead because now we are consolidating
+      // every node on the path
+
+      return;
+    }
+
+    NodeID node_id = snapshot_p->node_id;
+
+    if(snapshot_p->IsLeaf() == true) {
+      const LeafNode *leaf_node_p = \
+        static_cast<const LeafNode *>(node_p);
+
+      // NOTE: We use key number as the size of the node
+      // because using item count might result in a very unstable
+      // split, in a sense that we could not always split the node
+      // evenly, and in the worst case if there is one key in the
+      // node the node could not be splited while having a large
+      // item count
+      size_t node_size = leaf_node_p->GetItemCount();
+
+      // Perform corresponding action based on node size
+      if(node_size >= static_cast<size_t>(leaf_node_size_upper_threshold)) {
+        bwt_printf("Node size >= leaf upper threshold. Split\n");
+
+        // Note: This function takes this as argument since it will
+        // do key comparison
+        int split_index = GetSplitIndex(leaf_node_p,
+                                        static_cast<int>(node_size),
+                                        leaf_node_size_upper_threshold,
+                                        leaf_node_size_lower_threshold);
+        // The right sibling must not be merged back right away, which
+        // would repeat forever during compaction if keys have many values
+        const LeafNode *new_leaf_node_p = \
+          leaf_node_p->GetSplitSibling(this,
+                                       split_index,
+                                       IsMergeExempt(leaf_node_p) == true ? \
+                                         0 : GetMergeThreshold(context_p, true));
+
+        // If the new leaf node pointer is nullptr then it means the
+        // although the size of the leaf node exceeds split threshold
+        // but we could not find a spliting point that evenly or almost
+        // evenly divides the key space into two siblings whose sizes
+        // are both larger than the merge threshold (o.w. the node will
+        // be immediately merged)
+        // NOTE: This is a potential problem if a leaf becomes very unbalanced
+        // since all threads will try to split the leaf node when traversing
+        // to it (not for reader threads)
+        if(new_leaf_node_p == nullptr) {
+          bwt_printf("LeafNode size exceeds overhead, "
+                     "but could not find split point\n");
+
+          return;
+        }
+
+        // Since we would like to access its first element to get the low key
+        assert(new_leaf_node_p->GetSize() > 0);
+
+        // The split key is the low key of the new leaf, which is not
+        // necessarily a key stored in the leaf (see GetSeparatorKey())
+        const KeyType &split_key = new_leaf_node_p->GetLowKey();
+
+        // If leaf split fails this should be recyced using a fake remove node
+        NodeID new_node_id = GetNextNodeID();
+
+        // Note that although split node only stores the new node ID
+        // we still need its pointer to compute item_count
+        const LeafSplitNode *split_node_p = \
+          LeafInlineAllocateOfType(LeafSplitNode, 
+                                   node_p, 
+                                   std::make_pair(split_key, new_node_id),
+                                   node_p,
+                                   new_leaf_node_p);
+
+        //  First install the NodeID -> split sibling mapping
+        // If CAS fails we also need to recycle the node ID allocated here
+        InstallNewNode(new_node_id, new_leaf_node_p);
+
+        // Then CAS split delta into current node's NodeID
+        bool ret = InstallNodeToReplace(node_id, split_node_p, node_p);
+
+        if(ret == true) {
+          bwt_printf("Leaf split delta (from %lu to %lu) CAS succeeds. ABORT\n",
+                     node_id,
+                     new_node_id);
+
+          AddStatistics(&ThreadStatistics::split_count);
+
+          if(context_p->compact_flag == true) {
+            context_p->compact_freed_size -= \
+              static_cast<int64_t>(GetDeltaChainMemorySize(new_leaf_node_p));
+          }
+
+          // TODO: WE ABORT HERE TO AVOID THIS THREAD POSTING ANYTHING
+          // ON TOP OF IT WITHOUT HELPING ALONG AND ALSO BLOCKING OTHER
+          // THREAD TO HELP ALONG
+          context_p->abort_flag = true;
+
+          return;
+        } else {
+          bwt_printf("Leaf split delta CAS fails\n");
+
+          // Need to use the epoch manager to recycle NodeID
+          // Note that this node must not be created on new_leaf_node_p
+          // since they are both put into the GC chain, it is possible
+          // for new_leaf_node_p to be deleted first and then remove node
+          // is deleted
+          const LeafRemoveNode *fake_remove_node_p = \
+            new LeafRemoveNode{new_node_id, 
+                               new_leaf_node_p};
+
+          // Must put both of them into GC chain since RemoveNode
+          // will not be followed by GC thread
+          epoch_manager.AddGarbageNode(fake_remove_node_p, false);
+          epoch_manager.AddGarbageNode(new_leaf_node_p);
+
+          // We have two nodes to delete here
+          split_node_p->~LeafSplitNode();
+
+          return;
+        }
+
+      } else if(node_size <= \
+                static_cast<size_t>(GetMergeThreshold(context_p, true))) {
+        if(node_size > 0UL && IsMergeExempt(leaf_node_p) == true) {
+          bwt_printf("Right edge leaf node is growing. Do not remove\n");
+
+          return;
+        }
+
+        // After the abort below the traversal only comes back to finish
+        // the merge if the search key is inside the node, which is not
+        // the case after finishing a split of the node for a key on the
+        // sibling. Read-optimized traversals wait for the merge to finish
+        if(IsKeyInNodeRange(context_p->search_key, node_p) == false) {
+          bwt_printf("Search key is not in the leaf node. Do not remove\n");
+
+          return;
+        }
+
+        // This might yield a false positive of left child
+        // but correctness is not affected - sometimes the merge is delayed
+        if(IsOnLeftMostChild(context_p) == true) {
+          bwt_printf("Left most leaf node cannot be removed\n");
+
+          return;
+        }
+
+        // After this point we decide to remove leaf node
+
+        bwt_printf("Node size <= leaf lower threshold. Remove\n");
+
+        // Install an abort node on parent
+        const BaseNode *abort_node_p;
+        const BaseNode *abort_child_node_p;
+        NodeID parent_node_id;
+
+        bool abort_node_ret = \
+          PostAbortOnParent(context_p,
+                            &parent_node_id,
+                            &abort_node_p,
+                            &abort_child_node_p);
+
+        // If we could not block the parent then the parent has changed
+        // (splitted, etc.)
+        if(abort_node_ret == true) {
+          bwt_printf("Blocked parent node (current node is leaf)\n");
+        } else {
+          bwt_printf("Unable to block parent node "
+                     "(current node is leaf). ABORT\n");
+
+          // ABORT and return
+          context_p->abort_flag = true;
+
+          return;
+        }
+
+        const LeafRemoveNode *remove_node_p = \
+          new LeafRemoveNode{node_id, 
+                             node_p};
+
+        bool ret = InstallNodeToReplace(node_id, remove_node_p, node_p);
+        if(ret == true) {
+          bwt_printf("LeafRemoveNode CAS succeeds. ABORT.\n");
+
+          RecordInstalledNode(remove_node_p);
+
+          AddStatistics(&ThreadStatistics::merge_count);
+
+          context_p->abort_flag = true;
+
+          RemoveAbortOnParent(parent_node_id,
+                              abort_node_p,
+                              abort_child_node_p);
+
+          return;
+        } else {
+          bwt_printf("LeafRemoveNode CAS failed\n");
+
+          delete remove_node_p;
+
+          context_p->abort_flag = true;
+
+          RemoveAbortOnParent(parent_node_id,
+                              abort_node_p,
+                              abort_child_node_p);
+
+          return;
+        }
+      }
+    } else {   // If this is an inner node
+      const InnerNode *inner_node_p = static_cast<const InnerNode *>(node_p);
+
+      size_t node_size = inner_node_p->GetSize();
+
+      if(node_size >= static_cast<size_t>(inner_node_size_upper_threshold)) {
+        bwt_printf("Node size >= inner upper threshold. Split\n");
+
+        int split_index = GetSplitIndex(inner_node_p,
+                                        static_cast<int>(node_size),
+                                        inner_node_size_upper_threshold,
+                                        inner_node_size_lower_threshold);
+        const InnerNode *new_inner_node_p = \
+          inner_node_p->GetSplitSibling(split_index);
+
+        // Since this is a split sibling, the low key must be a valid key
+        // NOTE: Only for InnerNodes could we call GetLowKey()
+        const KeyType &split_key = new_inner_node_p->GetLowKey();
+
+        // New node has at least one item (this is the basic requirement)
+        assert(new_inner_node_p->GetSize() > 0);
+
+        const KeyNodeIDPair &first_item = new_inner_node_p->At(0);
+        
+        // This points to the left most node on the right split sibling
+        // If this node is being removed then we abort
+        NodeID split_key_child_node_id = first_item.second;
+
+        // This must be the split key
+        assert(KeyCmpEqual(first_item.first, split_key));
+
+        // NOTE: WE FETCH THE POINTER WITHOUT HELP ALONG SINCE WE ARE
+        // NOW ON ITS PARENT
+        const BaseNode *split_key_child_node_p = \
+          GetNode(split_key_child_node_id);
+
+        // If the type is remove then we just continue without abort
+        // If we abort then it might introduce deadlock
+        if(split_key_child_node_p->IsRemoveNode()) {
+          bwt_printf("Found a removed node on split key child. CONTINUE \n");
+
+          // Put the new inner node into GC chain
+          // Although it is not entirely necessary it is good for us to
+          // make is so to avoid redundant code here
+          epoch_manager.AddGarbageNode(new_inner_node_p, false);
+
+          return;
+        }
+
+        NodeID new_node_id = GetNextNodeID();
+
+        const InnerSplitNode *split_node_p = \
+          InnerInlineAllocateOfType(InnerSplitNode,
+                                    node_p,
+                                    std::make_pair(split_key, new_node_id),
+                                    node_p,
+                                    new_inner_node_p);
+
+        //  First install the NodeID -> split sibling mapping
+        InstallNewNode(new_node_id, new_inner_node_p);
+
+        // Then CAS split delta into current node's NodeID
+        bool ret = InstallNodeToReplace(node_id, split_node_p, node_p);
+
+        if(ret == true) {
+          bwt_printf("Inner split delta (from %lu to %lu) CAS succeeds."
+                     " ABORT\n", node_id, new_node_id);
+
+          AddStatistics(&ThreadStatistics::split_count);
+
+          if(context_p->compact_flag == true) {
+            context_p->compact_freed_size -= \
+              static_cast<int64_t>(GetDeltaChainMemorySize(new_inner_node_p));
+          }
+
+          // Same reason as in leaf node
+          context_p->abort_flag = true;
+
+          return;
+        } else {
+          bwt_printf("Inner split delta CAS fails\n");
+
+          // Use the epoch manager to recycle NodeID in single threaded
+          // environment
+          // Note that this remove node should be created on existing node
+          // rather than on new_inner_node_p, since new_inner_node_p may
+          // be destroyed before fake_remove_node_p is destroyed
+          const InnerRemoveNode *fake_remove_node_p = \
+            new InnerRemoveNode{new_node_id, 
+                                new_inner_node_p};
+
+          epoch_manager.AddGarbageNode(fake_remove_node_p, false);
+          epoch_manager.AddGarbageNode(new_inner_node_p);
+
+          // Call destructor since it is allocated from the base InnerNode
+          split_node_p->~InnerSplitNode();
+
+          return;
+        } // if CAS fails
+      } else if(node_size <= \
+                static_cast<size_t>(GetMergeThreshold(context_p, false))) {
+        if(IsMergeExempt(inner_node_p) == true) {
+          bwt_printf("Right edge inner node is growing. Do not remove\n");
+
+          return;
+        }
+
+        if(context_p->IsOnRootNode() == true) {
+          bwt_printf("Root underflow - let it be\n");
+
+          return;
+        }
+
+        // NOTE: If the parent node has changed (e.g. split on the current
+        // node's low key) we will not be able to catch it. But we will
+        // find it later by posting an InnerAbortNode on parent which would
+        // result in CAS failing and aborting
+
+        // Same as leaf nodes
+        if(IsKeyInNodeRange(context_p->search_key, node_p) == false) {
+          bwt_printf("Search key is not in the inner node. Do not remove\n");
+
+          return;
+        }
+
+        // We could not remove leftmost node
+        if(IsOnLeftMostChild(context_p) == true) {
+          bwt_printf("Left most inner node cannot be removed\n");
+
+          return;
+        }
+
+        // After this point we decide to remove
+
+        bwt_printf("Node size <= inner lower threshold. Remove\n");
+
+        // Then we abort its parent node
+        // These two are used to hold abort node and its previous child
+        const BaseNode *abort_node_p;
+        const BaseNode *abort_child_node_p;
+        NodeID parent_node_id;
+
+        bool abort_node_ret = \
+          PostAbortOnParent(context_p,
+                            &parent_node_id,
+                            &abort_node_p,
+                            &abort_child_node_p);
+
+        // If we could not block the parent then the parent has changed
+        // (splitted, etc.)
+        if(abort_node_ret == true) {
+          bwt_printf("Blocked parent node (current node is inner)\n");
+        } else {
+          bwt_printf("Unable to block parent node "
+                     "(current node is inner). ABORT\n");
+
+          // ABORT and return
+          context_p->abort_flag = true;
+
+          return;
+        }
+
+        const InnerRemoveNode *remove_node_p = \
+          new InnerRemoveNode{node_id, 
+                              node_p};
+
+        bool ret = InstallNodeToReplace(node_id, remove_node_p, node_p);
+        if(ret == true) {
+          bwt_printf("InnerRemoveNode CAS succeeds. ABORT\n");
+
+          RecordInstalledNode(remove_node_p);
+
+          AddStatistics(&ThreadStatistics::merge_count);
+
+          // We abort after installing a node remove delta
+          context_p->abort_flag = true;
+
+          // Even if we success we need to remove the abort
+          // on the parent, and let parent split thread to detect the remove
+          // delta on child
+          RemoveAbortOnParent(parent_node_id,
+                              abort_node_p,
+                              abort_child_node_p);
+
+          return;
+        } else {
+          bwt_printf("InnerRemoveNode CAS failed\n");
+
+          delete remove_node_p;
+
+          // We must abort here since otherwise it might cause
+          // merge nodes to underflow
+          context_p->abort_flag = true;
+
+          // Same as above
+          RemoveAbortOnParent(parent_node_id,
+                              abort_node_p,
+                              abort_child_node_p);
+
+          return;
+        }
+      } // if split/remove
+    }
+
+    return;
+  }
+
+  /*
+   * RemoveAbortOnParent() - Removes the abort node on the parent
+   *
+   * This operation must succeeds since only the thread that installed
+   * the abort node could remove it
+   */
+  void RemoveAbortOnParent(NodeID parent_node_id,
+                           const BaseNode *abort_node_p,
+                           const BaseNode *abort_child_node_p) {
+    bwt_printf("Remove abort on parent node\n");
+
+    // We switch back to the child node (so it is the target)
+    bool ret = \
+      InstallNodeToReplace(parent_node_id, abort_child_node_p, abort_node_p);
+
+    // This CAS must succeed since nobody except this thread could remove
+    // the ABORT delta on parent node
+    assert(ret == true);
+    (void)ret;
+
+    // NOTE: DO NOT FORGET TO REMOVE THE ABORT AFTER
+    // UNINSTALLING IT FROM THE PARENT NODE
+    // NOTE 2: WE COULD NOT DIRECTLY DELETE THIS NODE
+    // SINCE SOME OTHER NODES MIGHT HAVE TAKEN A SNAPSHOT
+    // AND IF ABORT NODE WAS REMOVED, THE TYPE INFORMATION
+    // CANNOT BE PRESERVED AND IT DOES NOT ABORT; INSTEAD
+    // IT WILL TRY TO CALL CONSOLIDATE ON ABORT
+    // NODE, CAUSING TYPE ERROR
+    //delete (InnerAbortNode *)abort_node_p;
+
+    // This delays the deletion of abort node until all threads has exited
+    // so that existing pointers to ABORT node remain valid
+    // GC does not follow the delta chain of ABORT node
+    epoch_manager.AddGarbageNode(abort_node_p);
+
+    return;
+  }
+
+  /*
+   * PostAbortOnParent() - Posts an inner abort node on the parent
+   *
+   * This function blocks all accesses to the parent node, and blocks
+   * all CAS efforts for threads that took snapshots before the CAS
+   * in this function.
+   *
+   * Return false if CAS failed. In that case the memory is freed
+   * by this function
+   *
+   * This function DOES NOT ABORT. Do not have to check for abort flag. But
+   * if CAS fails then returns false, and caller needs to abort after
+   * checking the return value.
+   */
+  bool PostAbortOnParent(Context *context_p,
+                         NodeID *parent_node_id_p,
+                         const BaseNode **abort_node_p_p,
+                         const BaseNode **abort_child_node_p_p) {
+    // This will make sure the path list has length >= 2
+    NodeSnapshot *parent_snapshot_p = \
+      GetLatestParentNodeSnapshot(context_p);
+
+    const BaseNode *parent_node_p = parent_snapshot_p->node_p;
+    NodeID parent_node_id = parent_snapshot_p->node_id;
+
+    // Save original node pointer
+    *abort_child_node_p_p = parent_node_p;
+    *parent_node_id_p = parent_node_id;
+
+    InnerAbortNode *abort_node_p = \
+      new InnerAbortNode{parent_node_p};
+
+    bool ret = InstallNodeToReplace(parent_node_id,
+                                    abort_node_p,
+                                    parent_node_p);
+
+    if(ret == true) {
+      bwt_printf("Inner Abort node CAS succeeds\n");
+
+      RecordInstalledNode(abort_node_p);
+
+      // Copy the new node to caller since after posting remove delta we will
+      // remove this abort node to enable accessing again
+      *abort_node_p_p = abort_node_p;
+    } else {
+      bwt_printf("Inner Abort node CAS failed\n");
+
+      delete abort_node_p;
+    }
+
+    return ret;
+  }
+
+  /*
+   * NavigateInnerNode() - Given a parent snapshot and a key, return the item
+   *                       with the same key if that item exists
+   *
+   * This function checks whether a given key exists in the current
+   * inner node delta chain. If it exists then return a pointer to the
+   * item, otherwise return nullptr.
+   *
+   * This function is called when completing both split SMO and merge SMO
+   * For split SMO we need to check, key range and key existance, and
+   * NodeID value, to avoid mssing a few InnerDeleteNode on the parent node.
+   * However, for merge SMO, we only check key existence.
+   *
+   * Note: This function does not abort. Any extra checking (e.g. whether
+   * NodeIDs match, whether key is inside range) should be done by the caller
+   *
+   * Note 2: index_pair_p always reflects the relative position of the search
+   * key inside this InnerNode, no matter nullptr or non-null pointer is 
+   * returned, the integer inside the pair is always the index for all keys
+   * >= the search key. Currently the secong component is not set and not
+   * used
+   */
+  const KeyNodeIDPair *NavigateInnerNode(NodeSnapshot *snapshot_p,
+                                         const KeyType &search_key,
+                                         const KeyNodeIDPair **location) {
+    // Save some keystrokes
+    const BaseNode *node_p = snapshot_p->node_p;
+    
+     // This is used to recognize the leftmost branch if there is
+     // a merge node
+     const KeyNodeIDPair &low_key_pair = node_p->GetLowKeyPair();
+    
+    // The caller must make sure this is true
+    assert(node_p->GetNextNodeID() == INVALID_NODE_ID ||
+           KeyCmpLess(search_key, node_p->GetHighKey()));
+
+    while(1) {
+      switch(node_p->GetType()) {
+      case NodeType::InnerInsertType: {
+        const KeyNodeIDPair &insert_item = \
+          static_cast<const InnerInsertNode *>(node_p)->item;
+
+        if(KeyCmpEqual(insert_item.first, search_key) == true) {
+          // Same key, same index
+          *location = static_cast<const InnerInsertNode *>(node_p)->location;
+          
+          return &insert_item;
+        }
+
+        node_p = \
+          static_cast<const InnerInsertNode *>(node_p)->child_node_p;
+
+        break;
+      } // InnerInsertNode
+      case NodeType::InnerDeleteType: {
+        const KeyNodeIDPair &delete_item = \
+          static_cast<const InnerDeleteNode *>(node_p)->item;
+
+        if(KeyCmpEqual(delete_item.first, search_key) == true) {
+          *location = static_cast<const InnerDeleteNode *>(node_p)->location;
+          
+          return nullptr;
+        }
+
+        node_p = \
+          static_cast<const InnerDeleteNode *>(node_p)->child_node_p;
+
+        break;
+      } // InnerDeleteNode
+      case NodeType::InnerType: {
+        const InnerNode *inner_node_p = static_cast<const InnerNode *>(node_p);
+
+        // DO NOT REMOVE THIS!!!!!!
+        // Unlike a NavigateInnerNode(Context *) which searches for child
+        // node ID, this function needs to cover all possible separators
+        // in the merged InnerNode (right branch)
+        const KeyNodeIDPair *start_it = inner_node_p->Begin();
+
+        // If we are on the leftmost branch of the inner node delta chain
+        // if there is a merge delta, then we should start searching from
+        // the second element. Otherwise always start search from the first
+        // element
+        if(low_key_pair.second == inner_node_p->At(0).second) {
+          start_it++;
+        }
+
+        const KeyNodeIDPair *it = \
+          KeyLowerBound(start_it, inner_node_p->End(), search_key);
+
+        // Just give the location information by assigning to location
+        *location = it;
+
+        if(it == inner_node_p->End()) {
+          // This is special case since we could not compare the iterator
+          // If the key does not exist then return nullptr
+          return nullptr;
+        } else if(KeyCmpEqual(it->first, search_key) == false) {
+          // If found the lower bound but keys are different
+          // then also return nullptr
+          return nullptr;
+        } else {
+          // If found the lower bound and the key matches
+          // return the key
+          return it;
+        }
+
+        assert(false);
+        return nullptr;
+      } // InnerNode
+      case NodeType::InnerSplitType: {
+        // We must guarantee that the key must be inside the range
+        // of this function
+        // For split SMO this is true by extra checking
+        // For merge SMO this is implicitly true sunce the merge key
+        // should not be in another node, o.w. the high key has changed
+        node_p = \
+          static_cast<const InnerSplitNode *>(node_p)->child_node_p;
+
+        break;
+      } // InnerSplitType
+      case NodeType::InnerMergeType: {
+        const KeyNodeIDPair &delete_item = \
+          static_cast<const InnerMergeNode *>(node_p)->delete_item;
+
+        // If the split key >= merge key then just go to the right branch
+        if(KeyCmpGreaterEqual(search_key, delete_item.first) == true) {
+          node_p = static_cast<const InnerMergeNode *>(node_p)->right_merge_p;
+        } else {
+          node_p = static_cast<const InnerMergeNode *>(node_p)->child_node_p;
+        }
+
+        break;
+      } // InnerMergeNode
+      default: {
+        bwt_printf("Unknown InnerNode type: %d", (int)node_p->GetType());
+
+        assert(false);
+        return nullptr;
+      } // default
+      } // switch
+    } // while(1)
+
+    assert(false);
+    return nullptr;
+  }
+  
+  /*
+   * FindLeftSibling() - Finds the left sibling of the current child node
+   *                     specified by a search key
+   *
+   * This function works in a way similar to how inner node delta chains
+   * are consolidated: We replay the log using sorted small set on all keys
+   * less than or equal to the search key, and then choose the second key
+   * in key order from high to low, after combing the content of InnerNode
+   * and the delta chain nodes
+   *
+   * NOTE: search_key is the low key of the current node for which we are
+   * find the left sibling, not the search key of the current operation.
+   * These two might differ in the case of cascading remove node delta
+   *
+   * NOTE 2: This function could not deal with InnerMergeNode since the merge
+   * node imposes a non-consecutive storage for adjacent keys. As an alternative
+   * way of finding left sibling, whenever an InnerMergeNode is observed,
+   * the node will be consolidated and we use the plain InnerNode to
+   * continue searching
+   */
+  inline NodeID FindLeftSibling(const KeyType &search_key,
+                                NodeSnapshot *snapshot_p) {
+
+    // This will be changed during the traversal
+    const BaseNode *node_p = snapshot_p->node_p;
+    
+    // First check that the node is always in the range of the inner node
+    assert(node_p->GetNextNodeID() == INVALID_NODE_ID || \
+           KeyCmpLess(search_key, node_p->GetHighKey()));
+    
+    // We can only search for left sibling on inner delta chain
+    assert(node_p->IsOnLeafDeltaChain() == false);
+    
+    const InnerDataNode *data_node_list[node_p->GetDepth()];
+
+    // These two are used to compare InnerDataNode for < and == relation
+
+    // NOTE: For this function we reverse the direction of comparison,
+    // i.e. the order is big-to-small to make iteration a little bit easier
+    auto f1 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
+                      return this->KeyCmpLess(idn_2->item.first, idn_1->item.first);
+                      //                          ^ <-------------> ^
+                    };
+
+    auto f2 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
+                      return this->KeyCmpEqual(idn_1->item.first, idn_2->item.first);
+                    };
+
+    SortedSmallSet<const InnerDataNode *, decltype(f1), decltype(f2)> \
+      sss{data_node_list, f1, f2};
+
+    while(1) {
+      NodeType type = node_p->GetType();
+
+      switch(type) {
+        case NodeType::InnerType: {
+          const InnerNode *inner_node_p = \
+            static_cast<const InnerNode *>(node_p);
+            
+          ///////////////////////////////////////////////////////////
+          // First find the nearest sep key <= search key on InnerNode
+          ///////////////////////////////////////////////////////////
+
+          // This is the logical end of the array
+          const KeyNodeIDPair *end_it = inner_node_p->End();
+
+          // Since we know the search key must be one of the key inside
+          // the inner node, lower bound is sufficient
+          auto it1 = KeyUpperBound(inner_node_p->Begin() + 1,
+                                   end_it,
+                                   search_key) - 1;
+
+          // Note that it is possible for it1 to be begin()
+          // since it is not the real current node if the node id
+          // is actually found on the delta chain
+          
+          ///////////////////////////////////////////////////////////
+          // After this point, it is guaranteed:
+          //   1. it1 points to an element <= removed node's low key
+          //   2. sss.GetBegin() points to an element <= removed node's low key
+          //      * OR *
+          //      sss.GetBegin() == sss.GetEnd()
+          ///////////////////////////////////////////////////////////
+          
+          // We need to pop out 2 items
+          const KeyNodeIDPair *left_item_p = nullptr;
+          
+          int counter = 0;
+          
+          // Loop twice. Hope compiler expands this loop
+          while(counter < 2) {
+            if(sss.GetBegin() == sss.GetEnd()) {
+              left_item_p = &(*it1);
+              
+              it1--;
+              counter++;
+              
+              continue;
+            } else if(it1 == inner_node_p->Begin()) {
+              // We know the sss is not empty, so could always pop from it
+              if(sss.GetFront()->GetType() == NodeType::InnerInsertType) {
+                left_item_p = &(sss.GetFront()->item);
+
+                counter++;
+              }
+              
+              // This has to be done anyway
+              sss.PopFront();
+              
+              continue;
+            }
+            
+            // After this point it1-- is always valid since it is not begin()
+            
+            // If the two items are same
+            if(KeyCmpEqual(sss.GetFront()->item.first, it1->first)) {
+              // If a delete node and a sep item has the same key
+              if(sss.GetFront()->GetType() == NodeType::InnerDeleteType) {
+                it1--;
+              } else {
+                // Otherwise an insert node overrides existing key
+                left_item_p = &(sss.GetFront()->item);
+                
+                it1--;
+                
+                counter++;
+              }
+              
+              // This is common
+              sss.PopFront();
+            } else if(KeyCmpLess(sss.GetFront()->item.first, it1->first)) {
+              // If the inner node has larger sep item
+              // Otherwise an insert node overrides existing key
+              left_item_p = &(*it1);
+
+              it1--;
+
+              counter++;
+            } else {
+              if(sss.GetFront()->GetType() == NodeType::InnerInsertType) {
+                // If the delta node has larger item then set left item p
+                // to delta item
+                left_item_p = &(sss.GetFront()->item);
+
+                counter++;
+              } 
+              
+              // This is common
+              sss.PopFront();
+            }
+          } // while counter < 2
+          
+          // This is the NodeID of the left sibling
+          return left_item_p->second;
+        } 
+        case NodeType::InnerInsertType: {
+          const InnerInsertNode *insert_node_p = \
+            static_cast<const InnerInsertNode *>(node_p);
+
+          const KeyNodeIDPair &insert_item = insert_node_p->item;
+
+          if(KeyCmpLessEqual(insert_item.first, search_key)) {
+            sss.Insert(insert_node_p);
+          }
+
+          node_p = insert_node_p->child_node_p;
+
+          break;
+        } // InnerInsertType
+        case NodeType::InnerDeleteType: {
+          const InnerDeleteNode *delete_node_p = \
+            static_cast<const InnerDeleteNode *>(node_p);
+            
+          const KeyNodeIDPair &delete_item = delete_node_p->item;
+
+          if(KeyCmpLessEqual(delete_item.first, search_key)) {
+            sss.Insert(delete_node_p);
+          }
+          
+          node_p = delete_node_p->child_node_p;
+
+          break;
+        } // InnerDeleteType
+        case NodeType::InnerSplitType: {
+          const InnerSplitNode *split_node_p = \
+            static_cast<const InnerSplitNode *>(node_p);
+
+          node_p = split_node_p->child_node_p;
+
+          break;
+        } // case InnerSplitType
+        case NodeType::InnerMergeType: {
+          bwt_printf("Found merge node. "
+                     "Need consolidation to find left sibling\n");
+
+          // Since we could not deal with merge delta, if there is
+          // a merge delta on the path, the only solution is to
+          // consolidate the inner node, and try to install it
+          //
+          // Even if installation fails, we need to prevserve the content
+          // of the consolidated node, so need to add it to the GC instead
+          // of directly releasing its memory
+
+          InnerNode *inner_node_p = \
+            CollectAllSepsOnInner(snapshot_p,
+                                  // Must +1 to avoid looping on the same depth
+                                  // without any consolidation
+                                  snapshot_p->node_p->GetDepth() + 1);
+
+          bool ret = InstallNodeToReplace(snapshot_p->node_id,
+                                          inner_node_p,
+                                          snapshot_p->node_p);
+                                          
+          if(ret == true) {
+            RecordInstalledNode(inner_node_p);
+
+            epoch_manager.AddGarbageNode(snapshot_p->node_p);
+            
+            snapshot_p->node_p = inner_node_p;
+          } else {
+            // This is necessary to preserve the content of the inner node
+            // while avoid memory leaks
+            epoch_manager.AddGarbageNode(inner_node_p, false);
+          }
+          
+          // Next iteration will go directly into inner node we have
+          // just consolidated
+          node_p = inner_node_p;
+            
+          // This is important - since we just changed the entire node,
+          // the sss should be empty
+          sss.Invalidate();
+          
+          break;
+        } // InnerMergeType
+        default: {
+          bwt_printf("ERROR: Unknown node type = %d",
+                     static_cast<int>(type));
+
+          assert(false);
+        }
+      } // switch type
+    } // while 1
+
+    // Should not reach here
+    assert(false);
+    return INVALID_NODE_ID;
+  }
+
+  /*
+   * PostInnerMergeNode() - Post an inner merge node
+   */
+  bool PostInnerMergeNode(const NodeSnapshot *snapshot_p,
+                          const KeyType *merge_key_p,
+                          const BaseNode *merge_branch_p,
+                          NodeID deleted_node_id,
+                          const BaseNode **node_p_p) {
+    // This is the child node of merge delta
+    const BaseNode *node_p = snapshot_p->node_p;
+    NodeID node_id = snapshot_p->node_id;
+
+    // Note that we allocate from merge_banch_p since node_p is deallocated
+    // first and then merge_branch_p, so if we allocate the merge node
+    // on node_p's base node it will be invalid for the second recursive call
+    const InnerMergeNode *merge_node_p = \
+      InnerInlineAllocateOfType(InnerMergeNode, 
+                                merge_branch_p,
+                                *merge_key_p,
+                                merge_branch_p,
+                                deleted_node_id,
+                                node_p);
+
+    // Compare and Swap!
+    bool ret = InstallNodeToReplace(node_id, merge_node_p, node_p);
+
+    // If CAS fails we delete the node and return false
+    if(ret == false) {
+      merge_node_p->~InnerMergeNode();
+    } else {
+      *node_p_p = merge_node_p;
+    }
+
+    return ret;
+  }
+  
+
+  /*
+   * PostLeafMergeNode() - Post an inner merge node
+   */
+  bool PostLeafMergeNode(const NodeSnapshot *snapshot_p,
+                         const KeyType *merge_key_p,
+                         const BaseNode *merge_branch_p,
+                         NodeID deleted_node_id,
+                         const BaseNode **node_p_p) {
+    // This is the child node of merge delta
+    const BaseNode *node_p = snapshot_p->node_p;
+    NodeID node_id = snapshot_p->node_id;
+
+    // Must allocate on merge_branch_p, otherwise when recycle this
+    // delta chain, node_p is reclaimed first and then merge_branch_p,
+    // so if we allocate it on node_p, we will get an invalid reference
+    // for the second recursive call
+    const LeafMergeNode *merge_node_p = \
+      InnerInlineAllocateOfType(LeafMergeNode, 
+                                merge_branch_p,
+                                *merge_key_p,
+                                merge_branch_p,
+                                deleted_node_id,
+                                node_p);
+
+    // Compare and Swap!
+    bool ret = InstallNodeToReplace(node_id, merge_node_p, node_p);
+
+    // If CAS fails we delete the node and return false
+    if(ret == false) {
+      merge_node_p->~LeafMergeNode();
+    } else {
+      *node_p_p = merge_node_p;
+    }
+
+    return ret;
+  }
 
-          node_p = insert_node_p->child_node_p;
+  /*
+   * BulkLoad() - Build the tree from a sorted range of key value pairs
+   *
+   * Leaf nodes are packed to fill_factor * leaf node split threshold
+   * elements, and inner levels are then built bottom-up from the low keys of
+   * the level below, until a single node remains which becomes the root.
+   * All nodes are consolidated base nodes, so there is no delta chain or CAS
+   * involved
+   *
+   * The first leaf reuses first_leaf_id such that the iterator still
+   * works, and the top level reuses the current root NodeID
+   *
+   * NOTE: This function must be called on an empty tree under single threaded
+   * environment. The range must be sorted by key and must not contain
+   * duplicated key value pairs. Values of the same key are never split into
+   * two leaf nodes, which is the same invariant maintained by leaf split
+   */
+  template <typename IteratorType>
+  void BulkLoad(IteratorType begin_it,
+                IteratorType end_it,
+                double fill_factor = 0.75) {
+    bwt_printf("BulkLoad()\n");
+
+    assert(fill_factor > 0.0 && fill_factor <= 1.0);
+
+    // Node size must be kept within (LOWER, UPPER) to avoid triggering an
+    // immediate split or remove on the first access
+    const size_t leaf_node_size = static_cast<size_t>(
+      BulkLoadNodeSize(leaf_node_size_upper_threshold,
+                       leaf_node_size_lower_threshold,
+                       fill_factor));
+    const size_t inner_node_size = static_cast<size_t>(
+      BulkLoadNodeSize(inner_node_size_upper_threshold,
+                       inner_node_size_lower_threshold,
+                       fill_factor));
+
+    if(begin_it == end_it) {
+      return;
+    }
 
-          break;
-        } // case LeafInsertType
-        case NodeType::LeafDeleteType: {
-          const LeafDeleteNode *delete_node_p = \
-            static_cast<const LeafDeleteNode *>(node_p);
+    const BaseNode *first_leaf_node_p = GetNode(first_leaf_id);
+    assert(first_leaf_node_p->GetType() == NodeType::LeafType);
+    assert(first_leaf_node_p->GetItemCount() == 0);
+
+    // This is (-Inf, INVALID_NODE_ID) and (+Inf, INVALID_NODE_ID) respectively
+    KeyNodeIDPair low_key_pair = first_leaf_node_p->GetLowKeyPair();
+    const KeyNodeIDPair inf_key_pair = first_leaf_node_p->GetHighKeyPair();
+
+    // The old root only has a single separator pointing to the first leaf,
+    // so we free it directly rather than recursively
+    const InnerNode *root_node_p = \
+      static_cast<const InnerNode *>(GetNode(root_id.load()));
+    assert(root_node_p->GetType() == NodeType::InnerType);
+    assert(root_node_p->GetItemCount() == 1);
+
+    node_memory_size.fetch_sub( \
+      static_cast<int64_t>(GetDeltaChainMemorySize(root_node_p) + \
+                           GetDeltaChainMemorySize(first_leaf_node_p)),
+      std::memory_order_relaxed);
+
+    root_node_p->~InnerNode();
+    root_node_p->Destroy();
+    mapping_table[root_id.load()] = nullptr;
+
+    FreeNodeByNodeID(first_leaf_id);
+
+    // This holds (low key, NodeID) of nodes on the level being built
+    std::vector<KeyNodeIDPair> sep_list{};
+
+    // Items of the current leaf node which has not been installed
+    std::vector<KeyValuePair> item_list{};
+    NodeID leaf_node_id = first_leaf_id;
+
+    for(IteratorType it = begin_it;it != end_it;it++) {
+      assert(item_list.empty() == true ||
+             KeyCmpLessEqual(item_list.back().first, it->first) == true);
+
+      // Only cut the leaf at a key boundary
+      if((item_list.size() >= leaf_node_size) &&
+         (KeyCmpEqual(item_list.back().first, it->first) == false)) {
+        // Bulk load does not require a GC ID, so NodeIDs are not taken
+        // from the thread-local chunk
+        NodeID next_leaf_node_id = TakeNodeID();
+        const KeyType split_key = \
+          GetSeparatorKey(item_list.back().first, it->first);
+
+        BulkLoadLeafNode(leaf_node_id,
+                         low_key_pair,
+                         std::make_pair(split_key, next_leaf_node_id),
+                         &item_list);
+        sep_list.push_back(std::make_pair(low_key_pair.first, leaf_node_id));
+
+        // Same as the low key of a split sibling
+        low_key_pair = std::make_pair(split_key, ~INVALID_NODE_ID);
+        leaf_node_id = next_leaf_node_id;
+        item_list.clear();
+      }
 
-          if(delta_set.Exists(delete_node_p->item) == false) {
-            delta_set.Insert(delete_node_p->item);
+      item_list.push_back(*it);
+      approximate_size_base++;
+    }
 
-            sss.InsertNoDedup(delete_node_p);
-          }
+    BulkLoadLeafNode(leaf_node_id, low_key_pair, inf_key_pair, &item_list);
+    sep_list.push_back(std::make_pair(low_key_pair.first, leaf_node_id));
 
-          node_p = delete_node_p->child_node_p;
+    // Build at least one level to have an inner node as the root
+    do {
+      sep_list = BulkLoadInnerLevel(sep_list, inner_node_size, inf_key_pair);
+    } while(sep_list.size() > 1);
 
-          break;
-        } // case LeafDeleteType
-        case NodeType::LeafRemoveType: {
-          bwt_printf("ERROR: LeafRemoveNode not allowed\n");
+    assert(sep_list[0].second == root_id.load());
 
-          assert(false);
-        } // case LeafRemoveType
-        case NodeType::LeafSplitType: {
-          const LeafSplitNode *split_node_p = \
-            static_cast<const LeafSplitNode *>(node_p);
+    return;
+  }
 
-          node_p = split_node_p->child_node_p;
+  /*
+   * BulkLoadNodeSize() - Returns the number of elements in a bulk loaded node
+   */
+  static int BulkLoadNodeSize(int upper_threshold,
+                              int lower_threshold,
+                              double fill_factor) {
+    int node_size = static_cast<int>(upper_threshold * fill_factor);
 
-          break;
-        } // case LeafSplitType
-        case NodeType::LeafMergeType: {
-          const LeafMergeNode *merge_node_p = \
-            static_cast<const LeafMergeNode *>(node_p);
+    return std::min(std::max(node_size, lower_threshold + 1),
+                    upper_threshold - 1);
+  }
 
-          /**** RECURSIVE CALL ON LEFT AND RIGHT SUB-TREE ****/
-          CollectAllValuesOnLeafRecursive(merge_node_p->child_node_p,
-                                          sss,
-                                          delta_set,
-                                          new_leaf_node_p);
+  /*
+   * BulkLoadLeafNode() - Allocates a leaf node, and install it with NodeID
+   *
+   * Items are moved into the node, so the caller should clear the list
+   */
+  void BulkLoadLeafNode(NodeID node_id,
+                        const KeyNodeIDPair &low_key_pair,
+                        const KeyNodeIDPair &high_key_pair,
+                        std::vector<KeyValuePair> *item_list_p) {
+    int item_count = static_cast<int>(item_list_p->size());
 
-          CollectAllValuesOnLeafRecursive(merge_node_p->right_merge_p,
-                                          sss,
-                                          delta_set,
-                                          new_leaf_node_p);
+    LeafNode *leaf_node_p = \
+      reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
+        Get(item_count,
+            NodeType::LeafType,
+            0,
+            item_count,
+            low_key_pair,
+            high_key_pair));
 
-          return;
-        } // case LeafMergeType
-        default: {
-          bwt_printf("ERROR: Unknown node type: %d\n",
-                     static_cast<int>(type));
+    leaf_node_p->MoveBack(item_list_p->data(),
+                          item_list_p->data() + item_count);
 
-          assert(false);
-        } // default
-      } // switch
-    } // while(1)
+    InstallNewNode(node_id, leaf_node_p);
 
     return;
   }
 
-  ///////////////////////////////////////////////////////////////////
-  // Control Core
-  ///////////////////////////////////////////////////////////////////
-
   /*
-   * GetLatestNodeSnapshot() - Return a pointer to the most recent snapshot
-   *
-   * This is wrapper that includes size checking
+   * BulkLoadInnerLevel() - Builds a level of inner nodes from the separators
+   *                        of the level below
    *
-   * NOTE: The snapshot object is not valid after it is popped out of
-   * the vector, since at that time the snapshot object will be destroyed
-   * which also freed up the logical node object
+   * Separators are evenly distributed into inner nodes of no more than
+   * node_size elements. The first separator of each inner node is its low key.
+   * If the level has only one node then it is installed as the root. Returns
+   * the separator list of the nodes on this level
    */
-  static inline NodeSnapshot *GetLatestNodeSnapshot(Context *context_p) {
-    assert(context_p->current_level >= 0);
+  std::vector<KeyNodeIDPair> \
+  BulkLoadInnerLevel(const std::vector<KeyNodeIDPair> &sep_list,
+                     size_t node_size,
+                     const KeyNodeIDPair &inf_key_pair) {
+    const size_t sep_num = sep_list.size();
+    const size_t node_num = (sep_num + node_size - 1) / node_size;
+
+    std::vector<KeyNodeIDPair> upper_sep_list{};
+    upper_sep_list.reserve(node_num);
+
+    // NodeIDs are allocated first since high key of a node refers
+    // to its right sibling
+    for(size_t i = 0;i < node_num;i++) {
+      NodeID node_id = (node_num == 1) ? root_id.load() : TakeNodeID();
+
+      // Element index of this node in sep_list
+      size_t start_index = (sep_num * i) / node_num;
+
+      upper_sep_list.push_back(std::make_pair(sep_list[start_index].first,
+                                              node_id));
+    }
 
-    return &context_p->current_snapshot;
+    for(size_t i = 0;i < node_num;i++) {
+      size_t start_index = (sep_num * i) / node_num;
+      size_t end_index = (sep_num * (i + 1)) / node_num;
+      int item_count = static_cast<int>(end_index - start_index);
+
+      InnerNode *inner_node_p = \
+        reinterpret_cast<InnerNode *>(ElasticNode<KeyNodeIDPair>::\
+          Get(item_count,
+              NodeType::InnerType,
+              0,
+              item_count,
+              sep_list[start_index],
+              (i == node_num - 1) ? inf_key_pair : upper_sep_list[i + 1]));
+
+      inner_node_p->PushBack(sep_list.data() + start_index,
+                             sep_list.data() + end_index);
+
+      InstallNewNode(upper_sep_list[i].second, inner_node_p);
+    }
+
+    return upper_sep_list;
   }
 
   /*
-   * GetLatestParentNodeSnapshot() - Return the pointer to the parent node of
-   *                                 the current node
+   * InsertBatch() - Inserts a batch of key value pairs into the tree
    *
-   * This function assumes the current node is always the one on the top of
-   * the stack.
+   * The batch is sorted by key and cut into at most thread_num ranges, and
+   * each range is inserted by its own thread. Boundaries of ranges are moved
+   * to high keys of the leaf nodes they fall into, such that two threads do
+   * not work on the same leaf unless it is split or merged concurrently.
+   * Pairs of a leaf are inserted together by consolidating the leaf with
+   * these pairs into a new base node, so there is one CAS per leaf instead
+   * of one per pair (see InsertBatchLeaf()).
    *
-   * NOTE: The same as GetLatestNodeSnapshot(), be careful when popping
-   * snapshots out of the stack
+   * Pairs already in the tree, or repeated in the batch, are ignored in the
+   * same way as Insert() returning false. Returns the number of pairs
+   * inserted
+   *
+   * NOTE: This could be called concurrently with other operations. If
+   * thread_num > 1 then the worker threads are registered with
+   * RegisterThread(), and the calling thread only waits for them
    */
-  inline NodeSnapshot *GetLatestParentNodeSnapshot(Context *context_p) {
-    // Make sure the current node has a parent
-    assert(context_p->current_level >= 1);
+  size_t InsertBatch(const KeyValuePair *pair_list_p,
+                     size_t pair_num,
+                     int thread_num = 1) {
+    bwt_printf("InsertBatch()\n");
 
-    // This is the address of the parent node
-    return &context_p->parent_snapshot;
+    assert(thread_num > 0);
+
+    AddStatistics(&ThreadStatistics::insert_op_count, pair_num);
+
+    // Values of the same key are kept in their order in the batch such that
+    // the first one wins for unique key
+    std::vector<KeyValuePair> batch(pair_list_p, pair_list_p + pair_num);
+    std::stable_sort(batch.begin(), batch.end(), key_value_pair_cmp_obj);
+
+    // Remove duplicates inside the batch, which only happen between pairs
+    // of the same key
+    size_t batch_size = 0;
+    for(size_t i = 0;i < batch.size();i++) {
+      bool duplicated_flag = false;
+
+      for(size_t j = batch_size;j > 0;j--) {
+        if(KeyCmpEqual(batch[j - 1].first, batch[i].first) == false) {
+          break;
+        }
+
+        if(UniqueKey == true || \
+           key_value_pair_eq_obj(batch[j - 1], batch[i]) == true) {
+          duplicated_flag = true;
+
+          break;
+        }
+      }
+
+      if(duplicated_flag == false) {
+        batch[batch_size++] = batch[i];
+      }
+    }
+
+    if(batch_size == 0UL) {
+      return 0UL;
+    }
+
+    const KeyValuePair *begin_p = batch.data();
+    const KeyValuePair *end_p = batch.data() + batch_size;
+
+    // Boundaries of ranges, moved to the first key of the next leaf
+    std::vector<const KeyValuePair *> boundary_list{begin_p};
+    const size_t range_num = \
+      std::min(static_cast<size_t>(thread_num), batch_size);
+    for(size_t i = 1;i < range_num;i++) {
+      const KeyValuePair *boundary_p = \
+        std::max(begin_p + i * batch_size / range_num, boundary_list.back());
+      if(boundary_p == end_p) {
+        break;
+      }
+
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
+
+      Context context{boundary_p->first};
+      Traverse(&context, nullptr, nullptr);
+      const KeyNodeIDPair high_key_pair = \
+        GetLatestNodeSnapshot(&context)->node_p->GetHighKeyPair();
+
+      epoch_manager.LeaveEpoch(epoch_node_p);
+
+      if(high_key_pair.second == INVALID_NODE_ID) {
+        break;
+      }
+
+      boundary_p = std::lower_bound(boundary_p,
+                                    end_p,
+                                    std::make_pair(high_key_pair.first,
+                                                   ValueType{}),
+                                    key_value_pair_cmp_obj);
+      if(boundary_p == end_p) {
+        break;
+      }
+
+      boundary_list.push_back(boundary_p);
+    }
+
+    boundary_list.push_back(end_p);
+
+    std::atomic<size_t> inserted_count{0UL};
+    auto insert_range = [&](size_t range_id) {
+      inserted_count.fetch_add(InsertBatchRange(boundary_list[range_id],
+                                                boundary_list[range_id + 1]));
+    };
+
+    if(boundary_list.size() == 2UL) {
+      insert_range(0);
+    } else {
+      std::vector<std::thread> thread_list{};
+      for(size_t i = 0;i + 1 < boundary_list.size();i++) {
+        thread_list.emplace_back([&insert_range, i]() {
+          BwTreeBase::RegisterThread();
+          insert_range(i);
+        });
+      }
+
+      for(std::thread &thread : thread_list) {
+        thread.join();
+      }
+    }
+
+    AddStatistics(&ThreadStatistics::item_insert_count, inserted_count.load());
+
+    return inserted_count.load();
   }
 
   /*
-   * IsOnLeftMostChild() - Returns true if latest node snapshot represents
-   *                       the leftmost child in its parent
-   *
-   * This is done by checking whether the NodeID of the current node is
-   * the same as the NodeID associated with the low key of its parent node
+   * InsertBatchRange() - Inserts a sorted range of pairs without duplicates
+   *                      leaf by leaf
    *
-   * NOTE: This function could only be called on a non-root node
-   * since root node does not have any parent node
+   * Each iteration locates the leaf of the first pair not yet inserted, and
+   * inserts all following pairs in the range of the leaf. Returns the number
+   * of pairs inserted
    */
-  inline bool IsOnLeftMostChild(Context *context_p) {
-    assert(context_p->current_level >= 1);
+  size_t InsertBatchRange(const KeyValuePair *begin_p,
+                          const KeyValuePair *end_p) {
+    size_t inserted_count = 0UL;
 
-    return GetLatestParentNodeSnapshot(context_p)->node_p->GetLowKeyNodeID() == \
-           GetLatestNodeSnapshot(context_p)->node_id;
+    while(begin_p != end_p) {
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
+
+      Context context{begin_p->first};
+      Traverse(&context, nullptr, nullptr);
+
+      const KeyValuePair *next_p = \
+        InsertBatchLeaf(GetLatestNodeSnapshot(&context),
+                        begin_p,
+                        end_p,
+                        &inserted_count);
+
+      epoch_manager.LeaveEpoch(epoch_node_p);
+
+      // Pairs that are skipped as duplicates are also invalidated
+      if(read_cache_p != nullptr) {
+        for(const KeyValuePair *kvp_p = begin_p;kvp_p != next_p;kvp_p++) {
+          read_cache_p->Invalidate(kvp_p->first);
+        }
+      }
+
+      // Retry with the same pair if the CAS fails
+      begin_p = next_p;
+    }
+
+    return inserted_count;
   }
 
   /*
-   * JumpToLeftSibling() - Jump to the left sibling given a node
+   * InsertBatchLeaf() - Merges pairs into a leaf and installs it as a new
+   *                     base node
    *
-   * When this function is called, we assume path_list_p includes the
-   * NodeSnapshot object for the current node being inspected, since
-   * we want to pass the information of whether the current node is
-   * the left most child.
+   * Pairs are taken from begin_p while they are in the range of the leaf,
+   * until the merged node reaches the split threshold. Then the node is
+   * split by the next traversal in the same way as with normal inserts,
+   * instead of growing into a huge leaf when a large range is loaded.
    *
-   * This function uses the fact that the mapping relationship between NodeID
-   * and low key does not change during the lifetime of the NodeID. This way,
-   * after we have fixed a snapshot of the current node, even though the node
-   * could keep changing, using the information given in the snapshot
-   * we could know at least a starting point for us to traverse right until
-   * we see a node whose high key equals the low key we are searching for,
-   * or whose range covers the low key (in the latter case, we know the
-   * merge delta has already been posted)
+   * If there are only a few pairs for the leaf and its delta chain is short,
+   * they are posted as a LeafBatchInsertNode instead (see
+   * InsertBatchDelta()), which avoids copying the whole leaf
    *
-   * NOTE: This function might abort. Please check context and make proper
-   * decisions
+   * Returns the first pair not inserted, which is begin_p if the CAS fails.
+   * The number of pairs actually inserted is added to *inserted_count_p
    */
-  void JumpToLeftSibling(Context *context_p) {
-    bwt_printf("Jumping to the left sibling\n");
+  const KeyValuePair *InsertBatchLeaf(NodeSnapshot *snapshot_p,
+                                      const KeyValuePair *begin_p,
+                                      const KeyValuePair *end_p,
+                                      size_t *inserted_count_p) {
+    assert(snapshot_p->IsLeaf() == true);
 
-    assert(context_p->HasParentNode());
+    const BaseNode *node_p = snapshot_p->node_p;
 
-    // Get last record which is the current node's context
-    // and we must make sure the current node is not left mode node
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    const KeyNodeIDPair &high_key_pair = node_p->GetHighKeyPair();
+    if(high_key_pair.second != INVALID_NODE_ID) {
+      end_p = std::lower_bound(begin_p,
+                               end_p,
+                               std::make_pair(high_key_pair.first,
+                                              ValueType{}),
+                               key_value_pair_cmp_obj);
+    }
 
-    // Check currently we are on a remove node
-    assert(snapshot_p->node_p->IsRemoveNode());
+    if((end_p - begin_p <= LEAF_BATCH_INSERT_NODE_CAPACITY) && \
+       (node_p->GetDepth() + 1 < TuningPolicy::LEAF_DELTA_CHAIN_THRESHOLD)) {
+      return InsertBatchDelta(snapshot_p, begin_p, end_p, inserted_count_p);
+    }
 
-    // This is not necessarily true. e.g. if the parent node was merged into
-    // its left sibling before we take the snapshot of its previou left child
-    // then this no longer holds
-    if(IsOnLeftMostChild(context_p)) {
-      bwt_printf("Observed a remove node on left most child.\n"
-                 "  Parent node must have been merged. ABORT\n");
+    LeafNode *leaf_node_p = CollectAllValuesOnLeaf(snapshot_p);
 
-      context_p->abort_flag = true;
+    // At least one pair is inserted such that we always make progress
+    const int max_pair_num = \
+      std::max(leaf_node_size_upper_threshold - leaf_node_p->GetSize(), 1);
+    end_p = std::min(end_p, begin_p + max_pair_num);
+
+    // Merge existing pairs and new pairs by key. Existing values of a key
+    // go first and are used to dedup new values of the same key. Existing
+    // pairs are moved out of the private consolidated leaf
+    std::vector<KeyValuePair> item_list{};
+    item_list.reserve(leaf_node_p->GetSize() + (end_p - begin_p));
+
+    KeyValuePair *kvp_p = leaf_node_p->Begin();
+    KeyValuePair *kvp_end_p = leaf_node_p->End();
+    size_t new_pair_num = 0UL;
+    for(const KeyValuePair *batch_p = begin_p;batch_p != end_p;batch_p++) {
+      while(kvp_p != kvp_end_p && \
+            KeyCmpLessEqual(kvp_p->first, batch_p->first) == true) {
+        item_list.push_back(std::move(*kvp_p));
+        kvp_p++;
+      }
 
-      return;
+      bool duplicated_flag = false;
+      for(auto it = item_list.rbegin();it != item_list.rend();it++) {
+        if(KeyCmpEqual(it->first, batch_p->first) == false) {
+          break;
+        }
+
+        if(UniqueKey == true || \
+           key_value_pair_eq_obj(*it, *batch_p) == true) {
+          duplicated_flag = true;
+
+          break;
+        }
+      }
+
+      if(duplicated_flag == false) {
+        item_list.push_back(*batch_p);
+        new_pair_num++;
+      }
     }
 
-    // After here we know we are not on a left most child of the parent
-    // InnerNode, and thus the low key is a valid key
+    item_list.insert(item_list.end(),
+                     std::make_move_iterator(kvp_p),
+                     std::make_move_iterator(kvp_end_p));
 
-    // We use this to test whether we have found the real
-    // left sibling whose next node id equals this one
-    const NodeID removed_node_id = snapshot_p->node_id;
+    leaf_node_p->~LeafNode();
+    leaf_node_p->Destroy();
 
-    // After this point snapshot_p could be overwritten
+    // Nothing to insert; the leaf is left as it is
+    if(new_pair_num == 0UL) {
+      return end_p;
+    }
 
-    // Get its parent node
-    NodeSnapshot *parent_snapshot_p = GetLatestParentNodeSnapshot(context_p);
-    assert(parent_snapshot_p->IsLeaf() == false);
-    
-    // If the parent has changed then abort
-    // This is to avoid missing InnerInsertNode which is fatal in our case
-    // because we could not find the item that actually is on the parent node
-    //
-    // Or we might traverse right on the child (i.e. there was a split and
-    // the split was consolidated), which means also that we
-    // could not find a sep item on the parent node
-    if(parent_snapshot_p->node_p != GetNode(parent_snapshot_p->node_id)) {
-      bwt_printf("Inconsistent parent node snapshot and "
-                 "current parent node. ABORT\n");
-      
-      context_p->abort_flag = true;
-      
-      return;
+    int item_count = static_cast<int>(item_list.size());
+    LeafNode *new_leaf_node_p = \
+      reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
+        Get(item_count,
+            NodeType::LeafType,
+            0,
+            item_count,
+            node_p->GetLowKeyPair(),
+            node_p->GetHighKeyPair()));
+
+    new_leaf_node_p->MoveBack(item_list.data(),
+                              item_list.data() + item_count);
+
+    new_leaf_node_p->SetPreviousVersion(node_p, GetCurrentVersion());
+
+    bool ret = InstallNodeToReplace(snapshot_p->node_id,
+                                    new_leaf_node_p,
+                                    node_p);
+    if(ret == false) {
+      bwt_printf("Leaf batch insert CAS failed\n");
+
+      AddStatistics(&ThreadStatistics::insert_abort_count);
+
+      new_leaf_node_p->~LeafNode();
+      new_leaf_node_p->Destroy();
+
+      return begin_p;
     }
 
-    NodeID left_sibling_id = FindLeftSibling(snapshot_p->node_p->GetLowKey(),
-                                             parent_snapshot_p);
+    RecordInstalledNode(new_leaf_node_p);
+
+    epoch_manager.AddGarbageNode(node_p);
+
+    *inserted_count_p += new_pair_num;
+
+    return end_p;
+  }
+
+  /*
+   * InsertBatchDelta() - Posts pairs in the range of a leaf as a single
+   *                      LeafBatchInsertNode
+   *
+   * Pairs already on the leaf are skipped, and the position of every other
+   * pair on the base node is found in the same way as Insert() does. The
+   * batch node is allocated from the chunk of the base node like any other
+   * delta node.
+   *
+   * Returns end_p, or begin_p if the CAS fails
+   */
+  const KeyValuePair *InsertBatchDelta(NodeSnapshot *snapshot_p,
+                                       const KeyValuePair *begin_p,
+                                       const KeyValuePair *end_p,
+                                       size_t *inserted_count_p) {
+    assert(end_p - begin_p <= LEAF_BATCH_INSERT_NODE_CAPACITY);
+
+    const BaseNode *node_p = snapshot_p->node_p;
 
-    // This might incur recursive update
-    // We need to pass in the low key of left sibling node
-    JumpToNodeID(left_sibling_id, context_p);
+    const KeyValuePair *insert_item_list[LEAF_BATCH_INSERT_NODE_CAPACITY];
+    size_t key_hash_list[LEAF_BATCH_INSERT_NODE_CAPACITY];
+    std::pair<int, bool> index_pair_list[LEAF_BATCH_INSERT_NODE_CAPACITY];
+    int insert_num = 0;
 
-    if(context_p->abort_flag == true) {
-      bwt_printf("JumpToLeftSibling()'s call to JumpToNodeID() ABORT\n")
+    for(const KeyValuePair *kvp_p = begin_p;kvp_p != end_p;kvp_p++) {
+      const KeyValuePair *item_p = nullptr;
+      size_t key_hash = GetKeyHash(kvp_p->first);
 
-      return;
+      if(UniqueKey == true) {
+        item_p = NavigateLeafDeltaChainUnique(node_p,
+                                              kvp_p->first,
+                                              key_hash,
+                                              &index_pair_list[insert_num]);
+      } else {
+        item_p = NavigateLeafDeltaChain(node_p,
+                                        kvp_p->first,
+                                        key_hash,
+                                        kvp_p->second,
+                                        &index_pair_list[insert_num]);
+      }
+
+      if(item_p == nullptr) {
+        insert_item_list[insert_num] = kvp_p;
+        key_hash_list[insert_num] = key_hash;
+        insert_num++;
+      }
     }
 
-    // Read the potentially redirected snapshot
-    // (but do not pop it - so we directly return)
-    snapshot_p = GetLatestNodeSnapshot(context_p);
+    if(insert_num == 0) {
+      return end_p;
+    }
 
-    // If the next node ID stored inside the "left sibling" does
-    // not equal the removed node, then we know we have got to the
-    // wrong left sibling, maybe because the parent node has changed
-    // or because its left sibling has splited
-    // In the latter case simply aborting seems to be a bad idea
-    // but if it is the second case then aborting is beneficial
-    if(removed_node_id != snapshot_p->node_p->GetNextNodeID()) {
-      bwt_printf("Left sibling's next node ID does not match removed NodeID."
-                 " ABORT\n");
+    LeafBatchInsertNode *batch_node_p = \
+      new (ElasticNode<KeyValuePair>::InlineAllocate(
+             &node_p->GetLowKeyPair(),
+             LeafBatchInsertNode::GetAllocationSize(insert_num),
+             &node_memory_size)) \
+        LeafBatchInsertNode{node_p, insert_num, GetCurrentVersion()};
+
+    for(int i = 0;i < insert_num;i++) {
+      new (batch_node_p->Begin() + i) \
+        LeafInsertNode{insert_item_list[i]->first,
+                       key_hash_list[i],
+                       insert_item_list[i]->second,
+                       node_p,
+                       index_pair_list[i],
+                       batch_node_p->version};
+    }
 
-      context_p->abort_flag = true;
+    bool ret = InstallNodeToReplace(snapshot_p->node_id,
+                                    batch_node_p,
+                                    node_p);
+    if(ret == false) {
+      bwt_printf("Leaf batch insert delta CAS failed\n");
 
-      return;
+      AddStatistics(&ThreadStatistics::insert_abort_count);
+
+      batch_node_p->~LeafBatchInsertNode();
+
+      return begin_p;
     }
 
-    return;
+    *inserted_count_p += static_cast<size_t>(insert_num);
+
+    return end_p;
   }
 
   /*
-   * TakeNodeSnapshot() - Take the snapshot of a node by pushing node information
+   * class CheckpointHeader - The header at the beginning of a checkpoint file
    *
-   * This function simply copies NodeID, and physical pointer into
-   * the snapshot object. Node that the snapshot object itself is directly
-   * constructed on the path list which is a vector. This avoids copying the
-   * NodeSnapshot object from the stack to vector
+   * A checkpoint file consists of this header, data pages and a page table
+   * at the end of the file. Each data page is an array of key value pairs
+   * stored as they are in memory, and the page table lists (offset, item
+   * count) of all pages in key order. Pages are appended by writers in the
+   * order their space is reserved, so pages of different writers interleave
+   * in the file, and only the page table tells the key order
    */
-  void TakeNodeSnapshot(NodeID node_id,
-                        Context *context_p) {
-    const BaseNode *node_p = GetNode(node_id);
+  class CheckpointHeader {
+   public:
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
 
-    bwt_printf("Is leaf node? - %d\n", node_p->IsOnLeafDeltaChain());
+    // These guard against restoring with a different type
+    uint32_t key_size;
+    uint32_t value_size;
 
-    #ifdef BWTREE_DEBUG
-    
-    // This is used to record how many levels we have traversed
-    context_p->current_level++;
-    
-    #endif
+    uint64_t item_count;
+    uint64_t page_num;
+    uint64_t page_table_offset;
+  };
 
-    // Copy assignment
-    // NOTE: For root node, the parent node contains garbage
-    // but current node ID is INVALID_NODE_ID
-    // So after this line parent node ID is INVALID_NODE_ID
-    context_p->parent_snapshot = context_p->current_snapshot;
+  /*
+   * class CheckpointPage - Page table entry of a checkpoint file
+   */
+  class CheckpointPage {
+   public:
+    uint64_t offset;
+    uint64_t item_count;
+  };
 
-    context_p->current_snapshot.node_p = node_p;
-    context_p->current_snapshot.node_id = node_id;
+  // "BWTCKPT" followed by a zero byte
+  static constexpr uint64_t CHECKPOINT_MAGIC = 0x0054504B43545742UL;
+  static constexpr uint32_t CHECKPOINT_VERSION = 1;
 
-    return;
-  }
+  // Writers buffer pairs up to this size before writing a page. Pages start
+  // at offsets aligned to CHECKPOINT_PAGE_ALIGNMENT such that they could be
+  // accessed in place after the file is mapped
+  static constexpr size_t CHECKPOINT_PAGE_SIZE = ((size_t)1) << 20;
+  static constexpr size_t CHECKPOINT_PAGE_ALIGNMENT = CACHE_LINE_SIZE;
 
   /*
-   * UpdateNodeSnapshot() - Update an existing node snapshot
-   *
-   * This function does not create and push new NodeSnapshot object into the
-   * stack; instead it modifies existing NodeSnapshot object on top of the
-   * path stack, using the given NodeID and low key
-   *
-   * NOTE: The left most child flag will be ignored because in current
-   * design when this is called we always go within the same parent node
-   *
-   * NOTE 2: If right traversal cross parent node boundary then NOTE 1
-   * is no longer true
+   * class CheckpointIterator - Forward iterator over pairs of a mapped
+   *                            checkpoint file
    *
-   * NOTE 3: Since we always traverse on the same level, the leaf/inner identity
-   * does not change
-   *
-   * NOTE 4: We need to clear all cached data and metadata inside the logical
-   * node since it is not changed to another NodeID
-   *
-   * NOTE 5: IF NODE ID DOES NOT CHANGE, DO NOT CALL THIS FUNCTION
-   * SINCE THIS FUNCTION RESETS ROOT IDENTITY
-   * Call SwitchPhysicalPointer() instead
+   * This walks pages in the order of the page table, and is used to feed
+   * BulkLoad() directly from the mapping
    */
-  void UpdateNodeSnapshot(NodeID node_id,
-                          Context *context_p) {
-    const BaseNode *node_p = GetNode(node_id);
+  class CheckpointIterator {
+   public:
+    const char *base_p;
+    const CheckpointPage *page_p;
+    uint64_t index;
+
+    CheckpointIterator(const char *p_base_p,
+                       const CheckpointPage *p_page_p) :
+      base_p{p_base_p},
+      page_p{p_page_p},
+      index{0UL}
+    {}
 
-    // We operate on the latest snapshot instead of creating a new one
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+    inline const KeyValuePair &operator*() const {
+      return reinterpret_cast<const KeyValuePair *>(
+        base_p + page_p->offset)[index];
+    }
 
-    // Assume we always use this function to traverse on the same
-    // level
-    assert(node_p->IsOnLeafDeltaChain() == snapshot_p->IsLeaf());
+    inline const KeyValuePair *operator->() const {
+      return &**this;
+    }
 
-    // Make sure we are not switching to itself
-    assert(snapshot_p->node_id != node_id);
+    /*
+     * operator++ - Moves to the next pair, and to the next page if the
+     *              current page is drained
+     *
+     * Pages are never empty, so we always stop at a valid pair or the end
+     */
+    inline CheckpointIterator &operator++() {
+      index++;
+      if(index == page_p->item_count) {
+        page_p++;
+        index = 0UL;
+      }
 
-    snapshot_p->node_id = node_id;
-    snapshot_p->node_p = node_p;
+      return *this;
+    }
 
-    return;
-  }
+    inline CheckpointIterator operator++(int) {
+      CheckpointIterator temp = *this;
+      ++*this;
+
+      return temp;
+    }
+
+    inline bool operator==(const CheckpointIterator &other) const {
+      return page_p == other.page_p && index == other.index;
+    }
+
+    inline bool operator!=(const CheckpointIterator &other) const {
+      return !(*this == other);
+    }
+  };
 
   /*
-   * LoadNodeID() - Push a new snapshot for the node pointed to by node_id
-   *
-   * If we just want to modify existing snapshot object in the stack, we should
-   * call JumpToNodeID() instead
-   *
-   * Note that there is currently no flag indicating whether the current node
-   * being load is a leaf node or leftmost node or a root node. To check for
-   * attributes mentioned above:
+   * Compact() - Consolidates and merges under-full nodes covering a key
+   *             range in one pass
    *
-   * (1) Call IsOnLeafDeltaChain() to determine whether we are on leaf node
-   *     This call is lightweight and only requires an integer comparison
+   * Leaf nodes that intersect [low_key, high_key] are visited one by one by
+   * following the high key of the previous leaf. These traversals
+   * consolidate every delta chain on the path, and merge leaf and inner
+   * nodes with fewer items than half of the upper threshold into their
+   * left sibling (see GetMergeThreshold()), so a run of near-empty leaves
+   * left behind by a mass delete collapses into the leftmost one, and their
+   * parents shrink in the same way as they are traversed.
    *
-   * (2) Check current node id with parent node's low key node id. If they
-   *     match then we are on a left most child of the parent node
-   *     (but that is only a strong hint; if the parent node is merged after
-   *     being taken a snapshot then we will get a false positive, though it
-   *     does not affect correctness)
+   * Returns the bytes of nodes unlinked by the pass minus the bytes of
+   * nodes it allocated, which are returned to the allocator once no
+   * thread could be reading them. SMOs helped along for other threads are
+   * not counted
    *
-   * (3) Check current_level == 0 to determine whether we are on a root node
+   * NOTE: The tree could be modified concurrently. Leftmost children are
+   * never merged, and neither is the root, so a second pass could compact
+   * further after parents have been merged in the first one
    */
-  void LoadNodeID(NodeID node_id, Context *context_p) {
-    bwt_printf("Loading NodeID = %lu\n", node_id);
+  size_t Compact(const KeyType &low_key, const KeyType &high_key) {
+    bwt_printf("Compact()\n");
 
-    // This pushes a new snapshot into stack
-    TakeNodeSnapshot(node_id, context_p);
+    int64_t freed_size = 0;
+    KeyType current_key = low_key;
 
-    // If there are SMO (split; merge) that require much computation to
-    // deal with (e.g. go to its parent and comsolidate parent first) then
-    // we should aggressively comsolidate the SMO away to avoid further
-    // access
-    FinishPartialSMO(context_p);
+    while(1) {
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    if(context_p->abort_flag == true) {
-      return;
-    }
+      Context context{current_key};
+      context.compact_flag = true;
 
-    // This does not abort
-    TryConsolidateNode(context_p);
+      Traverse(&context, nullptr, nullptr);
 
-    AdjustNodeSize(context_p);
+      freed_size += context.compact_freed_size;
 
-    // Do not have to check for abort here because anyway we will return
+      const KeyNodeIDPair next_key_pair = \
+        GetLatestNodeSnapshot(&context)->node_p->GetHighKeyPair();
 
-    return;
+      epoch_manager.LeaveEpoch(epoch_node_p);
+
+      // Stop after the last leaf, or the leaf containing the high key
+      if((next_key_pair.second == INVALID_NODE_ID) || \
+         (KeyCmpGreater(next_key_pair.first, high_key) == true)) {
+        break;
+      }
+
+      current_key = next_key_pair.first;
+    }
+
+    return freed_size > 0 ? static_cast<size_t>(freed_size) : 0UL;
   }
 
   /*
-   * JumpToNodeID() - Given a NodeID, change the top of the path list
-   *                  by loading the delta chain of the node ID
+   * CompressColdLeaves() - Compresses leaf nodes covering a key range that
+   *                        have not been modified for a number of epochs
    *
-   * NOTE: This function could also be called to traverse right, in which case
-   * we need to check whether the target node is the left most child
+   * Leaf nodes that intersect [low_key, high_key] are visited in the same
+   * way as Compact() but with read-optimized traversals. A leaf is replaced
+   * by a CompressedLeafNode if it has been a LeafNode without any delta
+   * record since a call cold_epoch_num epochs earlier; the first call that
+   * sees a leaf starts counting, and with cold_epoch_num == 0 leaves are
+   * compressed right away. Leaves are usually consolidated by Compact()
+   * before, otherwise they are skipped until the next consolidation.
+   *
+   * Point lookups, iterators, RangeScan() and Checkpoint() decode compressed
+   * leaves without changing them. The first traversal that might modify the
+   * leaf expands it back into a LeafNode.
+   *
+   * Returns the bytes of leaf nodes replaced minus those of compressed
+   * nodes, which are returned to the allocator once no thread could be
+   * reading them
+   *
+   * NOTE: Only trees with integral key and value types could be compressed
    */
-  void JumpToNodeID(NodeID node_id, Context *context_p) {
-    bwt_printf("Jumping to node ID = %lu\n", node_id);
-
-    // This updates the current snapshot in the stack
-    UpdateNodeSnapshot(node_id, context_p);
-
-    FinishPartialSMO(context_p);
+  size_t CompressColdLeaves(const KeyType &low_key,
+                            const KeyType &high_key,
+                            uint64_t cold_epoch_num) {
+    static_assert(LEAF_COMPRESSION_SUPPORTED,
+                  "Leaf compression requires integral key and value");
+    bwt_printf("CompressColdLeaves()\n");
 
-    if(context_p->abort_flag == true) {
-      return;
-    }
+    int64_t freed_size = 0;
+    KeyType current_key = low_key;
 
-    // This does not abort
-    TryConsolidateNode(context_p);
+    // Used to encode all leaves
+    std::vector<unsigned char> buffer{};
 
-    AdjustNodeSize(context_p);
+    while(1) {
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    // Do not have to check for abort here because anyway we will return
+      Context context{current_key};
 
-    return;
-  }
+      TraverseReadOptimized(&context, [](const ValueType &) {});
 
-  ///////////////////////////////////////////////////////////////////
-  // Read-Optimized functions
-  ///////////////////////////////////////////////////////////////////
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
 
-  /*
-   * FinishPartialSMOReadOptimized() - Read optimized version of
-   *                                   FinishPartialSMO()
-   *
-   * This function only delas with remove delta and abort node
-   */
-  inline void FinishPartialSMOReadOptimized(Context *context_p) {
-    // Note: If the top of the path list changes then this pointer
-    // must also be updated
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+      freed_size += TryCompressLeafNode(snapshot_p, cold_epoch_num, &buffer);
 
-before_switch:
-    switch(snapshot_p->node_p->GetType()) {
-      case NodeType::InnerAbortType: {
-        bwt_printf("Observed Inner Abort Node; Continue\n");
+      const KeyNodeIDPair next_key_pair = \
+        snapshot_p->node_p->GetHighKeyPair();
 
-        snapshot_p->node_p = \
-          (static_cast<const DeltaNode *>(snapshot_p->node_p))->child_node_p;
+      epoch_manager.LeaveEpoch(epoch_node_p);
 
-        goto before_switch;
-      }
-      case NodeType::LeafRemoveType:
-      case NodeType::InnerRemoveType: {
-        bwt_printf("Observed remove node; abort\n");
-        
-        // Since remove node is just a temporary measure, and if
-        // a thread proceeds to do its own job it must finish the remove
-        // SMO, posting InnerDeleteNode on the parent
-        context_p->abort_flag = true;
-        
-        return;
-      } // case Inner/LeafRemoveType
-      default: {
-        return;
+      // Stop after the last leaf, or the leaf containing the high key
+      if((next_key_pair.second == INVALID_NODE_ID) || \
+         (KeyCmpGreater(next_key_pair.first, high_key) == true)) {
+        break;
       }
-    } // switch
 
-    assert(false);
-    return;
+      current_key = next_key_pair.first;
+    }
+
+    return freed_size > 0 ? static_cast<size_t>(freed_size) : 0UL;
   }
-  
+
   /*
-   * TakeNodeSnapshotReadOptimized() - Take node snapshot without saving
-   *                                   parent node
+   * Checkpoint() - Writes all key value pairs of the tree into a file
    *
-   * This implies that if there is remove delta on the path then
-   * the read thread will have to spin and wait. But finally it will
-   * complete the job since remove delta will not be present if the thread
-   * posting the remove delta finally proceeds to finish its job
+   * Leaf nodes are consolidated one by one by following the high key of the
+   * previous leaf, in the same way as the iterator, and pairs are written as
+   * sorted pages (see class CheckpointHeader). Key space is partitioned
+   * into at most thread_num disjoint ranges using separators of the root
+   * node, and each range is written by its own thread with pwrite() into
+   * space reserved by an atomic counter, so writers never wait for each
+   * other. The page table and the header are written last.
+   *
+   * Returns false if the file could not be created or written, in which
+   * case the content of the file is undefined
+   *
+   * NOTE: The tree could be modified while being checkpointed, but then
+   * the checkpoint is only consistent on a per-leaf basis. Key and value
+   * types must be trivially copyable
+   *
+   * NOTE 2: If thread_num > 1 then writer threads are registered with
+   * RegisterThread(), and the calling thread only waits for them
    */
-  inline void TakeNodeSnapshotReadOptimized(NodeID node_id,
-                                            Context *context_p) {
-    const BaseNode *node_p = GetNode(node_id);
+  bool Checkpoint(const std::string &path, int thread_num = 1) {
+    static_assert(std::is_trivially_copyable<KeyType>::value && \
+                  std::is_trivially_copyable<ValueType>::value,
+                  "Checkpoint requires trivially copyable key and value");
+    bwt_printf("Checkpoint()\n");
 
-    bwt_printf("Is leaf node (RO)? - %d\n", node_p->IsOnLeafDeltaChain());
+    assert(thread_num > 0);
 
-    #ifdef BWTREE_DEBUG
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if(fd < 0) {
+      return false;
+    }
 
-    // This is used to record how many levels we have traversed
-    context_p->current_level++;
+    // Split points of the key space which are all separators of the root
+    std::vector<KeyType> split_key_list{};
+    if(thread_num > 1) {
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    #endif
+      NodeID root_node_id = root_id.load();
+      NodeSnapshot snapshot{root_node_id, GetNode(root_node_id)};
+      InnerNode *root_node_p = CollectAllSepsOnInner(&snapshot);
 
-    context_p->current_snapshot.node_p = node_p;
-    
-    // DO NOT REMOVE THIS!
-    // REMOVING THIS WOULD CAUSE ASSERTION FAILURE WHEN JUMPING
-    // TO RIGHT SIBLING SINCEI IT CHECKS NODE ID
-    context_p->current_snapshot.node_id = node_id;
+      epoch_manager.LeaveEpoch(epoch_node_p);
+
+      // The first separator is the low key of the root which is -Inf
+      const size_t sep_num = static_cast<size_t>(root_node_p->GetSize());
+      const size_t range_num = \
+        std::min(static_cast<size_t>(thread_num), sep_num);
+      for(size_t i = 1;i < range_num;i++) {
+        split_key_list.push_back(
+          root_node_p->At(static_cast<int>(i * sep_num / range_num)).first);
+      }
 
-    return;
-  }
+      root_node_p->~InnerNode();
+      root_node_p->Destroy();
+    }
 
-  /*
-   * LoadNodeIDReadOptimized() - Read optimized version of LoadNodeID()
-   *
-   * This only SMO that a read only thread cares about is remove delta,
-   * since it has to jump to the left sibling in order to keep traversing
-   * down. However, jumping to left sibling has the possibility to fail
-   * so we still need to check abort flag after this function returns
-   */
-  inline void LoadNodeIDReadOptimized(NodeID node_id, Context *context_p) {
-    bwt_printf("Loading NodeID (RO) = %lu\n", node_id);
+    const size_t range_num = split_key_list.size() + 1;
+
+    // Pages are written after the header
+    std::atomic<uint64_t> file_offset{
+      (sizeof(CheckpointHeader) + CHECKPOINT_PAGE_ALIGNMENT - 1) & \
+      ~(CHECKPOINT_PAGE_ALIGNMENT - 1)};
+    std::vector<std::vector<CheckpointPage>> page_list_list(range_num);
+    std::atomic<bool> ok_flag{true};
+
+    auto write_range = [&](size_t range_id) {
+      bool ret = \
+        CheckpointRange(fd,
+                        range_id == 0 ? nullptr : &split_key_list[range_id - 1],
+                        range_id == range_num - 1 ? \
+                          nullptr : &split_key_list[range_id],
+                        &file_offset,
+                        &page_list_list[range_id]);
+      if(ret == false) {
+        ok_flag.store(false);
+      }
+    };
 
-    // This pushes a new snapshot into stack
-    TakeNodeSnapshotReadOptimized(node_id, context_p);
+    if(range_num == 1) {
+      write_range(0);
+    } else {
+      std::vector<std::thread> thread_list{};
+      for(size_t i = 0;i < range_num;i++) {
+        thread_list.emplace_back([&write_range, i]() {
+          BwTreeBase::RegisterThread();
+          write_range(i);
+        });
+      }
 
-    FinishPartialSMOReadOptimized(context_p);
+      for(std::thread &thread : thread_list) {
+        thread.join();
+      }
+    }
 
-    // Do not need to check for abort flag here
+    // Concatenate pages of all ranges which are already in key order
+    std::vector<CheckpointPage> page_list{};
+    CheckpointHeader header{};
+    for(const std::vector<CheckpointPage> &range_page_list : page_list_list) {
+      for(const CheckpointPage &page : range_page_list) {
+        page_list.push_back(page);
+        header.item_count += page.item_count;
+      }
+    }
 
-    return;
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.header_size = static_cast<uint32_t>(sizeof(CheckpointHeader));
+    header.key_size = static_cast<uint32_t>(sizeof(KeyType));
+    header.value_size = static_cast<uint32_t>(sizeof(ValueType));
+    header.page_num = page_list.size();
+    header.page_table_offset = file_offset.load();
+
+    if(ok_flag.load() == true) {
+      ok_flag.store(
+        CheckpointWrite(fd,
+                        page_list.data(),
+                        page_list.size() * sizeof(CheckpointPage),
+                        header.page_table_offset) && \
+        CheckpointWrite(fd, &header, sizeof(header), 0UL) && \
+        fsync(fd) == 0);
+    }
+
+    close(fd);
+
+    return ok_flag.load();
   }
 
   /*
-   * TraverseBI() - Read optimized traversal for backward iteration
+   * CheckpointRange() - Writes pairs whose keys are in [*low_key_p,
+   *                     *high_key_p) into a checkpoint file
    *
-   * This function calls NavigateInnerNodeBI() to find the node with a smaller
-   * key than search key
+   * nullptr means -Inf or +Inf respectively. Pages written are appended to
+   * the page list in key order. Returns false if a page could not be
+   * written
+   *
+   * NOTE: The leaf located with a key might have a smaller low key after
+   * a merge, so pairs less than the current key are skipped since they have
+   * been written with the previous leaf
    */
-  void TraverseBI(Context *context_p) {
-retry_traverse:
-    assert(context_p->abort_flag == false);
-    assert(context_p->current_level == -1);
-
-    NodeID start_node_id = root_id.load();
-    context_p->current_snapshot.node_id = INVALID_NODE_ID;
-    LoadNodeID(start_node_id, context_p);
-    if(context_p->abort_flag == true) {
-      goto abort_traverse;
-    }
+  bool CheckpointRange(int fd,
+                       const KeyType *low_key_p,
+                       const KeyType *high_key_p,
+                       std::atomic<uint64_t> *file_offset_p,
+                       std::vector<CheckpointPage> *page_list_p) {
+    const size_t page_item_num = CHECKPOINT_PAGE_SIZE / sizeof(KeyValuePair);
+
+    std::vector<KeyValuePair> buffer{};
+    buffer.reserve(page_item_num);
+
+    // Reserves space for the buffered pairs and writes them as a page
+    auto flush = [&]() {
+      const size_t size = buffer.size() * sizeof(KeyValuePair);
+      const uint64_t offset = file_offset_p->fetch_add(
+        (size + CHECKPOINT_PAGE_ALIGNMENT - 1) & \
+        ~(CHECKPOINT_PAGE_ALIGNMENT - 1));
+
+      page_list_p->push_back(CheckpointPage{offset, buffer.size()});
+      bool ret = CheckpointWrite(fd, buffer.data(), size, offset);
+      buffer.clear();
+
+      return ret;
+    };
 
-    bwt_printf("Successfully loading root node ID for BI\n");
+    bool has_key = (low_key_p != nullptr);
+    KeyType current_key = has_key ? *low_key_p : KeyType{};
 
     while(1) {
-      NodeID child_node_id = NavigateInnerNodeBI(context_p);
-      if(context_p->abort_flag == true) {
-        bwt_printf("Navigate Inner Node abort (BI). ABORT\n");
-        assert(child_node_id == INVALID_NODE_ID);
-        goto abort_traverse;
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
+
+      LeafNode *leaf_node_p = nullptr;
+      if(has_key == false) {
+        NodeID leaf_node_id = first_leaf_id.load();
+        NodeSnapshot snapshot{leaf_node_id, GetNode(leaf_node_id)};
+        leaf_node_p = CollectAllValuesOnLeaf(&snapshot);
+      } else {
+        Context context{current_key};
+        context.read_only_flag = true;
+        Traverse(&context, nullptr, nullptr);
+        leaf_node_p = CollectAllValuesOnLeaf(GetLatestNodeSnapshot(&context));
       }
 
-      LoadNodeID(child_node_id, context_p);
-      if(context_p->abort_flag == true) {
-        bwt_printf("LoadNodeID aborted (BI). ABORT\n");
-        goto abort_traverse;
+      epoch_manager.LeaveEpoch(epoch_node_p);
+
+      const KeyValuePair *start_p = leaf_node_p->Begin();
+      const KeyValuePair *end_p = leaf_node_p->End();
+      if(has_key == true) {
+        start_p = std::lower_bound(start_p,
+                                   end_p,
+                                   std::make_pair(current_key, ValueType{}),
+                                   key_value_pair_cmp_obj);
       }
 
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-      if(snapshot_p->IsLeaf() == true) {
-        bwt_printf("The next node is a leaf (BI)\n");
+      if(high_key_p != nullptr) {
+        end_p = std::lower_bound(start_p,
+                                 end_p,
+                                 std::make_pair(*high_key_p, ValueType{}),
+                                 key_value_pair_cmp_obj);
+      }
 
-        // After reaching leaf level just traverse the sibling chain
-        // and stop before the search key
-        NavigateSiblingChainBI(context_p);
-        if(context_p->abort_flag == true) {
-          bwt_printf("NavigateSiblingChainBI() inside TraverseBI() aborts\n");
+      bool ret = true;
+      for(const KeyValuePair *kvp_p = start_p;kvp_p != end_p;kvp_p++) {
+        buffer.push_back(*kvp_p);
 
-          goto abort_traverse;
+        if(buffer.size() == page_item_num) {
+          ret = ret && flush();
         }
-    
-        return;
       }
-    } //while(1)
 
-abort_traverse:
-    #ifdef BWTREE_DEBUG
-    assert(context_p->current_level >= 0);
-    context_p->current_level = -1;
-    context_p->abort_counter++;
-    #endif
-    
-    // This is used to identify root node
-    context_p->current_snapshot.node_id = INVALID_NODE_ID;
-    context_p->abort_flag = false;
-    goto retry_traverse;
+      const KeyNodeIDPair next_key_pair = leaf_node_p->GetHighKeyPair();
 
-    assert(false);
-    return;
-  }
-  
-  void TraverseReadOptimized(Context *context_p,
-                             std::vector<ValueType> *value_list_p) {
-retry_traverse:
-    assert(context_p->abort_flag == false);
-    assert(context_p->current_level == -1);
+      leaf_node_p->~LeafNode();
+      leaf_node_p->Destroy();
 
-    // This is the serialization point for reading/writing root node
-    NodeID child_node_id = root_id.load();
-    
-    LoadNodeIDReadOptimized(child_node_id, context_p);
+      if(ret == false) {
+        return false;
+      }
 
-    if(context_p->abort_flag == true) {
-      bwt_printf("LoadNodeID aborted on loading root (RO)\n");
+      // Stop after the last leaf, or the leaf containing the high key
+      if((next_key_pair.second == INVALID_NODE_ID) || \
+         (high_key_p != nullptr && \
+          KeyCmpLess(next_key_pair.first, *high_key_p) == false)) {
+        break;
+      }
 
-      goto abort_traverse;
+      current_key = next_key_pair.first;
+      has_key = true;
     }
-    
-    bwt_printf("Successfully loading root node ID (RO)\n");
-
-    while(1) {
-      child_node_id = NavigateInnerNode(context_p);
 
-      // Navigate could abort since it might go to another NodeID
-      // if there is a split delta and the key is >= split key
-      if(context_p->abort_flag == true) {
-        bwt_printf("Navigate Inner Node abort (RO)\n");
+    if(buffer.empty() == false) {
+      return flush();
+    }
 
-        // If NavigateInnerNode() aborts then it retrns INVALID_NODE_ID
-        // as a double check
-        // This is the only situation that this function returns
-        // INVALID_NODE_ID
-        assert(child_node_id == INVALID_NODE_ID);
+    return true;
+  }
 
-        goto abort_traverse;
+  /*
+   * CheckpointWrite() - Writes a buffer at an offset of a file
+   *
+   * pwrite() might write less than requested, so we loop until everything
+   * is written or an error occurs
+   */
+  static bool CheckpointWrite(int fd,
+                              const void *data_p,
+                              size_t size,
+                              uint64_t offset) {
+    const char *p = static_cast<const char *>(data_p);
+
+    while(size > 0UL) {
+      ssize_t ret = pwrite(fd, p, size, static_cast<off_t>(offset));
+      if(ret <= 0) {
+        return false;
       }
-      
-      // This might load a leaf child
-      // Also LoadNodeID() does not guarantee the node bound matches
-      // search key. Since we could readjust using the split side link
-      // during Navigate...Node(), or abort if we reach the bottom
-      // while still observing an inconsistent high key
-      // (low key is always consistent)
-      LoadNodeIDReadOptimized(child_node_id, context_p);
 
-      if(context_p->abort_flag == true) {
-        bwt_printf("LoadNodeID aborted (RO). ABORT\n");
+      p += ret;
+      size -= static_cast<size_t>(ret);
+      offset += static_cast<uint64_t>(ret);
+    }
 
-        goto abort_traverse;
-      }
+    return true;
+  }
 
-      // This is the node we have just loaded
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+  /*
+   * Restore() - Builds the tree from a checkpoint file
+   *
+   * The file is mapped read-only, and pairs are fed to BulkLoad() directly
+   * from the mapping without parsing or copying the file into a buffer.
+   * The mapping is released after the tree is built since nodes own copies
+   * of their pairs.
+   *
+   * Returns false if the file could not be read, or is not a checkpoint of
+   * the same version and key value sizes. The tree is not modified in this
+   * case
+   *
+   * NOTE: Same as BulkLoad(), this function must be called on an empty tree
+   * under single threaded environment
+   */
+  bool Restore(const std::string &path, double fill_factor = 0.75) {
+    bwt_printf("Restore()\n");
 
-      if(snapshot_p->IsLeaf() == true) {
-        bwt_printf("The next node is a leaf (RO)\n");
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+      return false;
+    }
 
-        NavigateLeafNode(context_p, *value_list_p);
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || \
+       static_cast<size_t>(file_stat.st_size) < sizeof(CheckpointHeader)) {
+      close(fd);
 
-        if(context_p->abort_flag == true) {
-          bwt_printf("NavigateLeafNode aborts (RO). ABORT\n");
+      return false;
+    }
 
-          goto abort_traverse;
-        }
+    const size_t file_size = static_cast<size_t>(file_stat.st_size);
+    void *map_p = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-        #ifdef BWTREE_DEBUG
-        
-        bwt_printf("Found leaf node (RO). Abort count = %d, level = %d\n",
-                   context_p->abort_counter,
-                   context_p->current_level);
+    // The mapping is still valid after the file is closed
+    close(fd);
+    if(map_p == MAP_FAILED) {
+      return false;
+    }
 
-        #endif
+    madvise(map_p, file_size, MADV_SEQUENTIAL);
 
-        // If there is no abort then we could safely return
-        return;
-      }
-      
-      // This does not work
-      //_mm_prefetch(&context_p->current_snapshot.node_p->GetLowKeyPair(), _MM_HINT_T0);
-    } // while(1)
+    const char *base_p = static_cast<const char *>(map_p);
+    const CheckpointHeader *header_p = \
+      reinterpret_cast<const CheckpointHeader *>(base_p);
 
-abort_traverse:
-    #ifdef BWTREE_DEBUG
-    
-    assert(context_p->current_level >= 0);
+    bool ret = (header_p->magic == CHECKPOINT_MAGIC) && \
+               (header_p->version == CHECKPOINT_VERSION) && \
+               (header_p->header_size == sizeof(CheckpointHeader)) && \
+               (header_p->key_size == sizeof(KeyType)) && \
+               (header_p->value_size == sizeof(ValueType)) && \
+               (header_p->page_table_offset <= file_size) && \
+               (header_p->page_num <= \
+                (file_size - header_p->page_table_offset) / \
+                  sizeof(CheckpointPage));
 
-    context_p->current_level = -1;
-    
-    context_p->abort_counter++;
-    
-    #endif
-    
-    context_p->current_snapshot.node_id = INVALID_NODE_ID;
+    if(ret == true) {
+      const CheckpointPage *page_table_p = \
+        reinterpret_cast<const CheckpointPage *>(
+          base_p + header_p->page_table_offset);
 
-    context_p->abort_flag = false;
+      // Every page must be within the file
+      for(uint64_t i = 0;i < header_p->page_num;i++) {
+        const CheckpointPage &page = page_table_p[i];
 
-    goto retry_traverse;
+        if((page.item_count == 0UL) || \
+           (page.offset > header_p->page_table_offset) || \
+           (page.item_count > (header_p->page_table_offset - page.offset) / \
+                                sizeof(KeyValuePair))) {
+          ret = false;
 
-    assert(false);
-    return;
-  }
+          break;
+        }
+      }
 
-  ///////////////////////////////////////////////////////////////////
-  ///////////////////////////////////////////////////////////////////
-  ///////////////////////////////////////////////////////////////////
+      if(ret == true) {
+        BulkLoad(CheckpointIterator{base_p, page_table_p},
+                 CheckpointIterator{base_p,
+                                    page_table_p + header_p->page_num},
+                 fill_factor);
+      }
+    }
+
+    munmap(map_p, file_size);
+
+    return ret;
+  }
 
   /*
-   * PostInnerInsertNode() - Posts an InnerInsertNode on the parent node
-   *
-   * This is used to finish the partial node split SMO as part of the help
-   * along protocol
+   * Insert() - Insert a key-value pair
    *
-   * NOTE: This function may abort
+   * This function returns false if value already exists
+   * If CAS fails this function retries until it succeeds
    */
-  inline bool PostInnerInsertNode(Context *context_p,
-                                  const KeyNodeIDPair &insert_item,
-                                  const KeyNodeIDPair &next_item,
-                                  const KeyNodeIDPair *location) {
-    // We post on the parent node, after which we check for size and decide whether
-    // to consolidate and/or split the node
-    NodeSnapshot *parent_snapshot_p = GetLatestParentNodeSnapshot(context_p);
+  bool Insert(const KeyType &key, const ValueType &value) {
+    bwt_printf("Insert called\n");
 
-    // Three arguments are: inserted key-node id pair
-    //                      next key-node id pair
-    //                      child node in delta chain
-    const InnerInsertNode *insert_node_p = \
-      InnerInlineAllocateOfType(InnerInsertNode,
-                                parent_snapshot_p->node_p,
-                                insert_item,
-                                next_item,
-                                parent_snapshot_p->node_p,
-                                location);
+    #ifdef BWTREE_DEBUG
+    insert_op_count.fetch_add(1);
+    #endif
 
-    // CAS Index Term Insert Delta onto the parent node
-    bool ret = InstallNodeToReplace(parent_snapshot_p->node_id,
-                                    insert_node_p,
-                                    parent_snapshot_p->node_p);
+    AddStatistics(&ThreadStatistics::insert_op_count);
 
-    if(ret == true) {
-      bwt_printf("Index term insert (from %lu to %lu) delta CAS succeeds\n",
-                 GetLatestNodeSnapshot(context_p)->node_id,
-                 insert_item.second);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-      // Update parent node pointer to reflect the fact that it has been
-      // updated
-      parent_snapshot_p->node_p = insert_node_p;
+    // The leaf of the last failed installation (see SetLeafRetryMode())
+    NodeID retry_node_id = INVALID_NODE_ID;
 
-      ConsolidateNode(GetLatestNodeSnapshot(context_p));
+    while(1) {
+      Context context{key};
+      std::pair<int, bool> index_pair;
 
-      return true;
-    } else {
-      bwt_printf("Index term insert (from %lu to %lu) delta CAS failed. "
-                 "ABORT\n",
-                 GetLatestNodeSnapshot(context_p)->node_id,
-                 insert_item.second);
+      // Check whether the key-value pair exists
+      // Also if the key previously exists in the delta chain
+      // then return the position of the node using next_key_p
+      // if there is none then return nullptr
+      const KeyValuePair *item_p = nullptr;
+
+      if(UniqueKey == true) {
+        // Any value of the key blocks the insert
+        TraverseWithFinger(&context, nullptr, nullptr, retry_node_id);
 
-      // Set abort, and remove the newly created node
-      context_p->abort_flag = true;
-      
-      // Call destructor but do not free memory
-      insert_node_p->~InnerInsertNode();
+        item_p = NavigateLeafNodeUnique(&context, &index_pair);
+      } else {
+        item_p = \
+          TraverseWithFinger(&context, &value, &index_pair, retry_node_id);
+      }
 
-      return false;
-    } // if CAS succeeds/fails
+      SampleLeafWrite(&context);
 
-    assert(false);
-    return false;
-  }
+      // If the key-value pair already exists then return false
+      if(item_p != nullptr) {
+        epoch_manager.LeaveEpoch(epoch_node_p);
 
-  /*
-   * PostInnerDeleteNode() - Posts an InnerDeleteNode on the current parent node
-   *
-   * This function is called to complete node merges as part of the SMO help-along
-   * protocol. It posts an InnerDeleteNode on the parent node and returns the result
-   * of CAS instruction
-   *
-   * NOTE: This function may abort
-   */
-  inline bool PostInnerDeleteNode(Context *context_p,
-                                  const KeyNodeIDPair &delete_item,
-                                  const KeyNodeIDPair &prev_item,
-                                  const KeyNodeIDPair &next_item,
-                                  const KeyNodeIDPair *location) {
-    NodeSnapshot *parent_snapshot_p = GetLatestParentNodeSnapshot(context_p);
+        return false;
+      }
 
-    // Arguments are:
-    // Deleted item; Prev item; next item (NodeID not used for next item)
-    // and delta chail child node
-    const InnerDeleteNode *delete_node_p = \
-      InnerInlineAllocateOfType(InnerDeleteNode,
-                                parent_snapshot_p->node_p,
-                                delete_item,
-                                prev_item,
-                                next_item,
-                                parent_snapshot_p->node_p,
-                                location);
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
 
-    // Assume parent has not changed, and CAS the index term delete delta
-    // If CAS failed then parent has changed, and we have no idea how it
-    // could be modified. The safest way is just abort
-    bool ret = InstallNodeToReplace(parent_snapshot_p->node_id,
-                                    delete_node_p,
-                                    parent_snapshot_p->node_p);
+      // We will CAS on top of this
+      const BaseNode *node_p = snapshot_p->node_p;
+      NodeID node_id = snapshot_p->node_id;
 
-    // If we installed the IndexTermDeleteDelta successfully the next
-    // step is to put the remove node into garbage chain
-    // and also recycle the deleted NodeID since now no new thread
-    // could access that NodeID until it is reused
-    if(ret == true) {
-      bwt_printf("Index term delete delta installed, ID = %lu; ABORT\n",
-                 parent_snapshot_p->node_id);
+      const LeafInsertNode *insert_node_p = \
+        LeafInlineAllocateOfType(LeafInsertNode, 
+                                 node_p, 
+                                 key, 
+                                 GetSearchKeyHash(&context),
+                                 value, 
+                                 node_p, 
+                                 index_pair,
+                                 GetCurrentVersion());
 
-      // The deleted node ID must resolve to a RemoveNode of either
-      // Inner or Leaf category
-      const BaseNode *garbage_node_p = GetNode(delete_item.second);
-      assert(garbage_node_p->IsRemoveNode());
+      bool ret = InstallLeafDelta(node_id, insert_node_p, node_p);
+      if(ret == true) {
+        bwt_printf("Leaf Insert delta CAS succeed\n");
 
-      // Put the remove node into garbage chain
-      // This will not remove the child node of the remove node, which
-      // should be removed together with the merge node above it
-      // Also, the remove node acts as a container for removed NodeID
-      // which will be recycled when the remove node is recycled
-      epoch_manager.AddGarbageNode(garbage_node_p);
+        InvalidateReadCache(key);
+        AddStatistics(&ThreadStatistics::item_insert_count);
 
-      // To avoid this entry being recycled during tree destruction
-      // Since the entry still remains in the old inner base node
-      // but we should have already deleted it
-      // NOTE: We could not do it here since some thread will fetch
-      // nullptr from the mapping table
-      // We should recycle the NodeID using EpochManager
-      // and requires that epoch manager finishes all epoches before
-      // the tree is destroyed
-      //mapping_table[deleted_node_id] = nullptr;
+        // If install is a success then just break from the loop
+        // and return
+        break;
+      } else {
+        bwt_printf("Leaf insert delta CAS failed\n");
 
-      parent_snapshot_p->node_p = delete_node_p;
+        AddStatistics(&ThreadStatistics::insert_abort_count);
 
-      ConsolidateNode(GetLatestNodeSnapshot(context_p));
+        #ifdef BWTREE_DEBUG
 
-      return true;
-    } else {
-      bwt_printf("Index term delete delta install failed. ABORT\n");
+        context.abort_counter++;
+        
+        #endif
 
-      // DO NOT FORGET TO DELETE THIS
-      delete_node_p->~InnerDeleteNode();
+        insert_node_p->~LeafInsertNode();
 
-      // The caller just returns after this function, so do not have
-      // to branch on abort_flag after this function returns
-      context_p->abort_flag = true;
+        if(leaf_retry_flag == true) {
+          retry_node_id = node_id;
+        }
+      }
 
-      return false;
+      #ifdef BWTREE_DEBUG
+      
+      // Update abort counter
+      // NOTE 1: We could not do this before return since the context
+      // object is cleared at the end of loop
+      // NOTE 2: Since Traverse() might abort due to other CAS failures
+      // context.abort_counter might be larger than 1 when
+      // LeafInsertNode installation fails
+      insert_abort_count.fetch_add(context.abort_counter);
+      
+      #endif
+
+      // We reach here only because CAS failed
+      bwt_printf("Retry installing leaf insert delta from the root\n");
     }
 
-    assert(false);
-    return false;
+    epoch_manager.LeaveEpoch(epoch_node_p);
+
+    return true;
   }
 
+#ifdef BWTREE_PELOTON
+
   /*
-   * FinishPartialSMO() - Finish partial completed SMO if there is one
-   *
-   * This function defines the help-along protocol, i.e. if we find
-   * a SMO on top of the delta chain, we should help-along that SMO before
-   * doing our own job. This might incur a recursive call of this function.
+   * ConditionalInsert() - Insert a key-value pair only if a given
+   *                       predicate fails for all values with a key
    *
-   * If this function returns true, then a node consolidation on the current
-   * top snapshot is recommended, because we have seen and processed (or
-   * confirmed that it has been processed) a merge/split delta on current
-   * top snapshot. To prevent other threads from seeing them and taking
-   * a full snapshot of the parent snapshot everytime they are seen, we
-   * return true to inform caller to do a consolidation
+   * If return true then the value has been inserted
+   * If return false then the value is not inserted. The reason could be
+   * predicates returning true for one of the values of a given key
+   * or because the value is already in the index
    *
-   * If we see a remove node, then the actual NodeID pushed into the path
-   * list stack may not equal the NodeID passed in this function. So when
-   * we need to read NodeID, always use the one stored in the NodeSnapshot
-   * vector instead of using a previously passed one
+   * NOTE: We first test the predicate, and then test for duplicated values
+   * so predicate test result is always available
    */
-  void FinishPartialSMO(Context *context_p) {
-    // Note: If the top of the path list changes then this pointer
-    // must also be updated
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
+  bool ConditionalInsert(const KeyType &key,
+                         const ValueType &value,
+                         std::function<bool(const void *)> predicate,
+                         bool *predicate_satisfied) {
+    bwt_printf("Insert (cond.) called\n");
 
-before_switch:
-    switch(snapshot_p->node_p->GetType()) {
-      case NodeType::InnerAbortType: {
-        bwt_printf("Observed Inner Abort Node; ABORT\n");
+    #ifdef BWTREE_DEBUG
+    insert_op_count.fetch_add(1);
+    #endif
 
-        // This is an optimization - when seeing an ABORT
-        // node, we continue but set the physical pointer to be ABORT's
-        // child, to make CAS always fail on this node to avoid
-        // posting on ABORT, especially posting split node
-        snapshot_p->node_p = \
-          (static_cast<const DeltaNode *>(snapshot_p->node_p))->child_node_p;
+    AddStatistics(&ThreadStatistics::insert_op_count);
 
-        goto before_switch;
-      }
-      case NodeType::LeafRemoveType:
-      case NodeType::InnerRemoveType: {
-        bwt_printf("Helping along remove node...\n");
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-        // The right branch for merging is the child node under remove node
-        const BaseNode *merge_right_branch = \
-          (static_cast<const DeltaNode *>(snapshot_p->node_p))->child_node_p;
+    // The leaf of the last failed installation (see SetLeafRetryMode())
+    NodeID retry_node_id = INVALID_NODE_ID;
 
-        // This will also be recorded in merge delta such that when
-        // we finish merge delta we could recycle the node id as well
-        // as the RemoveNode
-        NodeID deleted_node_id = snapshot_p->node_id;
+    while(1) {
+      Context context{key};
 
-        JumpToLeftSibling(context_p);
+      // This will just stop on the correct leaf page
+      // without traversing into it. Next we manually traverse
+      TraverseWithFinger(&context, nullptr, nullptr, retry_node_id);
 
-        // If this aborts then we propagate this to the state machine driver
-        if(context_p->abort_flag == true) {
-          bwt_printf("Jump to left sibling in Remove help along ABORT\n");
+      SampleLeafWrite(&context);
 
-          // Here we are uncertain about the current status (it might have
-          // jumped and observed an inconsistent next node ID, or it has not
-          // jumped because of an inconsistent left child status)
-          return;
-        }
+      *predicate_satisfied = false;
+      
+      // This is used to hold the index for which this delta will
+      // be applied to
+      std::pair<int, bool> index_pair;
 
-        // That is the left sibling's snapshot
-        NodeSnapshot *left_snapshot_p = GetLatestNodeSnapshot(context_p);
+      // Call navigate leaf node to test predicate and to test duplicates
+      const KeyValuePair *item_p = \
+        NavigateLeafNode(&context,
+                         value,
+                         &index_pair,
+                         predicate,
+                         predicate_satisfied);
+      
+      // We do not insert anything if predicate is satisfied
+      if(*predicate_satisfied == true) {
+        epoch_manager.LeaveEpoch(epoch_node_p);
+        
+        return false;
+      } else if(item_p != nullptr) {
+        epoch_manager.LeaveEpoch(epoch_node_p);
+        
+        return false;
+      }
 
-        // Update snapshot pointer if we fall through to posting
-        // index term delete delta for merge node
-        snapshot_p = left_snapshot_p;
+      // This retrieves the most up-to-date snapshot (which does not change)
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
 
-        // This serves as the merge key
-        // Note that the left sibling node must have a valid high key
-        const KeyType &merge_key = snapshot_p->node_p->GetHighKey();
+      // We will CAS on top of this
+      const BaseNode *node_p = snapshot_p->node_p;
+      NodeID node_id = snapshot_p->node_id;
+
+      // Here since we could not know which is the next key node
+      // just use child node as a cpnservative way of inserting
+      const LeafInsertNode *insert_node_p = \
+        LeafInlineAllocateOfType(LeafInsertNode, 
+                                 node_p, 
+                                 key, 
+                                 GetSearchKeyHash(&context),
+                                 value, 
+                                 node_p, 
+                                 index_pair,
+                                 GetCurrentVersion());
+
+      bool ret = InstallLeafDelta(node_id, insert_node_p, node_p);
+      if(ret == true) {
+        bwt_printf("Leaf Insert (cond.) delta CAS succeed\n");
+
+        InvalidateReadCache(key);
+        AddStatistics(&ThreadStatistics::item_insert_count);
+
+        // If install is a success then just break from the loop
+        // and return
+        break;
+      } else {
+        bwt_printf("Leaf insert (cond.) delta CAS failed\n");
 
-        // This holds the merge node if installation is successful
-        // Not changed (i.e.undefined) if CAS fails
-        const BaseNode *merge_node_p = nullptr;
+        AddStatistics(&ThreadStatistics::insert_abort_count);
 
-        bool ret;
+        #ifdef BWTREE_DEBUG
 
-        // If we are currently on leaf, just post leaf merge delta
-        if(left_snapshot_p->IsLeaf() == true) {
-          ret = \
-            PostLeafMergeNode(left_snapshot_p,
-                              &merge_key,
-                              merge_right_branch,
-                              deleted_node_id,
-                              &merge_node_p);
-        } else {
-          ret = \
-            PostInnerMergeNode(left_snapshot_p,
-                               &merge_key,
-                               merge_right_branch,
-                               deleted_node_id,
-                               &merge_node_p);
+        context.abort_counter++;
+        
+        #endif
+
+        insert_node_p->~LeafInsertNode();
+
+        if(leaf_retry_flag == true) {
+          retry_node_id = node_id;
         }
+      }
 
-        // If CAS fails just abort and return
-        if(ret == true) {
-          bwt_printf("Merge delta CAS succeeds. "
-                     "Continue to finish merge SMO\n");
+      #ifdef BWTREE_DEBUG
 
-          left_snapshot_p->node_p = merge_node_p;
+      insert_abort_count.fetch_add(context.abort_counter);
+      
+      #endif
 
-          // merge_node_p is set as the newest merge node above
-          // after this point
-          // Also snapshot_p has been to left_snapshot_p above
-        } else {
-          bwt_printf("Merge delta CAS fails. ABORT\n");
+      bwt_printf("Retry installing leaf insert (cond.) delta from the root\n");
+    }
 
-          context_p->abort_flag = true;
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
-          return;
-        } // if ret == true
+    return true;
+  }
 
-        //
-        // FALL THROUGH IF POSTING MERGE DELTA SUCCEEDS
-        //
+#endif
 
-      } // case Inner/LeafRemoveType
-      case NodeType::InnerMergeType:
-      case NodeType::LeafMergeType: {
-        bwt_printf("Helping along merge delta\n");
 
-        // First consolidate parent node and find the left/right
-        // sep pair plus left node ID
-        NodeSnapshot *parent_snapshot_p = \
-          GetLatestParentNodeSnapshot(context_p);
+  /*
+   * Delete() - Remove a key-value pair from the tree
+   *
+   * This function returns false if the key and value pair does not
+   * exist. Return true if delete succeeds
+   *
+   * This functions shares a same structure with the Insert() one
+   */
+  bool Delete(const KeyType &key, const ValueType &value) {
+    bwt_printf("Delete called\n");
 
-        // This is necessary - make sure the parent node snapshot
-        // is always update to date such that we do not miss a
-        // late InnerInsertNode that actually posts the deleted item
-        // o.w. the thread will just continue and post on top of
-        // an unfinished merge delta
-        if(parent_snapshot_p->node_p != GetNode(parent_snapshot_p->node_id)) {
-          context_p->abort_flag = true;
-          
-          return;
-        }
+    #ifdef BWTREE_DEBUG
+    delete_op_count.fetch_add(1);
+    #endif
 
-        // This is the item being deleted inside parent node
-        const KeyNodeIDPair *delete_item_p = nullptr;
-        const BaseNode *right_merge_p = nullptr;
+    AddStatistics(&ThreadStatistics::delete_op_count);
 
-        // Type of the merge delta
-        // This is important since we might fall through
-        // from the LeafRemoveNode/InnerRemoveNode branch
-        NodeType type = snapshot_p->node_p->GetType();
-        
-        if(type == NodeType::InnerMergeType) {
-          const InnerMergeNode *merge_node_p = \
-            static_cast<const InnerMergeNode *>(snapshot_p->node_p);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-          delete_item_p = &merge_node_p->delete_item;
-          right_merge_p = merge_node_p->right_merge_p;
-        } else if(type == NodeType::LeafMergeType) {
-          const LeafMergeNode *merge_node_p = \
-            static_cast<const LeafMergeNode *>(snapshot_p->node_p);
+    // The leaf of the last failed installation (see SetLeafRetryMode())
+    NodeID retry_node_id = INVALID_NODE_ID;
 
-          delete_item_p = &merge_node_p->delete_item;
-          right_merge_p = merge_node_p->right_merge_p;
-        } else {
-          bwt_printf("ERROR: Illegal node type: %d\n",
-                     static_cast<int>(type));
+    while(1) {
+      Context context{key};
+      std::pair<int, bool> index_pair;
 
-          assert(false);
-        } // If on type of merge node
+      // Navigate leaf nodes to check whether the key-value
+      // pair exists
+      const KeyValuePair *item_p = \
+        TraverseWithFinger(&context, &value, &index_pair, retry_node_id);
 
-        const KeyNodeIDPair *location;
+      SampleLeafWrite(&context);
 
-        // Find the deleted item
-        const KeyNodeIDPair *found_pair_p = \
-          NavigateInnerNode(parent_snapshot_p, 
-                            delete_item_p->first, 
-                            &location);
-          
-        // If the item is found then next we post InnerDeleteNode
-        if(found_pair_p != nullptr) {
-          assert(found_pair_p->second == delete_item_p->second);
-        } else {
-          return;
-        }
+      if(item_p == nullptr) {
+        epoch_manager.LeaveEpoch(epoch_node_p);
 
-        // It will post an InnerDeleteNode on the parent node
-        // and the return value is the result of CAS
-        // Note: Even if this function aborts, since we return immediately
-        // so do not have to test abort_flag here
-        //
-        // There is a trick: The prev key is the low key of the node
-        // being merged into
-        // and the next key is the high key of the node being merged from
-        PostInnerDeleteNode(context_p,
-                            *delete_item_p,
-                            // Note that for leaf node the low key is not complete
-                            std::make_pair(snapshot_p->node_p->GetLowKey(), snapshot_p->node_id),
-                            // Also note that high key pair is valid for both leaf and inner
-                            right_merge_p->GetHighKeyPair(),
-                            // This is location on InnerNode
-                            location);
+        return false;
+      }
 
-        return;
-      } // case Inner/LeafMergeNode
-      case NodeType::InnerSplitType:
-      case NodeType::LeafSplitType: {
-        bwt_printf("Helping along split node\n");
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
 
-        // These two will be stored inside InnerInsertNode
-        // The insert item is just the split item inside InnerSplitNode
-        // but next item needs to be read from the parent node
-        const KeyNodeIDPair *insert_item_p;
+      // We will CAS on top of this
+      const BaseNode *node_p = snapshot_p->node_p;
+      NodeID node_id = snapshot_p->node_id;
 
-        // This is set to use the high key pair of the node under
-        // split delta
-        const KeyNodeIDPair *next_item_p;
+      const LeafDeleteNode *delete_node_p = \
+        LeafInlineAllocateOfType(LeafDeleteNode, 
+                                 node_p, 
+                                 key, 
+                                 GetSearchKeyHash(&context),
+                                 value, 
+                                 node_p, 
+                                 index_pair,
+                                 GetCurrentVersion());
 
-        NodeType type = snapshot_p->node_p->GetType();
+      bool ret = InstallLeafDelta(node_id, delete_node_p, node_p);
+      if(ret == true) {
+        bwt_printf("Leaf Delete delta CAS succeed\n");
 
-        // NOTE: depth should not be read here, since we
-        // need to know the depth on its parent node
-        if(type == NodeType::InnerSplitType) {
-          const InnerSplitNode *split_node_p = \
-            static_cast<const InnerSplitNode *>(snapshot_p->node_p);
+        InvalidateReadCache(key);
+        AddStatistics(&ThreadStatistics::item_delete_count);
 
-          insert_item_p = &split_node_p->insert_item;
-          next_item_p = &split_node_p->child_node_p->GetHighKeyPair();
-        } else {
-          const LeafSplitNode *split_node_p = \
-            static_cast<const LeafSplitNode *>(snapshot_p->node_p);
+        // If install is a success then just break from the loop
+        // and return
+        break;
+      } else {
+        bwt_printf("Leaf Delete delta CAS failed\n");
 
-          insert_item_p = &split_node_p->insert_item;
-          next_item_p = &split_node_p->child_node_p->GetHighKeyPair();
-        }
+        AddStatistics(&ThreadStatistics::delete_abort_count);
 
-        assert(context_p->current_level >= 0);
+        delete_node_p->~LeafDeleteNode();
 
-        // If the parent snapshot has an invalid node ID then it must be the
-        // root node. 
-        if(context_p->IsOnRootNode() == true) {
-          /***********************************************************
-           * Root splits (don't have to consolidate parent node)
-           ***********************************************************/
-          bwt_printf("Root splits!\n");
+        if(leaf_retry_flag == true) {
+          retry_node_id = node_id;
+        }
 
-          // Allocate a new node ID for the newly created node
-          // If CAS fails we need to free the root ID
-          NodeID new_root_id = GetNextNodeID();
+        #ifdef BWTREE_DEBUG
 
-          // InnerNode requires high key pair which is +Inf, INVALID NODE ID
-          // low key pair will be set inside the constructor to be pointing
-          // to the first element in the sep list
-          // NOTE: Storage will be automatically reserved inside the
-          // constructor
-          #ifdef BWTREE_PELOTON
+        context.abort_counter++;
+        
+        #endif
+      }
 
-          // This is the first item of the newly created InnerNode
-          // and also the low key for the newly created InnerNode
-          const KeyNodeIDPair first_item = std::make_pair(KeyType(),
-                                                          snapshot_p->node_id);
+      #ifdef BWTREE_DEBUG
 
-          // Allocate an InnerNode with KeyNodeIDPair embedded
-          InnerNode *inner_node_p = \
-            reinterpret_cast<InnerNode *>( \
-              ElasticNode<KeyNodeIDPair>::\
-                Get(2, 
-                    NodeType::InnerType, 
-                    0,
-                    2,
-                    first_item,
-                    std::make_pair(KeyType(), INVALID_NODE_ID)));
+      delete_abort_count.fetch_add(context.abort_counter);
+      
+      #endif
 
-          #else
+      // We reach here only because CAS failed
+      bwt_printf("Retry installing leaf delete delta from the root\n");
+    }
 
-          // This is the first item of the newly created InnerNode
-          // and also the low key for the InnerNode
-          const KeyNodeIDPair first_item = std::make_pair(KeyType{},
-                                                          snapshot_p->node_id);
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
-          // Allocate an InnerNode with KeyNodeIDPair embedded
-          InnerNode *inner_node_p = \
-            reinterpret_cast<InnerNode *>( \
-              ElasticNode<KeyNodeIDPair>::\
-                Get(2, 
-                NodeType::InnerType, 
-                0,
-                2,
-                first_item,
-                std::make_pair(KeyType{}, INVALID_NODE_ID)));
-                               
-          #endif
+    return true;
+  }
+
+  /*
+   * DeleteRange() - Removes all key value pairs whose keys are in
+   *                 [low_key, high_key)
+   *
+   * Leaf nodes intersecting the range are visited one by one by following
+   * the high key of the previous leaf, and the part of the range inside
+   * each leaf is deleted with one LeafDeleteRangeNode rather than one
+   * LeafDeleteNode per pair. If the range covers all items of a leaf then
+   * its delta chain is replaced with an empty base node instead, which is
+   * removed and merged into its left sibling by the traversal right after.
+   *
+   * Returns the number of key value pairs deleted
+   *
+   * NOTE: Each leaf is deleted atomically, but the range as a whole is not,
+   * so concurrent readers could observe a partially deleted range
+   */
+  size_t DeleteRange(const KeyType &low_key, const KeyType &high_key) {
+    bwt_printf("DeleteRange()\n");
 
-          // Add new element - one points to the current node (new second level
-          // left most inner node), another points to its split sibling
-          inner_node_p->PushBack(first_item);
-          inner_node_p->PushBack(*insert_item_p);
+    size_t delete_count = 0UL;
+    KeyType current_key = low_key;
 
-          // First we need to install the new node with NodeID
-          // This makes it visible
-          InstallNewNode(new_root_id, inner_node_p);
-          bool ret = InstallRootNode(snapshot_p->node_id,
-                                     new_root_id);
+    // Pairs inside the range on the current leaf; Only the size is used
+    std::vector<KeyValuePair> item_list{};
 
-          if(ret == true) {
-            bwt_printf("Install root CAS succeeds\n");
+    while(KeyCmpLess(current_key, high_key) == true) {
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-            // After installing new root we abort in order to load
-            // the new root
-            context_p->abort_flag = true;
+      Context context{current_key};
 
-            return;
-          } else {
-            bwt_printf("Install root CAS failed. ABORT\n");
+      Traverse(&context, nullptr, nullptr);
 
-            // We need to make a new remove node and send it into EpochManager
-            // for recycling the NodeID
-            // Note that the remove node must not be created on inner_node_p
-            // since inner_node_p might be destroyed before remove node is 
-            // destroyed since they are both put into the GC chain
-            const InnerRemoveNode *fake_remove_node_p = \
-              new InnerRemoveNode{new_root_id, 
-                                  inner_node_p};
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
+      const BaseNode *node_p = snapshot_p->node_p;
+      NodeID node_id = snapshot_p->node_id;
 
-            // Put the remove node into garbage chain, because
-            // we cannot call InvalidateNodeID() here
-            epoch_manager.AddGarbageNode(fake_remove_node_p);
-            epoch_manager.AddGarbageNode(inner_node_p);
+      const KeyNodeIDPair next_key_pair = node_p->GetHighKeyPair();
 
-            context_p->abort_flag = true;
+      // The range tombstone must not cover keys outside the leaf
+      const KeyType *delete_high_key_p = &high_key;
+      if((next_key_pair.second != INVALID_NODE_ID) && \
+         (KeyCmpLess(next_key_pair.first, high_key) == true)) {
+        delete_high_key_p = &next_key_pair.first;
+      }
 
-            return;
-          } // if CAS succeeds/fails
-        } else {
-          /***********************************************************
-           * Index term insert for non-root nodes
-           ***********************************************************/
+      item_list.clear();
+      CollectRangeOnLeaf(node_p,
+                         &current_key,
+                         delete_high_key_p,
+                         static_cast<size_t>(node_p->GetItemCount()),
+                         &item_list);
+
+      int delete_num = static_cast<int>(item_list.size());
+      bool ret = true;
+
+      if(delete_num == node_p->GetItemCount() && delete_num > 0) {
+        // The leaf becomes empty, so the delta chain is dropped as a whole
+        LeafNode *empty_leaf_node_p = \
+          reinterpret_cast<LeafNode *>(ElasticNode<KeyValuePair>::\
+            Get(0,
+                NodeType::LeafType,
+                0,
+                0,
+                node_p->GetLowKeyPair(),
+                node_p->GetHighKeyPair()));
 
-          // First consolidate parent node and find the right sep
-          NodeSnapshot *parent_snapshot_p = \
-            GetLatestParentNodeSnapshot(context_p);
+        empty_leaf_node_p->SetPreviousVersion(node_p, GetCurrentVersion());
 
-          // If the split key is out of range then just ignore
-          // we do not worry that through split sibling link
-          // we would traverse to the child of a different parent node
-          // than the current one, since we always guarantee that after
-          // NavigateInnerNode() returns if it does not abort, then we
-          // are on the correct node for the current key
+        ret = InstallNodeToReplace(node_id, empty_leaf_node_p, node_p);
+        if(ret == true) {
+          RecordInstalledNode(empty_leaf_node_p);
 
-          // This happens when the parent splits on the newly inserted index term
-          // and the split delta has not been consolidated yet, so that a thread
-          // sees the split delta and traverses to its right sibling which is on
-          // another parent node (the right sibling of the current parent node)
-          // In this case we do not have to insert since we know the index term has
-          // already been inserted
-          if((parent_snapshot_p->node_p->GetNextNodeID() != INVALID_NODE_ID) &&
-             (KeyCmpGreaterEqual(insert_item_p->first,
-                                 parent_snapshot_p->node_p->GetHighKey()))) {
-            bwt_printf("Bounds check failed on parent node"
-                       " - item key >= high key\n");
+          epoch_manager.AddGarbageNode(node_p);
 
-            return;
-          }
-          
-          // This is used to hold index information for InnerInsertNode
-          const KeyNodeIDPair *location;
+          // This posts remove node on the empty leaf and finishes the merge
+          Context remove_context{current_key};
 
-          // Find the split item that we intend to insert in the parent node
-          // This function returns a pointer to the item if found, or
-          // nullptr if not found
-          const KeyNodeIDPair *found_item_p = \
-            NavigateInnerNode(parent_snapshot_p, 
-                              insert_item_p->first, 
-                              &location);
+          Traverse(&remove_context, nullptr, nullptr);
+        } else {
+          epoch_manager.AddGarbageNode(empty_leaf_node_p, false);
+        }
+      } else if(delete_num > 0) {
+        const LeafDeleteRangeNode *delete_range_node_p = \
+          LeafInlineAllocateOfType(LeafDeleteRangeNode,
+                                   node_p,
+                                   current_key,
+                                   *delete_high_key_p,
+                                   node_p,
+                                   delete_num,
+                                   GetCurrentVersion());
 
-          // If the item has been found then we do not post
-          // InnerInsertNode onto the parent
-          if(found_item_p != nullptr) {
-            
-            // Check whether there is an item in the parent
-            // node that has the same key but different NodeID
-            // This is totally legal
-            if(found_item_p->second != insert_item_p->second) {
-              
-              #ifdef BWTREE_DEBUG
-              
-              // If this happens then it must be the case that the node with
-              // the same split key but different node ID was removed and then
-              // merged into the current node and then it is splited again
-              //
-              // We are now on the way of completing the second split SMO
-              // but since the parent has changed (we must have missed an
-              // InnerInsertNode) we need to abort and restart traversing
-              const BaseNode *node_p = GetNode(found_item_p->second);
-              
-              assert(node_p->GetType() == NodeType::InnerRemoveType ||
-                     node_p->GetType() == NodeType::LeafRemoveType);
-              
-              #endif
-              
-              context_p->abort_flag = true;
-            }
-            
-            return;
-          }
+        ret = InstallNodeToReplace(node_id, delete_range_node_p, node_p);
+        if(ret == false) {
+          delete_range_node_p->~LeafDeleteRangeNode();
+        }
+      }
 
-          // Post InnerInsertNode on the parent node.
-          // Also if this returns true then we have successfully completed split SMO
-          // which means the SMO could be removed by a consolidation to avoid
-          // consolidating the parent node again and again
-          // Note: Even if this function aborts, since we return immediately
-          // so do not have to test abort_flag here
-          PostInnerInsertNode(context_p, 
-                              *insert_item_p, 
-                              *next_item_p, 
-                              location);
+      epoch_manager.LeaveEpoch(epoch_node_p);
 
-          return;
-        } // if split root / else not split root
-      } // case split node
-      default: {
-        return;
-        // By default we do not do anything special
+      // Retry the same leaf if it has been modified
+      if(ret == false) {
+        bwt_printf("Leaf delete range CAS failed\n");
+
+        AddStatistics(&ThreadStatistics::delete_abort_count);
+
+        continue;
+      }
+
+      delete_count += static_cast<size_t>(delete_num);
+
+      if(next_key_pair.second == INVALID_NODE_ID) {
         break;
       }
-    } // switch
 
-    assert(false);
-    return;
+      current_key = next_key_pair.first;
+    }
+
+    // Keys in the range are not known to the cache, so all entries go
+    if(read_cache_p != nullptr) {
+      read_cache_p->InvalidateAll();
+    }
+
+    AddStatistics(&ThreadStatistics::item_delete_count, delete_count);
+
+    return delete_count;
   }
-  
+
   /*
-   * ConsolidateLeafNode() - Consolidates a leaf delta chian unconditionally
+   * Truncate() - Removes all key value pairs from the tree
    *
-   * This function does not check delta chain size
+   * An empty root and first leaf are installed under new NodeIDs, and then
+   * the root NodeID is swapped, such that operations starting after this
+   * see an empty tree. Nodes of the old tree are freed by a background
+   * thread once all threads that could have seen the old root have left
+   * their epochs, with SetTeardownThreadNum() threads, so this function
+   * returns without visiting the old tree. NodeIDs of the old tree are then
+   * handed out again before new ones are reserved, such that repeatedly
+   * truncating and refilling the tree does not grow the mapping table
+   *
+   * Operations running concurrently with this function are ordered before
+   * it, and their changes are dropped with the old tree. Snapshots taken
+   * before this function keep iterating on the old tree, which is only
+   * freed after they are released
+   *
+   * NOTE: This function could be called concurrently with other operations,
+   * but not with another Truncate(). Functions that must be called when
+   * there is no other thread working on the tree and which reconfigure
+   * threads, as well as the destructor, finish pending reclamation first
    */
-  inline void ConsolidateLeafNode(NodeSnapshot *snapshot_p) {
-    assert(snapshot_p->node_p->IsOnLeafDeltaChain() == true);
-    
-    LeafNode *leaf_node_p = CollectAllValuesOnLeaf(snapshot_p);
+  void Truncate() {
+    bwt_printf("Truncate()\n");
 
-    bool ret = InstallNodeToReplace(snapshot_p->node_id,
-                                    leaf_node_p,
-                                    snapshot_p->node_p);
+    // Join reclaim threads of earlier calls that have finished
+    auto it = reclaim_task_list.begin();
+    while(it != reclaim_task_list.end()) {
+      if((*it)->finish_flag.load() == false) {
+        it++;
 
-    if(ret == true) {
-      epoch_manager.AddGarbageNode(snapshot_p->node_p);
+        continue;
+      }
 
-      snapshot_p->node_p = leaf_node_p;
-    } else {
-      epoch_manager.AddGarbageNode(leaf_node_p);
+      (*it)->thread_p->join();
+
+      delete (*it)->thread_p;
+      delete *it;
+
+      it = reclaim_task_list.erase(it);
     }
-    
-    return;
-  }
-  
-  /*
-   * ConsolidateInnerNode() - Consolidates inner node unconditionally
-   *
-   * This function does not check for inner delta chain length
-   */
-  inline void ConsolidateInnerNode(NodeSnapshot *snapshot_p) {
-    assert(snapshot_p->node_p->IsOnLeafDeltaChain() == false);
-    
-    InnerNode *inner_node_p = CollectAllSepsOnInner(snapshot_p);
 
-    bool ret = InstallNodeToReplace(snapshot_p->node_id,
-                                    inner_node_p,
-                                    snapshot_p->node_p);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    if(ret == true) {
-      epoch_manager.AddGarbageNode(snapshot_p->node_p);
+    // Bytes of the old tree are dropped at once. Concurrent operations and
+    // snapshot iterators on the old tree might leave a small error
+    int64_t old_node_size = node_memory_size.load();
 
-      snapshot_p->node_p = inner_node_p;
-    } else {
-      epoch_manager.AddGarbageNode(inner_node_p);
+    NodeID new_root_id = TakeNodeID();
+    NodeID new_leaf_id = TakeNodeID();
+    InstallEmptyLayout(new_root_id, new_leaf_id);
+
+    // Leaf fingers found while the generation is odd are never used again
+    tree_generation.fetch_add(1UL);
+
+    // Iterators starting from the new first leaf only move to the new
+    // tree, so it is switched before the root
+    first_leaf_id.store(new_leaf_id);
+    NodeID old_root_id = root_id.exchange(new_root_id);
+
+    tree_generation.fetch_add(1UL);
+
+    node_memory_size.fetch_sub(old_node_size);
+    approximate_size_base.fetch_sub(GetItemCountSum());
+
+    // Entries filled by readers of the old tree after this are rejected
+    // by the generation check
+    if(read_cache_p != nullptr) {
+      read_cache_p->InvalidateAll();
     }
-    
+
+    // Threads announcing a later epoch are guaranteed to see the new root
+    uint64_t epoch = GetGlobalEpoch();
+    IncreaseEpoch();
+
+    // This thread announces the new epoch, so it does not hold back the
+    // reclamation by itself
+    epoch_manager.LeaveEpoch(epoch_node_p);
+
+    ReclaimTask *task_p = new ReclaimTask{};
+    bool drain_flag = (consolidation_queue_p != nullptr);
+    size_t thread_num = teardown_thread_num;
+
+    task_p->thread_p = \
+      new std::thread{[this,
+                       task_p,
+                       old_root_id,
+                       epoch,
+                       drain_flag,
+                       thread_num]() {
+        this->ReclaimTreeFunc(old_root_id, epoch, drain_flag, thread_num);
+
+        task_p->finish_flag.store(true);
+      }};
+
+    reclaim_task_list.push_back(task_p);
+
     return;
   }
 
   /*
-   * ConsolidateNode() - Consolidates current node unconditionally
-   *
-   * This function is called after finishing split/merge SMO, since we
-   * want to prevent other threads from seeing the finished SMO and
-   * do an useless consolidation on the parent node
+   * ReclaimTreeFunc() - Frees a tree dropped by Truncate() in the background
    *
-   * NOTE: This function does not return any value reflecting the status
-   * of CAS operation, since consolidation is an optional operation, and it
-   * would not have any effect even if it fails
+   * Threads that announced an epoch no later than the given one might still
+   * be on the old tree, and NodeIDs of the old tree they pushed into the
+   * background consolidation queue might be popped later. So if background
+   * consolidation is running, the queue is drained after these threads have
+   * left, and we wait for another epoch, since consolidation threads enter
+   * their epoch before popping
    */
-  void ConsolidateNode(NodeSnapshot *snapshot_p) {
-    if(snapshot_p->node_p->IsOnLeafDeltaChain() == true) {
-      ConsolidateLeafNode(snapshot_p);
-    } else {
-      ConsolidateInnerNode(snapshot_p);
-    } // if on leaf/inner node
+  void ReclaimTreeFunc(NodeID old_root_id,
+                       uint64_t epoch,
+                       bool drain_flag,
+                       size_t thread_num) {
+    WaitForEpoch(epoch);
+
+    if(drain_flag == true) {
+      for(size_t i = 0;i < CONSOLIDATION_QUEUE_SIZE;i++) {
+        if(consolidation_queue_p->Pop().first == false) {
+          break;
+        }
+      }
+
+      epoch = GetGlobalEpoch();
+      IncreaseEpoch();
+
+      WaitForEpoch(epoch);
+    }
+
+    // No thread could reach the old tree, so its NodeIDs are reused
+    size_t node_count = FreeSubtrees(old_root_id, thread_num, true);
+
+    bwt_printf("Reclaimed %lu tree nodes\n", node_count);
+    (void)node_count;
 
     return;
   }
 
   /*
-   * TryConsolidateNode() - Consolidate current node if its length exceeds the
-   *                        threshold value
-   *
-   * If the length of delta chain does not exceed the threshold then this
-   * function does nothing
-   *
-   * If function returns true then we have successfully consolidated a node
-   * Otherwise no consolidation happens. The return value might be used
-   * as a hint for deciding whether to adjust node size or not
-   *
-   * NOTE: If consolidation fails then this function does not do anything
-   * and will just continue with its own job. There is no chance of abort
-   *
-   * TODO: If strict mode is on, then whenever consolidation fails we should
-   * always abort and start from the beginning, to keep delta chain length
-   * upper bound intact
+   * WaitForEpoch() - Waits until all threads have announced an epoch later
+   *                  than the given one, or pending reclamation is being
+   *                  finished by JoinReclaimTasks()
    */
-  void TryConsolidateNode(Context *context_p) {
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-
-    // Do not overwrite this pointer since we will use this
-    // to locate garbage delta chain
-    const BaseNode *node_p = snapshot_p->node_p;
-
-    // We could only perform consolidation on delta node
-    // because we want to see depth field
-    if(node_p->IsDeltaNode() == false) {
-      // The depth of base node may not be 0
-      // since if we consolidate parent node to finish the partial SMO,
-      // then parent node will have non-0 depth in order to avoid being too
-      // large (see FindSplitNextKey() and FindMergePrevNextKey() and
-      // JumpToLeftSibling())
-      // assert(node_p->metadata.depth == 0);
-
-      return;
+  void WaitForEpoch(uint64_t epoch) {
+    while(reclaim_exit_flag.load() == false && GetCachedGCEpoch() <= epoch) {
+      std::this_thread::sleep_for(
+        std::chrono::microseconds(RECLAIM_POLL_INTERVAL_US));
     }
 
-    // If depth does not exceed threshold then we check recommendation flag
-    int depth = node_p->GetDepth();
+    return;
+  }
 
-    if(snapshot_p->IsLeaf() == true) {
-      if(depth < LEAF_DELTA_CHAIN_LENGTH_THRESHOLD) {
-        return;
-      }
-    } else {
-      if(depth < INNER_DELTA_CHAIN_LENGTH_THRESHOLD) {
-        return;
-      }
-    }
+  /*
+   * JoinReclaimTasks() - Finishes reclamation of all trees dropped by
+   *                      Truncate() and joins reclaim threads
+   *
+   * Reclaim threads stop waiting for epochs and free the old trees right
+   * away, so this must be called when there is no other thread working
+   * on the tree, and no snapshot taken before Truncate() is left
+   */
+  void JoinReclaimTasks() {
+    reclaim_exit_flag.store(true);
 
-    // After this point we decide to consolidate node
+    for(ReclaimTask *task_p : reclaim_task_list) {
+      task_p->thread_p->join();
 
-    ConsolidateNode(snapshot_p);
+      delete task_p->thread_p;
+      delete task_p;
+    }
+
+    reclaim_task_list.clear();
+    reclaim_exit_flag.store(false);
 
     return;
   }
 
   /*
-   * AdjustNodeSize() - Post split or merge delta if a node becomes overflow
-   *                    or underflow
-   *
-   * For leftmost children nodes and for root node (which has is_leftmost
-   * flag set) we never post remove delta, the merge of which would change
-   * its parent node's low key
+   * Update() - Replaces a key-value pair with another value of the same key
    *
-   * NOTE: This function will abort after installing a node remove delta,
-   * in order not to have to call LoadNodeID recursively
+   * This function returns false if the old key-value pair does not exist, or
+   * if the new key-value pair already exists. Otherwise a single
+   * LeafUpdateNode is posted, which is equivalent to Delete() on the old
+   * value followed by Insert() on the new value, but only takes one
+   * traversal and one delta record
    *
-   * TODO: In the future we might want to change this
+   * If the old value equals the new value then nothing is posted, and the
+   * return value indicates whether the key-value pair exists
    */
-  void AdjustNodeSize(Context *context_p) {
-    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
-    const BaseNode *node_p = snapshot_p->node_p;
-
-    // We do not adjust size for delta nodes
-    if(node_p->IsDeltaNode() == true) {
-      // TODO: If we want to strictly enforce the size of any node
-      // then we should aggressively consolidate here and always
-      // Though it brings huge overhead because now we are consolidating
-      // every node on the path
+  bool Update(const KeyType &key,
+              const ValueType &old_value,
+              const ValueType &new_value) {
+    bwt_printf("Update called\n");
 
-      return;
-    }
+    #ifdef BWTREE_DEBUG
+    update_op_count.fetch_add(1);
+    #endif
 
-    NodeID node_id = snapshot_p->node_id;
+    AddStatistics(&ThreadStatistics::update_op_count);
 
-    if(snapshot_p->IsLeaf() == true) {
-      const LeafNode *leaf_node_p = \
-        static_cast<const LeafNode *>(node_p);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-      // NOTE: We use key number as the size of the node
-      // because using item count might result in a very unstable
-      // split, in a sense that we could not always split the node
-      // evenly, and in the worst case if there is one key in the
-      // node the node could not be splited while having a large
-      // item count
-      size_t node_size = leaf_node_p->GetItemCount();
+    while(1) {
+      Context context{key};
+      std::pair<int, bool> old_index_pair;
+      std::pair<int, bool> new_index_pair;
 
-      // Perform corresponding action based on node size
-      if(node_size >= LEAF_NODE_SIZE_UPPER_THRESHOLD) {
-        bwt_printf("Node size >= leaf upper threshold. Split\n");
+      const KeyValuePair *item_p = \
+        TraverseWithFinger(&context, &old_value, &old_index_pair);
 
-        // Note: This function takes this as argument since it will
-        // do key comparison
-        const LeafNode *new_leaf_node_p = leaf_node_p->GetSplitSibling(this);
+      SampleLeafWrite(&context);
 
-        // If the new leaf node pointer is nullptr then it means the
-        // although the size of the leaf node exceeds split threshold
-        // but we could not find a spliting point that evenly or almost
-        // evenly divides the key space into two siblings whose sizes
-        // are both larger than the merge threshold (o.w. the node will
-        // be immediately merged)
-        // NOTE: This is a potential problem if a leaf becomes very unbalanced
-        // since all threads will try to split the leaf node when traversing
-        // to it (not for reader threads)
-        if(new_leaf_node_p == nullptr) {
-          bwt_printf("LeafNode size exceeds overhead, "
-                     "but could not find split point\n");
+      if(item_p == nullptr || ValueCmpEqual(old_value, new_value)) {
+        epoch_manager.LeaveEpoch(epoch_node_p);
 
-          return;
-        }
+        return item_p != nullptr;
+      }
 
-        // Since we would like to access its first element to get the low key
-        assert(new_leaf_node_p->GetSize() > 0);
+      // We are already on the correct leaf, so this does not abort
+      item_p = NavigateLeafNode(&context, new_value, &new_index_pair);
+      assert(context.abort_flag == false);
 
-        // The split key must be a valid key
-        // Note that the lowkey for leaf node is not defined, so in the
-        // case that it is required we must manually goto its data list
-        // and find the low key in its leftmost element
-        const KeyType &split_key = new_leaf_node_p->At(0).first;
+      if(item_p != nullptr) {
+        epoch_manager.LeaveEpoch(epoch_node_p);
 
-        // If leaf split fails this should be recyced using a fake remove node
-        NodeID new_node_id = GetNextNodeID();
+        return false;
+      }
 
-        // Note that although split node only stores the new node ID
-        // we still need its pointer to compute item_count
-        const LeafSplitNode *split_node_p = \
-          LeafInlineAllocateOfType(LeafSplitNode, 
-                                   node_p, 
-                                   std::make_pair(split_key, new_node_id),
-                                   node_p,
-                                   new_leaf_node_p);
+      if(InstallUpdateNode(&context,
+                           old_value,
+                           new_value,
+                           old_index_pair,
+                           new_index_pair) == true) {
+        break;
+      }
 
-        //  First install the NodeID -> split sibling mapping
-        // If CAS fails we also need to recycle the node ID allocated here
-        InstallNewNode(new_node_id, new_leaf_node_p);
+      #ifdef BWTREE_DEBUG
 
-        // Then CAS split delta into current node's NodeID
-        bool ret = InstallNodeToReplace(node_id, split_node_p, node_p);
+      update_abort_count.fetch_add(context.abort_counter);
 
-        if(ret == true) {
-          bwt_printf("Leaf split delta (from %lu to %lu) CAS succeeds. ABORT\n",
-                     node_id,
-                     new_node_id);
+      #endif
 
-          // TODO: WE ABORT HERE TO AVOID THIS THREAD POSTING ANYTHING
-          // ON TOP OF IT WITHOUT HELPING ALONG AND ALSO BLOCKING OTHER
-          // THREAD TO HELP ALONG
-          context_p->abort_flag = true;
+      bwt_printf("Retry installing leaf update delta from the root\n");
+    }
 
-          return;
-        } else {
-          bwt_printf("Leaf split delta CAS fails\n");
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
-          // Need to use the epoch manager to recycle NodeID
-          // Note that this node must not be created on new_leaf_node_p
-          // since they are both put into the GC chain, it is possible
-          // for new_leaf_node_p to be deleted first and then remove node
-          // is deleted
-          const LeafRemoveNode *fake_remove_node_p = \
-            new LeafRemoveNode{new_node_id, 
-                               new_leaf_node_p};
+    return true;
+  }
 
-          // Must put both of them into GC chain since RemoveNode
-          // will not be followed by GC thread
-          epoch_manager.AddGarbageNode(fake_remove_node_p);
-          epoch_manager.AddGarbageNode(new_leaf_node_p);
+  /*
+   * Upsert() - Sets the value of a key, inserting the key if it does not
+   *            exist
+   *
+   * If the key does not have any value then the key-value pair is inserted
+   * and this function returns true. Otherwise one of its values is replaced
+   * with a single LeafUpdateNode and this function returns false. If the
+   * value is already associated with the key then nothing is posted
+   *
+   * NOTE: This is designed for keys with at most one value. If the key has
+   * multiple values then only one of them is replaced
+   */
+  bool Upsert(const KeyType &key, const ValueType &value) {
+    bwt_printf("Upsert called\n");
 
-          // We have two nodes to delete here
-          split_node_p->~LeafSplitNode();
+    #ifdef BWTREE_DEBUG
+    update_op_count.fetch_add(1);
+    #endif
 
-          return;
-        }
+    AddStatistics(&ThreadStatistics::update_op_count);
 
-      } else if(node_size <= LEAF_NODE_SIZE_LOWER_THRESHOLD) {
-        // This might yield a false positive of left child
-        // but correctness is not affected - sometimes the merge is delayed
-        if(IsOnLeftMostChild(context_p) == true) {
-          bwt_printf("Left most leaf node cannot be removed\n");
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-          return;
-        }
+    // The leaf of the last failed installation (see SetLeafRetryMode())
+    NodeID retry_node_id = INVALID_NODE_ID;
 
-        // After this point we decide to remove leaf node
+    while(1) {
+      Context context{key};
+      std::pair<int, bool> new_index_pair;
 
-        bwt_printf("Node size <= leaf lower threshold. Remove\n");
+      const KeyValuePair *item_p = \
+        TraverseWithFinger(&context,
+                           &value,
+                           &new_index_pair,
+                           retry_node_id);
 
-        // Install an abort node on parent
-        const BaseNode *abort_node_p;
-        const BaseNode *abort_child_node_p;
-        NodeID parent_node_id;
+      SampleLeafWrite(&context);
 
-        bool abort_node_ret = \
-          PostAbortOnParent(context_p,
-                            &parent_node_id,
-                            &abort_node_p,
-                            &abort_child_node_p);
+      if(item_p != nullptr) {
+        epoch_manager.LeaveEpoch(epoch_node_p);
 
-        // If we could not block the parent then the parent has changed
-        // (splitted, etc.)
-        if(abort_node_ret == true) {
-          bwt_printf("Blocked parent node (current node is leaf)\n");
-        } else {
-          bwt_printf("Unable to block parent node "
-                     "(current node is leaf). ABORT\n");
+        return false;
+      }
 
-          // ABORT and return
-          context_p->abort_flag = true;
+      // Find an existing value on the same leaf
+      const KeyValuePair *old_item_p = nullptr;
+      std::pair<int, bool> old_index_pair;
 
-          return;
+      if(UniqueKey == true) {
+        old_item_p = NavigateLeafNodeUnique(&context, &old_index_pair);
+      } else {
+        std::vector<ValueType> value_list{};
+        NavigateLeafNode(&context, value_list);
+        assert(context.abort_flag == false);
+
+        if(value_list.size() > 0UL) {
+          old_item_p = \
+            NavigateLeafNode(&context, value_list[0], &old_index_pair);
+          assert(old_item_p != nullptr);
         }
+      }
 
-        const LeafRemoveNode *remove_node_p = \
-          new LeafRemoveNode{node_id, 
-                             node_p};
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
+      const BaseNode *node_p = snapshot_p->node_p;
 
-        bool ret = InstallNodeToReplace(node_id, remove_node_p, node_p);
-        if(ret == true) {
-          bwt_printf("LeafRemoveNode CAS succeeds. ABORT.\n");
+      if(old_item_p == nullptr) {
+        const LeafInsertNode *insert_node_p = \
+          LeafInlineAllocateOfType(LeafInsertNode,
+                                   node_p,
+                                   key,
+                                   GetSearchKeyHash(&context),
+                                   value,
+                                   node_p,
+                                   new_index_pair,
+                                   GetCurrentVersion());
 
-          context_p->abort_flag = true;
+        if(InstallLeafDelta(snapshot_p->node_id,
+                            insert_node_p,
+                            node_p) == true) {
+          InvalidateReadCache(key);
+          AddStatistics(&ThreadStatistics::item_insert_count);
 
-          RemoveAbortOnParent(parent_node_id,
-                              abort_node_p,
-                              abort_child_node_p);
+          epoch_manager.LeaveEpoch(epoch_node_p);
 
-          return;
-        } else {
-          bwt_printf("LeafRemoveNode CAS failed\n");
+          return true;
+        }
 
-          delete remove_node_p;
+        insert_node_p->~LeafInsertNode();
 
-          context_p->abort_flag = true;
+        if(leaf_retry_flag == true) {
+          retry_node_id = snapshot_p->node_id;
+        }
 
-          RemoveAbortOnParent(parent_node_id,
-                              abort_node_p,
-                              abort_child_node_p);
+        AddStatistics(&ThreadStatistics::update_abort_count);
 
-          return;
+        #ifdef BWTREE_DEBUG
+
+        context.abort_counter++;
+
+        #endif
+      } else {
+        if(InstallUpdateNode(&context,
+                             old_item_p->second,
+                             value,
+                             old_index_pair,
+                             new_index_pair) == true) {
+          epoch_manager.LeaveEpoch(epoch_node_p);
+
+          return false;
         }
       }
-    } else {   // If this is an inner node
-      const InnerNode *inner_node_p = static_cast<const InnerNode *>(node_p);
 
-      size_t node_size = inner_node_p->GetSize();
+      #ifdef BWTREE_DEBUG
 
-      if(node_size >= INNER_NODE_SIZE_UPPER_THRESHOLD) {
-        bwt_printf("Node size >= inner upper threshold. Split\n");
+      update_abort_count.fetch_add(context.abort_counter);
 
-        const InnerNode *new_inner_node_p = inner_node_p->GetSplitSibling();
+      #endif
 
-        // Since this is a split sibling, the low key must be a valid key
-        // NOTE: Only for InnerNodes could we call GetLowKey()
-        const KeyType &split_key = new_inner_node_p->GetLowKey();
+      bwt_printf("Retry installing leaf upsert delta from the root\n");
+    }
 
-        // New node has at least one item (this is the basic requirement)
-        assert(new_inner_node_p->GetSize() > 0);
+    assert(false);
+    return false;
+  }
 
-        const KeyNodeIDPair &first_item = new_inner_node_p->At(0);
-        
-        // This points to the left most node on the right split sibling
-        // If this node is being removed then we abort
-        NodeID split_key_child_node_id = first_item.second;
+  /*
+   * InstallUpdateNode() - Posts a LeafUpdateNode on the current leaf of the
+   *                       context
+   *
+   * Returns false if CAS fails, in which case the operation should be
+   * retried from the root
+   */
+  bool InstallUpdateNode(Context *context_p,
+                         const ValueType &old_value,
+                         const ValueType &new_value,
+                         std::pair<int, bool> old_index_pair,
+                         std::pair<int, bool> new_index_pair) {
+    NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(context_p);
 
-        // This must be the split key
-        assert(KeyCmpEqual(first_item.first, split_key));
+    // We will CAS on top of this
+    const BaseNode *node_p = snapshot_p->node_p;
+    NodeID node_id = snapshot_p->node_id;
 
-        // NOTE: WE FETCH THE POINTER WITHOUT HELP ALONG SINCE WE ARE
-        // NOW ON ITS PARENT
-        const BaseNode *split_key_child_node_p = \
-          GetNode(split_key_child_node_id);
+    const LeafUpdateNode *update_node_p = \
+      LeafInlineAllocateOfType(LeafUpdateNode,
+                               node_p,
+                               context_p->search_key,
+                               GetSearchKeyHash(context_p),
+                               old_value,
+                               new_value,
+                               node_p,
+                               old_index_pair,
+                               new_index_pair,
+                               GetCurrentVersion());
+
+    bool ret = InstallNodeToReplace(node_id,
+                                    update_node_p,
+                                    node_p);
+    if(ret == true) {
+      bwt_printf("Leaf Update delta CAS succeed\n");
 
-        // If the type is remove then we just continue without abort
-        // If we abort then it might introduce deadlock
-        if(split_key_child_node_p->IsRemoveNode()) {
-          bwt_printf("Found a removed node on split key child. CONTINUE \n");
+      InvalidateReadCache(context_p->search_key);
+    } else {
+      bwt_printf("Leaf Update delta CAS failed\n");
 
-          // Put the new inner node into GC chain
-          // Although it is not entirely necessary it is good for us to
-          // make is so to avoid redundant code here
-          epoch_manager.AddGarbageNode(new_inner_node_p);
+      AddStatistics(&ThreadStatistics::update_abort_count);
 
-          return;
-        }
+      update_node_p->~LeafUpdateNode();
+
+      #ifdef BWTREE_DEBUG
+
+      context_p->abort_counter++;
 
-        NodeID new_node_id = GetNextNodeID();
+      #endif
+    }
 
-        const InnerSplitNode *split_node_p = \
-          InnerInlineAllocateOfType(InnerSplitNode,
-                                    node_p,
-                                    std::make_pair(split_key, new_node_id),
-                                    node_p,
-                                    new_inner_node_p);
+    return ret;
+  }
 
-        //  First install the NodeID -> split sibling mapping
-        InstallNewNode(new_node_id, new_inner_node_p);
+  /*
+   * GetValue() - Fill a value list with values stored
+   *
+   * This function accepts a value list as argument,
+   * and will copy all values into the list
+   *
+   * The return value is used to indicate whether the value set
+   * is empty or not
+   */
+  void GetValue(const KeyType &search_key,
+                std::vector<ValueType> &value_list) {
+    bwt_printf("GetValue()\n");
 
-        // Then CAS split delta into current node's NodeID
-        bool ret = InstallNodeToReplace(node_id, split_node_p, node_p);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-        if(ret == true) {
-          bwt_printf("Inner split delta (from %lu to %lu) CAS succeeds."
-                     " ABORT\n", node_id, new_node_id);
+    AddStatistics(&ThreadStatistics::read_op_count);
 
-          // Same reason as in leaf node
-          context_p->abort_flag = true;
+    Context context{search_key};
 
-          return;
-        } else {
-          bwt_printf("Inner split delta CAS fails\n");
+    TraverseReadCached(&context,
+                       [&value_list](const ValueType &value) {
+                         value_list.push_back(value);
+                       });
 
-          // Use the epoch manager to recycle NodeID in single threaded
-          // environment
-          // Note that this remove node should be created on existing node
-          // rather than on new_inner_node_p, since new_inner_node_p may
-          // be destroyed before fake_remove_node_p is destroyed
-          const InnerRemoveNode *fake_remove_node_p = \
-            new InnerRemoveNode{new_node_id, 
-                                new_inner_node_p};
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
-          epoch_manager.AddGarbageNode(fake_remove_node_p);
-          epoch_manager.AddGarbageNode(new_inner_node_p);
+    return;
+  }
 
-          // Call destructor since it is allocated from the base InnerNode
-          split_node_p->~InnerSplitNode();
+  /*
+   * GetValue() - Copies the value of a key into value_p if keys are unique
+   *
+   * Returns false if the key does not exist, in which case value_p is not
+   * modified. This function does not allocate any memory
+   */
+  bool GetValue(const KeyType &search_key, ValueType *value_p) {
+    static_assert(UniqueKey == true,
+                  "GetValue() with a single value requires UniqueKey");
 
-          return;
-        } // if CAS fails
-      } else if(node_size <= INNER_NODE_SIZE_LOWER_THRESHOLD) {
-        if(context_p->IsOnRootNode() == true) {
-          bwt_printf("Root underflow - let it be\n");
+    bwt_printf("GetValue() (unique)\n");
 
-          return;
-        }
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-        // NOTE: If the parent node has changed (e.g. split on the current
-        // node's low key) we will not be able to catch it. But we will
-        // find it later by posting an InnerAbortNode on parent which would
-        // result in CAS failing and aborting
+    AddStatistics(&ThreadStatistics::read_op_count);
 
-        // We could not remove leftmost node
-        if(IsOnLeftMostChild(context_p) == true) {
-          bwt_printf("Left most inner node cannot be removed\n");
+    Context context{search_key};
+    bool found_flag = false;
 
-          return;
-        }
+    // In unique key mode the visitor is called at most once
+    TraverseReadCached(&context,
+                       [value_p, &found_flag](const ValueType &value) {
+                         *value_p = value;
+                         found_flag = true;
+                       });
 
-        // After this point we decide to remove
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
-        bwt_printf("Node size <= inner lower threshold. Remove\n");
+    return found_flag;
+  }
 
-        // Then we abort its parent node
-        // These two are used to hold abort node and its previous child
-        const BaseNode *abort_node_p;
-        const BaseNode *abort_child_node_p;
-        NodeID parent_node_id;
+  /*
+   * GetValue() - Copies at most value_cap values of a key into a caller
+   *              provided buffer
+   *
+   * The return value is the total number of values of the key. If it is
+   * greater than value_cap then the buffer has overflown, and only the first
+   * value_cap values (in no particular order) are copied. This function does
+   * not allocate any memory
+   */
+  size_t GetValue(const KeyType &search_key,
+                  ValueType *value_buffer_p,
+                  size_t value_cap) {
+    bwt_printf("GetValue() (buffer)\n");
 
-        bool abort_node_ret = \
-          PostAbortOnParent(context_p,
-                            &parent_node_id,
-                            &abort_node_p,
-                            &abort_child_node_p);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-        // If we could not block the parent then the parent has changed
-        // (splitted, etc.)
-        if(abort_node_ret == true) {
-          bwt_printf("Blocked parent node (current node is inner)\n");
-        } else {
-          bwt_printf("Unable to block parent node "
-                     "(current node is inner). ABORT\n");
+    AddStatistics(&ThreadStatistics::read_op_count);
 
-          // ABORT and return
-          context_p->abort_flag = true;
+    Context context{search_key};
+    size_t value_count = 0UL;
 
-          return;
-        }
+    TraverseReadCached(&context,
+                       [value_buffer_p,
+                        value_cap,
+                        &value_count](const ValueType &value) {
+                         if(value_count < value_cap) {
+                           value_buffer_p[value_count] = value;
+                         }
 
-        const InnerRemoveNode *remove_node_p = \
-          new InnerRemoveNode{node_id, 
-                              node_p};
+                         value_count++;
+                       });
 
-        bool ret = InstallNodeToReplace(node_id, remove_node_p, node_p);
-        if(ret == true) {
-          bwt_printf("InnerRemoveNode CAS succeeds. ABORT\n");
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
-          // We abort after installing a node remove delta
-          context_p->abort_flag = true;
+    return value_count;
+  }
 
-          // Even if we success we need to remove the abort
-          // on the parent, and let parent split thread to detect the remove
-          // delta on child
-          RemoveAbortOnParent(parent_node_id,
-                              abort_node_p,
-                              abort_child_node_p);
+  /*
+   * VisitValue() - Calls the visitor once on each value of a key
+   *
+   * The visitor is a callable taking const ValueType &. It is called inside
+   * the epoch, so it should be short and must not call into the tree
+   */
+  template <typename ValueVisitor>
+  void VisitValue(const KeyType &search_key, ValueVisitor &&visitor) {
+    bwt_printf("VisitValue()\n");
 
-          return;
-        } else {
-          bwt_printf("InnerRemoveNode CAS failed\n");
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-          delete remove_node_p;
+    AddStatistics(&ThreadStatistics::read_op_count);
 
-          // We must abort here since otherwise it might cause
-          // merge nodes to underflow
-          context_p->abort_flag = true;
+    Context context{search_key};
 
-          // Same as above
-          RemoveAbortOnParent(parent_node_id,
-                              abort_node_p,
-                              abort_child_node_p);
+    TraverseReadCached(&context, visitor);
 
-          return;
-        }
-      } // if split/remove
-    }
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
     return;
   }
 
   /*
-   * RemoveAbortOnParent() - Removes the abort node on the parent
+   * GetValue() - Return value in a ValueSet object
    *
-   * This operation must succeeds since only the thread that installed
-   * the abort node could remove it
+   * This is used for verification in the benchmark test suite. Do not
+   * remove this method
    */
-  void RemoveAbortOnParent(NodeID parent_node_id,
-                           const BaseNode *abort_node_p,
-                           const BaseNode *abort_child_node_p) {
-    bwt_printf("Remove abort on parent node\n");
+  ValueSet GetValue(const KeyType &search_key) {
+    bwt_printf("GetValue()\n");
 
-    // We switch back to the child node (so it is the target)
-    bool ret = \
-      InstallNodeToReplace(parent_node_id, abort_child_node_p, abort_node_p);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    // This CAS must succeed since nobody except this thread could remove
-    // the ABORT delta on parent node
-    assert(ret == true);
-    (void)ret;
+    AddStatistics(&ThreadStatistics::read_op_count);
 
-    // NOTE: DO NOT FORGET TO REMOVE THE ABORT AFTER
-    // UNINSTALLING IT FROM THE PARENT NODE
-    // NOTE 2: WE COULD NOT DIRECTLY DELETE THIS NODE
-    // SINCE SOME OTHER NODES MIGHT HAVE TAKEN A SNAPSHOT
-    // AND IF ABORT NODE WAS REMOVED, THE TYPE INFORMATION
-    // CANNOT BE PRESERVED AND IT DOES NOT ABORT; INSTEAD
-    // IT WILL TRY TO CALL CONSOLIDATE ON ABORT
-    // NODE, CAUSING TYPE ERROR
-    //delete (InnerAbortNode *)abort_node_p;
+    Context context{search_key};
 
-    // This delays the deletion of abort node until all threads has exited
-    // so that existing pointers to ABORT node remain valid
-    // GC does not follow the delta chain of ABORT node
-    epoch_manager.AddGarbageNode(abort_node_p);
+    ValueSet value_set{10, value_hash_obj, value_eq_obj};
 
-    return;
+    // Values go into the set directly without a temporary list
+    TraverseReadCached(&context,
+                       [&value_set](const ValueType &value) {
+                         value_set.insert(value);
+                       });
+
+    epoch_manager.LeaveEpoch(epoch_node_p);
+
+    return value_set;
   }
 
   /*
-   * PostAbortOnParent() - Posts an inner abort node on the parent
+   * GetValueBatch() - Fill a list of value lists for a batch of keys
    *
-   * This function blocks all accesses to the parent node, and blocks
-   * all CAS efforts for threads that took snapshots before the CAS
-   * in this function.
+   * The i-th element of value_list_p receives values of key_list[i], in the
+   * same way as GetValue() does for a single key. Keys are probed in sorted
+   * order (if sorted_flag is false we sort an index list first, without
+   * moving keys), and the whole batch runs inside a single epoch.
    *
-   * Return false if CAS failed. In that case the memory is freed
-   * by this function
+   * Since consecutive keys tend to fall on the same leaf, we remember the
+   * NodeID of the last leaf and reload it directly from the mapping table.
+   * If its current range [low key, high key) still covers the next key then
+   * the leaf is navigated without descending from the root. Otherwise, or if
+   * the node has been removed, we fall back to a full read optimized traversal
    *
-   * This function DOES NOT ABORT. Do not have to check for abort flag. But
-   * if CAS fails then returns false, and caller needs to abort after
-   * checking the return value.
+   * NOTE: Reloading the NodeID is safe since it could only be recycled after
+   * all threads that have seen the remove node leave their epoch
    */
-  bool PostAbortOnParent(Context *context_p,
-                         NodeID *parent_node_id_p,
-                         const BaseNode **abort_node_p_p,
-                         const BaseNode **abort_child_node_p_p) {
-    // This will make sure the path list has length >= 2
-    NodeSnapshot *parent_snapshot_p = \
-      GetLatestParentNodeSnapshot(context_p);
+  void GetValueBatch(const KeyType *key_list,
+                     size_t key_num,
+                     std::vector<ValueType> *value_list_p,
+                     bool sorted_flag = false) {
+    bwt_printf("GetValueBatch()\n");
+
+    // This is used only when keys are not sorted by the caller
+    std::vector<size_t> order_list{};
+    if(sorted_flag == false) {
+      order_list.resize(key_num);
+      for(size_t i = 0;i < key_num;i++) {
+        order_list[i] = i;
+      }
 
-    const BaseNode *parent_node_p = parent_snapshot_p->node_p;
-    NodeID parent_node_id = parent_snapshot_p->node_id;
+      std::sort(order_list.begin(),
+                order_list.end(),
+                [this, key_list](size_t index_1, size_t index_2) {
+                  return this->KeyCmpLess(key_list[index_1],
+                                          key_list[index_2]);
+                });
+    }
 
-    // Save original node pointer
-    *abort_child_node_p_p = parent_node_p;
-    *parent_node_id_p = parent_node_id;
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    InnerAbortNode *abort_node_p = \
-      new InnerAbortNode{parent_node_p};
+    AddStatistics(&ThreadStatistics::read_op_count, key_num);
 
-    bool ret = InstallNodeToReplace(parent_node_id,
-                                    abort_node_p,
-                                    parent_node_p);
+    if(prefetch_flag == true) {
+      for(size_t i = 0;i < key_num;i += BATCH_PREFETCH_GROUP_SIZE) {
+        size_t group_size = std::min(BATCH_PREFETCH_GROUP_SIZE, key_num - i);
 
-    if(ret == true) {
-      bwt_printf("Inner Abort node CAS succeeds\n");
+        GetValueGroupInterleaved(key_list,
+                                 (sorted_flag == true) ? \
+                                   nullptr : (order_list.data() + i),
+                                 i,
+                                 group_size,
+                                 value_list_p);
+      }
 
-      // Copy the new node to caller since after posting remove delta we will
-      // remove this abort node to enable accessing again
-      *abort_node_p_p = abort_node_p;
-    } else {
-      bwt_printf("Inner Abort node CAS failed\n");
+      epoch_manager.LeaveEpoch(epoch_node_p);
 
-      delete abort_node_p;
+      return;
     }
 
-    return ret;
+    // The leaf node the previous key lands on
+    NodeID leaf_node_id = INVALID_NODE_ID;
+
+    for(size_t i = 0;i < key_num;i++) {
+      size_t index = (sorted_flag == true) ? i : order_list[i];
+      Context context{key_list[index]};
+
+      if(leaf_node_id != INVALID_NODE_ID) {
+        LoadNodeIDReadOptimized(leaf_node_id, &context);
+
+        if((context.abort_flag == false) &&
+           (IsKeyInNodeRange(context.search_key,
+                             context.current_snapshot.node_p) == true)) {
+          // The key is within range so NavigateSiblingChain() inside this
+          // function does not jump, and it could not abort
+          NavigateLeafNode(&context, value_list_p[index]);
+          assert(context.abort_flag == false);
+
+          continue;
+        }
+
+        bwt_printf("Batch key out of cached leaf range; re-traverse\n");
+
+        // Restore the context to its initial state for a full traversal
+        context.abort_flag = false;
+
+        #ifdef BWTREE_DEBUG
+        context.current_level = -1;
+        #endif
+      }
+
+      TraverseReadOptimized(&context, value_list_p + index);
+
+      leaf_node_id = context.current_snapshot.node_id;
+    }
+
+    epoch_manager.LeaveEpoch(epoch_node_p);
+
+    return;
   }
 
   /*
-   * NavigateInnerNode() - Given a parent snapshot and a key, return the item
-   *                       with the same key if that item exists
-   *
-   * This function checks whether a given key exists in the current
-   * inner node delta chain. If it exists then return a pointer to the
-   * item, otherwise return nullptr.
-   *
-   * This function is called when completing both split SMO and merge SMO
-   * For split SMO we need to check, key range and key existance, and
-   * NodeID value, to avoid mssing a few InnerDeleteNode on the parent node.
-   * However, for merge SMO, we only check key existence.
-   *
-   * Note: This function does not abort. Any extra checking (e.g. whether
-   * NodeIDs match, whether key is inside range) should be done by the caller
-   *
-   * Note 2: index_pair_p always reflects the relative position of the search
-   * key inside this InnerNode, no matter nullptr or non-null pointer is 
-   * returned, the integer inside the pair is always the index for all keys
-   * >= the search key. Currently the secong component is not set and not
-   * used
+   * GetValueGroupInterleaved() - Looks up a group of keys with interleaved
+   *                              traversals
+   *
+   * All keys advance one level per round. In the first pass of a round the
+   * nodes to be loaded are prefetched (their mapping table slots having
+   * been prefetched in the previous round), and in the second pass each key
+   * loads its node and either navigates the inner node, prefetching the
+   * mapping table slot of the child, or collects values on the leaf. Memory
+   * accesses of one key thus overlap with the search of the other keys
+   *
+   * Keys i to i + group_size - 1 are looked up, in the order given by
+   * order_list_p if it is not nullptr. If the traversal of a key aborts then
+   * it is retried alone with TraverseReadOptimized()
+   *
+   * NOTE: This must be called inside an epoch
    */
-  const KeyNodeIDPair *NavigateInnerNode(NodeSnapshot *snapshot_p,
-                                         const KeyType &search_key,
-                                         const KeyNodeIDPair **location) {
-    // Save some keystrokes
-    const BaseNode *node_p = snapshot_p->node_p;
-    
-     // This is used to recognize the leftmost branch if there is
-     // a merge node
-     const KeyNodeIDPair &low_key_pair = node_p->GetLowKeyPair();
-    
-    // The caller must make sure this is true
-    assert(node_p->GetNextNodeID() == INVALID_NODE_ID ||
-           KeyCmpLess(search_key, node_p->GetHighKey()));
+  void GetValueGroupInterleaved(const KeyType *key_list,
+                                const size_t *order_list_p,
+                                size_t start_index,
+                                size_t group_size,
+                                std::vector<ValueType> *value_list_p) {
+    assert(group_size <= BATCH_PREFETCH_GROUP_SIZE);
+
+    // Context objects could not be copied or moved, so they are constructed
+    // in place
+    alignas(Context) char context_buffer[sizeof(Context) * \
+                                         BATCH_PREFETCH_GROUP_SIZE];
+    Context *context_list = reinterpret_cast<Context *>(context_buffer);
+
+    size_t index_list[BATCH_PREFETCH_GROUP_SIZE];
+    NodeID next_node_id_list[BATCH_PREFETCH_GROUP_SIZE];
+    bool active_list[BATCH_PREFETCH_GROUP_SIZE];
+    size_t active_num = group_size;
+
+    NodeID root_node_id = root_id.load();
+    mapping_table.Prefetch(root_node_id);
+
+    AddStatistics(&ThreadStatistics::traversal_count, group_size);
+
+    for(size_t j = 0;j < group_size;j++) {
+      index_list[j] = (order_list_p == nullptr) ? \
+                      (start_index + j) : order_list_p[j];
+
+      new (context_list + j) Context{key_list[index_list[j]]};
+      next_node_id_list[j] = root_node_id;
+      active_list[j] = true;
+    }
 
-    while(1) {
-      switch(node_p->GetType()) {
-      case NodeType::InnerInsertType: {
-        const KeyNodeIDPair &insert_item = \
-          static_cast<const InnerInsertNode *>(node_p)->item;
+    while(active_num > 0UL) {
+      for(size_t j = 0;j < group_size;j++) {
+        if(active_list[j] == true) {
+          PrefetchNodeID(next_node_id_list[j]);
+        }
+      }
 
-        if(KeyCmpEqual(insert_item.first, search_key) == true) {
-          // Same key, same index
-          *location = static_cast<const InnerInsertNode *>(node_p)->location;
-          
-          return &insert_item;
+      for(size_t j = 0;j < group_size;j++) {
+        if(active_list[j] == false) {
+          continue;
         }
 
-        node_p = \
-          static_cast<const InnerInsertNode *>(node_p)->child_node_p;
+        Context *context_p = context_list + j;
+        std::vector<ValueType> *value_list_p_j = value_list_p + index_list[j];
 
-        break;
-      } // InnerInsertNode
-      case NodeType::InnerDeleteType: {
-        const KeyNodeIDPair &delete_item = \
-          static_cast<const InnerDeleteNode *>(node_p)->item;
+        LoadNodeIDReadOptimized(next_node_id_list[j], context_p);
 
-        if(KeyCmpEqual(delete_item.first, search_key) == true) {
-          *location = static_cast<const InnerDeleteNode *>(node_p)->location;
-          
-          return nullptr;
-        }
+        if(context_p->abort_flag == false) {
+          if(GetLatestNodeSnapshot(context_p)->IsLeaf() == true) {
+            NavigateLeafNode(context_p, *value_list_p_j);
 
-        node_p = \
-          static_cast<const InnerDeleteNode *>(node_p)->child_node_p;
+            if(context_p->abort_flag == false) {
+              active_list[j] = false;
+              active_num--;
 
-        break;
-      } // InnerDeleteNode
-      case NodeType::InnerType: {
-        const InnerNode *inner_node_p = static_cast<const InnerNode *>(node_p);
+              continue;
+            }
+          } else {
+            next_node_id_list[j] = NavigateInnerNode(context_p);
 
-        // DO NOT REMOVE THIS!!!!!!
-        // Unlike a NavigateInnerNode(Context *) which searches for child
-        // node ID, this function needs to cover all possible separators
-        // in the merged InnerNode (right branch)
-        const KeyNodeIDPair *start_it = inner_node_p->Begin();
+            if(context_p->abort_flag == false) {
+              mapping_table.Prefetch(next_node_id_list[j]);
 
-        // If we are on the leftmost branch of the inner node delta chain
-        // if there is a merge delta, then we should start searching from
-        // the second element. Otherwise always start search from the first
-        // element
-        if(low_key_pair.second == inner_node_p->At(0).second) {
-          start_it++;
+              continue;
+            }
+          }
         }
 
-        const KeyNodeIDPair *it = \
-          std::lower_bound(start_it,
-                           inner_node_p->End(),
-                           std::make_pair(search_key, INVALID_NODE_ID),
-                           key_node_id_pair_cmp_obj);
+        bwt_printf("Interleaved traversal aborts; retry alone\n");
 
-        // Just give the location information by assigning to location
-        *location = it;
+        AddStatistics(&ThreadStatistics::traversal_abort_count);
 
-        if(it == inner_node_p->End()) {
-          // This is special case since we could not compare the iterator
-          // If the key does not exist then return nullptr
-          return nullptr;
-        } else if(KeyCmpEqual(it->first, search_key) == false) {
-          // If found the lower bound but keys are different
-          // then also return nullptr
-          return nullptr;
-        } else {
-          // If found the lower bound and the key matches
-          // return the key
-          return it;
-        }
+        // Restore the context to its initial state for a full traversal
+        // NOTE: No value has been collected if NavigateLeafNode() aborts
+        context_p->abort_flag = false;
+        context_p->current_snapshot.node_id = INVALID_NODE_ID;
 
-        assert(false);
-        return nullptr;
-      } // InnerNode
-      case NodeType::InnerSplitType: {
-        // We must guarantee that the key must be inside the range
-        // of this function
-        // For split SMO this is true by extra checking
-        // For merge SMO this is implicitly true sunce the merge key
-        // should not be in another node, o.w. the high key has changed
-        node_p = \
-          static_cast<const InnerSplitNode *>(node_p)->child_node_p;
+        #ifdef BWTREE_DEBUG
+        context_p->current_level = -1;
+        #endif
 
-        break;
-      } // InnerSplitType
-      case NodeType::InnerMergeType: {
-        const KeyNodeIDPair &delete_item = \
-          static_cast<const InnerMergeNode *>(node_p)->delete_item;
+        TraverseReadOptimized(context_p, value_list_p_j);
 
-        // If the split key >= merge key then just go to the right branch
-        if(KeyCmpGreaterEqual(search_key, delete_item.first) == true) {
-          node_p = static_cast<const InnerMergeNode *>(node_p)->right_merge_p;
-        } else {
-          node_p = static_cast<const InnerMergeNode *>(node_p)->child_node_p;
-        }
+        active_list[j] = false;
+        active_num--;
+      }
+    }
 
-        break;
-      } // InnerMergeNode
-      default: {
-        bwt_printf("Unknown InnerNode type: %d", (int)node_p->GetType());
+    for(size_t j = 0;j < group_size;j++) {
+      context_list[j].~Context();
+    }
 
-        assert(false);
-        return nullptr;
-      } // default
-      } // switch
-    } // while(1)
+    return;
+  }
 
-    assert(false);
-    return nullptr;
+  /*
+   * IsKeyInNodeRange() - Returns true if low key <= key < high key
+   *
+   * -Inf low key and +Inf high key are identified by INVALID_NODE_ID in the
+   * low key pair and next node ID respectively
+   */
+  inline bool IsKeyInNodeRange(const KeyType &search_key,
+                               const BaseNode *node_p) const {
+    if((node_p->GetLowKeyPair().second != INVALID_NODE_ID) &&
+       (KeyCmpLess(search_key, node_p->GetLowKey()) == true)) {
+      return false;
+    }
+
+    return (node_p->GetNextNodeID() == INVALID_NODE_ID) || \
+           (KeyCmpLess(search_key, node_p->GetHighKey()) == true);
   }
-  
+
   /*
-   * FindLeftSibling() - Finds the left sibling of the current child node
-   *                     specified by a search key
+   * RangeScan() - Calls the callback on key value pairs in [low_key, high_key)
    *
-   * This function works in a way similar to how inner node delta chains
-   * are consolidated: We replay the log using sorted small set on all keys
-   * less than or equal to the search key, and then choose the second key
-   * in key order from high to low, after combing the content of InnerNode
-   * and the delta chain nodes
+   * Items are passed to callback(key, value) in key order, and at most
+   * limit items are passed. The number of items passed is returned
    *
-   * NOTE: search_key is the low key of the current node for which we are
-   * find the left sibling, not the search key of the current operation.
-   * These two might differ in the case of cascading remove node delta
+   * Unlike ForwardIterator, this function does not consolidate the entire
+   * logical leaf node. Only delta records and base node items inside the
+   * range are merged, and the scan stops as soon as the limit or high key
+   * is reached. This makes short range queries much cheaper
    *
-   * NOTE 2: This function could not deal with InnerMergeNode since the merge
-   * node imposes a non-consecutive storage for adjacent keys. As an alternative
-   * way of finding left sibling, whenever an InnerMergeNode is observed,
-   * the node will be consolidated and we use the plain InnerNode to
-   * continue searching
+   * NOTE: Callback is invoked outside of the epoch, after items of a leaf
+   * node have been copied, so it is safe to call other tree functions
+   * from the callback. Consistency is the same as ForwardIterator, i.e. each
+   * leaf node is read atomically, but not the range as a whole
    */
-  inline NodeID FindLeftSibling(const KeyType &search_key,
-                                NodeSnapshot *snapshot_p) {
+  template <typename CallbackType>
+  size_t RangeScan(const KeyType &low_key,
+                   const KeyType &high_key,
+                   size_t limit,
+                   CallbackType &&callback) {
+    return RangeScanCommon(low_key, &high_key, limit, callback);
+  }
 
-    // This will be changed during the traversal
-    const BaseNode *node_p = snapshot_p->node_p;
-    
-    // First check that the node is always in the range of the inner node
-    assert(node_p->GetNextNodeID() == INVALID_NODE_ID || \
-           KeyCmpLess(search_key, node_p->GetHighKey()));
-    
-    // We can only search for left sibling on inner delta chain
-    assert(node_p->IsOnLeafDeltaChain() == false);
-    
-    const InnerDataNode *data_node_list[node_p->GetDepth()];
+  /*
+   * RangeScan() - Calls the callback on key value pairs >= low_key
+   *
+   * This function is the same as the bounded version except that the range
+   * is only bounded by +Inf
+   */
+  template <typename CallbackType>
+  size_t RangeScan(const KeyType &low_key,
+                   size_t limit,
+                   CallbackType &&callback) {
+    return RangeScanCommon(low_key, nullptr, limit, callback);
+  }
 
-    // These two are used to compare InnerDataNode for < and == relation
+  /*
+   * RangeScanCommon() - Implements range scan with an optional high key
+   *
+   * We traverse to the leaf node containing the current start key, collect
+   * items inside the range, and then use the high key of the leaf as the
+   * next start key. Since the high key of a leaf always equals the low key
+   * of its right sibling, this never misses or duplicates items even if
+   * the leaf has been split or merged between two traversals
+   */
+  template <typename CallbackType>
+  size_t RangeScanCommon(const KeyType &low_key,
+                         const KeyType *high_key_p,
+                         size_t limit,
+                         CallbackType &callback) {
+    bwt_printf("RangeScan()\n");
+
+    KeyType start_key = low_key;
+    size_t item_count = 0UL;
+
+    // This is reused for all leaf nodes
+    std::vector<KeyValuePair> item_list{};
+
+    while(item_count < limit) {
+      if((high_key_p != nullptr) && \
+         (KeyCmpLess(start_key, *high_key_p) == false)) {
+        break;
+      }
 
-    // NOTE: For this function we reverse the direction of comparison,
-    // i.e. the order is big-to-small to make iteration a little bit easier
-    auto f1 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
-                      return this->KeyCmpLess(idn_2->item.first, idn_1->item.first);
-                      //                          ^ <-------------> ^
-                    };
+      EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    auto f2 = [this](const InnerDataNode *idn_1, const InnerDataNode *idn_2) {
-                      return this->KeyCmpEqual(idn_1->item.first, idn_2->item.first);
-                    };
+      // Compressed leaves are decoded by CollectRangeOnLeaf()
+      Context context{start_key};
+      context.read_only_flag = true;
+      Traverse(&context, nullptr, nullptr);
 
-    SortedSmallSet<const InnerDataNode *, decltype(f1), decltype(f2)> \
-      sss{data_node_list, f1, f2};
+      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
+      const BaseNode *node_p = snapshot_p->node_p;
 
-    while(1) {
-      NodeType type = node_p->GetType();
+      item_list.clear();
+      CollectRangeOnLeaf(node_p,
+                         &start_key,
+                         high_key_p,
+                         limit - item_count,
+                         &item_list);
+
+      // Copy the high key before leaving the epoch since the node
+      // might be recycled after that
+      bool is_last_leaf = (node_p->GetNextNodeID() == INVALID_NODE_ID);
+      if(is_last_leaf == false) {
+        start_key = node_p->GetHighKey();
+      }
 
-      switch(type) {
-        case NodeType::InnerType: {
-          const InnerNode *inner_node_p = \
-            static_cast<const InnerNode *>(node_p);
-            
-          ///////////////////////////////////////////////////////////
-          // First find the nearest sep key <= search key on InnerNode
-          ///////////////////////////////////////////////////////////
+      epoch_manager.LeaveEpoch(epoch_node_p);
 
-          // This is the logical end of the array
-          const KeyNodeIDPair *end_it = inner_node_p->End();
+      for(const KeyValuePair &item : item_list) {
+        callback(item.first, item.second);
+      }
 
-          // Since we know the search key must be one of the key inside
-          // the inner node, lower bound is sufficient
-          auto it1 = std::upper_bound(inner_node_p->Begin() + 1,
-                                      end_it,
-                                      std::make_pair(search_key, INVALID_NODE_ID),
-                                      key_node_id_pair_cmp_obj) - 1;
+      item_count += item_list.size();
 
-          // Note that it is possible for it1 to be begin()
-          // since it is not the real current node if the node id
-          // is actually found on the delta chain
-          
-          ///////////////////////////////////////////////////////////
-          // After this point, it is guaranteed:
-          //   1. it1 points to an element <= removed node's low key
-          //   2. sss.GetBegin() points to an element <= removed node's low key
-          //      * OR *
-          //      sss.GetBegin() == sss.GetEnd()
-          ///////////////////////////////////////////////////////////
-          
-          // We need to pop out 2 items
-          const KeyNodeIDPair *left_item_p = nullptr;
-          
-          int counter = 0;
-          
-          // Loop twice. Hope compiler expands this loop
-          while(counter < 2) {
-            if(sss.GetBegin() == sss.GetEnd()) {
-              left_item_p = &(*it1);
-              
-              it1--;
-              counter++;
-              
-              continue;
-            } else if(it1 == inner_node_p->Begin()) {
-              // We know the sss is not empty, so could always pop from it
-              if(sss.GetFront()->GetType() == NodeType::InnerInsertType) {
-                left_item_p = &(sss.GetFront()->item);
+      if(is_last_leaf == true) {
+        break;
+      }
+    }
+
+    return item_count;
+  }
+
+  /*
+   * ParallelScan() - Calls the visitor on key value pairs in [low_key,
+   *                  high_key) using multiple threads
+   *
+   * The range is cut into at most thread_num partitions holding roughly the
+   * same number of items (see GetScanPartitionKeys()), and each partition
+   * is scanned by its own thread in the same way as RangeScan(). The
+   * visitor is called as visitor(partition_id, key, value), where partition
+   * IDs are in [0, thread_num) and increase with keys. Items of the same
+   * partition are visited in key order by a single thread, so per-partition
+   * results could be kept without synchronization and concatenated in
+   * order of partition IDs. Returns the number of items visited
+   *
+   * NOTE: Visitors of different partitions run concurrently. If there is
+   * more than one partition then the worker threads are registered with
+   * RegisterThread(), and the calling thread only waits for them
+   */
+  template <typename VisitorType>
+  size_t ParallelScan(const KeyType &low_key,
+                      const KeyType &high_key,
+                      int thread_num,
+                      VisitorType &&visitor) {
+    return ParallelScanCommon(low_key, &high_key, thread_num, visitor);
+  }
+
+  /*
+   * ParallelScan() - Calls the visitor on key value pairs >= low_key using
+   *                  multiple threads
+   *
+   * This function is the same as the bounded version except that the range
+   * is only bounded by +Inf
+   */
+  template <typename VisitorType>
+  size_t ParallelScan(const KeyType &low_key,
+                      int thread_num,
+                      VisitorType &&visitor) {
+    return ParallelScanCommon(low_key, nullptr, thread_num, visitor);
+  }
+
+  /*
+   * ParallelScanCommon() - Implements parallel scan with an optional
+   *                        high key
+   */
+  template <typename VisitorType>
+  size_t ParallelScanCommon(const KeyType &low_key,
+                            const KeyType *high_key_p,
+                            int thread_num,
+                            VisitorType &visitor) {
+    bwt_printf("ParallelScan()\n");
+
+    assert(thread_num > 0);
+
+    if((high_key_p != nullptr) && \
+       (KeyCmpLess(low_key, *high_key_p) == false)) {
+      return 0UL;
+    }
+
+    std::vector<KeyType> boundary_list = \
+      GetScanPartitionKeys(low_key,
+                           high_key_p,
+                           static_cast<size_t>(thread_num));
+    const size_t partition_num = boundary_list.size() + 1;
+
+    std::atomic<size_t> item_count{0UL};
+    auto scan_partition = [&](size_t partition_id) {
+      const KeyType &start_key = \
+        partition_id == 0UL ? low_key : boundary_list[partition_id - 1];
+      const KeyType *end_key_p = \
+        partition_id + 1 == partition_num ? \
+          high_key_p : &boundary_list[partition_id];
+
+      auto callback = [&visitor, partition_id](const KeyType &key,
+                                               const ValueType &value) {
+        visitor(partition_id, key, value);
+      };
+
+      item_count.fetch_add( \
+        RangeScanCommon(start_key,
+                        end_key_p,
+                        static_cast<size_t>(-1),
+                        callback));
+    };
+
+    if(partition_num == 1UL) {
+      scan_partition(0);
+    } else {
+      std::vector<std::thread> thread_list{};
+      for(size_t i = 0;i < partition_num;i++) {
+        thread_list.emplace_back([&scan_partition, i]() {
+          BwTreeBase::RegisterThread();
+          scan_partition(i);
+        });
+      }
 
-                counter++;
-              }
-              
-              // This has to be done anyway
-              sss.PopFront();
-              
-              continue;
-            }
-            
-            // After this point it1-- is always valid since it is not begin()
-            
-            // If the two items are same
-            if(KeyCmpEqual(sss.GetFront()->item.first, it1->first)) {
-              // If a delete node and a sep item has the same key
-              if(sss.GetFront()->GetType() == NodeType::InnerDeleteType) {
-                it1--;
-              } else {
-                // Otherwise an insert node overrides existing key
-                left_item_p = &(sss.GetFront()->item);
-                
-                it1--;
-                
-                counter++;
-              }
-              
-              // This is common
-              sss.PopFront();
-            } else if(KeyCmpLess(sss.GetFront()->item.first, it1->first)) {
-              // If the inner node has larger sep item
-              // Otherwise an insert node overrides existing key
-              left_item_p = &(*it1);
+      for(std::thread &thread : thread_list) {
+        thread.join();
+      }
+    }
 
-              it1--;
+    return item_count.load();
+  }
 
-              counter++;
-            } else {
-              if(sss.GetFront()->GetType() == NodeType::InnerInsertType) {
-                // If the delta node has larger item then set left item p
-                // to delta item
-                left_item_p = &(sss.GetFront()->item);
+  /*
+   * GetScanPartitionKeys() - Returns keys that cut [low_key, high_key) into
+   *                          at most partition_num partitions
+   *
+   * Inner nodes are read level by level from the root, keeping only
+   * subtrees that intersect the range, until there are at least
+   * SCAN_PARTITION_SUBTREE_NUM subtrees per partition or the next level
+   * is the leaf level. The weight of a subtree is the item count of its
+   * node, i.e. the number of items of a leaf or the fanout of an inner node,
+   * and partitions are cut at low keys of subtrees such that they have
+   * roughly the same total weight. The returned keys are sorted, unique
+   * and inside the range. Fewer keys are returned if there are not enough
+   * subtrees
+   */
+  std::vector<KeyType> GetScanPartitionKeys(const KeyType &low_key,
+                                            const KeyType *high_key_p,
+                                            size_t partition_num) {
+    std::vector<KeyType> boundary_list{};
+    if(partition_num <= 1UL) {
+      return boundary_list;
+    }
 
-                counter++;
-              } 
-              
-              // This is common
-              sss.PopFront();
-            }
-          } // while counter < 2
-          
-          // This is the NodeID of the left sibling
-          return left_item_p->second;
-        } 
-        case NodeType::InnerInsertType: {
-          const InnerInsertNode *insert_node_p = \
-            static_cast<const InnerInsertNode *>(node_p);
+    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-          const KeyNodeIDPair &insert_item = insert_node_p->item;
+    // Subtrees of the current level, and the low key of each one clamped
+    // to low_key
+    std::vector<KeyNodeIDPair> subtree_list{};
+    subtree_list.push_back(std::make_pair(low_key, root_id.load()));
 
-          if(KeyCmpLessEqual(insert_item.first, search_key)) {
-            sss.Insert(insert_node_p);
-          }
+    std::vector<KeyNodeIDPair> next_subtree_list{};
 
-          node_p = insert_node_p->child_node_p;
+    bool leaf_level_flag = false;
 
-          break;
-        } // InnerInsertType
-        case NodeType::InnerDeleteType: {
-          const InnerDeleteNode *delete_node_p = \
-            static_cast<const InnerDeleteNode *>(node_p);
-            
-          const KeyNodeIDPair &delete_item = delete_node_p->item;
+    while((leaf_level_flag == false) && \
+          (subtree_list.size() < partition_num * SCAN_PARTITION_SUBTREE_NUM)) {
+      next_subtree_list.clear();
 
-          if(KeyCmpLessEqual(delete_item.first, search_key)) {
-            sss.Insert(delete_node_p);
-          }
-          
-          node_p = delete_node_p->child_node_p;
+      for(const KeyNodeIDPair &subtree : subtree_list) {
+        NodeSnapshot snapshot{subtree.second, nullptr};
+        snapshot.node_p = SkipTransientNode(GetNode(snapshot.node_id));
+
+        // All subtrees are on the same level
+        if(snapshot.IsLeaf() == true) {
+          leaf_level_flag = true;
 
           break;
-        } // InnerDeleteType
-        case NodeType::InnerSplitType: {
-          const InnerSplitNode *split_node_p = \
-            static_cast<const InnerSplitNode *>(node_p);
+        }
 
-          node_p = split_node_p->child_node_p;
+        InnerNode *consolidated_node_p = nullptr;
+        const InnerNode *inner_node_p = nullptr;
 
-          break;
-        } // case InnerSplitType
-        case NodeType::InnerMergeType: {
-          bwt_printf("Found merge node. "
-                     "Need consolidation to find left sibling\n");
+        if(snapshot.node_p->GetType() == NodeType::InnerType) {
+          inner_node_p = static_cast<const InnerNode *>(snapshot.node_p);
+        } else {
+          consolidated_node_p = CollectAllSepsOnInner(&snapshot);
+          inner_node_p = consolidated_node_p;
+        }
 
-          // Since we could not deal with merge delta, if there is
-          // a merge delta on the path, the only solution is to
-          // consolidate the inner node, and try to install it
-          //
-          // Even if installation fails, we need to prevserve the content
-          // of the consolidated node, so need to add it to the GC instead
-          // of directly releasing its memory
+        const KeyNodeIDPair *start_p = inner_node_p->Begin();
+        const KeyNodeIDPair *end_p = inner_node_p->End();
 
-          InnerNode *inner_node_p = \
-            CollectAllSepsOnInner(snapshot_p,
-                                  // Must +1 to avoid looping on the same depth
-                                  // without any consolidation
-                                  snapshot_p->node_p->GetDepth() + 1);
+        // Children whose key range lies completely out of the range are
+        // skipped. The first separator of a node is its low key, which
+        // is replaced by the low key of the subtree
+        for(const KeyNodeIDPair *it = start_p;it != end_p;it++) {
+          if((it + 1 != end_p) && \
+             (KeyCmpLessEqual((it + 1)->first, subtree.first) == true)) {
+            continue;
+          }
 
-          bool ret = InstallNodeToReplace(snapshot_p->node_id,
-                                          inner_node_p,
-                                          snapshot_p->node_p);
-                                          
-          if(ret == true) {
-            epoch_manager.AddGarbageNode(snapshot_p->node_p);
-            
-            snapshot_p->node_p = inner_node_p;
+          if((it != start_p) && \
+             (high_key_p != nullptr) && \
+             (KeyCmpLess(it->first, *high_key_p) == false)) {
+            break;
+          }
+
+          if((it == start_p) || \
+             (KeyCmpLess(it->first, subtree.first) == true)) {
+            next_subtree_list.push_back(std::make_pair(subtree.first,
+                                                       it->second));
           } else {
-            // This is necessary to preserve the content of the inner node
-            // while avoid memory leaks
-            epoch_manager.AddGarbageNode(inner_node_p);
+            next_subtree_list.push_back(*it);
           }
-          
-          // Next iteration will go directly into inner node we have
-          // just consolidated
-          node_p = inner_node_p;
-            
-          // This is important - since we just changed the entire node,
-          // the sss should be empty
-          sss.Invalidate();
-          
-          break;
-        } // InnerMergeType
-        default: {
-          bwt_printf("ERROR: Unknown node type = %d",
-                     static_cast<int>(type));
+        }
 
-          assert(false);
+        if(consolidated_node_p != nullptr) {
+          consolidated_node_p->~InnerNode();
+          consolidated_node_p->Destroy();
         }
-      } // switch type
-    } // while 1
+      }
 
-    // Should not reach here
-    assert(false);
-    return INVALID_NODE_ID;
-  }
+      if(leaf_level_flag == false) {
+        subtree_list.swap(next_subtree_list);
+      }
+    }
 
-  /*
-   * PostInnerMergeNode() - Post an inner merge node
-   */
-  bool PostInnerMergeNode(const NodeSnapshot *snapshot_p,
-                          const KeyType *merge_key_p,
-                          const BaseNode *merge_branch_p,
-                          NodeID deleted_node_id,
-                          const BaseNode **node_p_p) {
-    // This is the child node of merge delta
-    const BaseNode *node_p = snapshot_p->node_p;
-    NodeID node_id = snapshot_p->node_id;
+    // This holds prefix sums of weights
+    std::vector<uint64_t> weight_list{};
+    uint64_t total_weight = 0UL;
 
-    // Note that we allocate from merge_banch_p since node_p is deallocated
-    // first and then merge_branch_p, so if we allocate the merge node
-    // on node_p's base node it will be invalid for the second recursive call
-    const InnerMergeNode *merge_node_p = \
-      InnerInlineAllocateOfType(InnerMergeNode, 
-                                merge_branch_p,
-                                *merge_key_p,
-                                merge_branch_p,
-                                deleted_node_id,
-                                node_p);
+    for(const KeyNodeIDPair &subtree : subtree_list) {
+      int item_count = GetNode(subtree.second)->GetItemCount();
 
-    // Compare and Swap!
-    bool ret = InstallNodeToReplace(node_id, merge_node_p, node_p);
+      total_weight += static_cast<uint64_t>(std::max(item_count, 0));
+      weight_list.push_back(total_weight);
+    }
 
-    // If CAS fails we delete the node and return false
-    if(ret == false) {
-      merge_node_p->~InnerMergeNode();
-    } else {
-      *node_p_p = merge_node_p;
+    size_t index = 0UL;
+    for(size_t i = 1;i < partition_num;i++) {
+      const uint64_t target_weight = total_weight * i / partition_num;
+
+      // The first subtree that starts at or after the target weight
+      while((index < subtree_list.size()) && \
+            (weight_list[index] <= target_weight)) {
+        index++;
+      }
+
+      if(index >= subtree_list.size()) {
+        break;
+      }
+
+      // Boundaries must be strictly increasing and above the low key
+      const KeyType &boundary_key = subtree_list[index].first;
+      if(KeyCmpLessEqual(boundary_key, low_key) == true) {
+        continue;
+      }
+
+      if((boundary_list.empty() == false) && \
+         (KeyCmpLessEqual(boundary_key, boundary_list.back()) == true)) {
+        continue;
+      }
+
+      boundary_list.push_back(boundary_key);
     }
 
-    return ret;
+    epoch_manager.LeaveEpoch(epoch_node_p);
+
+    return boundary_list;
   }
-  
+
+  ///////////////////////////////////////////////////////////////////
+  // Cardinality estimation
+  ///////////////////////////////////////////////////////////////////
 
   /*
-   * PostLeafMergeNode() - Post an inner merge node
+   * GetItemCountSum() - Returns the number of items inserted minus the
+   *                     number of items deleted, as counted by threads
    */
-  bool PostLeafMergeNode(const NodeSnapshot *snapshot_p,
-                         const KeyType *merge_key_p,
-                         const BaseNode *merge_branch_p,
-                         NodeID deleted_node_id,
-                         const BaseNode **node_p_p) {
-    // This is the child node of merge delta
-    const BaseNode *node_p = snapshot_p->node_p;
-    NodeID node_id = snapshot_p->node_id;
+  int64_t GetItemCountSum() {
+    int64_t item_count = approximate_size_base;
 
-    // Must allocate on merge_branch_p, otherwise when recycle this
-    // delta chain, node_p is reclaimed first and then merge_branch_p,
-    // so if we allocate it on node_p, we will get an invalid reference
-    // for the second recursive call
-    const LeafMergeNode *merge_node_p = \
-      InnerInlineAllocateOfType(LeafMergeNode, 
-                                merge_branch_p,
-                                *merge_key_p,
-                                merge_branch_p,
-                                deleted_node_id,
-                                node_p);
+    for(size_t i = 0;i < segment_num.load();i++) {
+      const ThreadLocalSegment *segment_p = segment_list[i].load();
+      if(segment_p == nullptr) {
+        continue;
+      }
 
-    // Compare and Swap!
-    bool ret = InstallNodeToReplace(node_id, merge_node_p, node_p);
+      for(size_t j = 0;j < THREAD_LOCAL_SEGMENT_SIZE;j++) {
+        const ThreadStatistics &data = segment_p->statistics_list[j].data;
 
-    // If CAS fails we delete the node and return false
-    if(ret == false) {
-      merge_node_p->~LeafMergeNode();
-    } else {
-      *node_p_p = merge_node_p;
+        item_count += static_cast<int64_t>(data.item_insert_count.load());
+        item_count -= static_cast<int64_t>(data.item_delete_count.load());
+      }
     }
 
-    return ret;
+    return item_count;
   }
 
   /*
-   * Insert() - Insert a key-value pair
+   * GetApproximateSize() - Returns the number of key value pairs in the tree
    *
-   * This function returns false if value already exists
-   * If CAS fails this function retries until it succeeds
+   * The size is maintained with per-thread counters, so this function only
+   * sums a few counters of each thread slot without touching any node.
+   * It is exact when no modification is in progress; otherwise counters of
+   * concurrent operations might or might not be included
    */
-  bool Insert(const KeyType &key, const ValueType &value) {
-    bwt_printf("Insert called\n");
+  size_t GetApproximateSize() {
+    int64_t item_count = GetItemCountSum();
 
-    #ifdef BWTREE_DEBUG
-    insert_op_count.fetch_add(1);
-    #endif
+    return item_count > 0L ? static_cast<size_t>(item_count) : 0UL;
+  }
 
-    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
+  /*
+   * CountInnerSeparators() - Returns the number of separators of an inner
+   *                          node whose keys are <= the search key
+   *
+   * The low key is always counted. Insert and delete deltas on the chain
+   * are replayed, since the root in particular tends to have most of its
+   * separators in deltas, and only the branch of a merge delta containing
+   * the key is searched after counting all items of the left branch
+   */
+  size_t CountInnerSeparators(const KeyType &search_key,
+                              const BaseNode *node_p) const {
+    size_t count = 0UL;
 
     while(1) {
-      Context context{key};
-      std::pair<int, bool> index_pair;
-
-      // Check whether the key-value pair exists
-      // Also if the key previously exists in the delta chain
-      // then return the position of the node using next_key_p
-      // if there is none then return nullptr
-      const KeyValuePair *item_p = Traverse(&context, &value, &index_pair);
-
-      // If the key-value pair already exists then return false
-      if(item_p != nullptr) {
-        epoch_manager.LeaveEpoch(epoch_node_p);
-
-        return false;
-      }
-
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
-
-      // We will CAS on top of this
-      const BaseNode *node_p = snapshot_p->node_p;
-      NodeID node_id = snapshot_p->node_id;
+      switch(node_p->GetType()) {
+        case NodeType::InnerType: {
+          const InnerNode *inner_node_p = \
+            static_cast<const InnerNode *>(node_p);
 
-      const LeafInsertNode *insert_node_p = \
-        LeafInlineAllocateOfType(LeafInsertNode, 
-                                 node_p, 
-                                 key, 
-                                 value, 
-                                 node_p, 
-                                 index_pair);
+          return count + static_cast<size_t>(
+            KeyUpperBound(inner_node_p->Begin() + 1,
+                          inner_node_p->End(),
+                          search_key) - inner_node_p->Begin());
+        }
+        case NodeType::InnerInsertType: {
+          const InnerInsertNode *insert_node_p = \
+            static_cast<const InnerInsertNode *>(node_p);
 
-      bool ret = InstallNodeToReplace(node_id,
-                                      insert_node_p,
-                                      node_p);
-      if(ret == true) {
-        bwt_printf("Leaf Insert delta CAS succeed\n");
+          if(KeyCmpLess(search_key, insert_node_p->item.first) == false) {
+            count++;
+          }
 
-        // If install is a success then just break from the loop
-        // and return
-        break;
-      } else {
-        bwt_printf("Leaf insert delta CAS failed\n");
+          break;
+        }
+        case NodeType::InnerDeleteType: {
+          const InnerDeleteNode *delete_node_p = \
+            static_cast<const InnerDeleteNode *>(node_p);
 
-        #ifdef BWTREE_DEBUG
+          if(KeyCmpLess(search_key, delete_node_p->item.first) == false) {
+            count--;
+          }
 
-        context.abort_counter++;
-        
-        #endif
+          break;
+        }
+        case NodeType::InnerMergeType: {
+          const InnerMergeNode *merge_node_p = \
+            static_cast<const InnerMergeNode *>(node_p);
 
-        insert_node_p->~LeafInsertNode();
-      }
+          if(KeyCmpLess(search_key,
+                        merge_node_p->delete_item.first) == false) {
+            count += static_cast<size_t>(
+              merge_node_p->child_node_p->GetItemCount());
+            node_p = merge_node_p->right_merge_p;
+          } else {
+            node_p = merge_node_p->child_node_p;
+          }
 
-      #ifdef BWTREE_DEBUG
-      
-      // Update abort counter
-      // NOTE 1: We could not do this before return since the context
-      // object is cleared at the end of loop
-      // NOTE 2: Since Traverse() might abort due to other CAS failures
-      // context.abort_counter might be larger than 1 when
-      // LeafInsertNode installation fails
-      insert_abort_count.fetch_add(context.abort_counter);
-      
-      #endif
+          continue;
+        }
+        default:
+          break;
+      }
 
-      // We reach here only because CAS failed
-      bwt_printf("Retry installing leaf insert delta from the root\n");
+      node_p = static_cast<const DeltaNode *>(node_p)->child_node_p;
     }
 
-    epoch_manager.LeaveEpoch(epoch_node_p);
-
-    return true;
+    assert(false);
+    return 0UL;
   }
 
-#ifdef BWTREE_PELOTON
-
   /*
-   * ConditionalInsert() - Insert a key-value pair only if a given
-   *                       predicate fails for all values with a key
+   * EstimateKeyPosition() - Returns the approximate fraction of items whose
+   *                         keys are less than the search key
    *
-   * If return true then the value has been inserted
-   * If return false then the value is not inserted. The reason could be
-   * predicates returning true for one of the values of a given key
-   * or because the value is already in the index
+   * On each inner level the key falls into the i-th of the n children of
+   * the node, and each child is assumed to hold 1 / n of the items under
+   * the node. On the leaf the number of items before the key in the base
+   * node is divided by the size of the base node. Leaf deltas are not
+   * replayed since there are only a few compared with the leaf size
    *
-   * NOTE: We first test the predicate, and then test for duplicated values
-   * so predicate test result is always available
+   * NOTE: This function must be called inside an epoch
    */
-  bool ConditionalInsert(const KeyType &key,
-                         const ValueType &value,
-                         std::function<bool(const void *)> predicate,
-                         bool *predicate_satisfied) {
-    bwt_printf("Insert (cond.) called\n");
+  double EstimateKeyPosition(const KeyType &search_key) {
+    while(1) {
+      Context context{search_key};
 
-    #ifdef BWTREE_DEBUG
-    insert_op_count.fetch_add(1);
-    #endif
+      double position = 0.0;
+      double scale = 1.0;
 
-    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
+      LoadNodeIDReadOptimized(root_id.load(), &context);
 
-    while(1) {
-      Context context{key};
+      while(context.abort_flag == false) {
+        if(GetLatestNodeSnapshot(&context)->IsLeaf() == true) {
+          NavigateSiblingChain(&context);
+          if(context.abort_flag == true) {
+            break;
+          }
 
-      // This will just stop on the correct leaf page
-      // without traversing into it. Next we manually traverse
-      Traverse(&context, nullptr, nullptr);
+          const BaseNode *node_p = GetLatestNodeSnapshot(&context)->node_p;
+          size_t index = 0UL;
+          size_t base_size = 0UL;
 
-      *predicate_satisfied = false;
-      
-      // This is used to hold the index for which this delta will
-      // be applied to
-      std::pair<int, bool> index_pair;
+          if(node_p->GetType() == NodeType::LeafCompressedType) {
+            base_size = static_cast<size_t>(node_p->GetItemCount());
 
-      // Call navigate leaf node to test predicate and to test duplicates
-      const KeyValuePair *item_p = \
-        NavigateLeafNode(&context,
-                         value,
-                         &index_pair,
-                         predicate,
-                         predicate_satisfied);
-      
-      // We do not insert anything if predicate is satisfied
-      if(*predicate_satisfied == true) {
-        epoch_manager.LeaveEpoch(epoch_node_p);
-        
-        return false;
-      } else if(item_p != nullptr) {
-        epoch_manager.LeaveEpoch(epoch_node_p);
-        
-        return false;
-      }
+            DecodeLeafItems(
+              static_cast<const CompressedLeafNode *>(node_p),
+              [this, &search_key, &index](const KeyType &key,
+                                          const ValueType &) {
+                if(KeyCmpLess(key, search_key) == false) {
+                  return false;
+                }
 
-      // This retrieves the most up-to-date snapshot (which does not change)
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
+                index++;
 
-      // We will CAS on top of this
-      const BaseNode *node_p = snapshot_p->node_p;
-      NodeID node_id = snapshot_p->node_id;
+                return true;
+              });
+          } else {
+            const ElasticNode<KeyValuePair> *leaf_node_p = \
+              LeafNode::GetNodeHeader(&node_p->GetLowKeyPair());
+
+            index = static_cast<size_t>(
+              KeyLowerBound(leaf_node_p->Begin(),
+                            leaf_node_p->End(),
+                            search_key) - leaf_node_p->Begin());
+            base_size = static_cast<size_t>(leaf_node_p->End() - \
+                                            leaf_node_p->Begin());
+          }
 
-      // Here since we could not know which is the next key node
-      // just use child node as a cpnservative way of inserting
-      const LeafInsertNode *insert_node_p = \
-        LeafInlineAllocateOfType(LeafInsertNode, 
-                                 node_p, 
-                                 key, 
-                                 value, 
-                                 node_p, 
-                                 index_pair);
+          if(base_size > 0UL) {
+            position += scale * static_cast<double>(index) / \
+                        static_cast<double>(base_size);
+          }
 
-      bool ret = InstallNodeToReplace(node_id,
-                                      insert_node_p,
-                                      node_p);
-      if(ret == true) {
-        bwt_printf("Leaf Insert (cond.) delta CAS succeed\n");
+          return position;
+        }
 
-        // If install is a success then just break from the loop
-        // and return
-        break;
-      } else {
-        bwt_printf("Leaf insert (cond.) delta CAS failed\n");
+        NodeID child_node_id = NavigateInnerNode(&context);
+        if(context.abort_flag == true) {
+          break;
+        }
 
-        #ifdef BWTREE_DEBUG
+        // NavigateInnerNode() might have moved to a sibling
+        const BaseNode *node_p = GetLatestNodeSnapshot(&context)->node_p;
+        size_t index = CountInnerSeparators(search_key, node_p) - 1;
+        size_t node_size = static_cast<size_t>(node_p->GetItemCount());
 
-        context.abort_counter++;
-        
-        #endif
+        position += scale * static_cast<double>(index) / \
+                    static_cast<double>(node_size);
+        scale /= static_cast<double>(node_size);
 
-        insert_node_p->~LeafInsertNode();
+        LoadNodeIDReadOptimized(child_node_id, &context);
       }
 
-      #ifdef BWTREE_DEBUG
-
-      insert_abort_count.fetch_add(context.abort_counter);
-      
-      #endif
-
-      bwt_printf("Retry installing leaf insert (cond.) delta from the root\n");
+      AddStatistics(&ThreadStatistics::traversal_abort_count);
     }
 
-    epoch_manager.LeaveEpoch(epoch_node_p);
-
-    return true;
+    assert(false);
+    return 0.0;
   }
 
-#endif
-
-
   /*
-   * Delete() - Remove a key-value pair from the tree
-   *
-   * This function returns false if the key and value pair does not
-   * exist. Return true if delete succeeds
+   * EstimateCount() - Returns the approximate number of key value pairs in
+   *                   [low_key, high_key)
    *
-   * This functions shares a same structure with the Insert() one
+   * Only the paths from the root to the two boundary leaves are visited,
+   * without reading any other node. The positions of the two keys are
+   * estimated by EstimateKeyPosition(), and their difference is scaled by
+   * GetApproximateSize(). The estimate is accurate when nodes on the same
+   * level are of similar sizes, which is what splits and merges maintain
    */
-  bool Delete(const KeyType &key, const ValueType &value) {
-    bwt_printf("Delete called\n");
-
-    #ifdef BWTREE_DEBUG
-    delete_op_count.fetch_add(1);
-    #endif
+  size_t EstimateCount(const KeyType &low_key, const KeyType &high_key) {
+    if(KeyCmpLess(low_key, high_key) == false) {
+      return 0UL;
+    }
 
     EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    while(1) {
-      Context context{key};
-      std::pair<int, bool> index_pair;
+    double low_position = EstimateKeyPosition(low_key);
+    double high_position = EstimateKeyPosition(high_key);
 
-      // Navigate leaf nodes to check whether the key-value
-      // pair exists
-      const KeyValuePair *item_p = Traverse(&context, &value, &index_pair);
+    epoch_manager.LeaveEpoch(epoch_node_p);
 
-      if(item_p == nullptr) {
-        epoch_manager.LeaveEpoch(epoch_node_p);
+    if(high_position <= low_position) {
+      return 0UL;
+    }
 
-        return false;
-      }
+    double count = (high_position - low_position) * \
+                   static_cast<double>(GetApproximateSize());
 
-      NodeSnapshot *snapshot_p = GetLatestNodeSnapshot(&context);
+    return static_cast<size_t>(count + 0.5);
+  }
 
-      // We will CAS on top of this
-      const BaseNode *node_p = snapshot_p->node_p;
-      NodeID node_id = snapshot_p->node_id;
+  ///////////////////////////////////////////////////////////////////
+  // Sampling
+  ///////////////////////////////////////////////////////////////////
 
-      const LeafDeleteNode *delete_node_p = \
-        LeafInlineAllocateOfType(LeafDeleteNode, 
-                                 node_p, 
-                                 key, 
-                                 value, 
-                                 node_p, 
-                                 index_pair);
+  /*
+   * SkipTransientNode() - Returns the node below abort and remove deltas
+   *
+   * Same as FinishPartialSMOReadOptimized(), abort nodes are simply passed.
+   * A removed node is read as it was before the remove, instead of waiting
+   * for the merge to be finished by a writer
+   */
+  const BaseNode *SkipTransientNode(const BaseNode *node_p) const {
+    while(1) {
+      switch(node_p->GetType()) {
+        case NodeType::InnerAbortType:
+        case NodeType::InnerRemoveType:
+        case NodeType::LeafRemoveType:
+          node_p = static_cast<const DeltaNode *>(node_p)->child_node_p;
 
-      bool ret = InstallNodeToReplace(node_id,
-                                      delete_node_p,
-                                      node_p);
-      if(ret == true) {
-        bwt_printf("Leaf Delete delta CAS succeed\n");
+          break;
+        default:
+          return node_p;
+      }
+    }
 
-        // If install is a success then just break from the loop
-        // and return
-        break;
-      } else {
-        bwt_printf("Leaf Delete delta CAS failed\n");
+    assert(false);
+    return nullptr;
+  }
 
-        delete_node_p->~LeafDeleteNode();
+  /*
+   * SampleInnerChild() - Picks a child of an inner node with probability
+   *                      proportional to its item count
+   *
+   * Inner nodes with deltas are consolidated into a temporary node. The
+   * weight of a leaf child is its number of items, and the weight of an
+   * inner child is its fanout. weight_list_p is scratch space reused by
+   * the caller. Returns INVALID_NODE_ID if all children are empty
+   */
+  template <typename RandomEngine>
+  NodeID SampleInnerChild(NodeSnapshot *snapshot_p,
+                          RandomEngine &rng,
+                          std::vector<uint64_t> *weight_list_p) {
+    InnerNode *consolidated_node_p = nullptr;
+    const InnerNode *inner_node_p = nullptr;
+
+    if(snapshot_p->node_p->GetType() == NodeType::InnerType) {
+      inner_node_p = static_cast<const InnerNode *>(snapshot_p->node_p);
+    } else {
+      consolidated_node_p = CollectAllSepsOnInner(snapshot_p);
+      inner_node_p = consolidated_node_p;
+    }
 
-        #ifdef BWTREE_DEBUG
+    // This holds prefix sums of weights
+    weight_list_p->clear();
+    uint64_t total_weight = 0UL;
 
-        context.abort_counter++;
-        
-        #endif
-      }
+    for(const KeyNodeIDPair *it = inner_node_p->Begin();
+        it != inner_node_p->End();
+        it++) {
+      int item_count = GetNode(it->second)->GetItemCount();
 
-      #ifdef BWTREE_DEBUG
+      total_weight += static_cast<uint64_t>(std::max(item_count, 0));
+      weight_list_p->push_back(total_weight);
+    }
 
-      delete_abort_count.fetch_add(context.abort_counter);
-      
-      #endif
+    NodeID child_node_id = INVALID_NODE_ID;
 
-      // We reach here only because CAS failed
-      bwt_printf("Retry installing leaf delete delta from the root\n");
+    if(total_weight > 0UL) {
+      uint64_t weight = \
+        std::uniform_int_distribution<uint64_t>{0UL, total_weight - 1}(rng);
+      size_t index = static_cast<size_t>(
+        std::upper_bound(weight_list_p->begin(),
+                         weight_list_p->end(),
+                         weight) - weight_list_p->begin());
+
+      child_node_id = inner_node_p->Begin()[index].second;
     }
 
-    epoch_manager.LeaveEpoch(epoch_node_p);
+    if(consolidated_node_p != nullptr) {
+      consolidated_node_p->~InnerNode();
+      consolidated_node_p->Destroy();
+    }
 
-    return true;
+    return child_node_id;
   }
 
   /*
-   * GetValue() - Fill a value list with values stored
+   * SampleKeys() - Returns a random sample of key value pairs in the tree
    *
-   * This function accepts a value list as argument,
-   * and will copy all values into the list
+   * Each sample is taken by a random descent from the root, choosing a
+   * child by SampleInnerChild() on each level, and then an item of the leaf
+   * uniformly at random. Leaves with deltas are consolidated into a
+   * temporary node, and base leaves are read in place. Items of the same
+   * parent node are sampled uniformly, and items of different parents are
+   * sampled roughly uniformly since fanouts only approximate subtree sizes
    *
-   * The return value is used to indicate whether the value set
-   * is empty or not
+   * Samples are taken with replacement, under a single epoch. A descent
+   * ending in an empty leaf is retried from the root, and fewer than
+   * sample_num samples are only returned if the tree is (almost) empty
+   *
+   * RandomEngine is a standard random number engine, e.g. std::mt19937_64
    */
-  void GetValue(const KeyType &search_key,
-                std::vector<ValueType> &value_list) {
-    bwt_printf("GetValue()\n");
+  template <typename RandomEngine>
+  std::vector<KeyValuePair> SampleKeys(size_t sample_num, RandomEngine &rng) {
+    std::vector<KeyValuePair> sample_list{};
+    sample_list.reserve(sample_num);
+
+    std::vector<uint64_t> weight_list{};
 
     EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
 
-    Context context{search_key};
+    int retry_count = 0;
 
-    TraverseReadOptimized(&context, &value_list);
+    while(sample_list.size() < sample_num) {
+      NodeSnapshot snapshot{root_id.load(), nullptr};
+      snapshot.node_p = SkipTransientNode(GetNode(snapshot.node_id));
 
-    epoch_manager.LeaveEpoch(epoch_node_p);
+      while(snapshot.IsLeaf() == false) {
+        snapshot.node_id = SampleInnerChild(&snapshot, rng, &weight_list);
+        if(snapshot.node_id == INVALID_NODE_ID) {
+          break;
+        }
+
+        snapshot.node_p = SkipTransientNode(GetNode(snapshot.node_id));
+      }
+
+      // Inner nodes might only have empty leaves before they are merged,
+      // in which case the descent is retried
+      if(snapshot.node_id == INVALID_NODE_ID || \
+         snapshot.node_p->GetItemCount() <= 0) {
+        if(++retry_count < SAMPLE_DESCENT_RETRY_COUNT) {
+          continue;
+        }
+
+        // Probably the tree is empty
+        break;
+      }
 
-    return;
-  }
+      retry_count = 0;
 
-  /*
-   * GetValue() - Return value in a ValueSet object
-   *
-   * This is used for verification in the benchmark test suite. Do not
-   * remove this method
-   */
-  ValueSet GetValue(const KeyType &search_key) {
-    bwt_printf("GetValue()\n");
+      LeafNode *consolidated_node_p = nullptr;
+      const LeafNode *leaf_node_p = nullptr;
 
-    EpochNode *epoch_node_p = epoch_manager.JoinEpoch();
+      if(snapshot.node_p->GetType() == NodeType::LeafType) {
+        leaf_node_p = static_cast<const LeafNode *>(snapshot.node_p);
+      } else {
+        consolidated_node_p = CollectAllValuesOnLeaf(&snapshot);
+        leaf_node_p = consolidated_node_p;
+      }
 
-    Context context{search_key};
+      size_t leaf_size = static_cast<size_t>(leaf_node_p->GetSize());
+      size_t index = \
+        std::uniform_int_distribution<size_t>{0UL, leaf_size - 1}(rng);
+      sample_list.push_back(leaf_node_p->Begin()[index]);
 
-    std::vector<ValueType> value_list{};
-    TraverseReadOptimized(&context, &value_list);
+      if(consolidated_node_p != nullptr) {
+        consolidated_node_p->~LeafNode();
+        consolidated_node_p->Destroy();
+      }
+    }
 
     epoch_manager.LeaveEpoch(epoch_node_p);
 
-    ValueSet value_set{value_list.begin(),
-                       value_list.end(),
-                       10,
-                       value_hash_obj,
-                       value_eq_obj};
-
-    return value_set;
+    return sample_list;
   }
-  
+
   ///////////////////////////////////////////////////////////////////
   // Garbage Collection Interface
   ///////////////////////////////////////////////////////////////////
@@ -7758,15 +16385,30 @@ before_switch:
   // This value is atomic and will change
   std::atomic<NodeID> root_id;
 
-  // This value is non-atomic, but it remains constant after constructor
-  NodeID first_leaf_id;
+  // Iterators start from this leaf. It only changes in Truncate()
+  std::atomic<NodeID> first_leaf_id;
+
+  // Incremented by Truncate() before and after the root is swapped, so
+  // it is odd while the swap is in progress, and a leaf finger found under
+  // one value belongs to the tree of that value (see LeafFinger)
+  std::atomic<uint64_t> tree_generation;
 
   std::atomic<NodeID> next_unused_node_id;
-  std::array<std::atomic<const BaseNode *>, MAPPING_TABLE_SIZE> mapping_table;
+  MappingTable<const BaseNode *,
+               MAPPING_TABLE_SEGMENT_BITS,
+               MAPPING_TABLE_DIRECTORY_SIZE> mapping_table;
 
   // This list holds free NodeID which was removed by remove delta
   // We recycle NodeID in epoch manager
-  AtomicStack<NodeID, MAPPING_TABLE_SIZE> free_node_id_list;
+  AtomicStack<NodeID, FREE_NODE_ID_LIST_SIZE> free_node_id_list;
+
+  // Ranges [first, second) of NodeIDs of trees freed after Truncate(),
+  // which are handed out before new NodeIDs are reserved. The count is
+  // checked without the lock, such that the lock is only taken if there
+  // is something to take (see TakeRecycledNodeIDs())
+  std::mutex recycled_node_id_lock;
+  std::vector<std::pair<NodeID, NodeID>> recycled_node_id_list;
+  std::atomic<size_t> recycled_node_id_count;
 
   std::atomic<uint64_t> insert_op_count;
   std::atomic<uint64_t> insert_abort_count;
@@ -7777,76 +16419,144 @@ before_switch:
   std::atomic<uint64_t> update_op_count;
   std::atomic<uint64_t> update_abort_count;
 
-  //InteractiveDebugger idb;
+  // Bytes of nodes reachable from the mapping table, garbage nodes waiting
+  // for their epoch, and segments of garbage lists. They are signed since a
+  // node could be retired by another thread before its publisher counts it
+  std::atomic<int64_t> node_memory_size;
+  std::atomic<int64_t> garbage_memory_size;
+  std::atomic<int64_t> garbage_list_memory_size;
 
-  EpochManager epoch_manager;
+  // Bytes of leaf pages and parent nodes buffered by iterators. This is
+  // shared with IteratorContext objects since iterators could outlive
+  // the tree
+  std::shared_ptr<std::atomic<int64_t>> iterator_memory_size_p;
 
- public:
+  // Bytes of chunks of stable value slots
+  std::atomic<int64_t> stable_value_memory_size;
+
+  // Soft limit of the total bytes, or 0 if there is no limit
+  size_t memory_limit;
+
+  // Chunks of stable value slots allocated by NewStableValue()
+  std::atomic<StableValueChunk *> stable_value_chunk_list;
+
+  // Node size thresholds for split and merge. They are initialized from
+  // TuningPolicy and could be changed by SetNodeSizeThreshold()
+  int inner_node_size_upper_threshold;
+  int inner_node_size_lower_threshold;
+  int leaf_node_size_upper_threshold;
+  int leaf_node_size_lower_threshold;
+
+  // Percentage of items that stay in the left node of a split, for nodes
+  // with a right sibling and for the rightmost node of a level respectively
+  int split_percent;
+  int right_edge_split_percent;
+
+  // Whether consolidated inner nodes carry a search index
+  bool inner_search_index_flag;
+
+  // Whether consolidated leaf nodes carry a key fingerprint
+  bool leaf_fingerprint_flag;
+
+  // Whether reads issue software prefetches
+  bool prefetch_flag;
+
+  // Background consolidation. The queue is nullptr if it is not started
+  using ConsolidationQueue = AtomicQueue<NodeID, CONSOLIDATION_QUEUE_SIZE>;
+
+  ConsolidationQueue *consolidation_queue_p;
+  std::vector<std::thread *> consolidation_thread_list;
+  std::atomic<bool> consolidation_exit_flag;
+  int consolidation_hard_cap_factor;
+
+  // Background threads use GC IDs starting from this
+  int consolidation_gc_id_start;
+
+  // Sampled leaf access counters of adaptive consolidation, or nullptr if
+  // it is disabled. Reads are in the lower 16 bits and writes in the higher
+  std::atomic<uint32_t> *node_access_counter_p;
+
+  // Cache of hot keys in front of point lookups, or nullptr if disabled
+  using ReadCacheType = \
+    ReadCache<KeyType, ValueType, KeyHashFunc, KeyEqualityChecker>;
+
+  ReadCacheType *read_cache_p;
+
+  // Whether modifications start from the leaf last modified by the thread
+  bool leaf_finger_flag;
+
+  // Whether failed leaf delta installations are retried from the leaf
+  bool leaf_retry_flag;
+
+  // Whether leaf deltas are installed in an RTM transaction
+  bool rtm_flag;
+
+  // Items not counted by thread statistics, i.e. those loaded by BulkLoad()
+  // and the size of the tree when thread statistics were last reset. This
+  // is atomic since Truncate() subtracts all items counted so far
+  std::atomic<int64_t> approximate_size_base;
+
+  // Incremented by Snapshot(), and stamped on leaf delta records and leaf
+  // base nodes when they are created
+  std::atomic<uint64_t> snapshot_version;
+
+  // The number of threads freeing nodes in the destructor and after
+  // Truncate(), chosen by SetTeardownThreadNum()
+  size_t teardown_thread_num;
 
   /*
-   * class EpochManager - Maintains a linked list of deleted nodes
-   *                      for threads to access until all threads
-   *                      entering epochs before the deletion of
-   *                      nodes have exited
+   * class ReclaimTask - A background thread freeing a tree dropped by
+   *                     Truncate()
+   *
+   * The flag is set by the thread when it is done, after which the thread
+   * could be joined without waiting
    */
-  class EpochManager {
+  class ReclaimTask {
    public:
-    BwTree *tree_p;
-
-    // Garbage collection interval (milliseconds)
-    constexpr static int GC_INTERVAL = 50;
+    std::thread *thread_p;
+    std::atomic<bool> finish_flag;
 
     /*
-     * struct GarbageNode - A linked list of garbages
+     * Default constructor
      */
-    struct GarbageNode {
-      const BaseNode *node_p;
+    ReclaimTask() :
+      thread_p{nullptr},
+      finish_flag{false}
+    {}
+  };
 
-      // This does not have to be atomic, since we only
-      // insert at the head of garbage list
-      GarbageNode *next_p;
-    };
+  std::vector<ReclaimTask *> reclaim_task_list;
+  std::atomic<bool> reclaim_exit_flag;
 
-    /*
-     * struct EpochNode - A linked list of epoch node that records thread count
-     *
-     * This struct is also the head of garbage node linked list, which must
-     * be made atomic since different worker threads will contend to insert
-     * garbage into the head of the list
-     */
-    struct EpochNode {
-      // We need this to be atomic in order to accurately
-      // count the number of threads
-      std::atomic<int> active_thread_count;
-
-      // We need this to be atomic to be able to
-      // add garbage nodes without any race condition
-      // i.e. GC nodes are CASed onto this pointer
-      std::atomic<GarbageNode *> garbage_list_p;
-
-      // This does not need to be atomic since it is
-      // only maintained by the epoch thread
-      EpochNode *next_p;
-    };
+  // If true then garbage is collected when a thread leaves its epoch, after
+  // advancing the global epoch. Otherwise the epoch is advanced by the user
+  // and garbage is collected as soon as the threshold is exceeded
+  bool auto_epoch_flag;
 
-    // The head pointer does not need to be atomic
-    // since it is only accessed by epoch manager
-    EpochNode *head_epoch_p;
+  //InteractiveDebugger idb;
 
-    // This does not need to be atomic because it is only written
-    // by the epoch manager and read by worker threads. But it is
-    // acceptable that allocations are delayed to the next epoch
-    EpochNode *current_epoch_p;
+  EpochManager epoch_manager;
 
-    // This flag indicates whether the destructor is running
-    // If it is true then GC thread should not clean
-    // Therefore, strict ordering is required
-    std::atomic<bool> exited_flag;
+ public:
 
-    // If GC is done with external thread then this should be set
-    // to nullptr
-    // Otherwise it points to a thread created by EpochManager internally
-    std::thread *thread_p;
+  /*
+   * class EpochManager - Announces epochs of worker threads and frees
+   *                      garbage nodes
+   *
+   * Each thread announces the global epoch in its own cache line aligned
+   * GCMetaData slot when it enters and leaves an operation, so entering an
+   * epoch never writes to a cache line shared with other threads. Garbage
+   * nodes are kept in per-thread GC contexts tagged with the epoch they are
+   * unlinked in, and are freed once the minimum announced epoch of all
+   * threads has passed that epoch (see BwTree::PerformGC())
+   */
+  class EpochManager {
+   public:
+    BwTree *tree_p;
+
+    // The handle returned by JoinEpoch() is the slot of the thread that
+    // the epoch is announced in
+    using EpochNode = GCMetaData;
 
     // The counter that counts how many free is called
     // inside the epoch manager
@@ -7860,324 +16570,97 @@ before_switch:
 
     // Number of NodeID we have freed
     size_t freed_id_count;
-
-    // These two are used for debugging
-    size_t epoch_created;
-    size_t epoch_freed;
-
-    std::atomic<size_t> epoch_join;
-    std::atomic<size_t> epoch_leave;
     #endif
 
     /*
-     * Constructor - Initialize the epoch list to be a single node
-     *
-     * NOTE: We do not start thread here since the init of bw-tree itself
-     * might take a long time
+     * Constructor - Binds the epoch manager to the tree
      */
     EpochManager(BwTree *p_tree_p) :
       tree_p{p_tree_p} {
-      current_epoch_p = new EpochNode{};
-
-      // These two are atomic variables but we could
-      // simply assign to them
-      current_epoch_p->active_thread_count = 0;
-      current_epoch_p->garbage_list_p = nullptr;
-
-      current_epoch_p->next_p = nullptr;
-
-      head_epoch_p = current_epoch_p;
-
-      // We allocate and run this later
-      thread_p = nullptr;
-
-      // This is used to notify the cleaner thread that it has ended
-      exited_flag.store(false);
-
       // Initialize atomic counter to record how many
       // freed has been called inside epoch manager
       #ifdef BWTREE_DEBUG
       freed_count = 0UL;
       freed_id_count = 0UL;
-
-      // It is not 0UL since we create an initial epoch on initialization
-      epoch_created = 1UL;
-      epoch_freed = 0UL;
-
-      epoch_join = 0UL;
-      epoch_leave = 0UL;
       #endif
 
       return;
     }
 
     /*
-     * Destructor - Stop the worker thread and cleanup resources not freed
+     * Destructor - Prints statistics
      *
-     * This function waits for the worker thread using join() method. After the
-     * worker thread has exited, it synchronously clears all epochs that have
-     * not been recycled by calling ClearEpoch()
-     *
-     * NOTE: If no internal GC is started then thread_p would be a nullptr
-     * and we neither wait nor free the pointer.
+     * Garbage nodes are kept in thread local GC contexts, which are freed
+     * by the destructor of BwTree
      */
     ~EpochManager() {
-      // Set stop flag and let thread terminate
-      // Also if there is an external GC thread then it should
-      // check this flag everytime it does cleaning since otherwise
-      // the un-thread-safe function ClearEpoch() would be ran
-      // by more than 1 threads
-      exited_flag.store(true);
-
-      // If thread pointer is nullptr then we know the GC thread
-      // is not started. In this case do not wait for the thread, and just
-      // call destructor
-      //
-      // NOTE: The destructor routine is not thread-safe, so if an external
-      // GC thread is being used then that thread should check for
-      // exited_flag everytime it wants to do GC
-      //
-      // If the external thread calls ThreadFunc() then it is safe
-      if(thread_p != nullptr) {
-        bwt_printf("Waiting for thread\n");
-        
-        thread_p->join();
-
-        // Free memory
-        delete thread_p;
-        
-        bwt_printf("Thread stops\n");
-      }
-
-      // So that in the following function the comparison
-      // would always fail, until we have cleaned all epoch nodes
-      current_epoch_p = nullptr;
-
-      // If all threads has exited then all thread counts are
-      // 0, and therefore this should proceed way to the end
-      ClearEpoch();
-
-      // If we have a bug (currently there is one) then as a temporary
-      // measure just force cleaning all epoches no matter whether they
-      // are cleared or not
-      if(head_epoch_p != nullptr) {
-        bwt_printf("ERROR: After cleanup there is still epoch left\n");
-        bwt_printf("==============================================\n");
-        bwt_printf("DUMP\n");
-
-        for(EpochNode *epoch_node_p = head_epoch_p;
-            epoch_node_p != nullptr;
-            epoch_node_p = epoch_node_p->next_p) {
-          bwt_printf("Active thread count: %d\n",
-                 epoch_node_p->active_thread_count.load());
-          epoch_node_p->active_thread_count = 0;
-        }
-
-        bwt_printf("RETRY CLEANING...\n");
-        ClearEpoch();
-      }
-
-      assert(head_epoch_p == nullptr);
-      bwt_printf("Garbage Collector has finished freeing all garbage nodes\n");
-
       #ifdef BWTREE_DEBUG
       bwt_printf("Stat: Freed %lu nodes and %lu NodeID by epoch manager\n",
                  freed_count,
                  freed_id_count);
-
-      bwt_printf("      Epoch created = %lu; epoch freed = %lu\n",
-                 epoch_created,
-                 epoch_freed);
-
-      bwt_printf("      Epoch join = %lu; epoch leave = %lu\n",
-                 epoch_join.load(),
-                 epoch_leave.load());
-      #endif
-
-      return;
-    }
-
-    /*
-     * CreateNewEpoch() - Create a new epoch node
-     *
-     * This functions does not have to consider race conditions
-     */
-    void CreateNewEpoch() {
-      bwt_printf("Creating new epoch...\n");
-
-      EpochNode *epoch_node_p = new EpochNode{};
-
-      epoch_node_p->active_thread_count = 0;
-      epoch_node_p->garbage_list_p = nullptr;
-
-      // We always append to the tail of the linked list
-      // so this field for new node is always nullptr
-      epoch_node_p->next_p = nullptr;
-
-      // Update its previous node (current tail)
-      current_epoch_p->next_p = epoch_node_p;
-
-      // And then switch current epoch pointer
-      current_epoch_p = epoch_node_p;
-
-      #ifdef BWTREE_DEBUG
-      epoch_created++;
       #endif
 
       return;
     }
 
-#ifdef USE_OLD_EPOCH 
-
-    /*
-     * AddGarbageNode() - Add garbage node into the current epoch
-     *
-     * NOTE: This function is called by worker threads so it has
-     * to consider race conditions
-     */
-    void AddGarbageNode(const BaseNode *node_p) {
-      // We need to keep a copy of current epoch node
-      // in case that this pointer is increased during
-      // the execution of this function
-      //
-      // NOTE: Current epoch must not be recycled, since
-      // the current thread calling this function must
-      // come from an epoch <= current epoch
-      // in which case all epochs before that one should
-      // remain valid
-      EpochNode *epoch_p = current_epoch_p;
-
-      // These two could be predetermined
-      GarbageNode *garbage_node_p = new GarbageNode;
-      garbage_node_p->node_p = node_p;
-
-      garbage_node_p->next_p = epoch_p->garbage_list_p.load();
-
-      while(1) {
-        // Then CAS previous node with new garbage node
-        // If this fails, then garbage_node_p->next_p is the actual value
-        // of garbage_list_p, in which case we do not need to load it again
-        bool ret = \
-          epoch_p->garbage_list_p.compare_exchange_strong(garbage_node_p->next_p,
-                                                          garbage_node_p);
-
-        // If CAS succeeds then just return
-        if(ret == true) {
-          break;
-        } else {
-          bwt_printf("Add garbage node CAS failed. Retry\n");
-        }
-      } // while 1
-
-      return;
-    }
-
-    /*
-     * JoinEpoch() - Let current thread join this epoch
-     *
-     * The effect is that all memory deallocated on and after
-     * current epoch will not be freed before current thread leaves
-     *
-     * NOTE: It is possible that prev_count < 0, because in ClearEpoch()
-     * the cleaner thread will decrease the epoch counter by a large amount
-     * to prevent this function using an epoch currently being recycled
-     */
-    inline EpochNode *JoinEpoch() {
-try_join_again:
-      // We must make sure the epoch we join and the epoch we
-      // return are the same one because the current point
-      // could change in the middle of this function
-      EpochNode *epoch_p = current_epoch_p;
-
-      int64_t prev_count = epoch_p->active_thread_count.fetch_add(1);
-
-      // We know epoch_p is now being cleaned, so need to read the
-      // current epoch again because it must have been moved
-      if(prev_count < 0) {
-        // Consider the following sequence:
-        //   0. Start with counter = 0
-        //   1. Worker thread 1 fetch_add() -> return 0, OK
-        //   2. GC thread fetch_sub() -> return positive, abort!
-        //   3. Worker thread 2 fetch_add() -> return negative, retry!
-        //   4. GC thread fetch_add() and aborts
-        //   5. Worker thread 2 retries, and fetch_add() -> return 1, OK
-        // This way the second worker thread actually incremented the epoch
-        // counter twice
-        epoch_p->active_thread_count.fetch_sub(1);
-        
-        goto try_join_again;
-      }
-
-      #ifdef BWTREE_DEBUG
-      epoch_join.fetch_add(1);
-      #endif
-
-      return epoch_p;
-    }
-
     /*
-     * LeaveEpoch() - Leave epoch a thread has once joined
-     *
-     * After an epoch has been cleared all memories allocated on
-     * and before that epoch could safely be deallocated
+     * AddGarbageNode() - This encapsulates BwTree::AddGarbageNode()
      */
-    inline void LeaveEpoch(EpochNode *epoch_p) {
-      // This might return a negative value if the current epoch
-      // is being cleaned
-      epoch_p->active_thread_count.fetch_sub(1);
-
-      #ifdef BWTREE_DEBUG
-      epoch_leave.fetch_add(1);
-      #endif
-
+    inline void AddGarbageNode(const BaseNode *node_p,
+                               bool installed_flag = true) {
+      tree_p->AddGarbageNode(node_p, installed_flag); 
+      
       return;
     }
     
     /*
-     * PerformGarbageCollection() - Actual job of GC is done here
+     * JoinEpoch() - Announces the current global epoch for the calling
+     *               thread
      *
-     * We need to separate the GC loop and actual GC routine to enable
-     * external threads calling the function while also allows BwTree maintains
-     * its own GC thread using the loop
-     */
-    void PerformGarbageCollection() {
-      ClearEpoch();
-      CreateNewEpoch();
-      
-      return;
-    }
-
-#else  // #ifdef USE_OLD_EPOCH
-
-    /*
-     * AddGarbageNode() - This encapsulates BwTree::AddGarbageNode()
+     * Nodes unlinked on and after the announced epoch will not be freed
+     * before the thread leaves
      */
-    inline void AddGarbageNode(const BaseNode *node_p) {
-      tree_p->AddGarbageNode(node_p); 
-      
-      return;
-    }
-    
     inline EpochNode *JoinEpoch() {
       tree_p->UpdateLastActiveEpoch();
       
-      return nullptr;
+      return tree_p->GetCurrentGCMetaData();
     }
     
+    /*
+     * LeaveEpoch() - Announces the current global epoch again, and collects
+     *                garbage of the thread if the tree advances epochs by
+     *                itself and the thread has enough garbage
+     *
+     * Since the thread does not hold any reference at this point, it does
+     * not prevent its own garbage from being freed
+     */
     inline void LeaveEpoch(EpochNode *epoch_p) {
+      if(tree_p->auto_epoch_flag == true && \
+         (epoch_p->node_count > epoch_p->gc_threshold || \
+          (epoch_p->node_count > 0UL && \
+           tree_p->IsMemoryLimitExceeded() == true))) {
+        tree_p->IncreaseEpoch();
+        tree_p->UpdateLastActiveEpoch();
+        tree_p->PerformGC(gc_id);
+        
+        return;
+      }
+      
       tree_p->UpdateLastActiveEpoch();
       
-      (void)epoch_p;
       return;
     }
     
+    /*
+     * PerformGarbageCollection() - Advances the global epoch
+     *
+     * This is used when the tree does not advance epochs by itself
+     */
     inline void PerformGarbageCollection() {
       tree_p->IncreaseEpoch();
       
       return;
     }
-    
-#endif // #ifdef USE_OLD_EPOCH
 
     /*
      * FreeEpochDeltaChain() - Free a delta chain (used by EpochManager)
@@ -8221,6 +16704,36 @@ try_join_again:
             freed_count++;
             #endif
 
+            break;
+          case NodeType::LeafUpdateType:
+            next_node_p = ((LeafUpdateNode *)node_p)->child_node_p;
+
+            ((LeafUpdateNode *)node_p)->~LeafUpdateNode();
+
+            #ifdef BWTREE_DEBUG
+            freed_count++;
+            #endif
+
+            break;
+          case NodeType::LeafBatchInsertType:
+            next_node_p = ((LeafBatchInsertNode *)node_p)->child_node_p;
+
+            ((LeafBatchInsertNode *)node_p)->~LeafBatchInsertNode();
+
+            #ifdef BWTREE_DEBUG
+            freed_count++;
+            #endif
+
+            break;
+          case NodeType::LeafDeleteRangeType:
+            next_node_p = ((LeafDeleteRangeNode *)node_p)->child_node_p;
+
+            ((LeafDeleteRangeNode *)node_p)->~LeafDeleteRangeNode();
+
+            #ifdef BWTREE_DEBUG
+            freed_count++;
+            #endif
+
             break;
           case NodeType::LeafSplitType:
             next_node_p = ((LeafSplitNode *)node_p)->child_node_p;
@@ -8232,18 +16745,26 @@ try_join_again:
             #endif
 
             break;
-          case NodeType::LeafMergeType:
-            FreeEpochDeltaChain(((LeafMergeNode *)node_p)->child_node_p);
-            FreeEpochDeltaChain(((LeafMergeNode *)node_p)->right_merge_p);
+          case NodeType::LeafMergeType: {
+            // The merge node is allocated inside the chunk of the right
+            // branch, so it must be destroyed before branches are freed
+            const BaseNode *child_node_p = \
+              ((LeafMergeNode *)node_p)->child_node_p;
+            const BaseNode *right_merge_p = \
+              ((LeafMergeNode *)node_p)->right_merge_p;
 
             ((LeafMergeNode *)node_p)->~LeafMergeNode();
 
+            FreeEpochDeltaChain(child_node_p);
+            FreeEpochDeltaChain(right_merge_p);
+
             #ifdef BWTREE_DEBUG
             freed_count++;
             #endif
 
             // Leaf merge node is an ending node
             return;
+          } // case LeafMergeType
           case NodeType::LeafRemoveType:
             // This recycles node ID
             tree_p->InvalidateNodeID(((LeafRemoveNode *)node_p)->removed_id);
@@ -8260,14 +16781,26 @@ try_join_again:
             // merge node
             return;
           case NodeType::LeafType:
-            ((LeafNode *)node_p)->~LeafNode();
-            ((LeafNode *)node_p)->Destroy();
+            // A leaf pinned by an iterator is freed by the last Unpin()
+            if(((LeafNode *)node_p)->Retire() == true) {
+              ((LeafNode *)node_p)->~LeafNode();
+              ((LeafNode *)node_p)->Destroy();
+            }
 
             #ifdef BWTREE_DEBUG
             freed_count++;
             #endif
 
             // We have reached the end of delta chain
+            return;
+          case NodeType::LeafCompressedType:
+            ((CompressedLeafNode *)node_p)->~CompressedLeafNode();
+            ((CompressedLeafNode *)node_p)->Destroy();
+
+            #ifdef BWTREE_DEBUG
+            freed_count++;
+            #endif
+
             return;
           case NodeType::InnerInsertType:
             next_node_p = ((InnerInsertNode *)node_p)->child_node_p;
@@ -8299,18 +16832,26 @@ try_join_again:
             #endif
 
             break;
-          case NodeType::InnerMergeType:
-            FreeEpochDeltaChain(((InnerMergeNode *)node_p)->child_node_p);
-            FreeEpochDeltaChain(((InnerMergeNode *)node_p)->right_merge_p);
+          case NodeType::InnerMergeType: {
+            // The merge node is allocated inside the chunk of the right
+            // branch, so it must be destroyed before branches are freed
+            const BaseNode *child_node_p = \
+              ((InnerMergeNode *)node_p)->child_node_p;
+            const BaseNode *right_merge_p = \
+              ((InnerMergeNode *)node_p)->right_merge_p;
 
             ((InnerMergeNode *)node_p)->~InnerMergeNode();
 
+            FreeEpochDeltaChain(child_node_p);
+            FreeEpochDeltaChain(right_merge_p);
+
             #ifdef BWTREE_DEBUG
             freed_count++;
             #endif
 
             // Merge node is also an ending node
             return;
+          } // case InnerMergeType
           case NodeType::InnerRemoveType:
             // Recycle NodeID here together with RemoveNode
             // Since we need to guatantee all threads that could potentially
@@ -8362,137 +16903,162 @@ try_join_again:
       return;
     }
 
-    /*
-     * ClearEpoch() - Sweep the chain of epoch and free memory
-     *
-     * The minimum number of epoch we must maintain is 1 which means
-     * when current epoch is the head epoch we should stop scanning
-     *
-     * NOTE: There is no race condition in this function since it is
-     * only called by the cleaner thread
-     */
-    void ClearEpoch() {
-      bwt_printf("Start to clear epoch\n");
-
-      while(1) {
-        // Even if current_epoch_p is nullptr, this should work
-        if(head_epoch_p == current_epoch_p) {
-          bwt_printf("Current epoch is head epoch. Do not clean\n");
-
-          break;
-        }
-
-        // Since it could only be acquired and released by worker thread
-        // the value must be >= 0
-        int active_thread_count = head_epoch_p->active_thread_count.load();
-        assert(active_thread_count >= 0);
-
-        // If we have seen an epoch whose count is not zero then all
-        // epochs after that are protected and we stop
-        if(active_thread_count != 0) {
-          bwt_printf("Head epoch is not empty. Return\n");
-
-          break;
-        }
-
-        // If some thread joins the epoch between the previous branch
-        // and the following fetch_sub(), then fetch_sub() returns a positive
-        // number, which is the number of threads that have joined the epoch
-        // since last epoch counter testing.
-
-        if(head_epoch_p->active_thread_count.fetch_sub(MAX_THREAD_COUNT) > 0) {
-          bwt_printf("Some thread sneaks in after we have decided"
-                     " to clean. Return\n");
-
-          // Must add it back to let the next round of cleaning correctly
-          // identify empty epoch
-          head_epoch_p->active_thread_count.fetch_add(MAX_THREAD_COUNT);
+  }; // Epoch manager
 
-          break;
-        }
+  /*
+   * Snapshot Interface
+   */
 
-        // After this point all fetch_add() on the epoch counter would return
-        // a negative value which will cause re-read of current_epoch_p
-        // to prevent joining an epoch that is being deleted
+  /*
+   * class ReadSnapshot - A point-in-time view of the tree for iterators
+   *
+   * This is created by Snapshot(), and holds a pinned epoch slot together
+   * with the version of the tree when it is taken. Iterators created from
+   * it with Begin() skip all modifications of later versions, such that a
+   * scan sees the same consistent state no matter how long it takes, while
+   * writers never wait for it. Nodes replaced after the snapshot is taken
+   * are kept by the GC as long as the snapshot is alive, so it should be
+   * released as soon as the scan finishes. This includes the whole tree if
+   * it is dropped by Truncate() after the snapshot is taken.
+   *
+   * The object is movable but not copyable. It must be released (or
+   * destroyed) after all its iterators and before the tree is destroyed
+   */
+  class ReadSnapshot {
+   private:
+    BwTree *tree_p;
+    size_t epoch_slot;
+    uint64_t version;
+    TreeRoot tree_root;
 
-        // If the epoch has cleared we just loop through its garbage chain
-        // and then free each delta chain
+   public:
+    /*
+     * Default Constructor - An invalid snapshot that does not pin anything
+     */
+    ReadSnapshot() :
+      tree_p{nullptr},
+      epoch_slot{0UL},
+      version{0UL},
+      tree_root{}
+    {}
 
-        const GarbageNode *next_garbage_node_p = nullptr;
+    ReadSnapshot(BwTree *p_tree_p,
+                 size_t p_epoch_slot,
+                 uint64_t p_version,
+                 const TreeRoot &p_tree_root) :
+      tree_p{p_tree_p},
+      epoch_slot{p_epoch_slot},
+      version{p_version},
+      tree_root{p_tree_root}
+    {}
 
-        // Walk through its garbage chain
-        for(const GarbageNode *garbage_node_p = head_epoch_p->garbage_list_p.load();
-            garbage_node_p != nullptr;
-            garbage_node_p = next_garbage_node_p) {
-          FreeEpochDeltaChain(garbage_node_p->node_p);
+    ReadSnapshot(const ReadSnapshot &) = delete;
+    ReadSnapshot &operator=(const ReadSnapshot &) = delete;
 
-          // Save the next pointer so that we could
-          // delete current node directly
-          next_garbage_node_p = garbage_node_p->next_p;
+    ReadSnapshot(ReadSnapshot &&other) :
+      tree_p{other.tree_p},
+      epoch_slot{other.epoch_slot},
+      version{other.version},
+      tree_root{other.tree_root} {
+      other.tree_p = nullptr;
 
-          // This invalidates any further reference to its
-          // members (so we saved next pointer above)
-          delete garbage_node_p;
-        } // for
+      return;
+    }
 
-        // First need to save this in order to delete current node
-        // safely
-        EpochNode *next_epoch_node_p = head_epoch_p->next_p;
+    ReadSnapshot &operator=(ReadSnapshot &&other) {
+      if(this != &other) {
+        Release();
 
-        delete head_epoch_p;
+        tree_p = other.tree_p;
+        epoch_slot = other.epoch_slot;
+        version = other.version;
+        tree_root = other.tree_root;
 
-        #ifdef BWTREE_DEBUG
-        epoch_freed++;
-        #endif
+        other.tree_p = nullptr;
+      }
 
-        // Then advance to the next epoch
-        // It is possible that head_epoch_p becomes nullptr
-        // this happens during destruction, and should not
-        // cause any problem since that case we also set current epoch
-        // pointer to nullptr
-        head_epoch_p = next_epoch_node_p;
-      } // while(1) through epoch nodes
+      return *this;
+    }
 
-      return;
+    ~ReadSnapshot() {
+      Release();
     }
 
     /*
-     * ThreadFunc() - The cleaner thread executes this every GC_INTERVAL ms
-     *
-     * This function exits when exit flag is set to true
+     * Release() - Unpins the epoch such that the GC could reclaim nodes
+     *             replaced after the snapshot is taken
      */
-    void ThreadFunc() {
-      // While the parent is still running
-      // We do not worry about race condition here
-      // since even if we missed one we could always
-      // hit the correct value on next try
-      while(exited_flag.load() == false) {
-        //printf("Start new epoch cycle\n");
-        PerformGarbageCollection();
-
-        // Sleep for 50 ms
-        std::chrono::milliseconds duration(GC_INTERVAL);
-        std::this_thread::sleep_for(duration);
+    void Release() {
+      if(tree_p != nullptr) {
+        tree_p->UnpinEpoch(epoch_slot);
+        tree_p = nullptr;
       }
 
-      bwt_printf("exit flag is true; thread return\n");
-
       return;
     }
 
-    /*
-     * StartThread() - Start cleaner thread for garbage collection
-     *
-     * NOTE: This is not called in the constructor, and needs to be
-     * called manually
-     */
-    void StartThread() {
-      thread_p = new std::thread{[this](){this->ThreadFunc();}};
+    inline bool IsValid() const {
+      return tree_p != nullptr;
+    }
+
+    inline uint64_t GetVersion() const {
+      return version;
+    }
+
+    inline const TreeRoot &GetTreeRoot() const {
+      return tree_root;
+    }
+  };
+
+  /*
+   * Snapshot() - Returns a snapshot of the current state of the tree
+   *
+   * Modifications that complete before this function is called are seen
+   * by iterators of the snapshot, and those that start after it returns
+   * are not. Modifications racing with this function might be seen or not,
+   * but each of them is seen either entirely or not at all
+   *
+   * The epoch must be pinned before the version is taken, such that the
+   * chain replaced by any base node of a newer version is not yet reclaimed.
+   * For the same reason the root is read after the epoch is pinned, and a
+   * tree dropped by Truncate() afterwards is only reclaimed after the
+   * snapshot is released (but see JoinReclaimTasks())
+   */
+  ReadSnapshot Snapshot() {
+    size_t epoch_slot = PinEpoch();
+    uint64_t version = snapshot_version.fetch_add(1UL);
 
-      return;
+    // Retry if Truncate() swaps the root and the first leaf in between,
+    // which is the case if the generation is odd or changes
+    while(1) {
+      uint64_t generation = tree_generation.load();
+      NodeID root_node_id = root_id.load();
+      NodeID first_leaf_node_id = first_leaf_id.load();
+
+      if((generation % 2UL) == 0UL && tree_generation.load() == generation) {
+        return ReadSnapshot{this,
+                            epoch_slot,
+                            version,
+                            TreeRoot{generation,
+                                     root_node_id,
+                                     first_leaf_node_id}};
+      }
     }
 
-  }; // Epoch manager
+    assert(false);
+    return ReadSnapshot{};
+  }
+
+  /*
+   * GetCurrentVersion() - Returns the version stamped on new leaf delta
+   *                       records and leaf base nodes
+   *
+   * It must be loaded after the delta chain the node is posted on or
+   * consolidated from, such that versions never decrease along a chain
+   */
+  inline uint64_t GetCurrentVersion() const {
+    return snapshot_version.load();
+  }
 
   /*
    * Iterator Interface
@@ -8521,6 +17087,60 @@ try_join_again:
     return ForwardIterator{this, start_key};
   }
 
+  /*
+   * Begin() - Return an iterator on the first element of a snapshot
+   *
+   * The iterator, and all iterators derived from it, only see the state of
+   * the tree when the snapshot is taken. Leaf pages with newer modifications
+   * are always buffered in the iterator rather than pinned
+   */
+  ForwardIterator Begin(const ReadSnapshot &snapshot) {
+    assert(snapshot.IsValid() == true);
+
+    return ForwardIterator{this,
+                           snapshot.GetVersion(),
+                           snapshot.GetTreeRoot()};
+  }
+
+  /*
+   * Begin() - Return an iterator on the first element of a snapshot whose
+   *           key is greater than or equal to the given key
+   */
+  ForwardIterator Begin(const ReadSnapshot &snapshot,
+                        const KeyType &start_key) {
+    assert(snapshot.IsValid() == true);
+
+    return ForwardIterator{this,
+                           start_key,
+                           snapshot.GetVersion(),
+                           snapshot.GetTreeRoot()};
+  }
+
+  /*
+   * RBegin() - Return an iterator for backward iteration from a given key
+   *
+   * The iterator returned points to the last data item whose key is less
+   * than or equal to the given key. If such key does not exist then the
+   * iterator is REnd()
+   *
+   * NOTE: Backward iteration caches the parent node of leaf pages, such that
+   * moving to the left page usually does not require a traversal from the
+   * root. The cache is built by the first operator--() that crosses
+   * a page boundary
+   */
+  ForwardIterator RBegin(const KeyType &start_key) {
+    ForwardIterator it{this, start_key};
+
+    // Skip all values of the start key since they should also be included
+    while((it.IsEnd() == false) && (KeyCmpEqual(it->first, start_key))) {
+      ++it;
+    }
+
+    --it;
+
+    return it;
+  }
+
   /*
    * NullIterator() - Returns an empty iterator that cannot do anything
    *
@@ -8542,9 +17162,11 @@ try_join_again:
    * class IteratorContext - Buffers leaf page information for iterating on
    *                         that page
    *
-   * This page buffers the content of a leaf page in the tree. We do not 
-   * directly refer to a page because there is no protection from the page being
-   * recycled by SMR.
+   * This page buffers the content of a leaf page in the tree. A leaf page
+   * that has a delta chain is consolidated into a private copy embedded in
+   * this object. A consolidated base leaf is read in place instead, and is
+   * pinned (see ElasticNode::Pin()) such that SMR does not recycle it
+   * before the context is destroyed.
    *
    * Please note that this IteratorContext could only be used under single 
    * threaded environment. This is a valid assumption since different threads
@@ -8560,10 +17182,35 @@ try_join_again:
     // We need this reference to traverse and also to call GC
     BwTree *tree_p;
 
+    // Iterator memory counter of the tree, which is still valid after the
+    // tree is destroyed
+    std::shared_ptr<std::atomic<int64_t>> memory_size_p;
+
     // This is a reference counter used for single threaded environment
     // Note that if multiple threads modifies the reference counter concurrentl
     // then we could not recycle it even if the ref count has droped to 0
     size_t ref_count;
+
+    // A private consolidated copy of the parent node of the buffered leaf
+    // page, or nullptr if it is unknown. This is used by backward iteration
+    // to find the left sibling without traversing from the root
+    InnerNode *parent_node_p;
+
+    // The leaf node being iterated on. This is either the embedded leaf
+    // node below, or a pinned base leaf node in the tree
+    LeafNode *current_leaf_p;
+
+    // Bytes allocated for this object, which are counted into the
+    // iterator memory of the tree
+    size_t allocation_size;
+
+    // The version the leaf page is read at, which is LATEST_VERSION unless
+    // the iterator is created from a snapshot
+    uint64_t version;
+
+    // The tree of the snapshot, which is used for traversals to the next
+    // leaf page, since the tree might have been dropped by Truncate()
+    TreeRoot tree_root;
     
     // This is a stub that points to class LeafNode which is used to
     // receive consolidated key value pairs from a leaf delta chain
@@ -8574,9 +17221,17 @@ try_join_again:
      *
      * Note that the LeafNode instance is initialized outside of this class
      */
-    IteratorContext(BwTree *p_tree_p) :
+    IteratorContext(BwTree *p_tree_p,
+                    LeafNode *p_current_leaf_p,
+                    size_t p_allocation_size) :
       tree_p{p_tree_p},
-      ref_count{0UL} 
+      memory_size_p{p_tree_p->iterator_memory_size_p},
+      ref_count{0UL},
+      parent_node_p{nullptr},
+      current_leaf_p{p_current_leaf_p},
+      allocation_size{p_allocation_size},
+      version{LATEST_VERSION},
+      tree_root{}
     {}
     
     /*
@@ -8588,8 +17243,19 @@ try_join_again:
      * class IteratorContext instance
      */
     ~IteratorContext() {
-      // Call destructor to destruct all KeyValuePairs stored in its array
-      GetLeafNode()->~ElasticNode<KeyValuePair>();
+      if(IsPinned() == true) {
+        // If the GC has retired the leaf while it is pinned then
+        // it is our responsibility to free it
+        if(current_leaf_p->Unpin() == true) {
+          current_leaf_p->~LeafNode();
+          current_leaf_p->Destroy();
+        }
+      } else {
+        // Call destructor to destruct all KeyValuePairs stored in its array
+        current_leaf_p->~ElasticNode<KeyValuePair>();
+      }
+
+      SetParentNode(nullptr);
       
       return;
     }
@@ -8597,11 +17263,20 @@ try_join_again:
    public:
     
     /*
-     * GetLeafNode() - Returns a pointer to the leaf node object embedded inside
-     *                 class IteratorContext object
+     * GetLeafNode() - Returns a pointer to the leaf node being iterated on
+     *
+     * The node must not be modified if it is pinned in the tree
      */
     inline LeafNode *GetLeafNode() {
-      return &leaf_node_p[0];
+      return current_leaf_p;
+    }
+
+    /*
+     * IsPinned() - Whether the leaf node is read in place from the tree
+     *              rather than from the embedded copy
+     */
+    inline bool IsPinned() const {
+      return current_leaf_p != &leaf_node_p[0];
     }
     
     /*
@@ -8610,6 +17285,68 @@ try_join_again:
     inline BwTree *GetTree() {
       return tree_p;
     }
+
+    /*
+     * GetVersion() - Returns the version the leaf page is read at
+     */
+    inline uint64_t GetVersion() const {
+      return version;
+    }
+
+    /*
+     * GetTreeRoot() - Returns the tree the iterator is on
+     */
+    inline const TreeRoot &GetTreeRoot() const {
+      return tree_root;
+    }
+
+    /*
+     * GetParentNode() - Returns the cached parent node or nullptr
+     */
+    inline const InnerNode *GetParentNode() const {
+      return parent_node_p;
+    }
+
+    /*
+     * SetParentNode() - Replaces the cached parent node
+     *
+     * The previously cached copy, if any, is freed. The new node must be a
+     * private copy created by CollectAllSepsOnInner()
+     */
+    inline void SetParentNode(InnerNode *p_parent_node_p) {
+      InnerNode *old_parent_node_p = ReleaseParentNode();
+      if(old_parent_node_p != nullptr) {
+        old_parent_node_p->~InnerNode();
+        old_parent_node_p->Destroy();
+      }
+
+      parent_node_p = p_parent_node_p;
+
+      if(parent_node_p != nullptr) {
+        memory_size_p->fetch_add( \
+          static_cast<int64_t>(GetNodeAllocationSize(parent_node_p)),
+          std::memory_order_relaxed);
+      }
+
+      return;
+    }
+
+    /*
+     * ReleaseParentNode() - Returns the cached parent node and gives up
+     *                       its ownership
+     */
+    inline InnerNode *ReleaseParentNode() {
+      InnerNode *ret = parent_node_p;
+      parent_node_p = nullptr;
+
+      if(ret != nullptr) {
+        memory_size_p->fetch_sub( \
+          static_cast<int64_t>(GetNodeAllocationSize(ret)),
+          std::memory_order_relaxed);
+      }
+
+      return ret;
+    }
     
     /*
      * InnRef() - Increase reference counter
@@ -8651,6 +17388,10 @@ try_join_again:
       
       ref_count--;
       if(ref_count == 0UL) {
+        memory_size_p->fetch_sub( \
+          static_cast<int64_t>(allocation_size),
+          std::memory_order_relaxed);
+
         // 1. calls d'tor of class IteratorContext which calls d'tor
         //    for class ElasticNode
         this->~IteratorContext();
@@ -8667,6 +17408,16 @@ try_join_again:
     inline size_t GetRefCount() {
       return ref_count;
     }
+
+    /*
+     * GetAllocationSize() - Returns the bytes allocated by Get() for a leaf
+     *                       page of the given number of items
+     */
+    inline static size_t GetAllocationSize(int item_count) {
+      return sizeof(IteratorContext) + \
+             sizeof(LeafNode) + \
+             sizeof(KeyValuePair) * item_count;
+    }
     
     /*
      * Get() - Static function that constructs an iterator context object
@@ -8679,30 +17430,35 @@ try_join_again:
      * Both class IteratorContext and class LeafNode is initialized when
      * this function returns. CollectAllValuesOnLeaf() does not einitialize
      * the leaf node if it is provided in the argument list.
+     *
+     * The embedded leaf node has room for item_count items, which is the
+     * item count of node_p unless the node is read at an older version
      */
     inline static IteratorContext *Get(BwTree *p_tree_p, 
-                                       const BaseNode *node_p) {
+                                       const BaseNode *node_p,
+                                       int item_count) {
       // This is the size of the memory chunk we allocate for the leaf node
-      size_t size = \
-        sizeof(IteratorContext) + \
-        sizeof(LeafNode) + \
-        sizeof(KeyValuePair) * node_p->GetItemCount();
+      size_t size = GetAllocationSize(item_count);
+
+      p_tree_p->iterator_memory_size_p->fetch_add( \
+        static_cast<int64_t>(size),
+        std::memory_order_relaxed);
       
       // This is the size of memory we wish to initialize for IteratorContext
       // plus data
       IteratorContext *ic_p = \
-        reinterpret_cast<IteratorContext *>(new char[size]);
+        reinterpret_cast<IteratorContext *>(NodeAllocator::Allocate(size));
       assert(ic_p != nullptr);
       
       // Initialize class IteratorContext part
-      new (ic_p) IteratorContext{p_tree_p};
+      new (ic_p) IteratorContext{p_tree_p, &ic_p->leaf_node_p[0], size};
       
       // Then initialize class LeafNode 
       // i.e. class ElasticNode<KeyValuePair> part 
       new (ic_p->GetLeafNode()) \
         ElasticNode<KeyValuePair>{node_p->GetType(),
                                   node_p->GetDepth(),
-                                  node_p->GetItemCount(),
+                                  item_count,
                                   node_p->GetLowKeyPair(),
                                   node_p->GetHighKeyPair()};
       
@@ -8712,23 +17468,148 @@ try_join_again:
       
       return ic_p;
     }
+
+    inline static IteratorContext *Get(BwTree *p_tree_p, 
+                                       const BaseNode *node_p) {
+      return Get(p_tree_p, node_p, node_p->GetItemCount());
+    }
+
+    /*
+     * GetPinned() - Constructs an iterator context object that reads a
+     *               consolidated leaf node in place
+     *
+     * This must be called inside the epoch in which leaf_node_p is loaded.
+     * The leaf node is pinned until the context is destroyed, so it remains
+     * valid after the epoch is left
+     */
+    inline static IteratorContext *GetPinned(BwTree *p_tree_p,
+                                             const LeafNode *leaf_node_p) {
+      size_t size = sizeof(IteratorContext);
+
+      p_tree_p->iterator_memory_size_p->fetch_add( \
+        static_cast<int64_t>(size),
+        std::memory_order_relaxed);
+
+      IteratorContext *ic_p = \
+        reinterpret_cast<IteratorContext *>(NodeAllocator::Allocate(size));
+      assert(ic_p != nullptr);
+
+      leaf_node_p->Pin();
+
+      // Iterators only read through the node, so removing const is safe
+      new (ic_p) IteratorContext{p_tree_p,
+                                 const_cast<LeafNode *>(leaf_node_p),
+                                 size};
+
+      ic_p->IncRef();
+      assert(ic_p->GetRefCount() == 1UL);
+
+      return ic_p;
+    }
+
+    /*
+     * Load() - Constructs an iterator context object for a leaf node
+     *          snapshot
+     *
+     * If the snapshot is a consolidated base leaf node then it is pinned
+     * and read in place. Otherwise its delta chain is consolidated into
+     * the embedded leaf node. This must be called inside an epoch
+     *
+     * If a version is given then the leaf page is read at the version (see
+     * Snapshot()). The base node is pinned only if it is not newer than
+     * the version and there is no delta record on it
+     */
+    inline static IteratorContext *Load(BwTree *p_tree_p,
+                                        NodeSnapshot *snapshot_p,
+                                        uint64_t version = LATEST_VERSION,
+                                        const TreeRoot &tree_root = \
+                                          TreeRoot{}) {
+      const BaseNode *node_p = snapshot_p->node_p;
+      assert(node_p->IsOnLeafDeltaChain() == true);
+
+      IteratorContext *ic_p = nullptr;
+
+      if(node_p->GetType() == NodeType::LeafType && \
+         static_cast<const LeafNode *>(node_p)->GetVersion() <= version) {
+        ic_p = GetPinned(p_tree_p, static_cast<const LeafNode *>(node_p));
+      } else if(version == LATEST_VERSION || \
+                (node_p->GetType() == NodeType::LeafCompressedType && \
+                 static_cast<const CompressedLeafNode *>(node_p)-> \
+                   GetVersion() <= version)) {
+        ic_p = Get(p_tree_p, node_p);
+
+        // Consolidate the current node. Note that we pass in the leaf node
+        // object embedded inside the IteratorContext object
+        p_tree_p->CollectAllValuesOnLeaf(snapshot_p, ic_p->GetLeafNode());
+      } else {
+        ic_p = LoadVersion(p_tree_p, node_p, version);
+      }
+
+      ic_p->version = version;
+      ic_p->tree_root = tree_root;
+
+      return ic_p;
+    }
+
+    /*
+     * LoadVersion() - Constructs an iterator context object with the items
+     *                 of a leaf page at an older version
+     *
+     * The number of items is unknown before they are collected, so they
+     * are collected into a vector first. Since a compressed leaf node does
+     * not have delta records, we start from the chain it replaced if it is
+     * newer than the version
+     */
+    static IteratorContext *LoadVersion(BwTree *p_tree_p,
+                                        const BaseNode *node_p,
+                                        uint64_t version) {
+      const BaseNode *chain_p = node_p;
+      if(node_p->GetType() == NodeType::LeafCompressedType) {
+        chain_p = static_cast<const CompressedLeafNode *>(node_p)-> \
+                    GetPreviousVersion();
+      }
+
+      // The chain might cover a wider key range than the current node
+      const KeyType *low_key_p = nullptr;
+      if(node_p->GetLowKeyPair().second != INVALID_NODE_ID) {
+        low_key_p = &node_p->GetLowKey();
+      }
+
+      const KeyType *high_key_p = nullptr;
+      if(node_p->GetNextNodeID() != INVALID_NODE_ID) {
+        high_key_p = &node_p->GetHighKey();
+      }
+
+      std::vector<KeyValuePair> item_list{};
+      p_tree_p->CollectRangeOnLeaf(chain_p,
+                                   low_key_p,
+                                   high_key_p,
+                                   static_cast<size_t>(-1),
+                                   &item_list,
+                                   version);
+
+      int item_count = static_cast<int>(item_list.size());
+      IteratorContext *ic_p = Get(p_tree_p, node_p, item_count);
+
+      ic_p->GetLeafNode()->MoveBack(item_list.data(),
+                                    item_list.data() + item_count);
+
+      return ic_p;
+    }
     
     /*
-     * Destroy() - Manually frees memory as char[]
+     * Destroy() - Manually frees memory through the node allocator
      *
      * This function is necessary to ensure well defined bahavior of the
-     * class since the memory of "this" pointer is allocated through operator
-     * new[] of type char[], so we must reclaim memory using the same
-     * operator delete[] of type char[]
+     * class since the memory of "this" pointer is allocated through
+     * NodeAllocator::Allocate() as raw memory, so we must reclaim memory
+     * using NodeAllocator::Free() rather than operator delete
      *
      * Note that class ElasticNode<KeyValuePair> d'tor needs to be called
      * before this function is called then it is deleted in the d'tor
      */
     inline void Destroy() {
-      // Note that we must cast it as char * before
-      // delete[] otherwise C++ will try to find the size of the array
-      // and call d'tor for each element
-      delete[] reinterpret_cast<char *>(this);
+      NodeAllocator::Free(this);
       
       return; 
     }
@@ -8768,35 +17649,49 @@ try_join_again:
     /*
      * Constructor
      *
-     * NOTE: We load the first leaf page using FIRST_LEAF_NODE_ID since we
+     * NOTE: We load the first leaf page using first_leaf_id since we
      * know it is there
+     *
+     * If a version is given then all leaf pages are read at the version
+     * (see BwTree::Snapshot()), and the tree of the snapshot is iterated
+     * on even if it has been dropped by Truncate()
      */
-    ForwardIterator(BwTree *p_tree_p) {
+    ForwardIterator(BwTree *p_tree_p,
+                    uint64_t version = LATEST_VERSION,
+                    const TreeRoot &tree_root = TreeRoot{}) {
       // This also needs to be protected by epoch since we do access internal
       // node that is possible to be reclaimed
       EpochNode *epoch_node_p = p_tree_p->epoch_manager.JoinEpoch();
         
-      // Load the first leaf page
-      const BaseNode *node_p = p_tree_p->GetNode(FIRST_LEAF_NODE_ID);
+      // Load the first leaf page. It never changes until the tree is
+      // dropped, so the snapshot's first leaf is always used
+      NodeID leaf_node_id = p_tree_p->first_leaf_id.load();
+      if(tree_root.IsCurrent() == false) {
+        leaf_node_id = tree_root.first_leaf_node_id;
+      }
+
+      const BaseNode *node_p = p_tree_p->GetNode(leaf_node_id);
       assert(node_p != nullptr);
       assert(node_p->IsOnLeafDeltaChain() == true);
 
-      // Allocate space for IteratorContext + LeafNode Metadata + LeafNode data
-      ic_p = IteratorContext::Get(p_tree_p, node_p);
-      // This does not change after CollectAllValuesOnLeaf() is called
+      // Either pin the leaf node or consolidate it into IteratorContext
+      NodeSnapshot snapshot{leaf_node_id, node_p};
+      ic_p = IteratorContext::Load(p_tree_p, &snapshot, version, tree_root);
       kv_p = ic_p->GetLeafNode()->Begin();
       assert(ic_p->GetRefCount() == 1UL);
 
-      // Use this to collect all values
-      NodeSnapshot snapshot{FIRST_LEAF_NODE_ID, node_p};
-
-      // Consolidate the current node. Note that we pass in the leaf node
-      // object embedded inside the IteratorContext object
-      p_tree_p->CollectAllValuesOnLeaf(&snapshot, ic_p->GetLeafNode());
-      
       // Leave epoch
       p_tree_p->epoch_manager.LeaveEpoch(epoch_node_p);
 
+      // The first leaf could be empty after deletes, since leftmost
+      // children are never merged. Then go to the first key after it
+      if(kv_p == ic_p->GetLeafNode()->End() && IsEnd() == false) {
+        LowerBound(p_tree_p,
+                   &ic_p->GetLeafNode()->GetHighKeyPair().first,
+                   version,
+                   tree_root);
+      }
+
       return;
     }
 
@@ -8808,13 +17703,15 @@ try_join_again:
      * a starting key could be derived according to conditions
      */
     ForwardIterator(BwTree *p_tree_p,
-                    const KeyType &start_key) :
+                    const KeyType &start_key,
+                    uint64_t version = LATEST_VERSION,
+                    const TreeRoot &tree_root = TreeRoot{}) :
       ic_p{nullptr},
       kv_p{nullptr} {
       
       // Load the corresponding page using the given key and store all its
       // data into the iterator's embedded leaf page
-      LowerBound(p_tree_p, &start_key);
+      LowerBound(p_tree_p, &start_key, version, tree_root);
 
       return;
     }
@@ -8861,7 +17758,9 @@ try_join_again:
       // Add a reference to the IteratorContext
       ic_p = other.ic_p;
       kv_p = other.kv_p;
-      other.ic_p->IncRef();
+      if(ic_p != nullptr) {
+        ic_p->IncRef();
+      }
 
       return *this;
     }
@@ -8880,12 +17779,14 @@ try_join_again:
         return *this;
       }
 
-      // For move assignment we do not touch the ref count
-      // and just nullify the other object 
+      // For move assignment we do not touch the ref count of the other
+      // object and just nullify it. The current one is still released
+      // since it may pin a leaf node in the tree
       if(ic_p == nullptr) {
         assert(kv_p == nullptr); 
       } else {
         assert(kv_p != nullptr); 
+        ic_p->DecRef();
       }
       
       // Add a reference to the IteratorContext
@@ -8898,6 +17799,14 @@ try_join_again:
       return *this;
     }
     
+    /*
+     * IsPinned() - Whether the current page is read in place from the tree
+     *              rather than from a consolidated copy
+     */
+    bool IsPinned() const {
+      return (ic_p != nullptr) && (ic_p->IsPinned() == true);
+    }
+
     /*
      * IsEnd() - Whether the current iterator caches the last page and 
      *           the iterator points to the last element
@@ -9168,10 +18077,14 @@ try_join_again:
      *
      * Note that the argument p_tree_p is required since this function might be 
      * called with ic_p being nullptr, such that we need a reference to the tree
-     * instance
+     * instance, and for the same reason the version of pages and the tree
+     * of the snapshot are passed. The latter is copied since it might also
+     * be inside the IteratorContext
      */
     void LowerBound(BwTree *p_tree_p,
-                    const KeyType *start_key_p) {
+                    const KeyType *start_key_p,
+                    uint64_t version,
+                    const TreeRoot tree_root) {
       assert(start_key_p != nullptr);
       // This is required since start_key_p might be pointing inside the
       // currently buffered IteratorContext which will be destroyed
@@ -9187,12 +18100,13 @@ try_join_again:
         //   1. It stops at the leaf level without traversing leaf with the key
         //   2. It DOES finish partial SMO, consolidate overlengthed chain, etc.
         //   3. It DOES traverse horizontally using sibling pointer
-        Context context{start_key};
+        //   4. It does not expand compressed leaves, which are decoded
+        //      into the IteratorContext
+        Context context{start_key, tree_root};
+        context.read_only_flag = true;
         p_tree_p->Traverse(&context, nullptr, nullptr);
 
         NodeSnapshot *snapshot_p = BwTree::GetLatestNodeSnapshot(&context);
-        const BaseNode *node_p = snapshot_p->node_p;
-        assert(node_p->IsOnLeafDeltaChain() == true);
 
         // After this point, start_key_p from the last page becomes invalid
 
@@ -9203,13 +18117,11 @@ try_join_again:
         }
         
         // Refresh the IteratorContext object and also refresh kv_p
-        ic_p = IteratorContext::Get(p_tree_p, node_p);
+        // The current node is either pinned or consolidated into
+        // the embedded leaf node
+        ic_p = IteratorContext::Load(p_tree_p, snapshot_p, version, tree_root);
         assert(ic_p->GetRefCount() == 1UL);
 
-        // Consolidate the current node and store all key value pairs
-        // to the embedded leaf node 
-        p_tree_p->CollectAllValuesOnLeaf(snapshot_p, ic_p->GetLeafNode());
-
         // Leave the epoch, since we have already had all information
         p_tree_p->epoch_manager.LeaveEpoch(epoch_node_p);
 
@@ -9282,18 +18194,58 @@ try_join_again:
         // the IteratorContext object, it is still valid key
         KeyType low_key = ic_p->GetLeafNode()->GetLowKey();
         
-        // Traverse backward using the low key. This function will
-        // try its best to reach the exact left page whose high key
-        // <= current low key
-        Context context{low_key};
-        
         EpochNode *epoch_node_p = tree_p->epoch_manager.JoinEpoch();
-        
-        // This function stops and does not traverse LeafNode after adjusting
-        // itself by traversing sibling chain
-        tree_p->TraverseBI(&context);
-        NodeSnapshot *snapshot_p = tree_p->GetLatestNodeSnapshot(&context);
-        const BaseNode *node_p = snapshot_p->node_p;
+
+        NodeSnapshot snapshot{INVALID_NODE_ID, nullptr};
+
+        // This will be cached in the new IteratorContext object
+        InnerNode *parent_node_p = nullptr;
+
+        // First try to find the left sibling using the parent node cached
+        // in the current page, which is a single mapping table lookup in
+        // most cases
+        if(LocateLeftSiblingByParent(tree_p, &low_key, &snapshot) == true) {
+          // If the IteratorContext is shared with other iterators (e.g.
+          // postfix operator--) then we could not take its parent node
+          // and should make a copy
+          if(ic_p->GetRefCount() == 1UL) {
+            parent_node_p = ic_p->ReleaseParentNode();
+          } else {
+            const InnerNode *old_parent_node_p = ic_p->GetParentNode();
+
+            parent_node_p = reinterpret_cast<InnerNode *>( \
+              ElasticNode<KeyNodeIDPair>::\
+                Get(old_parent_node_p->GetSize(),
+                    NodeType::InnerType,
+                    0,
+                    old_parent_node_p->GetItemCount(),
+                    old_parent_node_p->GetLowKeyPair(),
+                    old_parent_node_p->GetHighKeyPair()));
+
+            parent_node_p->PushBack(old_parent_node_p->Begin(),
+                                    old_parent_node_p->End());
+          }
+        } else {
+          // Traverse backward using the low key. This function will
+          // try its best to reach the exact left page whose high key
+          // <= current low key
+          Context context{low_key, ic_p->GetTreeRoot()};
+          context.read_only_flag = true;
+
+          // This function stops and does not traverse LeafNode after adjusting
+          // itself by traversing sibling chain
+          tree_p->TraverseBI(&context);
+          snapshot = *tree_p->GetLatestNodeSnapshot(&context);
+
+          // Remember the parent node for the next time we cross the
+          // boundary of leaf pages
+          if(context.IsOnRootNode() == false) {
+            parent_node_p = \
+              tree_p->CollectAllSepsOnInner(&context.parent_snapshot);
+          }
+        }
+
+        const BaseNode *node_p = snapshot.node_p;
         
         // We must have reached a node whose low key is less than the
         // low key we used as the search key
@@ -9302,10 +18254,12 @@ try_join_again:
                (tree_p->KeyCmpLess(node_p->GetLowKey(), low_key) == true));
         
         // Release the current leaf page, and 
+        const uint64_t version = ic_p->GetVersion();
+        const TreeRoot tree_root = ic_p->GetTreeRoot();
         ic_p->DecRef();
-        ic_p = IteratorContext::Get(tree_p, node_p);
+        ic_p = IteratorContext::Load(tree_p, &snapshot, version, tree_root);
         assert(ic_p->GetRefCount() == 1UL);
-        tree_p->CollectAllValuesOnLeaf(snapshot_p, ic_p->GetLeafNode());
+        ic_p->SetParentNode(parent_node_p);
         
         // Now we could safely release the reference
         tree_p->epoch_manager.LeaveEpoch(epoch_node_p);
@@ -9344,6 +18298,74 @@ try_join_again:
       return;
     }
 
+    /*
+     * LocateLeftSiblingByParent() - Find the left sibling of the current page
+     *                               using the cached parent node
+     *
+     * The separator of the current page in its parent is its low key, and
+     * the NodeID before it is the left sibling (the low key NodeID if the
+     * separator is the first one). Since the cached parent might be stale
+     * we validate the result by requiring the high key of the node we load
+     * to be exactly low_key, and go right if the left sibling has been split
+     * after the parent was cached.
+     *
+     * Returns false if the parent is not cached, the current page is the
+     * left most child, or validation fails, in which case the caller should
+     * traverse from the root. The caller must have joined the epoch
+     */
+    bool LocateLeftSiblingByParent(BwTree *tree_p,
+                                   const KeyType *low_key_p,
+                                   NodeSnapshot *snapshot_p) {
+      const InnerNode *parent_node_p = ic_p->GetParentNode();
+      if(parent_node_p == nullptr) {
+        return false;
+      }
+
+      const KeyNodeIDPair *it = \
+        tree_p->KeyLowerBound(parent_node_p->Begin() + 1,
+                              parent_node_p->End(),
+                              *low_key_p);
+
+      if((it == parent_node_p->End()) || \
+         (tree_p->KeyCmpEqual(it->first, *low_key_p) == false)) {
+        return false;
+      }
+
+      NodeID node_id = (it - 1)->second;
+
+      while(1) {
+        const BaseNode *node_p = tree_p->GetNode(node_id);
+
+        // The node has been removed, or the high key is +Inf which means
+        // the node is not to the left of the current page. If the tree has
+        // been truncated then the NodeID might have been recycled for any
+        // node of the current tree
+        if((node_p == nullptr) || \
+           (node_p->IsOnLeafDeltaChain() == false) || \
+           (node_p->GetType() == NodeType::LeafRemoveType) || \
+           (node_p->GetNextNodeID() == INVALID_NODE_ID)) {
+          return false;
+        }
+
+        if(tree_p->KeyCmpEqual(node_p->GetHighKey(), *low_key_p) == true) {
+          snapshot_p->node_id = node_id;
+          snapshot_p->node_p = node_p;
+
+          return true;
+        } else if(tree_p->KeyCmpGreater(node_p->GetHighKey(),
+                                        *low_key_p) == true) {
+          // The current page has been merged into the node
+          return false;
+        }
+
+        // The left sibling has been split
+        node_id = node_p->GetNextNodeID();
+      }
+
+      assert(false);
+      return false;
+    }
+
     /*
      * MoveAheadByOne() - Move the iterator ahead by one
      *
@@ -9374,7 +18396,9 @@ try_join_again:
         // This will replace the current ic_p with a new one
         // all references to the ic_p will be invalidated
         LowerBound(ic_p->GetTree(),
-                   &ic_p->GetLeafNode()->GetHighKeyPair().first);
+                   &ic_p->GetLeafNode()->GetHighKeyPair().first,
+                   ic_p->GetVersion(),
+                   ic_p->GetTreeRoot());
       }
 
       return;
@@ -9389,25 +18413,69 @@ try_join_again:
    *
    * This is always called by the thread owning thread local data, so we
    * do not have to worry about thread identity issues
+   *
+   * installed_flag is false for nodes that have never been published in
+   * the mapping table, whose bytes were not counted as tree nodes
+   *
+   * Threads still in the current epoch may grow the chunks of the node after
+   * it is measured here. Such growth is counted into node_memory_size by
+   * InlineAllocate() and is subtracted from it when the node is freed
+   */
+  void AddGarbageNode(const BaseNode *node_p, bool installed_flag = true) {
+    size_t size = GetGarbageMemorySize(node_p);
+    if(installed_flag == true) {
+      node_memory_size.fetch_sub(static_cast<int64_t>(size),
+                                 std::memory_order_relaxed);
+    }
+
+    garbage_memory_size.fetch_add(static_cast<int64_t>(size),
+                                  std::memory_order_relaxed);
+
+    AddGarbage((void *)(node_p), size);
+    
+    return;
+  }
+  
+  /*
+   * AddGarbage() - Appends a node or a tagged stable value slot to the
+   *                garbage list of the current thread, and performs GC if
+   *                there are too many of them
+   *
+   * memory_size is the bytes counted into garbage_memory_size for the node
    */
-  void AddGarbageNode(const BaseNode *node_p) {
-    GarbageNode *garbage_node_p = \
-      new GarbageNode{GetGlobalEpoch(), (void *)(node_p)};
-    assert(garbage_node_p != nullptr);
+  void AddGarbage(void *garbage_p, size_t memory_size = 0UL) {
+    GCMetaData *metadata_p = GetCurrentGCMetaData();
+    GarbageSegment *segment_p = metadata_p->tail_p;
+    
+    // Start a new segment at the end of the list if the tail is full
+    if(segment_p == nullptr || segment_p->IsFull()) {
+      GarbageSegment *new_segment_p = AllocateGarbageSegment(metadata_p);
+      
+      if(segment_p == nullptr) {
+        metadata_p->head_p = new_segment_p;
+      } else {
+        segment_p->next_p = new_segment_p;
+      }
+      
+      metadata_p->tail_p = new_segment_p;
+      segment_p = new_segment_p;
+    }
     
-    // Link this new node to the end of the linked list
-    // and then update last_p
-    GetCurrentGCMetaData()->last_p->next_p = garbage_node_p;
-    GetCurrentGCMetaData()->last_p = garbage_node_p;
+    segment_p->node_list[segment_p->end_index] = \
+      GarbageNode{GetGlobalEpoch(), garbage_p, memory_size};
+    segment_p->end_index++;
     
     // Update the counter 
-    GetCurrentGCMetaData()->node_count++;
+    metadata_p->node_count++;
     
     // It is possible that we could not free enough number of nodes to
     // make it less than this threshold
     // So it is important to let the epoch counter be constantly increased
     // to guarantee progress
-    if(GetCurrentGCMetaData()->node_count > GC_NODE_COUNT_THREADHOLD) {
+    // If the tree advances epochs by itself this is done in LeaveEpoch()
+    if(auto_epoch_flag == false && \
+       (metadata_p->node_count > metadata_p->gc_threshold || \
+        IsMemoryLimitExceeded() == true)) {
       // Use current thread's gc id to perform GC
       PerformGC(gc_id);
     }
@@ -9415,6 +18483,31 @@ try_join_again:
     return;
   }
   
+  /*
+   * AllocateGarbageSegment() - Returns an empty garbage segment, reusing
+   *                            one from the thread's free list if possible
+   */
+  GarbageSegment *AllocateGarbageSegment(GCMetaData *metadata_p) {
+    GarbageSegment *segment_p = metadata_p->free_segment_p;
+    
+    if(segment_p == nullptr) {
+      garbage_list_memory_size.fetch_add( \
+        static_cast<int64_t>(sizeof(GarbageSegment)),
+        std::memory_order_relaxed);
+
+      return new (NodeAllocator::Allocate(sizeof(GarbageSegment))) \
+               GarbageSegment{};
+    }
+    
+    metadata_p->free_segment_p = segment_p->next_p;
+    
+    segment_p->next_p = nullptr;
+    segment_p->begin_index = 0UL;
+    segment_p->end_index = 0UL;
+    
+    return segment_p;
+  }
+  
   /*
    * PerformGC() - This function performs GC on the current thread's garbage 
    *               chain using the call back function
@@ -9427,40 +18520,120 @@ try_join_again:
    * GetCurrentGCMetaData()
    */
   void PerformGC(int thread_id) {
+    auto start_time = std::chrono::steady_clock::now();
+    
     // First of all get the minimum epoch of all active threads
     // This is the upper bound for deleted epoch in garbage node
-    uint64_t min_epoch = SummarizeGCEpoch();
-    
-    // This is the pointer we use to perform GC
-    // Note that we only fetch the metadata using the current thread-local id
-    GarbageNode *header_p = &GetGCMetaData(thread_id)->header; 
-    GarbageNode *first_p = header_p->next_p;
-    
-    // Then traverse the linked list
-    // Only reclaim memory when the deleted epoch < min epoch
-    while(first_p != nullptr && \
-          first_p->delete_epoch < min_epoch) {
-      // First unlink the current node from the linked list
-      // This could set it to nullptr
-      header_p->next_p = first_p->next_p;
+    uint64_t min_epoch = GetCachedGCEpoch();
+    
+    GCMetaData *metadata_p = GetGCMetaData(thread_id);
+    uint64_t old_count = metadata_p->node_count;
+    
+    FreeGarbageBefore(thread_id, min_epoch);
+    
+    // If less than half of the nodes could be freed then the epoch has not
+    // advanced enough, and we wait for more garbage before trying again.
+    // Once most nodes could be freed the threshold shrinks back
+    if(metadata_p->node_count > old_count / 2) {
+      if(metadata_p->gc_threshold < GC_NODE_COUNT_THREADHOLD_MAX) {
+        metadata_p->gc_threshold *= 2;
+      }
+    } else if(metadata_p->node_count < old_count / 8) {
+      if(metadata_p->gc_threshold > GC_NODE_COUNT_THREADHOLD) {
+        metadata_p->gc_threshold /= 2;
+      }
+    }
+    
+    // GC is rare enough to afford reading the clock
+    AddStatistics(&ThreadStatistics::gc_count);
+    AddStatistics(&ThreadStatistics::gc_time,
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_time).count());
+    
+    return;
+  }
+  
+  /*
+   * FreeGarbageBefore() - Frees garbage nodes of a thread whose delete epoch
+   *                       is less than the given epoch
+   *
+   * Drained segments are moved to the free segment list of the thread.
+   * Returns the number of nodes freed
+   */
+  size_t FreeGarbageBefore(int thread_id, uint64_t min_epoch) {
+    GCMetaData *metadata_p = GetGCMetaData(thread_id);
+    size_t freed_count = 0UL;
+    size_t freed_size = 0UL;
+    size_t grown_size = 0UL;
+    
+    while(metadata_p->head_p != nullptr) {
+      GarbageSegment *segment_p = metadata_p->head_p;
       
-      // Then free memory
-      epoch_manager.FreeEpochDeltaChain((const BaseNode *)first_p->node_p);
+      // Only reclaim memory when the deleted epoch < min epoch
+      while(segment_p->IsEmpty() == false) {
+        const GarbageNode &garbage_node = \
+          segment_p->node_list[segment_p->begin_index];
+        
+        if(garbage_node.delete_epoch >= min_epoch) {
+          assert(metadata_p->node_count >= freed_count);
+          metadata_p->node_count -= freed_count;
+
+          garbage_memory_size.fetch_sub(static_cast<int64_t>(freed_size),
+                                        std::memory_order_relaxed);
+          node_memory_size.fetch_sub(static_cast<int64_t>(grown_size),
+                                     std::memory_order_relaxed);
+          
+          return freed_count;
+        }
+        
+        size_t garbage_address = \
+          reinterpret_cast<size_t>(garbage_node.node_p);
+        
+        if((garbage_address & STABLE_VALUE_GARBAGE_TAG) != 0UL) {
+          // Stable value slots are reused by this thread
+          StableValueSlot *slot_p = reinterpret_cast<StableValueSlot *>( \
+            garbage_address & ~STABLE_VALUE_GARBAGE_TAG);
+          
+          slot_p->next_p = \
+            static_cast<StableValueSlot *>(metadata_p->free_value_slot_p);
+          metadata_p->free_value_slot_p = slot_p;
+        } else {
+          // Chunks grown after the node was retired were counted as tree
+          // nodes rather than garbage
+          size_t size = \
+            GetGarbageMemorySize((const BaseNode *)garbage_node.node_p);
+          assert(size >= garbage_node.memory_size);
+          
+          freed_size += garbage_node.memory_size;
+          grown_size += size - garbage_node.memory_size;
+          
+          epoch_manager.FreeEpochDeltaChain(
+            (const BaseNode *)garbage_node.node_p);
+        }
+        
+        segment_p->begin_index++;
+        freed_count++;
+      }
       
-      delete first_p;
-      assert(GetGCMetaData(thread_id)->node_count != 0UL);
-      GetGCMetaData(thread_id)->node_count--;
+      // Unlink the drained segment and keep it for reuse
+      metadata_p->head_p = segment_p->next_p;
+      if(metadata_p->head_p == nullptr) {
+        metadata_p->tail_p = nullptr;
+      }
       
-      first_p = header_p->next_p;
+      segment_p->next_p = metadata_p->free_segment_p;
+      metadata_p->free_segment_p = segment_p;
     }
     
-    // If we have freed all nodes in the linked list we should 
-    // reset last_p to the header
-    if(first_p == nullptr) {
-      GetGCMetaData(thread_id)->last_p = header_p;
-    }
+    assert(metadata_p->node_count == freed_count);
+    metadata_p->node_count = 0UL;
+
+    garbage_memory_size.fetch_sub(static_cast<int64_t>(freed_size),
+                                  std::memory_order_relaxed);
+    node_memory_size.fetch_sub(static_cast<int64_t>(grown_size),
+                               std::memory_order_relaxed);
     
-    return;
+    return freed_count;
   }
 
 }; // class BwTree
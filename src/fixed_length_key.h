@@ -0,0 +1,202 @@
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * class FixedLengthKey - Fixed sized binary key compared byte by byte
+ *
+ * Key bytes are stored inline, so node layouts hold the whole key without
+ * any indirection, and keys are ordered as unsigned byte strings, i.e. in
+ * the same way as memcmp(). Columns of a compound key are appended one
+ * after another in normalized form such that the byte order of the key is
+ * the same as the order of the column tuple:
+ *
+ *   - Unsigned integers are stored in big-endian
+ *   - Signed integers have their sign bit flipped and then stored in
+ *     big-endian
+ *   - Byte strings are copied as they are, padded with zero if shorter
+ *     than the column
+ *
+ * Unused bytes are always zero, so keys could be compared and hashed on
+ * all KEY_SIZE bytes.
+ *
+ * NOTE: This class is trivially copyable, and a default constructed key
+ * is the smallest key of its size
+ */
+template <size_t KEY_SIZE>
+class FixedLengthKey {
+  static_assert(KEY_SIZE > 0UL, "Key size must be positive");
+
+ public:
+  unsigned char data[KEY_SIZE];
+
+  /*
+   * Default Constructor - All bytes are zero
+   */
+  FixedLengthKey() {
+    memset(data, 0, KEY_SIZE);
+
+    return;
+  }
+
+  /*
+   * SetUnsigned() - Stores an unsigned integer column at an offset
+   *
+   * The column occupies size bytes of the key, which must be no more than 8.
+   * The lower size bytes of the value are stored in big-endian
+   */
+  inline void SetUnsigned(size_t offset, uint64_t value, size_t size = 8UL) {
+    assert(size > 0UL && size <= 8UL);
+    assert(offset + size <= KEY_SIZE);
+
+    for(size_t i = 0;i < size;i++) {
+      data[offset + size - 1 - i] = static_cast<unsigned char>(value >> (i * 8));
+    }
+
+    return;
+  }
+
+  /*
+   * SetSigned() - Stores a signed integer column at an offset
+   *
+   * Flipping the sign bit maps the signed order into unsigned order
+   */
+  inline void SetSigned(size_t offset, int64_t value, size_t size = 8UL) {
+    assert(size > 0UL && size <= 8UL);
+    assert(offset + size <= KEY_SIZE);
+
+    uint64_t sign_bit = ((uint64_t)1) << (size * 8 - 1);
+
+    SetUnsigned(offset, static_cast<uint64_t>(value) ^ sign_bit, size);
+
+    return;
+  }
+
+  /*
+   * SetBytes() - Copies a byte string column at an offset
+   *
+   * If the string is shorter than the column the rest is filled with zero
+   */
+  inline void SetBytes(size_t offset,
+                       const void *bytes_p,
+                       size_t length,
+                       size_t size) {
+    assert(length <= size);
+    assert(offset + size <= KEY_SIZE);
+
+    memcpy(data + offset, bytes_p, length);
+    memset(data + offset + length, 0, size - length);
+
+    return;
+  }
+
+  /*
+   * GetUnsigned() - Returns an unsigned integer column stored at an offset
+   */
+  inline uint64_t GetUnsigned(size_t offset, size_t size = 8UL) const {
+    assert(size > 0UL && size <= 8UL);
+    assert(offset + size <= KEY_SIZE);
+
+    uint64_t value = 0UL;
+    for(size_t i = 0;i < size;i++) {
+      value = (value << 8) | data[offset + i];
+    }
+
+    return value;
+  }
+
+  /*
+   * GetSigned() - Returns a signed integer column stored at an offset
+   */
+  inline int64_t GetSigned(size_t offset, size_t size = 8UL) const {
+    uint64_t sign_bit = ((uint64_t)1) << (size * 8 - 1);
+    uint64_t value = GetUnsigned(offset, size) ^ sign_bit;
+
+    // Sign extend if the column is less than 8 bytes
+    if(size < 8UL && (value & sign_bit) != 0UL) {
+      value |= ~((sign_bit << 1) - 1);
+    }
+
+    return static_cast<int64_t>(value);
+  }
+
+  /*
+   * LoadWord() - Loads 8 bytes at an offset as a big-endian integer
+   *
+   * Comparing such words as integers gives the same result as memcmp()
+   * over the 8 bytes
+   */
+  inline uint64_t LoadWord(size_t offset) const {
+    uint64_t word;
+    memcpy(&word, data + offset, sizeof(word));
+
+    return __builtin_bswap64(word);
+  }
+};
+
+/*
+ * class FixedLengthKeyComparator - Less than comparator for FixedLengthKey
+ *
+ * Full 8 byte words are compared as big-endian integers, and the remaining
+ * bytes, if any, with memcmp(). For key sizes of multiples of 8 the loop
+ * has a constant trip count and is fully unrolled by the compiler
+ */
+template <size_t KEY_SIZE>
+class FixedLengthKeyComparator {
+ public:
+  inline bool operator()(const FixedLengthKey<KEY_SIZE> &key1,
+                         const FixedLengthKey<KEY_SIZE> &key2) const {
+    for(size_t offset = 0;offset + 8 <= KEY_SIZE;offset += 8) {
+      uint64_t word1 = key1.LoadWord(offset);
+      uint64_t word2 = key2.LoadWord(offset);
+
+      if(word1 != word2) {
+        return word1 < word2;
+      }
+    }
+
+    constexpr size_t tail_offset = KEY_SIZE / 8 * 8;
+    if(tail_offset == KEY_SIZE) {
+      return false;
+    }
+
+    return memcmp(key1.data + tail_offset,
+                  key2.data + tail_offset,
+                  KEY_SIZE - tail_offset) < 0;
+  }
+};
+
+/*
+ * class FixedLengthKeyEqualityChecker - Equality checker for FixedLengthKey
+ */
+template <size_t KEY_SIZE>
+class FixedLengthKeyEqualityChecker {
+ public:
+  inline bool operator()(const FixedLengthKey<KEY_SIZE> &key1,
+                         const FixedLengthKey<KEY_SIZE> &key2) const {
+    return memcmp(key1.data, key2.data, KEY_SIZE) == 0;
+  }
+};
+
+/*
+ * class FixedLengthKeyHashFunc - Hash function for FixedLengthKey
+ *
+ * This is FNV-1a over all bytes of the key
+ */
+template <size_t KEY_SIZE>
+class FixedLengthKeyHashFunc {
+ public:
+  inline size_t operator()(const FixedLengthKey<KEY_SIZE> &key) const {
+    uint64_t hash = 14695981039346656037UL;
+
+    for(size_t i = 0;i < KEY_SIZE;i++) {
+      hash ^= key.data[i];
+      hash *= 1099511628211UL;
+    }
+
+    return static_cast<size_t>(hash);
+  }
+};
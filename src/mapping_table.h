@@ -0,0 +1,306 @@
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "page_allocator.h"
+
+/*
+ * class MappingTable - Lock-free segmented array of atomic pointers
+ *
+ * The table is divided into segments of SEGMENT_SIZE slots. A fixed sized
+ * directory holds pointers to segments, which are allocated on demand when
+ * the first index inside the segment is reserved. Therefore the capacity
+ * of the table is DIRECTORY_SIZE * SEGMENT_SIZE, but memory consumption
+ * only grows with the largest index that is actually in use.
+ *
+ * Lookup is two dependent loads: one on the directory and one on the slot
+ * inside the segment. Segments are never freed before the table is destroyed
+ * so the segment pointer read from the directory is always valid.
+ *
+ * Segments are allocated from the heap unless SetPageFlags() is called, in
+ * which case they are mapped by PageAllocator in groups that fill a huge
+ * page, such that lookups on a large table do not miss the TLB on every
+ * segment. Group k holds segments [k * SEGMENT_GROUP_SIZE,
+ * (k + 1) * SEGMENT_GROUP_SIZE), and since the position of a segment inside
+ * its group is fixed, threads racing on a group install the same pointers.
+ *
+ * NOTE: Reserve() must be called for an index before it is accessed through
+ * operator[]. All slots in a newly allocated segment are nullptr.
+ */
+template <typename T,
+          size_t SEGMENT_BITS,
+          size_t DIRECTORY_SIZE>
+class MappingTable {
+ public:
+  // Number of slots in each segment
+  static constexpr size_t SEGMENT_SIZE = ((size_t)1) << SEGMENT_BITS;
+
+  // Total number of slots of the table
+  static constexpr size_t CAPACITY = SEGMENT_SIZE * DIRECTORY_SIZE;
+
+  // Bytes of each segment
+  static constexpr size_t SEGMENT_BYTES = SEGMENT_SIZE * sizeof(std::atomic<T>);
+
+  // Number of segments mapped together if page flags are set
+  static constexpr size_t SEGMENT_GROUP_SIZE = \
+    (SEGMENT_BYTES >= PageAllocator::HUGE_PAGE_SIZE) ? \
+      1UL : PageAllocator::HUGE_PAGE_SIZE / SEGMENT_BYTES;
+
+ private:
+  // Only this level is allocated as part of the object
+  std::atomic<std::atomic<T> *> directory[DIRECTORY_SIZE];
+
+  // Number of segments installed into the directory
+  std::atomic<size_t> segment_count;
+
+  // Options of PageAllocator for segment groups, or 0 if segments are
+  // allocated from the heap
+  int page_flags;
+
+  /*
+   * AllocateSegmentGroup() - Maps the group of a segment and installs all
+   *                          segments of the group into the directory
+   *
+   * The first segment of a group points to the region, so the thread that
+   * installs it owns the region, and others free theirs. Other segments
+   * are stored by whoever sees them as nullptr
+   */
+  std::atomic<T> *AllocateSegmentGroup(size_t segment_index) {
+    size_t group_first = \
+      segment_index / SEGMENT_GROUP_SIZE * SEGMENT_GROUP_SIZE;
+    size_t group_end = \
+      std::min(group_first + SEGMENT_GROUP_SIZE, DIRECTORY_SIZE);
+
+    std::atomic<T> *group_p = directory[group_first].load();
+
+    if(group_p == nullptr) {
+      // The region is zero filled, which is nullptr for all slots
+      std::atomic<T> *new_group_p = \
+        reinterpret_cast<std::atomic<T> *>( \
+          PageAllocator::Allocate(SEGMENT_GROUP_SIZE * SEGMENT_BYTES,
+                                  page_flags));
+      if(new_group_p == nullptr) {
+        throw std::bad_alloc{};
+      }
+
+      bool ret = \
+        directory[group_first].compare_exchange_strong(group_p, new_group_p);
+
+      if(ret == true) {
+        group_p = new_group_p;
+
+        segment_count.fetch_add(group_end - group_first);
+      } else {
+        PageAllocator::Free(new_group_p,
+                            SEGMENT_GROUP_SIZE * SEGMENT_BYTES,
+                            page_flags);
+      }
+    }
+
+    for(size_t i = group_first + 1;i < group_end;i++) {
+      if(directory[i].load() == nullptr) {
+        directory[i].store(group_p + (i - group_first) * SEGMENT_SIZE);
+      }
+    }
+
+    return directory[segment_index].load();
+  }
+
+  /*
+   * AllocateSegment() - Allocates a segment and installs it into the directory
+   *
+   * If there is already a segment (probably installed by another thread
+   * after we have seen nullptr) then the new segment is freed and the
+   * existing one is returned
+   */
+  std::atomic<T> *AllocateSegment(size_t segment_index) {
+    if(page_flags != 0) {
+      return AllocateSegmentGroup(segment_index);
+    }
+
+    std::atomic<T> *segment_p = new std::atomic<T>[SEGMENT_SIZE];
+
+    for(size_t i = 0;i < SEGMENT_SIZE;i++) {
+      segment_p[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    std::atomic<T> *expected_p = nullptr;
+    bool ret = \
+      directory[segment_index].compare_exchange_strong(expected_p, segment_p);
+
+    if(ret == false) {
+      delete[] segment_p;
+
+      return expected_p;
+    }
+
+    segment_count.fetch_add(1UL);
+
+    return segment_p;
+  }
+
+ public:
+
+  /*
+   * Constructor - Initialize an empty directory
+   */
+  MappingTable() :
+    segment_count{0UL},
+    page_flags{0} {
+    for(size_t i = 0;i < DIRECTORY_SIZE;i++) {
+      directory[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    return;
+  }
+
+  /*
+   * Destructor - Frees all segments
+   *
+   * Objects pointed to by slots are not freed
+   */
+  ~MappingTable() {
+    if(page_flags != 0) {
+      for(size_t i = 0;i < DIRECTORY_SIZE;i += SEGMENT_GROUP_SIZE) {
+        PageAllocator::Free(directory[i].load(),
+                            SEGMENT_GROUP_SIZE * SEGMENT_BYTES,
+                            page_flags);
+      }
+
+      return;
+    }
+
+    for(size_t i = 0;i < DIRECTORY_SIZE;i++) {
+      delete[] directory[i].load();
+    }
+
+    return;
+  }
+
+  MappingTable(const MappingTable &) = delete;
+  MappingTable &operator=(const MappingTable &) = delete;
+
+  /*
+   * SetPageFlags() - Moves all segments into groups mapped by PageAllocator
+   *                  with the given options, which are also used for
+   *                  segments allocated later
+   *
+   * Slots of existing segments are copied, so this must be called when no
+   * other thread is accessing the table, and at most once
+   */
+  void SetPageFlags(int p_page_flags) {
+    assert(page_flags == 0);
+    assert(p_page_flags != 0);
+
+    std::vector<std::atomic<T> *> heap_segment_list(DIRECTORY_SIZE);
+    for(size_t i = 0;i < DIRECTORY_SIZE;i++) {
+      heap_segment_list[i] = directory[i].exchange(nullptr);
+    }
+
+    page_flags = p_page_flags;
+    segment_count.store(0UL);
+
+    for(size_t i = 0;i < DIRECTORY_SIZE;i++) {
+      if(heap_segment_list[i] == nullptr) {
+        continue;
+      }
+
+      std::atomic<T> *segment_p = AllocateSegmentGroup(i);
+
+      for(size_t j = 0;j < SEGMENT_SIZE;j++) {
+        segment_p[j].store(heap_segment_list[i][j].load(),
+                           std::memory_order_relaxed);
+      }
+
+      delete[] heap_segment_list[i];
+    }
+
+    return;
+  }
+
+  /*
+   * Preallocate() - Allocates segments for indices in [0, index_num)
+   *
+   * With PageAllocator::PREFAULT the pages of these segments are faulted
+   * here rather than on their first access
+   */
+  void Preallocate(size_t index_num) {
+    if(index_num > CAPACITY) {
+      index_num = CAPACITY;
+    }
+
+    for(size_t index = 0;index < index_num;index += SEGMENT_SIZE) {
+      Reserve(index);
+    }
+
+    return;
+  }
+
+  /*
+   * Reserve() - Makes sure the segment of an index has been allocated
+   *
+   * This function could be called by multiple threads concurrently
+   */
+  inline void Reserve(size_t index) {
+    assert(index < CAPACITY);
+
+    size_t segment_index = index >> SEGMENT_BITS;
+    if(directory[segment_index].load() == nullptr) {
+      AllocateSegment(segment_index);
+    }
+
+    return;
+  }
+
+  /*
+   * operator[] - Returns the atomic slot of an index
+   *
+   * The segment must have been allocated by Reserve()
+   */
+  inline std::atomic<T> &operator[](size_t index) {
+    assert(index < CAPACITY);
+
+    std::atomic<T> *segment_p = directory[index >> SEGMENT_BITS].load();
+    assert(segment_p != nullptr);
+
+    return segment_p[index & (SEGMENT_SIZE - 1)];
+  }
+
+  /*
+   * Prefetch() - Issues a prefetch for the slot of an index
+   *
+   * This is only a hint, so nothing is done if the segment has not been
+   * allocated
+   */
+  inline void Prefetch(size_t index) const {
+    assert(index < CAPACITY);
+
+    std::atomic<T> *segment_p = \
+      directory[index >> SEGMENT_BITS].load(std::memory_order_relaxed);
+    if(segment_p != nullptr) {
+      __builtin_prefetch(segment_p + (index & (SEGMENT_SIZE - 1)));
+    }
+
+    return;
+  }
+
+  /*
+   * GetSegmentCount() - Returns the number of allocated segments
+   */
+  size_t GetSegmentCount() const {
+    return segment_count.load(std::memory_order_relaxed);
+  }
+
+  /*
+   * GetMemorySize() - Returns the bytes of the directory and all segments
+   */
+  size_t GetMemorySize() const {
+    return sizeof(MappingTable) +
+           GetSegmentCount() * SEGMENT_SIZE * sizeof(std::atomic<T>);
+  }
+};
@@ -0,0 +1,385 @@
+
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "page_allocator.h"
+
+/*
+ * class DefaultNodeAllocator - Allocates node memory from the global heap
+ *
+ * A node allocator is passed to BwTree as a template argument, and is used
+ * for base nodes, the chunks that their delta records are allocated from,
+ * iterator pages and garbage list nodes. Any class with the following two
+ * static functions could be used as the allocator:
+ *
+ *   static void *Allocate(size_t size);
+ *   static void Free(void *p);
+ *
+ * Memory returned by Allocate() must be aligned to at least 16 bytes, and
+ * Free() might be called by a thread other than the one calling Allocate()
+ */
+class DefaultNodeAllocator {
+ public:
+  static void *Allocate(size_t size) {
+    return new char[size];
+  }
+
+  static void Free(void *p) {
+    delete[] reinterpret_cast<char *>(p);
+
+    return;
+  }
+};
+
+/*
+ * class PagedThreadLocalPoolAllocator - Per-thread slab pool for node sized
+ *                                       objects
+ *
+ * Each thread allocates from its own pool, which carves blocks out of large
+ * slabs allocated by that thread. Since the OS places pages on the memory
+ * node of the thread that first touches them, nodes created by a thread stay
+ * local to it on NUMA machines, and allocation does not contend with
+ * other threads.
+ *
+ * Blocks are rounded up to size classes of 2^n and 1.5 * 2^n bytes. Each
+ * block has a header recording its owner pool, so a block freed by another
+ * thread (e.g. by the epoch GC of the thread that unlinked it) is pushed
+ * into a lock-free remote free list of the owner, and the owner takes the
+ * whole list back when its local free list runs empty. Requests larger than
+ * the largest size class go to the global heap directly.
+ *
+ * If SLAB_PAGE_FLAGS is not 0 then slabs are mapped by PageAllocator with
+ * these options instead of being allocated from the heap, and each slab
+ * fills a huge page if huge pages are asked for. Pools of different flags
+ * are independent. See ThreadLocalPoolAllocator and HugePagePoolAllocator
+ *
+ * NOTE: Slabs are never returned to the OS. Pools of exited threads are kept
+ * in a global idle list and reused by new threads together with their
+ * cached blocks, so memory usage is bounded by the peak usage
+ */
+template <int SLAB_PAGE_FLAGS>
+class PagedThreadLocalPoolAllocator {
+ public:
+  // The smallest block size in bytes, including the block header
+  static constexpr size_t MIN_BLOCK_SIZE = 64UL;
+
+  // Size classes are 64, 96, 128, 192, ..., 64K, 96K
+  static constexpr size_t SIZE_CLASS_NUM = 22UL;
+
+  // This is used to mark blocks from the global heap
+  static constexpr size_t LARGE_SIZE_CLASS = SIZE_CLASS_NUM;
+
+  // Blocks are carved from slabs of this size
+  static constexpr size_t SLAB_SIZE = \
+    ((SLAB_PAGE_FLAGS & (PageAllocator::HUGE_PAGE | \
+                         PageAllocator::HUGETLB)) != 0) ? \
+      PageAllocator::HUGE_PAGE_SIZE : ((size_t)1) << 20;
+
+ private:
+  class Pool;
+
+  /*
+   * class BlockHeader - Precedes every block returned to the caller
+   *
+   * The size of this header keeps the returned address 16 byte aligned
+   */
+  class BlockHeader {
+   public:
+    // nullptr if the block is allocated from the global heap
+    Pool *owner_p;
+    size_t size_class;
+  };
+
+  static_assert(sizeof(BlockHeader) == 16UL,
+                "class BlockHeader breaks alignment!");
+
+  /*
+   * class FreeBlock - The layout of a block on a free list
+   *
+   * The link pointer overlaps with the memory of the caller
+   */
+  class FreeBlock {
+   public:
+    BlockHeader header;
+    FreeBlock *next_p;
+  };
+
+  /*
+   * class Pool - The pool owned by one thread
+   *
+   * Local free lists and the slab are only accessed by the owner thread.
+   * Remote free lists are pushed by other threads with CAS and popped as
+   * a whole by the owner with an atomic exchange, which is free of ABA
+   */
+  class Pool {
+   public:
+    FreeBlock *free_list[SIZE_CLASS_NUM];
+    std::atomic<FreeBlock *> remote_free_list[SIZE_CLASS_NUM];
+
+    // Current slab being carved
+    char *slab_p;
+    char *slab_end_p;
+
+    // All slabs allocated by this pool
+    std::vector<char *> slab_list;
+
+    /*
+     * Constructor - Initialize empty lists. Slabs are allocated on demand
+     */
+    Pool() :
+      slab_p{nullptr},
+      slab_end_p{nullptr},
+      slab_list{} {
+      for(size_t i = 0;i < SIZE_CLASS_NUM;i++) {
+        free_list[i] = nullptr;
+        remote_free_list[i].store(nullptr);
+      }
+
+      return;
+    }
+
+    /*
+     * AllocateBlock() - Allocates a block of the given size class
+     */
+    FreeBlock *AllocateBlock(size_t size_class) {
+      FreeBlock *block_p = free_list[size_class];
+
+      // Take back all blocks freed by other threads
+      if(block_p == nullptr) {
+        block_p = remote_free_list[size_class].exchange(nullptr);
+      }
+
+      if(block_p != nullptr) {
+        free_list[size_class] = block_p->next_p;
+
+        return block_p;
+      }
+
+      size_t block_size = GetClassSize(size_class);
+
+      // The remaining part of the slab is wasted, which is less than
+      // the largest size class
+      if(static_cast<size_t>(slab_end_p - slab_p) < block_size) {
+        slab_p = AllocateSlab();
+        slab_end_p = slab_p + SLAB_SIZE;
+
+        slab_list.push_back(slab_p);
+      }
+
+      block_p = reinterpret_cast<FreeBlock *>(slab_p);
+      slab_p += block_size;
+
+      block_p->header.owner_p = this;
+      block_p->header.size_class = size_class;
+
+      return block_p;
+    }
+
+    /*
+     * FreeLocalBlock() - Returns a block to the local free list
+     */
+    inline void FreeLocalBlock(FreeBlock *block_p) {
+      size_t size_class = block_p->header.size_class;
+
+      block_p->next_p = free_list[size_class];
+      free_list[size_class] = block_p;
+
+      return;
+    }
+
+    /*
+     * FreeRemoteBlock() - Returns a block owned by this pool from another
+     *                     thread
+     */
+    inline void FreeRemoteBlock(FreeBlock *block_p) {
+      std::atomic<FreeBlock *> &list = \
+        remote_free_list[block_p->header.size_class];
+
+      FreeBlock *head_p = list.load();
+      do {
+        block_p->next_p = head_p;
+      } while(list.compare_exchange_weak(head_p, block_p) == false);
+
+      return;
+    }
+  };
+
+  /*
+   * AllocateSlab() - Allocates a slab of SLAB_SIZE bytes
+   */
+  static char *AllocateSlab() {
+    if(SLAB_PAGE_FLAGS == 0) {
+      return new char[SLAB_SIZE];
+    }
+
+    char *slab_p = reinterpret_cast<char *>( \
+      PageAllocator::Allocate(SLAB_SIZE, SLAB_PAGE_FLAGS));
+    if(slab_p == nullptr) {
+      throw std::bad_alloc{};
+    }
+
+    return slab_p;
+  }
+
+  /*
+   * class PoolHandle - Thread local handle to the pool of a thread
+   *
+   * The pool is taken from the global idle list if there is one, and is
+   * put back into the list when the thread exits
+   */
+  class PoolHandle {
+   public:
+    Pool *pool_p;
+
+    PoolHandle() {
+      std::lock_guard<std::mutex> guard{GetIdleListLock()};
+
+      std::vector<Pool *> &idle_list = GetIdleList();
+      if(idle_list.size() == 0UL) {
+        pool_p = new Pool{};
+      } else {
+        pool_p = idle_list.back();
+        idle_list.pop_back();
+      }
+
+      return;
+    }
+
+    ~PoolHandle() {
+      std::lock_guard<std::mutex> guard{GetIdleListLock()};
+
+      GetIdleList().push_back(pool_p);
+
+      return;
+    }
+  };
+
+  /*
+   * GetIdleList() - Returns the list of pools not owned by any thread
+   *
+   * Function local statics are used to keep this class header only
+   */
+  static std::vector<Pool *> &GetIdleList() {
+    static std::vector<Pool *> idle_list{};
+
+    return idle_list;
+  }
+
+  static std::mutex &GetIdleListLock() {
+    static std::mutex idle_list_lock{};
+
+    return idle_list_lock;
+  }
+
+  /*
+   * GetLocalPool() - Returns the pool of the current thread
+   */
+  static Pool *GetLocalPool() {
+    static thread_local PoolHandle handle{};
+
+    return handle.pool_p;
+  }
+
+ public:
+
+  /*
+   * GetSizeClass() - Returns the smallest size class that holds size bytes
+   *
+   * If size is in (2^n, 2^(n+1)] then the size class is either 1.5 * 2^n
+   * or 2^(n+1)
+   */
+  static inline size_t GetSizeClass(size_t size) {
+    if(size <= MIN_BLOCK_SIZE) {
+      return 0UL;
+    }
+
+    // This is n, and we know n >= 6 here
+    size_t shift = 63UL - __builtin_clzl(size - 1);
+
+    if(size <= (((size_t)3) << (shift - 1))) {
+      return 2 * (shift - 6) + 1;
+    }
+
+    return 2 * (shift - 5);
+  }
+
+  /*
+   * GetClassSize() - Returns the block size of a size class
+   */
+  static inline size_t GetClassSize(size_t size_class) {
+    if(size_class % 2 == 0) {
+      return MIN_BLOCK_SIZE << (size_class / 2);
+    }
+
+    return (MIN_BLOCK_SIZE + MIN_BLOCK_SIZE / 2) << (size_class / 2);
+  }
+
+  /*
+   * Allocate() - Allocates memory from the current thread's pool
+   */
+  static void *Allocate(size_t size) {
+    size_t size_class = GetSizeClass(size + sizeof(BlockHeader));
+
+    if(size_class >= SIZE_CLASS_NUM) {
+      BlockHeader *header_p = \
+        reinterpret_cast<BlockHeader *>(new char[size + sizeof(BlockHeader)]);
+
+      header_p->owner_p = nullptr;
+      header_p->size_class = LARGE_SIZE_CLASS;
+
+      return header_p + 1;
+    }
+
+    FreeBlock *block_p = GetLocalPool()->AllocateBlock(size_class);
+
+    return &block_p->header + 1;
+  }
+
+  /*
+   * Free() - Returns memory to its owner pool
+   */
+  static void Free(void *p) {
+    BlockHeader *header_p = reinterpret_cast<BlockHeader *>(p) - 1;
+
+    if(header_p->owner_p == nullptr) {
+      assert(header_p->size_class == LARGE_SIZE_CLASS);
+
+      delete[] reinterpret_cast<char *>(header_p);
+
+      return;
+    }
+
+    FreeBlock *block_p = reinterpret_cast<FreeBlock *>(header_p);
+    Pool *local_pool_p = GetLocalPool();
+
+    if(header_p->owner_p == local_pool_p) {
+      local_pool_p->FreeLocalBlock(block_p);
+    } else {
+      header_p->owner_p->FreeRemoteBlock(block_p);
+    }
+
+    return;
+  }
+};
+
+/*
+ * ThreadLocalPoolAllocator - Pool allocator with slabs from the heap
+ */
+using ThreadLocalPoolAllocator = PagedThreadLocalPoolAllocator<0>;
+
+/*
+ * HugePagePoolAllocator - Pool allocator with slabs on transparent huge
+ *                         pages, which are faulted when the slab is carved
+ *
+ * This reduces TLB misses of lookups on a large tree, and moves page faults
+ * out of the allocation of individual nodes
+ */
+using HugePagePoolAllocator = \
+  PagedThreadLocalPoolAllocator<PageAllocator::HUGE_PAGE | \
+                                PageAllocator::PREFAULT>;
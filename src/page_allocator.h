@@ -0,0 +1,177 @@
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * class PageAllocator - Allocates page aligned regions directly from the OS
+ *
+ * This backs the mapping table and the slabs of node pools if they are
+ * asked to use huge pages. Each option is a hint, and is silently given up
+ * if the OS does not support it, so the caller always gets a usable region:
+ *
+ *   - HUGE_PAGE: The region is aligned to HUGE_PAGE_SIZE and advised with
+ *                MADV_HUGEPAGE, such that it is backed by transparent huge
+ *                pages where possible
+ *   - HUGETLB: The region is mapped from the reserved hugetlbfs pool with
+ *              MAP_HUGETLB, falling back to HUGE_PAGE if the pool is empty
+ *   - PREFAULT: All pages are touched before the region is returned, such
+ *               that page faults do not happen on the first access
+ *   - INTERLEAVE: Pages are interleaved over all memory nodes with mbind(),
+ *                 which suits memory shared by all threads
+ *
+ * Regions are zero filled. Sizes are rounded up to HUGE_PAGE_SIZE if either
+ * of the first two options is given, and to SMALL_PAGE_SIZE otherwise. The
+ * same size and flags must be passed to Free()
+ */
+class PageAllocator {
+ public:
+  static constexpr int HUGE_PAGE = 0x1;
+  static constexpr int HUGETLB = 0x2;
+  static constexpr int PREFAULT = 0x4;
+  static constexpr int INTERLEAVE = 0x8;
+
+  static constexpr size_t SMALL_PAGE_SIZE = ((size_t)1) << 12;
+  static constexpr size_t HUGE_PAGE_SIZE = ((size_t)1) << 21;
+
+ private:
+  // Value of MPOL_INTERLEAVE in linux/mempolicy.h, which is not included
+  // to avoid depending on libnuma headers
+  static constexpr int MPOL_INTERLEAVE_MODE = 3;
+
+  /*
+   * MapAligned() - Maps an anonymous region aligned to HUGE_PAGE_SIZE
+   *
+   * One more huge page is mapped, and the unaligned head and tail are
+   * unmapped
+   */
+  static void *MapAligned(size_t size) {
+    size_t map_size = size + HUGE_PAGE_SIZE;
+    void *map_p = mmap(nullptr,
+                       map_size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1,
+                       0);
+    if(map_p == MAP_FAILED) {
+      return nullptr;
+    }
+
+    uintptr_t map_addr = reinterpret_cast<uintptr_t>(map_p);
+    uintptr_t addr = (map_addr + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    if(addr != map_addr) {
+      munmap(map_p, addr - map_addr);
+    }
+
+    if(map_addr + map_size != addr + size) {
+      munmap(reinterpret_cast<void *>(addr + size),
+             map_addr + map_size - (addr + size));
+    }
+
+    return reinterpret_cast<void *>(addr);
+  }
+
+ public:
+
+  /*
+   * GetRegionSize() - Returns the bytes actually mapped for a request
+   */
+  static size_t GetRegionSize(size_t size, int flags) {
+    size_t page_size = \
+      ((flags & (HUGE_PAGE | HUGETLB)) != 0) ? HUGE_PAGE_SIZE : SMALL_PAGE_SIZE;
+
+    return (size + page_size - 1) / page_size * page_size;
+  }
+
+  /*
+   * Allocate() - Maps a zero filled region of at least size bytes
+   *
+   * Returns nullptr only if the OS is out of memory
+   */
+  static void *Allocate(size_t size, int flags) {
+    size = GetRegionSize(size, flags);
+
+    void *region_p = nullptr;
+
+    if((flags & HUGETLB) != 0) {
+      region_p = mmap(nullptr,
+                      size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                      -1,
+                      0);
+      if(region_p == MAP_FAILED) {
+        region_p = nullptr;
+      }
+    }
+
+    if(region_p == nullptr) {
+      if((flags & (HUGE_PAGE | HUGETLB)) != 0) {
+        region_p = MapAligned(size);
+
+        if(region_p != nullptr) {
+          madvise(region_p, size, MADV_HUGEPAGE);
+        }
+      } else {
+        region_p = mmap(nullptr,
+                        size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1,
+                        0);
+        if(region_p == MAP_FAILED) {
+          region_p = nullptr;
+        }
+      }
+    }
+
+    if(region_p == nullptr) {
+      return nullptr;
+    }
+
+    // The policy only applies to pages faulted after this, so it must be
+    // set before prefaulting
+    if((flags & INTERLEAVE) != 0) {
+      unsigned long node_mask = ~0UL;
+
+      syscall(SYS_mbind,
+              region_p,
+              size,
+              MPOL_INTERLEAVE_MODE,
+              &node_mask,
+              sizeof(node_mask) * 8,
+              0);
+    }
+
+    if((flags & PREFAULT) != 0) {
+      volatile char *p = reinterpret_cast<volatile char *>(region_p);
+
+      for(size_t offset = 0;offset < size;offset += SMALL_PAGE_SIZE) {
+        p[offset] = 0;
+      }
+    }
+
+    return region_p;
+  }
+
+  /*
+   * Free() - Unmaps a region returned by Allocate()
+   */
+  static void Free(void *region_p, size_t size, int flags) {
+    if(region_p == nullptr) {
+      return;
+    }
+
+    int ret = munmap(region_p, GetRegionSize(size, flags));
+    assert(ret == 0);
+    (void)ret;
+
+    return;
+  }
+};
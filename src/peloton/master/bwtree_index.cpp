@@ -128,77 +128,71 @@ BWTREE_INDEX_TYPE::CondInsertEntry(const storage::Tuple *key,
   return ret;
 }
 
+/*
+ * ScanInRange() - Calls scan_func with the key tuple and the value of every
+ *                 entry satisfying the predicates
+ *
+ * The key tuple is valid only during the call
+ */
 BWTREE_TEMPLATE_ARGUMENTS
+template <typename ScanFunc>
 void
-BWTREE_INDEX_TYPE::Scan(const std::vector<Value> &values,
-                        const std::vector<oid_t> &key_column_ids,
-                        const std::vector<ExpressionType> &expr_types,
-                        const ScanDirectionType &scan_direction,
-                        std::vector<ItemPointer> &result) {
+BWTREE_INDEX_TYPE::ScanInRange(const std::vector<Value> &values,
+                               const std::vector<oid_t> &key_column_ids,
+                               const std::vector<ExpressionType> &expr_types,
+                               const ScanDirectionType &scan_direction,
+                               ScanFunc &&scan_func) {
   KeyType index_key;
+  ScanRange range{};
 
-  // Checkif we have leading (leftmost) column equality
+  // The range to scan is derived from predicates on leading (leftmost)
+  // key columns
   // refer : http://www.postgresql.org/docs/8.2/static/indexes-multicolumn.html
-  oid_t leading_column_id = 0;
-  auto key_column_ids_itr = std::find(key_column_ids.begin(),
-                                      key_column_ids.end(), leading_column_id);
-
-  // SPECIAL CASE : leading column id is one of the key column ids
-  // and is involved in a equality constraint
-  bool special_case = false;
-  if (key_column_ids_itr != key_column_ids.end()) {
-    auto offset = std::distance(key_column_ids.begin(), key_column_ids_itr);
-    if (expr_types[offset] == EXPRESSION_TYPE_COMPARE_EQUAL) {
-      special_case = true;
+  std::unique_ptr<storage::Tuple> start_key{
+    new storage::Tuple(metadata->GetKeySchema(), true)};
+
+  ConstructScanRange(start_key.get(),
+                     values,
+                     key_column_ids,
+                     expr_types,
+                     range);
+
+  LOG_TRACE("Equal column count : %u ", range.equal_column_count);
+
+  index_key.SetFromKey(start_key.get());
+
+  // If all key columns are fixed then it is a point query and we just do a
+  // GetValue() since GetValue() is way more faster than scanning using
+  // iterator. Other predicates are checked once on the key
+  if(range.equal_column_count == \
+     metadata->GetKeySchema()->GetColumnCount()) {
+    auto tuple = index_key.GetTupleForComparison(metadata->GetKeySchema());
+    if(Compare(tuple, key_column_ids, expr_types, values) == false) {
+      return;
     }
-  }
-
-  LOG_TRACE("Special case : %d ", special_case);
 
-  // This is only a placeholder that cannot be moved but can be assigned to
-  auto scan_begin_itr = container.NullIterator();
-  
-  std::unique_ptr<storage::Tuple> start_key;
-  bool all_constraints_are_equal = false;
+    std::vector<ItemPointer *> item_p_list{};
 
-  // If it is a special case, we can figure out the range to scan in the index
-  if (special_case == true) {
-    start_key.reset(new storage::Tuple(metadata->GetKeySchema(), true));
+    // This retrieves a list of ItemPointer *
+    container.GetValue(index_key, item_p_list);
 
-    // Construct the lower bound key tuple
-    all_constraints_are_equal = ConstructLowerBoundTuple(
-        start_key.get(), values, key_column_ids, expr_types);
-        
-    LOG_TRACE("All constraints are equal : %d ", all_constraints_are_equal);
-    
-    index_key.SetFromKey(start_key.get());
-    
-    // If it is point query then we just do a GetValue() since GetValue()
-    // is way more faster than scanning using iterator
-    if(all_constraints_are_equal == true) {
-      std::vector<ItemPointer *> item_p_list{};
-      
-      // This retrieves a list of ItemPointer *
-      container.GetValue(index_key, item_p_list);
-
-      // To reduce allocation
-      result.reserve(item_p_list.size());
-      
-      // Dereference pointers one by one
-      for(auto p : item_p_list) {
-        result.push_back(*p);
-      }
-      
-      return;
+    for(auto p : item_p_list) {
+      scan_func(tuple, p);
     }
 
-    // This returns an iterator pointing to index_key's values
+    return;
+  }
+
+  // This is only a placeholder that cannot be moved but can be assigned to
+  auto scan_begin_itr = container.NullIterator();
+
+  if(range.low_bound_flag == true) {
+    // This returns an iterator pointing to the first key not less than
+    // the lower bound
     scan_begin_itr = container.Begin(index_key);
   } else {
     scan_begin_itr = container.Begin();
   }
-  
-  //printf("Start scanning\n");
 
   switch (scan_direction) {
     case SCAN_DIRECTION_TYPE_FORWARD:
@@ -212,16 +206,21 @@ BWTREE_INDEX_TYPE::Scan(const std::vector<Value> &values,
         auto tuple =
             scan_current_key.GetTupleForComparison(metadata->GetKeySchema());
 
+        // Keys are ordered column by column, so after the first key above
+        // the range all keys are above the range
+        if (IsAboveScanRange(tuple,
+                             values,
+                             key_column_ids,
+                             expr_types,
+                             range) == true) {
+          break;
+        }
+
         // Compare the current key in the scan with "values" based on
         // "expression types"
         // For instance, "5" EXPR_GREATER_THAN "2" is true
         if (Compare(tuple, key_column_ids, expr_types, values) == true) {
-          result.push_back(*(scan_itr->second));
-        } else {
-          // We can stop scanning if we know that all constraints are equal
-          if (all_constraints_are_equal == true) {
-            break;
-          }
+          scan_func(tuple, scan_itr->second);
         }
       }
 
@@ -236,6 +235,24 @@ BWTREE_INDEX_TYPE::Scan(const std::vector<Value> &values,
   return;
 }
 
+BWTREE_TEMPLATE_ARGUMENTS
+void
+BWTREE_INDEX_TYPE::Scan(const std::vector<Value> &values,
+                        const std::vector<oid_t> &key_column_ids,
+                        const std::vector<ExpressionType> &expr_types,
+                        const ScanDirectionType &scan_direction,
+                        std::vector<ItemPointer> &result) {
+  ScanInRange(values,
+              key_column_ids,
+              expr_types,
+              scan_direction,
+              [&result](const AbstractTuple &, ItemPointer *item_p) {
+                result.push_back(*item_p);
+              });
+
+  return;
+}
+
 BWTREE_TEMPLATE_ARGUMENTS
 void
 BWTREE_INDEX_TYPE::ScanAllKeys(std::vector<ItemPointer> &result) {
@@ -275,95 +292,13 @@ BWTREE_INDEX_TYPE::Scan(const std::vector<Value> &values,
                         const std::vector<ExpressionType> &expr_types,
                         const ScanDirectionType &scan_direction,
                         std::vector<ItemPointer *> &result) {
-  KeyType index_key;
-
-  // Checkif we have leading (leftmost) column equality
-  // refer : http://www.postgresql.org/docs/8.2/static/indexes-multicolumn.html
-  oid_t leading_column_id = 0;
-  auto key_column_ids_itr = std::find(key_column_ids.begin(),
-                                      key_column_ids.end(), leading_column_id);
-
-  // SPECIAL CASE : leading column id is one of the key column ids
-  // and is involved in a equality constraint
-  bool special_case = false;
-  if (key_column_ids_itr != key_column_ids.end()) {
-    auto offset = std::distance(key_column_ids.begin(), key_column_ids_itr);
-    if (expr_types[offset] == EXPRESSION_TYPE_COMPARE_EQUAL) {
-      special_case = true;
-    }
-  }
-
-  LOG_TRACE("Special case : %d ", special_case);
-
-  // This is only a placeholder that cannot be moved but can be assigned to
-  auto scan_begin_itr = container.NullIterator();
-
-  std::unique_ptr<storage::Tuple> start_key;
-  bool all_constraints_are_equal = false;
-
-  // If it is a special case, we can figure out the range to scan in the index
-  if (special_case == true) {
-    start_key.reset(new storage::Tuple(metadata->GetKeySchema(), true));
-
-    // Construct the lower bound key tuple
-    all_constraints_are_equal = ConstructLowerBoundTuple(
-        start_key.get(), values, key_column_ids, expr_types);
-
-    LOG_TRACE("All constraints are equal : %d ", all_constraints_are_equal);
-
-    index_key.SetFromKey(start_key.get());
-/*
-    // If it is point query then we just do a GetValue() since GetValue()
-    // is way more faster than scanning using iterator
-    if(all_constraints_are_equal == true) {
-      //printf("All constraints are equal\n");
-      
-      // This retrieves a list of ItemPointer *
-      container.GetValue(index_key, result);
-
-      return;
-    }
-*/
-    //printf("Non special case\n");
-
-    // This returns an iterator pointing to index_key's values
-    scan_begin_itr = container.Begin(index_key);
-  } else {
-    scan_begin_itr = container.Begin();
-  }
-
-  switch (scan_direction) {
-    case SCAN_DIRECTION_TYPE_FORWARD:
-    case SCAN_DIRECTION_TYPE_BACKWARD: {
-      // Scan the index entries in forward direction
-      for (auto scan_itr = scan_begin_itr;
-           scan_itr.IsEnd() == false;
-           scan_itr++) {
-        KeyType &scan_current_key = const_cast<KeyType &>(scan_itr->first);
-          
-        auto tuple =
-            scan_current_key.GetTupleForComparison(metadata->GetKeySchema());
-
-        // Compare the current key in the scan with "values" based on
-        // "expression types"
-        // For instance, "5" EXPR_GREATER_THAN "2" is true
-        if (Compare(tuple, key_column_ids, expr_types, values) == true) {
-          result.push_back(scan_itr->second);
-        } else {
-          // We can stop scanning if we know that all constraints are equal
-          if (all_constraints_are_equal == true) {
-            break;
-          }
-        }
-      }
-
-    } break;
-
-    case SCAN_DIRECTION_TYPE_INVALID:
-    default:
-      throw Exception("Invalid scan direction \n");
-      break;
-  }
+  ScanInRange(values,
+              key_column_ids,
+              expr_types,
+              scan_direction,
+              [&result](const AbstractTuple &, ItemPointer *item_p) {
+                result.push_back(item_p);
+              });
 
   return;
 }
@@ -395,6 +330,166 @@ BWTREE_INDEX_TYPE::ScanKey(const storage::Tuple *key,
   return;
 }
 
+/*
+ * ScanKeyColumns() - Index-only scan that also returns values of the
+ *                    requested key columns
+ *
+ * Values are decoded from keys buffered by the iterator, so covered
+ * queries do not read the table. The i-th entry of column_value_list
+ * holds values of output_column_ids for the i-th ItemPointer of result
+ */
+BWTREE_TEMPLATE_ARGUMENTS
+void
+BWTREE_INDEX_TYPE::ScanKeyColumns(const std::vector<Value> &values,
+                                  const std::vector<oid_t> &key_column_ids,
+                                  const std::vector<ExpressionType> &expr_types,
+                                  const ScanDirectionType &scan_direction,
+                                  const std::vector<oid_t> &output_column_ids,
+                                  std::vector<std::vector<Value>> &column_value_list,
+                                  std::vector<ItemPointer> &result) {
+  ScanInRange(values,
+              key_column_ids,
+              expr_types,
+              scan_direction,
+              [&](const AbstractTuple &key_tuple, ItemPointer *item_p) {
+                std::vector<Value> column_values{};
+                column_values.reserve(output_column_ids.size());
+
+                for(oid_t column_id : output_column_ids) {
+                  column_values.push_back(key_tuple.GetValue(column_id));
+                }
+
+                column_value_list.push_back(std::move(column_values));
+                result.push_back(*item_p);
+              });
+
+  return;
+}
+
+/*
+ * ConstructScanRange() - Sets the lower bound key of a scan and collects
+ *                        predicates that end the scan
+ *
+ * Leading key columns fixed by equality predicates form a prefix, and the
+ * column after the prefix could have a lower and an upper bound. Since
+ * keys are ordered column by column, the scan starts from the prefix and
+ * the lower bound (other columns are set to the min value), and every key
+ * after the first one violating an equality predicate of the prefix or an
+ * upper bound of the column after it also violates the predicate
+ */
+BWTREE_TEMPLATE_ARGUMENTS
+void
+BWTREE_INDEX_TYPE::ConstructScanRange(storage::Tuple *low_key,
+                                      const std::vector<Value> &values,
+                                      const std::vector<oid_t> &key_column_ids,
+                                      const std::vector<ExpressionType> &expr_types,
+                                      ScanRange &range) {
+  auto schema = low_key->GetSchema();
+  oid_t column_count = schema->GetColumnCount();
+
+  range.equal_column_count = 0;
+  range.low_bound_flag = false;
+  range.high_offset_list.clear();
+
+  // Whether all columns before the current one are fixed
+  bool prefix_flag = true;
+
+  for (oid_t column_itr = 0; column_itr < column_count; column_itr++) {
+    const Value *low_value_p = nullptr;
+    bool equal_flag = false;
+
+    for (oid_t offset = 0; prefix_flag == true && offset < key_column_ids.size();
+         offset++) {
+      if (key_column_ids[offset] != column_itr) {
+        continue;
+      }
+
+      switch (expr_types[offset]) {
+        case EXPRESSION_TYPE_COMPARE_EQUAL:
+          equal_flag = true;
+          low_value_p = &values[offset];
+          range.high_offset_list.push_back(offset);
+          break;
+        case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+        case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+          if (low_value_p == nullptr) {
+            low_value_p = &values[offset];
+          }
+          break;
+        case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+        case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+          range.high_offset_list.push_back(offset);
+          break;
+        default:
+          break;
+      }
+    }
+
+    // The inclusive lower bound is checked again by Compare() in the scan
+    if (low_value_p != nullptr) {
+      low_key->SetValue(column_itr, *low_value_p, GetPool());
+
+      if (column_itr == 0) {
+        range.low_bound_flag = true;
+      }
+    } else {
+      auto value_type = schema->GetType(column_itr);
+      low_key->SetValue(column_itr, Value::GetMinValue(value_type), GetPool());
+    }
+
+    if (prefix_flag == true && equal_flag == true) {
+      range.equal_column_count++;
+    } else {
+      prefix_flag = false;
+    }
+  }
+
+  return;
+}
+
+/*
+ * IsAboveScanRange() - Returns true if a key starting from the lower bound
+ *                      is above the range of the scan
+ *
+ * Predicates are checked in the order of key columns, and a key is above
+ * the range once a column is greater than its equality predicate or
+ * reaches its upper bound while all columns before it are equal
+ */
+BWTREE_TEMPLATE_ARGUMENTS
+bool
+BWTREE_INDEX_TYPE::IsAboveScanRange(const AbstractTuple &key_tuple,
+                                    const std::vector<Value> &values,
+                                    const std::vector<oid_t> &key_column_ids,
+                                    const std::vector<ExpressionType> &expr_types,
+                                    const ScanRange &range) {
+  for (oid_t offset : range.high_offset_list) {
+    Value key_value = key_tuple.GetValue(key_column_ids[offset]);
+    int diff = key_value.Compare(values[offset]);
+
+    switch (expr_types[offset]) {
+      case EXPRESSION_TYPE_COMPARE_EQUAL:
+        if (diff == VALUE_COMPARE_GREATERTHAN) {
+          return true;
+        }
+        break;
+      case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+        if (diff != VALUE_COMPARE_LESSTHAN) {
+          return true;
+        }
+        break;
+      case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+        if (diff == VALUE_COMPARE_GREATERTHAN) {
+          return true;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  return false;
+}
+
 BWTREE_TEMPLATE_ARGUMENTS
 std::string
 BWTREE_INDEX_TYPE::GetTypeName() const {
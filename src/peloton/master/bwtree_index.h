@@ -116,6 +116,14 @@ class BWTreeIndex : public Index {
   void ScanKey(const storage::Tuple *key,
                std::vector<ItemPointer *> &result);
 
+  void ScanKeyColumns(const std::vector<Value> &values,
+                      const std::vector<oid_t> &key_column_ids,
+                      const std::vector<ExpressionType> &expr_types,
+                      const ScanDirectionType &scan_direction,
+                      const std::vector<oid_t> &output_column_ids,
+                      std::vector<std::vector<Value>> &column_value_list,
+                      std::vector<ItemPointer> &result);
+
   std::string GetTypeName() const;
 
   // TODO: Implement this
@@ -125,6 +133,37 @@ class BWTreeIndex : public Index {
   size_t GetMemoryFootprint() { return 0; }
 
  protected:
+  // Key range of a scan derived from predicates on leading key columns
+  struct ScanRange {
+    // Number of leading key columns fixed by equality predicates
+    oid_t equal_column_count;
+
+    // Whether the first key column has a lower bound
+    bool low_bound_flag;
+
+    // Offsets of predicates that end the scan once a key violates them
+    std::vector<oid_t> high_offset_list;
+  };
+
+  void ConstructScanRange(storage::Tuple *low_key,
+                          const std::vector<Value> &values,
+                          const std::vector<oid_t> &key_column_ids,
+                          const std::vector<ExpressionType> &expr_types,
+                          ScanRange &range);
+
+  bool IsAboveScanRange(const AbstractTuple &key_tuple,
+                        const std::vector<Value> &values,
+                        const std::vector<oid_t> &key_column_ids,
+                        const std::vector<ExpressionType> &expr_types,
+                        const ScanRange &range);
+
+  template <typename ScanFunc>
+  void ScanInRange(const std::vector<Value> &values,
+                   const std::vector<oid_t> &key_column_ids,
+                   const std::vector<ExpressionType> &expr_types,
+                   const ScanDirectionType &scan_direction,
+                   ScanFunc &&scan_func);
+
   // equality checker and comparator
   KeyComparator comparator;
   KeyEqualityChecker equals;
@@ -54,7 +54,10 @@ BWTREE_INDEX_TYPE::InsertEntry(const storage::Tuple *key,
   KeyType index_key;
 
   index_key.SetFromKey(key);
-  ItemPointer *itempointer = new ItemPointer(location);
+
+  // The value is stored in a slot of the tree rather than on the heap, and
+  // its address remains valid until it is retired and GC reclaims it
+  ItemPointer *itempointer = container.NewStableValue(location);
   std::pair<KeyType, ValueType> entry(index_key,
                                       itempointer);
   if (itempointer_ptr != nullptr) {
@@ -62,10 +65,10 @@ BWTREE_INDEX_TYPE::InsertEntry(const storage::Tuple *key,
   }
   
   bool ret = container.Insert(index_key, itempointer);
-  // If insertion fails we just delete the new value and return false
+  // If insertion fails we just retire the new value and return false
   // to notify the caller
   if(ret == false) {
-    delete itempointer;
+    container.RetireStableValue(itempointer);
   }
 
   return ret;
@@ -101,20 +104,18 @@ BWTREE_INDEX_TYPE::DeleteEntry(const storage::Tuple *key,
   KeyType index_key;
   index_key.SetFromKey(key);
   
-  // Must allocate new memory here
-  ItemPointer *ip_p = new ItemPointer{location};
-  
   // In Delete() since we just use the value for comparison (i.e. read-only)
   // it is unnecessary for us to allocate memory
+  ItemPointer item{location};
+  ItemPointer *ip_p = &item;
+  
   bool ret = container.DeleteExchange(index_key, &ip_p);
   
   // IF delete succeeds then DeleteExchange() will exchange the deleted
-  // value into this variable
+  // value into this variable. Readers might still hold the pointer, so
+  // it is only reclaimed after they have left the epoch
   if(ret == true) {
-    //delete ip_p;
-  } else {
-    // This will delete the unused memory
-    delete ip_p;
+    container.RetireStableValue(ip_p);
   }
 
   return ret;
@@ -154,7 +155,7 @@ BWTREE_INDEX_TYPE::CondInsertEntry(const storage::Tuple *key,
   KeyType index_key;
   index_key.SetFromKey(key);
   
-  ItemPointer *item_p = new ItemPointer{location};
+  ItemPointer *item_p = container.NewStableValue(location);
   bool predicate_satisfied = false;
 
   // This function will complete them in one step
@@ -174,10 +175,10 @@ BWTREE_INDEX_TYPE::CondInsertEntry(const storage::Tuple *key,
   } else {
     assert(ret == false);
     
-    // Otherwise insertion fails. and we need to delete memory
+    // Otherwise insertion fails. and we need to retire the value
     *itemptr_ptr = nullptr;
     
-    delete item_p;
+    container.RetireStableValue(item_p);
   }
 
   return ret;
@@ -397,6 +398,96 @@ BWTREE_INDEX_TYPE::ScanKey(const storage::Tuple *key,
   return;
 }
 
+/*
+ * ScanKeyColumns() - Index-only scan that also returns values of the
+ *                    requested key columns
+ *
+ * Values are decoded from keys buffered by the iterator, so covered
+ * queries do not read the table. The i-th entry of column_value_list
+ * holds values of output_column_ids for the i-th ItemPointer of result
+ */
+BWTREE_TEMPLATE_ARGUMENTS
+void
+BWTREE_INDEX_TYPE::ScanKeyColumns(const std::vector<Value> &values,
+                                  const std::vector<oid_t> &key_column_ids,
+                                  const std::vector<ExpressionType> &expr_types,
+                                  const ScanDirectionType &scan_direction,
+                                  const std::vector<oid_t> &output_column_ids,
+                                  std::vector<std::vector<Value>> &column_value_list,
+                                  std::vector<ItemPointer> &result) {
+  KeyType index_key;
+
+  // This is filled with the lower bound of traversal into the index
+  // (see Scan())
+  std::unique_ptr<storage::Tuple> start_key;
+  start_key.reset(new storage::Tuple(metadata->GetKeySchema(), true));
+
+  bool all_constraints_are_equal = ConstructLowerBoundTuple(
+          start_key.get(), values, key_column_ids, expr_types);
+
+  index_key.SetFromKey(start_key.get());
+
+  // Decodes requested columns of a key that satisfies all predicates
+  auto decode_func = [&output_column_ids](const AbstractTuple &key_tuple) {
+    std::vector<Value> column_values{};
+    column_values.reserve(output_column_ids.size());
+
+    for(oid_t column_id : output_column_ids) {
+      column_values.push_back(key_tuple.GetValue(column_id));
+    }
+
+    return column_values;
+  };
+
+  // Optimize for point query. All values share the same key
+  if (all_constraints_are_equal == true) {
+    std::vector<ItemPointer *> item_p_list{};
+    container.GetValue(index_key, item_p_list);
+
+    if(item_p_list.size() == 0) {
+      return;
+    }
+
+    auto tuple = index_key.GetTupleForComparison(metadata->GetKeySchema());
+    std::vector<Value> column_values = decode_func(tuple);
+
+    for(auto item_p : item_p_list) {
+      column_value_list.push_back(column_values);
+      result.push_back(*item_p);
+    }
+
+    return;
+  }
+
+  switch (scan_direction) {
+    case SCAN_DIRECTION_TYPE_FORWARD:
+    case SCAN_DIRECTION_TYPE_BACKWARD: {
+      for (auto scan_itr = container.Begin(index_key);
+           scan_itr.IsEnd() == false;
+           scan_itr++) {
+        KeyType &scan_current_key = const_cast<KeyType &>(scan_itr->first);
+
+        auto tuple =
+            scan_current_key.GetTupleForComparison(metadata->GetKeySchema());
+
+        if (Compare(tuple, key_column_ids, expr_types, values) == true) {
+          column_value_list.push_back(decode_func(tuple));
+          result.push_back(*(scan_itr->second));
+        }
+      }
+
+      break;
+    }
+
+    case SCAN_DIRECTION_TYPE_INVALID:
+    default:
+      throw Exception("Invalid scan direction \n");
+      break;
+  }
+
+  return;
+}
+
 BWTREE_TEMPLATE_ARGUMENTS
 std::string
 BWTREE_INDEX_TYPE::GetTypeName() const {
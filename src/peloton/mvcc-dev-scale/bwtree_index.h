@@ -123,6 +123,14 @@ class BWTreeIndex : public Index {
   void ScanKey(const storage::Tuple *key,
                std::vector<ItemPointer *> &result);
 
+  void ScanKeyColumns(const std::vector<Value> &values,
+                      const std::vector<oid_t> &key_column_ids,
+                      const std::vector<ExpressionType> &expr_types,
+                      const ScanDirectionType &scan_direction,
+                      const std::vector<oid_t> &output_column_ids,
+                      std::vector<std::vector<Value>> &column_value_list,
+                      std::vector<ItemPointer> &result);
+
   std::string GetTypeName() const;
 
   // TODO: Implement this
@@ -0,0 +1,198 @@
+
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * class ReadCache - Fixed sized direct mapped cache of single valued keys
+ *
+ * Each key is hashed into one slot, which holds the key, its value, and
+ * the generation of the slot at the time the pair was read from the tree.
+ * Writers invalidate a key by incrementing the generation of its slot, so
+ * an entry is only valid while the generation recorded in it is still the
+ * current one. Since the generation is read by Lookup() before the reader
+ * traverses the tree, a value read before a concurrent write is never
+ * filled as valid after that write has invalidated the slot.
+ *
+ * Slot contents are protected by a sequence lock. Writers of the contents
+ * (i.e. fills) take the lock with a CAS and give up if it is taken, and
+ * readers retry as a miss if the sequence number changes during the read.
+ * Invalidation only touches the generation, so it never waits.
+ *
+ * NOTE: SLOT_NUM passed to the constructor must be a power of two. Types
+ * KeyType and ValueType are required to be trivially copyable, since
+ * readers copy them out of the slot while they could be written
+ */
+template <typename KeyType,
+          typename ValueType,
+          typename KeyHashFunc,
+          typename KeyEqualityChecker>
+class ReadCache {
+ private:
+  /*
+   * class Slot - One entry of the cache
+   */
+  class Slot {
+   public:
+    // Odd if a fill is in progress
+    std::atomic<uint64_t> sequence;
+
+    // Incremented on every write of keys hashed into this slot
+    std::atomic<uint64_t> generation;
+
+    // The generation when key and value are read from the tree. An empty
+    // slot has this set to a generation that never occurs
+    uint64_t fill_generation;
+
+    KeyType key;
+    ValueType value;
+  };
+
+  Slot *slot_list_p;
+  size_t slot_mask;
+
+  const KeyHashFunc key_hash_obj;
+  const KeyEqualityChecker key_eq_obj;
+
+  /*
+   * GetSlot() - Returns the slot a key is mapped to
+   *
+   * The hash is multiplied with a large odd number, since std::hash of
+   * integers is the identity function
+   */
+  inline Slot *GetSlot(const KeyType &key) const {
+    uint64_t hash = \
+      static_cast<uint64_t>(key_hash_obj(key)) * 0x9E3779B97F4A7C15UL;
+
+    return &slot_list_p[(hash >> 32) & slot_mask];
+  }
+
+ public:
+
+  /*
+   * Constructor - Allocates slot_num empty slots
+   */
+  ReadCache(size_t slot_num,
+            const KeyHashFunc &p_key_hash_obj = KeyHashFunc{},
+            const KeyEqualityChecker &p_key_eq_obj = KeyEqualityChecker{}) :
+    slot_list_p{new Slot[slot_num]},
+    slot_mask{slot_num - 1},
+    key_hash_obj{p_key_hash_obj},
+    key_eq_obj{p_key_eq_obj} {
+    assert(slot_num > 0UL && (slot_num & (slot_num - 1)) == 0UL);
+
+    for(size_t i = 0;i < slot_num;i++) {
+      slot_list_p[i].sequence.store(0UL, std::memory_order_relaxed);
+      slot_list_p[i].generation.store(0UL, std::memory_order_relaxed);
+      slot_list_p[i].fill_generation = ~0UL;
+    }
+
+    return;
+  }
+
+  ~ReadCache() {
+    delete[] slot_list_p;
+
+    return;
+  }
+
+  ReadCache(const ReadCache &) = delete;
+  ReadCache &operator=(const ReadCache &) = delete;
+
+  /*
+   * Lookup() - Copies the cached value of a key into value_p
+   *
+   * Returns true on hit. On miss the current generation of the slot is
+   * stored into generation_p, which must be passed to Fill() after the key
+   * is read from the tree
+   */
+  inline bool Lookup(const KeyType &key,
+                     ValueType *value_p,
+                     uint64_t *generation_p) const {
+    Slot *slot_p = GetSlot(key);
+
+    uint64_t generation = slot_p->generation.load();
+    *generation_p = generation;
+
+    uint64_t seq = slot_p->sequence.load(std::memory_order_acquire);
+    if((seq & 0x1UL) != 0UL) {
+      return false;
+    }
+
+    uint64_t fill_generation = slot_p->fill_generation;
+    KeyType cached_key = slot_p->key;
+    ValueType cached_value = slot_p->value;
+
+    // Contents must be read before the sequence number is validated
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if(slot_p->sequence.load(std::memory_order_relaxed) != seq || \
+       fill_generation != generation || \
+       key_eq_obj(cached_key, key) == false) {
+      return false;
+    }
+
+    *value_p = cached_value;
+
+    return true;
+  }
+
+  /*
+   * Fill() - Puts a key and its only value into the cache
+   *
+   * The generation must be the one returned by Lookup() before the value
+   * is read. The cache is not filled if the slot is being filled by another
+   * thread, and the entry is invalid right away if the key has been written
+   * since then
+   */
+  inline void Fill(const KeyType &key,
+                   const ValueType &value,
+                   uint64_t generation) {
+    Slot *slot_p = GetSlot(key);
+
+    uint64_t seq = slot_p->sequence.load(std::memory_order_relaxed);
+    if((seq & 0x1UL) != 0UL || \
+       slot_p->sequence.compare_exchange_strong(seq, seq + 1) == false) {
+      return;
+    }
+
+    // Contents must not be written before the sequence number turns odd
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot_p->fill_generation = generation;
+    slot_p->key = key;
+    slot_p->value = value;
+
+    slot_p->sequence.store(seq + 2, std::memory_order_release);
+
+    return;
+  }
+
+  /*
+   * Invalidate() - Invalidates the cached value of a key, if any
+   *
+   * This must be called after the modification of the key is visible in
+   * the tree. Other keys mapped to the same slot are also invalidated
+   */
+  inline void Invalidate(const KeyType &key) {
+    GetSlot(key)->generation.fetch_add(1UL);
+
+    return;
+  }
+
+  /*
+   * InvalidateAll() - Invalidates all cached values
+   *
+   * This is used after modifying a range of keys, which could be mapped
+   * to any slot
+   */
+  void InvalidateAll() {
+    for(size_t i = 0;i <= slot_mask;i++) {
+      slot_list_p[i].generation.fetch_add(1UL);
+    }
+
+    return;
+  }
+};
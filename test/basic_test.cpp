@@ -86,6 +86,90 @@ void DeleteTest2(uint64_t thread_id, TreeType *t) {
   return;
 }
 
+/*
+ * UpdateTest1() - Replaces one value of each key, using the same pattern
+ *                 as InsertTest1()
+ *
+ * This should be called after InsertTest1() or InsertTest2()
+ */
+void UpdateTest1(uint64_t thread_id, TreeType *t) {
+  for(int i = thread_id * basic_test_key_num;
+      i < (int)(thread_id + 1) * basic_test_key_num;
+      i++) {
+    bool ret = t->Update(i, i + 1, i + 5);
+    assert(ret == true);
+
+    // The old value no longer exists
+    ret = t->Update(i, i + 1, i + 6);
+    assert(ret == false);
+
+    // The new value already exists
+    ret = t->Update(i, i + 2, i + 3);
+    assert(ret == false);
+
+    ret = t->Update(i, i + 2, i + 2);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  return;
+}
+
+/*
+ * UpsertTest2() - Upserts on keys after the key space of other tests, using
+ *                 the same pattern as InsertTest2()
+ */
+void UpsertTest2(uint64_t thread_id, TreeType *t) {
+  int key_num = basic_test_key_num * basic_test_thread_num;
+
+  for(int i = 0;i < basic_test_key_num;i++) {
+    int key = key_num + basic_test_thread_num * i + thread_id;
+
+    bool ret = t->Upsert(key, key);
+    assert(ret == true);
+
+    ret = t->Upsert(key, key + 1);
+    assert(ret == false);
+
+    ret = t->Upsert(key, key + 1);
+    assert(ret == false);
+    (void)ret;
+  }
+
+  return;
+}
+
+/*
+ * UpdateGetValueTest() - Verifies all values after UpdateTest1()
+ */
+void UpdateGetValueTest(TreeType *t) {
+  for(int i = 0;i < basic_test_key_num * basic_test_thread_num;i++) {
+    auto value_set = t->GetValue(i);
+
+    assert(value_set.size() == 4);
+    assert(value_set.find(i + 1) == value_set.end());
+    assert(value_set.find(i + 5) != value_set.end());
+  }
+
+  return;
+}
+
+/*
+ * UpsertGetValueTest() - Verifies all values after UpsertTest2()
+ */
+void UpsertGetValueTest(TreeType *t) {
+  int key_num = basic_test_key_num * basic_test_thread_num;
+
+  for(int i = key_num;i < key_num * 2;i++) {
+    auto value_set = t->GetValue(i);
+
+    assert(value_set.size() == 1);
+    assert(*value_set.begin() == i + 1);
+  }
+
+  return;
+}
+
 /*
  * DeleteGetValueTest() - Verifies all values have been deleted
  *
@@ -113,3 +197,35 @@ void InsertGetValueTest(TreeType *t) {
 
   return;
 }
+
+/*
+ * InsertGetValueBatchTest() - Verifies all values using batched lookup
+ *
+ * Keys are probed in reverse order to also test sorting inside the tree
+ */
+void InsertGetValueBatchTest(TreeType *t) {
+  const int key_num = basic_test_key_num * basic_test_thread_num;
+  const int batch_size = 1024;
+
+  std::vector<long int> key_list{};
+  std::vector<std::vector<long int>> value_list{};
+
+  for(int i = key_num - 1;i >= 0;i -= batch_size) {
+    key_list.clear();
+    value_list.clear();
+
+    for(int j = i;j > i - batch_size && j >= 0;j--) {
+      key_list.push_back(j);
+    }
+
+    value_list.resize(key_list.size());
+    t->GetValueBatch(key_list.data(), key_list.size(), value_list.data());
+
+    for(size_t j = 0;j < key_list.size();j++) {
+      assert(value_list[j].size() == 4);
+      (void)j;
+    }
+  }
+
+  return;
+}
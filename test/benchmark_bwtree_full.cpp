@@ -79,10 +79,14 @@ void BenchmarkBwTreeRandInsert(int key_num, int thread_num) {
 
 /*
  * BenchmarkBwTreeSeqInsert() - As name suggests
+ *
+ * If leaf_finger_flag is true then inserts start from leaf fingers, and the
+ * ratio of inserts not traversing from the root is printed
  */
 void BenchmarkBwTreeSeqInsert(TreeType *t, 
                               int key_num, 
-                              int thread_num) {
+                              int thread_num,
+                              bool leaf_finger_flag) {
   const int num_thread = thread_num;
 
   // This is used to record time taken for each individual thread
@@ -91,8 +95,17 @@ void BenchmarkBwTreeSeqInsert(TreeType *t,
     thread_time[i] = 0.0;
   }
 
+  t->SetLeafFingerMode(leaf_finger_flag);
+
+  // Statistics are reset when threads are launched and joined, so they
+  // are taken by the last thread to finish
+  std::atomic<int> finished_thread_num{0};
+  TreeType::Statistics stat{};
+
   auto func = [key_num, 
                &thread_time, 
+               &finished_thread_num,
+               &stat,
                num_thread](uint64_t thread_id, TreeType *t) {
     long int start_key = key_num / num_thread * (long)thread_id;
     long int end_key = start_key + key_num / num_thread;
@@ -110,6 +123,10 @@ void BenchmarkBwTreeSeqInsert(TreeType *t,
 
     thread_time[thread_id] = duration;
 
+    if(finished_thread_num.fetch_add(1) == num_thread - 1) {
+      stat = t->GetStatistics();
+    }
+
     std::cout << "[Thread " << thread_id << " Done] @ " \
               << (key_num / num_thread) / (1024.0 * 1024.0) / duration \
               << " million insert/sec" << "\n";
@@ -131,6 +148,16 @@ void BenchmarkBwTreeSeqInsert(TreeType *t,
   std::cout << num_thread << " Threads BwTree: overall "
             << (key_num / (1024.0 * 1024.0) * num_thread) / elapsed_seconds
             << " million insert/sec" << "\n";
+
+  if(leaf_finger_flag == true) {
+    uint64_t hit_count = stat.leaf_finger_hit_count;
+    uint64_t miss_count = stat.leaf_finger_miss_count;
+
+    std::cout << "Leaf finger hit rate = "
+              << 100.0 * hit_count / (hit_count + miss_count + 1) << "%\n";
+
+    t->SetLeafFingerMode(false);
+  }
             
   return;
 }
@@ -267,13 +294,165 @@ void BenchmarkBwTreeRandRead(TreeType *t,
   return;
 }
 
+/*
+ * BenchmarkBwTreeRandReadBuffer() - Random read into a stack buffer
+ *
+ * This is the same workload as BenchmarkBwTreeRandRead(), except that
+ * values are copied into a fixed sized buffer, so the lookup does not
+ * allocate any memory
+ */
+void BenchmarkBwTreeRandReadBuffer(TreeType *t, 
+                                   int key_num,
+                                   int thread_num) {
+  const int num_thread = thread_num;
+  int iter = 1;
+  
+  // This is used to record time taken for each individual thread
+  double thread_time[num_thread];
+  for(int i = 0;i < num_thread;i++) {
+    thread_time[i] = 0.0;
+  }
+  
+  auto func2 = [key_num, 
+                iter, 
+                &thread_time,
+                num_thread](uint64_t thread_id, TreeType *t) {
+    long buffer[4];
+    
+    // This is the random number generator we use
+    SimpleInt64Random<0, 30 * 1024 * 1024> h{};
+
+    Timer timer{true};
+    CacheMeter cache{true};
+
+    for(int j = 0;j < iter;j++) {
+      for(int i = 0;i < key_num;i++) {
+        long int key = (long int)h((uint64_t)i, thread_id);
+
+        t->GetValue(key, buffer, 4);
+      }
+    }
+
+    cache.Stop();
+    double duration = timer.Stop();
+    
+    thread_time[thread_id] = duration;
+
+    std::cout << "[Thread " << thread_id << " Done] @ " \
+              << (iter * key_num / (1024.0 * 1024.0)) / duration \
+              << " million read (random, buffer)/sec" << "\n";
+    
+    cache.PrintL3CacheUtilization();
+    cache.PrintL1CacheUtilization();
+    
+    return;
+  };
+
+  LaunchParallelTestID(t, num_thread, func2, t);
+
+  double elapsed_seconds = 0.0;
+  for(int i = 0;i < num_thread;i++) {
+    elapsed_seconds += thread_time[i];
+  }
+
+  std::cout << num_thread << " Threads BwTree: overall "
+            << (iter * key_num / (1024.0 * 1024.0) * num_thread * num_thread) / elapsed_seconds
+            << " million read (random, buffer)/sec" << "\n";
+
+  return;
+}
+
+/*
+ * BenchmarkBwTreeRandReadBatch() - Random read using GetValueBatch()
+ *
+ * Keys are the same as in BenchmarkBwTreeRandRead(). If prefetch_flag is
+ * true then traversals inside a batch are interleaved with prefetching
+ */
+void BenchmarkBwTreeRandReadBatch(TreeType *t, 
+                                  int key_num,
+                                  int thread_num,
+                                  bool prefetch_flag) {
+  const int num_thread = thread_num;
+  const int batch_size = 64;
+  int iter = 1;
+  
+  // This is used to record time taken for each individual thread
+  double thread_time[num_thread];
+  for(int i = 0;i < num_thread;i++) {
+    thread_time[i] = 0.0;
+  }
+
+  t->SetPrefetchMode(prefetch_flag);
+  
+  auto func2 = [key_num, 
+                iter, 
+                &thread_time,
+                num_thread,
+                batch_size](uint64_t thread_id, TreeType *t) {
+    long int key_list[batch_size];
+    std::vector<long> value_list[batch_size];
+    
+    // This is the random number generator we use
+    SimpleInt64Random<0, 30 * 1024 * 1024> h{};
+
+    Timer timer{true};
+    CacheMeter cache{true};
+
+    for(int j = 0;j < iter;j++) {
+      for(int i = 0;i < key_num;i += batch_size) {
+        for(int k = 0;k < batch_size;k++) {
+          key_list[k] = (long int)h((uint64_t)(i + k), thread_id);
+          value_list[k].clear();
+        }
+
+        t->GetValueBatch(key_list, batch_size, value_list);
+      }
+    }
+
+    cache.Stop();
+    double duration = timer.Stop();
+    
+    thread_time[thread_id] = duration;
+
+    std::cout << "[Thread " << thread_id << " Done] @ " \
+              << (iter * key_num / (1024.0 * 1024.0)) / duration \
+              << " million read (random, batch)/sec" << "\n";
+    
+    cache.PrintL3CacheUtilization();
+    cache.PrintL1CacheUtilization();
+    
+    return;
+  };
+
+  LaunchParallelTestID(t, num_thread, func2, t);
+
+  t->SetPrefetchMode(false);
+
+  double elapsed_seconds = 0.0;
+  for(int i = 0;i < num_thread;i++) {
+    elapsed_seconds += thread_time[i];
+  }
+
+  std::cout << num_thread << " Threads BwTree: overall "
+            << (iter * key_num / (1024.0 * 1024.0) * num_thread * num_thread) / elapsed_seconds
+            << " million read (random, batch"
+            << (prefetch_flag ? ", prefetch" : "") << ")/sec" << "\n";
+
+  return;
+}
+
 
 /*
  * BenchmarkBwTreeZipfRead() - As name suggests
+ *
+ * If read_cache_size is not 0 then a read cache of that many slots is put
+ * in front of the tree during the benchmark, and its hit rate is printed.
+ * The overall throughput is returned to compute the speedup
  */
-void BenchmarkBwTreeZipfRead(TreeType *t, 
-                             int key_num,
-                             int thread_num) {
+double BenchmarkBwTreeZipfRead(TreeType *t, 
+                               int key_num,
+                               int thread_num,
+                               size_t read_cache_size) {
   const int num_thread = thread_num;
   int iter = 1;
   
@@ -282,6 +461,8 @@ void BenchmarkBwTreeZipfRead(TreeType *t,
   for(int i = 0;i < num_thread;i++) {
     thread_time[i] = 0.0;
   }
+
+  t->SetReadCacheSize(read_cache_size);
   
   // Generate zipfian distribution into this list
   std::vector<long> zipfian_key_list{};
@@ -295,10 +476,17 @@ void BenchmarkBwTreeZipfRead(TreeType *t,
     zipfian_key_list.push_back(zipf.Get()); 
   }
   
+  // Statistics are reset when threads are launched and joined, so they
+  // are taken by the last thread to finish
+  std::atomic<int> finished_thread_num{0};
+  TreeType::Statistics stat{};
+
   auto func2 = [key_num, 
                 iter, 
                 &thread_time,
                 &zipfian_key_list,
+                &finished_thread_num,
+                &stat,
                 num_thread](uint64_t thread_id, TreeType *t) {
     // This is the start and end index we read into the zipfian array
     long int start_index = key_num / num_thread * (long)thread_id;
@@ -326,6 +514,10 @@ void BenchmarkBwTreeZipfRead(TreeType *t,
     
     thread_time[thread_id] = duration;
 
+    if(finished_thread_num.fetch_add(1) == num_thread - 1) {
+      stat = t->GetStatistics();
+    }
+
     std::cout << "[Thread " << thread_id << " Done] @ " \
               << (iter * (end_index - start_index) / (1024.0 * 1024.0)) / duration \
               << " million read (zipfian)/sec" << "\n";
@@ -343,9 +535,67 @@ void BenchmarkBwTreeZipfRead(TreeType *t,
     elapsed_seconds += thread_time[i];
   }
 
+  double throughput = \
+    (iter * key_num / (1024.0 * 1024.0)) / (elapsed_seconds / num_thread);
+
   std::cout << num_thread << " Threads BwTree: overall "
-            << (iter * key_num / (1024.0 * 1024.0)) / (elapsed_seconds / num_thread)
+            << throughput
             << " million read (zipfian)/sec" << "\n";
 
+  if(read_cache_size > 0UL) {
+    uint64_t hit_count = stat.read_cache_hit_count;
+    uint64_t miss_count = stat.read_cache_miss_count;
+
+    std::cout << "Read cache (" << read_cache_size << " slots) hit rate = "
+              << 100.0 * hit_count / (hit_count + miss_count + 1) << "%\n";
+
+    t->SetReadCacheSize(0UL);
+  }
+
+  return throughput;
+}
+
+/*
+ * BenchmarkBwTreeBulkLoad() - Compares bulk loading against sequential insert
+ *
+ * Both are done using a single thread on an empty tree with the same key
+ * set as BenchmarkBwTreeSeqInsert() in order to be comparable
+ */
+void BenchmarkBwTreeBulkLoad(int key_num) {
+  std::vector<std::pair<long int, long int>> item_list{};
+  item_list.reserve(key_num);
+  
+  for(int i = 0;i < key_num;i++) {
+    item_list.push_back(std::make_pair(i, i));
+  }
+  
+  TreeType *t = GetEmptyTree(true);
+  
+  Timer timer{true};
+  
+  t->BulkLoad(item_list.begin(), item_list.end());
+  
+  double bulk_load_duration = timer.Stop();
+  
+  delete t;
+  
+  t = GetEmptyTree(true);
+  
+  timer.Start();
+  
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+  
+  double insert_duration = timer.Stop();
+  
+  delete t;
+  
+  std::cout << "BwTree: bulk load "
+            << key_num / (1024.0 * 1024.0) / bulk_load_duration
+            << " million keys/sec; sequential insert "
+            << key_num / (1024.0 * 1024.0) / insert_duration
+            << " million keys/sec" << "\n";
+  
   return;
 }
@@ -0,0 +1,586 @@
+
+/*
+ * benchmark_scalability.cpp - Sweeps the number of threads over several
+ *                             workloads and reports throughput together
+ *                             with internal counters of the tree as CSV
+ *
+ * For every index, workload and thread count a fresh index is loaded and
+ * then each thread issues SCALABILITY_OP_NUM operations. Counters of BwTree
+ * are the difference of two GetStatistics() snapshots around the run, so
+ * they do not include the load phase. Workloads are:
+ *
+ *   insert   Inserts random keys into an empty index
+ *   read     Reads random keys of the loaded index
+ *   mixed    50% reads, 25% inserts and 25% deletes over twice the loaded
+ *            key range, which keeps splitting and merging nodes
+ *   hot      All threads insert and delete a few keys that fit in a
+ *            single leaf, which maximizes CAS contention
+ *
+ * The benchmark is configured by the following environmental variables:
+ *
+ *   THREAD_NUM              Maximum number of threads (see GetThreadNum())
+ *   SCALABILITY_STEP        Thread count increment; 0 (default) doubles the
+ *                           count on every step
+ *   SCALABILITY_WORKLOAD    Comma separated workloads (default all)
+ *   SCALABILITY_INDEX       Comma separated list of "bwtree" and "btree"
+ *                           (default both)
+ *   SCALABILITY_KEY_NUM     Number of keys loaded (default 1M)
+ *   SCALABILITY_OP_NUM      Number of operations per thread (default 1M)
+ *   SCALABILITY_AFFINITY    "none", "compact" (default) fills cores of one
+ *                           NUMA node before the next one, and "scatter"
+ *                           assigns threads to nodes round-robin
+ *   SCALABILITY_NUMA_NODE   If set, only cores of this NUMA node are used
+ *
+ * Since worker threads also load the index, memory is placed on the NUMA
+ * nodes of the threads using it by first touch. The baseline is
+ * stx::btree_multimap protected by the reader-writer spinlock under
+ * ./benchmark/spinlock, for which tree counters are reported as zero
+ */
+
+#include "test_suite.h"
+#include "../benchmark/spinlock/spinlock.h"
+
+/*
+ * class ScalabilityConfig - Parameters of a sweep read from environmental
+ *                           variables
+ */
+class ScalabilityConfig {
+ public:
+  uint64_t max_thread_num;
+  uint64_t thread_step;
+  uint64_t key_num;
+  uint64_t op_num;
+
+  std::string affinity;
+
+  // CPUs in the order threads are pinned to them; empty if threads are
+  // not pinned
+  std::vector<int> cpu_list;
+};
+
+/*
+ * ParseCPUList() - Parses a CPU list in the format of sysfs, e.g. "0-3,8"
+ */
+static std::vector<int> ParseCPUList(const std::string &cpu_list) {
+  std::vector<int> ret{};
+
+  size_t start = 0UL;
+  while(start < cpu_list.size()) {
+    size_t end = cpu_list.find(',', start);
+    if(end == std::string::npos) {
+      end = cpu_list.size();
+    }
+
+    std::string range = cpu_list.substr(start, end - start);
+    size_t dash = range.find('-');
+
+    try {
+      int low = std::stoi(range.substr(0, dash));
+      int high = (dash == std::string::npos) ? \
+                   low : std::stoi(range.substr(dash + 1));
+
+      for(int cpu = low;cpu <= high;cpu++) {
+        ret.push_back(cpu);
+      }
+    } catch(...) {
+      // Ignore trailing newline and malformed ranges
+    }
+
+    start = end + 1;
+  }
+
+  return ret;
+}
+
+/*
+ * GetNUMANodeCPUList() - Returns CPUs of each NUMA node
+ *
+ * If the topology could not be read from sysfs then all CPUs are assumed
+ * to be on node 0
+ */
+static std::vector<std::vector<int>> GetNUMANodeCPUList() {
+  std::vector<std::vector<int>> node_list{};
+
+  for(int node = 0;;node++) {
+    std::ifstream ifs{"/sys/devices/system/node/node" + \
+                      std::to_string(node) + "/cpulist"};
+    if(ifs.good() == false) {
+      break;
+    }
+
+    std::string cpu_list{};
+    std::getline(ifs, cpu_list);
+
+    node_list.push_back(ParseCPUList(cpu_list));
+  }
+
+  if(node_list.empty() == true) {
+    std::vector<int> cpu_list{};
+    for(unsigned int cpu = 0;cpu < std::thread::hardware_concurrency();cpu++) {
+      cpu_list.push_back(static_cast<int>(cpu));
+    }
+
+    node_list.push_back(cpu_list);
+  }
+
+  return node_list;
+}
+
+/*
+ * GetPinnedCPUList() - Returns the CPU of each thread ID given the
+ *                      affinity policy
+ */
+static std::vector<int> GetPinnedCPUList(const std::string &affinity,
+                                         const std::string &numa_node) {
+  std::vector<std::vector<int>> node_list = GetNUMANodeCPUList();
+
+  if(numa_node.empty() == false) {
+    size_t node = std::stoul(numa_node);
+    if(node >= node_list.size()) {
+      throw "SCALABILITY_NUMA_NODE is not a valid NUMA node!";
+    }
+
+    node_list = {node_list[node]};
+  }
+
+  std::vector<int> cpu_list{};
+
+  if(affinity == "none") {
+    return cpu_list;
+  } else if(affinity == "compact") {
+    for(const std::vector<int> &node_cpu_list : node_list) {
+      cpu_list.insert(cpu_list.end(),
+                      node_cpu_list.begin(),
+                      node_cpu_list.end());
+    }
+  } else if(affinity == "scatter") {
+    for(size_t i = 0;;i++) {
+      bool found_flag = false;
+
+      for(const std::vector<int> &node_cpu_list : node_list) {
+        if(i < node_cpu_list.size()) {
+          cpu_list.push_back(node_cpu_list[i]);
+          found_flag = true;
+        }
+      }
+
+      if(found_flag == false) {
+        break;
+      }
+    }
+  } else {
+    throw "SCALABILITY_AFFINITY must be none, compact or scatter!";
+  }
+
+  return cpu_list;
+}
+
+/*
+ * PinThread() - Pins the current thread to the CPU assigned to its ID
+ *
+ * Threads are wrapped around if there are more threads than CPUs
+ */
+static void PinThread(const ScalabilityConfig &config, uint64_t thread_id) {
+  if(config.cpu_list.empty() == true) {
+    return;
+  }
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(config.cpu_list[thread_id % config.cpu_list.size()], &cpu_set);
+
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+
+  return;
+}
+
+// Keys of the hot workload; they fit in one leaf of the default size
+static constexpr long int SCALABILITY_HOT_KEY_NUM = 16L;
+
+/*
+ * class ScalabilityBwTree - Runs workloads of the sweep on BwTree
+ */
+class ScalabilityBwTree {
+ public:
+  TreeType *tree_p;
+  TreeType::Statistics start_stat;
+
+  static const char *GetName() {
+    return "bwtree";
+  }
+
+  ScalabilityBwTree(uint64_t thread_num) :
+    tree_p{GetEmptyTree(true)},
+    start_stat{} {
+    tree_p->UpdateThreadLocal(thread_num);
+
+    return;
+  }
+
+  ~ScalabilityBwTree() {
+    DestroyTree(tree_p, true);
+  }
+
+  void JoinThread(uint64_t thread_id) {
+    tree_p->AssignGCID(static_cast<int>(thread_id));
+
+    return;
+  }
+
+  void LeaveThread(uint64_t thread_id) {
+    tree_p->UnregisterThread(static_cast<int>(thread_id));
+
+    return;
+  }
+
+  inline void Insert(long int key, long int value) {
+    tree_p->Insert(key, value);
+
+    return;
+  }
+
+  inline void Delete(long int key, long int value) {
+    tree_p->Delete(key, value);
+
+    return;
+  }
+
+  inline bool Read(long int key) {
+    long int value;
+
+    return tree_p->GetValue(key, &value, 1UL) != 0UL;
+  }
+
+  /*
+   * StartRun() - Takes the statistics snapshot at the start of a run
+   */
+  void StartRun() {
+    start_stat = tree_p->GetStatistics();
+
+    return;
+  }
+
+  /*
+   * PrintCounter() - Prints CSV columns of counters since StartRun()
+   */
+  void PrintCounter(uint64_t op_num) {
+    TreeType::Statistics stat = tree_p->GetStatistics();
+
+    uint64_t insert_abort = stat.insert_abort_count - \
+                            start_stat.insert_abort_count;
+    uint64_t delete_abort = stat.delete_abort_count - \
+                            start_stat.delete_abort_count;
+    uint64_t update_abort = stat.update_abort_count - \
+                            start_stat.update_abort_count;
+    uint64_t traversal_abort = stat.traversal_abort_count - \
+                               start_stat.traversal_abort_count;
+
+    printf("%lu,%lu,%lu,%lu,%f,%lu,%lu,%lu,%lu,%lu,%f",
+           insert_abort,
+           delete_abort,
+           update_abort,
+           traversal_abort,
+           (insert_abort + delete_abort + update_abort + traversal_abort) * \
+             1000.0 / op_num,
+           stat.smo_help_count - start_stat.smo_help_count,
+           stat.consolidation_count - start_stat.consolidation_count,
+           stat.split_count - start_stat.split_count,
+           stat.merge_count - start_stat.merge_count,
+           stat.gc_count - start_stat.gc_count,
+           (stat.gc_time - start_stat.gc_time) / 1000000.0);
+
+    return;
+  }
+};
+
+/*
+ * class ScalabilityBTree - Runs workloads of the sweep on
+ *                          stx::btree_multimap behind a spinlock
+ */
+class ScalabilityBTree {
+ public:
+  BTreeType *tree_p;
+  spinlock_t lock;
+
+  static const char *GetName() {
+    return "btree";
+  }
+
+  ScalabilityBTree(uint64_t) :
+    tree_p{GetEmptyBTree()} {
+    rwlock_init(lock);
+
+    return;
+  }
+
+  ~ScalabilityBTree() {
+    delete tree_p;
+  }
+
+  void JoinThread(uint64_t) {}
+  void LeaveThread(uint64_t) {}
+
+  inline void Insert(long int key, long int value) {
+    write_lock(lock);
+    tree_p->insert(key, value);
+    write_unlock(lock);
+
+    return;
+  }
+
+  inline void Delete(long int key, long int) {
+    write_lock(lock);
+    tree_p->erase_one(key);
+    write_unlock(lock);
+
+    return;
+  }
+
+  inline bool Read(long int key) {
+    read_lock(lock);
+    bool ret = (tree_p->find(key) != tree_p->end());
+    read_unlock(lock);
+
+    return ret;
+  }
+
+  void StartRun() {}
+
+  void PrintCounter(uint64_t) {
+    printf("0,0,0,0,0,0,0,0,0,0,0");
+
+    return;
+  }
+};
+
+/*
+ * RunScalabilityStep() - Loads a fresh index and runs a workload with the
+ *                        given number of threads
+ */
+template <typename ScalabilityIndex>
+void RunScalabilityStep(const ScalabilityConfig &config,
+                        const std::string &workload,
+                        uint64_t thread_num) {
+  ScalabilityIndex *index_p = new ScalabilityIndex{thread_num};
+
+  uint64_t key_num = config.key_num;
+  uint64_t op_num = config.op_num;
+
+  // The insert workload starts with an empty index
+  if(workload != "insert") {
+    auto load_func = [&config, key_num, thread_num](uint64_t thread_id,
+                                                    ScalabilityIndex *index_p) {
+      PinThread(config, thread_id);
+      index_p->JoinThread(thread_id);
+
+      uint64_t start_key = key_num / thread_num * thread_id;
+      uint64_t end_key = (thread_id == thread_num - 1) ? \
+                           key_num : start_key + key_num / thread_num;
+
+      for(uint64_t i = start_key;i < end_key;i++) {
+        index_p->Insert(static_cast<long int>(i), static_cast<long int>(i));
+      }
+
+      index_p->LeaveThread(thread_id);
+
+      return;
+    };
+
+    LaunchParallelTestID(nullptr, thread_num, load_func, index_p);
+  }
+
+  std::vector<double> thread_time(thread_num, 0.0);
+
+  auto run_func = [&config,
+                   &workload,
+                   key_num,
+                   op_num,
+                   &thread_time](uint64_t thread_id,
+                                 ScalabilityIndex *index_p) {
+    PinThread(config, thread_id);
+    index_p->JoinThread(thread_id);
+
+    SimpleInt64Random<0, 0xFFFFFFFFFFFFFFFFUL> random{};
+    long int value = static_cast<long int>(thread_id);
+
+    Timer timer{true};
+
+    if(workload == "insert") {
+      for(uint64_t i = 0;i < op_num;i++) {
+        index_p->Insert(static_cast<long int>(random(i, thread_id) >> 1),
+                        value);
+      }
+    } else if(workload == "read") {
+      for(uint64_t i = 0;i < op_num;i++) {
+        index_p->Read(static_cast<long int>(random(i, thread_id) % key_num));
+      }
+    } else if(workload == "mixed") {
+      for(uint64_t i = 0;i < op_num;i++) {
+        uint64_t r = random(i, thread_id);
+        long int key = static_cast<long int>((r >> 2) % (key_num * 2));
+
+        switch(r & 0x3) {
+          case 0:
+            index_p->Insert(key, key);
+            break;
+          case 1:
+            index_p->Delete(key, key);
+            break;
+          default:
+            index_p->Read(key);
+            break;
+        }
+      }
+    } else {
+      // Keys are in the middle of the loaded key range, such that they
+      // are on the same leaf
+      long int hot_key_start = static_cast<long int>(key_num / 2);
+
+      for(uint64_t i = 0;i < op_num;i += 2) {
+        long int key = \
+          hot_key_start + \
+          static_cast<long int>(random(i, thread_id) % SCALABILITY_HOT_KEY_NUM);
+
+        index_p->Insert(key, value);
+        index_p->Delete(key, value);
+      }
+    }
+
+    thread_time[thread_id] = timer.Stop();
+
+    index_p->LeaveThread(thread_id);
+
+    return;
+  };
+
+  index_p->StartRun();
+  LaunchParallelTestID(nullptr, thread_num, run_func, index_p);
+
+  double max_time = 0.0;
+  for(double duration : thread_time) {
+    max_time = std::max(max_time, duration);
+  }
+
+  printf("%s,%s,%lu,%s,%f,",
+         ScalabilityIndex::GetName(),
+         workload.c_str(),
+         thread_num,
+         config.affinity.c_str(),
+         op_num * thread_num / 1000000.0 / max_time);
+  index_p->PrintCounter(op_num * thread_num);
+  printf("\n");
+
+  fflush(stdout);
+
+  delete index_p;
+
+  return;
+}
+
+/*
+ * SplitCommaList() - Splits a comma separated list
+ */
+static std::vector<std::string> SplitCommaList(const std::string &list) {
+  std::vector<std::string> ret{};
+
+  size_t start = 0UL;
+  while(start < list.size()) {
+    size_t end = list.find(',', start);
+    if(end == std::string::npos) {
+      end = list.size();
+    }
+
+    ret.push_back(list.substr(start, end - start));
+    start = end + 1;
+  }
+
+  return ret;
+}
+
+/*
+ * BenchmarkScalability() - Sweeps thread counts from 1 to max_thread_num
+ *                          on indexes and workloads given by environmental
+ *                          variables
+ */
+void BenchmarkScalability(int max_thread_num) {
+  // Keep debug messages of trees from mixing with CSV rows
+  print_flag = false;
+
+  ScalabilityConfig config{};
+  config.max_thread_num = static_cast<uint64_t>(max_thread_num);
+  config.thread_step = 0UL;
+  config.key_num = 1024UL * 1024UL;
+  config.op_num = 1024UL * 1024UL;
+
+  if(Envp::GetValueAsUL("SCALABILITY_STEP", &config.thread_step) == false) {
+    throw "SCALABILITY_STEP must be an unsigned integer!";
+  }
+
+  if(Envp::GetValueAsUL("SCALABILITY_KEY_NUM", &config.key_num) == false || \
+     config.key_num < static_cast<uint64_t>(SCALABILITY_HOT_KEY_NUM)) {
+    throw "SCALABILITY_KEY_NUM must be an integer no less than 16!";
+  }
+
+  if(Envp::GetValueAsUL("SCALABILITY_OP_NUM", &config.op_num) == false) {
+    throw "SCALABILITY_OP_NUM must be an unsigned integer!";
+  }
+
+  config.affinity = Envp::Get("SCALABILITY_AFFINITY");
+  if(config.affinity.empty() == true) {
+    config.affinity = "compact";
+  }
+
+  config.cpu_list = GetPinnedCPUList(config.affinity,
+                                     Envp::Get("SCALABILITY_NUMA_NODE"));
+
+  std::string workload_list = Envp::Get("SCALABILITY_WORKLOAD");
+  if(workload_list.empty() == true) {
+    workload_list = "insert,read,mixed,hot";
+  }
+
+  std::string index_list = Envp::Get("SCALABILITY_INDEX");
+  if(index_list.empty() == true) {
+    index_list = "bwtree,btree";
+  }
+
+  printf("index,workload,thread_num,affinity,mops,"
+         "insert_abort,delete_abort,update_abort,traversal_abort,"
+         "abort_per_kop,smo_help,consolidation,split,merge,"
+         "gc_count,gc_time_ms\n");
+
+  for(const std::string &index : SplitCommaList(index_list)) {
+    for(const std::string &workload : SplitCommaList(workload_list)) {
+      if(workload != "insert" && workload != "read" && \
+         workload != "mixed" && workload != "hot") {
+        printf("Unknown workload: %s\n", workload.c_str());
+
+        continue;
+      }
+
+      uint64_t thread_num = 1UL;
+      while(thread_num <= config.max_thread_num) {
+        if(index == "bwtree") {
+          RunScalabilityStep<ScalabilityBwTree>(config, workload, thread_num);
+        } else if(index == "btree") {
+          RunScalabilityStep<ScalabilityBTree>(config, workload, thread_num);
+        } else {
+          printf("Unknown index: %s\n", index.c_str());
+
+          break;
+        }
+
+        // Always finish with the maximum thread count
+        uint64_t next_thread_num = (config.thread_step == 0UL) ? \
+          thread_num * 2 : thread_num + config.thread_step;
+        if(thread_num < config.max_thread_num && \
+           next_thread_num > config.max_thread_num) {
+          next_thread_num = config.max_thread_num;
+        }
+
+        thread_num = next_thread_num;
+      }
+    }
+  }
+
+  return;
+}
@@ -0,0 +1,917 @@
+
+/*
+ * benchmark_ycsb.cpp - YCSB style mixed workload benchmark with latency
+ *                      histograms
+ *
+ * Each index is loaded with YCSB_KEY_NUM records, and then threads issue a
+ * mix of read, update, insert, scan and read-modify-write operations given
+ * by YCSB workloads A - F. The latency of every operation is recorded into a
+ * per-thread histogram, and histograms are merged after the run to report
+ * p50/p99/p99.9 latency of each operation type.
+ *
+ * The benchmark is configured by the following environmental variables:
+ *
+ *   THREAD_NUM          Number of worker threads (see GetThreadNum())
+ *   YCSB_WORKLOAD       Workloads to run, e.g. "AC" (default "ABCDEF")
+ *   YCSB_INDEX          Comma separated list of indexes among "bwtree",
+ *                       "bwtree-fixed16", "btree", "art" and "cuckoo"
+ *                       (default "bwtree")
+ *   YCSB_KEY_NUM        Number of records loaded (default 10M)
+ *   YCSB_OP_NUM         Number of operations of all threads (default
+ *                       YCSB_KEY_NUM)
+ *   YCSB_SCAN_LENGTH    Maximum number of records of a scan (default 100)
+ *   YCSB_DISTRIBUTION   Overrides the key distribution of all workloads;
+ *                       one of "uniform", "zipfian" and "latest"
+ *
+ * Requires stx::btree_multimap, ART, libcuckoo and spinlock in ./benchmark
+ * directory. The STX B-tree and ART are protected by a reader-writer
+ * spinlock since they do not support concurrent writers, and scans are not
+ * supported by cuckoohash_map and the ART we use, so workload E is skipped
+ * for them
+ */
+
+#include "test_suite.h"
+#include "../benchmark/spinlock/spinlock.h"
+
+/*
+ * class LatencyHistogram - Log-linear histogram of latencies in nanoseconds
+ *
+ * Values below SUB_BUCKET_NUM have their own buckets, and each power of two
+ * above that is divided into SUB_BUCKET_NUM buckets, so the relative error
+ * of a reported percentile is less than 1 / SUB_BUCKET_NUM. Recording a
+ * value is a few shifts and an increment on thread local memory
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int SUB_BUCKET_BITS = 4;
+  static constexpr uint64_t SUB_BUCKET_NUM = 1UL << SUB_BUCKET_BITS;
+  static constexpr size_t BUCKET_NUM = (64 - SUB_BUCKET_BITS + 1) * \
+                                       SUB_BUCKET_NUM;
+
+  uint64_t bucket_list[BUCKET_NUM];
+  uint64_t count;
+  uint64_t max_latency;
+
+  /*
+   * Default constructor - The histogram is empty
+   */
+  LatencyHistogram() :
+    count{0UL},
+    max_latency{0UL} {
+    memset(bucket_list, 0, sizeof(bucket_list));
+
+    return;
+  }
+
+  /*
+   * GetBucketIndex() - Returns the index of the bucket holding a latency
+   */
+  static inline size_t GetBucketIndex(uint64_t latency) {
+    if(latency < SUB_BUCKET_NUM) {
+      return latency;
+    }
+
+    int msb = 63 - __builtin_clzl(latency);
+    int shift = msb - SUB_BUCKET_BITS;
+
+    return (shift + 1) * SUB_BUCKET_NUM + \
+           ((latency >> shift) & (SUB_BUCKET_NUM - 1));
+  }
+
+  /*
+   * GetBucketUpperBound() - Returns the largest latency in a bucket
+   */
+  static inline uint64_t GetBucketUpperBound(size_t index) {
+    if(index < SUB_BUCKET_NUM) {
+      return index;
+    }
+
+    int shift = static_cast<int>(index / SUB_BUCKET_NUM) - 1;
+    uint64_t sub_bucket = index % SUB_BUCKET_NUM;
+
+    return ((SUB_BUCKET_NUM + sub_bucket + 1) << shift) - 1;
+  }
+
+  /*
+   * Record() - Adds a latency into the histogram
+   */
+  inline void Record(uint64_t latency) {
+    bucket_list[GetBucketIndex(latency)]++;
+    count++;
+
+    if(latency > max_latency) {
+      max_latency = latency;
+    }
+
+    return;
+  }
+
+  /*
+   * Merge() - Adds all latencies of another histogram into this one
+   */
+  void Merge(const LatencyHistogram &other) {
+    for(size_t i = 0;i < BUCKET_NUM;i++) {
+      bucket_list[i] += other.bucket_list[i];
+    }
+
+    count += other.count;
+    max_latency = std::max(max_latency, other.max_latency);
+
+    return;
+  }
+
+  /*
+   * GetPercentile() - Returns the latency that percentile percent of the
+   *                   recorded latencies do not exceed
+   *
+   * The upper bound of the bucket is returned, so it is never smaller than
+   * the exact percentile
+   */
+  uint64_t GetPercentile(double percentile) const {
+    if(count == 0UL) {
+      return 0UL;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(count * percentile / 100.0);
+    if(rank >= count) {
+      rank = count - 1;
+    }
+
+    uint64_t current_count = 0UL;
+    for(size_t i = 0;i < BUCKET_NUM;i++) {
+      current_count += bucket_list[i];
+      if(current_count > rank) {
+        return std::min(GetBucketUpperBound(i), max_latency);
+      }
+    }
+
+    return max_latency;
+  }
+};
+
+/*
+ * enum class YCSBOpType - Operations issued by YCSB workloads
+ */
+enum class YCSBOpType : int {
+  READ = 0,
+  UPDATE,
+  INSERT,
+  SCAN,
+  READ_MODIFY_WRITE,
+  OP_TYPE_NUM,
+};
+
+static const char *ycsb_op_name_list[] = {
+  "read", "update", "insert", "scan", "rmw",
+};
+
+static constexpr int YCSB_OP_TYPE_NUM = \
+  static_cast<int>(YCSBOpType::OP_TYPE_NUM);
+
+/*
+ * enum class YCSBDistribution - How keys of reads, updates and scans are
+ *                               chosen among records inserted so far
+ */
+enum class YCSBDistribution : int {
+  // All records are equally likely
+  UNIFORM = 0,
+  // Popular records are scattered over the key space
+  ZIPFIAN,
+  // The most recently inserted records are the most popular
+  LATEST,
+};
+
+/*
+ * class YCSBWorkload - Operation mix and key distribution of a workload
+ *
+ * Proportions are percentages of operations and add up to 100
+ */
+class YCSBWorkload {
+ public:
+  char name;
+  int proportion_list[YCSB_OP_TYPE_NUM];
+  YCSBDistribution distribution;
+};
+
+// These are the core workloads defined by YCSB
+static const YCSBWorkload ycsb_workload_list[] = {
+  // Update heavy
+  {'A', {50, 50, 0, 0, 0}, YCSBDistribution::ZIPFIAN},
+  // Read mostly
+  {'B', {95, 5, 0, 0, 0}, YCSBDistribution::ZIPFIAN},
+  // Read only
+  {'C', {100, 0, 0, 0, 0}, YCSBDistribution::ZIPFIAN},
+  // Read latest
+  {'D', {95, 0, 5, 0, 0}, YCSBDistribution::LATEST},
+  // Short ranges
+  {'E', {0, 0, 5, 95, 0}, YCSBDistribution::ZIPFIAN},
+  // Read-modify-write
+  {'F', {50, 0, 0, 0, 50}, YCSBDistribution::ZIPFIAN},
+};
+
+/*
+ * class YCSBKeyChooser - Chooses record IDs of a thread following the
+ *                        distribution of a workload
+ *
+ * Zipfian ranks are drawn over the loaded records. For the zipfian
+ * distribution the rank is hashed to spread popular records over the key
+ * space (i.e. YCSB's scrambled zipfian), and for the latest distribution
+ * rank 0 is the newest record
+ */
+class YCSBKeyChooser {
+ private:
+  YCSBDistribution distribution;
+  Zipfian zipf;
+  SimpleInt64Random<0, 0xFFFFFFFFFFFFFFFFUL> hash;
+  uint64_t salt;
+  uint64_t seq;
+
+ public:
+  YCSBKeyChooser(YCSBDistribution p_distribution,
+                 uint64_t key_num,
+                 uint64_t thread_id) :
+    distribution{p_distribution},
+    zipf{key_num, 0.99, thread_id + 1},
+    hash{},
+    salt{thread_id + 1},
+    seq{0UL}
+  {}
+
+  /*
+   * Get() - Returns a record ID in [0, record_count)
+   */
+  inline uint64_t Get(uint64_t record_count) {
+    switch(distribution) {
+      case YCSBDistribution::UNIFORM:
+        return hash(seq++, salt) % record_count;
+      case YCSBDistribution::ZIPFIAN:
+        return hash(zipf.Get(), 0UL) % record_count;
+      case YCSBDistribution::LATEST:
+        return record_count - 1 - (zipf.Get() % record_count);
+    }
+
+    assert(false);
+    return 0UL;
+  }
+};
+
+/*
+ * YCSBMakeKey() - Converts a record ID into a key of the index
+ *
+ * Keys are ordered in the same way as record IDs, such that a scan from a
+ * record visits records with the following IDs
+ */
+inline void YCSBMakeKey(uint64_t record_id, long int *key_p) {
+  *key_p = static_cast<long int>(record_id);
+
+  return;
+}
+
+template <size_t KEY_SIZE>
+inline void YCSBMakeKey(uint64_t record_id, FixedLengthKey<KEY_SIZE> *key_p) {
+  key_p->SetUnsigned(0, record_id);
+
+  return;
+}
+
+/*
+ * class YCSBBwTreeIndex - Runs YCSB operations on a BwTree
+ *
+ * Updates replace the value of a key with Upsert() since every record has
+ * exactly one value. Reads copy the value into a stack buffer
+ */
+template <typename KeyType,
+          typename KeyComparator,
+          typename KeyEqualityChecker,
+          typename KeyHashFunc>
+class YCSBBwTreeIndex {
+ public:
+  using IndexType = BwTree<KeyType,
+                           long int,
+                           KeyComparator,
+                           KeyEqualityChecker,
+                           KeyHashFunc>;
+
+  static constexpr bool SCAN_SUPPORTED = true;
+
+  IndexType *tree_p;
+
+  YCSBBwTreeIndex() :
+    tree_p{new IndexType{true,
+                         KeyComparator{1},
+                         KeyEqualityChecker{1},
+                         KeyHashFunc{}}} {
+    // Debug messages of the tree would dominate latency
+    print_flag = false;
+
+    return;
+  }
+
+  ~YCSBBwTreeIndex() {
+    delete tree_p;
+  }
+
+  static const char *GetName() {
+    return std::is_same<KeyType, long int>::value ? "BwTree" : "BwTree-Fixed";
+  }
+
+  /*
+   * PrepareThread() - Prepares GC slots for the given number of threads
+   *
+   * This must be called before worker threads start
+   */
+  void PrepareThread(uint64_t thread_num) {
+    tree_p->UpdateThreadLocal(thread_num);
+
+    return;
+  }
+
+  void JoinThread(uint64_t thread_id) {
+    tree_p->AssignGCID(static_cast<int>(thread_id));
+
+    return;
+  }
+
+  void LeaveThread(uint64_t thread_id) {
+    tree_p->UnregisterThread(static_cast<int>(thread_id));
+
+    return;
+  }
+
+  inline void Insert(uint64_t record_id, long int value) {
+    KeyType key{};
+    YCSBMakeKey(record_id, &key);
+
+    tree_p->Insert(key, value);
+
+    return;
+  }
+
+  inline bool Read(uint64_t record_id, long int *value_p) {
+    KeyType key{};
+    YCSBMakeKey(record_id, &key);
+
+    return tree_p->GetValue(key, value_p, 1UL) != 0UL;
+  }
+
+  inline void Update(uint64_t record_id, long int value) {
+    KeyType key{};
+    YCSBMakeKey(record_id, &key);
+
+    tree_p->Upsert(key, value);
+
+    return;
+  }
+
+  inline size_t Scan(uint64_t record_id, size_t scan_length) {
+    KeyType key{};
+    YCSBMakeKey(record_id, &key);
+
+    size_t count = 0UL;
+    for(auto it = tree_p->Begin(key);
+        count < scan_length && it.IsEnd() == false;
+        it++) {
+      count += (it->second >= 0L) ? 1UL : 0UL;
+    }
+
+    return count;
+  }
+};
+
+/*
+ * class YCSBFixedKeyComparator - Adds a constructor taking an int to
+ *                                FixedLengthKeyComparator, as other
+ *                                comparators of this benchmark
+ */
+template <size_t KEY_SIZE>
+class YCSBFixedKeyComparator : public FixedLengthKeyComparator<KEY_SIZE> {
+ public:
+  YCSBFixedKeyComparator(int dummy) {
+    (void)dummy;
+  }
+};
+
+template <size_t KEY_SIZE>
+class YCSBFixedKeyEqualityChecker :
+  public FixedLengthKeyEqualityChecker<KEY_SIZE> {
+ public:
+  YCSBFixedKeyEqualityChecker(int dummy) {
+    (void)dummy;
+  }
+};
+
+using YCSBBwTree = YCSBBwTreeIndex<long int,
+                                   KeyComparator,
+                                   KeyEqualityChecker,
+                                   std::hash<long int>>;
+
+using YCSBBwTreeFixed16 = \
+  YCSBBwTreeIndex<FixedLengthKey<16>,
+                  YCSBFixedKeyComparator<16>,
+                  YCSBFixedKeyEqualityChecker<16>,
+                  FixedLengthKeyHashFunc<16>>;
+
+/*
+ * class YCSBBTreeIndex - Runs YCSB operations on stx::btree_multimap
+ *                        protected by a reader-writer spinlock
+ */
+class YCSBBTreeIndex {
+ public:
+  static constexpr bool SCAN_SUPPORTED = true;
+
+  BTreeType *tree_p;
+  spinlock_t lock;
+
+  YCSBBTreeIndex() :
+    tree_p{GetEmptyBTree()} {
+    rwlock_init(lock);
+
+    return;
+  }
+
+  ~YCSBBTreeIndex() {
+    delete tree_p;
+  }
+
+  static const char *GetName() {
+    return "BTree";
+  }
+
+  void PrepareThread(uint64_t) {}
+  void JoinThread(uint64_t) {}
+  void LeaveThread(uint64_t) {}
+
+  inline void Insert(uint64_t record_id, long int value) {
+    write_lock(lock);
+    tree_p->insert(static_cast<long int>(record_id), value);
+    write_unlock(lock);
+
+    return;
+  }
+
+  inline bool Read(uint64_t record_id, long int *value_p) {
+    read_lock(lock);
+
+    auto it = tree_p->find(static_cast<long int>(record_id));
+    bool found_flag = (it != tree_p->end());
+    if(found_flag == true) {
+      *value_p = it->second;
+    }
+
+    read_unlock(lock);
+
+    return found_flag;
+  }
+
+  inline void Update(uint64_t record_id, long int value) {
+    write_lock(lock);
+
+    auto it = tree_p->find(static_cast<long int>(record_id));
+    if(it != tree_p->end()) {
+      it.data() = value;
+    }
+
+    write_unlock(lock);
+
+    return;
+  }
+
+  inline size_t Scan(uint64_t record_id, size_t scan_length) {
+    read_lock(lock);
+
+    size_t count = 0UL;
+    for(auto it = tree_p->lower_bound(static_cast<long int>(record_id));
+        count < scan_length && it != tree_p->end();
+        it++) {
+      count += (it->second >= 0L) ? 1UL : 0UL;
+    }
+
+    read_unlock(lock);
+
+    return count;
+  }
+};
+
+/*
+ * class YCSBARTIndex - Runs YCSB operations on ART protected by a
+ *                      reader-writer spinlock
+ *
+ * Keys are stored in big-endian, and values are stored in the pointer
+ * field plus one since ART returns nullptr for missing keys
+ */
+class YCSBARTIndex {
+ public:
+  static constexpr bool SCAN_SUPPORTED = false;
+
+  ARTType tree;
+  spinlock_t lock;
+
+  YCSBARTIndex() {
+    art_tree_init(&tree);
+    rwlock_init(lock);
+
+    return;
+  }
+
+  ~YCSBARTIndex() {
+    art_tree_destroy(&tree);
+  }
+
+  static const char *GetName() {
+    return "ART";
+  }
+
+  void PrepareThread(uint64_t) {}
+  void JoinThread(uint64_t) {}
+  void LeaveThread(uint64_t) {}
+
+  static inline uint64_t MakeKey(uint64_t record_id) {
+    return __builtin_bswap64(record_id);
+  }
+
+  inline void Insert(uint64_t record_id, long int value) {
+    uint64_t key = MakeKey(record_id);
+
+    write_lock(lock);
+    art_insert(&tree, (unsigned char *)&key, sizeof(key), (void *)(value + 1));
+    write_unlock(lock);
+
+    return;
+  }
+
+  inline bool Read(uint64_t record_id, long int *value_p) {
+    uint64_t key = MakeKey(record_id);
+
+    read_lock(lock);
+    void *ret = art_search(&tree, (unsigned char *)&key, sizeof(key));
+    read_unlock(lock);
+
+    if(ret == nullptr) {
+      return false;
+    }
+
+    *value_p = (long int)ret - 1;
+
+    return true;
+  }
+
+  inline void Update(uint64_t record_id, long int value) {
+    Insert(record_id, value);
+
+    return;
+  }
+
+  inline size_t Scan(uint64_t, size_t) {
+    assert(false);
+
+    return 0UL;
+  }
+};
+
+/*
+ * class YCSBCuckooIndex - Runs YCSB operations on cuckoohash_map
+ */
+class YCSBCuckooIndex {
+ public:
+  static constexpr bool SCAN_SUPPORTED = false;
+
+  cuckoohash_map<long int, long int> map;
+
+  static const char *GetName() {
+    return "CuckooHash";
+  }
+
+  void PrepareThread(uint64_t) {}
+  void JoinThread(uint64_t) {}
+  void LeaveThread(uint64_t) {}
+
+  inline void Insert(uint64_t record_id, long int value) {
+    map.insert(static_cast<long int>(record_id), value);
+
+    return;
+  }
+
+  inline bool Read(uint64_t record_id, long int *value_p) {
+    return map.find(static_cast<long int>(record_id), *value_p);
+  }
+
+  inline void Update(uint64_t record_id, long int value) {
+    map.update(static_cast<long int>(record_id), value);
+
+    return;
+  }
+
+  inline size_t Scan(uint64_t, size_t) {
+    assert(false);
+
+    return 0UL;
+  }
+};
+
+/*
+ * class YCSBConfig - Parameters of a run read from environmental variables
+ */
+class YCSBConfig {
+ public:
+  uint64_t thread_num;
+  uint64_t key_num;
+  uint64_t op_num;
+  uint64_t scan_length;
+
+  // Workload letters to run, in the given order
+  std::string workload_list;
+
+  // True if the distribution of all workloads is overridden
+  bool distribution_flag;
+  YCSBDistribution distribution;
+};
+
+/*
+ * YCSBGetNanoSecond() - Returns a monotonic timestamp in nanoseconds
+ */
+static inline uint64_t YCSBGetNanoSecond() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * RunYCSBWorkload() - Loads a fresh index and runs one workload on it
+ */
+template <typename YCSBIndex>
+void RunYCSBWorkload(const YCSBConfig &config, const YCSBWorkload &workload) {
+  if(workload.proportion_list[static_cast<int>(YCSBOpType::SCAN)] > 0 && \
+     YCSBIndex::SCAN_SUPPORTED == false) {
+    printf("[YCSB-%c] %s does not support scan; skipped\n",
+           workload.name,
+           YCSBIndex::GetName());
+
+    return;
+  }
+
+  YCSBDistribution distribution = \
+    config.distribution_flag ? config.distribution : workload.distribution;
+
+  uint64_t thread_num = config.thread_num;
+  uint64_t key_num = config.key_num;
+
+  YCSBIndex *index_p = new YCSBIndex{};
+  index_p->PrepareThread(thread_num);
+
+  // Load phase - each thread inserts a contiguous range of records
+  auto load_func = [key_num, thread_num](uint64_t thread_id,
+                                         YCSBIndex *index_p) {
+    index_p->JoinThread(thread_id);
+
+    uint64_t start_id = key_num / thread_num * thread_id;
+    uint64_t end_id = (thread_id == thread_num - 1) ? \
+                        key_num : start_id + key_num / thread_num;
+
+    for(uint64_t i = start_id;i < end_id;i++) {
+      index_p->Insert(i, static_cast<long int>(i));
+    }
+
+    index_p->LeaveThread(thread_id);
+
+    return;
+  };
+
+  Timer timer{true};
+  LaunchParallelTestID(nullptr, thread_num, load_func, index_p);
+  double load_duration = timer.Stop();
+
+  printf("[YCSB-%c] %s load %lu records: %f million insert/sec\n",
+         workload.name,
+         YCSBIndex::GetName(),
+         key_num,
+         key_num / 1000000.0 / load_duration);
+
+  // Records with IDs below this have been inserted. New records take IDs
+  // from this counter
+  std::atomic<uint64_t> record_count{key_num};
+
+  std::vector<std::array<LatencyHistogram, YCSB_OP_TYPE_NUM>> \
+    histogram_list(thread_num);
+
+  // Records returned by scans of each thread. This also keeps the compiler
+  // from discarding scan loops whose results are not otherwise used
+  std::vector<uint64_t> scan_record_count_list(thread_num, 0UL);
+
+  uint64_t thread_op_num = config.op_num / thread_num;
+  uint64_t scan_length = config.scan_length;
+
+  auto run_func = [&workload,
+                   distribution,
+                   key_num,
+                   thread_op_num,
+                   scan_length,
+                   &record_count,
+                   &histogram_list,
+                   &scan_record_count_list](uint64_t thread_id,
+                                            YCSBIndex *index_p) {
+    index_p->JoinThread(thread_id);
+
+    YCSBKeyChooser chooser{distribution, key_num, thread_id};
+    SimpleInt64Random<0, 100> op_random{};
+    SimpleInt64Random<1, 0xFFFFFFFFFFFFFFFFUL> scan_random{};
+    std::array<LatencyHistogram, YCSB_OP_TYPE_NUM> &histogram = \
+      histogram_list[thread_id];
+    uint64_t scan_record_count = 0UL;
+
+    for(uint64_t i = 0;i < thread_op_num;i++) {
+      // Choose the operation type by its proportion
+      int op_dice = static_cast<int>(op_random(i, thread_id));
+      int op_type = 0;
+      while(op_dice >= workload.proportion_list[op_type]) {
+        op_dice -= workload.proportion_list[op_type];
+        op_type++;
+      }
+
+      long int value = 0L;
+      uint64_t start_time = YCSBGetNanoSecond();
+
+      switch(static_cast<YCSBOpType>(op_type)) {
+        case YCSBOpType::READ:
+          index_p->Read(chooser.Get(record_count.load()), &value);
+          break;
+        case YCSBOpType::UPDATE:
+          index_p->Update(chooser.Get(record_count.load()),
+                          static_cast<long int>(i));
+          break;
+        case YCSBOpType::INSERT: {
+          uint64_t record_id = record_count.fetch_add(1);
+          index_p->Insert(record_id, static_cast<long int>(record_id));
+          break;
+        }
+        case YCSBOpType::SCAN:
+          scan_record_count += \
+            index_p->Scan(chooser.Get(record_count.load()),
+                          1 + scan_random(i, thread_id) % scan_length);
+          break;
+        case YCSBOpType::READ_MODIFY_WRITE: {
+          uint64_t record_id = chooser.Get(record_count.load());
+          index_p->Read(record_id, &value);
+          index_p->Update(record_id, value + 1);
+          break;
+        }
+        default:
+          assert(false);
+      }
+
+      histogram[op_type].Record(YCSBGetNanoSecond() - start_time);
+    }
+
+    scan_record_count_list[thread_id] = scan_record_count;
+
+    index_p->LeaveThread(thread_id);
+
+    return;
+  };
+
+  timer.Start();
+  LaunchParallelTestID(nullptr, thread_num, run_func, index_p);
+  double run_duration = timer.Stop();
+
+  printf("[YCSB-%c] %s %lu threads: %f million op/sec\n",
+         workload.name,
+         YCSBIndex::GetName(),
+         thread_num,
+         thread_op_num * thread_num / 1000000.0 / run_duration);
+  printf("    %-8s %12s %10s %10s %10s %10s\n",
+         "op", "count", "p50(ns)", "p99(ns)", "p99.9(ns)", "max(ns)");
+
+    for(int op_type = 0;op_type < YCSB_OP_TYPE_NUM;op_type++) {
+    LatencyHistogram histogram{};
+    for(uint64_t i = 0;i < thread_num;i++) {
+      histogram.Merge(histogram_list[i][op_type]);
+    }
+
+    if(histogram.count == 0UL) {
+      continue;
+    }
+
+    printf("    %-8s %12lu %10lu %10lu %10lu %10lu\n",
+           ycsb_op_name_list[op_type],
+           histogram.count,
+           histogram.GetPercentile(50.0),
+           histogram.GetPercentile(99.0),
+           histogram.GetPercentile(99.9),
+           histogram.max_latency);
+
+    if(op_type == static_cast<int>(YCSBOpType::SCAN)) {
+      uint64_t scan_record_count = 0UL;
+      for(uint64_t i = 0;i < thread_num;i++) {
+        scan_record_count += scan_record_count_list[i];
+      }
+
+      printf("    Average scan length: %f\n",
+             scan_record_count / static_cast<double>(histogram.count));
+    }
+  }
+
+  delete index_p;
+
+  return;
+}
+
+/*
+ * RunYCSBIndex() - Runs all configured workloads on one type of index
+ */
+template <typename YCSBIndex>
+void RunYCSBIndex(const YCSBConfig &config) {
+  for(char name : config.workload_list) {
+    bool found_flag = false;
+
+    for(const YCSBWorkload &workload : ycsb_workload_list) {
+      if(workload.name == toupper(name)) {
+        RunYCSBWorkload<YCSBIndex>(config, workload);
+        found_flag = true;
+      }
+    }
+
+    if(found_flag == false) {
+      printf("Unknown YCSB workload: %c\n", name);
+    }
+  }
+
+  return;
+}
+
+/*
+ * BenchmarkYCSB() - Runs YCSB workloads on indexes given by environmental
+ *                   variables
+ */
+void BenchmarkYCSB(int thread_num) {
+  YCSBConfig config{};
+  config.thread_num = static_cast<uint64_t>(thread_num);
+  config.key_num = 10UL * 1000UL * 1000UL;
+  config.scan_length = 100UL;
+
+  if(Envp::GetValueAsUL("YCSB_KEY_NUM", &config.key_num) == false || \
+     config.key_num == 0UL) {
+    throw "YCSB_KEY_NUM must be a positive integer!";
+  }
+
+  config.op_num = config.key_num;
+  if(Envp::GetValueAsUL("YCSB_OP_NUM", &config.op_num) == false) {
+    throw "YCSB_OP_NUM must be an unsigned integer!";
+  }
+
+  if(Envp::GetValueAsUL("YCSB_SCAN_LENGTH", &config.scan_length) == false || \
+     config.scan_length == 0UL) {
+    throw "YCSB_SCAN_LENGTH must be a positive integer!";
+  }
+
+  config.workload_list = Envp::Get("YCSB_WORKLOAD");
+  if(config.workload_list.empty() == true) {
+    config.workload_list = "ABCDEF";
+  }
+
+  std::string distribution = Envp::Get("YCSB_DISTRIBUTION");
+  config.distribution_flag = (distribution.empty() == false);
+  if(distribution == "uniform") {
+    config.distribution = YCSBDistribution::UNIFORM;
+  } else if(distribution == "zipfian") {
+    config.distribution = YCSBDistribution::ZIPFIAN;
+  } else if(distribution == "latest") {
+    config.distribution = YCSBDistribution::LATEST;
+  } else if(config.distribution_flag == true) {
+    throw "YCSB_DISTRIBUTION must be uniform, zipfian or latest!";
+  }
+
+  std::string index_list = Envp::Get("YCSB_INDEX");
+  if(index_list.empty() == true) {
+    index_list = "bwtree";
+  }
+
+  printf("YCSB: %lu records, %lu operations, workloads %s\n",
+         config.key_num,
+         config.op_num,
+         config.workload_list.c_str());
+
+  size_t start = 0UL;
+  while(start <= index_list.size()) {
+    size_t end = index_list.find(',', start);
+    if(end == std::string::npos) {
+      end = index_list.size();
+    }
+
+    std::string index = index_list.substr(start, end - start);
+    start = end + 1;
+
+    if(index == "bwtree") {
+      RunYCSBIndex<YCSBBwTree>(config);
+    } else if(index == "bwtree-fixed16") {
+      RunYCSBIndex<YCSBBwTreeFixed16>(config);
+    } else if(index == "btree") {
+      RunYCSBIndex<YCSBBTreeIndex>(config);
+    } else if(index == "art") {
+      RunYCSBIndex<YCSBARTIndex>(config);
+    } else if(index == "cuckoo") {
+      RunYCSBIndex<YCSBCuckooIndex>(config);
+    } else {
+      printf("Unknown YCSB index: %s\n", index.c_str());
+    }
+  }
+
+  return;
+}
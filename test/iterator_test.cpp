@@ -74,3 +74,161 @@ void BackwardIteratorTest(TreeType *t, int key_num) {
   
   return;
 }
+
+/*
+ * ReverseIteratorTest() - Tests RBegin() and backward iteration through
+ *                         cached parent nodes
+ *
+ * The second part splits leaf pages on the left of the iterator after the
+ * parent node has been cached, such that the cached parent becomes stale
+ */
+void ReverseIteratorTest(TreeType *t, int key_num) {
+  printf("========== Reverse Iterator Test ==========\n");
+
+  auto it = t->RBegin(key_num + 100);
+  long int key = key_num - 1;
+
+  while(it.IsREnd() == false) {
+    assert(it->first == key);
+    assert(it->first == it->second);
+
+    key--;
+    --it;
+  }
+
+  assert(key == -1);
+
+  it = t->RBegin(key_num / 2);
+  assert(it->first == key_num / 2);
+
+  it = t->RBegin(-1);
+  assert(it.IsREnd() == true);
+
+  TreeType *t2 = GetEmptyTree(true);
+  t2->SetNodeSizeThreshold(8, 2, 8, 2);
+
+  const long int small_key_num = 4096;
+
+  for(long int i = 0;i < small_key_num;i += 2) {
+    t2->Insert(i, i);
+  }
+
+  auto it2 = t2->RBegin(small_key_num);
+  key = small_key_num - 2;
+
+  // Cross a few page boundaries to build the cache
+  while(key >= small_key_num / 2) {
+    assert(it2->first == key);
+
+    key -= 2;
+    --it2;
+  }
+
+  // Odd numbers are inserted into pages on the left. The current page
+  // has already been buffered, so leave a gap larger than a page
+  const long int gap_key = key - 64;
+  for(long int i = 1;i < gap_key;i += 2) {
+    t2->Insert(i, i);
+  }
+
+  while(it2.IsREnd() == false) {
+    assert(it2->first == key);
+
+    key -= (key > gap_key) ? 2 : 1;
+    --it2;
+  }
+
+  assert(key == -1);
+
+  DestroyTree(t2, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * RangeScanTest() - Tests range scan against forward iterator
+ *
+ * Some delta records are installed on the first few leaf nodes before
+ * scanning, such that both base node items and delta records are collected
+ */
+void RangeScanTest(TreeType *t, int key_num) {
+  printf("========== Range Scan Test ==========\n");
+
+  const int delta_key_num = 4096;
+
+  for(int i = 0;i < delta_key_num;i++) {
+    if(i % 3 == 0) {
+      t->Insert(i, i + key_num);
+    }
+
+    if(i % 5 == 0) {
+      t->Delete(i, i);
+    }
+  }
+
+  std::vector<std::pair<long int, long int>> result{};
+  std::vector<std::pair<long int, long int>> expected{};
+
+  auto cb = [&result](const long int &key, const long int &value) {
+    result.push_back(std::make_pair(key, value));
+  };
+
+  for(int i = 0;i < 1000;i++) {
+    long int low = (i % 2 == 0) ? (rand() % (delta_key_num * 2)) : \
+                                  (rand() % key_num);
+    long int high = low + rand() % 1000;
+    size_t limit = rand() % 600;
+
+    result.clear();
+    expected.clear();
+
+    size_t ret = t->RangeScan(low, high, limit, cb);
+    assert(ret == result.size());
+    (void)ret;
+
+    for(auto it = t->Begin(low);it.IsEnd() == false;it++) {
+      if((it->first >= high) || (expected.size() == limit)) {
+        break;
+      }
+
+      expected.push_back(*it);
+    }
+
+    assert(result.size() == expected.size());
+
+    // Order of values under the same key is not specified, and the limit
+    // may cut between values of a key, so only compare keys in this case
+    for(size_t j = 0;j < result.size();j++) {
+      assert(result[j].first == expected[j].first);
+    }
+
+    if(result.size() < limit) {
+      std::sort(result.begin(), result.end());
+      std::sort(expected.begin(), expected.end());
+
+      assert(result == expected);
+    }
+  }
+
+  // Unbounded scan stops at the end of the tree
+  result.clear();
+  size_t scan_count = t->RangeScan(key_num - 10, 100, cb);
+  assert(scan_count == 10UL);
+  assert(result.front().first == key_num - 10);
+  assert(result.back().first == key_num - 1);
+
+  // Empty ranges
+  scan_count = t->RangeScan(100, 100, 100, cb);
+  assert(scan_count == 0UL);
+  scan_count = t->RangeScan(key_num, 100, cb);
+  assert(scan_count == 0UL);
+  scan_count = t->RangeScan(0, key_num, 0, cb);
+  assert(scan_count == 0UL);
+  (void)scan_count;
+
+  printf("PASS\n");
+
+  return;
+}
@@ -25,6 +25,8 @@ int main(int argc, char **argv) {
   bool run_benchmark_bwtree_full = false;
   bool run_benchmark_btree_full = false;
   bool run_benchmark_art_full = false;
+  bool run_benchmark_ycsb = false;
+  bool run_benchmark_scalability = false;
   bool run_stress = false;
   bool run_epoch_test = false;
   bool run_infinite_insert_test = false;
@@ -47,6 +49,10 @@ int main(int argc, char **argv) {
       run_benchmark_btree_full = true;
     } else if(strcmp(opt_p, "--benchmark-art-full") == 0) {
       run_benchmark_art_full = true;
+    } else if(strcmp(opt_p, "--benchmark-ycsb") == 0) {
+      run_benchmark_ycsb = true;
+    } else if(strcmp(opt_p, "--benchmark-scalability") == 0) {
+      run_benchmark_scalability = true;
     } else if(strcmp(opt_p, "--stress-test") == 0) {
       run_stress = true;
     } else if(strcmp(opt_p, "--epoch-test") == 0) {
@@ -70,6 +76,8 @@ int main(int argc, char **argv) {
   bwt_printf("RUN_BENCHMARK_BWTREE_FULL = %d\n", run_benchmark_bwtree_full);
   bwt_printf("RUN_BENCHMARK_BWTREE = %d\n", run_benchmark_bwtree);
   bwt_printf("RUN_BENCHMARK_ART_FULL = %d\n", run_benchmark_art_full);
+  bwt_printf("RUN_BENCHMARK_YCSB = %d\n", run_benchmark_ycsb);
+  bwt_printf("RUN_BENCHMARK_SCALABILITY = %d\n", run_benchmark_scalability);
   bwt_printf("RUN_TEST = %d\n", run_test);
   bwt_printf("RUN_STRESS = %d\n", run_stress);
   bwt_printf("RUN_EPOCH_TEST = %d\n", run_epoch_test);
@@ -162,6 +170,14 @@ int main(int argc, char **argv) {
     DestroyBTree(t);
   }
 
+  if(run_benchmark_ycsb == true) {
+    BenchmarkYCSB((int)GetThreadNum());
+  }
+
+  if(run_benchmark_scalability == true) {
+    BenchmarkScalability((int)GetThreadNum());
+  }
+
   if(run_benchmark_bwtree == true ||
      run_benchmark_bwtree_full == true) {
     t1 = GetEmptyTree();
@@ -178,17 +194,45 @@ int main(int argc, char **argv) {
     
     uint64_t thread_num = GetThreadNum();
 
+    // PageAllocator options of the mapping table, e.g. 5 for huge pages
+    // faulted before the benchmark starts
+    uint64_t page_flags = 0;
+    if(Envp::GetValueAsUL("PAGE_FLAGS", &page_flags) == false) {
+      throw "PAGE_FLAGS must be an unsigned integer!";
+    } else if(page_flags != 0) {
+      printf("Using page_flags = %lu\n", page_flags);
+
+      t1->SetMappingTablePageMode(static_cast<int>(page_flags), key_num);
+    }
+
     if(run_benchmark_bwtree_full == true) {
       // Benchmark random insert performance
       BenchmarkBwTreeRandInsert(key_num, (int)thread_num);
-      // Then we rely on this test to fill bwtree with 30 million keys
-      BenchmarkBwTreeSeqInsert(t1, key_num, (int)thread_num);
+      // Sequential insert from the root on a separate tree
+      TreeType *t2 = GetEmptyTree(true);
+      BenchmarkBwTreeSeqInsert(t2, key_num, (int)thread_num, false);
+      DestroyTree(t2, true);
+      // Then we rely on this test to fill bwtree with 30 million keys,
+      // which uses leaf fingers
+      BenchmarkBwTreeSeqInsert(t1, key_num, (int)thread_num, true);
       // And then do a multithreaded sequential read
       BenchmarkBwTreeSeqRead(t1, key_num, (int)thread_num);
       // Do a random read with totally random numbers
       BenchmarkBwTreeRandRead(t1, key_num, (int)thread_num);
-      // Zipfan read
-      BenchmarkBwTreeZipfRead(t1, key_num, (int)thread_num);
+      // The same random read into a buffer without allocation
+      BenchmarkBwTreeRandReadBuffer(t1, key_num, (int)thread_num);
+      // The same random read in batches, without and with prefetching
+      BenchmarkBwTreeRandReadBatch(t1, key_num, (int)thread_num, false);
+      BenchmarkBwTreeRandReadBatch(t1, key_num, (int)thread_num, true);
+      // Zipfan read, without and with the read cache
+      double zipf_throughput = \
+        BenchmarkBwTreeZipfRead(t1, key_num, (int)thread_num, 0UL);
+      double zipf_cache_throughput = \
+        BenchmarkBwTreeZipfRead(t1, key_num, (int)thread_num, 1UL << 18);
+      printf("Read cache speedup (zipfian) = %f\n",
+             zipf_cache_throughput / zipf_throughput);
+      // Compare bulk loading with sequential insert on a separate tree
+      BenchmarkBwTreeBulkLoad(key_num);
     } else {
       // This function will delete all keys at the end, so the tree
       // is empty after it returns
@@ -258,6 +302,8 @@ int main(int argc, char **argv) {
 
     ForwardIteratorTest(t1, key_num);
     BackwardIteratorTest(t1, key_num);
+    ReverseIteratorTest(t1, key_num);
+    RangeScanTest(t1, key_num);
     
     PrintStat(t1);
 
@@ -266,6 +312,67 @@ int main(int argc, char **argv) {
     // Do not forget to deletet the tree here
     DestroyTree(t1, true);
 
+    /////////////////////////////////////////////////////////////////
+    // Test bulk load
+    /////////////////////////////////////////////////////////////////
+
+    t1 = GetEmptyTree(true);
+
+    BulkLoadTest(t1, key_num);
+
+    DestroyTree(t1, true);
+
+    /////////////////////////////////////////////////////////////////
+    // Test non-default node size thresholds
+    /////////////////////////////////////////////////////////////////
+
+    TuningPolicyTest(key_num / 4);
+
+    MappingTableGrowthTest(key_num / 2);
+
+    IntegerKeySearchTest(key_num / 4);
+
+    NodeAllocatorTest(key_num / 4);
+
+    GarbageCollectionTest(key_num / 4);
+
+    BackgroundConsolidationTest(key_num / 4);
+
+    UniqueKeyTest(key_num / 4);
+
+    GetValueBufferTest(key_num / 4);
+
+    StringSeparatorTest(key_num / 4);
+
+    FixedLengthKeyTest(key_num / 4);
+
+    InnerSearchIndexTest(key_num);
+    StatisticsTest(key_num / 4);
+    EpochAdvanceTest(key_num / 16);
+    ThreadRegistrationTest(key_num / 16);
+    CheckpointTest(key_num / 4);
+    InsertBatchTest(key_num / 4);
+    LeafBatchInsertTest(key_num / 4);
+    AdaptiveConsolidationTest(key_num / 4);
+    ReadCacheTest(key_num / 4);
+    LeafFingerTest(key_num / 16);
+    SplitPolicyTest(key_num / 16);
+    CompactTest(key_num / 4);
+    DeleteRangeTest(key_num / 4);
+    MemoryUsageTest(key_num / 4);
+    StableValueTest(key_num / 16);
+    CompressedLeafTest(key_num / 4);
+    LeafRetryTest(key_num / 16);
+    EstimateCountTest(key_num / 4);
+    SampleKeysTest(key_num / 4);
+    IteratorPinTest(key_num / 4);
+    ParallelScanTest(key_num / 4);
+    NodeIDCacheTest(key_num / 4);
+    LeafFingerprintTest(key_num / 4);
+    PageAllocatorTest(key_num / 4);
+    SnapshotTest(key_num / 4);
+    TruncateTest(key_num / 4);
+
     /////////////////////////////////////////////////////////////////
     // Test random insert
     /////////////////////////////////////////////////////////////////
@@ -310,6 +417,14 @@ int main(int argc, char **argv) {
     InsertGetValueTest(t1);
     printf("Finished verifying all inserted values\n");
 
+    InsertGetValueBatchTest(t1);
+    printf("Finished verifying all inserted values (batch)\n");
+
+    t1->SetPrefetchMode(true);
+    InsertGetValueBatchTest(t1);
+    t1->SetPrefetchMode(false);
+    printf("Finished verifying all inserted values (batch, prefetch)\n");
+
     LaunchParallelTestID(t1, basic_test_thread_num, DeleteTest1, t1);
     printf("Finished deleting all keys\n");
 
@@ -366,6 +481,26 @@ int main(int argc, char **argv) {
     DeleteGetValueTest(t1);
     printf("Finished verifying all deleted values\n");
 
+    LaunchParallelTestID(t1, basic_test_thread_num, InsertTest1, t1);
+    printf("Finished inserting all keys\n");
+
+    LaunchParallelTestID(t1, basic_test_thread_num, UpdateTest1, t1);
+    printf("Finished updating all keys\n");
+
+    PrintStat(t1);
+
+    UpdateGetValueTest(t1);
+    printf("Finished verifying all updated values\n");
+
+    LaunchParallelTestID(t1, basic_test_thread_num, UpsertTest2, t1);
+    printf("Finished upserting all keys\n");
+
+    PrintStat(t1);
+
+    UpsertGetValueTest(t1);
+    UpdateGetValueTest(t1);
+    printf("Finished verifying all upserted values\n");
+
     DestroyTree(t1);
   }
   
@@ -46,3 +46,3835 @@ void TestEpochManager(TreeType *t) {
 
   return;
 }
+
+/*
+ * BulkLoadTest() - Tests bulk loading a tree from sorted key value pairs
+ *
+ * Each key has two values, and after bulk loading we verify the tree using
+ * both point queries and iterators, and then run normal inserts and deletes
+ * on the bulk loaded tree to make sure SMOs work with it
+ */
+void BulkLoadTest(TreeType *t, int key_num) {
+  printf("========== Bulk Load Test ==========\n");
+
+  std::vector<std::pair<long int, long int>> item_list{};
+  for(int i = 0;i < key_num;i++) {
+    item_list.push_back(std::make_pair(i, i));
+    item_list.push_back(std::make_pair(i, i + 1));
+  }
+
+  t->BulkLoad(item_list.begin(), item_list.end());
+
+  for(int i = 0;i < key_num;i++) {
+    auto value_set = t->GetValue(i);
+
+    assert(value_set.size() == 2);
+  }
+
+  long int key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key / 2);
+    key++;
+  }
+
+  assert(key == key_num * 2);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Delete(i, i + 1);
+    t->Insert(i + key_num, i);
+  }
+
+  for(int i = 0;i < key_num * 2;i++) {
+    auto value_set = t->GetValue(i);
+
+    assert(value_set.size() == 1);
+  }
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * class SmallNodeTuningPolicy - Tuning policy with small nodes and short
+ *                               delta chains to make SMOs frequent
+ */
+class SmallNodeTuningPolicy {
+ public:
+  static constexpr int INNER_DELTA_CHAIN_THRESHOLD = 2;
+  static constexpr int LEAF_DELTA_CHAIN_THRESHOLD = 4;
+  static constexpr int INNER_NODE_UPPER_THRESHOLD = 16;
+  static constexpr int INNER_NODE_LOWER_THRESHOLD = 4;
+  static constexpr int LEAF_NODE_UPPER_THRESHOLD = 16;
+  static constexpr int LEAF_NODE_LOWER_THRESHOLD = 4;
+};
+
+/*
+ * TuningPolicyTest() - Tests trees with non-default node size thresholds
+ *
+ * The first tree uses a tuning policy, and the second one overrides the
+ * default policy at runtime. Both trees are verified after inserting and
+ * then deleting half of the keys
+ */
+void TuningPolicyTest(int key_num) {
+  printf("========== Tuning Policy Test ==========\n");
+
+  using SmallNodeTreeType = BwTree<long int,
+                                   long int,
+                                   KeyComparator,
+                                   KeyEqualityChecker,
+                                   std::hash<long int>,
+                                   std::equal_to<long int>,
+                                   std::hash<long int>,
+                                   SmallNodeTuningPolicy>;
+
+  auto t1 = new SmallNodeTreeType{true,
+                                  KeyComparator{1},
+                                  KeyEqualityChecker{1}};
+  t1->UpdateThreadLocal(1);
+  t1->AssignGCID(0);
+
+  TreeType *t2 = GetEmptyTree(true);
+  t2->SetNodeSizeThreshold(8, 2, 8, 2);
+
+  for(int i = 0;i < key_num;i++) {
+    t1->Insert(i, i);
+    t2->Insert(i, i);
+  }
+
+  for(int i = 0;i < key_num;i += 2) {
+    t1->Delete(i, i);
+    t2->Delete(i, i);
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    size_t expected = (i % 2 == 0) ? 0UL : 1UL;
+
+    assert(t1->GetValue(i).size() == expected);
+    assert(t2->GetValue(i).size() == expected);
+    (void)expected;
+  }
+
+  delete t1;
+  DestroyTree(t2, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * MappingTableGrowthTest() - Tests allocating mapping table segments
+ *
+ * Small nodes are used to quickly consume NodeIDs in more than one segment
+ */
+void MappingTableGrowthTest(int key_num) {
+  printf("========== Mapping Table Growth Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(8, 2, 8, 2);
+
+  // A new tree only uses the first segment for root and the first leaf
+  assert(t->mapping_table.GetSegmentCount() == 1UL);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  printf("Next NodeID = %lu; segment count = %lu\n",
+         t->next_unused_node_id.load(),
+         t->mapping_table.GetSegmentCount());
+
+  assert(t->mapping_table.GetSegmentCount() == \
+         (t->next_unused_node_id.load() - 1) / \
+           decltype(t->mapping_table)::SEGMENT_SIZE + 1);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(i).size() == 1UL);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * IntegerKeySearchTest() - Tests the integer key search path
+ *
+ * TreeType uses a custom comparator, so we use a tree with std::less here.
+ * Search routines are first compared with std::lower_bound() and
+ * std::upper_bound() on sorted arrays of different sizes with duplicated
+ * keys, and then the tree is verified after insert and delete
+ */
+void IntegerKeySearchTest(int key_num) {
+  printf("========== Integer Key Search Test ==========\n");
+
+  using IntegerTreeType = BwTree<long int, long int>;
+
+  auto t = new IntegerTreeType{true};
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  assert(IntegerTreeType::INTEGER_KEY_SEARCH == true);
+  assert(TreeType::INTEGER_KEY_SEARCH == false);
+
+  auto cmp = [](const std::pair<long int, long int> &p1,
+                const std::pair<long int, long int> &p2) {
+    return p1.first < p2.first;
+  };
+
+  for(int size = 0;size < 100;size++) {
+    std::vector<std::pair<long int, long int>> v{};
+    for(int i = 0;i < size;i++) {
+      // Each key appears twice
+      v.push_back(std::make_pair((long int)(i / 2 * 2), (long int)i));
+    }
+
+    const std::pair<long int, long int> *begin_p = v.data();
+    const std::pair<long int, long int> *end_p = v.data() + size;
+
+    for(long int key = -1;key <= size + 1;key++) {
+      auto pair = std::make_pair(key, 0L);
+
+      assert(t->KeyLowerBound(begin_p, end_p, key) == \
+             std::lower_bound(begin_p, end_p, pair, cmp));
+      assert(t->KeyUpperBound(begin_p, end_p, key) == \
+             std::upper_bound(begin_p, end_p, pair, cmp));
+      (void)pair;
+    }
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+    t->Insert(i, i + 1);
+  }
+
+  for(int i = 0;i < key_num;i += 2) {
+    t->Delete(i, i);
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    size_t expected = (i % 2 == 0) ? 1UL : 2UL;
+
+    assert(t->GetValue(i).size() == expected);
+    (void)expected;
+  }
+
+  assert(t->GetValue(-1).size() == 0UL);
+  assert(t->GetValue(key_num).size() == 0UL);
+
+  delete t;
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * NodeAllocatorTest() - Tests trees using the thread local pool allocator
+ *
+ * Keys inserted by one thread are deleted by another thread, such that
+ * nodes allocated from one pool are freed by the GC of other threads.
+ * Threads exit between phases, so pools are also reused by new threads
+ */
+void NodeAllocatorTest(int key_num) {
+  printf("========== Node Allocator Test ==========\n");
+
+  for(size_t size = 1;size <= 100000;size++) {
+    size_t size_class = ThreadLocalPoolAllocator::GetSizeClass(size);
+
+    assert(ThreadLocalPoolAllocator::GetClassSize(size_class) >= size);
+    assert((size_class == 0UL) || \
+           (ThreadLocalPoolAllocator::GetClassSize(size_class - 1) < size));
+    (void)size_class;
+  }
+
+  using PoolTreeType = BwTree<long int,
+                              long int,
+                              KeyComparator,
+                              KeyEqualityChecker,
+                              std::hash<long int>,
+                              std::equal_to<long int>,
+                              std::hash<long int>,
+                              DefaultTuningPolicy,
+                              ThreadLocalPoolAllocator>;
+
+  auto t = new PoolTreeType{true,
+                            KeyComparator{1},
+                            KeyEqualityChecker{1}};
+
+  const int thread_num = 4;
+  t->UpdateThreadLocal(thread_num);
+
+  auto insert_func = [key_num, thread_num](uint64_t thread_id,
+                                           PoolTreeType *t) {
+    t->AssignGCID(thread_id);
+
+    for(int i = thread_id;i < key_num;i += thread_num) {
+      t->Insert(i, i);
+    }
+
+    t->UnregisterThread(thread_id);
+
+    return;
+  };
+
+  auto delete_func = [key_num, thread_num](uint64_t thread_id,
+                                           PoolTreeType *t) {
+    t->AssignGCID(thread_id);
+
+    // Delete even keys inserted by the next thread
+    int start_key = (thread_id + 1) % thread_num;
+    for(int i = start_key;i < key_num;i += thread_num) {
+      if(i % 2 == 0) {
+        t->Delete(i, i);
+      }
+    }
+
+    t->UnregisterThread(thread_id);
+
+    return;
+  };
+
+  LaunchParallelTestID(nullptr, thread_num, insert_func, t);
+  LaunchParallelTestID(nullptr, thread_num, delete_func, t);
+
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  for(int i = 0;i < key_num;i++) {
+    size_t expected = (i % 2 == 0) ? 0UL : 1UL;
+
+    assert(t->GetValue(i).size() == expected);
+    (void)expected;
+  }
+
+  delete t;
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * GarbageCollectionTest() - Tests garbage segments and the adaptive
+ *                           GC threshold
+ *
+ * The tree does not advance the epoch by itself, so it only advances when
+ * we call IncreaseEpoch(). Before that no garbage could be freed and the
+ * threshold grows; after that GC catches up and the threshold shrinks
+ */
+void GarbageCollectionTest(int key_num) {
+  printf("========== Garbage Collection Test ==========\n");
+
+  auto t = new TreeType{false,
+                        KeyComparator{1},
+                        KeyEqualityChecker{1}};
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  auto metadata_p = t->GetGCMetaData(0);
+  uint64_t initial_threshold = metadata_p->gc_threshold;
+  (void)initial_threshold;
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  printf("Garbage count = %lu; threshold = %lu\n",
+         metadata_p->node_count,
+         metadata_p->gc_threshold);
+
+  // Nothing could be freed in epoch 0
+  assert(metadata_p->node_count > initial_threshold);
+  assert(metadata_p->gc_threshold > initial_threshold);
+  assert(metadata_p->node_count <= metadata_p->gc_threshold);
+
+  uint64_t max_threshold = metadata_p->gc_threshold;
+  (void)max_threshold;
+
+  // Keep producing garbage until GC is triggered, and advance the epoch
+  // frequently as worker threads would do
+  int round = 0;
+  while(metadata_p->gc_threshold == max_threshold) {
+    assert(round < 16);
+
+    for(int i = 0;i < key_num;i++) {
+      if(i % 1024 == 0) {
+        t->IncreaseEpoch();
+      }
+
+      t->Delete(i, i);
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      if(i % 1024 == 0) {
+        t->IncreaseEpoch();
+      }
+
+      t->Insert(i, i);
+    }
+
+    round++;
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    if(i % 1024 == 0) {
+      t->IncreaseEpoch();
+    }
+
+    t->Delete(i, i);
+  }
+
+  printf("Garbage count = %lu; threshold = %lu\n",
+         metadata_p->node_count,
+         metadata_p->gc_threshold);
+
+  // All garbage before the new epoch has been freed at least once
+  assert(metadata_p->gc_threshold < max_threshold);
+  assert(metadata_p->free_segment_p != nullptr);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(i).size() == 0UL);
+  }
+
+  delete t;
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * BackgroundConsolidationTest() - Tests consolidation in background threads
+ *
+ * Worker threads insert and delete disjoint keys while two background
+ * threads consolidate and split nodes. A small hard cap factor is used in
+ * the second phase to also exercise the inline fallback
+ */
+void BackgroundConsolidationTest(int key_num) {
+  printf("========== Background Consolidation Test ==========\n");
+
+  const int thread_num = 4;
+  const int background_thread_num = 2;
+
+  for(int hard_cap_factor : {CONSOLIDATION_HARD_CAP_FACTOR, 2}) {
+    TreeType *t = GetEmptyTree(true);
+    t->UpdateThreadLocal(thread_num + background_thread_num);
+    t->StartConsolidationThreads(background_thread_num, hard_cap_factor);
+
+    auto insert_func = [key_num, thread_num](uint64_t thread_id,
+                                             TreeType *t) {
+      t->AssignGCID(thread_id);
+
+      for(int i = thread_id;i < key_num;i += thread_num) {
+        t->Insert(i, i);
+        t->Insert(i, i + 1);
+      }
+
+      t->UnregisterThread(thread_id);
+
+      return;
+    };
+
+    auto delete_func = [key_num, thread_num](uint64_t thread_id,
+                                             TreeType *t) {
+      t->AssignGCID(thread_id);
+
+      for(int i = thread_id;i < key_num;i += thread_num) {
+        t->Delete(i, i);
+      }
+
+      t->UnregisterThread(thread_id);
+
+      return;
+    };
+
+    // The thread local array also serves background threads
+    LaunchParallelTestID(nullptr, thread_num, insert_func, t);
+
+    for(int i = 0;i < key_num;i++) {
+      assert(t->GetValue(i).size() == 2UL);
+    }
+
+    LaunchParallelTestID(nullptr, thread_num, delete_func, t);
+
+    t->StopConsolidationThreads();
+
+    for(int i = 0;i < key_num;i++) {
+      auto value_set = t->GetValue(i);
+
+      assert(value_set.size() == 1UL);
+      assert(*value_set.begin() == i + 1);
+      (void)value_set;
+    }
+
+    DestroyTree(t, true);
+  }
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * UniqueKeyTest() - Tests the tree with UniqueKey set to true
+ *
+ * Each key could only be mapped to one value. Threads insert, update and
+ * delete disjoint keys, and values are read without a value set
+ */
+void UniqueKeyTest(int key_num) {
+  printf("========== Unique Key Test ==========\n");
+
+  using UniqueTreeType = BwTree<long int,
+                                long int,
+                                KeyComparator,
+                                KeyEqualityChecker,
+                                std::hash<long int>,
+                                std::equal_to<long int>,
+                                std::hash<long int>,
+                                DefaultTuningPolicy,
+                                DefaultNodeAllocator,
+                                true>;
+
+  const int thread_num = 4;
+
+  UniqueTreeType *t = new UniqueTreeType{true,
+                                         KeyComparator{1},
+                                         KeyEqualityChecker{1}};
+  t->UpdateThreadLocal(thread_num);
+
+  auto work_func = [key_num, thread_num](uint64_t thread_id,
+                                         UniqueTreeType *t) {
+    t->AssignGCID(thread_id);
+
+    for(int i = thread_id;i < key_num;i += thread_num) {
+      bool ret = t->Insert(i, i);
+      assert(ret == true);
+
+      // Another value of the same key is rejected
+      ret = t->Insert(i, i + 1);
+      assert(ret == false);
+
+      // Odd keys are deleted and then inserted with another value
+      if(i % 2 == 1) {
+        ret = t->Delete(i, i);
+        assert(ret == true);
+
+        ret = t->Insert(i, i + 1);
+        assert(ret == true);
+      }
+
+      // Every fourth key is updated in place
+      if(i % 4 == 0) {
+        ret = t->Update(i, i, i + 2);
+        assert(ret == true);
+
+        ret = t->Upsert(i, i + 3);
+        assert(ret == false);
+      }
+
+      (void)ret;
+    }
+
+    t->UnregisterThread(thread_id);
+
+    return;
+  };
+
+  LaunchParallelTestID(nullptr, thread_num, work_func, t);
+
+  t->AssignGCID(0);
+
+  for(int i = 0;i < key_num;i++) {
+    long int value = -1;
+    bool ret = t->GetValue(i, &value);
+    assert(ret == true);
+
+    long int expected = i;
+    if(i % 2 == 1) {
+      expected = i + 1;
+    } else if(i % 4 == 0) {
+      expected = i + 3;
+    }
+
+    assert(value == expected);
+
+    // The value set interface sees the same value
+    auto value_set = t->GetValue(i);
+    assert(value_set.size() == 1UL);
+    assert(*value_set.begin() == expected);
+
+    (void)ret;
+    (void)value_set;
+    (void)expected;
+  }
+
+  // Keys outside the range are not found and the output is untouched
+  long int value = -1;
+  bool ret = t->GetValue(key_num, &value);
+  assert(ret == false);
+  assert(value == -1);
+
+  // Inserting new keys with Upsert()
+  ret = t->Upsert(key_num, 0);
+  assert(ret == true);
+  ret = t->GetValue(key_num, &value);
+  assert(ret == true);
+  assert(value == 0);
+  (void)ret;
+  (void)value;
+
+  t->UnregisterThread(0);
+
+  delete t;
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * GetValueBufferTest() - Tests GetValue() into a buffer and VisitValue()
+ *
+ * Each key has a different number of values, some of which are deleted,
+ * so that the buffer overflows for some keys but not others
+ */
+void GetValueBufferTest(int key_num) {
+  printf("========== GetValue Buffer Test ==========\n");
+
+  const int max_value_num = 8;
+  const size_t buffer_size = 4;
+
+  TreeType *t = GetEmptyTree(true);
+
+  for(int i = 0;i < key_num;i++) {
+    for(int j = 0;j < i % max_value_num;j++) {
+      t->Insert(i, j);
+    }
+
+    // The first value is deleted if there is one
+    if(i % max_value_num != 0) {
+      t->Delete(i, 0);
+    }
+  }
+
+  for(int i = 0;i < key_num + 1;i++) {
+    // The last key does not exist
+    size_t expected = 0UL;
+    if((i < key_num) && (i % max_value_num != 0)) {
+      expected = i % max_value_num - 1;
+    }
+
+    long int buffer[buffer_size + 1];
+    buffer[buffer_size] = -1;
+
+    size_t value_num = t->GetValue(i, buffer, buffer_size);
+    assert(value_num == expected);
+
+    // Values in the buffer are distinct and within range
+    size_t copy_num = std::min(value_num, buffer_size);
+    std::unordered_set<long int> value_set{buffer, buffer + copy_num};
+    assert(value_set.size() == copy_num);
+    for(long int value : value_set) {
+      assert((value >= 1) && (value < max_value_num));
+      (void)value;
+    }
+
+    // Overflown values are not written
+    assert(buffer[buffer_size] == -1);
+
+    // The visitor sees all values
+    size_t visit_num = 0UL;
+    t->VisitValue(i, [&visit_num](const long int &value) {
+      assert(value != 0);
+      (void)value;
+
+      visit_num++;
+    });
+    assert(visit_num == expected);
+
+    assert(t->GetValue(i).size() == expected);
+
+    (void)value_num;
+    (void)visit_num;
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * StringSeparatorTest() - Tests truncated separators of string keys
+ *
+ * Keys share a long common prefix. After leaf splits and after bulk loading
+ * the low key of each split leaf must be a short separator that is <= the
+ * first key in the leaf, and all keys must still be found
+ */
+void StringSeparatorTest(int key_num) {
+  printf("========== String Separator Test ==========\n");
+
+  using StringTreeType = BwTree<std::string, long int>;
+
+  assert(StringTreeType::STRING_KEY_SEPARATOR == true);
+  assert(TreeType::STRING_KEY_SEPARATOR == false);
+
+  assert(StringTreeType::GetSeparatorKey("abc", "abd") == "abd");
+  assert(StringTreeType::GetSeparatorKey("abc", "abcd") == "abcd");
+  assert(StringTreeType::GetSeparatorKey("abcx", "abd") == "abd");
+  assert(StringTreeType::GetSeparatorKey("ab", "b") == "b");
+  assert(StringTreeType::GetSeparatorKey("abc", "abzzz") == "abz");
+  assert(StringTreeType::GetSeparatorKey("", "zzz") == "z");
+
+  const std::string prefix{"http://www.example.com/users/"};
+
+  std::vector<std::string> key_list{};
+  for(int i = 0;i < key_num;i++) {
+    char buffer[16];
+    sprintf(buffer, "%08d", i);
+
+    key_list.push_back(prefix + buffer);
+  }
+
+  // This checks leaf low keys and looks up all keys
+  auto verify_func = [&key_list, &prefix](StringTreeType *t) {
+    size_t short_key_count = 0UL;
+    NodeID end_node_id = t->next_unused_node_id.load();
+
+    for(NodeID node_id = 1;node_id < end_node_id;node_id++) {
+      const StringTreeType::BaseNode *node_p = t->GetNode(node_id);
+      if((node_p == nullptr) ||
+         (node_p->GetType() != StringTreeType::NodeType::LeafType) ||
+         (node_p->GetLowKeyPair().second == INVALID_NODE_ID)) {
+        continue;
+      }
+
+      const StringTreeType::LeafNode *leaf_node_p = \
+        static_cast<const StringTreeType::LeafNode *>(node_p);
+      const std::string &low_key = leaf_node_p->GetLowKey();
+
+      if(leaf_node_p->GetSize() > 0) {
+        assert(low_key <= leaf_node_p->At(0).first);
+      }
+
+      if(low_key.size() < prefix.size() + 8UL) {
+        short_key_count++;
+      }
+    }
+
+    assert(short_key_count > 0UL);
+    (void)short_key_count;
+
+    for(size_t i = 0;i < key_list.size();i++) {
+      auto value_set = t->GetValue(key_list[i]);
+
+      assert(value_set.size() == 1UL);
+      assert(*value_set.begin() == (long int)i);
+      (void)value_set;
+    }
+
+    assert(t->GetValue(prefix).size() == 0UL);
+  };
+
+  auto t = new StringTreeType{true};
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(key_list[i], i);
+  }
+
+  verify_func(t);
+
+  // Deleting every other key merges leaves using their low keys
+  for(int i = 0;i < key_num;i += 2) {
+    t->Delete(key_list[i], i);
+  }
+
+  for(int i = 0;i < key_num;i += 2) {
+    assert(t->GetValue(key_list[i]).size() == 0UL);
+    t->Insert(key_list[i], i);
+  }
+
+  verify_func(t);
+
+  delete t;
+
+  t = new StringTreeType{true};
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  std::vector<std::pair<std::string, long int>> item_list{};
+  for(int i = 0;i < key_num;i++) {
+    item_list.push_back(std::make_pair(key_list[i], (long int)i));
+  }
+
+  t->BulkLoad(item_list.begin(), item_list.end());
+
+  verify_func(t);
+
+  delete t;
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * FixedLengthKeyTest() - Tests compound binary keys
+ *
+ * Keys are (signed 8 byte, unsigned 4 byte, 4 byte string) columns. The
+ * comparator must agree with the order of the column tuple, and the tree
+ * must find all keys after insert and delete
+ */
+void FixedLengthKeyTest(int key_num) {
+  printf("========== Fixed Length Key Test ==========\n");
+
+  using KeyType = FixedLengthKey<16>;
+  using FixedKeyTreeType = BwTree<KeyType,
+                                  long int,
+                                  FixedLengthKeyComparator<16>,
+                                  FixedLengthKeyEqualityChecker<16>,
+                                  FixedLengthKeyHashFunc<16>>;
+
+  auto make_key = [](long int a, uint32_t b, const char *c) {
+    KeyType key{};
+    key.SetSigned(0, a);
+    key.SetUnsigned(8, b, 4);
+    key.SetBytes(12, c, strlen(c), 4);
+
+    return key;
+  };
+
+  FixedLengthKeyComparator<16> cmp{};
+  FixedLengthKeyEqualityChecker<16> eq{};
+
+  const long int a_list[] = {-1000000000000L, -2, -1, 0, 1, 255, 256, 1L << 40};
+  const uint32_t b_list[] = {0, 1, 255, 0x7FFFFFFF, 0xFFFFFFFF};
+  const char *c_list[] = {"", "a", "ab", "abcd", "b"};
+
+  // Columns are listed in ascending order, so the key order is the same
+  // as the order of triples of indices
+  std::vector<KeyType> sorted_key_list{};
+  for(long int a : a_list) {
+    for(uint32_t b : b_list) {
+      for(const char *c : c_list) {
+        KeyType key = make_key(a, b, c);
+
+        assert(key.GetSigned(0) == a);
+        assert(key.GetUnsigned(8, 4) == b);
+
+        sorted_key_list.push_back(key);
+      }
+    }
+  }
+
+  for(size_t i = 0;i < sorted_key_list.size();i++) {
+    for(size_t j = 0;j < sorted_key_list.size();j++) {
+      assert(cmp(sorted_key_list[i], sorted_key_list[j]) == (i < j));
+      assert(eq(sorted_key_list[i], sorted_key_list[j]) == (i == j));
+    }
+  }
+
+  // Short signed columns are sign extended
+  KeyType short_key{};
+  short_key.SetSigned(0, -3, 2);
+  assert(short_key.GetSigned(0, 2) == -3);
+  short_key.SetSigned(0, 300, 2);
+  assert(short_key.GetSigned(0, 2) == 300);
+
+  auto t = new FixedKeyTreeType{true,
+                                FixedLengthKeyComparator<16>{},
+                                FixedLengthKeyEqualityChecker<16>{},
+                                FixedLengthKeyHashFunc<16>{}};
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  for(int i = 0;i < key_num;i++) {
+    // The first column decides the order of most keys
+    t->Insert(make_key(i / 4 - key_num / 8, i % 4, "k"), i);
+  }
+
+  for(int i = 0;i < key_num;i += 2) {
+    t->Delete(make_key(i / 4 - key_num / 8, i % 4, "k"), i);
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    auto value_set = t->GetValue(make_key(i / 4 - key_num / 8, i % 4, "k"));
+
+    if(i % 2 == 0) {
+      assert(value_set.size() == 0UL);
+    } else {
+      assert(value_set.size() == 1UL);
+      assert(*value_set.begin() == i);
+    }
+
+    (void)value_set;
+  }
+
+  // Iterating the tree goes in the order of the first column
+  long int prev_a = -key_num;
+  size_t item_count = 0UL;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    long int a = it->first.GetSigned(0);
+    assert(a >= prev_a);
+
+    prev_a = a;
+    item_count++;
+  }
+
+  assert(item_count == static_cast<size_t>(key_num / 2));
+  (void)item_count;
+
+  delete t;
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * InnerSearchIndexTest() - Tests the Eytzinger search index of inner nodes
+ *
+ * Small inner nodes are used so that there are several inner levels. After
+ * insert and delete all inner nodes with a search index are checked against
+ * the binary search on their separator array
+ */
+void InnerSearchIndexTest(int key_num) {
+  printf("========== Inner Search Index Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetInnerNodeSearchIndex(true);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  for(int i = 0;i < key_num;i += 3) {
+    t->Delete(i, i);
+  }
+
+  size_t index_count = 0UL;
+  NodeID end_node_id = t->next_unused_node_id.load();
+
+  for(NodeID node_id = 1;node_id < end_node_id;node_id++) {
+    const TreeType::BaseNode *node_p = t->GetNode(node_id);
+    if((node_p == nullptr) ||
+       (node_p->GetType() != TreeType::NodeType::InnerType)) {
+      continue;
+    }
+
+    const TreeType::InnerNode *inner_node_p = \
+      static_cast<const TreeType::InnerNode *>(node_p);
+    if(inner_node_p->GetSearchIndex() == nullptr) {
+      continue;
+    }
+
+    index_count++;
+
+    // Probe keys around each separator and outside of the node
+    std::vector<long int> probe_list{node_p->GetLowKey(), -1, key_num};
+    for(auto it = inner_node_p->Begin() + 1;it != inner_node_p->End();it++) {
+      probe_list.push_back(it->first - 1);
+      probe_list.push_back(it->first);
+      probe_list.push_back(it->first + 1);
+    }
+
+    for(long int key : probe_list) {
+      auto it = std::upper_bound(inner_node_p->Begin() + 1,
+                                 inner_node_p->End(),
+                                 std::make_pair(key, INVALID_NODE_ID),
+                                 t->key_node_id_pair_cmp_obj) - 1;
+
+      assert(t->SearchInnerSearchIndex(key, inner_node_p) == it->second);
+      (void)it;
+    }
+  }
+
+  assert(index_count > 0UL);
+  (void)index_count;
+
+  for(int i = 0;i < key_num;i++) {
+    size_t expected = (i % 3 == 0) ? 0UL : 1UL;
+
+    assert(t->GetValue(i).size() == expected);
+    (void)expected;
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * StatisticsTest() - Tests per-thread statistics and GetStatistics()
+ *
+ * Counters are first checked against the operations of a single thread on
+ * a tree with small nodes, and then summed over threads inserting disjoint
+ * keys while snapshots are being taken
+ */
+void StatisticsTest(int key_num) {
+  printf("========== Statistics Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  // Duplicated key-value pairs are counted as operations but never abort
+  for(int i = 0;i < key_num;i++) {
+    bool ret = t->Insert(i, i);
+    assert(ret == false);
+    (void)ret;
+  }
+
+  TreeType::Statistics stat = t->GetStatistics();
+
+  assert(stat.insert_op_count == 2UL * key_num);
+  assert(stat.insert_abort_count == 0UL);
+  assert(stat.traversal_count >= 2UL * key_num);
+  assert(stat.node_visit_count >= stat.traversal_count);
+  assert(stat.split_count > 0UL);
+  assert(stat.consolidation_count > 0UL);
+  assert(stat.smo_help_count >= stat.split_count);
+  assert(stat.merge_count == 0UL);
+
+  int delete_count = 0;
+  for(int i = 0;i < key_num;i++) {
+    if(i % 4 != 0) {
+      t->Delete(i, i);
+      delete_count++;
+    }
+  }
+
+  for(int i = 0;i < key_num;i += 4) {
+    t->Upsert(i, i + 1);
+  }
+
+  // Long delta chains are consolidated and merged when they are loaded
+  // again by the following deletes, which do not find the pair
+  for(int i = 0;i < key_num;i++) {
+    if(i % 4 != 0) {
+      bool ret = t->Delete(i, i);
+      assert(ret == false);
+      (void)ret;
+    }
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    size_t expected = (i % 4 == 0) ? 1UL : 0UL;
+
+    assert(t->GetValue(i).size() == expected);
+    (void)expected;
+  }
+
+  stat = t->GetStatistics();
+
+  assert(stat.delete_op_count == 2UL * delete_count);
+  assert(stat.update_op_count == static_cast<uint64_t>((key_num + 3) / 4));
+  assert(stat.read_op_count == static_cast<uint64_t>(key_num));
+  assert(stat.delete_abort_count == 0UL);
+  assert(stat.update_abort_count == 0UL);
+  assert(stat.merge_count > 0UL);
+  assert(stat.gc_backlog == t->GetGCMetaData(0)->node_count);
+
+  // Garbage of the consolidations above has been collected at least once
+  assert(stat.gc_count > 0UL);
+  assert(stat.gc_time > 0UL);
+
+  DestroyTree(t, true);
+
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->UpdateThreadLocal(thread_num);
+
+  auto insert_func = [key_num, thread_num](uint64_t thread_id,
+                                           TreeType *t) {
+    t->AssignGCID(thread_id);
+
+    uint64_t op_count = 0UL;
+    for(int i = thread_id;i < key_num;i += thread_num) {
+      t->Insert(i, i);
+      op_count++;
+
+      // Snapshots never miss operations of the calling thread
+      if(i % 64 == 0) {
+        assert(t->GetStatistics().insert_op_count >= op_count);
+      }
+    }
+
+    t->UnregisterThread(thread_id);
+
+    return;
+  };
+
+  LaunchParallelTestID(nullptr, thread_num, insert_func, t);
+
+  stat = t->GetStatistics();
+
+  assert(stat.insert_op_count == static_cast<uint64_t>(key_num));
+  assert(stat.traversal_count >= stat.insert_op_count + \
+                                 stat.insert_abort_count);
+
+  // All threads have unregistered
+  assert(stat.epoch_lag == 0UL);
+
+  t->AssignGCID(0);
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * EpochAdvanceTest() - Tests garbage collection with epochs advanced by
+ *                      worker threads
+ *
+ * Threads repeatedly insert and delete disjoint keys. Garbage is collected
+ * after the epoch is advanced on leaving an operation, so the garbage of
+ * each thread stays bounded by its threshold
+ */
+void EpochAdvanceTest(int key_num) {
+  printf("========== Epoch Advance Test ==========\n");
+
+  const int thread_num = 4;
+  const int round_num = 4;
+
+  TreeType *t = GetEmptyTree(true);
+  t->UpdateThreadLocal(thread_num);
+
+  auto func = [key_num, thread_num, round_num](uint64_t thread_id,
+                                               TreeType *t) {
+    t->AssignGCID(thread_id);
+
+    auto metadata_p = t->GetGCMetaData(thread_id);
+
+    for(int round = 0;round < round_num;round++) {
+      for(int i = thread_id;i < key_num;i += thread_num) {
+        t->Insert(i, i);
+      }
+
+      for(int i = thread_id;i < key_num;i += thread_num) {
+        t->Delete(i, i);
+      }
+
+      // The garbage of one operation is bounded by a small constant
+      assert(metadata_p->node_count <= metadata_p->gc_threshold + 64UL);
+    }
+
+    // Do not block GC of other threads after this thread has finished
+    t->UnregisterThread(thread_id);
+
+    return;
+  };
+
+  LaunchParallelTestID(nullptr, thread_num, func, t);
+
+  assert(t->GetGlobalEpoch() > 0UL);
+
+  // Other threads have unregistered, so the garbage of this thread is
+  // always freed after it advances the epoch
+  t->AssignGCID(0);
+
+  auto metadata_p = t->GetGCMetaData(0);
+  uint64_t epoch = t->GetGlobalEpoch();
+  (void)epoch;
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+    t->Delete(i, i);
+  }
+
+  assert(t->GetGlobalEpoch() > epoch);
+  assert(metadata_p->node_count <= metadata_p->gc_threshold);
+  assert(metadata_p->free_segment_p != nullptr);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(i).size() == 0UL);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * ThreadRegistrationTest() - Tests GC ID recycling of registered threads
+ *
+ * Waves of threads register themselves, work on the tree and exit. IDs of
+ * exited threads are reused by the next wave, so the largest ID is bounded
+ * by the number of live threads, and exited threads never prevent GC
+ */
+void ThreadRegistrationTest(int key_num) {
+  printf("========== Thread Registration Test ==========\n");
+
+  const int thread_num = 4;
+  const int wave_num = 8;
+
+  TreeType *t = GetEmptyTree(true);
+
+  std::atomic<int> max_gc_id{-1};
+  std::atomic<uint64_t> gc_id_mask{0UL};
+
+  auto func = [key_num, thread_num, &max_gc_id, &gc_id_mask](
+      uint64_t thread_id, TreeType *t) {
+    TreeType::RegisterThread();
+
+    // Registering again does not change the ID
+    int gc_id = TreeType::GetGCID();
+    TreeType::RegisterThread();
+    assert(TreeType::GetGCID() == gc_id);
+    assert(gc_id >= 0 && gc_id < 64);
+
+    // Live threads never share an ID
+    uint64_t prev_mask = gc_id_mask.fetch_or(0x1UL << gc_id);
+    assert((prev_mask & (0x1UL << gc_id)) == 0UL);
+    (void)prev_mask;
+
+    int current_max = max_gc_id.load();
+    while(current_max < gc_id && \
+          max_gc_id.compare_exchange_strong(current_max, gc_id) == false);
+
+    for(int i = thread_id;i < key_num;i += thread_num) {
+      t->Insert(i, i);
+    }
+
+    for(int i = thread_id;i < key_num;i += thread_num) {
+      t->Delete(i, i);
+    }
+
+    // The ID is released when the thread exits
+    return;
+  };
+
+  for(int wave = 0;wave < wave_num;wave++) {
+    gc_id_mask.store(0UL);
+
+    LaunchParallelTestID(nullptr, thread_num, func, t);
+  }
+
+  // IDs are reused by later waves
+  assert(max_gc_id.load() < thread_num);
+
+  auto stat = t->GetStatistics();
+
+  assert(stat.insert_op_count == static_cast<uint64_t>(wave_num) * key_num);
+  assert(stat.delete_op_count == static_cast<uint64_t>(wave_num) * key_num);
+
+  // Slots of exited threads are ignored
+  assert(stat.epoch_lag == 0UL);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(i).size() == 0UL);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * CheckpointTest() - Tests writing a tree into a checkpoint file and
+ *                    restoring it into another tree
+ *
+ * The tree is checkpointed with both a single writer and multiple writers,
+ * and both files should restore to the same content as the original tree.
+ * Restoring from an invalid file should fail without touching the tree
+ */
+void CheckpointTest(int key_num) {
+  printf("========== Checkpoint Test ==========\n");
+
+  const char *path_list[] = {"checkpoint_test_1.bin", "checkpoint_test_4.bin"};
+  const int thread_num_list[] = {1, 4};
+
+  TreeType *t = GetEmptyTree(true);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+    t->Insert(i, i + 1);
+  }
+
+  // Leave some leaves with delta chains and merged nodes
+  for(int i = 0;i < key_num;i += 3) {
+    t->Delete(i, i + 1);
+  }
+
+  for(int i = 0;i < 2;i++) {
+    bool ret = t->Checkpoint(path_list[i], thread_num_list[i]);
+    assert(ret == true);
+
+    TreeType *t2 = GetEmptyTree(true);
+    ret = t2->Restore(path_list[i]);
+    assert(ret == true);
+
+    auto it2 = t2->Begin();
+    for(auto it = t->Begin();it.IsEnd() == false;it++) {
+      assert(it2.IsEnd() == false);
+      assert(it->first == it2->first);
+      assert(it->second == it2->second);
+
+      it2++;
+    }
+
+    assert(it2.IsEnd() == true);
+
+    for(int j = 0;j < key_num;j++) {
+      assert(t2->GetValue(j).size() == (j % 3 == 0 ? 1UL : 2UL));
+    }
+
+    DestroyTree(t2, true);
+  }
+
+  // Truncating the file invalidates the page table
+  int truncate_ret = truncate(path_list[1], 4096);
+  assert(truncate_ret == 0);
+  (void)truncate_ret;
+
+  TreeType *t3 = GetEmptyTree(true);
+  bool ret = t3->Restore(path_list[1]);
+  assert(ret == false);
+  ret = t3->Restore("checkpoint_test_missing.bin");
+  assert(ret == false);
+  (void)ret;
+  assert(t3->Begin().IsEnd() == true);
+
+  DestroyTree(t3, true);
+
+  for(int i = 0;i < 2;i++) {
+    remove(path_list[i]);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * InsertBatchTest() - Tests inserting batches of pairs with multiple threads
+ *
+ * Half of the keys are inserted before, and the batch contains pairs
+ * already in the tree and repeated pairs, which should all be ignored.
+ * Another thread keeps inserting into the same key range while the batch
+ * is being inserted
+ */
+void InsertBatchTest(int key_num) {
+  printf("========== Insert Batch Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+
+  for(int i = 0;i < key_num;i += 2) {
+    t->Insert(i, i);
+  }
+
+  // Odd keys have two values, and every pair appears twice
+  std::vector<std::pair<long int, long int>> batch{};
+  for(int i = 0;i < key_num;i++) {
+    batch.push_back(std::make_pair(i, i));
+
+    if(i % 2 == 1) {
+      batch.push_back(std::make_pair(i, i + 1));
+      batch.push_back(std::make_pair(i, i));
+    }
+  }
+
+  std::shuffle(batch.begin(), batch.end(), std::mt19937_64{0});
+
+  size_t ret = t->InsertBatch(batch.data(), batch.size(), 4);
+  assert(ret == static_cast<size_t>(key_num / 2 * 2));
+
+  // Nothing is new in the second time
+  ret = t->InsertBatch(batch.data(), batch.size(), 1);
+  assert(ret == 0UL);
+
+  long int key = 0;
+  long int count = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first >= key);
+
+    key = it->first;
+    count++;
+  }
+
+  assert(count == key_num / 2 + key_num / 2 * 2);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(i).size() == (i % 2 == 0 ? 1UL : 2UL));
+  }
+
+  // Batches racing with normal inserts on the same leaves
+  std::vector<std::pair<long int, long int>> batch2{};
+  for(int i = 0;i < key_num;i++) {
+    batch2.push_back(std::make_pair(i, i + 2));
+  }
+
+  auto func = [key_num, &batch2](uint64_t thread_id, TreeType *t) {
+    if(thread_id == 0) {
+      t->InsertBatch(batch2.data(), batch2.size(), 1);
+    } else {
+      for(int i = 0;i < key_num;i++) {
+        t->Insert(i, i + 3);
+      }
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, 2, func, t);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(i).size() == (i % 2 == 0 ? 3UL : 4UL));
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * LeafBatchInsertTest() - Tests posting small batches as a single
+ *                         LeafBatchInsertNode
+ *
+ * A small batch into one leaf should be a single delta node, and point
+ * queries, range scans, updates, deletes and consolidation should all see
+ * pairs inside it. Then many small batches are inserted into a larger tree
+ * and the result is compared with the expected content
+ */
+void LeafBatchInsertTest(int key_num) {
+  printf("========== Leaf Batch Insert Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+
+  for(int i = 0;i < 10;i++) {
+    t->Insert(i, i);
+  }
+
+  // Key 5 exists, and key 21 has two values
+  std::vector<std::pair<long int, long int>> batch{
+    {20, 20}, {21, 21}, {21, 22}, {5, 5}, {15, 15}};
+
+  size_t ret = t->InsertBatch(batch.data(), batch.size(), 1);
+  assert(ret == 4UL);
+
+  const BaseNode *node_p = t->GetNode(FIRST_LEAF_NODE_ID);
+  assert(node_p->GetType() == TreeType::NodeType::LeafBatchInsertType);
+  assert(node_p->GetItemCount() == 14);
+
+  assert(t->GetValue(15).size() == 1UL);
+  assert(t->GetValue(21).size() == 2UL);
+  assert(t->GetValue(5).size() == 1UL);
+
+  bool op_ret = t->Insert(21, 22);
+  assert(op_ret == false);
+
+  size_t scan_count = t->RangeScan(
+    15, 22, 100,
+    [](const long int &key, const long int &value) {
+      assert(key >= 15 && key < 22);
+      (void)value;
+    });
+  assert(scan_count == 4UL);
+  (void)scan_count;
+
+  op_ret = t->Update(20, 20, 30);
+  assert(op_ret == true);
+  op_ret = t->Delete(21, 21);
+  assert(op_ret == true);
+  (void)op_ret;
+
+  assert(*t->GetValue(20).begin() == 30);
+  assert(t->GetValue(21).size() == 1UL);
+
+  // (20, 20) and (21, 21) have been replaced or deleted
+  ret = t->InsertBatch(batch.data(), batch.size() - 2, 1);
+  assert(ret == 2UL);
+
+  // Consolidation merges all embedded insert nodes
+  NodeSnapshot snapshot{FIRST_LEAF_NODE_ID, t->GetNode(FIRST_LEAF_NODE_ID)};
+  t->ConsolidateNode(&snapshot);
+  assert(t->GetNode(FIRST_LEAF_NODE_ID)->GetType() == \
+         TreeType::NodeType::LeafType);
+
+  long int expected_list[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 15, 20, 20, 21, 21};
+  int index = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == expected_list[index]);
+    index++;
+  }
+
+  assert(index == 15);
+
+  DestroyTree(t, true);
+
+  // Batches of three keys into every leaf
+  t = GetEmptyTree(true);
+
+  for(int i = 0;i < key_num;i += 4) {
+    t->Insert(i, i);
+  }
+
+  for(int i = 0;i < key_num;i += 4) {
+    std::pair<long int, long int> small_batch[] = {
+      {i + 1, i + 1}, {i + 2, i + 2}, {i + 3, i + 3}, {i, i}};
+
+    ret = t->InsertBatch(small_batch, 4, 1);
+    assert(ret == 3UL);
+  }
+
+  (void)ret;
+
+  long int key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    assert(it->second == key);
+    key++;
+  }
+
+  assert(key == (key_num + 3) / 4 * 4);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(i).size() == 1UL);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * AdaptiveConsolidationTest() - Tests delta chain thresholds chosen by the
+ *                               sampled access mix of leaves
+ *
+ * A read-hot leaf should be consolidated by readers before its chain
+ * reaches the static threshold, and a write-hot leaf should be consolidated
+ * less often than it is without adaptive consolidation
+ */
+void AdaptiveConsolidationTest(int key_num) {
+  printf("========== Adaptive Consolidation Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetAdaptiveConsolidation(true);
+
+  for(int i = 0;i < 5;i++) {
+    t->Insert(i, i);
+  }
+
+  assert(t->GetNode(FIRST_LEAF_NODE_ID)->GetDepth() == 5);
+
+  for(int i = 0;i < 100;i++) {
+    assert(t->GetValue(i % 5).size() == 1UL);
+  }
+
+  TreeType::Statistics stat = t->GetStatistics();
+  assert(stat.early_consolidation_count >= 1UL);
+  assert(t->GetNode(FIRST_LEAF_NODE_ID)->IsDeltaNode() == false);
+
+  for(int i = 0;i < 5;i++) {
+    assert(*t->GetValue(i).begin() == i);
+  }
+
+  DestroyTree(t, true);
+
+  // Insert-only workloads into a single leaf with and without adaptive
+  // consolidation
+  uint64_t consolidation_count[2];
+  int insert_num = std::min(key_num, 100);
+
+  for(int adaptive = 0;adaptive < 2;adaptive++) {
+    t = GetEmptyTree(true);
+    t->SetAdaptiveConsolidation(adaptive == 1);
+
+    for(int i = 0;i < insert_num;i++) {
+      t->Insert(i, i);
+    }
+
+    for(int i = 0;i < insert_num;i++) {
+      assert(*t->GetValue(i).begin() == i);
+    }
+
+    stat = t->GetStatistics();
+    consolidation_count[adaptive] = stat.consolidation_count;
+
+    if(adaptive == 1) {
+      assert(stat.deferred_consolidation_count >= 1UL);
+    } else {
+      assert(stat.deferred_consolidation_count == 0UL);
+      assert(stat.early_consolidation_count == 0UL);
+    }
+
+    DestroyTree(t, true);
+  }
+
+  assert(consolidation_count[1] < consolidation_count[0]);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * ReadCacheTest() - Tests the hot key read cache in front of GetValue()
+ *
+ * Repeated reads should hit the cache, and every kind of write should
+ * invalidate the key such that the next read sees the written value. Then
+ * one thread keeps updating a few hot keys while other threads read them,
+ * and readers should never observe a value older than one already seen
+ */
+void ReadCacheTest(int key_num) {
+  printf("========== Read Cache Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetReadCacheSize(1024);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  for(int i = 0;i < 100;i++) {
+    assert(*t->GetValue(i).begin() == i);
+  }
+
+  TreeType::Statistics stat = t->GetStatistics();
+  assert(stat.read_cache_miss_count == 100UL);
+  assert(stat.read_cache_hit_count == 0UL);
+
+  long int value = -1;
+  for(int i = 0;i < 100;i++) {
+    std::vector<long int> value_list{};
+    t->GetValue(i, value_list);
+    assert(value_list.size() == 1UL && value_list[0] == i);
+  }
+
+  stat = t->GetStatistics();
+  assert(stat.read_cache_hit_count >= 90UL);
+
+  // Keys with more than one value are not cached
+  t->Insert(5, 50);
+  assert(t->GetValue(5).size() == 2UL);
+  assert(t->GetValue(5).size() == 2UL);
+
+  t->Delete(5, 5);
+  assert(*t->GetValue(5).begin() == 50);
+
+  t->Update(6, 6, 60);
+  assert(*t->GetValue(6).begin() == 60);
+
+  t->Upsert(7, 70);
+  assert(*t->GetValue(7).begin() == 70);
+
+  t->Delete(8, 8);
+  assert(t->GetValue(8).size() == 0UL);
+  size_t value_count = t->GetValue(8, &value, 1);
+  assert(value_count == 0UL);
+  (void)value_count;
+
+  std::pair<long int, long int> batch[] = {{8, 80}, {9, 90}};
+  t->InsertBatch(batch, 2, 1);
+  assert(*t->GetValue(8).begin() == 80);
+  assert(t->GetValue(9).size() == 2UL);
+
+  DestroyTree(t, true);
+
+  // Concurrent updates of hot keys
+  const int hot_key_num = 16;
+  const int update_num = 1000;
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->UpdateThreadLocal(thread_num);
+  t->SetReadCacheSize(256);
+
+  for(int i = 0;i < hot_key_num;i++) {
+    t->Insert(i, 0);
+  }
+
+  auto func = [hot_key_num, update_num](uint64_t thread_id, TreeType *t) {
+    if(thread_id == 0) {
+      for(int j = 0;j < update_num;j++) {
+        for(int i = 0;i < hot_key_num;i++) {
+          bool ret = t->Update(i, j, j + 1);
+          assert(ret == true);
+          (void)ret;
+        }
+      }
+
+      return;
+    }
+
+    long int last_value_list[hot_key_num] = {0};
+
+    for(int j = 0;j < update_num * 4;j++) {
+      int key = j % hot_key_num;
+      std::vector<long int> value_list{};
+
+      t->GetValue(key, value_list);
+      assert(value_list.size() == 1UL);
+      assert(value_list[0] >= last_value_list[key]);
+      assert(value_list[0] <= update_num);
+
+      last_value_list[key] = value_list[0];
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  for(int i = 0;i < hot_key_num;i++) {
+    assert(*t->GetValue(i).begin() == update_num);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * LeafFingerTest() - Tests modifications starting from leaf fingers
+ *
+ * Sequential inserts should mostly start from the finger while leaves keep
+ * splitting. Deletes that empty leaves and cause merges should still be
+ * correct, and so should threads inserting their own increasing ranges
+ */
+void LeafFingerTest(int key_num) {
+  printf("========== Leaf Finger Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetLeafFingerMode(true);
+
+  for(int i = 0;i < key_num;i++) {
+    bool ret = t->Insert(i, i);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  TreeType::Statistics stat = t->GetStatistics();
+  assert(stat.leaf_finger_hit_count + stat.leaf_finger_miss_count == \
+         static_cast<uint64_t>(key_num));
+  assert(stat.leaf_finger_hit_count > stat.leaf_finger_miss_count);
+  assert(stat.split_count > 0UL);
+
+  // Duplicates are found from the finger as well
+  for(int i = 0;i < key_num;i++) {
+    bool ret = t->Insert(i, i);
+    assert(ret == false);
+    (void)ret;
+  }
+
+  for(int i = key_num - 1;i >= 0;i--) {
+    if(i % 4 != 0) {
+      bool ret = t->Delete(i, i);
+      assert(ret == true);
+      (void)ret;
+    }
+  }
+
+  for(int i = 0;i < key_num;i += 4) {
+    bool ret = t->Update(i, i, i + 1);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  long int key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    assert(it->second == key + 1);
+    key += 4;
+  }
+
+  assert(key == (key_num + 3) / 4 * 4);
+
+  DestroyTree(t, true);
+
+  // Each thread inserts an increasing range of its own
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetLeafFingerMode(true);
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    for(int i = 0;i < key_num;i++) {
+      t->Insert(static_cast<long int>(thread_id) * key_num + i, i);
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    assert(it->second == key % key_num);
+    key++;
+  }
+
+  assert(key == static_cast<long int>(thread_num) * key_num);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * SplitPolicyTest() - Tests uneven splits of the right edge under
+ *                     increasing keys
+ */
+void SplitPolicyTest(int key_num) {
+  printf("========== Split Policy Test ==========\n");
+
+  uint64_t split_count[2];
+
+  for(int round = 0;round < 2;round++) {
+    TreeType *t = GetEmptyTree(true);
+    t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+    if(round == 1) {
+      t->SetSplitPolicy(50, 90);
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      bool ret = t->Insert(i, i);
+      assert(ret == true);
+      (void)ret;
+    }
+
+    split_count[round] = t->GetStatistics().split_count;
+
+    long int key = 0;
+    for(auto it = t->Begin();it.IsEnd() == false;it++) {
+      assert(it->first == key);
+      assert(it->second == key);
+      key++;
+    }
+
+    assert(key == key_num);
+
+    // Removing most keys merges the left nodes, while the small right edge
+    // nodes stay until they are empty
+    for(int i = 0;i < key_num;i++) {
+      if(i % 8 != 0) {
+        bool ret = t->Delete(i, i);
+        assert(ret == true);
+        (void)ret;
+      }
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      std::vector<long int> value_list;
+      t->GetValue(i, value_list);
+      assert(value_list.size() == (i % 8 == 0 ? 1UL : 0UL));
+    }
+
+    DestroyTree(t, true);
+  }
+
+  // Left nodes are kept almost full, so there are fewer splits
+  printf("Split count = %lu (50/50), %lu (90/10)\n",
+         split_count[0],
+         split_count[1]);
+  assert(split_count[1] * 4 < split_count[0] * 3);
+
+  // Random keys with an uneven policy for nodes with a right sibling
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetSplitPolicy(70, 90);
+
+  std::vector<long int> key_list;
+  for(int i = 0;i < key_num;i++) {
+    key_list.push_back(i);
+  }
+
+  std::shuffle(key_list.begin(), key_list.end(), std::mt19937_64{0});
+
+  for(long int key : key_list) {
+    bool ret = t->Insert(key, key);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  long int key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    key++;
+  }
+
+  assert(key == key_num);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * CompactTest() - Tests merging under-full nodes after range deletes
+ */
+void CompactTest(int key_num) {
+  printf("========== Compact Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    bool ret = t->Insert(i, i);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  // Keep one key out of every 16 in the lower half, which leaves leaves
+  // with one or two items that are above the lower threshold after
+  // consolidation
+  for(int i = 0;i < key_num / 2;i++) {
+    if(i % 16 != 0) {
+      bool ret = t->Delete(i, i);
+      assert(ret == true);
+      (void)ret;
+    }
+  }
+
+  uint64_t merge_count = t->GetStatistics().merge_count;
+
+  size_t freed_size = t->Compact(0, key_num / 2);
+  uint64_t compact_merge_count = \
+    t->GetStatistics().merge_count - merge_count;
+
+  printf("Compact merged %lu nodes and freed %lu bytes\n",
+         compact_merge_count,
+         freed_size);
+  assert(compact_merge_count > 0UL);
+  assert(freed_size > 0UL);
+
+  // Nodes left are above the compaction threshold, except for leftmost
+  // children which could only be merged after their parents
+  size_t second_freed_size = t->Compact(0, key_num / 2);
+  assert(second_freed_size < freed_size);
+  (void)second_freed_size;
+
+  for(int i = 0;i < key_num;i++) {
+    std::vector<long int> value_list;
+    t->GetValue(i, value_list);
+
+    if(i < key_num / 2 && i % 16 != 0) {
+      assert(value_list.size() == 0UL);
+    } else {
+      assert(value_list.size() == 1UL);
+      assert(value_list[0] == i);
+    }
+  }
+
+  DestroyTree(t, true);
+
+  // Compact a deleted range while other threads insert above it
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    t->Delete(i, i);
+  }
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    if(thread_id == 0) {
+      for(int round = 0;round < 4;round++) {
+        t->Compact(0, key_num);
+      }
+
+      return;
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      t->Insert(static_cast<long int>(thread_id) * key_num + i, i);
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  long int key = key_num;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    assert(it->second == key % key_num);
+    key++;
+  }
+
+  assert(key == static_cast<long int>(thread_num) * key_num);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * DeleteRangeTest() - Tests deleting key ranges with range tombstones
+ */
+void DeleteRangeTest(int key_num) {
+  printf("========== Delete Range Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  // Keys with two values are deleted as a whole
+  for(int i = 0;i < key_num;i += 8) {
+    t->Insert(i, i + 1);
+  }
+
+  // The range ends in the middle of a leaf and so does it start
+  const int low_key = key_num / 4 + 3;
+  const int high_key = key_num / 2 + 7;
+
+  size_t delete_count = t->DeleteRange(low_key, high_key);
+
+  size_t expected_count = 0UL;
+  for(int i = low_key;i < high_key;i++) {
+    expected_count += (i % 8 == 0) ? 2UL : 1UL;
+  }
+
+  printf("DeleteRange deleted %lu pairs\n", delete_count);
+  assert(delete_count == expected_count);
+  (void)expected_count;
+
+  // Nothing is left to delete
+  delete_count = t->DeleteRange(low_key, high_key);
+  assert(delete_count == 0UL);
+
+  for(int i = 0;i < key_num;i++) {
+    std::vector<long int> value_list;
+    t->GetValue(i, value_list);
+
+    if(i >= low_key && i < high_key) {
+      assert(value_list.size() == 0UL);
+
+      bool ret = t->Delete(i, i);
+      assert(ret == false);
+      (void)ret;
+    } else {
+      assert(value_list.size() == ((i % 8 == 0) ? 2UL : 1UL));
+    }
+  }
+
+  // Keys hidden by range tombstones could be inserted again, which also
+  // consolidates leaves with tombstones on their chains
+  for(int i = low_key;i < high_key;i += 3) {
+    bool ret = t->Insert(i, i + 2);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  long int key_count = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    if(it->first >= low_key && it->first < high_key) {
+      assert((it->first - low_key) % 3 == 0);
+      assert(it->second == it->first + 2);
+    }
+
+    key_count++;
+  }
+
+  long int expected_key_count = 0;
+  for(int i = 0;i < key_num;i++) {
+    if(i >= low_key && i < high_key) {
+      expected_key_count += ((i - low_key) % 3 == 0) ? 1 : 0;
+    } else {
+      expected_key_count += (i % 8 == 0) ? 2 : 1;
+    }
+  }
+
+  assert(key_count == expected_key_count);
+  (void)expected_key_count;
+
+  for(int i = low_key;i < high_key;i++) {
+    std::vector<long int> value_list;
+    t->GetValue(i, value_list);
+
+    if((i - low_key) % 3 == 0) {
+      assert(value_list.size() == 1UL);
+      assert(value_list[0] == i + 2);
+    } else {
+      assert(value_list.size() == 0UL);
+    }
+  }
+
+  DestroyTree(t, true);
+
+  // Drop a range while other threads insert above it
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  std::atomic<size_t> range_delete_count{0UL};
+
+  auto func = [key_num, &range_delete_count](uint64_t thread_id,
+                                             TreeType *t) {
+    if(thread_id == 0) {
+      range_delete_count.fetch_add(t->DeleteRange(0, key_num));
+
+      return;
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      t->Insert(static_cast<long int>(thread_id) * key_num + i, i);
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  assert(range_delete_count.load() == static_cast<size_t>(key_num));
+
+  long int key = key_num;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    assert(it->second == key % key_num);
+    key++;
+  }
+
+  assert(key == static_cast<long int>(thread_num) * key_num);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * GetReachableNodeSize() - Returns the bytes of nodes reachable from the
+ *                          mapping table
+ *
+ * This must be called when there is no garbage left, such that every
+ * removed node has been unlinked from the mapping table
+ */
+static size_t GetReachableNodeSize(TreeType *t) {
+  size_t size = 0UL;
+  NodeID end_node_id = t->next_unused_node_id.load();
+
+  for(NodeID node_id = 1;node_id < end_node_id;node_id++) {
+    const TreeType::BaseNode *node_p = t->GetNode(node_id);
+    if(node_p != nullptr) {
+      size += t->GetDeltaChainMemorySize(node_p);
+    }
+  }
+
+  return size;
+}
+
+/*
+ * MemoryUsageTest() - Tests memory accounting and the soft memory limit
+ */
+void MemoryUsageTest(int key_num) {
+  printf("========== Memory Usage Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  TreeType::MemoryUsage usage = t->GetMemoryUsage();
+  assert(usage.node_size == GetReachableNodeSize(t));
+  assert(usage.mapping_table_size > 0UL);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  for(int i = 0;i < key_num;i += 2) {
+    t->Delete(i, i);
+  }
+
+  // This frees all garbage nodes and garbage list segments
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  usage = t->GetMemoryUsage();
+  printf("Node %lu; mapping table %lu; total %lu bytes\n",
+         usage.node_size,
+         usage.mapping_table_size,
+         usage.GetTotalSize());
+  assert(usage.node_size == GetReachableNodeSize(t));
+  assert(usage.garbage_size == 0UL);
+  assert(usage.garbage_list_size == 0UL);
+  assert(usage.iterator_size == 0UL);
+
+  {
+    auto it = t->Begin();
+    auto it2 = t->Begin(key_num / 2);
+    assert(it.IsEnd() == false);
+    assert(t->GetMemoryUsage().iterator_size > 0UL);
+
+    while(it.IsEnd() == false) {
+      it++;
+    }
+
+    for(int i = 0;i < key_num / 4 && it2.IsREnd() == false;i++) {
+      it2--;
+    }
+  }
+
+  assert(t->GetMemoryUsage().iterator_size == 0UL);
+
+  // Nodes are counted exactly under concurrent splits and merges
+  const int thread_num = 4;
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    for(int i = 0;i < key_num;i++) {
+      long int key = static_cast<long int>(thread_id) * key_num + i;
+
+      t->Insert(key, i);
+      if(i % 2 == 0) {
+        t->Delete(key - 1, i - 1);
+      }
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  usage = t->GetMemoryUsage();
+  assert(usage.node_size == GetReachableNodeSize(t));
+  assert(usage.garbage_size == 0UL);
+
+  DestroyTree(t, true);
+
+  // Above the limit garbage is collected when each operation finishes
+  t = GetEmptyTree(true);
+  t->SetMemoryLimit(1UL);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+    assert(t->GetMemoryUsage().garbage_size == 0UL);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * StableValueTest() - Tests stable value slots and their reuse through GC
+ */
+void StableValueTest(int key_num) {
+  printf("========== Stable Value Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+
+  std::vector<long int *> value_list{};
+  for(int i = 0;i < key_num;i++) {
+    long int *value_p = t->NewStableValue<long int>(i);
+    assert(*value_p == i);
+
+    value_list.push_back(value_p);
+  }
+
+  size_t stable_value_size = t->GetMemoryUsage().stable_value_size;
+  assert(stable_value_size > 0UL);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(*value_list[i] == i);
+
+    t->RetireStableValue(value_list[i]);
+  }
+
+  // All threads have left the epoch in which values were retired
+  t->IncreaseEpoch();
+  t->UpdateLastActiveEpoch();
+  t->PerformGC(0);
+
+  // Slots are reused without allocating new chunks
+  std::unordered_set<long int *> retired_set{value_list.begin(),
+                                             value_list.end()};
+  for(int i = 0;i < key_num;i++) {
+    long int *value_p = t->NewStableValue<long int>(-i);
+    assert(retired_set.find(value_p) != retired_set.end());
+
+    value_list[i] = value_p;
+  }
+
+  assert(t->GetMemoryUsage().stable_value_size == stable_value_size);
+
+  for(int i = 0;i < key_num;i++) {
+    assert(*value_list[i] == -i);
+
+    t->RetireStableValue(value_list[i]);
+  }
+
+  // Values stored in the tree are not handed out twice across threads
+  const int thread_num = 4;
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    for(int round = 0;round < 4;round++) {
+      for(int i = 0;i < key_num;i++) {
+        long int key = static_cast<long int>(thread_id) * key_num + i;
+        long int *value_p = t->NewStableValue<long int>(key);
+
+        t->Insert(key, reinterpret_cast<long int>(value_p));
+      }
+
+      for(int i = 0;i < key_num;i++) {
+        long int key = static_cast<long int>(thread_id) * key_num + i;
+        auto value_set = t->GetValue(key);
+        assert(value_set.size() == 1UL);
+
+        long int value = *value_set.begin();
+        long int *value_p = reinterpret_cast<long int *>(value);
+        assert(*value_p == key);
+
+        t->Delete(key, value);
+        t->RetireStableValue(value_p);
+      }
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  printf("Stable values: %lu bytes\n", t->GetMemoryUsage().stable_value_size);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * CompressedLeafTest() - Tests compression of cold leaves, decoding them
+ *                        on reads and expanding them on writes
+ */
+void CompressedLeafTest(int key_num) {
+  printf("========== Compressed Leaf Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+
+  // Negative keys and several values per key
+  const long int low_key = -key_num / 2;
+  const long int high_key = low_key + key_num;
+  const int value_num = 3;
+
+  for(long int key = low_key;key < high_key;key++) {
+    for(int j = 0;j < value_num;j++) {
+      t->Insert(key, key * value_num + j);
+    }
+  }
+
+  // Leaves with delta records are skipped
+  t->Compact(low_key, high_key);
+
+  size_t node_size = t->GetMemoryUsage().node_size;
+
+  // The first pass only starts counting epochs
+  size_t freed_size = t->CompressColdLeaves(low_key, high_key, 2);
+  assert(freed_size == 0UL);
+
+  t->IncreaseEpoch();
+  t->IncreaseEpoch();
+
+  freed_size = t->CompressColdLeaves(low_key, high_key, 2);
+  printf("Compressed leaves freed %lu out of %lu bytes\n",
+         freed_size,
+         node_size);
+  assert(freed_size > 0UL);
+  assert(node_size - t->GetMemoryUsage().node_size == freed_size);
+
+  auto check_key = [t, value_num](long int key, size_t expected_num) {
+    std::vector<long int> value_list;
+    t->GetValue(key, value_list);
+
+    assert(value_list.size() == expected_num);
+    for(size_t j = 0;j < value_list.size();j++) {
+      assert(value_list[j] >= key * value_num);
+      assert(value_list[j] <= key * value_num + value_num);
+    }
+
+    (void)expected_num;
+  };
+
+  for(long int key = low_key - 1;key <= high_key;key++) {
+    check_key(key, (key < low_key || key == high_key) ? 0UL : value_num);
+  }
+
+  // Point lookups decode leaves without expanding them
+  freed_size = t->CompressColdLeaves(low_key, high_key, 2);
+  assert(freed_size == 0UL);
+
+  // Scans in both directions decode leaves without expanding them either
+  long int item_count = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == low_key + item_count / value_num);
+    assert(it->second >= it->first * value_num);
+    assert(it->second < it->first * value_num + value_num);
+    item_count++;
+  }
+
+  assert(item_count == key_num * value_num);
+
+  for(auto it = t->RBegin(high_key);it.IsREnd() == false;it--) {
+    item_count--;
+    assert(it->first == low_key + item_count / value_num);
+  }
+
+  assert(item_count == 0);
+
+  size_t scan_count = t->RangeScan(
+    low_key + 1,
+    high_key - 1,
+    static_cast<size_t>(-1),
+    [&item_count, value_num](const long int &key, const long int &value) {
+      assert(value >= key * value_num && value < key * value_num + value_num);
+      item_count++;
+      (void)key;
+      (void)value;
+    });
+  assert(scan_count == static_cast<size_t>((key_num - 2) * value_num));
+  assert(item_count == (key_num - 2) * value_num);
+  (void)scan_count;
+
+  freed_size = t->CompressColdLeaves(low_key, high_key, 2);
+  assert(freed_size == 0UL);
+
+  // Modifications expand the leaf
+  for(long int key = low_key;key < high_key;key += 16) {
+    t->Insert(key, key * value_num + value_num);
+    t->Delete(key, key * value_num);
+  }
+
+  for(long int key = low_key;key < high_key;key++) {
+    check_key(key, value_num);
+  }
+
+  // This frees all garbage nodes
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  assert(t->GetMemoryUsage().node_size == GetReachableNodeSize(t));
+
+  DestroyTree(t, true);
+
+  // Compress leaves while other threads read and modify them
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    if(thread_id == 0) {
+      for(int round = 0;round < 4;round++) {
+        t->Compact(0, key_num * thread_num);
+        t->CompressColdLeaves(0, key_num * thread_num, 0);
+      }
+
+      return;
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      t->Insert(static_cast<long int>(thread_id) * key_num + i, i);
+
+      std::vector<long int> value_list;
+      t->GetValue(i, value_list);
+      assert(value_list.size() == 1UL);
+      assert(value_list[0] == i);
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  for(int i = 0;i < key_num * thread_num;i++) {
+    std::vector<long int> value_list;
+    t->GetValue(i, value_list);
+    assert(value_list.size() == 1UL);
+    assert(value_list[0] == i % key_num);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * LeafRetryTest() - Tests retries of failed leaf deltas from the leaf
+ *
+ * A retry from a leaf whose range contains the key must not visit the
+ * root. Threads interleaving keys on the same few leaves cause failed
+ * installations, which are retried from the leaf, and the result should
+ * be the same as without the mode
+ */
+void LeafRetryTest(int key_num) {
+  printf("========== Leaf Retry Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetLeafRetryMode(true);
+
+  // RTM is only available if it is compiled in and the CPU supports it
+  bool rtm_ret = t->SetRTMMode(true);
+  #ifndef BWTREE_USE_RTM
+  assert(rtm_ret == false);
+  #endif
+  (void)rtm_ret;
+
+  for(int i = 0;i < key_num;i++) {
+    bool ret = t->Insert(i, i);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  // Retry a lookup of the middle key from its own leaf
+  long int key = key_num / 2;
+  NodeID node_id = INVALID_NODE_ID;
+
+  {
+    TreeType::EpochNode *epoch_node_p = t->epoch_manager.JoinEpoch();
+
+    TreeType::Context context{key};
+    std::pair<int, bool> index_pair;
+    t->Traverse(&context, &key, &index_pair);
+    node_id = t->GetLatestNodeSnapshot(&context)->node_id;
+
+    uint64_t retry_count = t->GetStatistics().leaf_retry_count;
+    uint64_t traversal_count = t->GetStatistics().traversal_count;
+
+    TreeType::Context retry_context{key};
+    auto item_p = \
+      t->TraverseWithFinger(&retry_context, &key, &index_pair, node_id);
+    assert(item_p != nullptr);
+    assert(item_p->second == key);
+    assert(t->GetLatestNodeSnapshot(&retry_context)->node_id == node_id);
+    assert(t->GetStatistics().leaf_retry_count == retry_count + 1);
+    assert(t->GetStatistics().traversal_count == traversal_count);
+
+    // A key outside of the leaf falls back to the root
+    long int other_key = key_num - 1;
+    TreeType::Context other_context{other_key};
+    item_p = t->TraverseWithFinger(&other_context,
+                                   &other_key,
+                                   &index_pair,
+                                   node_id);
+    assert(item_p != nullptr);
+    assert(item_p->second == other_key);
+    assert(t->GetStatistics().leaf_retry_count == retry_count + 1);
+    (void)item_p;
+
+    t->epoch_manager.LeaveEpoch(epoch_node_p);
+  }
+
+  DestroyTree(t, true);
+
+  // Threads interleave keys so they contend on the same leaves
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetLeafRetryMode(true);
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    long int start = static_cast<long int>(thread_id);
+
+    for(long int i = start;i < key_num * thread_num;i += thread_num) {
+      t->Insert(i, i);
+    }
+
+    for(long int i = start;i < key_num * thread_num;i += thread_num) {
+      if(i % 8 < 4) {
+        t->Delete(i, i);
+      }
+    }
+
+    for(long int i = start;i < key_num * thread_num;i += thread_num) {
+      t->Upsert(i, i + 1);
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    assert(it->second == key + 1);
+    key++;
+  }
+
+  assert(key == static_cast<long int>(thread_num) * key_num);
+
+  TreeType::Statistics stat = t->GetStatistics();
+  assert(stat.leaf_retry_count <= stat.insert_abort_count + \
+                                  stat.delete_abort_count + \
+                                  stat.update_abort_count);
+  printf("%lu out of %lu failed installations retried from the leaf\n",
+         stat.leaf_retry_count,
+         stat.insert_abort_count + \
+         stat.delete_abort_count + \
+         stat.update_abort_count);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * EstimateCountTest() - Tests approximate size and range cardinality
+ *
+ * The approximate size is exact without concurrent modifications, and
+ * survives reallocation of the thread local array. Range estimates are
+ * checked against a loose bound, since they only assume that nodes on the
+ * same level are of similar sizes
+ */
+void EstimateCountTest(int key_num) {
+  printf("========== Estimate Count Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  assert(t->GetApproximateSize() == 0UL);
+  assert(t->EstimateCount(0, key_num) == 0UL);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  // Duplicates are not counted
+  for(int i = 0;i < key_num;i += 2) {
+    bool ret = t->Insert(i, i);
+    assert(ret == false);
+    (void)ret;
+  }
+
+  assert(t->GetApproximateSize() == static_cast<size_t>(key_num));
+
+  auto check_estimate = [&t](long int low_key, long int high_key) {
+    size_t actual_count = 0UL;
+    for(auto it = t->Begin(low_key);
+        it.IsEnd() == false && it->first < high_key;
+        it++) {
+      actual_count++;
+    }
+
+    size_t estimated_count = t->EstimateCount(low_key, high_key);
+    assert(estimated_count * 2 + 16 >= actual_count);
+    assert(estimated_count <= actual_count * 2 + 16);
+    (void)estimated_count;
+  };
+
+  check_estimate(0, key_num);
+  check_estimate(-key_num, key_num * 2);
+  check_estimate(key_num / 4, key_num / 2);
+  check_estimate(key_num / 2, key_num / 2 + 8);
+  check_estimate(key_num / 2, key_num / 2 + 1);
+
+  size_t estimated_count = t->EstimateCount(0, key_num);
+  printf("Estimated %lu out of %d items\n", estimated_count, key_num);
+
+  assert(t->EstimateCount(key_num, 0) == 0UL);
+  assert(t->EstimateCount(key_num, key_num) == 0UL);
+  assert(t->EstimateCount(key_num, key_num * 2) == 0UL);
+
+  // Remove three quarters of the keys, which causes merges
+  for(int i = 0;i < key_num;i++) {
+    if(i % 4 != 0) {
+      bool ret = t->Delete(i, i);
+      assert(ret == true);
+      (void)ret;
+    }
+  }
+
+  bool ret = t->Delete(1, 1);
+  assert(ret == false);
+  assert(t->GetApproximateSize() == static_cast<size_t>((key_num + 3) / 4));
+
+  check_estimate(0, key_num);
+  check_estimate(key_num / 4, key_num / 2);
+
+  size_t delete_count = t->DeleteRange(0, key_num / 2);
+  assert(delete_count == static_cast<size_t>((key_num / 2 + 3) / 4));
+  (void)delete_count;
+
+  ret = t->Upsert(key_num, 0);
+  assert(ret == true);
+  ret = t->Upsert(key_num, 1);
+  assert(ret == false);
+  (void)ret;
+
+  size_t size = static_cast<size_t>((key_num + 3) / 4 - \
+                                    (key_num / 2 + 3) / 4 + 1);
+  assert(t->GetApproximateSize() == size);
+
+  // Counters of the old thread local array are kept
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+  assert(t->GetApproximateSize() == size);
+  (void)size;
+
+  DestroyTree(t, true);
+
+  // Concurrent inserts and deletes of different threads
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  std::vector<TreeType::KeyValuePair> pair_list{};
+  for(int i = 0;i < key_num;i++) {
+    pair_list.push_back(std::make_pair(i, i));
+  }
+
+  t->BulkLoad(pair_list.begin(), pair_list.end());
+  assert(t->GetApproximateSize() == static_cast<size_t>(key_num));
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    for(int i = 0;i < key_num;i++) {
+      long int key = key_num + i * thread_num + static_cast<int>(thread_id);
+      t->Insert(key, key);
+
+      if(i % 2 == 0) {
+        t->Delete(key, key);
+      }
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  size_t actual_count = 0UL;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    actual_count++;
+  }
+
+  assert(actual_count == t->GetApproximateSize());
+  check_estimate(0, key_num * (thread_num + 1));
+  check_estimate(key_num, key_num * (thread_num + 1));
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * SampleKeysTest() - Tests random sampling of key value pairs
+ *
+ * Samples must be pairs in the tree, and should be spread over the key
+ * space roughly in proportion to the number of keys. Sampling runs
+ * concurrently with inserts and deletes in the second part
+ */
+void SampleKeysTest(int key_num) {
+  printf("========== Sample Keys Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  Random<uint64_t> seed_rand{0, UINT64_MAX};
+  std::mt19937_64 rng{seed_rand()};
+
+  size_t empty_sample_num = t->SampleKeys(16, rng).size();
+  assert(empty_sample_num == 0UL);
+  (void)empty_sample_num;
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  const size_t sample_num = 10000;
+  const int bucket_num = 4;
+  size_t bucket_list[bucket_num] = {0};
+
+  std::vector<TreeType::KeyValuePair> sample_list = \
+    t->SampleKeys(sample_num, rng);
+  assert(sample_list.size() == sample_num);
+
+  for(const TreeType::KeyValuePair &item : sample_list) {
+    assert(item.first >= 0 && item.first < key_num);
+    assert(item.second == item.first);
+
+    bucket_list[item.first * bucket_num / key_num]++;
+  }
+
+  // Each bucket expects 2500 samples
+  for(int i = 0;i < bucket_num;i++) {
+    printf("Bucket %d: %lu samples\n", i, bucket_list[i]);
+    assert(bucket_list[i] > sample_num / bucket_num / 2);
+    assert(bucket_list[i] < sample_num / bucket_num * 3 / 2);
+  }
+
+  // Only a quarter of keys remain, all in the upper half
+  for(int i = 0;i < key_num;i++) {
+    if(i < key_num / 2 || i % 2 == 1) {
+      t->Delete(i, i);
+    }
+  }
+
+  sample_list = t->SampleKeys(sample_num, rng);
+  assert(sample_list.size() == sample_num);
+
+  for(const TreeType::KeyValuePair &item : sample_list) {
+    assert(item.first >= key_num / 2 && item.first < key_num);
+    assert(item.first % 2 == 0);
+    assert(item.second == item.first);
+  }
+
+  DestroyTree(t, true);
+
+  // Thread 0 samples while other threads insert and delete
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  uint64_t seed = seed_rand();
+
+  auto func = [key_num, seed](uint64_t thread_id, TreeType *t) {
+    if(thread_id == 0) {
+      std::mt19937_64 thread_rng{seed};
+
+      for(int i = 0;i < 64;i++) {
+        std::vector<TreeType::KeyValuePair> thread_sample_list = \
+          t->SampleKeys(256, thread_rng);
+
+        for(const TreeType::KeyValuePair &item : thread_sample_list) {
+          assert(item.first >= 0 && item.first < key_num * 2);
+          assert(item.second == item.first);
+          (void)item;
+        }
+      }
+
+      return;
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      long int key = key_num + i;
+      if(key % (thread_num - 1) == static_cast<long int>(thread_id) - 1) {
+        t->Insert(key, key);
+        t->Delete(i, i);
+      }
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  sample_list = t->SampleKeys(sample_num, rng);
+  assert(sample_list.size() == sample_num);
+
+  for(const TreeType::KeyValuePair &item : sample_list) {
+    assert(item.first >= key_num && item.first < key_num * 2);
+    assert(item.second == item.first);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * IteratorPinTest() - Tests iterators reading consolidated leaves in place
+ */
+void IteratorPinTest(int key_num) {
+  printf("========== Iterator Pin Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  // After this every leaf is a base node without delta records
+  t->Compact(0, key_num);
+
+  {
+    auto it = t->Begin();
+    assert(t->GetMemoryUsage().iterator_size == \
+           sizeof(TreeType::IteratorContext));
+
+    long int key = 0;
+    while(it.IsEnd() == false) {
+      assert(it.IsPinned() == true);
+      assert(it->first == key);
+      assert(it->second == key);
+
+      key++;
+      it++;
+    }
+
+    assert(key == key_num);
+  }
+
+  assert(t->GetMemoryUsage().iterator_size == 0UL);
+
+  // A leaf with a delta chain is consolidated into a private copy
+  t->Insert(-1, -1);
+
+  {
+    auto it = t->Begin();
+    assert(it.IsPinned() == false);
+    assert(it->first == -1);
+  }
+
+  t->Delete(-1, -1);
+  t->Compact(-1, key_num);
+
+  // The pinned leaf is replaced and reclaimed while the iterator reads it
+  {
+    const TreeType::LeafNode *leaf_node_p = \
+      static_cast<const TreeType::LeafNode *>(t->GetNode(FIRST_LEAF_NODE_ID));
+    auto it = t->Begin();
+    auto it2 = it;
+    assert(it.IsPinned() == true);
+    assert(&*it == leaf_node_p->Begin());
+
+    for(int i = 0;i < 64;i++) {
+      t->Insert(-1, -1);
+      t->Delete(-1, -1);
+      t->Delete(0, 0);
+      t->Insert(0, 0);
+    }
+
+    t->Compact(-1, key_num);
+
+    // This frees all garbage nodes
+    t->UpdateThreadLocal(1);
+    t->AssignGCID(0);
+
+    assert(t->GetNode(FIRST_LEAF_NODE_ID) != leaf_node_p);
+    assert(&*it == leaf_node_p->Begin());
+
+    // Both iterators share the old leaf
+    assert(it->first == 0 && it->second == 0);
+    it2++;
+    assert(it2->first == 1 && it2->second == 1);
+
+    long int key = 0;
+    while(it.IsEnd() == false) {
+      assert(it->first == key);
+      assert(it->second == key);
+
+      key++;
+      it++;
+    }
+
+    assert(key == key_num);
+  }
+
+  assert(t->GetMemoryUsage().iterator_size == 0UL);
+
+  // A pinned leaf is freed by the iterator if it outlives the tree
+  auto it = t->Begin(key_num / 2);
+  assert(it.IsPinned() == true);
+
+  DestroyTree(t, true);
+
+  assert(it->first == key_num / 2);
+  assert(it->second == key_num / 2);
+
+  it = TreeType::ForwardIterator{};
+
+  // Concurrent scans of pinned leaves race with consolidation and GC
+  const int thread_num = 4;
+
+  t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i * 2, i * 2);
+  }
+
+  t->Compact(0, key_num * 2);
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    if(thread_id == 0) {
+      for(int i = 0;i < 8;i++) {
+        long int prev_key = -1;
+        for(auto it = t->Begin();it.IsEnd() == false;it++) {
+          assert(it->first > prev_key);
+          assert(it->first % 2 == 0 || it->first == it->second);
+          prev_key = it->first;
+        }
+
+        t->Compact(0, key_num * 2);
+      }
+
+      return;
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      long int key = i * 2 + 1;
+      if(i % (thread_num - 1) == static_cast<int>(thread_id) - 1) {
+        t->Insert(key, key);
+        t->Delete(key, key);
+      }
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * ParallelScanTest() - Tests partitioned scans with multiple threads
+ */
+void ParallelScanTest(int key_num) {
+  printf("========== Parallel Scan Test ==========\n");
+
+  const int thread_num = 4;
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  // Checks that partitions concatenated in order are [low_key, high_key)
+  auto check_scan = [t](long int low_key,
+                        long int high_key,
+                        int scan_num) -> size_t {
+    std::vector<std::vector<long int>> partition_list(scan_num);
+
+    size_t item_count = t->ParallelScan(low_key,
+                                        high_key,
+                                        scan_num,
+                                        [&partition_list](size_t partition_id,
+                                                          const long int &key,
+                                                          const long int &value) {
+      assert(key == value);
+      partition_list[partition_id].push_back(key);
+    });
+
+    assert(item_count == static_cast<size_t>(high_key - low_key));
+
+    long int key = low_key;
+    size_t nonempty_num = 0UL;
+    for(const std::vector<long int> &partition : partition_list) {
+      if(partition.empty() == false) {
+        nonempty_num++;
+      }
+
+      for(long int partition_key : partition) {
+        assert(partition_key == key);
+        key++;
+      }
+    }
+
+    assert(key == high_key);
+
+    return nonempty_num;
+  };
+
+  // The full range is cut into as many partitions as threads
+  assert(check_scan(0, key_num, thread_num) == \
+         static_cast<size_t>(thread_num));
+  assert(check_scan(0, key_num, 1) == 1UL);
+
+  // Ranges covering part of the tree, a single leaf, or nothing
+  check_scan(key_num / 3, key_num / 2, thread_num);
+  check_scan(key_num / 2, key_num / 2 + 3, thread_num);
+  check_scan(key_num / 2, key_num / 2, thread_num);
+
+  // The partitions are balanced even if the tree is not
+  std::vector<long int> boundary_list = \
+    t->GetScanPartitionKeys(0, nullptr, thread_num);
+  assert(boundary_list.size() == static_cast<size_t>(thread_num - 1));
+
+  for(int i = 0;i < thread_num - 1;i++) {
+    long int expected_key = static_cast<long int>(key_num) * (i + 1) / \
+                            thread_num;
+    assert(std::abs(boundary_list[i] - expected_key) < key_num / 8);
+  }
+
+  // Unbounded scan while other threads modify keys out of the range. All
+  // threads are registered since scan workers are
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    TreeType::RegisterThread();
+
+    if(thread_id == 0) {
+      for(int i = 0;i < 8;i++) {
+        std::atomic<size_t> scanned_count{0UL};
+
+        t->ParallelScan(0,
+                        thread_num,
+                        [key_num, &scanned_count](size_t,
+                                                  const long int &key,
+                                                  const long int &value) {
+          assert(key == value || key >= key_num);
+          scanned_count.fetch_add(1UL);
+          (void)key;
+          (void)value;
+        });
+
+        assert(scanned_count.load() >= static_cast<size_t>(key_num));
+      }
+
+      return;
+    }
+
+    for(int i = 0;i < key_num;i++) {
+      long int key = key_num + i;
+      if(i % (thread_num - 1) == static_cast<int>(thread_id) - 1) {
+        t->Insert(key, key);
+        t->Delete(key, key);
+      }
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(nullptr, thread_num, func, t);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * NodeIDCacheTest() - Tests NodeIDs handed out from thread-local chunks
+ */
+void NodeIDCacheTest(int key_num) {
+  printf("========== NodeID Cache Test ==========\n");
+
+  const int thread_num = 4;
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  // A chunk is reserved at once, and then used without the shared counter
+  NodeID first_node_id = t->GetNextNodeID();
+  assert(t->next_unused_node_id.load() == \
+         first_node_id + NODE_ID_CHUNK_SIZE);
+
+  for(NodeID i = 1;i < NODE_ID_CHUNK_SIZE;i++) {
+    NodeID node_id = t->GetNextNodeID();
+    assert(node_id == first_node_id + i);
+    (void)node_id;
+  }
+
+  assert(t->next_unused_node_id.load() == \
+         first_node_id + NODE_ID_CHUNK_SIZE);
+
+  NodeID next_node_id = t->GetNextNodeID();
+  assert(next_node_id == first_node_id + NODE_ID_CHUNK_SIZE);
+  (void)next_node_id;
+
+  // Threads never get the same NodeID
+  std::vector<std::vector<NodeID>> node_id_list(thread_num);
+
+  auto func = [key_num, &node_id_list](uint64_t thread_id, TreeType *t) {
+    for(int i = 0;i < key_num / thread_num;i++) {
+      node_id_list[thread_id].push_back(t->GetNextNodeID());
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func, t);
+
+  std::unordered_set<NodeID> node_id_set{};
+  for(const std::vector<NodeID> &thread_node_id_list : node_id_list) {
+    for(NodeID node_id : thread_node_id_list) {
+      assert(node_id > FIRST_LEAF_NODE_ID);
+      assert(node_id < t->next_unused_node_id.load());
+
+      bool insert_ret = node_id_set.insert(node_id).second;
+      assert(insert_ret == true);
+      (void)insert_ret;
+    }
+  }
+
+  // Concurrent splits take NodeIDs from their own chunks
+  auto func2 = [key_num](uint64_t thread_id, TreeType *t) {
+    for(int i = static_cast<int>(thread_id);i < key_num;i += thread_num) {
+      t->Insert(i, i);
+    }
+
+    return;
+  };
+
+  LaunchParallelTestID(t, thread_num, func2, t);
+
+  for(int i = 0;i < key_num;i++) {
+    auto value_set = t->GetValue(i);
+    assert(value_set.size() == 1UL);
+    assert(*value_set.begin() == i);
+  }
+
+  long int key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    key++;
+  }
+
+  assert(key == key_num);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * LeafFingerprintTest() - Tests key fingerprints of consolidated leaves
+ *
+ * Even keys are inserted and a third of them deleted, and then all leaves
+ * are consolidated by Compact(). All keys on leaves with a fingerprint must
+ * pass the filter, and most odd keys must be ruled out by it
+ */
+void LeafFingerprintTest(int key_num) {
+  printf("========== Leaf Fingerprint Test ==========\n");
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetLeafKeyFingerprint(true);
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(2 * i, i);
+  }
+
+  for(int i = 0;i < key_num;i += 3) {
+    t->Delete(2 * i, i);
+  }
+
+  // Leaves are consolidated after the deletes
+  t->Compact(0L, 2L * key_num);
+
+  size_t fingerprint_count = 0UL;
+  size_t probe_count = 0UL;
+  size_t false_positive_count = 0UL;
+  NodeID end_node_id = t->next_unused_node_id.load();
+
+  for(NodeID node_id = 1;node_id < end_node_id;node_id++) {
+    const TreeType::BaseNode *node_p = t->GetNode(node_id);
+    if((node_p == nullptr) ||
+       (node_p->GetType() != TreeType::NodeType::LeafType)) {
+      continue;
+    }
+
+    const TreeType::LeafNode *leaf_node_p = \
+      static_cast<const TreeType::LeafNode *>(node_p);
+    if(leaf_node_p->GetSearchIndex() == nullptr) {
+      continue;
+    }
+
+    fingerprint_count++;
+
+    // The extra bytes are accounted in the size of the node
+    assert(t->GetNodeAllocationSize(leaf_node_p) == \
+           leaf_node_p->GetAllocationSize( \
+             t->GetLeafFingerprintSize(leaf_node_p->GetItemCount())));
+
+    for(auto it = leaf_node_p->Begin();it != leaf_node_p->End();it++) {
+      assert(t->LeafFingerprintMayContain(leaf_node_p,
+                                          t->GetKeyHash(it->first)));
+
+      // Odd keys are never on the leaf
+      probe_count++;
+      if(t->LeafFingerprintMayContain(leaf_node_p,
+                                      t->GetKeyHash(it->first + 1))) {
+        false_positive_count++;
+      }
+    }
+  }
+
+  assert(fingerprint_count > 0UL);
+  assert(false_positive_count * 5UL < probe_count);
+  (void)fingerprint_count;
+  (void)probe_count;
+  (void)false_positive_count;
+
+  for(int i = 0;i < key_num;i++) {
+    size_t expected = (i % 3 == 0) ? 0UL : 1UL;
+
+    assert(t->GetValue(2 * i).size() == expected);
+    assert(t->GetValue(2 * i + 1).size() == 0UL);
+    (void)expected;
+  }
+
+  // Duplicates are found through the fingerprint and the key hashes of
+  // delta records, and missing keys are inserted
+  for(int i = 0;i < key_num;i++) {
+    bool ret = t->Insert(2 * i, i);
+    assert(ret == (i % 3 == 0));
+
+    ret = t->Insert(2 * i + 1, i);
+    assert(ret == true);
+
+    ret = t->Insert(2 * i + 1, i);
+    assert(ret == false);
+    (void)ret;
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    assert(t->GetValue(2 * i).size() == 1UL);
+    assert(t->GetValue(2 * i + 1).size() == 1UL);
+
+    bool ret = t->Delete(2 * i + 1, i);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  long int key = 0;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    key += 2;
+  }
+
+  assert(key == 2L * key_num);
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * PageAllocatorTest() - Tests huge page backing of the mapping table and
+ *                       node pools
+ *
+ * Huge pages are only hints, so this checks that regions are aligned and
+ * zero filled, and that the tree works on top of them
+ */
+void PageAllocatorTest(int key_num) {
+  printf("========== Page Allocator Test ==========\n");
+
+  const int flags = PageAllocator::HUGE_PAGE | PageAllocator::PREFAULT;
+  const size_t size = PageAllocator::HUGE_PAGE_SIZE + 1;
+
+  assert(PageAllocator::GetRegionSize(size, flags) == \
+         2 * PageAllocator::HUGE_PAGE_SIZE);
+  assert(PageAllocator::GetRegionSize(size, 0) == \
+         PageAllocator::HUGE_PAGE_SIZE + PageAllocator::SMALL_PAGE_SIZE);
+
+  char *region_p = static_cast<char *>(PageAllocator::Allocate(size, flags));
+  assert(region_p != nullptr);
+  assert(reinterpret_cast<uintptr_t>(region_p) % \
+         PageAllocator::HUGE_PAGE_SIZE == 0UL);
+
+  for(size_t i = 0;i < size;i++) {
+    assert(region_p[i] == 0);
+    region_p[i] = static_cast<char>(i);
+  }
+
+  PageAllocator::Free(region_p, size, flags);
+
+  using HugePageTreeType = BwTree<long int,
+                                  long int,
+                                  KeyComparator,
+                                  KeyEqualityChecker,
+                                  std::hash<long int>,
+                                  std::equal_to<long int>,
+                                  std::hash<long int>,
+                                  DefaultTuningPolicy,
+                                  HugePagePoolAllocator>;
+
+  auto t = new HugePageTreeType{true,
+                                KeyComparator{1},
+                                KeyEqualityChecker{1}};
+
+  t->UpdateThreadLocal(1);
+  t->AssignGCID(0);
+
+  // Nodes of the empty tree are moved into the new segments
+  t->SetMappingTablePageMode(PageAllocator::HUGE_PAGE | \
+                             PageAllocator::PREFAULT | \
+                             PageAllocator::INTERLEAVE,
+                             key_num);
+
+  size_t segment_count = t->mapping_table.GetSegmentCount();
+  assert(segment_count > 0UL);
+  assert(segment_count % \
+         decltype(t->mapping_table)::SEGMENT_GROUP_SIZE == 0UL);
+  (void)segment_count;
+
+  for(int i = 0;i < key_num;i++) {
+    bool ret = t->Insert(i, i);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  for(int i = 0;i < key_num;i += 2) {
+    bool ret = t->Delete(i, i);
+    assert(ret == true);
+    (void)ret;
+  }
+
+  for(int i = 0;i < key_num;i++) {
+    auto value_list = t->GetValue(i);
+
+    if(i % 2 == 0) {
+      assert(value_list.size() == 0UL);
+    } else {
+      assert(value_list.size() == 1UL);
+      assert(value_list.count(i) == 1UL);
+    }
+  }
+
+  long int key = 1;
+  for(auto it = t->Begin();it.IsEnd() == false;it++) {
+    assert(it->first == key);
+    key += 2;
+  }
+
+  delete t;
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * SnapshotTest() - Tests iterators of a snapshot while the tree is modified
+ *
+ * After a snapshot is taken, keys are deleted, updated, inserted one by one
+ * and in batches, and removed with range tombstones. Leaves are then split,
+ * merged, consolidated and compressed, and garbage is collected. Iterators
+ * of the snapshot must still see exactly the pairs before the snapshot,
+ * while normal iterators see the latest pairs
+ */
+void SnapshotTest(int key_num) {
+  printf("========== Snapshot Test ==========\n");
+
+  using PairList = std::vector<std::pair<long int, long int>>;
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+
+  PairList old_list{};
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(2 * i, i);
+    old_list.push_back(std::make_pair(2 * i, i));
+
+    // Every tenth key has two values
+    if(i % 10 == 0) {
+      t->Insert(2 * i, -i - 1);
+      old_list.push_back(std::make_pair(2 * i, -i - 1));
+    }
+  }
+
+  std::sort(old_list.begin(), old_list.end());
+
+  auto snapshot = t->Snapshot();
+  assert(snapshot.IsValid() == true);
+
+  auto collect = [](TreeType::ForwardIterator it) {
+    PairList item_list{};
+
+    for(;it.IsEnd() == false;it++) {
+      assert(item_list.size() == 0UL || item_list.back().first <= it->first);
+
+      item_list.push_back(*it);
+    }
+
+    std::sort(item_list.begin(), item_list.end());
+
+    return item_list;
+  };
+
+  for(int i = 0;i < key_num;i += 3) {
+    t->Delete(2 * i, i);
+  }
+
+  for(int i = 1;i < key_num;i += 3) {
+    t->Update(2 * i, i, i + 1);
+  }
+
+  for(int i = 0;i < key_num;i += 2) {
+    t->Insert(2 * i + 1, i);
+  }
+
+  PairList batch_list{};
+  for(int i = 0;i < key_num;i += 5) {
+    batch_list.push_back(std::make_pair(2 * key_num + i, i));
+  }
+
+  t->InsertBatch(batch_list.data(), batch_list.size());
+
+  // Go back from the end of the snapshot
+  auto it = t->Begin(snapshot, 2 * key_num);
+  assert(it.IsEnd() == true);
+
+  PairList back_list{};
+  for(--it;it.IsREnd() == false;--it) {
+    back_list.push_back(*it);
+  }
+
+  std::sort(back_list.begin(), back_list.end());
+  assert(back_list == old_list);
+
+  t->DeleteRange(key_num / 2, key_num);
+
+  t->Compact(0, 3 * key_num);
+  t->CompressColdLeaves(0, 3 * key_num, 0);
+
+  t->PerformGC(0);
+
+  PairList new_list = collect(t->Begin());
+  assert(new_list != old_list);
+
+  assert(collect(t->Begin(snapshot)) == old_list);
+
+  // Start from the middle of the snapshot
+  const long int start_key = key_num / 2 + 1;
+  const auto start_pair = \
+    std::make_pair(start_key, std::numeric_limits<long int>::min());
+
+  assert(collect(t->Begin(snapshot, start_key)) == \
+         PairList(std::lower_bound(old_list.begin(),
+                                   old_list.end(),
+                                   start_pair),
+                  old_list.end()));
+
+  // A new snapshot sees the latest pairs
+  auto new_snapshot = t->Snapshot();
+  assert(new_snapshot.GetVersion() > snapshot.GetVersion());
+  assert(collect(t->Begin(new_snapshot)) == new_list);
+
+  snapshot.Release();
+  assert(snapshot.IsValid() == false);
+
+  new_snapshot = std::move(snapshot);
+  assert(new_snapshot.IsValid() == false);
+
+  t->PerformGC(0);
+
+  assert(collect(t->Begin()) == new_list);
+
+  (void)start_pair;
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
+
+/*
+ * TruncateTest() - Tests Truncate() and parallel teardown of the tree
+ *
+ * The tree is truncated after inserts, and then refilled with inserts and
+ * with BulkLoad(). It is then truncated by a worker thread while other
+ * threads insert, with background consolidation running. The tree must be
+ * empty right after each truncation, pairs inserted after Truncate()
+ * returns must never be lost, and the old tree must be reclaimed in the
+ * background once this thread has left its epoch
+ */
+void TruncateTest(int key_num) {
+  printf("========== Truncate Test ==========\n");
+
+  const int thread_num = 4;
+  const int background_thread_num = 1;
+
+  TreeType *t = GetEmptyTree(true);
+  t->SetNodeSizeThreshold(16, 4, 16, 4);
+  t->SetLeafFingerMode(true);
+  t->SetTeardownThreadNum(thread_num);
+
+  auto check_empty = [key_num](TreeType *t) {
+    assert(t->Begin().IsEnd() == true);
+    assert(t->GetApproximateSize() == 0UL);
+
+    for(int i = 0;i < key_num;i++) {
+      assert(t->GetValue(i).size() == 0UL);
+    }
+  };
+
+  // Keys in [0, key_num) must be there with value = key, and the other
+  // keys could only be there with value = key
+  auto check_keys = [key_num](TreeType *t) {
+    long int prev_key = -1;
+    int count = 0;
+    for(auto it = t->Begin();it.IsEnd() == false;it++) {
+      assert(it->first > prev_key);
+      assert(it->second == it->first);
+
+      prev_key = it->first;
+      count += (it->first < key_num) ? 1 : 0;
+    }
+
+    assert(count == key_num);
+
+    for(int i = 0;i < key_num;i++) {
+      auto value_set = t->GetValue(i);
+
+      assert(value_set.size() == 1UL);
+      assert(*value_set.begin() == i);
+      (void)value_set;
+    }
+
+    (void)count;
+  };
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  NodeID old_root_id = t->root_id.load();
+
+  t->Truncate();
+
+  assert(t->root_id.load() != old_root_id);
+  assert(t->first_leaf_id.load() != FIRST_LEAF_NODE_ID);
+  (void)old_root_id;
+  check_empty(t);
+
+  // Leaf fingers into the old tree are not used, even if the old tree
+  // has not been freed yet
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  check_keys(t);
+
+  // This thread has left the epoch of Truncate(), so the reclaim thread
+  // frees the old tree without any help
+  assert(t->reclaim_task_list.size() == 1UL);
+  while(t->reclaim_task_list[0]->finish_flag.load() == false) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  t->Truncate();
+  check_empty(t);
+
+  std::vector<std::pair<long int, long int>> item_list{};
+  for(int i = 0;i < key_num;i++) {
+    item_list.push_back(std::make_pair(i, i));
+  }
+
+  t->BulkLoad(item_list.begin(), item_list.end());
+  check_keys(t);
+
+  // Finished reclaim threads are joined by the next Truncate()
+  t->Truncate();
+  check_empty(t);
+
+  assert(t->reclaim_task_list.size() <= 2UL);
+
+  auto wait_for_reclaim = [](TreeType *t) {
+    for(auto task_p : t->reclaim_task_list) {
+      while(task_p->finish_flag.load() == false) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  };
+
+  // NodeIDs of a freed tree are reused by the next refill, so neither the
+  // NodeID counter nor the mapping table grows over repeated cycles
+  NodeID next_unused_node_id = INVALID_NODE_ID;
+  size_t segment_count = 0UL;
+
+  for(int cycle = 0;cycle < 8;cycle++) {
+    for(int i = 0;i < key_num;i++) {
+      t->Insert(i, i);
+    }
+
+    check_keys(t);
+
+    NodeID cycle_root_id = t->root_id.load();
+
+    t->Truncate();
+    wait_for_reclaim(t);
+
+    // Nothing has been allocated since, so the NodeID is not reused yet
+    assert(t->GetNode(cycle_root_id) == nullptr);
+    (void)cycle_root_id;
+
+    if(cycle == 1) {
+      next_unused_node_id = t->next_unused_node_id.load();
+      segment_count = t->mapping_table.GetSegmentCount();
+    } else if(cycle > 1) {
+      assert(t->next_unused_node_id.load() <= \
+             next_unused_node_id + NODE_ID_CHUNK_SIZE);
+      assert(t->mapping_table.GetSegmentCount() == segment_count);
+    }
+  }
+
+  check_empty(t);
+
+  (void)next_unused_node_id;
+  (void)segment_count;
+
+  // A snapshot taken before Truncate() keeps iterating on the old tree,
+  // which is only reclaimed after the snapshot is released. Keys inserted
+  // after the snapshot split the root that the snapshot remembers
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  auto snapshot = t->Snapshot();
+
+  for(int i = key_num;i < 2 * key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  t->Truncate();
+
+  for(int i = 2 * key_num;i < 3 * key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  int snapshot_count = 0;
+  for(auto it = t->Begin(snapshot);it.IsEnd() == false;it++) {
+    assert(it->first == snapshot_count);
+    assert(it->second == it->first);
+
+    snapshot_count++;
+  }
+
+  assert(snapshot_count == key_num);
+  (void)snapshot_count;
+
+  auto snapshot_it = t->Begin(snapshot, key_num / 2);
+  assert(snapshot_it.IsEnd() == false);
+  assert(snapshot_it->first == key_num / 2);
+
+  // Going backward crosses leaf pages of the old tree
+  for(long int key = key_num / 2;key > 0;key--) {
+    snapshot_it--;
+
+    assert(snapshot_it.IsREnd() == false);
+    assert(snapshot_it->first == key - 1);
+  }
+
+  snapshot_it--;
+  assert(snapshot_it.IsREnd() == true);
+
+  auto current_it = t->Begin();
+  assert(current_it.IsEnd() == false);
+  assert(current_it->first == 2 * key_num);
+
+  assert(t->reclaim_task_list.back()->finish_flag.load() == false);
+
+  // Iterators must not outlive the snapshot, and pinned leaves must not
+  // outlive the tree
+  snapshot_it = t->NullIterator();
+  current_it = t->NullIterator();
+  snapshot.Release();
+  wait_for_reclaim(t);
+
+  t->Truncate();
+  check_empty(t);
+
+  t->UpdateThreadLocal(thread_num + background_thread_num);
+  t->StartConsolidationThreads(background_thread_num);
+
+  auto func = [key_num](uint64_t thread_id, TreeType *t) {
+    t->AssignGCID(thread_id);
+
+    if(thread_id == 0) {
+      for(int i = key_num;i < key_num + key_num / 2;i++) {
+        t->Insert(i, i);
+      }
+
+      t->Truncate();
+
+      for(int i = 0;i < key_num;i++) {
+        t->Insert(i, i);
+      }
+    } else {
+      for(int i = key_num + static_cast<int>(thread_id);
+          i < 3 * key_num;
+          i += thread_num - 1) {
+        t->Insert(i, i);
+      }
+    }
+
+    t->UnregisterThread(thread_id);
+
+    return;
+  };
+
+  LaunchParallelTestID(nullptr, thread_num, func, t);
+
+  t->StopConsolidationThreads();
+  assert(t->reclaim_task_list.empty() == true);
+
+  check_keys(t);
+
+  // Leave a tree to the reclaim thread, which is finished by the
+  // destructor together with the parallel teardown of the current tree
+  t->Truncate();
+
+  for(int i = 0;i < key_num;i++) {
+    t->Insert(i, i);
+  }
+
+  DestroyTree(t, true);
+
+  printf("PASS\n");
+
+  return;
+}
@@ -924,9 +924,14 @@ void InsertTest1(uint64_t thread_id, TreeType *t);
 void InsertTest2(uint64_t thread_id, TreeType *t);
 void DeleteTest1(uint64_t thread_id, TreeType *t);
 void DeleteTest2(uint64_t thread_id, TreeType *t);
+void UpdateTest1(uint64_t thread_id, TreeType *t);
+void UpsertTest2(uint64_t thread_id, TreeType *t);
 
 void InsertGetValueTest(TreeType *t);
+void InsertGetValueBatchTest(TreeType *t);
 void DeleteGetValueTest(TreeType *t);
+void UpdateGetValueTest(TreeType *t);
+void UpsertGetValueTest(TreeType *t);
 
 extern int basic_test_key_num;
 extern int basic_test_thread_num;
@@ -957,10 +962,22 @@ void TestBwTreeInsertReadPerformance(TreeType *t, int key_num);
 
 // Multithreaded benchmark
 void BenchmarkBwTreeRandInsert(int key_num, int thread_num);
-void BenchmarkBwTreeSeqInsert(TreeType *t, int key_num, int thread_num);
+void BenchmarkBwTreeSeqInsert(TreeType *t,
+                              int key_num,
+                              int thread_num,
+                              bool leaf_finger_flag);
 void BenchmarkBwTreeSeqRead(TreeType *t, int key_num, int thread_num);
 void BenchmarkBwTreeRandRead(TreeType *t, int key_num, int thread_num);
-void BenchmarkBwTreeZipfRead(TreeType *t, int key_num, int thread_num);
+void BenchmarkBwTreeRandReadBuffer(TreeType *t, int key_num, int thread_num);
+void BenchmarkBwTreeRandReadBatch(TreeType *t,
+                                  int key_num,
+                                  int thread_num,
+                                  bool prefetch_flag);
+double BenchmarkBwTreeZipfRead(TreeType *t,
+                               int key_num,
+                               int thread_num,
+                               size_t read_cache_size);
+void BenchmarkBwTreeBulkLoad(int key_num);
 
 // Benchmark for stx::btree
 void BenchmarkBTreeSeqInsert(BTreeType *t, 
@@ -982,6 +999,12 @@ void BenchmarkBTreeZipfLockLessRead(BTreeType *t,
                                     int key_num,
                                     int num_thread);
 
+// YCSB mixed workloads on BwTree and the baselines
+void BenchmarkYCSB(int thread_num);
+
+// Thread count sweep on BwTree and the locked B-tree
+void BenchmarkScalability(int max_thread_num);
+
 // Benchmark for ART              
 void BenchmarkARTSeqInsert(ARTType *t, 
                            int key_num, 
@@ -1009,6 +1032,8 @@ void StressTest(uint64_t thread_id, TreeType *t);
  */
 void ForwardIteratorTest(TreeType *t, int key_num);
 void BackwardIteratorTest(TreeType *t, int key_num);
+void ReverseIteratorTest(TreeType *t, int key_num);
+void RangeScanTest(TreeType *t, int key_num);
 
 /*
  * Random test suite
@@ -1026,4 +1051,41 @@ void RandomInsertVerify(TreeType *t);
  * Misc test suite
  */
 void TestEpochManager(TreeType *t);
+void BulkLoadTest(TreeType *t, int key_num);
+void TuningPolicyTest(int key_num);
+void MappingTableGrowthTest(int key_num);
+void IntegerKeySearchTest(int key_num);
+void NodeAllocatorTest(int key_num);
+void GarbageCollectionTest(int key_num);
+void BackgroundConsolidationTest(int key_num);
+void UniqueKeyTest(int key_num);
+void GetValueBufferTest(int key_num);
+void StringSeparatorTest(int key_num);
+void FixedLengthKeyTest(int key_num);
+void InnerSearchIndexTest(int key_num);
+void StatisticsTest(int key_num);
+void EpochAdvanceTest(int key_num);
+void ThreadRegistrationTest(int key_num);
+void CheckpointTest(int key_num);
+void InsertBatchTest(int key_num);
+void LeafBatchInsertTest(int key_num);
+void AdaptiveConsolidationTest(int key_num);
+void ReadCacheTest(int key_num);
+void LeafFingerTest(int key_num);
+void SplitPolicyTest(int key_num);
+void CompactTest(int key_num);
+void DeleteRangeTest(int key_num);
+void MemoryUsageTest(int key_num);
+void StableValueTest(int key_num);
+void CompressedLeafTest(int key_num);
+void LeafRetryTest(int key_num);
+void EstimateCountTest(int key_num);
+void SampleKeysTest(int key_num);
+void IteratorPinTest(int key_num);
+void ParallelScanTest(int key_num);
+void NodeIDCacheTest(int key_num);
+void LeafFingerprintTest(int key_num);
+void PageAllocatorTest(int key_num);
+void SnapshotTest(int key_num);
+void TruncateTest(int key_num);
 